@@ -36,6 +36,21 @@ function(td_set_up_compiler)
     set(HAVE_STD14 MSVC_VERSION>=1900)
   endif()
 
+  if (TD_ENABLE_COROUTINES AND (GCC OR CLANG))
+    include(CheckCXXSourceCompiles)
+    string(REPLACE "c++14" "c++20" STD20_FLAG "${STD14_FLAG}")
+    set(CMAKE_REQUIRED_FLAGS "${STD20_FLAG}")
+    check_cxx_source_compiles("#include <coroutine>\nint main() { std::coroutine_handle<> handle; return handle ? 1 : 0; }"
+      HAVE_COROUTINES)
+    unset(CMAKE_REQUIRED_FLAGS)
+    if (HAVE_COROUTINES)
+      set(STD14_FLAG ${STD20_FLAG})
+      set(TD_HAVE_COROUTINES 1 PARENT_SCOPE)
+    else()
+      message(WARNING "C++20 coroutines aren't supported by the compiler")
+    endif()
+  endif()
+
   if (NOT HAVE_STD14)
     message(FATAL_ERROR "No C++14 support in the compiler. Please upgrade the compiler.")
   endif()
@@ -8,10 +8,15 @@
 
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
+#include "td/actor/Timeout.h"
 
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
+#include "td/utils/Heap.h"
 #include "td/utils/logging.h"
+#include "td/utils/Random.h"
+#include "td/utils/Time.h"
+#include "td/utils/TimerWheel.h"
 
 #if TD_MSVC
 #pragma comment(linker, "/STACK:16777216")
@@ -266,26 +271,261 @@ class QueryBench : public td::Benchmark {
   td::ActorOwn<ServerActor> server_;
 };
 
-int main() {
+// creates and destroys batches of closure events, as it happens when they are queued in mailboxes
+class ClosureEventBench : public td::Benchmark {
+ public:
+  std::string get_description() const override {
+    return "ClosureEvent: create and destroy";
+  }
+
+  class TestActor : public td::Actor {
+   public:
+    void f(int x, td::string str) {
+    }
+  };
+
+  void run(int n) override {
+    const int BATCH_SIZE = 64;
+    td::vector<td::Event> events;
+    events.reserve(BATCH_SIZE);
+    for (int i = 0; i < n; i += BATCH_SIZE) {
+      for (int j = 0; j < BATCH_SIZE; j++) {
+        events.push_back(td::Event::delayed_closure(&TestActor::f, j, td::string()));
+      }
+      events.clear();
+    }
+  }
+};
+
+// creates batches of lambda promises and sets their values, as it happens with promises of queries
+class LambdaPromiseBench : public td::Benchmark {
+ public:
+  std::string get_description() const override {
+    return "LambdaPromise: create and set value";
+  }
+
+  void run(int n) override {
+    const int BATCH_SIZE = 64;
+    td::vector<td::Promise<int>> promises;
+    promises.reserve(BATCH_SIZE);
+    int sum = 0;
+    for (int i = 0; i < n; i += BATCH_SIZE) {
+      for (int j = 0; j < BATCH_SIZE; j++) {
+        promises.push_back(td::PromiseCreator::lambda([&sum, j](int value) { sum += value + j; }));
+      }
+      for (auto &promise : promises) {
+        promise.set_value(1);
+      }
+      promises.clear();
+    }
+    CHECK(sum != 0);
+  }
+};
+
+// changes state of an actor many times per loop, as Session and FileLoader do; each change wakes the actor up
+class WakeupBench : public td::Benchmark {
+ public:
+  std::string get_description() const override {
+    return "Wakeup: many state changes per loop";
+  }
+
+  static constexpr int CHANGES_PER_LOOP = 16;
+
+  class LoopActor : public td::Actor {
+   public:
+    explicit LoopActor(int change_count) : changes_left_(change_count) {
+    }
+
+    void on_change() {
+      pending_changes_--;
+      yield();
+    }
+
+    void start_up() override {
+      yield();
+    }
+
+    void loop() override {
+      loop_count_++;
+      if (pending_changes_ != 0) {
+        return;
+      }
+      if (changes_left_ <= 0) {
+        LOG(INFO) << "Run loop " << loop_count_ << " times, coalesced "
+                  << td::Scheduler::instance()->get_coalesced_wakeup_count() << " wakeups";
+        td::Scheduler::instance()->finish();
+        return stop();
+      }
+      for (int i = 0; i < CHANGES_PER_LOOP; i++) {
+        send_closure_later(actor_id(this), &LoopActor::on_change);
+      }
+      pending_changes_ += CHANGES_PER_LOOP;
+      changes_left_ -= CHANGES_PER_LOOP;
+    }
+
+   private:
+    int changes_left_;
+    int pending_changes_ = 0;
+    int loop_count_ = 0;
+  };
+
+  void run(int n) override {
+    td::ConcurrentScheduler scheduler;
+    scheduler.init(0);
+    scheduler.create_actor_unsafe<LoopActor>(0, "LoopActor", n).release();
+    scheduler.start();
+    while (scheduler.run_main(10)) {
+      // empty
+    }
+    scheduler.finish();
+  }
+};
+
+static const int PENDING_TIMEOUT_COUNT = 1 << 18;
+
+// changes random timeouts among many pending ones, as it is done for per-query timeouts
+template <int type>
+class TimeoutQueueBench : public td::Benchmark {
+ public:
+  std::string get_description() const override {
+    static const char *types[] = {"KHeap", "TimerWheel"};
+    static_assert(0 <= type && type < 2, "");
+    return PSTRING() << "TimeoutQueue: " << types[type] << " (pending = " << PENDING_TIMEOUT_COUNT << ")";
+  }
+
+  void start_up() override {
+    heap_nodes_ = td::vector<td::HeapNode>(PENDING_TIMEOUT_COUNT);
+    timer_wheel_nodes_ = td::vector<td::TimerWheelNode>(PENDING_TIMEOUT_COUNT);
+    now_ = td::Time::now();
+    timer_wheel_.set_now(now_);
+    for (int i = 0; i < PENDING_TIMEOUT_COUNT; i++) {
+      if (type == 0) {
+        heap_.insert(get_random_timeout_at(), &heap_nodes_[i]);
+      } else {
+        timer_wheel_.insert(get_random_timeout_at(), &timer_wheel_nodes_[i]);
+      }
+    }
+  }
+
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      auto id = td::Random::fast(0, PENDING_TIMEOUT_COUNT - 1);
+      // timeouts are set and cancelled much more often than they expire
+      if (type == 0) {
+        heap_.erase(&heap_nodes_[id]);
+        heap_.insert(get_random_timeout_at(), &heap_nodes_[id]);
+      } else {
+        timer_wheel_.erase(&timer_wheel_nodes_[id]);
+        timer_wheel_.insert(get_random_timeout_at(), &timer_wheel_nodes_[id]);
+      }
+    }
+  }
+
+  void tear_down() override {
+    for (int i = 0; i < PENDING_TIMEOUT_COUNT; i++) {
+      if (type == 0) {
+        heap_.erase(&heap_nodes_[i]);
+      } else {
+        timer_wheel_.erase(&timer_wheel_nodes_[i]);
+      }
+    }
+  }
+
+ private:
+  double now_ = 0.0;
+  td::vector<td::HeapNode> heap_nodes_;
+  td::KHeap<double> heap_;
+  td::vector<td::TimerWheelNode> timer_wheel_nodes_;
+  td::TimerWheel timer_wheel_;
+
+  double get_random_timeout_at() const {
+    return now_ + td::Random::fast(1.0, 100.0);
+  }
+};
+
+class MultiTimeoutBench : public td::Benchmark {
+ public:
+  std::string get_description() const override {
+    return PSTRING() << "MultiTimeout (pending = " << PENDING_TIMEOUT_COUNT << ")";
+  }
+
+  void start_up() override {
+    // MultiTimeout logs every change at DEBUG level
+    old_verbosity_level_ = GET_VERBOSITY_LEVEL();
+    SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+    scheduler_ = new td::ConcurrentScheduler();
+    scheduler_->init(0);
+    scheduler_->start();
+
+    auto guard = scheduler_->get_main_guard();
+    multi_timeout_ = td::make_unique<td::MultiTimeout>("MultiTimeout");
+    multi_timeout_->set_callback([](void *, td::int64) { UNREACHABLE(); });
+    for (int i = 0; i < PENDING_TIMEOUT_COUNT; i++) {
+      multi_timeout_->set_timeout_in(i, td::Random::fast(1.0, 100.0));
+    }
+  }
+
+  void run(int n) override {
+    auto guard = scheduler_->get_main_guard();
+    for (int i = 0; i < n; i++) {
+      auto key = td::Random::fast(0, PENDING_TIMEOUT_COUNT - 1);
+      if (i % 2 == 0) {
+        multi_timeout_->cancel_timeout(key);
+      } else {
+        multi_timeout_->set_timeout_in(key, td::Random::fast(1.0, 100.0));
+      }
+    }
+  }
+
+  void tear_down() override {
+    {
+      auto guard = scheduler_->get_main_guard();
+      multi_timeout_.reset();
+    }
+    scheduler_->finish();
+    delete scheduler_;
+
+    SET_VERBOSITY_LEVEL(old_verbosity_level_);
+  }
+
+ private:
+  int old_verbosity_level_ = 0;
+  td::ConcurrentScheduler *scheduler_ = nullptr;
+  td::unique_ptr<td::MultiTimeout> multi_timeout_;
+};
+
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   td::init_openssl_threads();
 
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
-  bench(RingBench<4>(504, 0));
-  bench(RingBench<3>(504, 0));
-  bench(RingBench<0>(504, 0));
-  bench(RingBench<1>(504, 0));
-  bench(RingBench<2>(504, 0));
-  bench(QueryBench<5>());
-  bench(QueryBench<4>());
-  bench(QueryBench<2>());
-  bench(QueryBench<3>());
-  bench(QueryBench<1>());
-  bench(QueryBench<0>());
-  bench(RingBench<3>(504, 0));
-  bench(RingBench<0>(504, 10));
-  bench(RingBench<1>(504, 10));
-  bench(RingBench<2>(504, 10));
-  bench(RingBench<0>(504, 2));
-  bench(RingBench<1>(504, 2));
-  bench(RingBench<2>(504, 2));
+  runner.run(ClosureEventBench());
+  runner.run(LambdaPromiseBench());
+  runner.run(WakeupBench());
+  runner.run(RingBench<4>(504, 0));
+  runner.run(RingBench<3>(504, 0));
+  runner.run(RingBench<0>(504, 0));
+  runner.run(RingBench<1>(504, 0));
+  runner.run(RingBench<2>(504, 0));
+  runner.run(QueryBench<5>());
+  runner.run(QueryBench<4>());
+  runner.run(QueryBench<2>());
+  runner.run(QueryBench<3>());
+  runner.run(QueryBench<1>());
+  runner.run(QueryBench<0>());
+  runner.run(RingBench<3>(504, 0));
+  runner.run(RingBench<0>(504, 10));
+  runner.run(RingBench<1>(504, 10));
+  runner.run(RingBench<2>(504, 10));
+  runner.run(RingBench<0>(504, 2));
+  runner.run(RingBench<1>(504, 2));
+  runner.run(RingBench<2>(504, 2));
+  runner.run(TimeoutQueueBench<0>());
+  runner.run(TimeoutQueueBench<1>());
+  runner.run(MultiTimeoutBench());
+  return runner.finish();
 }
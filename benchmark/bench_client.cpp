@@ -0,0 +1,262 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/Client.h"
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/OptionParser.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/Slice.h"
+#include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
+
+#include <algorithm>
+#include <ctime>
+#include <unordered_map>
+
+// measures latency and throughput of requests to many TDLib instances sharing one ClientManager
+// all clients are fully initialized with their own databases, but use no network, so only local requests are sent
+
+namespace {
+
+struct ClientState {
+  td::ClientManager::ClientId client_id = 0;
+  td::string database_directory;
+  bool is_ready = false;
+  bool is_closed = false;
+  int sent_count = 0;
+  int received_count = 0;
+  bool markdown_option = false;
+};
+
+td::td_api::object_ptr<td::td_api::Function> get_request(ClientState &client) {
+  switch (client.sent_count % 5) {
+    case 0:
+      return td::td_api::make_object<td::td_api::testSquareInt>(client.sent_count);
+    case 1:
+      return td::td_api::make_object<td::td_api::testCallString>(td::string(1000, 'a'));
+    case 2:
+      return td::td_api::make_object<td::td_api::testCallVectorInt>(td::vector<td::int32>(100, client.sent_count));
+    case 3:
+      return td::td_api::make_object<td::td_api::getOption>("version");
+    case 4:
+      // changes an option stored in the database and generates updateOption
+      client.markdown_option = !client.markdown_option;
+      return td::td_api::make_object<td::td_api::setOption>(
+          "always_parse_markdown", td::td_api::make_object<td::td_api::optionValueBoolean>(client.markdown_option));
+    default:
+      UNREACHABLE();
+      return nullptr;
+  }
+}
+
+double get_cpu_time() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+td::uint64 get_resident_size() {
+  auto r_mem_stat = td::mem_stat();
+  if (r_mem_stat.is_error()) {
+    return 0;
+  }
+  return r_mem_stat.ok().resident_size_;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  int client_count = 10;
+  int request_count = 10000;
+  int in_flight_count = 10;
+  td::string directory = "bench_client_db";
+
+  td::OptionParser options;
+  options.set_description("End-to-end benchmark of TDLib clients");
+  options.add_checked_option('c', "clients", "Number of clients, 10 by default",
+                             td::OptionParser::parse_integer(client_count));
+  options.add_checked_option('n', "requests", "Number of requests sent by each client, 10000 by default",
+                             td::OptionParser::parse_integer(request_count));
+  options.add_checked_option('i', "in-flight", "Number of simultaneous requests of each client, 10 by default",
+                             td::OptionParser::parse_integer(in_flight_count));
+  options.add_option('d', "directory", "Directory for client databases, which is removed after the benchmark",
+                     [&](td::Slice arg) { directory = arg.str(); });
+  auto r_non_options = options.run(argc, argv, 0);
+  if (r_non_options.is_error() || client_count <= 0 || request_count <= 0 || in_flight_count <= 0) {
+    LOG(PLAIN) << argv[0] << ": " << (r_non_options.is_error() ? r_non_options.error().message() : "invalid arguments");
+    LOG(PLAIN) << options;
+    return 1;
+  }
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+  td::rmrf(directory).ignore();
+  td::mkdir(directory).ensure();
+
+  auto initial_resident_size = get_resident_size();
+
+  td::ClientManager client_manager;
+  td::vector<ClientState> clients(client_count);
+  std::unordered_map<td::ClientManager::ClientId, size_t> client_pos;
+  std::unordered_map<td::uint64, double> request_send_time;
+  td::uint64 current_request_id = 0;
+
+  auto send_request = [&](ClientState &client, td::td_api::object_ptr<td::td_api::Function> request) {
+    auto request_id = ++current_request_id;
+    request_send_time[request_id] = td::Time::now();
+    client_manager.send(client.client_id, request_id, std::move(request));
+  };
+
+  for (size_t i = 0; i < clients.size(); i++) {
+    auto &client = clients[i];
+    client.client_id = client_manager.create_client_id();
+    client.database_directory = PSTRING() << directory << TD_DIR_SLASH << i;
+    client_pos[client.client_id] = i;
+
+    auto parameters = td::td_api::make_object<td::td_api::tdlibParameters>();
+    parameters->use_test_dc_ = true;
+    parameters->database_directory_ = client.database_directory;
+    parameters->use_message_database_ = true;
+    parameters->api_id_ = 94575;
+    parameters->api_hash_ = "a3406de8d171bb422bb6ddf3bbd800e2";
+    parameters->system_language_code_ = "en";
+    parameters->device_model_ = "Desktop";
+    parameters->system_version_ = "Unknown";
+    parameters->application_version_ = "1.0";
+    send_request(client, td::td_api::make_object<td::td_api::setTdlibParameters>(std::move(parameters)));
+  }
+
+  auto on_authorization_state = [&](ClientState &client, const td::td_api::AuthorizationState &state) {
+    switch (state.get_id()) {
+      case td::td_api::authorizationStateWaitEncryptionKey::ID:
+        send_request(client, td::td_api::make_object<td::td_api::checkDatabaseEncryptionKey>());
+        send_request(client, td::td_api::make_object<td::td_api::setNetworkType>(
+                                 td::td_api::make_object<td::td_api::networkTypeNone>()));
+        break;
+      case td::td_api::authorizationStateWaitPhoneNumber::ID:
+        client.is_ready = true;
+        break;
+      case td::td_api::authorizationStateClosed::ID:
+        client.is_closed = true;
+        break;
+      default:
+        break;
+    }
+  };
+
+  // the benchmark is running while is_measuring is true
+  bool is_measuring = false;
+  td::vector<double> latencies;
+  latencies.reserve(static_cast<size_t>(client_count) * request_count);
+  td::uint64 update_count = 0;
+  size_t finished_client_count = 0;
+
+  auto process_response = [&](td::ClientManager::Response response) {
+    if (response.object == nullptr) {
+      return;
+    }
+    auto it = client_pos.find(response.client_id);
+    CHECK(it != client_pos.end());
+    auto &client = clients[it->second];
+    if (response.request_id == 0) {
+      if (is_measuring) {
+        update_count++;
+      }
+      if (response.object->get_id() == td::td_api::updateAuthorizationState::ID) {
+        auto &update = static_cast<const td::td_api::updateAuthorizationState &>(*response.object);
+        on_authorization_state(client, *update.authorization_state_);
+      }
+      return;
+    }
+
+    auto send_time_it = request_send_time.find(response.request_id);
+    CHECK(send_time_it != request_send_time.end());
+    auto latency = td::Time::now() - send_time_it->second;
+    request_send_time.erase(send_time_it);
+    if (response.object->get_id() == td::td_api::error::ID) {
+      LOG(ERROR) << "Receive error for request " << response.request_id << ": " << to_string(response.object);
+    }
+    if (!is_measuring) {
+      return;
+    }
+
+    latencies.push_back(latency);
+    client.received_count++;
+    if (client.sent_count < request_count) {
+      send_request(client, get_request(client));
+      client.sent_count++;
+    } else if (client.received_count == request_count) {
+      finished_client_count++;
+    }
+  };
+
+  auto all_clients = [&](auto predicate) {
+    return std::all_of(clients.begin(), clients.end(), predicate);
+  };
+
+  auto init_start_time = td::Time::now();
+  while (!all_clients([](const ClientState &client) { return client.is_ready; })) {
+    process_response(client_manager.receive(10.0));
+  }
+  while (!request_send_time.empty()) {
+    process_response(client_manager.receive(10.0));
+  }
+  LOG(PLAIN) << "Initialized " << client_count << " clients in " << td::format::as_time(td::Time::now() - init_start_time);
+
+  auto start_resident_size = get_resident_size();
+  auto start_cpu_time = get_cpu_time();
+  auto start_time = td::Time::now();
+  is_measuring = true;
+  for (auto &client : clients) {
+    for (int i = 0; i < in_flight_count && client.sent_count < request_count; i++) {
+      send_request(client, get_request(client));
+      client.sent_count++;
+    }
+  }
+  while (finished_client_count < clients.size()) {
+    process_response(client_manager.receive(10.0));
+  }
+  is_measuring = false;
+  auto total_time = td::Time::now() - start_time;
+  auto cpu_time = get_cpu_time() - start_cpu_time;
+  auto end_resident_size = get_resident_size();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto get_percentile = [&](size_t percent) {
+    auto pos = (latencies.size() * percent + 99) / 100;
+    return latencies[pos == 0 ? 0 : pos - 1];
+  };
+
+  LOG(PLAIN) << "Clients: " << client_count << ", requests per client: " << request_count
+             << ", simultaneous requests per client: " << in_flight_count;
+  LOG(PLAIN) << "Requests: " << latencies.size() << " in " << td::format::as_time(total_time) << ", "
+             << td::StringBuilder::FixedDouble(static_cast<double>(latencies.size()) / total_time, 1) << " per second";
+  LOG(PLAIN) << "Latency: p50 = " << td::format::as_time(get_percentile(50))
+             << ", p90 = " << td::format::as_time(get_percentile(90))
+             << ", p99 = " << td::format::as_time(get_percentile(99))
+             << ", max = " << td::format::as_time(get_percentile(100));
+  LOG(PLAIN) << "Updates: " << update_count << ", "
+             << td::StringBuilder::FixedDouble(static_cast<double>(update_count) / total_time, 1) << " per second";
+  LOG(PLAIN) << "CPU time per client: " << td::format::as_time(cpu_time / client_count) << ", "
+             << td::StringBuilder::FixedDouble(cpu_time / total_time * 100, 1) << "% of a core in total";
+  LOG(PLAIN) << "RSS per client: "
+             << td::format::as_size((start_resident_size - std::min(start_resident_size, initial_resident_size)) /
+                                    client_count)
+             << " after initialization, " << td::format::as_size(end_resident_size / client_count)
+             << " of total RSS after the benchmark";
+
+  for (auto &client : clients) {
+    send_request(client, td::td_api::make_object<td::td_api::close>());
+  }
+  while (!all_clients([](const ClientState &client) { return client.is_closed; })) {
+    process_response(client_manager.receive(10.0));
+  }
+  td::rmrf(directory).ignore();
+  return 0;
+}
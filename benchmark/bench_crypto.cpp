@@ -27,6 +27,7 @@
 
 static constexpr int DATA_SIZE = 8 << 10;
 static constexpr int SHORT_DATA_SIZE = 64;
+static constexpr int MULTIPLE_BUFFER_COUNT = 4;
 
 class SHA1Bench : public td::Benchmark {
  public:
@@ -286,6 +287,44 @@ class AesIgeShortBench : public td::Benchmark {
   }
 };
 
+template <bool encrypt>
+class AesIgeMultipleBench : public td::Benchmark {
+ public:
+  alignas(64) unsigned char data[MULTIPLE_BUFFER_COUNT][DATA_SIZE / MULTIPLE_BUFFER_COUNT];
+  td::UInt256 keys[MULTIPLE_BUFFER_COUNT];
+  td::UInt256 ivs[MULTIPLE_BUFFER_COUNT];
+
+  std::string get_description() const override {
+    return PSTRING() << "AES IGE " << (encrypt ? "encrypt" : "decrypt") << " multiple [" << MULTIPLE_BUFFER_COUNT << " x "
+                     << (DATA_SIZE / MULTIPLE_BUFFER_COUNT >> 10) << "KB]";
+  }
+
+  void start_up() override {
+    for (int i = 0; i < MULTIPLE_BUFFER_COUNT; i++) {
+      for (auto &c : data[i]) {
+        c = 123;
+      }
+      td::Random::secure_bytes(as_slice(keys[i]));
+      td::Random::secure_bytes(as_slice(ivs[i]));
+    }
+  }
+
+  void run(int n) override {
+    td::vector<td::AesIgeBuffer> buffers;
+    for (int i = 0; i < MULTIPLE_BUFFER_COUNT; i++) {
+      td::MutableSlice data_slice(data[i], sizeof(data[i]));
+      buffers.push_back(td::AesIgeBuffer{as_slice(keys[i]), as_slice(ivs[i]), data_slice, data_slice});
+    }
+    for (int i = 0; i < n; i++) {
+      if (encrypt) {
+        td::aes_ige_encrypt_multiple(buffers);
+      } else {
+        td::aes_ige_decrypt_multiple(buffers);
+      }
+    }
+  }
+};
+
 BENCH(Rand, "std_rand") {
   int res = 0;
   for (int i = 0; i < n; i++) {
@@ -407,29 +446,36 @@ class Crc64Bench : public td::Benchmark {
   }
 };
 
-int main() {
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   td::init_openssl_threads();
-  td::bench(AesCtrBench());
-  td::bench(AesCtrOpenSSLBench());
-
-  td::bench(AesCbcDecryptBench());
-  td::bench(AesCbcEncryptBench());
-  td::bench(AesIgeShortBench<true>());
-  td::bench(AesIgeShortBench<false>());
-  td::bench(AesIgeEncryptBench());
-  td::bench(AesIgeDecryptBench());
-  td::bench(AesEcbBench());
-
-  td::bench(Pbkdf2Bench());
-  td::bench(RandBench());
-  td::bench(CppRandBench());
-  td::bench(TdRand32Bench());
-  td::bench(TdRandFastBench());
+  runner.run(AesCtrBench());
+  runner.run(AesCtrOpenSSLBench());
+
+  runner.run(AesCbcDecryptBench());
+  runner.run(AesCbcEncryptBench());
+  runner.run(AesIgeShortBench<true>());
+  runner.run(AesIgeShortBench<false>());
+  runner.run(AesIgeEncryptBench());
+  runner.run(AesIgeDecryptBench());
+  runner.run(AesIgeMultipleBench<true>());
+  runner.run(AesIgeMultipleBench<false>());
+  runner.run(AesEcbBench());
+
+  runner.run(Pbkdf2Bench());
+  runner.run(RandBench());
+  runner.run(CppRandBench());
+  runner.run(TdRand32Bench());
+  runner.run(TdRandFastBench());
 #if !TD_THREAD_UNSUPPORTED
-  td::bench(SslRandBench());
+  runner.run(SslRandBench());
 #endif
-  td::bench(SslRandBufBench());
-  td::bench(SHA1Bench());
-  td::bench(Crc32Bench());
-  td::bench(Crc64Bench());
+  runner.run(SslRandBufBench());
+  runner.run(SHA1Bench());
+  runner.run(Crc32Bench());
+  runner.run(Crc64Bench());
+  return runner.finish();
 }
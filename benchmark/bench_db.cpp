@@ -228,14 +228,19 @@ class BinlogKeyValueBench : public td::Benchmark {
   }
 };
 
-int main() {
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
-  bench(BinlogKeyValueBench<true>());
-  bench(BinlogKeyValueBench<false>());
-  bench(SqliteKVBench<false>());
-  bench(SqliteKVBench<true>());
-  bench(SqliteKeyValueAsyncBench());
-  bench(TdKvBench<td::BinlogKeyValue<td::Binlog>>("BinlogKeyValue<Binlog>"));
-  bench(TdKvBench<td::BinlogKeyValue<td::ConcurrentBinlog>>("BinlogKeyValue<ConcurrentBinlog>"));
-  bench(SeqKvBench());
+  runner.run(BinlogKeyValueBench<true>());
+  runner.run(BinlogKeyValueBench<false>());
+  runner.run(SqliteKVBench<false>());
+  runner.run(SqliteKVBench<true>());
+  runner.run(SqliteKeyValueAsyncBench());
+  runner.run(TdKvBench<td::BinlogKeyValue<td::Binlog>>("BinlogKeyValue<Binlog>"));
+  runner.run(TdKvBench<td::BinlogKeyValue<td::ConcurrentBinlog>>("BinlogKeyValue<ConcurrentBinlog>"));
+  runner.run(SeqKvBench());
+  return runner.finish();
 }
@@ -71,7 +71,12 @@ class HandshakeBench : public Benchmark {
 };
 }  // namespace td
 
-int main() {
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
-  td::bench(td::HandshakeBench());
+  runner.run(td::HandshakeBench());
+  return runner.finish();
 }
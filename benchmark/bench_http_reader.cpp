@@ -13,6 +13,8 @@
 #include "td/utils/find_boundary.h"
 #include "td/utils/logging.h"
 
+#include <limits>
+
 static std::string http_query = "GET / HTTP/1.1\r\nConnection:keep-alive\r\nhost:127.0.0.1:8080\r\n\r\n";
 static const size_t block_size = 2500;
 
@@ -47,11 +49,71 @@ class HttpReaderBench : public td::Benchmark {
   td::HttpReader http_reader_;
 
   void start_up() override {
+    writer_ = td::ChainBufferWriter();
     reader_ = writer_.extract_reader();
     http_reader_.init(&reader_, 10000, 0);
   }
 };
 
+class HttpReaderPostBench : public td::Benchmark {
+ public:
+  explicit HttpReaderPostBench(bool is_chunked) : is_chunked_(is_chunked) {
+  }
+
+ private:
+  bool is_chunked_;
+  std::string query_;
+
+  std::string get_description() const override {
+    return PSTRING() << "HttpReaderPostBench" << (is_chunked_ ? "Chunked" : "ContentLength");
+  }
+
+  void run(int n) override {
+    td::HttpQuery q;
+    int parsed = 0;
+    for (int i = 0; i < n; i++) {
+      writer_.append(query_);
+      reader_.sync_with_writer();
+      while (true) {
+        auto wait = http_reader_.read_next(&q).ok();
+        if (wait != 0) {
+          break;
+        }
+        CHECK(q.content_.size() == content_size);
+        parsed++;
+      }
+    }
+    CHECK(parsed == n);
+  }
+  td::ChainBufferWriter writer_;
+  td::ChainBufferReader reader_;
+  td::HttpReader http_reader_;
+
+  static constexpr size_t content_size = 1 << 15;
+  static constexpr size_t chunk_size = 1 << 12;
+
+  void start_up() override {
+    std::string content(content_size, 'a');
+    query_ = "POST / HTTP/1.1\r\nConnection:keep-alive\r\nhost:127.0.0.1:8080\r\n";
+    if (is_chunked_) {
+      query_ += "Transfer-Encoding:chunked\r\n\r\n";
+      for (size_t i = 0; i < content_size; i += chunk_size) {
+        query_ += "1000\r\n";  // chunk_size in hex
+        query_ += content.substr(i, chunk_size);
+        query_ += "\r\n";
+      }
+      query_ += "0\r\n\r\n";
+    } else {
+      query_ += PSTRING() << "Content-Length:" << content_size << "\r\n\r\n";
+      query_ += content;
+    }
+
+    writer_ = td::ChainBufferWriter();
+    reader_ = writer_.extract_reader();
+    http_reader_.init(&reader_, std::numeric_limits<size_t>::max(), 0);
+  }
+};
+
 class BufferBench : public td::Benchmark {
   std::string get_description() const override {
     return "BufferBench";
@@ -74,6 +136,7 @@ class BufferBench : public td::Benchmark {
   td::HttpReader http_reader_;
 
   void start_up() override {
+    writer_ = td::ChainBufferWriter();
     reader_ = writer_.extract_reader();
   }
 };
@@ -104,13 +167,21 @@ class FindBoundaryBench : public td::Benchmark {
   td::HttpReader http_reader_;
 
   void start_up() override {
+    writer_ = td::ChainBufferWriter();
     reader_ = writer_.extract_reader();
   }
 };
 
-int main() {
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
-  td::bench(BufferBench());
-  td::bench(FindBoundaryBench());
-  td::bench(HttpReaderBench());
+  runner.run(BufferBench());
+  runner.run(FindBoundaryBench());
+  runner.run(HttpReaderBench());
+  runner.run(HttpReaderPostBench(false));
+  runner.run(HttpReaderPostBench(true));
+  return runner.finish();
 }
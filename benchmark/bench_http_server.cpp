@@ -9,16 +9,19 @@
 #include "td/net/HttpHeaderCreator.h"
 #include "td/net/HttpInboundConnection.h"
 #include "td/net/HttpQuery.h"
-#include "td/net/TcpListener.h"
+#include "td/net/HttpServer.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
-#include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
 
+#include <atomic>
+#include <memory>
+
 namespace td {
 
-static int cnt = 0;
+static std::atomic<int> cnt{0};
 
 class HelloWorld : public HttpInboundConnection::Callback {
  public:
@@ -46,36 +49,26 @@ class HelloWorld : public HttpInboundConnection::Callback {
 };
 
 const int N = 0;
-class Server : public TcpListener::Callback {
+
+class HelloWorldFactory : public HttpServer::Callback {
  public:
-  void start_up() override {
-    listener_ = create_actor<TcpListener>("Listener", 8082, ActorOwn<TcpListener::Callback>(actor_id(this)));
-  }
-  void accept(SocketFd fd) override {
+  ActorOwn<HttpInboundConnection::Callback> create_query_handler() override {
     LOG(ERROR) << "ACCEPT " << cnt++;
-    pos_++;
-    auto scheduler_id = pos_ % (N != 0 ? N : 1) + (N != 0);
-    create_actor_on_scheduler<HttpInboundConnection>("HttpInboundConnection", scheduler_id, std::move(fd), 1024 * 1024,
-                                                     0, 0,
-                                                     create_actor_on_scheduler<HelloWorld>("HelloWorld", scheduler_id))
-        .release();
-  }
-  void hangup() override {
-    // may be it should be default?..
-    LOG(ERROR) << "Hanging up..";
-    stop();
+    return ActorOwn<HttpInboundConnection::Callback>(create_actor<HelloWorld>("HelloWorld"));
   }
-
- private:
-  ActorOwn<TcpListener> listener_;
-  int pos_{0};
 };
 
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
   auto scheduler = make_unique<ConcurrentScheduler>();
   scheduler->init(N);
-  scheduler->create_actor_unsafe<Server>(0, "Server").release();
+  vector<int32> scheduler_ids;
+  for (int32 i = 0; i <= N; i++) {
+    scheduler_ids.push_back(i);
+  }
+  scheduler->create_actor_unsafe<HttpServer>(0, "HttpServer", 8082, std::move(scheduler_ids),
+                                             std::make_shared<HelloWorldFactory>(), 1024 * 1024, 0, 0)
+      .release();
   scheduler->start();
   while (scheduler->run_main(10)) {
     // empty
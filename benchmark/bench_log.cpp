@@ -153,11 +153,16 @@ class LogWriteBench : public td::Benchmark {
 
 std::mutex mutex;
 
-int main() {
-  td::bench(LogWriteBench());
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
+  runner.run(LogWriteBench());
 #if TD_ANDROID
-  td::bench(ALogWriteBench());
+  runner.run(ALogWriteBench());
 #endif
-  td::bench(IostreamWriteBench());
-  td::bench(FILEWriteBench());
+  runner.run(IostreamWriteBench());
+  runner.run(FILEWriteBench());
+  return runner.finish();
 }
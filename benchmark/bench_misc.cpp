@@ -5,7 +5,12 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/utils/benchmark.h"
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/Hints.h"
+#include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/EventFd.h"
@@ -14,10 +19,25 @@
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/port/UdpSocketFd.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SortedChunkMap.h"
+#include "td/utils/Span.h"
+#include "td/utils/Time.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/utf8.h"
 
+#include "td/telegram/Global.h"
+#include "td/telegram/logevent/LogEvent.h"
+#include "td/telegram/MessageContent.h"
+#include "td/telegram/MessageEntity.h"
+#include "td/telegram/net/NetQueryCreator.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/telegram_api.hpp"
+#include "td/telegram/WebPageId.h"
+
+#include "td/actor/actor.h"
 
 #if !TD_WINDOWS
 #include <unistd.h>
@@ -28,8 +48,11 @@
 #include <semaphore.h>
 #endif
 
+#include <array>
 #include <atomic>
 #include <cstdint>
+#include <map>
+#include <unordered_map>
 
 namespace td {
 
@@ -117,6 +140,38 @@ BENCH(Time, "Clocks::monotonic") {
   do_not_optimize_away(res);
 }
 */
+
+class TimeNowBench : public Benchmark {
+ public:
+  explicit TimeNowBench(bool use_coarse) : use_coarse_(use_coarse) {
+  }
+
+  string get_description() const override {
+    return use_coarse_ ? "Time::now_coarse" : "Time::now";
+  }
+
+  void start_up() override {
+    if (use_coarse_) {
+      Time::update_coarse();
+    }
+  }
+
+  void tear_down() override {
+    Time::reset_coarse();
+  }
+
+  void run(int n) override {
+    double res = 0;
+    for (int i = 0; i < n; i++) {
+      res += use_coarse_ ? Time::now_coarse() : Time::now();
+    }
+    do_not_optimize_away(res);
+  }
+
+ private:
+  bool use_coarse_;
+};
+
 #if !TD_WINDOWS
 class PipeBench : public Benchmark {
  public:
@@ -151,6 +206,83 @@ class PipeBench : public Benchmark {
 };
 #endif
 
+#if TD_PORT_POSIX
+template <bool use_batch>
+class UdpReceiveBench : public Benchmark {
+  static constexpr size_t BATCH_SIZE = 16;
+  static constexpr size_t PACKET_SIZE = 200;
+
+  UdpSocketFd sender_;
+  UdpSocketFd receiver_;
+  IPAddress receiver_address_;
+  string packet_;
+  std::array<std::array<char, 2048>, BATCH_SIZE> buffers_;
+  std::array<IPAddress, BATCH_SIZE> from_;
+  std::array<Status, BATCH_SIZE> errors_;
+
+ public:
+  string get_description() const override {
+    return PSTRING() << "UDP receive over loopback " << (use_batch ? "with recvmmsg" : "with recvmsg");
+  }
+
+  void start_up() override {
+    receiver_address_.init_ipv4_port("127.0.0.1", use_batch ? 32457 : 32458).ensure();
+    receiver_ = UdpSocketFd::open(receiver_address_).move_as_ok();
+    receiver_.maximize_rcv_buffer().ignore();
+    IPAddress sender_address;
+    sender_address.init_ipv4_port("127.0.0.1", use_batch ? 32459 : 32460).ensure();
+    sender_ = UdpSocketFd::open(sender_address).move_as_ok();
+    sender_.maximize_snd_buffer().ignore();
+    packet_ = string(PACKET_SIZE, 'a');
+  }
+
+  void run(int n) override {
+    std::array<UdpSocketFd::OutboundMessage, BATCH_SIZE> outbound;
+    for (auto &message : outbound) {
+      message.to = &receiver_address_;
+      message.data = packet_;
+    }
+    std::array<UdpSocketFd::InboundMessage, BATCH_SIZE> inbound;
+
+    size_t total_received = 0;
+    for (int i = 0; i < n; i += static_cast<int>(BATCH_SIZE)) {
+      size_t sent = 0;
+      while (sent < BATCH_SIZE) {
+        size_t cnt = 0;
+        sender_.send_messages(Span<UdpSocketFd::OutboundMessage>(outbound).substr(sent), cnt).ensure();
+        sent += cnt;
+      }
+
+      size_t received = 0;
+      while (received < BATCH_SIZE) {
+        for (size_t j = 0; j < BATCH_SIZE; j++) {
+          inbound[j].from = &from_[j];
+          inbound[j].data = MutableSlice(buffers_[j].data(), buffers_[j].size());
+          inbound[j].error = &errors_[j];
+        }
+        receiver_.get_poll_info().add_flags(PollFlags::Read());
+        if (use_batch) {
+          size_t cnt = 0;
+          receiver_.receive_messages(MutableSpan<UdpSocketFd::InboundMessage>(inbound), cnt).ensure();
+          received += cnt;
+        } else {
+          bool is_received = false;
+          receiver_.receive_message(inbound[0], is_received).ensure();
+          received += is_received;
+        }
+      }
+      total_received += received;
+    }
+    do_not_optimize_away(total_received);
+  }
+
+  void tear_down() override {
+    sender_.close();
+    receiver_.close();
+  }
+};
+#endif
+
 #if TD_LINUX || TD_ANDROID || TD_TIZEN
 class SemBench : public Benchmark {
   sem_t sem;
@@ -355,40 +487,591 @@ class RwMutexWriteBench : public Benchmark {
   }
 };
 #endif
+
+// emulates message index of a dialog with 100000 loaded messages: point lookups, history pages and new messages
+template <bool UseChunkMap>
+class MessageIndexBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return PSTRING() << "MessageIndex " << (UseChunkMap ? "SortedChunkMap" : "std::map")
+                     << " lookup + history page of " << PAGE_SIZE << " + insert/erase";
+  }
+
+  void start_up() override {
+    chunk_map_.clear();
+    map_.clear();
+    message_ids_.clear();
+    for (int64 i = 1; i <= MESSAGE_COUNT; i++) {
+      message_ids_.push_back(i << 20);
+    }
+    // add messages in random order to scatter them over the heap as messages loaded from different sources
+    for (size_t i = 1; i < message_ids_.size(); i++) {
+      std::swap(message_ids_[i], message_ids_[Random::fast(0, static_cast<int>(i))]);
+    }
+    for (auto message_id : message_ids_) {
+      add_message(message_id);
+    }
+  }
+
+  void run(int n) override {
+    int64 sum = 0;
+    for (int i = 0; i < n; i++) {
+      auto message_id = message_ids_[Random::fast(0, MESSAGE_COUNT - 1)];
+      if (UseChunkMap) {
+        sum += (*chunk_map_.get(message_id))->date;
+        auto it = chunk_map_.upper_bound(message_id);
+        for (int j = 0; j < PAGE_SIZE && --it != chunk_map_.end(); j++) {
+          sum += it.value()->date;
+        }
+      } else {
+        sum += map_.find(message_id)->second->date;
+        auto it = map_.upper_bound(message_id);
+        for (int j = 0; j < PAGE_SIZE && it != map_.begin(); j++) {
+          --it;
+          sum += it->second->date;
+        }
+      }
+
+      auto new_message_id = message_id + 1;
+      add_message(new_message_id);
+      if (UseChunkMap) {
+        chunk_map_.erase(new_message_id);
+      } else {
+        map_.erase(new_message_id);
+      }
+    }
+    do_not_optimize_away(sum);
+  }
+
+ private:
+  static constexpr int MESSAGE_COUNT = 100000;
+  static constexpr int PAGE_SIZE = 100;
+
+  struct Message {
+    int32 date = 0;
+    char data[200];
+  };
+
+  SortedChunkMap<int64, unique_ptr<Message>> chunk_map_;
+  std::map<int64, unique_ptr<Message>> map_;
+  vector<int64> message_ids_;
+
+  void add_message(int64 message_id) {
+    auto message = make_unique<Message>();
+    message->date = static_cast<int32>(message_id >> 20);
+    if (UseChunkMap) {
+      chunk_map_.insert(message_id, std::move(message));
+    } else {
+      map_.emplace(message_id, std::move(message));
+    }
+  }
+};
+
+// emulates lookups of users by identifier in a registry with 1000000 known users
+template <bool UseFlatHashMap>
+class IdRegistryBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return PSTRING() << "IdRegistry " << (UseFlatHashMap ? "FlatHashMap" : "std::unordered_map") << " lookup";
+  }
+
+  void start_up() override {
+    flat_map_.clear();
+    map_.clear();
+    user_ids_.clear();
+    for (int32 i = 0; i < USER_COUNT; i++) {
+      auto user_id = Random::fast(1, 2000000000);
+      user_ids_.push_back(user_id);
+      if (UseFlatHashMap) {
+        flat_map_[user_id] = user_id;
+      } else {
+        map_[user_id] = user_id;
+      }
+    }
+  }
+
+  void run(int n) override {
+    int64 sum = 0;
+    for (int i = 0; i < n; i++) {
+      auto user_id = user_ids_[Random::fast(0, USER_COUNT - 1)];
+      if (UseFlatHashMap) {
+        sum += flat_map_.find(user_id)->second;
+      } else {
+        sum += map_.find(user_id)->second;
+      }
+    }
+    do_not_optimize_away(sum);
+  }
+
+ private:
+  static constexpr int32 USER_COUNT = 1000000;
+
+  FlatHashMap<int32, int32> flat_map_;
+  std::unordered_map<int32, int32> map_;
+  vector<int32> user_ids_;
+};
+
+class Utf8Bench : public Benchmark {
+ public:
+  Utf8Bench(bool is_ascii, int function) : is_ascii_(is_ascii), function_(function) {
+  }
+
+  string get_description() const override {
+    static const char *names[] = {"check_utf8", "utf8_length", "utf8_utf16_length", "utf8_truncate"};
+    return PSTRING() << names[function_] << " on " << (is_ascii_ ? "English" : "multilingual") << " texts";
+  }
+
+  void start_up() override {
+    static const char *ascii_phrases[] = {"Hello, how are you? ", "See you tomorrow at 10:00. ",
+                                          "https://telegram.org ", "Thanks! "};
+    static const char *phrases[] = {"Hello, how are you? ", "Привет, как дела? ", "你好，你怎么样？ ",
+                                    "مرحبا، كيف حالك؟ ", "👍😂🎉 ", "Grüße aus München! "};
+    texts_.clear();
+    for (int i = 0; i < 1000; i++) {
+      string text;
+      auto length = Random::fast(10, 500);
+      while (static_cast<int>(text.size()) < length) {
+        text += is_ascii_ ? ascii_phrases[Random::fast(0, 3)] : phrases[Random::fast(0, 5)];
+      }
+      texts_.push_back(std::move(text));
+    }
+  }
+
+  void run(int n) override {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      for (auto &text : texts_) {
+        switch (function_) {
+          case 0:
+            result += check_utf8(text);
+            break;
+          case 1:
+            result += utf8_length(text);
+            break;
+          case 2:
+            result += utf8_utf16_length(text);
+            break;
+          case 3:
+            result += utf8_truncate(Slice(text), 100).size();
+            break;
+        }
+      }
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  bool is_ascii_;
+  int function_;
+  vector<string> texts_;
+};
+
+class JsonUpdateNewMessageBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return "JSON serialization of updateNewMessage";
+  }
+
+  void start_up() override {
+    static const char *phrases[] = {"Hello, how are you? ", "See you tomorrow at 10:00.\n", "Привет, как дела? ",
+                                    "\"Quoted\" text ",      "https://telegram.org ",         "👍😂🎉 "};
+    texts_.clear();
+    for (int i = 0; i < 1000; i++) {
+      string text;
+      auto length = Random::fast(10, 1000);
+      while (static_cast<int>(text.size()) < length) {
+        text += phrases[Random::fast(0, 5)];
+      }
+      texts_.push_back(std::move(text));
+    }
+    buffer_ = string(1 << 16, '\0');
+  }
+
+  void run(int n) override {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      for (auto &text : texts_) {
+        JsonBuilder jb(StringBuilder(buffer_, true), -1);
+        jb.enter_value() << json_object([&text](auto &update) {
+          update("@type", "updateNewMessage");
+          update("message", json_object([&text](auto &message) {
+                   message("@type", "message");
+                   message("id", 1048576);
+                   message("sender_user_id", 123456789);
+                   message("chat_id", JsonLong(-1001234567890));
+                   message("is_outgoing", JsonFalse());
+                   message("date", 1600000000);
+                   message("content", json_object([&text](auto &content) {
+                             content("@type", "messageText");
+                             content("text", json_object([&text](auto &formatted_text) {
+                                       formatted_text("@type", "formattedText");
+                                       formatted_text("text", text);
+                                       formatted_text("entities", JsonRaw("[]"));
+                                     }));
+                           }));
+                 }));
+        });
+        result += jb.string_builder().as_cslice().size();
+      }
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  vector<string> texts_;
+  string buffer_;
+};
+
+class FindEntitiesBench : public Benchmark {
+ public:
+  explicit FindEntitiesBench(bool has_entities) : has_entities_(has_entities) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "find_entities in long texts " << (has_entities_ ? "with" : "without") << " entities";
+  }
+
+  void start_up() override {
+    static const char *phrases[] = {"Hello, how are you? ", "See you tomorrow at 10 ", "Привет, как дела? ",
+                                    "\"Quoted\" text\n", "@username ", "#hashtag ", "https://telegram.org "};
+    texts_.clear();
+    for (int i = 0; i < 100; i++) {
+      string text;
+      auto length = Random::fast(1000, 4000);
+      while (static_cast<int>(text.size()) < length) {
+        text += phrases[Random::fast(0, has_entities_ ? 6 : 3)];
+      }
+      texts_.push_back(std::move(text));
+    }
+  }
+
+  void run(int n) override {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      for (auto &text : texts_) {
+        result += find_entities(text, false, false).size();
+      }
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  bool has_entities_;
+  vector<string> texts_;
+};
+
+class ParseMarkupBench : public Benchmark {
+ public:
+  explicit ParseMarkupBench(bool is_html) : is_html_(is_html) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Parse " << (is_html_ ? "HTML" : "MarkdownV2") << " bot messages";
+  }
+
+  void start_up() override {
+    static const char *html_templates[] = {
+        "Your order is confirmed, thank you",
+        "<b>Order confirmed</b>\nTotal: <i>42 USD</i>\n<a href=\"https://t.me\">Track</a>",
+        "Price: 5 &lt; 10 &amp; <code>in stock</code>"};
+    static const char *markdown_templates[] = {"Your order is confirmed, thank you",
+                                               "*Order confirmed*\nTotal: _42 USD_\n[Track](https://t.me)",
+                                               "Price: 5 \\< 10 \\& `in stock`"};
+    texts_.clear();
+    for (int i = 0; i < 1000; i++) {
+      auto id = Random::fast(0, 2);
+      texts_.push_back(is_html_ ? html_templates[id] : markdown_templates[id]);
+    }
+  }
+
+  void run(int n) override {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      for (auto &text : texts_) {
+        auto parsed_text = text;
+        auto r_entities = is_html_ ? parse_html(parsed_text) : parse_markdown_v2(parsed_text);
+        result += r_entities.ok().size() + parsed_text.size();
+      }
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  bool is_html_;
+  vector<string> texts_;
+};
+
+class HintsSearchBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return "Hints search in 100000 chat titles";
+  }
+
+  void start_up() override {
+    static const char *first_names[] = {"Alexander", "Anna",  "Maria", "Ivan",  "John",  "Emma",  "Mohammed",
+                                        "Александр", "Мария", "Иван",  "Елена", "Sofia", "Lucas", "Olga"};
+    static const char *last_names[] = {"Smith", "Ivanov", "Garcia", "Müller", "Иванов",   "Петрова",
+                                       "Kim",   "Nguyen", "Rossi",  "Silva",  "Kowalski", "Смирнов"};
+    hints_ = Hints();
+    for (int i = 1; i <= 100000; i++) {
+      string name = PSTRING() << first_names[Random::fast(0, 13)] << ' ' << last_names[Random::fast(0, 11)];
+      if (Random::fast(0, 3) == 0) {
+        name += ' ';
+        name += to_string(Random::fast(1, 1000));
+      }
+      hints_.add(i, name);
+      hints_.set_rating(i, -Random::fast(0, 1000000));
+    }
+  }
+
+  void run(int n) override {
+    static const char *queries[] = {"a", "i", "м", "al", "ив", "john s", "maria ivanova", "sm", "ko", "x"};
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      result += hints_.search(Slice(queries[i % 10]), 50).first;
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  Hints hints_;
+};
+
+// message contents are the biggest part of stored messages and dialog last messages
+class LogEventStoreBench : public Benchmark {
+ public:
+  LogEventStoreBench(size_t text_size, bool is_single_pass) : text_size_(text_size), is_single_pass_(is_single_pass) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Store message content with " << text_size_ << " bytes of text "
+                     << (is_single_pass_ ? "in a single pass" : "with length precalculation");
+  }
+
+  void start_up() override {
+    global_ = std::make_shared<Global>();
+    old_context_ = Scheduler::context();
+    Scheduler::context() = global_.get();
+
+    string text;
+    vector<MessageEntity> entities;
+    for (int i = 0; text.size() < text_size_; i++) {
+      string word = PSTRING() << "word" << i << ' ';
+      if (i % 10 == 0) {
+        entities.emplace_back(MessageEntity::Type::Bold, narrow_cast<int32>(text.size()),
+                              narrow_cast<int32>(word.size() - 1));
+      }
+      text += word;
+    }
+    content_ = create_text_message_content(std::move(text), std::move(entities), WebPageId());
+  }
+
+  void run(int n) override {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      total_size += (is_single_pass_ ? store_in_single_pass() : store_with_length_precalculation()).size();
+    }
+    do_not_optimize_away(total_size);
+  }
+
+  void tear_down() override {
+    content_ = nullptr;
+    Scheduler::context() = old_context_;
+    global_ = nullptr;
+  }
+
+ private:
+  size_t text_size_;
+  bool is_single_pass_;
+  std::shared_ptr<Global> global_;
+  ActorContext *old_context_ = nullptr;
+  unique_ptr<MessageContent> content_;
+
+  BufferSlice store_in_single_pass() const {
+    log_event::LogEventStoreBuffer buffer;
+    LogEventStorerGrowable storer(buffer.get());
+    store_message_content(content_.get(), storer);
+    return BufferSlice(storer.as_slice());
+  }
+
+  BufferSlice store_with_length_precalculation() const {
+    LogEventStorerCalcLength storer_calc_length;
+    store_message_content(content_.get(), storer_calc_length);
+
+    BufferSlice value_buffer{storer_calc_length.get_length()};
+    LogEventStorerUnsafe storer_unsafe(value_buffer.as_slice().ubegin());
+    store_message_content(content_.get(), storer_unsafe);
+    return value_buffer;
+  }
+};
+
+class TlFetchVectorBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return PSTRING() << "Fetch updateDeleteMessages with " << message_count_ << " messages";
+  }
+
+  void start_up() override {
+    vector<int32> data{telegram_api::updateDeleteMessages::ID, VECTOR_ID, message_count_};
+    for (int32 i = 1; i <= message_count_; i++) {
+      data.push_back(i);
+    }
+    data.push_back(1);
+    data.push_back(message_count_);
+    buffer_ = BufferSlice(Slice(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(int32)));
+  }
+
+  void run(int n) override {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      TlBufferParser parser(&buffer_);
+      auto update = telegram_api::Update::fetch(parser);
+      parser.fetch_end();
+      CHECK(parser.get_error() == nullptr);
+      total_size += static_cast<const telegram_api::updateDeleteMessages *>(update.get())->messages_.size();
+    }
+    do_not_optimize_away(total_size);
+  }
+
+ private:
+  static constexpr int32 VECTOR_ID = 0x1cb5c415;
+  const int32 message_count_ = 1000;
+
+  BufferSlice buffer_;
+};
+
+#if TD_HAVE_ZLIB
+class QueryCompressionBench : public Benchmark {
+ public:
+  QueryCompressionBench(bool is_compressible, bool use_estimate)
+      : is_compressible_(is_compressible), use_estimate_(use_estimate) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Compress " << (is_compressible_ ? "compressible" : "incompressible") << " queries "
+                     << (use_estimate_ ? "with entropy estimate" : "with sampled gzencode");
+  }
+
+  void start_up() override {
+    queries_.clear();
+    for (size_t size = 128; size <= (1 << 20); size *= 2) {
+      string query(size, '\0');
+      for (auto &c : query) {
+        c = static_cast<char>(is_compressible_ ? Random::fast('a', 'h') : Random::fast(0, 255));
+      }
+      queries_.push_back(std::move(query));
+    }
+  }
+
+  void run(int n) override {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      for (auto &query : queries_) {
+        BufferSlice slice(query);
+        if (use_estimate_) {
+          NetQueryCreator::compress_query(slice);
+        } else {
+          compress_with_sample(slice);
+        }
+        total_size += slice.size();
+      }
+    }
+    do_not_optimize_away(total_size);
+  }
+
+ private:
+  bool is_compressible_;
+  bool use_estimate_;
+  vector<string> queries_;
+
+  // the previous algorithm, which compresses a sample part of big queries before compressing the whole query
+  static void compress_with_sample(BufferSlice &slice) {
+    if (slice.size() < 128) {
+      return;
+    }
+    if (slice.size() >= 16384) {
+      size_t TESTED_SIZE = 1024;
+      if (gzencode(slice.as_slice().substr((slice.size() - TESTED_SIZE) / 2, TESTED_SIZE), 0.9).empty()) {
+        return;
+      }
+    }
+    BufferSlice compressed = gzencode(slice.as_slice(), 0.9);
+    if (!compressed.empty()) {
+      slice = std::move(compressed);
+    }
+  }
+};
+#endif
 }  // namespace td
 
-int main() {
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
 #if !TD_THREAD_UNSUPPORTED
-  td::bench(td::AtomicReleaseIncBench<1>());
-  td::bench(td::AtomicReleaseIncBench<2>());
-  td::bench(td::AtomicReleaseCasIncBench<1>());
-  td::bench(td::AtomicReleaseCasIncBench<2>());
-  td::bench(td::RwMutexWriteBench<1>());
-  td::bench(td::RwMutexReadBench<1>());
-  td::bench(td::RwMutexWriteBench<>());
-  td::bench(td::RwMutexReadBench<>());
+  runner.run(td::AtomicReleaseIncBench<1>());
+  runner.run(td::AtomicReleaseIncBench<2>());
+  runner.run(td::AtomicReleaseCasIncBench<1>());
+  runner.run(td::AtomicReleaseCasIncBench<2>());
+  runner.run(td::RwMutexWriteBench<1>());
+  runner.run(td::RwMutexReadBench<1>());
+  runner.run(td::RwMutexWriteBench<>());
+  runner.run(td::RwMutexReadBench<>());
 #endif
 #if !TD_WINDOWS
-  td::bench(td::UtimeBench());
+  runner.run(td::UtimeBench());
 #endif
-  td::bench(td::WalkPathBench());
-  td::bench(td::CreateFileBench());
-  td::bench(td::PwriteBench());
+  runner.run(td::WalkPathBench());
+  runner.run(td::CreateFileBench());
+  runner.run(td::PwriteBench());
 
-  td::bench(td::CallBench());
+  runner.run(td::CallBench());
+  runner.run(td::TimeNowBench(false));
+  runner.run(td::TimeNowBench(true));
 #if !TD_THREAD_UNSUPPORTED
-  td::bench(td::ThreadNewBench());
+  runner.run(td::ThreadNewBench());
 #endif
 #if !TD_EVENTFD_UNSUPPORTED
-  td::bench(td::EventFdBench());
+  runner.run(td::EventFdBench());
 #endif
-  td::bench(td::NewObjBench());
-  td::bench(td::NewIntBench());
+  runner.run(td::NewObjBench());
+  runner.run(td::NewIntBench());
 #if !TD_WINDOWS
-  td::bench(td::PipeBench());
+  runner.run(td::PipeBench());
+#endif
+#if TD_PORT_POSIX
+  runner.run(td::UdpReceiveBench<false>());
+  runner.run(td::UdpReceiveBench<true>());
 #endif
 #if TD_LINUX || TD_ANDROID || TD_TIZEN
-  td::bench(td::SemBench());
+  runner.run(td::SemBench());
+#endif
+  runner.run(td::MessageIndexBench<false>());
+  runner.run(td::MessageIndexBench<true>());
+  runner.run(td::IdRegistryBench<false>());
+  runner.run(td::IdRegistryBench<true>());
+  runner.run(td::JsonUpdateNewMessageBench());
+  runner.run(td::FindEntitiesBench(false));
+  runner.run(td::FindEntitiesBench(true));
+  runner.run(td::ParseMarkupBench(true));
+  runner.run(td::ParseMarkupBench(false));
+  runner.run(td::HintsSearchBench());
+  runner.run(td::TlFetchVectorBench());
+  for (size_t text_size : {100, 4000}) {
+    runner.run(td::LogEventStoreBench(text_size, false));
+    runner.run(td::LogEventStoreBench(text_size, true));
+  }
+  for (int function = 0; function < 4; function++) {
+    runner.run(td::Utf8Bench(true, function));
+    runner.run(td::Utf8Bench(false, function));
+  }
+#if TD_HAVE_ZLIB
+  for (auto is_compressible : {true, false}) {
+    runner.run(td::QueryCompressionBench(is_compressible, false));
+    runner.run(td::QueryCompressionBench(is_compressible, true));
+  }
 #endif
+  return runner.finish();
 }
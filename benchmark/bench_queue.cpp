@@ -7,6 +7,7 @@
 #include "td/utils/benchmark.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/MpscLinkPollableQueue.h"
 #include "td/utils/MpscPollableQueue.h"
 #include "td/utils/port/sleep.h"
 #include "td/utils/port/thread.h"
@@ -901,6 +902,54 @@ class RingBenchmark : public td::Benchmark {
   }
 };
 
+// many writers and one reader, like schedulers sending events to the main scheduler
+template <class QueueT>
+class FanInQueueBenchmark : public td::Benchmark {
+  QueueT queue;
+  int writers_n;
+
+ public:
+  explicit FanInQueueBenchmark(int writers_n) : writers_n(writers_n) {
+  }
+
+  std::string get_description() const override {
+    return "FanInQueueBenchmark";
+  }
+
+  void start_up() override {
+    queue.init();
+  }
+
+  void tear_down() override {
+    queue.destroy();
+  }
+
+  void run(int n) override {
+    int per_writer = td::max(n / writers_n, 1);
+    std::vector<td::thread> writers;
+    for (int i = 0; i < writers_n; i++) {
+      writers.emplace_back([&] {
+        for (int j = 0; j < per_writer; j++) {
+          queue.writer_put(j);
+          queue.writer_flush();
+        }
+      });
+    }
+    td::int64 left = static_cast<td::int64>(per_writer) * writers_n;
+    while (left > 0) {
+      int cnt = queue.reader_wait();
+      left -= cnt;
+      while (cnt-- > 0) {
+        queue.reader_get_unsafe();
+      }
+      queue.reader_flush();
+    }
+    for (auto &writer : writers) {
+      writer.join();
+    }
+  }
+};
+
 void test_queue() {
   std::vector<td::thread> threads;
   static constexpr size_t THREAD_COUNT = 100;
@@ -938,6 +987,10 @@ int main() {
   std::fprintf(stderr, "%s %d:\t", #Q, N); \
   td::bench(QueueBenchmark<Q>(N));
 
+#define BENCH_FAN_IN(Q, N)                         \
+  std::fprintf(stderr, "%s %d writers:\t", #Q, N); \
+  td::bench(FanInQueueBenchmark<Q>(N));
+
 #define BENCH_R(Q)                   \
   std::fprintf(stderr, "%s:\t", #Q); \
   td::bench(RingBenchmark<Q>());
@@ -951,6 +1004,16 @@ int main() {
   BENCH_Q2(td::MpscPollableQueue<qvalue_t>, 100);
   BENCH_Q2(td::PollQueue<qvalue_t>, 10);
   BENCH_Q2(td::MpscPollableQueue<qvalue_t>, 10);
+  BENCH_Q2(td::MpscLinkPollableQueue<qvalue_t>, 1);
+  BENCH_Q2(td::MpscLinkPollableQueue<qvalue_t>, 100);
+  BENCH_Q2(td::MpscLinkPollableQueue<qvalue_t>, 10);
+
+  BENCH_FAN_IN(td::MpscPollableQueue<qvalue_t>, 1);
+  BENCH_FAN_IN(td::MpscLinkPollableQueue<qvalue_t>, 1);
+  BENCH_FAN_IN(td::MpscPollableQueue<qvalue_t>, 4);
+  BENCH_FAN_IN(td::MpscLinkPollableQueue<qvalue_t>, 4);
+  BENCH_FAN_IN(td::MpscPollableQueue<qvalue_t>, 16);
+  BENCH_FAN_IN(td::MpscLinkPollableQueue<qvalue_t>, 16);
 
   BENCH_Q(VarQueue, 1);
   // BENCH_Q(FdQueue, 1);
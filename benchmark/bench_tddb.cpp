@@ -14,17 +14,26 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/db/binlog/Binlog.h"
+#include "td/db/DbKey.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/TQueue.h"
 
 #include "td/utils/benchmark.h"
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/port/Clocks.h"
 #include "td/utils/Random.h"
+#include "td/utils/Span.h"
 #include "td/utils/Status.h"
+#include "td/utils/Storer.h"
 
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 
 namespace td {
 
@@ -108,9 +117,131 @@ class MessagesDbBench : public Benchmark {
     return Status::OK();
   }
 };
+
+// measures latency of binlog writes, which trigger compactions of the binlog;
+// unencrypted binlogs are compacted incrementally, encrypted binlogs are reindexed at once
+class BinlogCompactionBench : public Benchmark {
+ public:
+  explicit BinlogCompactionBench(bool is_encrypted) : is_encrypted_(is_encrypted) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Binlog compaction " << (is_encrypted_ ? "(reindex)" : "(incremental)");
+  }
+
+  void start_up() override {
+    Binlog::destroy(binlog_name_).ignore();
+    binlog_ = make_unique<Binlog>();
+    auto db_key = is_encrypted_ ? DbKey::password("cucumber") : DbKey::empty();
+    binlog_->init(binlog_name_, [](const BinlogEvent &event) {}, std::move(db_key)).ensure();
+    for (int i = 0; i < LIVE_EVENT_COUNT; i++) {
+      ids_.push_back(binlog_->add(1, create_storer(string(Random::fast(25, 75) * 4, 'a'))));
+    }
+    latencies_.clear();
+  }
+
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      auto id = ids_[Random::fast(0, LIVE_EVENT_COUNT - 1)];
+      auto data = string(Random::fast(25, 75) * 4, 'b');
+      auto start_time = Clocks::monotonic();
+      binlog_->rewrite(id, 1, create_storer(data));
+      latencies_.push_back(Clocks::monotonic() - start_time);
+    }
+  }
+
+  void tear_down() override {
+    binlog_->close_and_destroy().ensure();
+    binlog_ = nullptr;
+    ids_.clear();
+
+    if (latencies_.size() < MIN_REPORTED_WRITE_COUNT) {
+      // too few writes to trigger compaction
+      return;
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    auto get_percentile = [&](double percentile) {
+      auto index = static_cast<size_t>(static_cast<double>(latencies_.size() - 1) * percentile);
+      return format::as_time(latencies_[index]);
+    };
+    LOG(WARNING) << get_description() << " write latency: " << tag("p50", get_percentile(0.5))
+                 << tag("p99", get_percentile(0.99)) << tag("p99.9", get_percentile(0.999))
+                 << tag("max", get_percentile(1.0));
+  }
+
+ private:
+  static constexpr int LIVE_EVENT_COUNT = 20000;
+  static constexpr size_t MIN_REPORTED_WRITE_COUNT = 1 << 16;
+
+  bool is_encrypted_;
+  string binlog_name_ = "bench_binlog";
+  unique_ptr<Binlog> binlog_;
+  vector<uint64> ids_;
+  vector<double> latencies_;
+};
+
+// measures throughput of TQueue for bot updates: events are pushed to many queues, half of the queues are read
+// in batches with confirmation of the previously received events, and events in the other queues expire
+class TQueueBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return "TQueue push/get/gc";
+  }
+
+  void start_up() override {
+    tqueue_ = TQueue::create();
+    next_event_ids_.clear();
+    now_ = 1;
+  }
+
+  void run(int n) override {
+    TQueue::Event events[100];
+    for (int i = 0; i < n; i++) {
+      tqueue_->push(Random::fast(1, QUEUE_COUNT), "event data", now_ + EVENT_TTL, 0, TQueue::EventId()).ensure();
+
+      if (i % 10 == 0) {
+        TQueue::QueueId queue_id = Random::fast(1, QUEUE_COUNT / 2);
+        auto &next_event_id = next_event_ids_[queue_id];
+        if (next_event_id.empty()) {
+          next_event_id = tqueue_->get_head(queue_id);
+        }
+        MutableSpan<TQueue::Event> span(events, 100);
+        tqueue_->get(queue_id, next_event_id, true, now_, span).ensure();
+        if (!span.empty()) {
+          next_event_id = span.back().id.next().move_as_ok();
+        }
+      }
+
+      if (i % 1000 == 0) {
+        now_++;
+        tqueue_->run_gc(now_);
+      }
+    }
+  }
+
+  void tear_down() override {
+    tqueue_ = nullptr;
+  }
+
+ private:
+  static constexpr int32 QUEUE_COUNT = 1000;
+  static constexpr int32 EVENT_TTL = 100;
+
+  unique_ptr<TQueue> tqueue_;
+  std::unordered_map<TQueue::QueueId, TQueue::EventId> next_event_ids_;
+  int32 now_ = 1;
+};
 }  // namespace td
 
-int main() {
+int main(int argc, char *argv[]) {
+  td::BenchmarkRunner runner;
+  if (!runner.init(argc, argv)) {
+    return 1;
+  }
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
-  bench(td::MessagesDbBench());
+  runner.run(td::MessagesDbBench());
+  runner.run(td::BinlogCompactionBench(false));
+  runner.run(td::BinlogCompactionBench(true));
+  runner.run(td::TQueueBench());
+  return runner.finish();
 }
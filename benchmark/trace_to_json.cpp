@@ -0,0 +1,193 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/format.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/StringBuilder.h"
+#include "td/utils/TraceLog.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+// converts files written by td::TraceLog to Chrome trace format, which can be opened in chrome://tracing
+// usage: trace_to_json <names.<pid>.txt> <trace.<pid>.<index>.bin>... > trace.json
+
+namespace {
+
+struct ThreadEvents {
+  td::uint64 thread_index = 0;
+  td::vector<td::TraceLog::Event> events;
+};
+
+td::Result<std::unordered_map<td::uint32, td::string>> read_names(td::CSlice path) {
+  TRY_RESULT(data, td::read_file_str(path));
+  std::unordered_map<td::uint32, td::string> names;
+  for (auto line : td::full_split(td::Slice(data), '\n')) {
+    if (line.empty()) {
+      continue;
+    }
+    auto id_name = td::split(line);
+    TRY_RESULT(name_id, td::to_integer_safe<td::uint32>(id_name.first));
+    names[name_id] = id_name.second.str();
+  }
+  return std::move(names);
+}
+
+td::Result<ThreadEvents> read_events(td::CSlice path) {
+  TRY_RESULT(data, td::read_file(path));
+  auto slice = data.as_slice();
+  if (slice.size() < sizeof(td::TraceLog::FileHeader)) {
+    return td::Status::Error("File is too small");
+  }
+
+  td::uint64 magic;
+  td::uint32 event_size;
+  td::uint64 capacity;
+  td::uint64 thread_index;
+  td::uint64 event_count;
+  std::memcpy(&magic, slice.begin() + offsetof(td::TraceLog::FileHeader, magic), sizeof(magic));
+  std::memcpy(&event_size, slice.begin() + offsetof(td::TraceLog::FileHeader, event_size), sizeof(event_size));
+  std::memcpy(&capacity, slice.begin() + offsetof(td::TraceLog::FileHeader, capacity), sizeof(capacity));
+  std::memcpy(&thread_index, slice.begin() + offsetof(td::TraceLog::FileHeader, thread_index), sizeof(thread_index));
+  std::memcpy(&event_count, slice.begin() + offsetof(td::TraceLog::FileHeader, event_count), sizeof(event_count));
+  if (magic != td::TraceLog::FileHeader::MAGIC) {
+    return td::Status::Error("Wrong file format");
+  }
+  if (event_size != sizeof(td::TraceLog::Event) || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+      (slice.size() - sizeof(td::TraceLog::FileHeader)) / event_size < capacity) {
+    return td::Status::Error("Wrong file header");
+  }
+
+  ThreadEvents result;
+  result.thread_index = thread_index;
+  auto events_begin = slice.begin() + sizeof(td::TraceLog::FileHeader);
+  auto first_event = event_count > capacity ? event_count - capacity : 0;
+  for (auto i = first_event; i < event_count; i++) {
+    td::TraceLog::Event event;
+    std::memcpy(&event, events_begin + (i & (capacity - 1)) * event_size, sizeof(event));
+    result.events.push_back(event);
+  }
+  return std::move(result);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    LOG(PLAIN) << "Usage: trace_to_json <names file> <trace file>...";
+    return 1;
+  }
+
+  auto r_names = read_names(td::CSlice(argv[1]));
+  if (r_names.is_error()) {
+    LOG(ERROR) << "Failed to read names from " << argv[1] << ": " << r_names.error();
+    return 1;
+  }
+  auto names = r_names.move_as_ok();
+
+  td::vector<ThreadEvents> threads;
+  for (int i = 2; i < argc; i++) {
+    auto r_events = read_events(td::CSlice(argv[i]));
+    if (r_events.is_error()) {
+      LOG(ERROR) << "Failed to read events from " << argv[i] << ": " << r_events.error();
+      continue;
+    }
+    threads.push_back(r_events.move_as_ok());
+  }
+
+  auto min_timestamp = std::numeric_limits<td::uint64>::max();
+  for (auto &thread : threads) {
+    for (auto &event : thread.events) {
+      min_timestamp = td::min(min_timestamp, event.timestamp);
+    }
+  }
+
+  auto get_name = [&](td::uint32 name_id) -> td::Slice {
+    auto it = names.find(name_id);
+    if (it == names.end()) {
+      return td::Slice("unknown");
+    }
+    return it->second;
+  };
+
+  td::StringBuilder sb(td::MutableSlice(), true);
+  sb << "{\"traceEvents\":[";
+  bool is_first = true;
+  for (auto &thread : threads) {
+    for (auto &event : thread.events) {
+      td::Slice phase;
+      td::Slice category;
+      td::string name;
+      bool is_async = false;
+      switch (static_cast<td::TraceLog::EventType>(event.type)) {
+        case td::TraceLog::EventType::ActorEventBegin:
+          phase = td::Slice("B");
+          category = td::Slice("actor");
+          name = get_name(event.name_id).str();
+          break;
+        case td::TraceLog::EventType::ActorEventEnd:
+          phase = td::Slice("E");
+          category = td::Slice("actor");
+          name = get_name(event.name_id).str();
+          break;
+        case td::TraceLog::EventType::QuerySent:
+          phase = td::Slice("b");
+          is_async = true;
+          break;
+        case td::TraceLog::EventType::QueryReceived:
+          phase = td::Slice("e");
+          is_async = true;
+          break;
+        case td::TraceLog::EventType::DbOperationBegin:
+          phase = td::Slice("B");
+          category = td::Slice("db");
+          name = get_name(event.name_id).str();
+          break;
+        case td::TraceLog::EventType::DbOperationEnd:
+          phase = td::Slice("E");
+          category = td::Slice("db");
+          name = get_name(event.name_id).str();
+          break;
+        default:
+          continue;
+      }
+      if (is_async) {
+        category = td::Slice("query");
+        name = PSTRING() << "query " << td::format::as_hex(static_cast<td::uint32>(event.arg));
+      }
+
+      if (!is_first) {
+        sb << ',';
+      }
+      is_first = false;
+      auto timestamp = event.timestamp - min_timestamp;
+      sb << "\n{\"name\":" << td::JsonString(name) << ",\"cat\":\"" << category << "\",\"ph\":\"" << phase
+         << "\",\"ts\":" << timestamp / 1000 << '.' << td::lpad0(td::to_string(timestamp % 1000), 3)
+         << ",\"pid\":1,\"tid\":" << thread.thread_index;
+      if (is_async) {
+        sb << ",\"id\":\"" << td::format::as_hex(event.id) << '"';
+      } else if (phase == "B") {
+        sb << ",\"args\":{\"id\":\"" << td::format::as_hex(event.id) << "\"}";
+      }
+      sb << '}';
+    }
+  }
+  sb << "\n]}\n";
+
+  auto result = sb.as_cslice();
+  std::fwrite(result.data(), 1, result.size(), stdout);
+  return 0;
+}
@@ -8,33 +8,55 @@
 #include "td/actor/PromiseFuture.h"
 
 #include "td/net/HttpQuery.h"
+#include "td/net/SslStream.h"
 #include "td/net/Wget.h"
 
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Slice.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
+
+static void run_wget(td::string url, bool prefer_ipv6, int left_count, double start_time) {
+  auto timeout = 10;
+  auto ttl = 3;
+  td::create_actor<td::Wget>(
+      "Client",
+      td::PromiseCreator::lambda([url, prefer_ipv6, left_count, start_time](
+                                     td::Result<td::unique_ptr<td::HttpQuery>> res) {
+        if (res.is_error()) {
+          LOG(FATAL) << res.error();
+        }
+        if (left_count > 1) {
+          return run_wget(url, prefer_ipv6, left_count - 1, start_time);
+        }
+        LOG(ERROR) << *res.ok();
+
+        // every query uses a new connection, so all handshakes except the first one can resume the TLS session
+        auto stats = td::SslStream::get_session_cache_stats();
+        LOG(ERROR) << "Finished in " << td::Time::now() - start_time << " seconds with " << stats.handshake_count
+                   << " TLS handshakes, " << stats.offered_session_count << " offered and "
+                   << stats.resumed_session_count << " resumed sessions";
+        td::Scheduler::instance()->finish();
+      }),
+      url, td::Auto(), timeout, ttl, prefer_ipv6)
+      .release();
+}
 
 int main(int argc, char *argv[]) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
   td::VERBOSITY_NAME(fd) = VERBOSITY_NAME(INFO);
 
   td::string url = (argc > 1 ? argv[1] : "https://telegram.org");
-  auto timeout = 10;
-  auto ttl = 3;
   auto prefer_ipv6 = (argc > 2 && td::string(argv[2]) == "-6");
+  auto query_count = (argc > 3 ? td::max(td::to_integer<int>(td::Slice(argv[3])), 1) : 1);
   auto scheduler = td::make_unique<td::ConcurrentScheduler>();
   scheduler->init(0);
-  scheduler
-      ->create_actor_unsafe<td::Wget>(0, "Client",
-                                      td::PromiseCreator::lambda([](td::Result<td::unique_ptr<td::HttpQuery>> res) {
-                                        if (res.is_error()) {
-                                          LOG(FATAL) << res.error();
-                                        }
-                                        LOG(ERROR) << *res.ok();
-                                        td::Scheduler::instance()->finish();
-                                      }),
-                                      url, td::Auto(), timeout, ttl, prefer_ipv6)
-      .release();
+  {
+    auto guard = scheduler->get_main_guard();
+    run_wget(url, prefer_ipv6, query_count, td::Time::now());
+  }
   scheduler->start();
   while (scheduler->run_main(10)) {
     // empty
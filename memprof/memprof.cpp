@@ -11,12 +11,16 @@
 #if (TD_DARWIN || TD_LINUX) && defined(USE_MEMPROF)
 #include <algorithm>
 #include <atomic>
+#include <cinttypes>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <new>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -85,10 +89,10 @@ double get_fast_backtrace_success_rate() {
 
 #endif
 
-static Backtrace get_backtrace() {
+static Backtrace get_backtrace(std::int32_t weight) {
   static __thread bool in_backtrace;  // static zero-initialized
   Backtrace res{{nullptr}};
-  if (in_backtrace) {
+  if (weight == 0 || in_backtrace) {
     return res;
   }
   in_backtrace = true;
@@ -126,9 +130,56 @@ static constexpr std::int32_t MALLOC_INFO_MAGIC = 0x27138373;
 struct malloc_info {
   std::int32_t magic;
   std::int32_t size;
-  std::int32_t ht_pos;
+  std::int32_t ht_pos;  // -1 if the allocation isn't tracked
+  std::int32_t weight;  // estimated number of allocations represented by the allocation
 };
 
+static std::atomic<std::size_t> sampling_rate{0};
+
+void set_memprof_sampling_rate(std::size_t new_sampling_rate) {
+  sampling_rate.store(new_sampling_rate, std::memory_order_relaxed);
+}
+
+std::size_t get_memprof_sampling_rate() {
+  return sampling_rate.load(std::memory_order_relaxed);
+}
+
+// distances between samples are exponentially distributed, so allocations are sampled as events of a Poisson process
+static double get_next_sample_distance(std::size_t rate) {
+  static __thread std::uint64_t random_state;  // static zero-initialized
+  if (random_state == 0) {
+    random_state = reinterpret_cast<std::uintptr_t>(&random_state) * 0x9E3779B97F4A7C15ull | 1;
+  }
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  auto random = static_cast<double>((random_state * 0x2545F4914F6CDD1Dull) >> 11) + 0.5;
+  return -std::log(random / static_cast<double>(static_cast<std::uint64_t>(1) << 53)) * static_cast<double>(rate);
+}
+
+// returns 0 if the allocation must not be tracked
+static std::int32_t get_allocation_weight(std::size_t size) {
+  auto rate = sampling_rate.load(std::memory_order_relaxed);
+  if (rate == 0) {
+    return 1;
+  }
+
+  static __thread std::size_t thread_rate;     // static zero-initialized
+  static __thread double bytes_until_sample;  // static zero-initialized
+  if (thread_rate != rate) {
+    thread_rate = rate;
+    bytes_until_sample = get_next_sample_distance(rate);
+  }
+  bytes_until_sample -= static_cast<double>(size);
+  if (bytes_until_sample > 0 || size == 0) {
+    return 0;
+  }
+  bytes_until_sample = get_next_sample_distance(rate);
+
+  auto probability = -std::expm1(-static_cast<double>(size) / static_cast<double>(rate));
+  return static_cast<std::int32_t>(std::min(1 / probability + 0.5, 1e9));
+}
+
 static std::uint64_t get_hash(const Backtrace &bt) {
   std::uint64_t h = 7;
   for (std::size_t i = 0; i < bt.size() && i < BACKTRACE_HASHED_LENGTH; i++) {
@@ -141,6 +192,9 @@ struct HashtableNode {
   std::atomic<std::uint64_t> hash;
   Backtrace backtrace;
   std::atomic<std::size_t> size;
+  std::atomic<std::size_t> count;
+  std::atomic<std::size_t> total_size;
+  std::atomic<std::size_t> total_count;
 };
 
 static constexpr std::size_t HT_MAX_SIZE = 1000000;
@@ -196,23 +250,91 @@ void dump_alloc(const std::function<void(const AllocInfo &)> &func) {
     if (size == 0) {
       continue;
     }
-    func(AllocInfo{node.backtrace, size});
+    func(AllocInfo{node.backtrace, size, node.count.load(std::memory_order_relaxed)});
   }
 }
 
+std::string get_memprof_heap_profile() {
+  char buf[96];
+  auto append_counts = [&buf](std::string &to, std::size_t count, std::size_t size, std::size_t total_count,
+                              std::size_t total_size) {
+    std::snprintf(buf, sizeof(buf), "%zu: %zu [%zu: %zu] @", count, size, total_count, total_size);
+    to += buf;
+  };
+
+  std::size_t count = 0;
+  std::size_t size = 0;
+  std::size_t total_count = 0;
+  std::size_t total_size = 0;
+  std::string stacks;
+  for (auto &node : ht) {
+    auto node_total_count = node.total_count.load(std::memory_order_relaxed);
+    if (node_total_count == 0) {
+      continue;
+    }
+    auto node_count = node.count.load(std::memory_order_relaxed);
+    auto node_size = node.size.load(std::memory_order_relaxed);
+    auto node_total_size = node.total_size.load(std::memory_order_relaxed);
+    count += node_count;
+    size += node_size;
+    total_count += node_total_count;
+    total_size += node_total_size;
+
+    append_counts(stacks, node_count, node_size, node_total_count, node_total_size);
+    for (auto ip : node.backtrace) {
+      if (ip == nullptr) {
+        break;
+      }
+      std::snprintf(buf, sizeof(buf), " 0x%" PRIxPTR, reinterpret_cast<std::uintptr_t>(ip));
+      stacks += buf;
+    }
+    stacks += '\n';
+  }
+
+  // the estimated counts are already unsampled, so the profile is stored as if there were no sampling
+  std::string result = "heap profile: ";
+  append_counts(result, count, size, total_count, total_size);
+  result += " heapprofile\n";
+  result += stacks;
+
+#if TD_LINUX
+  result += "\nMAPPED_LIBRARIES:\n";
+  auto *maps = std::fopen("/proc/self/maps", "r");
+  if (maps != nullptr) {
+    std::size_t read_size;
+    char maps_buf[4096];
+    while ((read_size = std::fread(maps_buf, 1, sizeof(maps_buf), maps)) > 0) {
+      result.append(maps_buf, read_size);
+    }
+    std::fclose(maps);
+  }
+#endif
+  return result;
+}
+
 void register_xalloc(malloc_info *info, std::int32_t diff) {
   my_assert(info->size >= 0);
+  if (info->ht_pos == -1) {
+    return;
+  }
+  auto &node = ht[info->ht_pos];
+  auto size = static_cast<std::size_t>(info->size) * static_cast<std::size_t>(info->weight);
+  auto count = static_cast<std::size_t>(info->weight);
   if (diff > 0) {
-    ht[info->ht_pos].size.fetch_add(info->size, std::memory_order_relaxed);
+    node.size.fetch_add(size, std::memory_order_relaxed);
+    node.count.fetch_add(count, std::memory_order_relaxed);
+    node.total_size.fetch_add(size, std::memory_order_relaxed);
+    node.total_count.fetch_add(count, std::memory_order_relaxed);
   } else {
-    auto old_value = ht[info->ht_pos].size.fetch_sub(info->size, std::memory_order_relaxed);
-    my_assert(old_value >= static_cast<std::size_t>(info->size));
+    auto old_value = node.size.fetch_sub(size, std::memory_order_relaxed);
+    my_assert(old_value >= size);
+    node.count.fetch_sub(count, std::memory_order_relaxed);
   }
 }
 
 extern "C" {
 
-static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
+static void *malloc_with_frame(std::size_t size, std::int32_t weight, const Backtrace &frame) {
   static_assert(RESERVED_SIZE % alignof(std::max_align_t) == 0, "fail");
   static_assert(RESERVED_SIZE >= sizeof(malloc_info), "fail");
 #if TD_DARWIN
@@ -227,7 +349,8 @@ static void *malloc_with_frame(std::size_t size, const Backtrace &frame) {
 
   info->magic = MALLOC_INFO_MAGIC;
   info->size = static_cast<std::int32_t>(size);
-  info->ht_pos = get_ht_pos(frame);
+  info->ht_pos = weight == 0 ? -1 : get_ht_pos(frame);
+  info->weight = weight;
 
   register_xalloc(info, +1);
 
@@ -246,7 +369,8 @@ static malloc_info *get_info(void *data_void) {
 }
 
 void *malloc(std::size_t size) {
-  return malloc_with_frame(size, get_backtrace());
+  auto weight = get_allocation_weight(size);
+  return malloc_with_frame(size, weight, get_backtrace(weight));
 }
 
 void free(void *data_void) {
@@ -267,16 +391,18 @@ void free(void *data_void) {
 }
 void *calloc(std::size_t size_a, std::size_t size_b) {
   auto size = size_a * size_b;
-  void *res = malloc_with_frame(size, get_backtrace());
+  auto weight = get_allocation_weight(size);
+  void *res = malloc_with_frame(size, weight, get_backtrace(weight));
   std::memset(res, 0, size);
   return res;
 }
 void *realloc(void *ptr, std::size_t size) {
+  auto weight = get_allocation_weight(size);
   if (ptr == nullptr) {
-    return malloc_with_frame(size, get_backtrace());
+    return malloc_with_frame(size, weight, get_backtrace(weight));
   }
   auto *info = get_info(ptr);
-  auto *new_ptr = malloc_with_frame(size, get_backtrace());
+  auto *new_ptr = malloc_with_frame(size, weight, get_backtrace(weight));
   auto to_copy = std::min(static_cast<std::int32_t>(size), info->size);
   std::memcpy(new_ptr, ptr, to_copy);
   free(ptr);
@@ -290,7 +416,8 @@ void *memalign(std::size_t aligment, std::size_t size) {
 
 // c++14 guarantees that it is enough to override these two operators.
 void *operator new(std::size_t count) {
-  return malloc_with_frame(count, get_backtrace());
+  auto weight = get_allocation_weight(count);
+  return malloc_with_frame(count, weight, get_backtrace(weight));
 }
 void operator delete(void *ptr) noexcept(true) {
   free(ptr);
@@ -316,6 +443,14 @@ double get_fast_backtrace_success_rate() {
 std::size_t get_ht_size() {
   return 0;
 }
+void set_memprof_sampling_rate(std::size_t sampling_rate) {
+}
+std::size_t get_memprof_sampling_rate() {
+  return 0;
+}
+std::string get_memprof_heap_profile() {
+  return std::string();
+}
 #endif
 
 std::size_t get_used_memory_size() {
@@ -9,6 +9,7 @@
 #include <array>
 #include <cstddef>
 #include <functional>
+#include <string>
 
 constexpr std::size_t BACKTRACE_SHIFT = 2;
 constexpr std::size_t BACKTRACE_HASHED_LENGTH = 6;
@@ -18,10 +19,23 @@ using Backtrace = std::array<void *, BACKTRACE_LENGTH>;
 struct AllocInfo {
   Backtrace backtrace;
   std::size_t size;
+  std::size_t count;
 };
 
 bool is_memprof_on();
 std::size_t get_ht_size();
 double get_fast_backtrace_success_rate();
+
+// sizes and counts of alive allocations for every backtrace; estimated from the samples if sampling is enabled
 void dump_alloc(const std::function<void(const AllocInfo &)> &func);
 std::size_t get_used_memory_size();
+
+// if sampling rate is 0, then all allocations are tracked, otherwise an allocation is tracked with probability
+// 1 - exp(-size / sampling_rate), i.e. once per sampling_rate allocated bytes on average;
+// backtraces of other allocations aren't collected, so rates like 512 KB are cheap enough for production use
+// the rate can be changed at any time and affects only subsequent allocations
+void set_memprof_sampling_rate(std::size_t sampling_rate);
+std::size_t get_memprof_sampling_rate();
+
+// returns alive and all allocations in the legacy text heap profile format, which can be read by pprof
+std::string get_memprof_heap_profile();
@@ -30,7 +30,8 @@ static void generate_cpp(const std::string &directory, const std::string &tl_nam
 
 int main() {
   generate_cpp<>("auto/td/telegram", "telegram_api", "std::string", "BufferSlice",
-                 {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""}, {"\"td/utils/buffer.h\""});
+                 {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""},
+                 {"\"td/tl/TlArena.h\"", "\"td/utils/buffer.h\""});
 
   generate_cpp<>("auto/td/telegram", "secret_api", "std::string", "BufferSlice",
                  {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""}, {"\"td/utils/buffer.h\""});
@@ -41,8 +42,11 @@ int main() {
 
 #ifdef TD_ENABLE_JNI
   generate_cpp<td::TD_TL_writer_jni_cpp, td::TD_TL_writer_jni_h>(
-      "auto/td/telegram", "td_api", "std::string", "std::string", {"\"td/tl/tl_jni_object.h\""}, {"<string>"});
+      "auto/td/telegram", "td_api", "std::string", "std::string", {"\"td/tl/tl_jni_object.h\""},
+      {"\"td/tl/TlObjectPool.h\"", "<string>"});
 #else
-  generate_cpp<>("auto/td/telegram", "td_api", "std::string", "std::string", {}, {"<string>"});
+  generate_cpp<>("auto/td/telegram", "td_api", "std::string", "std::string",
+                 {"\"td/tl/tl_object_parse.h\"", "\"td/tl/tl_object_store.h\""},
+                 {"\"td/tl/TlObjectPool.h\"", "<string>"});
 #endif
 }
@@ -15,6 +15,8 @@
 #include "td/utils/Slice.h"
 #include "td/utils/StringBuilder.h"
 
+#include <algorithm>
+#include <map>
 #include <utility>
 
 namespace td {
@@ -101,10 +103,34 @@ void gen_from_json_constructor(StringBuilder &sb, const T *constructor, bool is_
     sb << ";\n\n";
   } else {
     sb << " {\n";
-    for (auto &arg : constructor->args) {
-      sb << "  TRY_STATUS(from_json" << (arg.type->type == tl::simple::Type::Bytes ? "_bytes" : "") << "(to."
-         << tl::simple::gen_cpp_field_name(arg.name) << ", get_json_object_field_force(from, \""
-         << tl::simple::gen_cpp_name(arg.name) << "\")));\n";
+    if (!constructor->args.empty()) {
+      // match all fields in a single pass over the object, at first comparing only name lengths
+      std::map<size_t, vector<const tl::simple::Arg *>> args_by_name_size;
+      for (auto &arg : constructor->args) {
+        args_by_name_size[tl::simple::gen_cpp_name(arg.name).size()].push_back(&arg);
+      }
+      sb << "  for (auto &field_value : from) {\n";
+      sb << "    Slice name = field_value.first;\n";
+      sb << "    switch (name.size()) {\n";
+      for (auto &it : args_by_name_size) {
+        sb << "      case " << it.first << ":\n";
+        sb << "        ";
+        for (auto *arg : it.second) {
+          if (arg != it.second[0]) {
+            sb << " else ";
+          }
+          sb << "if (name == Slice(\"" << tl::simple::gen_cpp_name(arg->name) << "\")) {\n";
+          sb << "          TRY_STATUS(from_json" << (arg->type->type == tl::simple::Type::Bytes ? "_bytes" : "")
+             << "(to." << tl::simple::gen_cpp_field_name(arg->name) << ", std::move(field_value.second)));\n";
+          sb << "        }";
+        }
+        sb << "\n";
+        sb << "        break;\n";
+      }
+      sb << "      default:\n";
+      sb << "        break;\n";
+      sb << "    }\n";
+      sb << "  }\n";
     }
     sb << "  return Status::OK();\n";
     sb << "}\n\n";
@@ -129,30 +155,112 @@ void gen_from_json(StringBuilder &sb, const tl::simple::Schema &schema, bool is_
 }
 
 using Vec = std::vector<std::pair<int32, std::string>>;
+
+// must be kept in sync with get_tl_constructor_name_hash in the generated code
+static uint32 get_name_hash(Slice name) {
+  uint32 hash = 2166136261u;
+  for (auto c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// must be kept in sync with get_tl_constructor_name_slot in the generated code
+static uint32 get_slot_hash(uint32 hash, uint32 displacement) {
+  hash ^= displacement * 0x9E3779B9u;
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6Bu;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+// builds minimal perfect hash of the names using "hash, displace" method:
+// names are split into buckets by their hash and displacement of each bucket is chosen so,
+// that all names of the bucket are placed into different free slots
+static std::pair<vector<uint32>, vector<int32>> build_perfect_hash(const vector<uint32> &hashes, size_t slot_count) {
+  size_t bucket_count = (hashes.size() + 3) / 4;
+  vector<vector<int32>> buckets(bucket_count);
+  for (size_t i = 0; i < hashes.size(); i++) {
+    buckets[hashes[i] % bucket_count].push_back(static_cast<int32>(i));
+  }
+  vector<size_t> bucket_order(bucket_count);
+  for (size_t i = 0; i < bucket_count; i++) {
+    bucket_order[i] = i;
+  }
+  std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                   [&buckets](size_t lhs, size_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+  vector<uint32> displacements(bucket_count, 0);
+  vector<int32> slots(slot_count, -1);
+  for (auto bucket_id : bucket_order) {
+    auto &bucket = buckets[bucket_id];
+    for (uint32 displacement = 0;; displacement++) {
+      CHECK(displacement < 65536);
+      vector<size_t> bucket_slots;
+      for (auto i : bucket) {
+        auto slot = get_slot_hash(hashes[i], displacement) & (slot_count - 1);
+        if (slots[slot] != -1 || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (bucket_slots.size() == bucket.size()) {
+        for (size_t j = 0; j < bucket.size(); j++) {
+          slots[bucket_slots[j]] = bucket[j];
+        }
+        displacements[bucket_id] = displacement;
+        break;
+      }
+    }
+  }
+  return {std::move(displacements), std::move(slots)};
+}
+
 void gen_tl_constructor_from_string(StringBuilder &sb, Slice name, const Vec &vec, bool is_header) {
-  sb << "Result<int32> tl_constructor_from_string(td_api::" << name << " *object, const std::string &str)";
+  sb << "Result<int32> tl_constructor_from_string(td_api::" << name << " *object, Slice str)";
   if (is_header) {
     sb << ";\n\n";
     return;
   }
-  sb << " {\n";
-  sb << "  static const std::unordered_map<Slice, int32, SliceHash> m = {\n";
 
-  bool is_first = true;
+  vector<uint32> hashes;
   for (auto &p : vec) {
-    if (is_first) {
-      is_first = false;
+    hashes.push_back(get_name_hash(p.second));
+  }
+  size_t slot_count = 1;
+  while (slot_count < vec.size()) {
+    slot_count *= 2;
+  }
+  auto perfect_hash = build_perfect_hash(hashes, slot_count);
+  auto &displacements = perfect_hash.first;
+  auto &slots = perfect_hash.second;
+
+  sb << " {\n";
+  sb << "  static const uint16 displacements[] = {";
+  for (size_t i = 0; i < displacements.size(); i++) {
+    sb << (i % 16 == 0 ? "\n    " : " ") << displacements[i] << ",";
+  }
+  sb << "\n  };\n";
+  sb << "  static const TlConstructorName constructors[] = {\n";
+  for (auto slot : slots) {
+    if (slot == -1) {
+      sb << "    {nullptr, 0, 0},\n";
     } else {
-      sb << ",\n";
+      auto &p = vec[slot];
+      sb << "    {\"" << p.second << "\", " << p.second.size() << ", " << p.first << "},\n";
     }
-    sb << "    {\"" << p.second << "\", " << p.first << "}";
   }
-  sb << "\n  };\n";
-  sb << "  auto it = m.find(str);\n";
-  sb << "  if (it == m.end()) {\n"
+  sb << "  };\n";
+  sb << "  auto hash = get_tl_constructor_name_hash(str);\n";
+  sb << "  auto &constructor = constructors[get_tl_constructor_name_slot(hash, displacements[hash % "
+     << displacements.size() << "]) & " << slot_count - 1 << "];\n";
+  sb << "  if (constructor.name == nullptr || Slice(constructor.name, constructor.size) != str) {\n"
      << "    return Status::Error(PSLICE() << \"Unknown class \\\"\" << str << \"\\\"\");\n"
      << "  }\n"
-     << "  return it->second;\n";
+     << "  return constructor.id;\n";
   sb << "}\n\n";
 }
 
@@ -218,8 +326,7 @@ void gen_json_converter_file(const tl::simple::Schema &schema, const std::string
     sb << "#include \"td/utils/common.h\"\n";
     sb << "#include \"td/utils/Slice.h\"\n\n";
 
-    sb << "#include <functional>\n";
-    sb << "#include <unordered_map>\n\n";
+    sb << "#include <functional>\n\n";
   }
   sb << "namespace td {\n";
   sb << "namespace td_api {\n";
@@ -230,6 +337,31 @@ void gen_json_converter_file(const tl::simple::Schema &schema, const std::string
     sb << "\nvoid to_json(JsonValueScope &jv, const Function &object);\n\n";
   } else {
     sb << R"ABCD(
+struct TlConstructorName {
+  const char *name;
+  size_t size;
+  int32 id;
+};
+
+static uint32 get_tl_constructor_name_hash(Slice name) {
+  uint32 hash = 2166136261u;
+  for (auto c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint32 get_tl_constructor_name_slot(uint32 hash, uint32 displacement) {
+  hash ^= displacement * 0x9E3779B9u;
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6Bu;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
 void to_json(JsonValueScope &jv, const tl_object_ptr<Object> &value) {
   td::to_json(jv, std::move(value));
 }
@@ -171,6 +171,11 @@ std::string TD_TL_writer_cpp::gen_fetch_class_name(const tl::tl_tree_type *tree_
   return "TlFetchObject<" + gen_main_class_name(t) + ">";
 }
 
+bool TD_TL_writer_cpp::is_nullable_object_type(const tl::tl_type *t) const {
+  // objects in TDLib API can be absent, so they are always boxed and are serialized as null#56730bcc if absent
+  return tl_name == "td_api" && !is_built_in_simple_type(t->name) && !is_built_in_complex_type(t->name);
+}
+
 std::string TD_TL_writer_cpp::gen_full_fetch_class_name(const tl::tl_tree_type *tree_type) const {
   const tl::tl_type *t = tree_type->type;
   const std::string &name = t->name;
@@ -178,7 +183,7 @@ std::string TD_TL_writer_cpp::gen_full_fetch_class_name(const tl::tl_tree_type *
   assert(!(t->flags & tl::FLAG_DEFAULT_CONSTRUCTOR));  // Not supported yet
 
   std::int32_t expected_constructor_id = 0;
-  if (tree_type->flags & tl::FLAG_BARE) {
+  if ((tree_type->flags & tl::FLAG_BARE) && !is_nullable_object_type(t)) {
     assert(is_type_bare(t));
   } else {
     if (is_type_bare(t)) {
@@ -191,10 +196,14 @@ std::string TD_TL_writer_cpp::gen_full_fetch_class_name(const tl::tl_tree_type *
       }
     }
   }
-  if (expected_constructor_id == 0) {
-    return gen_fetch_class_name(tree_type);
+  std::string result = gen_fetch_class_name(tree_type);
+  if (expected_constructor_id != 0) {
+    result = "TlFetchBoxed<" + result + ", " + int_to_string(expected_constructor_id) + ">";
   }
-  return "TlFetchBoxed<" + gen_fetch_class_name(tree_type) + ", " + int_to_string(expected_constructor_id) + ">";
+  if (is_nullable_object_type(t)) {
+    result = "TlFetchNullable<" + result + ">";
+  }
+  return result;
 }
 
 std::string TD_TL_writer_cpp::gen_type_fetch(const std::string &field_name, const tl::tl_tree_type *tree_type,
@@ -357,7 +366,8 @@ std::string TD_TL_writer_cpp::gen_full_store_class_name(const tl::tl_tree_type *
 
   assert(!(t->flags & tl::FLAG_DEFAULT_CONSTRUCTOR));  // Not supported yet
 
-  if ((tree_type->flags & tl::FLAG_BARE) != 0 || t->name == "#" || t->name == "Bool") {
+  if (((tree_type->flags & tl::FLAG_BARE) != 0 && !is_nullable_object_type(t)) || t->name == "#" ||
+      t->name == "Bool") {
     return gen_store_class_name(tree_type);
   }
 
@@ -365,13 +375,18 @@ std::string TD_TL_writer_cpp::gen_full_store_class_name(const tl::tl_tree_type *
     return "TlStoreBoxed<" + gen_store_class_name(tree_type) + ", " + int_to_string(t->constructors[0]->id) + ">";
   }
 
+  auto wrap_nullable = [&](std::string class_name) {
+    return is_nullable_object_type(t) ? "TlStoreNullable<" + class_name + ">" : class_name;
+  };
+
   if (!is_type_bare(t)) {
-    return "TlStoreBoxedUnknown<" + gen_store_class_name(tree_type) + ">";
+    return wrap_nullable("TlStoreBoxedUnknown<" + gen_store_class_name(tree_type) + ">");
   }
 
   for (std::size_t i = 0; i < t->constructors_num; i++) {
     if (is_combinator_supported(t->constructors[i])) {
-      return "TlStoreBoxed<" + gen_store_class_name(tree_type) + ", " + int_to_string(t->constructors[i]->id) + ">";
+      return wrap_nullable("TlStoreBoxed<" + gen_store_class_name(tree_type) + ", " +
+                           int_to_string(t->constructors[i]->id) + ">");
     }
   }
 
@@ -25,6 +25,8 @@ class TD_TL_writer_cpp : public TD_TL_writer {
 
   std::string gen_full_store_class_name(const tl::tl_tree_type *tree_type) const;
 
+  bool is_nullable_object_type(const tl::tl_type *t) const;
+
   std::vector<std::string> ext_include;
 
  protected:
@@ -221,9 +221,31 @@ std::string TD_TL_writer_h::gen_forward_class_declaration(const std::string &cla
 
 std::string TD_TL_writer_h::gen_class_begin(const std::string &class_name, const std::string &base_class_name,
                                             bool is_proxy) const {
-  return "class " + class_name + (!is_proxy ? " final " : "") + ": public " + base_class_name +
-         " {\n"
-         " public:\n";
+  std::string result = "class " + class_name + (!is_proxy ? " final " : "") + ": public " + base_class_name +
+                       " {\n"
+                       " public:\n";
+  if (tl_name == "telegram_api" && class_name == gen_base_type_class_name(0)) {
+    // objects received from the server are allocated by TlArena
+    result +=
+        "  static void *operator new(std::size_t size) {\n"
+        "    return TlArena::allocate(size);\n"
+        "  }\n\n"
+        "  static void operator delete(void *ptr) {\n"
+        "    TlArena::deallocate(ptr);\n"
+        "  }\n";
+  }
+  if (tl_name == "td_api" &&
+      (class_name == gen_base_type_class_name(0) || class_name == gen_base_function_class_name())) {
+    // objects are created and destroyed for every request and update, so their memory is reused
+    result +=
+        "  static void *operator new(std::size_t size) {\n"
+        "    return TlObjectPool::allocate(size);\n"
+        "  }\n\n"
+        "  static void operator delete(void *ptr, std::size_t size) {\n"
+        "    TlObjectPool::deallocate(ptr, size);\n"
+        "  }\n";
+  }
+  return result;
 }
 
 std::string TD_TL_writer_h::gen_class_end() const {
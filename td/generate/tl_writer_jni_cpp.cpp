@@ -295,17 +295,16 @@ std::string TD_TL_writer_jni_cpp::gen_type_store(const std::string &field_name,
     if (storer_type == 1) {
       res = "s.store_field(\"" + get_pretty_field_name(field_name) + "\", " + field_name + ");";
     } else if (name == "Bool") {
-      res = "env->SetBooleanField(s, " + field_name + "fieldID, " + field_name + ");";
+      // the object is created by AllocObject, so all its fields are already zero-initialized
+      res = "if (" + field_name + ") { env->SetBooleanField(s, " + field_name + "fieldID, JNI_TRUE); }";
     } else if (name == "Int32") {
-      res = "env->SetIntField(s, " + field_name + "fieldID, " + field_name + ");";
+      res = "if (" + field_name + " != 0) { env->SetIntField(s, " + field_name + "fieldID, " + field_name + "); }";
     } else if (name == "Int53" || name == "Int64") {
-      res = "env->SetLongField(s, " + field_name + "fieldID, " + field_name + ");";
+      res = "if (" + field_name + " != 0) { env->SetLongField(s, " + field_name + "fieldID, " + field_name + "); }";
     } else if (name == "Double") {
       res = "env->SetDoubleField(s, " + field_name + "fieldID, " + field_name + ");";
     } else if (name == "String") {
-      res = "{ jstring nextString = jni::to_jstring(env, " + field_name +
-            "); if (nextString) { env->SetObjectField(s, " + field_name +
-            "fieldID, nextString); env->DeleteLocalRef(nextString); } }";
+      res = "jni::set_string_field(env, s, " + field_name + "fieldID, " + field_name + ");";
     } else {
       assert(false);
     }
@@ -313,9 +312,7 @@ std::string TD_TL_writer_jni_cpp::gen_type_store(const std::string &field_name,
     if (storer_type == 1) {
       res = "s.store_bytes_field(\"" + get_pretty_field_name(field_name) + "\", " + field_name + ");";
     } else {
-      res = "{ jbyteArray nextBytes = jni::to_bytes(env, " + field_name +
-            "); if (nextBytes) { env->SetObjectField(s, " + field_name +
-            "fieldID, nextBytes); env->DeleteLocalRef(nextBytes); } }";
+      res = "jni::set_bytes_field(env, s, " + field_name + "fieldID, " + field_name + ");";
     }
   } else if (name == "Vector") {
     const tl::tl_tree_type *child = static_cast<const tl::tl_tree_type *>(tree_type->children[0]);
@@ -13,8 +13,43 @@
 #include "td/utils/Status.h"
 #include "td/utils/UInt.h"
 
+#include <map>
+#include <mutex>
+
 namespace td {
 
+namespace {
+struct PrecomputedGB {
+  BigNum b;
+  BigNum g_b;
+};
+
+struct PrecomputedValues {
+  static constexpr size_t MAX_CONFIG_COUNT = 4;
+  static constexpr size_t MAX_VALUE_COUNT = 4;
+
+  std::mutex mutex;
+  std::map<std::pair<int32, string>, vector<PrecomputedGB>> values;
+};
+
+PrecomputedValues &get_precomputed_values() {
+  static PrecomputedValues precomputed_values;
+  return precomputed_values;
+}
+
+struct MontgomeryContexts {
+  static constexpr size_t MAX_PRIME_COUNT = 8;
+
+  std::mutex mutex;
+  std::map<string, std::shared_ptr<const BigNumMontgomeryContext>> contexts;
+};
+
+MontgomeryContexts &get_montgomery_contexts() {
+  static MontgomeryContexts montgomery_contexts;
+  return montgomery_contexts;
+}
+}  // namespace
+
 Status DhHandshake::check_config(Slice prime_str, const BigNum &prime, int32 g_int, BigNumContext &ctx,
                                  DhCallback *callback) {
   // check that 2^2047 <= p < 2^2048
@@ -126,17 +161,98 @@ void DhHandshake::set_config(int32 g_int, Slice prime_str) {
   has_config_ = true;
   prime_ = BigNum::from_binary(prime_str);
   prime_str_ = prime_str.str();
+  prime_context_ = nullptr;
 
   b_ = BigNum();
   g_b_ = BigNum();
 
-  BigNum::random(b_, 2048, -1, 0);
-
   // g^b
   g_int_ = g_int;
   g_.set_value(g_int_);
 
-  BigNum::mod_exp(g_b_, g_, b_, prime_, ctx_);
+  if (get_precomputed_g_b(g_int_, prime_str_, b_, g_b_)) {
+    return;
+  }
+
+  BigNum::random(b_, 2048, -1, 0);
+  BigNum::mod_exp(g_b_, g_, b_, get_prime_context(), ctx_);
+}
+
+std::shared_ptr<const BigNumMontgomeryContext> DhHandshake::get_montgomery_context(const string &prime_str) {
+  auto &montgomery_contexts = get_montgomery_contexts();
+  {
+    std::lock_guard<std::mutex> lock(montgomery_contexts.mutex);
+    auto it = montgomery_contexts.contexts.find(prime_str);
+    if (it != montgomery_contexts.contexts.end()) {
+      return it->second;
+    }
+  }
+
+  BigNumContext ctx;
+  auto context = std::make_shared<const BigNumMontgomeryContext>(BigNum::from_binary(prime_str), ctx);
+
+  std::lock_guard<std::mutex> lock(montgomery_contexts.mutex);
+  if (montgomery_contexts.contexts.size() < MontgomeryContexts::MAX_PRIME_COUNT) {
+    montgomery_contexts.contexts.emplace(prime_str, context);
+  }
+  return context;
+}
+
+const BigNumMontgomeryContext &DhHandshake::get_prime_context() {
+  if (prime_context_ == nullptr) {
+    prime_context_ = get_montgomery_context(prime_str_);
+  }
+  return *prime_context_;
+}
+
+bool DhHandshake::get_precomputed_g_b(int32 g_int, const string &prime_str, BigNum &b, BigNum &g_b) {
+  auto &precomputed_values = get_precomputed_values();
+  std::lock_guard<std::mutex> lock(precomputed_values.mutex);
+  auto it = precomputed_values.values.find(std::make_pair(g_int, prime_str));
+  if (it == precomputed_values.values.end() || it->second.empty()) {
+    return false;
+  }
+  b = std::move(it->second.back().b);
+  g_b = std::move(it->second.back().g_b);
+  it->second.pop_back();
+  return true;
+}
+
+void DhHandshake::add_used_config(int32 g_int, const string &prime_str) {
+  auto &precomputed_values = get_precomputed_values();
+  std::lock_guard<std::mutex> lock(precomputed_values.mutex);
+  if (precomputed_values.values.size() < PrecomputedValues::MAX_CONFIG_COUNT) {
+    precomputed_values.values.emplace(std::make_pair(g_int, prime_str), vector<PrecomputedGB>());
+  }
+}
+
+void DhHandshake::precompute_g_b() {
+  auto &precomputed_values = get_precomputed_values();
+  vector<std::pair<int32, string>> configs;
+  {
+    std::lock_guard<std::mutex> lock(precomputed_values.mutex);
+    for (auto &it : precomputed_values.values) {
+      for (auto i = it.second.size(); i < PrecomputedValues::MAX_VALUE_COUNT; i++) {
+        configs.push_back(it.first);
+      }
+    }
+  }
+
+  BigNumContext ctx;
+  for (auto &config : configs) {
+    // values are computed without the lock to not block handshakes
+    PrecomputedGB value;
+    BigNum g;
+    g.set_value(config.first);
+    BigNum::random(value.b, 2048, -1, 0);
+    BigNum::mod_exp(value.g_b, g, value.b, *get_montgomery_context(config.second), ctx);
+
+    std::lock_guard<std::mutex> lock(precomputed_values.mutex);
+    auto it = precomputed_values.values.find(config);
+    if (it != precomputed_values.values.end() && it->second.size() < PrecomputedValues::MAX_VALUE_COUNT) {
+      it->second.push_back(std::move(value));
+    }
+  }
 }
 
 Status DhHandshake::check_config(int32 g_int, Slice prime_str, DhCallback *callback) {
@@ -188,7 +304,9 @@ Status DhHandshake::run_checks(bool skip_config_check, DhCallback *callback) {
     TRY_STATUS(check_config(prime_str_, prime_, g_int_, ctx_, callback));
   }
 
-  return dh_check(prime_, g_a_, g_b_);
+  TRY_STATUS(dh_check(prime_, g_a_, g_b_));
+  add_used_config(g_int_, prime_str_);
+  return Status::OK();
 }
 
 BigNum DhHandshake::get_g() const {
@@ -209,7 +327,7 @@ BigNum DhHandshake::get_b() const {
 BigNum DhHandshake::get_g_ab() {
   CHECK(has_g_a_ && has_config_);
   BigNum g_ab;
-  BigNum::mod_exp(g_ab, g_a_, b_, prime_, ctx_);
+  BigNum::mod_exp(g_ab, g_a_, b_, get_prime_context(), ctx_);
   return g_ab;
 }
 
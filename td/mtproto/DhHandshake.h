@@ -11,6 +11,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <memory>
 #include <utility>
 
 namespace td {
@@ -58,6 +59,12 @@ class DhHandshake {
 
   static int64 calc_key_id(Slice auth_key);
 
+  // precomputes g^b for next handshakes with previously used DH configs; can be called from any thread
+  static void precompute_g_b();
+
+  // returns cached Montgomery context for the prime; can be called from any thread
+  static std::shared_ptr<const BigNumMontgomeryContext> get_montgomery_context(const string &prime_str);
+
   enum Flags { HasConfig = 1, HasGA = 2 };
 
   template <class StorerT>
@@ -95,6 +102,7 @@ class DhHandshake {
       // prime_, prime_str_, b_, g_, g_int_, g_b_
       prime_str_ = parser.template fetch_string<std::string>();
       prime_ = BigNum::from_binary(prime_str_);
+      prime_context_ = nullptr;
 
       b_ = BigNum::from_binary(parser.template fetch_string<string>());
 
@@ -114,8 +122,15 @@ class DhHandshake {
 
   static Status dh_check(const BigNum &prime, const BigNum &g_a, const BigNum &g_b) TD_WARN_UNUSED_RESULT;
 
+  static bool get_precomputed_g_b(int32 g_int, const string &prime_str, BigNum &b, BigNum &g_b);
+
+  static void add_used_config(int32 g_int, const string &prime_str);
+
+  const BigNumMontgomeryContext &get_prime_context();
+
   string prime_str_;
   BigNum prime_;
+  std::shared_ptr<const BigNumMontgomeryContext> prime_context_;
   BigNum g_;
   int32 g_int_;
   BigNum b_;
@@ -36,7 +36,7 @@ Result<size_t> Transport::read_next(BufferSlice *message, uint32 *quick_ack) {
     return Status::Error("Wrong response");
   }
   *message = std::move(http_query_.container_[1]);
-  turn_ = Write;
+  pending_response_count_--;
   return 0;
 }
 
@@ -75,15 +75,15 @@ void Transport::write(BufferWriter &&message, bool quick_ack) {
   dst.substr(dst.size() - src.size()).copy_from(src);
   message.confirm_prepend(src.size());
   output_->append(message.as_buffer_slice());
-  turn_ = Read;
+  pending_response_count_++;
 }
 
 bool Transport::can_read() const {
-  return turn_ == Read;
+  return pending_response_count_ > 0;
 }
 
 bool Transport::can_write() const {
-  return turn_ == Write;
+  return pending_response_count_ < MAX_PIPELINED_REQUEST_COUNT;
 }
 
 size_t Transport::max_prepend_size() const {
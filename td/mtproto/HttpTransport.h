@@ -50,7 +50,11 @@ class Transport : public IStreamTransport {
   HttpReader reader_;
   HttpQuery http_query_;
   ChainBufferWriter *output_;
-  enum { Write, Read } turn_ = Write;
+
+  // HTTP/1.1 pipelining: the next request is sent over the keep-alive connection without waiting for the response
+  // to the previous one, so there is no idle round trip between long polling requests or between outgoing containers
+  static constexpr size_t MAX_PIPELINED_REQUEST_COUNT = 2;
+  size_t pending_response_count_ = 0;
 };
 
 }  // namespace http
@@ -19,6 +19,7 @@ struct MtprotoQuery {
   bool gzip_flag;
   uint64 invoke_after_id;
   bool use_quick_ack;
+  double enqueued_at;
 };
 
 }  // namespace mtproto
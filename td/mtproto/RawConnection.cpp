@@ -82,6 +82,7 @@ Status RawConnection::flush_read(const AuthKey &auth_key, Callback &callback) {
       if (wait_size > MAX_PACKET_SIZE) {
         return Status::Error(PSLICE() << "Expected packet size is too big: " << wait_size);
       }
+      socket_fd_.set_read_size_hint(wait_size);
       break;
     }
 
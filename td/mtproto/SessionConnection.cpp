@@ -29,6 +29,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <mutex>
 #include <type_traits>
 
 namespace td {
@@ -346,6 +347,7 @@ Status SessionConnection::on_packet(const MsgInfo &info,
       LOG(WARNING) << bad_info << ": MessageId is too high. Session will be closed";
       // All this queries will be re-sent by parent
       to_send_.clear();
+      to_send_size_ = 0;
       callback_->on_session_failed(Status::Error("MessageId is too high"));
       return Status::Error("MessageId is too high");
     }
@@ -617,7 +619,7 @@ bool SessionConnection::must_flush_packet() {
   }
   // queries and acks (+ resend & get_info)
   if (has_salt && force_send_at_ != 0) {
-    if (Time::now_cached() > force_send_at_) {
+    if (Time::now_cached() >= force_send_at_) {
       return true;
     } else {
       relax_timeout_at(&flush_packet_at_, force_send_at_);
@@ -758,11 +760,16 @@ Result<uint64> SessionConnection::send_query(BufferSlice buffer, bool gzip_flag,
   }
   auto seq_no = auth_data_->next_seq_no(true);
   if (to_send_.empty()) {
-    send_before(Time::now_cached() + QUERY_DELAY);
+    send_before(Time::now_cached() + packing_policy_.max_delay);
   }
-  to_send_.push_back(MtprotoQuery{message_id, seq_no, std::move(buffer), gzip_flag, invoke_after_id, use_quick_ack});
+  to_send_size_ += buffer.size();
+  to_send_.push_back(MtprotoQuery{message_id, seq_no, std::move(buffer), gzip_flag, invoke_after_id, use_quick_ack,
+                                  Time::now_cached()});
   VLOG(mtproto) << "Invoke query " << message_id << " of size " << to_send_.back().packet.size() << " with seq_no "
                 << seq_no << " after " << invoke_after_id << (use_quick_ack ? " with quick ack" : "");
+  if (to_send_.size() >= packing_policy_.max_query_count || to_send_size_ >= packing_policy_.max_size) {
+    send_before(Time::now_cached());
+  }
 
   return message_id;
 }
@@ -803,7 +810,7 @@ std::pair<uint64, BufferSlice> SessionConnection::encrypted_bind(int64 perm_key,
   CHECK(size == real_size);
 
   MtprotoQuery query{
-      auth_data_->next_message_id(Time::now_cached()), 0, object_packet.as_buffer_slice(), false, 0, false};
+      auth_data_->next_message_id(Time::now_cached()), 0, object_packet.as_buffer_slice(), false, 0, false, 0.0};
   PacketStorer<QueryImpl> query_storer(query, Slice());
 
   PacketInfo info;
@@ -881,14 +888,16 @@ void SessionConnection::flush_packet() {
   }
 
   size_t send_till = 0, send_size = 0;
-  // send at most 1020 queries, of total size 2^15
+  // send at most MAX_CONTAINER_QUERY_COUNT queries, of total size MAX_CONTAINER_SIZE
   // don't send anything if have no salt
   if (has_salt) {
-    while (send_till < to_send_.size() && send_till < 1020 && send_size < (1 << 15)) {
+    while (send_till < to_send_.size() && send_till < MAX_CONTAINER_QUERY_COUNT && send_size < MAX_CONTAINER_SIZE) {
       send_size += to_send_[send_till].packet.size();
       send_till++;
     }
   }
+  CHECK(send_size <= to_send_size_);
+  to_send_size_ -= send_size;
   std::vector<MtprotoQuery> queries;
   if (send_till == to_send_.size()) {
     queries = std::move(to_send_);
@@ -927,13 +936,17 @@ void SessionConnection::flush_packet() {
   // no more than 8192 ids per container..
   auto to_resend_answer = cut_tail(to_resend_answer_, 8192, "resend_answer");
   uint64 resend_answer_id = 0;
-  CHECK(queries.size() <= 1020);
-  auto to_cancel_answer = cut_tail(to_cancel_answer_, 1020 - queries.size(), "cancel_answer");
+  CHECK(queries.size() <= MAX_CONTAINER_QUERY_COUNT);
+  auto to_cancel_answer = cut_tail(to_cancel_answer_, MAX_CONTAINER_QUERY_COUNT - queries.size(), "cancel_answer");
   auto to_get_state_info = cut_tail(to_get_state_info_, 8192, "get_state_info");
   uint64 get_state_info_id = 0;
   auto to_ack = cut_tail(to_ack_, 8192, "ack");
   uint64 ping_message_id = 0;
 
+  if (!queries.empty()) {
+    on_packet_sent(queries, send_size);
+  }
+
   bool use_quick_ack =
       std::any_of(queries.begin(), queries.end(), [](const auto &query) { return query.use_quick_ack; });
 
@@ -984,6 +997,46 @@ void SessionConnection::flush_packet() {
   }
 }
 
+void SessionConnection::set_packing_policy(const PackingPolicy &policy) {
+  packing_policy_ = policy;
+  packing_policy_.max_delay = clamp(packing_policy_.max_delay, 0.0, 1.0);
+  if (!to_send_.empty() &&
+      (to_send_.size() >= packing_policy_.max_query_count || to_send_size_ >= packing_policy_.max_size)) {
+    send_before(Time::now_cached());
+  }
+}
+
+namespace {
+std::mutex packing_stats_mutex;
+SessionConnection::PackingStats packing_stats;
+}  // namespace
+
+SessionConnection::PackingStats SessionConnection::get_packing_stats(bool reset) {
+  std::lock_guard<std::mutex> lock(packing_stats_mutex);
+  auto result = packing_stats;
+  if (reset) {
+    packing_stats = PackingStats();
+  }
+  return result;
+}
+
+void SessionConnection::on_packet_sent(const vector<MtprotoQuery> &queries, size_t size) {
+  double total_send_delay = 0;
+  double max_send_delay = 0;
+  for (auto &query : queries) {
+    auto send_delay = max(Time::now_cached() - query.enqueued_at, 0.0);
+    total_send_delay += send_delay;
+    max_send_delay = max(max_send_delay, send_delay);
+  }
+
+  std::lock_guard<std::mutex> lock(packing_stats_mutex);
+  packing_stats.packet_count++;
+  packing_stats.query_count += queries.size();
+  packing_stats.query_size += size;
+  packing_stats.total_send_delay += total_send_delay;
+  packing_stats.max_send_delay = max(packing_stats.max_send_delay, max_send_delay);
+}
+
 void SessionConnection::send_before(double tm) {
   if (force_send_at_ == 0 || force_send_at_ > tm) {
     force_send_at_ = tm;
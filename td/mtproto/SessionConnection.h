@@ -87,6 +87,29 @@ class SessionConnection
 
   void set_online(bool online_flag, bool is_main);
 
+  static constexpr size_t MAX_CONTAINER_SIZE = 1 << 15;
+  static constexpr size_t MAX_CONTAINER_QUERY_COUNT = 1020;
+
+  // determines how long queries wait to be sent together with other queries
+  struct PackingPolicy {
+    // the maximum time in seconds a query waits for other queries; 0 to send queries as soon as possible
+    double max_delay = 0.001;
+    // queries are sent without waiting for max_delay as soon as their total size or number reaches the limits
+    size_t max_size = MAX_CONTAINER_SIZE;
+    size_t max_query_count = MAX_CONTAINER_QUERY_COUNT;
+  };
+  void set_packing_policy(const PackingPolicy &policy);
+
+  // statistics about sent packets with queries, shared by all connections
+  struct PackingStats {
+    uint64 packet_count = 0;
+    uint64 query_count = 0;
+    uint64 query_size = 0;
+    double total_send_delay = 0;
+    double max_send_delay = 0;
+  };
+  static PackingStats get_packing_stats(bool reset);
+
   // Callback
   class Callback {
    public:
@@ -125,7 +148,6 @@ class SessionConnection
 
  private:
   static constexpr int ACK_DELAY = 30;                  // 30s
-  static constexpr double QUERY_DELAY = 0.001;          // 0.001s
   static constexpr double RESEND_ANSWER_DELAY = 0.001;  // 0.001s
 
   bool online_flag_ = false;
@@ -159,6 +181,8 @@ class SessionConnection
   static constexpr int TEMP_KEY_TIMEOUT = 60 * 60 * 24;  // one day
 
   vector<MtprotoQuery> to_send_;
+  size_t to_send_size_ = 0;
+  PackingPolicy packing_policy_;
   vector<int64> to_ack_;
   double force_send_at_ = 0;
 
@@ -256,6 +280,7 @@ class SessionConnection
   void send_ack(uint64 message_id);
   void send_crypto(const Storer &storer, uint64 quick_ack_token);
   void send_before(double tm);
+  void on_packet_sent(const vector<MtprotoQuery> &queries, size_t size);
   bool may_ping() const;
   bool must_ping() const;
   bool must_flush_packet();
@@ -227,7 +227,7 @@ void ObfuscatedTransport::do_write_main(BufferWriter &&message) {
     builder.prepend(header_);
     header_ = {};
   }
-  do_write(builder.extract());
+  do_write(std::move(builder));
 }
 
 void ObfuscatedTransport::do_write_tls(BufferWriter &&message) {
@@ -269,11 +269,13 @@ void ObfuscatedTransport::do_write_tls(BufferBuilder &&builder) {
     builder.prepend(first_prefix);
   }
 
-  do_write(builder.extract());
+  do_write(std::move(builder));
 }
 
-void ObfuscatedTransport::do_write(BufferSlice &&slice) {
-  output_->append(std::move(slice));
+void ObfuscatedTransport::do_write(BufferBuilder &&builder) {
+  // pass all parts to the output chain as is to avoid copying of the already encrypted payload,
+  // which would be needed to merge them into a single BufferSlice
+  std::move(builder).for_each([&](BufferSlice &&slice) { output_->append(std::move(slice)); });
 }
 
 }  // namespace tcp
@@ -199,7 +199,7 @@ class ObfuscatedTransport : public IStreamTransport {
   void do_write_tls(BufferWriter &&message);
   void do_write_tls(BufferBuilder &&builder);
   void do_write_main(BufferWriter &&message);
-  void do_write(BufferSlice &&message);
+  void do_write(BufferBuilder &&builder);
 };
 
 using Transport = ObfuscatedTransport;
@@ -19,6 +19,8 @@
 #include "td/utils/MpscPollableQueue.h"
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 #include <atomic>
@@ -100,6 +102,20 @@ class ClientManager::Impl final {
     requests_.push_back({client_id, request_id, std::move(request)});
   }
 
+  void send_batch(ClientId client_id, vector<std::pair<RequestId, td_api::object_ptr<td_api::Function>>> &&requests) {
+    for (auto &request : requests) {
+      send(client_id, request.first, std::move(request.second));
+    }
+  }
+
+  void set_receive_shard_count(int32 shard_count) {
+    // there is only one thread, so all responses are received from the same queue
+  }
+
+  Response receive_shard(int32 shard_id, double timeout) {
+    return receive(timeout);
+  }
+
   Response receive(double timeout) {
     if (!requests_.empty()) {
       for (size_t i = 0; i < requests_.size(); i++) {
@@ -249,7 +265,16 @@ class MultiTd : public Actor {
             td_api::object_ptr<td_api::Function> &&request) {
     auto &td = tds_[client_id];
     CHECK(!td.empty());
-    send_closure(td, &Td::request, request_id, std::move(request));
+    send_closure_urgent(td, &Td::request, request_id, std::move(request));
+  }
+
+  void send_batch(ClientManager::ClientId client_id,
+                  vector<std::pair<ClientManager::RequestId, td_api::object_ptr<td_api::Function>>> &&requests) {
+    auto &td = tds_[client_id];
+    CHECK(!td.empty());
+    for (auto &request : requests) {
+      send_closure_urgent(td, &Td::request, request.first, std::move(request.second));
+    }
   }
 
   void close(int32 td_id) {
@@ -338,22 +363,38 @@ class TdReceiver {
 
 class MultiImpl {
  public:
-  explicit MultiImpl(std::shared_ptr<NetQueryStats> net_query_stats) {
+  // the first td_thread_count schedulers run MultiTd actors, the next worker_thread_count schedulers are shared by them
+  MultiImpl(std::shared_ptr<NetQueryStats> net_query_stats, int32 td_thread_count, int32 worker_thread_count,
+            int32 first_cpu_id, bool balance_load) {
+    CHECK(td_thread_count > 0);
     concurrent_scheduler_ = std::make_shared<ConcurrentScheduler>();
-    concurrent_scheduler_->init(3);
+    concurrent_scheduler_->init(td_thread_count - 1 + worker_thread_count, balance_load);
+    if (first_cpu_id >= 0) {
+      concurrent_scheduler_->pin_threads_to_cpus(first_cpu_id);
+    }
     concurrent_scheduler_->start();
 
     {
       auto guard = concurrent_scheduler_->get_main_guard();
-      Td::Options options;
-      options.net_query_stats = std::move(net_query_stats);
-      multi_td_ = create_actor<MultiTd>("MultiTd", std::move(options));
+      for (int32 i = 0; i < td_thread_count; i++) {
+        Td::Options options;
+        options.net_query_stats = net_query_stats;
+        options.worker_scheduler_id = td_thread_count;
+        multi_tds_.push_back(create_actor_on_scheduler<MultiTd>("MultiTd", i, std::move(options)));
+      }
     }
 
     scheduler_thread_ = thread([concurrent_scheduler = concurrent_scheduler_] {
       while (concurrent_scheduler->run_main(10)) {
       }
     });
+    if (first_cpu_id >= 0) {
+      auto cpu_id = static_cast<int32>(first_cpu_id % thread::hardware_concurrency());
+      auto status = scheduler_thread_.set_cpu_affinity(cpu_id);
+      if (status.is_error()) {
+        LOG(ERROR) << "Failed to pin main scheduler thread to CPU " << cpu_id << ": " << status;
+      }
+    }
   }
   MultiImpl(const MultiImpl &) = delete;
   MultiImpl &operator=(const MultiImpl &) = delete;
@@ -368,7 +409,7 @@ class MultiImpl {
 
   void create(int32 td_id, unique_ptr<TdCallback> callback) {
     auto guard = concurrent_scheduler_->get_send_guard();
-    send_closure(multi_td_, &MultiTd::create, td_id, std::move(callback));
+    send_closure(get_multi_td(td_id), &MultiTd::create, td_id, std::move(callback));
   }
 
   static bool is_valid_client_id(int32 client_id) {
@@ -378,18 +419,24 @@ class MultiImpl {
   void send(ClientManager::ClientId client_id, ClientManager::RequestId request_id,
             td_api::object_ptr<td_api::Function> &&request) {
     auto guard = concurrent_scheduler_->get_send_guard();
-    send_closure(multi_td_, &MultiTd::send, client_id, request_id, std::move(request));
+    send_closure(get_multi_td(client_id), &MultiTd::send, client_id, request_id, std::move(request));
+  }
+
+  void send_batch(ClientManager::ClientId client_id,
+                  vector<std::pair<ClientManager::RequestId, td_api::object_ptr<td_api::Function>>> &&requests) {
+    auto guard = concurrent_scheduler_->get_send_guard();
+    send_closure(get_multi_td(client_id), &MultiTd::send_batch, client_id, std::move(requests));
   }
 
   void close(ClientManager::ClientId client_id) {
     auto guard = concurrent_scheduler_->get_send_guard();
-    send_closure(multi_td_, &MultiTd::close, client_id);
+    send_closure(get_multi_td(client_id), &MultiTd::close, client_id);
   }
 
   ~MultiImpl() {
     {
       auto guard = concurrent_scheduler_->get_send_guard();
-      multi_td_.reset();
+      multi_tds_.clear();
       Scheduler::instance()->finish();
     }
     scheduler_thread_.join();
@@ -401,21 +448,30 @@ class MultiImpl {
  private:
   std::shared_ptr<ConcurrentScheduler> concurrent_scheduler_;
   thread scheduler_thread_;
-  ActorOwn<MultiTd> multi_td_;
+  vector<ActorOwn<MultiTd>> multi_tds_;
 
   static std::atomic<uint32> current_id_;
+
+  ActorId<MultiTd> get_multi_td(int32 td_id) const {
+    return multi_tds_[static_cast<uint32>(td_id) % multi_tds_.size()].get();
+  }
 };
 
 std::atomic<uint32> MultiImpl::current_id_{1};
 
 class MultiImplPool {
  public:
+  static void set_thread_topology(const ClientManager::ThreadTopology &topology) {
+    std::lock_guard<std::mutex> lock(topology_mutex_);
+    topology_ = topology;
+  }
+
   std::shared_ptr<MultiImpl> get() {
     std::unique_lock<std::mutex> lock(mutex_);
     if (impls_.empty()) {
       init_openssl_threads();
 
-      impls_.resize(clamp(thread::hardware_concurrency(), 8u, 1000u) * 5 / 4);
+      init_topology();
 
       net_query_stats_ = std::make_shared<NetQueryStats>();
     }
@@ -423,7 +479,14 @@ class MultiImplPool {
                                    [](auto &a, auto &b) { return a.lock().use_count() < b.lock().use_count(); });
     auto result = impl.lock();
     if (!result) {
-      result = std::make_shared<MultiImpl>(net_query_stats_);
+      int32 first_cpu_id = -1;
+      if (pin_threads_to_cpus_) {
+        first_cpu_id = next_cpu_id_;
+        next_cpu_id_ = static_cast<int32>((next_cpu_id_ + td_thread_count_ + worker_thread_count_) %
+                                          thread::hardware_concurrency());
+      }
+      result = std::make_shared<MultiImpl>(net_query_stats_, td_thread_count_, worker_thread_count_, first_cpu_id,
+                                           balance_load_);
       impl = result;
     }
     return result;
@@ -448,11 +511,53 @@ class MultiImplPool {
   }
 
  private:
+  static constexpr int32 DEFAULT_WORKER_THREAD_COUNT = 3;
+
+  static std::mutex topology_mutex_;
+  static ClientManager::ThreadTopology topology_;
+
   std::mutex mutex_;
   std::vector<std::weak_ptr<MultiImpl>> impls_;
   std::shared_ptr<NetQueryStats> net_query_stats_;
+  int32 td_thread_count_ = 1;
+  int32 worker_thread_count_ = DEFAULT_WORKER_THREAD_COUNT;
+  bool pin_threads_to_cpus_ = false;
+  bool balance_load_ = false;
+  int32 next_cpu_id_ = 0;
+
+  void init_topology() {
+    ClientManager::ThreadTopology topology;
+    {
+      std::lock_guard<std::mutex> lock(topology_mutex_);
+      topology = topology_;
+    }
+
+    int32 instance_count = topology.instance_count;
+    if (instance_count <= 0) {
+      instance_count = static_cast<int32>(clamp(thread::hardware_concurrency(), 8u, 1000u) * 5 / 4);
+    }
+    worker_thread_count_ =
+        topology.threads_per_instance > 0 ? topology.threads_per_instance : DEFAULT_WORKER_THREAD_COUNT;
+    pin_threads_to_cpus_ = topology.pin_threads_to_cpus;
+    balance_load_ = topology.balance_load;
+    next_cpu_id_ = 0;
+    if (topology.share_auxiliary_threads) {
+      td_thread_count_ = instance_count;
+      impls_.resize(1);
+    } else {
+      td_thread_count_ = 1;
+      impls_.resize(instance_count);
+    }
+
+    LOG(INFO) << "Use " << impls_.size() << " thread groups with " << td_thread_count_ << " client and "
+              << worker_thread_count_ << " auxiliary threads each" << (pin_threads_to_cpus_ ? " pinned to CPUs" : "")
+              << (balance_load_ ? " with load balancing" : "");
+  }
 };
 
+std::mutex MultiImplPool::topology_mutex_;
+ClientManager::ThreadTopology MultiImplPool::topology_;
+
 class ClientManager::Impl final {
  public:
   ClientId create_client_id() {
@@ -465,11 +570,33 @@ class ClientManager::Impl final {
   }
 
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request) {
+    send_impl(
+        client_id, [&](MultiImpl *impl) { impl->send(client_id, request_id, std::move(request)); },
+        [&](int32 error_code, Slice error_message) {
+          get_receiver(client_id).add_response(client_id, request_id,
+                                               td_api::make_object<td_api::error>(error_code, error_message.str()));
+        });
+  }
+
+  void send_batch(ClientId client_id, vector<std::pair<RequestId, td_api::object_ptr<td_api::Function>>> &&requests) {
+    if (requests.empty()) {
+      return;
+    }
+    send_impl(
+        client_id, [&](MultiImpl *impl) { impl->send_batch(client_id, std::move(requests)); },
+        [&](int32 error_code, Slice error_message) {
+          for (auto &request : requests) {
+            get_receiver(client_id).add_response(client_id, request.first,
+                                                 td_api::make_object<td_api::error>(error_code, error_message.str()));
+          }
+        });
+  }
+
+  template <class SendT, class FailT>
+  void send_impl(ClientId client_id, SendT &&send_f, FailT &&fail_f) {
     auto lock = impls_mutex_.lock_read().move_as_ok();
     if (!MultiImpl::is_valid_client_id(client_id)) {
-      receiver_.add_response(client_id, request_id,
-                             td_api::make_object<td_api::error>(400, "Invalid TDLib instance specified"));
-      return;
+      return fail_f(400, "Invalid TDLib instance specified");
     }
 
     auto it = impls_.find(client_id);
@@ -480,7 +607,7 @@ class ClientManager::Impl final {
       it = impls_.find(client_id);
       if (it != impls_.end() && it->second.impl == nullptr) {
         it->second.impl = pool_.get();
-        it->second.impl->create(client_id, receiver_.create_callback(client_id));
+        it->second.impl->create(client_id, get_receiver(client_id).create_callback(client_id));
       }
       write_lock.reset();
 
@@ -488,14 +615,34 @@ class ClientManager::Impl final {
       it = impls_.find(client_id);
     }
     if (it == impls_.end() || it->second.is_closed) {
-      receiver_.add_response(client_id, request_id, td_api::make_object<td_api::error>(500, "Request aborted"));
+      return fail_f(500, "Request aborted");
+    }
+    send_f(it->second.impl.get());
+  }
+
+  void set_receive_shard_count(int32 shard_count) {
+    CHECK(shard_count > 0);
+    auto lock = impls_mutex_.lock_write().move_as_ok();
+    if (!impls_.empty()) {
+      LOG(ERROR) << "Can't change receive shard count after a TDLib instance is created";
       return;
     }
-    it->second.impl->send(client_id, request_id, std::move(request));
+    receivers_.clear();
+    for (int32 i = 0; i < shard_count; i++) {
+      receivers_.push_back(make_unique<TdReceiver>());
+    }
   }
 
   Response receive(double timeout) {
-    auto response = receiver_.receive(timeout);
+    return receive_shard(0, timeout);
+  }
+
+  Response receive_shard(int32 shard_id, double timeout) {
+    if (shard_id < 0 || static_cast<size_t>(shard_id) >= receivers_.size()) {
+      LOG(ERROR) << "Receive from invalid shard " << shard_id;
+      return {0, 0, nullptr};
+    }
+    auto response = receivers_[shard_id]->receive(timeout);
     if (response.request_id == 0 && response.object != nullptr &&
         response.object->get_id() == td_api::updateAuthorizationState::ID &&
         static_cast<const td_api::updateAuthorizationState *>(response.object.get())->authorization_state_->get_id() ==
@@ -530,14 +677,16 @@ class ClientManager::Impl final {
     if (!it->second.is_closed) {
       it->second.is_closed = true;
       if (it->second.impl == nullptr) {
-        receiver_.add_response(client_id, 0, nullptr);
+        get_receiver(client_id).add_response(client_id, 0, nullptr);
       } else {
         it->second.impl->close(client_id);
       }
     }
   }
 
-  Impl() = default;
+  Impl() {
+    receivers_.push_back(make_unique<TdReceiver>());
+  }
   Impl(const Impl &) = delete;
   Impl &operator=(const Impl &) = delete;
   Impl(Impl &&) = delete;
@@ -546,11 +695,44 @@ class ClientManager::Impl final {
     if (ExitGuard::is_exited()) {
       return;
     }
+
+    // keep all MultiImpl alive until all clients are closed to destroy them simultaneously afterwards,
+    // instead of destroying them one by one, while the last client of each of them is closed
+    vector<std::shared_ptr<MultiImpl>> multi_impls;
+    for (auto &it : impls_) {
+      if (it.second.impl != nullptr) {
+        multi_impls.push_back(it.second.impl);
+      }
+    }
+    std::sort(multi_impls.begin(), multi_impls.end());
+    multi_impls.erase(std::unique(multi_impls.begin(), multi_impls.end()), multi_impls.end());
+
+    // all clients are closed simultaneously
+    auto client_count = impls_.size();
+    auto start_time = Time::now();
+    auto next_progress_time = start_time + PROGRESS_REPORT_INTERVAL;
     for (auto &it : impls_) {
       close_impl(it.first);
     }
     while (!impls_.empty() && !ExitGuard::is_exited()) {
-      receive(0.1);
+      for (size_t i = 0; i < receivers_.size(); i++) {
+        receive_shard(static_cast<int32>(i), 0.1 / static_cast<double>(receivers_.size()));
+      }
+      auto now = Time::now();
+      if (now >= next_progress_time) {
+        LOG(INFO) << "Closed " << client_count - impls_.size() << " out of " << client_count << " clients in "
+                  << now - start_time << " seconds";
+        next_progress_time = now + PROGRESS_REPORT_INTERVAL;
+      }
+    }
+    if (ExitGuard::is_exited()) {
+      return;
+    }
+
+    destroy_multi_impls(std::move(multi_impls));
+    pool_.try_clear();
+    if (client_count > 0) {
+      LOG(INFO) << "Closed " << client_count << " clients in " << Time::now() - start_time << " seconds";
     }
   }
 
@@ -562,7 +744,32 @@ class ClientManager::Impl final {
     bool is_closed = false;
   };
   std::unordered_map<ClientId, MultiImplInfo> impls_;
-  TdReceiver receiver_;
+  vector<unique_ptr<TdReceiver>> receivers_;  // responses of a client are put to receivers_[client_id % size]
+
+  static constexpr double PROGRESS_REPORT_INTERVAL = 5.0;
+
+  TdReceiver &get_receiver(ClientId client_id) {
+    return *receivers_[static_cast<uint32>(client_id) % receivers_.size()];
+  }
+
+  // destroys MultiImpl in parallel, because destruction of each of them waits for all its threads to finish
+  static void destroy_multi_impls(vector<std::shared_ptr<MultiImpl>> &&multi_impls) {
+    if (multi_impls.size() <= 1) {
+      return;
+    }
+    auto thread_count = min(multi_impls.size(), static_cast<size_t>(max(thread::hardware_concurrency(), 1u)));
+    vector<thread> threads;
+    for (size_t i = 0; i < thread_count; i++) {
+      vector<std::shared_ptr<MultiImpl>> thread_impls;
+      for (size_t j = i; j < multi_impls.size(); j += thread_count) {
+        thread_impls.push_back(std::move(multi_impls[j]));
+      }
+      threads.emplace_back([thread_impls = std::move(thread_impls)]() mutable { reset_to_empty(thread_impls); });
+    }
+    for (auto &worker : threads) {
+      worker.join();
+    }
+  }
 };
 
 class Client::Impl final {
@@ -647,14 +854,33 @@ void ClientManager::send(ClientId client_id, RequestId request_id, td_api::objec
   impl_->send(client_id, request_id, std::move(request));
 }
 
+void ClientManager::send_batch(ClientId client_id,
+                               std::vector<std::pair<RequestId, td_api::object_ptr<td_api::Function>>> &&requests) {
+  impl_->send_batch(client_id, std::move(requests));
+}
+
 ClientManager::Response ClientManager::receive(double timeout) {
   return impl_->receive(timeout);
 }
 
+void ClientManager::set_receive_shard_count(std::int32_t shard_count) {
+  impl_->set_receive_shard_count(shard_count);
+}
+
+ClientManager::Response ClientManager::receive_shard(std::int32_t shard_id, double timeout) {
+  return impl_->receive_shard(shard_id, timeout);
+}
+
 td_api::object_ptr<td_api::Object> ClientManager::execute(td_api::object_ptr<td_api::Function> &&request) {
   return Td::static_request(std::move(request));
 }
 
+void ClientManager::set_thread_topology(const ThreadTopology &topology) {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  MultiImplPool::set_thread_topology(topology);
+#endif
+}
+
 ClientManager::~ClientManager() = default;
 ClientManager::ClientManager(ClientManager &&other) = default;
 ClientManager &ClientManager::operator=(ClientManager &&other) = default;
@@ -13,6 +13,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace td {
 
@@ -201,6 +203,15 @@ class ClientManager final {
    */
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request);
 
+  /**
+   * Sends a batch of requests to TDLib. May be called from any thread. The requests are passed to the TDLib instance
+   * at once and are handled in the specified order. Responses to them are received as usual, one by one.
+   * \param[in] client_id TDLib client instance identifier.
+   * \param[in] requests Requests to TDLib with their identifiers. Request identifiers must be non-zero.
+   */
+  void send_batch(ClientId client_id,
+                  std::vector<std::pair<RequestId, td_api::object_ptr<td_api::Function>>> &&requests);
+
   /**
    * A response to a request, or an incoming update from TDLib.
    */
@@ -230,6 +241,26 @@ class ClientManager final {
    */
   Response receive(double timeout);
 
+  /**
+   * Changes the number of independent queues for incoming updates and request responses. Updates and responses of
+   * a TDLib instance with identifier client_id are put to the queue number client_id % shard_count. Must be called
+   * before the first TDLib instance is created. May be called from any thread.
+   * \param[in] shard_count The number of queues. Must be positive. Defaults to 1.
+   */
+  void set_receive_shard_count(std::int32_t shard_count);
+
+  /**
+   * Receives incoming updates and request responses from TDLib instances, which use the specified queue.
+   * May be called from any thread, but must not be called simultaneously from two different threads for the same
+   * queue. Different queues can be used simultaneously. ClientManager::receive is equivalent to receiving from
+   * the queue 0.
+   * \param[in] shard_id Queue number, from 0 to shard_count - 1.
+   * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+   * \return An incoming update or request response. The object returned in the response may be a nullptr
+   *         if the timeout expires.
+   */
+  Response receive_shard(std::int32_t shard_id, double timeout);
+
   /**
    * Synchronously executes TDLib requests. Only a few requests can be executed synchronously.
    * May be called from any thread.
@@ -238,6 +269,45 @@ class ClientManager final {
    */
   static td_api::object_ptr<td_api::Object> execute(td_api::object_ptr<td_api::Function> &&request);
 
+  /**
+   * Layout of internal threads, which run TDLib client instances.
+   */
+  struct ThreadTopology {
+    /**
+     * Number of thread groups, among which TDLib client instances are distributed. Pass 0 to choose automatically.
+     */
+    std::int32_t instance_count = 0;
+
+    /**
+     * Number of auxiliary threads in each group, used for database access, network and other background work.
+     * Pass 0 to use the default value.
+     */
+    std::int32_t threads_per_instance = 0;
+
+    /**
+     * Pass true to pin every thread to a separate CPU in a round-robin fashion. Supported only on Linux.
+     */
+    bool pin_threads_to_cpus = false;
+
+    /**
+     * Pass true to run all thread groups in a single pool and share a single set of auxiliary threads between them.
+     */
+    bool share_auxiliary_threads = false;
+
+    /**
+     * Pass true to allow idle threads of a group to take over database, binlog and file loading work from overloaded
+     * threads of the same group.
+     */
+    bool balance_load = false;
+  };
+
+  /**
+   * Changes the layout of internal threads. Must be called before the first TDLib client instance is created,
+   * otherwise the new layout will be used only after all existing instances are closed. May be called from any thread.
+   * \param[in] topology The new layout of threads.
+   */
+  static void set_thread_topology(const ThreadTopology &topology);
+
   /**
    * Destroys the client manager and all TDLib client instance managed by it.
    */
@@ -21,7 +21,7 @@ ClientActor::ClientActor(unique_ptr<TdCallback> callback, Options options) {
 }
 
 void ClientActor::request(uint64 id, td_api::object_ptr<td_api::Function> request) {
-  send_closure(td_, &Td::request, id, std::move(request));
+  send_closure_urgent(td_, &Td::request, id, std::move(request));
 }
 
 ClientActor::~ClientActor() = default;
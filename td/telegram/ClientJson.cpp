@@ -13,9 +13,11 @@
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/thread_local.h"
-#include "td/utils/StackAllocator.h"
+#include "td/utils/Slice.h"
 #include "td/utils/StringBuilder.h"
 
+#include <cstring>
+#include <memory>
 #include <utility>
 
 namespace td {
@@ -54,75 +56,129 @@ static std::pair<td_api::object_ptr<td_api::Function>, string> to_request(Slice
   return std::make_pair(std::move(func), std::move(extra));
 }
 
-static string from_response(const td_api::Object &object, const string &extra, int client_id) {
-  auto buf = StackAllocator::alloc(1 << 18);
-  JsonBuilder jb(StringBuilder(buf.as_slice(), true), -1);
+// per-thread buffer for returned responses, which is reused between calls and grows to fit the largest output
+struct JsonOutputBuffer {
+  std::unique_ptr<char[]> data;
+  size_t size = 0;
+};
+
+static TD_THREAD_LOCAL JsonOutputBuffer *current_output;
+
+static MutableSlice get_output_buffer() {
+  init_thread_local<JsonOutputBuffer>(current_output);
+  auto &buffer = *current_output;
+  if (buffer.data == nullptr) {
+    buffer.size = 1 << 18;
+    buffer.data = std::make_unique<char[]>(buffer.size);
+  }
+  return MutableSlice(buffer.data.get(), buffer.size);
+}
+
+// appends null-terminated JSON-serialized object with the fields "@extra" and "@client_id" to the output
+// returns offset of the response in the output
+static size_t append_response(JsonBuilder &jb, const td_api::Object &object, Slice extra, int client_id) {
+  auto &sb = jb.string_builder();
+  auto offset = sb.as_cslice().size();
   jb.enter_value() << ToJson(object);
-  auto slice = jb.string_builder().as_cslice();
-  CHECK(!slice.empty() && slice.back() == '}');
-  string str;
-  str.reserve(slice.size() + (extra.empty() ? 0 : 10 + extra.size()) + (client_id == 0 ? 0 : 14 + 10));
-  str.append(slice.begin(), slice.size() - 1);
+  auto slice = sb.as_cslice();
+  CHECK(slice.size() > offset && slice.back() == '}');
+  sb.pop_back();
   if (!extra.empty()) {
-    str += ",\"@extra\":";
-    str += extra;
+    sb << ",\"@extra\":" << extra;
   }
   if (client_id != 0) {
-    str += ",\"@client_id\":";
-    str += to_string(client_id);
+    sb << ",\"@client_id\":" << client_id;
   }
-  str += '}';
-  return str;
+  sb << '}' << '\0';
+  return offset;
 }
 
-static TD_THREAD_LOCAL string *current_output;
+// returns the beginning of the output, which is valid until the next call in the same thread
+static const char *finish_output(JsonBuilder &jb) {
+  auto &buffer = *current_output;
+  auto &sb = jb.string_builder();
+  CHECK(!sb.is_error());
+  auto slice = sb.as_cslice();
+  if (slice.begin() != buffer.data.get()) {
+    // the output didn't fit and was reallocated by the StringBuilder; enlarge the buffer to avoid this next time
+    buffer.size = slice.size() * 2 + 1;
+    buffer.data = std::make_unique<char[]>(buffer.size);
+    std::memcpy(buffer.data.get(), slice.begin(), slice.size() + 1);
+  }
+  return buffer.data.get();
+}
 
-static const char *store_string(string str) {
-  init_thread_local<string>(current_output);
-  *current_output = std::move(str);
-  return current_output->c_str();
+static const char *store_response(const td_api::Object &object, Slice extra, int client_id) {
+  JsonBuilder jb(StringBuilder(get_output_buffer(), true), -1);
+  append_response(jb, object, extra, client_id);
+  return finish_output(jb);
+}
+
+// identifiers of requests without "@extra" are odd, otherwise they are pointers to the "@extra" string,
+// so "@extra" is returned together with the response without any shared state
+static std::uint64_t get_request_id(std::atomic<std::uint64_t> &next_request_id, string &&extra) {
+  if (extra.empty()) {
+    return next_request_id.fetch_add(2, std::memory_order_relaxed);
+  }
+  auto request_id = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(new string(std::move(extra))));
+  CHECK((request_id & 1) == 0);
+  return request_id;
+}
+
+static string get_request_extra(std::uint64_t request_id) {
+  if (request_id == 0 || (request_id & 1) != 0) {
+    return string();
+  }
+  std::unique_ptr<string> extra(reinterpret_cast<string *>(static_cast<std::uintptr_t>(request_id)));
+  return std::move(*extra);
 }
 
 void ClientJson::send(Slice request) {
   auto parsed_request = to_request(request);
-  std::uint64_t extra_id = extra_id_.fetch_add(1, std::memory_order_relaxed);
-  if (!parsed_request.second.empty()) {
-    std::lock_guard<std::mutex> guard(mutex_);
-    extra_[extra_id] = std::move(parsed_request.second);
-  }
-  client_.send(Client::Request{extra_id, std::move(parsed_request.first)});
+  auto request_id = get_request_id(extra_id_, std::move(parsed_request.second));
+  client_.send(Client::Request{request_id, std::move(parsed_request.first)});
 }
 
 const char *ClientJson::receive(double timeout) {
-  auto response = client_.receive(timeout);
-  if (response.object == nullptr) {
-    return nullptr;
-  }
+  const char *response = nullptr;
+  receive_many(timeout, &response, 1);
+  return response;
+}
 
-  string extra;
-  if (response.id != 0) {
-    std::lock_guard<std::mutex> guard(mutex_);
-    auto it = extra_.find(response.id);
-    if (it != extra_.end()) {
-      extra = std::move(it->second);
-      extra_.erase(it);
+int ClientJson::receive_many(double timeout, const char **responses, int max_count) {
+  JsonBuilder jb(StringBuilder(get_output_buffer(), true), -1);
+  vector<size_t> offsets;
+  while (static_cast<int>(offsets.size()) < max_count) {
+    // wait only for the first response
+    auto response = client_.receive(offsets.empty() ? timeout : 0.0);
+    if (response.object == nullptr) {
+      break;
     }
+
+    auto extra = get_request_extra(response.id);
+    offsets.push_back(append_response(jb, *response.object, extra, 0));
   }
-  return store_string(from_response(*response.object, extra, 0));
+  if (offsets.empty()) {
+    return 0;
+  }
+
+  auto output = finish_output(jb);
+  for (size_t i = 0; i < offsets.size(); i++) {
+    responses[i] = output + offsets[i];
+  }
+  return static_cast<int>(offsets.size());
 }
 
 const char *ClientJson::execute(Slice request) {
   auto parsed_request = to_request(request);
-  return store_string(from_response(*Client::execute(Client::Request{0, std::move(parsed_request.first)}).object,
-                                    parsed_request.second, 0));
+  return store_response(*Client::execute(Client::Request{0, std::move(parsed_request.first)}).object,
+                        parsed_request.second, 0);
 }
 
 static ClientManager *get_manager() {
   return ClientManager::get_manager_singleton();
 }
 
-static std::mutex extra_mutex;
-static std::unordered_map<int64, string> extra;
 static std::atomic<uint64> extra_id{1};
 
 int json_create_client_id() {
@@ -131,11 +187,7 @@ int json_create_client_id() {
 
 void json_send(int client_id, Slice request) {
   auto parsed_request = to_request(request);
-  auto request_id = extra_id.fetch_add(1, std::memory_order_relaxed);
-  if (!parsed_request.second.empty()) {
-    std::lock_guard<std::mutex> guard(extra_mutex);
-    extra[request_id] = std::move(parsed_request.second);
-  }
+  auto request_id = get_request_id(extra_id, std::move(parsed_request.second));
   get_manager()->send(client_id, request_id, std::move(parsed_request.first));
 }
 
@@ -145,22 +197,12 @@ const char *json_receive(double timeout) {
     return nullptr;
   }
 
-  string extra_str;
-  if (response.request_id != 0) {
-    std::lock_guard<std::mutex> guard(extra_mutex);
-    auto it = extra.find(response.request_id);
-    if (it != extra.end()) {
-      extra_str = std::move(it->second);
-      extra.erase(it);
-    }
-  }
-  return store_string(from_response(*response.object, extra_str, response.client_id));
+  return store_response(*response.object, get_request_extra(response.request_id), response.client_id);
 }
 
 const char *json_execute(Slice request) {
   auto parsed_request = to_request(request);
-  return store_string(
-      from_response(*ClientManager::execute(std::move(parsed_request.first)), parsed_request.second, 0));
+  return store_response(*ClientManager::execute(std::move(parsed_request.first)), parsed_request.second, 0);
 }
 
 }  // namespace td
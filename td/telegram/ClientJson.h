@@ -12,9 +12,6 @@
 
 #include <atomic>
 #include <cstdint>
-#include <mutex>
-#include <string>
-#include <unordered_map>
 
 namespace td {
 
@@ -24,12 +21,12 @@ class ClientJson final {
 
   const char *receive(double timeout);
 
+  int receive_many(double timeout, const char **responses, int max_count);
+
   static const char *execute(Slice request);
 
  private:
   Client client_;
-  std::mutex mutex_;  // for extra_
-  std::unordered_map<std::int64_t, std::string> extra_;
   std::atomic<std::uint64_t> extra_id_{1};
 };
 
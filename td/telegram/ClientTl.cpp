@@ -0,0 +1,117 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ClientTl.h"
+
+#include "td/telegram/Client.h"
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+#include "td/utils/ExitGuard.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Slice.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
+
+#include <utility>
+
+namespace td {
+
+static td_api::object_ptr<td_api::Function> get_return_error_function(Slice error_message) {
+  auto error = td_api::make_object<td_api::error>(400, error_message.str());
+  return td_api::make_object<td_api::testReturnError>(std::move(error));
+}
+
+// returns request identifier and the request; the identifier is 0 if the request must be ignored
+static std::pair<uint64, td_api::object_ptr<td_api::Function>> to_request(Slice request) {
+  if (request.size() < sizeof(uint64)) {
+    LOG(ERROR) << "Receive too short request of size " << request.size();
+    return {0, nullptr};
+  }
+
+  TlParser parser(request);
+  auto request_id = static_cast<uint64>(parser.fetch_long());
+  if (request_id == 0) {
+    LOG(ERROR) << "Receive request with zero identifier";
+    return {0, nullptr};
+  }
+
+  auto func = td_api::Function::fetch(parser);
+  parser.fetch_end();
+  auto status = parser.get_status();
+  if (status.is_error() || func == nullptr) {
+    return {request_id, get_return_error_function(PSLICE() << "Failed to parse TL-serialized TDLib request: "
+                                                           << status.message())};
+  }
+  return {request_id, std::move(func)};
+}
+
+// per-thread buffer for returned responses, which is reused between calls and grows to fit the largest output
+static TD_THREAD_LOCAL vector<int64> *current_output;
+
+static Slice store_response(int32 client_id, uint64 request_id, const td_api::Object &object) {
+  TlStorerCalcLength calc_length;
+  calc_length.store_int(client_id);
+  calc_length.store_long(static_cast<int64>(request_id));
+  calc_length.store_int(object.get_id());
+  object.store(calc_length);
+  auto length = calc_length.get_length();
+
+  init_thread_local<vector<int64>>(current_output);
+  auto &buffer = *current_output;
+  // int64 elements guarantee the alignment of the returned response
+  auto buffer_size = (length + sizeof(int64) - 1) / sizeof(int64);
+  if (buffer.size() < buffer_size) {
+    buffer.resize(buffer_size * 2);
+  }
+
+  auto data = reinterpret_cast<unsigned char *>(buffer.data());
+  TlStorerUnsafe storer(data);
+  storer.store_int(client_id);
+  storer.store_long(static_cast<int64>(request_id));
+  storer.store_int(object.get_id());
+  object.store(storer);
+  CHECK(storer.get_buf() == data + length);
+  return Slice(data, length);
+}
+
+// the JSON interface uses ClientManager singleton, so TL-serialized clients need a separate manager
+static ClientManager *get_manager() {
+  static ClientManager client_manager;
+  static ExitGuard exit_guard;
+  return &client_manager;
+}
+
+int tl_create_client_id() {
+  return static_cast<int>(get_manager()->create_client_id());
+}
+
+void tl_send(int client_id, Slice request) {
+  auto parsed_request = to_request(request);
+  if (parsed_request.first == 0) {
+    return;
+  }
+  get_manager()->send(client_id, parsed_request.first, std::move(parsed_request.second));
+}
+
+Slice tl_receive(double timeout) {
+  auto response = get_manager()->receive(timeout);
+  if (!response.object) {
+    return Slice();
+  }
+  return store_response(response.client_id, response.request_id, *response.object);
+}
+
+Slice tl_execute(Slice request) {
+  auto parsed_request = to_request(request);
+  if (parsed_request.first == 0) {
+    return Slice();
+  }
+  return store_response(0, parsed_request.first, *ClientManager::execute(std::move(parsed_request.second)));
+}
+
+}  // namespace td
@@ -0,0 +1,21 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/Slice.h"
+
+namespace td {
+
+int tl_create_client_id();
+
+void tl_send(int client_id, Slice request);
+
+Slice tl_receive(double timeout);
+
+Slice tl_execute(Slice request);
+
+}  // namespace td
@@ -13,7 +13,39 @@
 
 namespace td {
 
+namespace {
+
+struct CachedOptionInfo {
+  const char *name;
+  bool is_boolean;
+};
+
+// must be in the same order as ConfigShared::OptionId
+const CachedOptionInfo CACHED_OPTIONS[] = {{"always_parse_markdown", true},
+                                           {"disable_contact_registered_notifications", true},
+                                           {"disable_sent_scheduled_message_notifications", true},
+                                           {"edit_time_limit", false},
+                                           {"ignore_default_disable_notification", true},
+                                           {"ignore_inline_thumbnails", true},
+                                           {"ignore_platform_restrictions", true},
+                                           {"message_unload_delay", false},
+                                           {"revoke_pm_inbox", true},
+                                           {"revoke_pm_time_limit", false},
+                                           {"revoke_time_limit", false},
+                                           {"update_file_progress_delay_ms", false},
+                                           {"update_file_progress_min_size", false},
+                                           {"use_compact_file_progress_updates", true},
+                                           {"use_quick_ack", true}};
+
+static_assert(sizeof(CACHED_OPTIONS) / sizeof(CACHED_OPTIONS[0]) == static_cast<size_t>(ConfigShared::OptionId::Size),
+              "Wrong number of cached options");
+
+}  // namespace
+
 ConfigShared::ConfigShared(std::shared_ptr<KeyValueSyncInterface> config_pmc) : config_pmc_(std::move(config_pmc)) {
+  for (auto key_value : config_pmc_->get_all()) {
+    update_cached_option(key_value.first, key_value.second);
+  }
 }
 
 void ConfigShared::set_callback(unique_ptr<Callback> callback) {
@@ -102,11 +134,34 @@ string ConfigShared::get_option_string(Slice name, string default_value) const {
   return str_value.substr(1);
 }
 
+const ConfigShared::CachedOption &ConfigShared::get_cached_option(OptionId option_id) const {
+  auto pos = static_cast<size_t>(option_id);
+  CHECK(pos < cached_options_.size());
+  return cached_options_[pos];
+}
+
+bool ConfigShared::get_option_boolean(OptionId option_id, bool default_value) const {
+  auto &option = get_cached_option(option_id);
+  if (!option.has_value.load(std::memory_order_acquire)) {
+    return default_value;
+  }
+  return option.value.load(std::memory_order_relaxed) != 0;
+}
+
+int64 ConfigShared::get_option_integer(OptionId option_id, int64 default_value) const {
+  auto &option = get_cached_option(option_id);
+  if (!option.has_value.load(std::memory_order_acquire)) {
+    return default_value;
+  }
+  return option.value.load(std::memory_order_relaxed);
+}
+
 tl_object_ptr<td_api::OptionValue> ConfigShared::get_option_value(Slice name) const {
   return get_option_value_object(get_option(name));
 }
 
 bool ConfigShared::set_option(Slice name, Slice value) {
+  update_cached_option(name, value);
   if (value.empty()) {
     return config_pmc_->erase(name.str()) != 0;
   } else {
@@ -114,6 +169,34 @@ bool ConfigShared::set_option(Slice name, Slice value) {
   }
 }
 
+void ConfigShared::update_cached_option(Slice name, Slice value) {
+  for (size_t i = 0; i < cached_options_.size(); i++) {
+    if (name != Slice(CACHED_OPTIONS[i].name)) {
+      continue;
+    }
+
+    auto &option = cached_options_[i];
+    bool has_value = false;
+    int64 parsed_value = 0;
+    if (CACHED_OPTIONS[i].is_boolean) {
+      if (value == "Btrue" || value == "Bfalse") {
+        has_value = true;
+        parsed_value = value == "Btrue" ? 1 : 0;
+      }
+    } else if (!value.empty() && value[0] == 'I') {
+      has_value = true;
+      parsed_value = to_integer<int64>(value.substr(1));
+    }
+    if (has_value) {
+      option.value.store(parsed_value, std::memory_order_relaxed);
+    } else if (!value.empty()) {
+      LOG(ERROR) << "Found \"" << value << "\" as a value of option " << name;
+    }
+    option.has_value.store(has_value, std::memory_order_release);
+    return;
+  }
+}
+
 tl_object_ptr<td_api::OptionValue> ConfigShared::get_option_value_object(Slice value) {
   if (value.empty()) {
     return make_tl_object<td_api::optionValueEmpty>();
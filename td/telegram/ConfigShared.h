@@ -13,6 +13,8 @@
 #include "td/utils/common.h"
 #include "td/utils/Slice.h"
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 
@@ -31,6 +33,26 @@ class ConfigShared {
     virtual void on_option_updated(const string &name, const string &value) const = 0;
   };
 
+  // options, which are read on hot paths; their parsed values are cached and can be read without locking
+  enum class OptionId : int32 {
+    AlwaysParseMarkdown,
+    DisableContactRegisteredNotifications,
+    DisableSentScheduledMessageNotifications,
+    EditTimeLimit,
+    IgnoreDefaultDisableNotification,
+    IgnoreInlineThumbnails,
+    IgnorePlatformRestrictions,
+    MessageUnloadDelay,
+    RevokePmInbox,
+    RevokePmTimeLimit,
+    RevokeTimeLimit,
+    UpdateFileProgressDelayMs,
+    UpdateFileProgressMinSize,
+    UseCompactFileProgressUpdates,
+    UseQuickAck,
+    Size
+  };
+
   explicit ConfigShared(std::shared_ptr<KeyValueSyncInterface> config_pmc);
 
   void set_callback(unique_ptr<Callback> callback);
@@ -47,6 +69,9 @@ class ConfigShared {
   int64 get_option_integer(Slice name, int64 default_value = 0) const;
   string get_option_string(Slice name, string default_value = "") const;
 
+  bool get_option_boolean(OptionId option_id, bool default_value = false) const;
+  int64 get_option_integer(OptionId option_id, int64 default_value = 0) const;
+
   tl_object_ptr<td_api::OptionValue> get_option_value(Slice name) const;
 
   static tl_object_ptr<td_api::OptionValue> get_option_value_object(Slice value);
@@ -55,11 +80,21 @@ class ConfigShared {
   std::shared_ptr<KeyValueSyncInterface> config_pmc_;
   unique_ptr<Callback> callback_;
 
+  struct CachedOption {
+    std::atomic<bool> has_value{false};
+    std::atomic<int64> value{0};
+  };
+  std::array<CachedOption, static_cast<size_t>(OptionId::Size)> cached_options_;
+
   bool set_option(Slice name, Slice value);
 
   string get_option(Slice name) const;
 
   void on_option_updated(Slice name) const;
+
+  void update_cached_option(Slice name, Slice value);
+
+  const CachedOption &get_cached_option(OptionId option_id) const;
 };
 
 }  // namespace td
@@ -2158,7 +2158,9 @@ class GetFullUserQuery : public Td::ResultHandler {
   }
 
   void send(tl_object_ptr<telegram_api::InputUser> &&input_user) {
-    send_query(G()->net_query_creator().create(telegram_api::users_getFullUser(std::move(input_user))));
+    auto query = G()->net_query_creator().create(telegram_api::users_getFullUser(std::move(input_user)));
+    query->cache_ttl_ = 0;
+    send_query(std::move(query));
   }
 
   void on_result(uint64 id, BufferSlice packet) override {
@@ -2365,7 +2367,9 @@ class GetFullChannelQuery : public Td::ResultHandler {
 
   void send(ChannelId channel_id, tl_object_ptr<telegram_api::InputChannel> &&input_channel) {
     channel_id_ = channel_id;
-    send_query(G()->net_query_creator().create(telegram_api::channels_getFullChannel(std::move(input_channel))));
+    auto query = G()->net_query_creator().create(telegram_api::channels_getFullChannel(std::move(input_channel)));
+    query->cache_ttl_ = 0;
+    send_query(std::move(query));
   }
 
   void on_result(uint64 id, BufferSlice packet) override {
@@ -2958,6 +2962,8 @@ ContactsManager::ContactsManager(Td *td, ActorShared<> parent) : td_(td), parent
 
   invite_link_info_expire_timeout_.set_callback(on_invite_link_info_expire_timeout_callback);
   invite_link_info_expire_timeout_.set_callback_data(static_cast<void *>(this));
+
+  load_startup_snapshot();
 }
 
 void ContactsManager::tear_down() {
@@ -4323,6 +4329,24 @@ FolderId ContactsManager::get_secret_chat_initial_folder_id(SecretChatId secret_
   return c->initial_folder_id;
 }
 
+void ContactsManager::get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) const {
+  auto add_entry = [&entries](const char *name, size_t count, size_t object_size) {
+    entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(name, static_cast<int64>(count),
+                                                                         static_cast<int64>(count * object_size)));
+  };
+  add_entry("users", users_.size(), sizeof(User));
+  add_entry("full users", users_full_.size(), sizeof(UserFull));
+  add_entry("bot infos", bot_infos_.size(), sizeof(BotInfo));
+  add_entry("basic groups", chats_.size(), sizeof(Chat));
+  add_entry("full basic groups", chats_full_.size(), sizeof(ChatFull));
+  add_entry("supergroups", channels_.size(), sizeof(Channel));
+  add_entry("full supergroups", channels_full_.size(), sizeof(ChannelFull));
+  add_entry("secret chats", secret_chats_.size(), sizeof(SecretChat));
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "contact search index", static_cast<int64>(contacts_hints_.size()),
+      static_cast<int64>(contacts_hints_.get_memory_size())));
+}
+
 UserId ContactsManager::get_my_id() const {
   LOG_IF(ERROR, !my_id_.is_valid()) << "Wrong or unknown my id returned";
   return my_id_;
@@ -7471,11 +7495,33 @@ void ContactsManager::load_user_from_database_impl(UserId user_id, Promise<Unit>
   auto &load_user_queries = load_user_from_database_queries_[user_id];
   load_user_queries.push_back(std::move(promise));
   if (load_user_queries.size() == 1u) {
-    G()->td_db()->get_sqlite_pmc()->get(get_user_database_key(user_id), PromiseCreator::lambda([user_id](string value) {
-                                          send_closure(G()->contacts_manager(),
-                                                       &ContactsManager::on_load_user_from_database, user_id,
-                                                       std::move(value));
-                                        }));
+    if (pending_load_user_from_database_ids_.empty()) {
+      send_closure_later(actor_id(this), &ContactsManager::load_pending_users_from_database);
+    }
+    pending_load_user_from_database_ids_.push_back(user_id);
+  }
+}
+
+void ContactsManager::load_pending_users_from_database() {
+  auto user_ids = std::move(pending_load_user_from_database_ids_);
+  reset_to_empty(pending_load_user_from_database_ids_);
+  if (user_ids.empty()) {
+    return;
+  }
+
+  LOG(INFO) << "Load " << user_ids.size() << " users from database";
+  auto keys = transform(user_ids, get_user_database_key);
+  G()->td_db()->get_sqlite_pmc()->get_batch(
+      std::move(keys), PromiseCreator::lambda([user_ids = std::move(user_ids)](vector<string> values) mutable {
+        send_closure(G()->contacts_manager(), &ContactsManager::on_load_users_from_database, std::move(user_ids),
+                     std::move(values));
+      }));
+}
+
+void ContactsManager::on_load_users_from_database(vector<UserId> user_ids, vector<string> values) {
+  CHECK(user_ids.size() == values.size());
+  for (size_t i = 0; i < user_ids.size(); i++) {
+    on_load_user_from_database(user_ids[i], std::move(values[i]));
   }
 }
 
@@ -7640,6 +7686,113 @@ ContactsManager::User *ContactsManager::get_user_force_impl(UserId user_id) {
   return get_user(user_id);
 }
 
+class ContactsManager::StartupSnapshot {
+ public:
+  static constexpr int32 VERSION = 1;
+
+  vector<UserId> user_ids;
+  vector<ChatId> chat_ids;
+  vector<ChannelId> channel_ids;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    int32 version = VERSION;
+    td::store(version, storer);
+    td::store(user_ids, storer);
+    td::store(chat_ids, storer);
+    td::store(channel_ids, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    int32 version;
+    td::parse(version, parser);
+    if (version != VERSION) {
+      return parser.set_error("Unsupported snapshot version");
+    }
+    td::parse(user_ids, parser);
+    td::parse(chat_ids, parser);
+    td::parse(channel_ids, parser);
+  }
+};
+
+// identifiers of all users, basic groups and supergroups, which were known at the moment of closing, are saved,
+// so they can be loaded from the database in a few batches on the next start instead of one by one on first access
+void ContactsManager::save_startup_snapshot() {
+  if (!G()->parameters().use_chat_info_db || td_->auth_manager_->is_bot()) {
+    return;
+  }
+  if (!G()->shared_config().get_option_boolean("use_startup_snapshot")) {
+    G()->td_db()->get_sqlite_pmc()->erase("startup_snapshot", Auto());
+    return;
+  }
+
+  StartupSnapshot snapshot;
+  for (const auto &it : users_) {
+    if (snapshot.user_ids.size() == MAX_STARTUP_SNAPSHOT_OBJECTS) {
+      break;
+    }
+    snapshot.user_ids.push_back(it.first);
+  }
+  for (const auto &it : chats_) {
+    if (snapshot.chat_ids.size() == MAX_STARTUP_SNAPSHOT_OBJECTS) {
+      break;
+    }
+    snapshot.chat_ids.push_back(it.first);
+  }
+  for (const auto &it : channels_) {
+    if (snapshot.channel_ids.size() == MAX_STARTUP_SNAPSHOT_OBJECTS) {
+      break;
+    }
+    snapshot.channel_ids.push_back(it.first);
+  }
+  LOG(INFO) << "Save startup snapshot with " << snapshot.user_ids.size() << " users, " << snapshot.chat_ids.size()
+            << " basic groups and " << snapshot.channel_ids.size() << " supergroups";
+  G()->td_db()->get_sqlite_pmc()->set("startup_snapshot", log_event_store(snapshot).as_slice().str(), Auto());
+}
+
+void ContactsManager::load_startup_snapshot() {
+  if (!G()->parameters().use_chat_info_db || !G()->shared_config().get_option_boolean("use_startup_snapshot")) {
+    return;
+  }
+
+  G()->td_db()->get_sqlite_pmc()->get("startup_snapshot", PromiseCreator::lambda([](string value) {
+                                        send_closure(G()->contacts_manager(),
+                                                     &ContactsManager::on_load_startup_snapshot, std::move(value));
+                                      }));
+}
+
+void ContactsManager::on_load_startup_snapshot(string value) {
+  if (G()->close_flag() || value.empty()) {
+    return;
+  }
+
+  StartupSnapshot snapshot;
+  auto status = log_event_parse(snapshot, value);
+  if (status.is_error()) {
+    LOG(WARNING) << "Ignore startup snapshot: " << status;
+    return;
+  }
+
+  LOG(INFO) << "Load startup snapshot with " << snapshot.user_ids.size() << " users, " << snapshot.chat_ids.size()
+            << " basic groups and " << snapshot.channel_ids.size() << " supergroups";
+  for (auto user_id : snapshot.user_ids) {
+    if (user_id.is_valid() && get_user(user_id) == nullptr) {
+      load_user_from_database(nullptr, user_id, Auto());
+    }
+  }
+  for (auto chat_id : snapshot.chat_ids) {
+    if (chat_id.is_valid() && get_chat(chat_id) == nullptr) {
+      load_chat_from_database(nullptr, chat_id, Auto());
+    }
+  }
+  for (auto channel_id : snapshot.channel_ids) {
+    if (channel_id.is_valid() && get_channel(channel_id) == nullptr) {
+      load_channel_from_database(nullptr, channel_id, Auto());
+    }
+  }
+}
+
 class ContactsManager::ChatLogEvent {
  public:
   ChatId chat_id;
@@ -7787,11 +7940,33 @@ void ContactsManager::load_chat_from_database_impl(ChatId chat_id, Promise<Unit>
   auto &load_chat_queries = load_chat_from_database_queries_[chat_id];
   load_chat_queries.push_back(std::move(promise));
   if (load_chat_queries.size() == 1u) {
-    G()->td_db()->get_sqlite_pmc()->get(get_chat_database_key(chat_id), PromiseCreator::lambda([chat_id](string value) {
-                                          send_closure(G()->contacts_manager(),
-                                                       &ContactsManager::on_load_chat_from_database, chat_id,
-                                                       std::move(value));
-                                        }));
+    if (pending_load_chat_from_database_ids_.empty()) {
+      send_closure_later(actor_id(this), &ContactsManager::load_pending_chats_from_database);
+    }
+    pending_load_chat_from_database_ids_.push_back(chat_id);
+  }
+}
+
+void ContactsManager::load_pending_chats_from_database() {
+  auto chat_ids = std::move(pending_load_chat_from_database_ids_);
+  reset_to_empty(pending_load_chat_from_database_ids_);
+  if (chat_ids.empty()) {
+    return;
+  }
+
+  LOG(INFO) << "Load " << chat_ids.size() << " chats from database";
+  auto keys = transform(chat_ids, get_chat_database_key);
+  G()->td_db()->get_sqlite_pmc()->get_batch(
+      std::move(keys), PromiseCreator::lambda([chat_ids = std::move(chat_ids)](vector<string> values) mutable {
+        send_closure(G()->contacts_manager(), &ContactsManager::on_load_chats_from_database, std::move(chat_ids),
+                     std::move(values));
+      }));
+}
+
+void ContactsManager::on_load_chats_from_database(vector<ChatId> chat_ids, vector<string> values) {
+  CHECK(chat_ids.size() == values.size());
+  for (size_t i = 0; i < chat_ids.size(); i++) {
+    on_load_chat_from_database(chat_ids[i], std::move(values[i]));
   }
 }
 
@@ -8024,11 +8199,33 @@ void ContactsManager::load_channel_from_database_impl(ChannelId channel_id, Prom
   auto &load_channel_queries = load_channel_from_database_queries_[channel_id];
   load_channel_queries.push_back(std::move(promise));
   if (load_channel_queries.size() == 1u) {
-    G()->td_db()->get_sqlite_pmc()->get(
-        get_channel_database_key(channel_id), PromiseCreator::lambda([channel_id](string value) {
-          send_closure(G()->contacts_manager(), &ContactsManager::on_load_channel_from_database, channel_id,
-                       std::move(value));
-        }));
+    if (pending_load_channel_from_database_ids_.empty()) {
+      send_closure_later(actor_id(this), &ContactsManager::load_pending_channels_from_database);
+    }
+    pending_load_channel_from_database_ids_.push_back(channel_id);
+  }
+}
+
+void ContactsManager::load_pending_channels_from_database() {
+  auto channel_ids = std::move(pending_load_channel_from_database_ids_);
+  reset_to_empty(pending_load_channel_from_database_ids_);
+  if (channel_ids.empty()) {
+    return;
+  }
+
+  LOG(INFO) << "Load " << channel_ids.size() << " channels from database";
+  auto keys = transform(channel_ids, get_channel_database_key);
+  G()->td_db()->get_sqlite_pmc()->get_batch(
+      std::move(keys), PromiseCreator::lambda([channel_ids = std::move(channel_ids)](vector<string> values) mutable {
+        send_closure(G()->contacts_manager(), &ContactsManager::on_load_channels_from_database, std::move(channel_ids),
+                     std::move(values));
+      }));
+}
+
+void ContactsManager::on_load_channels_from_database(vector<ChannelId> channel_ids, vector<string> values) {
+  CHECK(channel_ids.size() == values.size());
+  for (size_t i = 0; i < channel_ids.size(); i++) {
+    on_load_channel_from_database(channel_ids[i], std::move(values[i]));
   }
 }
 
@@ -12414,9 +12611,7 @@ bool ContactsManager::get_user(UserId user_id, int left_tries, Promise<Unit> &&p
       return false;
     }
 
-    vector<tl_object_ptr<telegram_api::InputUser>> users;
-    users.push_back(std::move(input_user));
-    td_->create_handler<GetUsersQuery>(std::move(promise))->send(std::move(users));
+    get_user_from_server(user_id, std::move(promise));
     return false;
   }
 
@@ -12424,6 +12619,68 @@ bool ContactsManager::get_user(UserId user_id, int left_tries, Promise<Unit> &&p
   return true;
 }
 
+void ContactsManager::get_user_from_server(UserId user_id, Promise<Unit> &&promise) {
+  auto &queries = get_user_queries_[user_id];
+  queries.push_back(std::move(promise));
+  if (queries.size() != 1u) {
+    // the user is already being requested
+    return;
+  }
+
+  if (pending_get_user_ids_.empty()) {
+    send_closure_later(actor_id(this), &ContactsManager::send_get_users_queries);
+  }
+  pending_get_user_ids_.push_back(user_id);
+}
+
+void ContactsManager::send_get_users_queries() {
+  auto user_ids = std::move(pending_get_user_ids_);
+  reset_to_empty(pending_get_user_ids_);
+
+  vector<UserId> query_user_ids;
+  vector<tl_object_ptr<telegram_api::InputUser>> input_users;
+  auto send_query = [&] {
+    auto query_promise = PromiseCreator::lambda(
+        [actor_id = actor_id(this), user_ids = std::move(query_user_ids)](Result<Unit> result) mutable {
+          send_closure(actor_id, &ContactsManager::on_get_users_finished, std::move(user_ids), std::move(result));
+        });
+    td_->create_handler<GetUsersQuery>(std::move(query_promise))->send(std::move(input_users));
+    query_user_ids.clear();
+    input_users.clear();
+  };
+  for (auto user_id : user_ids) {
+    auto input_user = get_input_user(user_id);
+    if (input_user == nullptr) {
+      on_get_users_finished({user_id}, Status::Error(6, "User not found"));
+      continue;
+    }
+    query_user_ids.push_back(user_id);
+    input_users.push_back(std::move(input_user));
+    if (input_users.size() == MAX_GET_USERS_QUERY_SIZE) {
+      send_query();
+    }
+  }
+  if (!input_users.empty()) {
+    send_query();
+  }
+}
+
+void ContactsManager::on_get_users_finished(vector<UserId> user_ids, Result<Unit> &&result) {
+  for (auto user_id : user_ids) {
+    auto it = get_user_queries_.find(user_id);
+    CHECK(it != get_user_queries_.end());
+    auto promises = std::move(it->second);
+    get_user_queries_.erase(it);
+    for (auto &promise : promises) {
+      if (result.is_ok()) {
+        promise.set_value(Unit());
+      } else {
+        promise.set_error(result.error().clone());
+      }
+    }
+  }
+}
+
 ContactsManager::User *ContactsManager::add_user(UserId user_id, const char *source) {
   CHECK(user_id.is_valid());
   auto &user_ptr = users_[user_id];
@@ -13368,15 +13625,21 @@ std::pair<int32, vector<DialogParticipant>> ContactsManager::search_chat_partici
   };
 
   vector<UserId> user_ids;
+  std::unordered_map<UserId, const DialogParticipant *, UserIdHash> suitable_participants;
   for (const auto &participant : chat_full->participants) {
     if (is_dialog_participant_suitable(participant, filter)) {
       user_ids.push_back(participant.user_id);
+      suitable_participants.emplace(participant.user_id, &participant);
     }
   }
 
   int32 total_count;
   std::tie(total_count, user_ids) = search_among_users(user_ids, query, limit);
-  return {total_count, transform(user_ids, [&](UserId user_id) { return *get_chat_participant(chat_full, user_id); })};
+  return {total_count, transform(user_ids, [&suitable_participants](UserId user_id) {
+            auto it = suitable_participants.find(user_id);
+            CHECK(it != suitable_participants.end());
+            return *it->second;
+          })};
 }
 
 DialogParticipant ContactsManager::get_channel_participant(ChannelId channel_id, UserId user_id, int64 &random_id,
@@ -38,6 +38,7 @@
 #include "td/actor/Timeout.h"
 
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/Hints.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
@@ -183,6 +184,8 @@ class ContactsManager : public Actor {
 
   void on_ignored_restriction_reasons_changed();
 
+  void save_startup_snapshot();
+
   void on_get_chat_participants(tl_object_ptr<telegram_api::ChatParticipants> &&participants, bool from_update);
   void on_update_chat_add_user(ChatId chat_id, UserId inviter_user_id, UserId user_id, int32 date, int32 version);
   void on_update_chat_description(ChatId chat_id, string &&description);
@@ -276,6 +279,8 @@ class ContactsManager : public Actor {
 
   void invalidate_user_full(UserId user_id);
 
+  void get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) const;
+
   void on_channel_unban_timeout(ChannelId channel_id);
 
   void check_dialog_username(DialogId dialog_id, const string &username, Promise<CheckDialogUsernameResult> &&promise);
@@ -945,6 +950,9 @@ class ContactsManager : public Actor {
   class ChatLogEvent;
   class ChannelLogEvent;
   class SecretChatLogEvent;
+  class StartupSnapshot;
+
+  static constexpr size_t MAX_STARTUP_SNAPSHOT_OBJECTS = 10000;
 
   static constexpr int32 MAX_GET_PROFILE_PHOTOS = 100;        // server side limit
   static constexpr size_t MAX_NAME_LENGTH = 64;               // server side limit for first/last name
@@ -1236,6 +1244,9 @@ class ContactsManager : public Actor {
   void on_chat_update(telegram_api::channel &channel, const char *source);
   void on_chat_update(telegram_api::channelForbidden &channel, const char *source);
 
+  void load_startup_snapshot();
+  void on_load_startup_snapshot(string value);
+
   void save_user(User *u, UserId user_id, bool from_binlog);
   static string get_user_database_key(UserId user_id);
   static string get_user_database_value(const User *u);
@@ -1245,6 +1256,12 @@ class ContactsManager : public Actor {
   void load_user_from_database(User *u, UserId user_id, Promise<Unit> promise);
   void load_user_from_database_impl(UserId user_id, Promise<Unit> promise);
   void on_load_user_from_database(UserId user_id, string value);
+  void load_pending_users_from_database();
+  void on_load_users_from_database(vector<UserId> user_ids, vector<string> values);
+
+  void get_user_from_server(UserId user_id, Promise<Unit> &&promise);
+  void send_get_users_queries();
+  void on_get_users_finished(vector<UserId> user_ids, Result<Unit> &&result);
 
   void save_chat(Chat *c, ChatId chat_id, bool from_binlog);
   static string get_chat_database_key(ChatId chat_id);
@@ -1255,6 +1272,8 @@ class ContactsManager : public Actor {
   void load_chat_from_database(Chat *c, ChatId chat_id, Promise<Unit> promise);
   void load_chat_from_database_impl(ChatId chat_id, Promise<Unit> promise);
   void on_load_chat_from_database(ChatId chat_id, string value);
+  void load_pending_chats_from_database();
+  void on_load_chats_from_database(vector<ChatId> chat_ids, vector<string> values);
 
   void save_channel(Channel *c, ChannelId channel_id, bool from_binlog);
   static string get_channel_database_key(ChannelId channel_id);
@@ -1265,6 +1284,8 @@ class ContactsManager : public Actor {
   void load_channel_from_database(Channel *c, ChannelId channel_id, Promise<Unit> promise);
   void load_channel_from_database_impl(ChannelId channel_id, Promise<Unit> promise);
   void on_load_channel_from_database(ChannelId channel_id, string value);
+  void load_pending_channels_from_database();
+  void on_load_channels_from_database(vector<ChannelId> channel_ids, vector<string> values);
 
   void save_secret_chat(SecretChat *c, SecretChatId secret_chat_id, bool from_binlog);
   static string get_secret_chat_database_key(SecretChatId secret_chat_id);
@@ -1469,8 +1490,8 @@ class ContactsManager : public Actor {
   UserId support_user_id_;
   int32 my_was_online_local_ = 0;
 
-  std::unordered_map<UserId, unique_ptr<User>, UserIdHash> users_;
-  std::unordered_map<UserId, unique_ptr<UserFull>, UserIdHash> users_full_;
+  FlatHashMap<UserId, unique_ptr<User>, UserIdHash> users_;
+  FlatHashMap<UserId, unique_ptr<UserFull>, UserIdHash> users_full_;
   std::unordered_map<UserId, unique_ptr<BotInfo>, UserIdHash> bot_infos_;
   std::unordered_map<UserId, UserPhotos, UserIdHash> user_photos_;
   mutable std::unordered_set<UserId, UserIdHash> unknown_users_;
@@ -1483,18 +1504,18 @@ class ContactsManager : public Actor {
   std::unordered_map<std::pair<UserId, int64>, FileSourceId, UserIdPhotoIdHash> user_profile_photo_file_source_ids_;
   std::unordered_map<int64, FileId> my_photo_file_id_;
 
-  std::unordered_map<ChatId, unique_ptr<Chat>, ChatIdHash> chats_;
-  std::unordered_map<ChatId, unique_ptr<ChatFull>, ChatIdHash> chats_full_;
+  FlatHashMap<ChatId, unique_ptr<Chat>, ChatIdHash> chats_;
+  FlatHashMap<ChatId, unique_ptr<ChatFull>, ChatIdHash> chats_full_;
   mutable std::unordered_set<ChatId, ChatIdHash> unknown_chats_;
   std::unordered_map<ChatId, FileSourceId, ChatIdHash> chat_full_file_source_ids_;
 
   std::unordered_set<ChannelId, ChannelIdHash> min_channels_;
-  std::unordered_map<ChannelId, unique_ptr<Channel>, ChannelIdHash> channels_;
-  std::unordered_map<ChannelId, unique_ptr<ChannelFull>, ChannelIdHash> channels_full_;
+  FlatHashMap<ChannelId, unique_ptr<Channel>, ChannelIdHash> channels_;
+  FlatHashMap<ChannelId, unique_ptr<ChannelFull>, ChannelIdHash> channels_full_;
   mutable std::unordered_set<ChannelId, ChannelIdHash> unknown_channels_;
   std::unordered_map<ChannelId, FileSourceId, ChannelIdHash> channel_full_file_source_ids_;
 
-  std::unordered_map<SecretChatId, unique_ptr<SecretChat>, SecretChatIdHash> secret_chats_;
+  FlatHashMap<SecretChatId, unique_ptr<SecretChat>, SecretChatIdHash> secret_chats_;
   mutable std::unordered_set<SecretChatId, SecretChatIdHash> unknown_secret_chats_;
 
   std::unordered_map<UserId, vector<SecretChatId>, UserIdHash> secret_chats_with_user_;
@@ -1517,15 +1538,23 @@ class ContactsManager : public Actor {
   vector<ChannelId> inactive_channels_;
 
   std::unordered_map<UserId, vector<Promise<Unit>>, UserIdHash> load_user_from_database_queries_;
+  vector<UserId> pending_load_user_from_database_ids_;  // are loaded all at once in the next event loop iteration
   std::unordered_set<UserId, UserIdHash> loaded_from_database_users_;
+
+  static constexpr size_t MAX_GET_USERS_QUERY_SIZE = 100;  // server-side limit on number of users in users.getUsers
+  std::unordered_map<UserId, vector<Promise<Unit>>, UserIdHash> get_user_queries_;
+  vector<UserId> pending_get_user_ids_;  // are requested from the server in the next event loop iteration
+
   std::unordered_set<UserId, UserIdHash> unavailable_user_fulls_;
   std::unordered_set<UserId, UserIdHash> unavailable_bot_infos_;
 
   std::unordered_map<ChatId, vector<Promise<Unit>>, ChatIdHash> load_chat_from_database_queries_;
+  vector<ChatId> pending_load_chat_from_database_ids_;  // are loaded all at once in the next event loop iteration
   std::unordered_set<ChatId, ChatIdHash> loaded_from_database_chats_;
   std::unordered_set<ChatId, ChatIdHash> unavailable_chat_fulls_;
 
   std::unordered_map<ChannelId, vector<Promise<Unit>>, ChannelIdHash> load_channel_from_database_queries_;
+  vector<ChannelId> pending_load_channel_from_database_ids_;  // are loaded all at once in the next event loop iteration
   std::unordered_set<ChannelId, ChannelIdHash> loaded_from_database_channels_;
   std::unordered_set<ChannelId, ChannelIdHash> unavailable_channel_fulls_;
 
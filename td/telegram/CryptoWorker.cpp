@@ -0,0 +1,19 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/CryptoWorker.h"
+
+namespace td {
+
+void CryptoWorker::run(Promise<Unit> job) {
+  job.set_value(Unit());
+}
+
+void CryptoWorker::hangup() {
+  stop();
+}
+
+}  // namespace td
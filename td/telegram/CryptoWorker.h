@@ -0,0 +1,53 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/Global.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Status.h"
+
+#include <utility>
+
+namespace td {
+
+// runs CPU-heavy jobs like PBKDF2 and SRP computations outside of the scheduler of the requesting manager
+class CryptoWorker : public Actor {
+ public:
+  explicit CryptoWorker(ActorShared<> parent) : parent_(std::move(parent)) {
+  }
+
+  void run(Promise<Unit> job);
+
+ private:
+  ActorShared<> parent_;
+
+  void hangup() override;
+};
+
+// calls func() on the crypto worker and passes its result to the promise on the scheduler of the actor
+template <class T, class FunctionT>
+void run_crypto_job(ActorRef actor_ref, FunctionT &&func, Promise<T> &&promise) {
+  send_closure(G()->crypto_worker(), &CryptoWorker::run,
+               PromiseCreator::lambda([actor_ref, func = std::forward<FunctionT>(func),
+                                       promise = std::move(promise)](Result<Unit> result) mutable {
+                 Result<T> r_result;
+                 if (result.is_error()) {
+                   r_result = Status::Error(500, "Request aborted");
+                 } else {
+                   r_result = func();
+                 }
+                 send_lambda(actor_ref, [r_result = std::move(r_result), promise = std::move(promise)]() mutable {
+                   promise.set_result(std::move(r_result));
+                 });
+               }));
+}
+
+}  // namespace td
@@ -11,8 +11,30 @@
 
 #include "td/utils/common.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace td {
 
+namespace {
+// checking of a prime is expensive, so results are shared between all TDLib instances of the process
+struct SharedPrimes {
+  std::mutex mutex;
+  std::unordered_map<string, bool> is_good;
+};
+
+SharedPrimes &get_shared_primes() {
+  static SharedPrimes shared_primes;
+  return shared_primes;
+}
+
+void add_shared_prime(Slice prime_str, bool is_good) {
+  auto &shared_primes = get_shared_primes();
+  std::lock_guard<std::mutex> lock(shared_primes.mutex);
+  shared_primes.is_good[prime_str.str()] = is_good;
+}
+}  // namespace
+
 static string good_prime_key(Slice prime_str) {
   string key("good_prime:");
   key.append(prime_str.data(), prime_str.size());
@@ -20,11 +42,22 @@ static string good_prime_key(Slice prime_str) {
 }
 
 int DhCache::is_good_prime(Slice prime_str) const {
+  {
+    auto &shared_primes = get_shared_primes();
+    std::lock_guard<std::mutex> lock(shared_primes.mutex);
+    auto it = shared_primes.is_good.find(prime_str.str());
+    if (it != shared_primes.is_good.end()) {
+      return it->second ? 1 : 0;
+    }
+  }
+
   string value = G()->td_db()->get_binlog_pmc()->get(good_prime_key(prime_str));
   if (value == "good") {
+    add_shared_prime(prime_str, true);
     return 1;
   }
   if (value == "bad") {
+    add_shared_prime(prime_str, false);
     return 0;
   }
   CHECK(value == "");
@@ -32,10 +65,12 @@ int DhCache::is_good_prime(Slice prime_str) const {
 }
 
 void DhCache::add_good_prime(Slice prime_str) const {
+  add_shared_prime(prime_str, true);
   G()->td_db()->get_binlog_pmc()->set(good_prime_key(prime_str), "good");
 }
 
 void DhCache::add_bad_prime(Slice prime_str) const {
+  add_shared_prime(prime_str, false);
   G()->td_db()->get_binlog_pmc()->set(good_prime_key(prime_str), "bad");
 }
 
@@ -208,7 +208,7 @@ class DialogDbImpl : public DialogDbSyncInterface {
     get_dialog_stmt_.bind_int64(1, dialog_id.get()).ensure();
     TRY_STATUS(get_dialog_stmt_.step());
     if (!get_dialog_stmt_.has_row()) {
-      return Status::Error("Not found");
+      return STATIC_ERROR(0, "Not found");
     }
     return BufferSlice(get_dialog_stmt_.view_blob(0));
   }
@@ -220,7 +220,7 @@ class DialogDbImpl : public DialogDbSyncInterface {
     get_notification_group_stmt_.bind_int32(1, notification_group_id.get()).ensure();
     TRY_STATUS(get_notification_group_stmt_.step());
     if (!get_notification_group_stmt_.has_row()) {
-      return Status::Error("Not found");
+      return STATIC_ERROR(0, "Not found");
     }
     return NotificationGroupKey(notification_group_id, DialogId(get_notification_group_stmt_.view_int64(0)),
                                 get_last_notification_date(get_notification_group_stmt_, 1));
@@ -255,6 +255,7 @@ class DialogDbImpl : public DialogDbSyncInterface {
       result.next_order = get_dialogs_stmt_.view_int64(2);
       LOG(INFO) << "Load " << result.next_dialog_id << " with order " << result.next_order;
       result.dialogs.emplace_back(std::move(data));
+      result.dialog_ids.push_back(result.next_dialog_id);
       TRY_STATUS(get_dialogs_stmt_.step());
     }
 
@@ -443,7 +444,6 @@ class DialogDbAsync : public DialogDbAsyncInterface {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f), PromiseCreator::Ignore()));
       if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
         do_flush();
-        wakeup_at_ = 0;
       } else if (wakeup_at_ == 0) {
         wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
       }
@@ -470,6 +470,7 @@ class DialogDbAsync : public DialogDbAsyncInterface {
         p.first.set_result(std::move(p.second));
       }
       pending_write_results_.clear();
+      wakeup_at_ = 0;
       cancel_timeout();
     }
 
@@ -479,6 +480,12 @@ class DialogDbAsync : public DialogDbAsyncInterface {
 
     void start_up() override {
       sync_db_ = &sync_db_safe_->get();
+      allow_stealing();
+    }
+
+    void on_finish_migrate() override {
+      // database connections are scheduler-local
+      sync_db_ = &sync_db_safe_->get();
     }
   };
   ActorOwn<Impl> impl_;
@@ -29,6 +29,7 @@ class SqliteDb;
 
 struct DialogDbGetDialogsResult {
   vector<BufferSlice> dialogs;
+  vector<DialogId> dialog_ids;  // identifiers of the dialogs, so they don't need to be parsed from data
   int64 next_order = 0;
   DialogId next_dialog_id;
 };
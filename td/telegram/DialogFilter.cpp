@@ -53,6 +53,29 @@ void DialogFilter::remove_secret_chat_dialog_ids() {
   remove_secret_chats(pinned_dialog_ids);
   remove_secret_chats(included_dialog_ids);
   remove_secret_chats(excluded_dialog_ids);
+  dialog_id_index_ = DialogIdIndex();
+}
+
+int32 DialogFilter::get_dialog_inclusion(DialogId dialog_id) const {
+  if (!dialog_id_index_.is_inited) {
+    auto &is_included = dialog_id_index_.is_included;
+    // pinned and included chats take precedence over excluded chats
+    for (auto &input_dialog_id : excluded_dialog_ids) {
+      is_included[input_dialog_id.get_dialog_id()] = false;
+    }
+    for (auto input_dialog_ids : {&included_dialog_ids, &pinned_dialog_ids}) {
+      for (auto &input_dialog_id : *input_dialog_ids) {
+        is_included[input_dialog_id.get_dialog_id()] = true;
+      }
+    }
+    dialog_id_index_.is_inited = true;
+  }
+
+  auto it = dialog_id_index_.is_included.find(dialog_id);
+  if (it == dialog_id_index_.is_included.end()) {
+    return 0;
+  }
+  return it->second ? 1 : -1;
 }
 
 bool DialogFilter::is_empty(bool for_server) const {
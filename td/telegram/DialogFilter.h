@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/telegram/DialogFilterId.h"
+#include "td/telegram/DialogId.h"
 #include "td/telegram/InputDialogId.h"
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
@@ -49,6 +50,9 @@ class DialogFilter {
 
   void remove_secret_chat_dialog_ids();
 
+  // returns 1, if the chat is pinned or included in the filter, -1, if it is excluded from the filter, and 0 otherwise
+  int32 get_dialog_inclusion(DialogId dialog_id) const;
+
   bool is_empty(bool for_server) const;
 
   Status check_limits() const;
@@ -75,6 +79,27 @@ class DialogFilter {
   static bool are_flags_equal(const DialogFilter &lhs, const DialogFilter &rhs);
 
  private:
+  // lazily built index of pinned_dialog_ids, included_dialog_ids and excluded_dialog_ids
+  // it isn't copied with the filter, because the copy is usually changed afterwards
+  class DialogIdIndex {
+   public:
+    std::unordered_map<DialogId, bool, DialogIdHash> is_included;
+    bool is_inited = false;
+
+    DialogIdIndex() = default;
+    DialogIdIndex(const DialogIdIndex &) {
+    }
+    DialogIdIndex &operator=(const DialogIdIndex &) {
+      is_included.clear();
+      is_inited = false;
+      return *this;
+    }
+    DialogIdIndex(DialogIdIndex &&) = default;
+    DialogIdIndex &operator=(DialogIdIndex &&) = default;
+    ~DialogIdIndex() = default;
+  };
+  mutable DialogIdIndex dialog_id_index_;
+
   static std::unordered_map<string, string> emoji_to_icon_name_;
   static std::unordered_map<string, string> icon_name_to_emoji_;
 
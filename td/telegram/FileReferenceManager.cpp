@@ -248,13 +248,33 @@ void FileReferenceManager::send_query(Destination dest, FileSourceId file_source
     send_closure(file_manager, &FileManager::on_file_reference_repaired, dest.node_id, file_source_id,
                  std::move(result), std::move(new_promise));
   });
+  repair_file_source(file_source_id, std::move(promise));
+}
+
+void FileReferenceManager::repair_file_source(FileSourceId file_source_id, Promise<Unit> promise) {
+  auto &promises = file_source_repair_promises_[file_source_id];
+  promises.push_back(std::move(promise));
+  if (promises.size() != 1) {
+    VLOG(file_references) << "Wait for the already sent repair query for " << file_source_id;
+    return;
+  }
+
   auto index = static_cast<size_t>(file_source_id.get()) - 1;
   CHECK(index < file_sources_.size());
+  if (file_sources_[index].get_offset() == FileSource::offset<FileSourceMessage>()) {
+    // messages are requested in batches to avoid a separate query for every message
+    if (pending_message_file_source_ids_.empty()) {
+      send_closure_later(actor_id(this), &FileReferenceManager::repair_message_file_sources);
+    }
+    pending_message_file_source_ids_.push_back(file_source_id);
+    return;
+  }
+
+  promise = PromiseCreator::lambda([actor_id = actor_id(this), file_source_id](Result<Unit> result) {
+    send_closure(actor_id, &FileReferenceManager::on_file_source_repaired, file_source_id, std::move(result));
+  });
   file_sources_[index].visit(overloaded(
-      [&](const FileSourceMessage &source) {
-        send_closure_later(G()->messages_manager(), &MessagesManager::get_message_from_server, source.full_message_id,
-                           std::move(promise), nullptr);
-      },
+      [&](const FileSourceMessage &source) { UNREACHABLE(); },
       [&](const FileSourceUserPhoto &source) {
         send_closure_later(G()->contacts_manager(), &ContactsManager::reload_user_profile_photo, source.user_id,
                            source.photo_id, std::move(promise));
@@ -295,6 +315,59 @@ void FileReferenceManager::send_query(Destination dest, FileSourceId file_source
       }));
 }
 
+void FileReferenceManager::repair_message_file_sources() {
+  auto file_source_ids = std::move(pending_message_file_source_ids_);
+  reset_to_empty(pending_message_file_source_ids_);
+
+  // messages from all private chats and basic groups can be requested together, channel messages are requested
+  // separately for each channel
+  std::unordered_map<DialogId, vector<FileSourceId>, DialogIdHash> grouped_file_source_ids;
+  for (auto file_source_id : file_source_ids) {
+    auto index = static_cast<size_t>(file_source_id.get()) - 1;
+    auto dialog_id = file_sources_[index].get<FileSourceMessage>().full_message_id.get_dialog_id();
+    grouped_file_source_ids[dialog_id.get_type() == DialogType::Channel ? dialog_id : DialogId()].push_back(
+        file_source_id);
+  }
+
+  for (auto &it : grouped_file_source_ids) {
+    for (size_t i = 0; i < it.second.size(); i += MAX_MESSAGES_PER_REPAIR_QUERY) {
+      auto end = min(i + MAX_MESSAGES_PER_REPAIR_QUERY, it.second.size());
+      vector<FileSourceId> query_file_source_ids(it.second.begin() + i, it.second.begin() + end);
+      auto full_message_ids = transform(query_file_source_ids, [&](FileSourceId file_source_id) {
+        auto index = static_cast<size_t>(file_source_id.get()) - 1;
+        return file_sources_[index].get<FileSourceMessage>().full_message_id;
+      });
+      VLOG(file_references) << "Repair file references from " << full_message_ids;
+
+      auto promise = PromiseCreator::lambda([actor_id = actor_id(this),
+                                             file_source_ids = std::move(query_file_source_ids)](Result<Unit> result) {
+        for (auto file_source_id : file_source_ids) {
+          send_closure(actor_id, &FileReferenceManager::on_file_source_repaired, file_source_id,
+                       result.is_ok() ? Result<Unit>(Unit()) : Result<Unit>(result.error().clone()));
+        }
+      });
+      send_closure_later(G()->messages_manager(), &MessagesManager::get_messages_from_server,
+                         std::move(full_message_ids), std::move(promise), nullptr);
+    }
+  }
+}
+
+void FileReferenceManager::on_file_source_repaired(FileSourceId file_source_id, Result<Unit> result) {
+  auto it = file_source_repair_promises_.find(file_source_id);
+  CHECK(it != file_source_repair_promises_.end());
+  auto promises = std::move(it->second);
+  file_source_repair_promises_.erase(it);
+
+  VLOG(file_references) << "Repaired " << promises.size() << " file references from " << file_source_id;
+  for (auto &promise : promises) {
+    if (result.is_ok()) {
+      promise.set_value(Unit());
+    } else {
+      promise.set_error(result.error().clone());
+    }
+  }
+}
+
 FileReferenceManager::Destination FileReferenceManager::on_query_result(Destination dest, FileSourceId file_source_id,
                                                                         Status status, int32 sub) {
   VLOG(file_references) << "Receive result of file reference repair query for file " << dest.node_id
@@ -12,6 +12,7 @@
 #include "td/telegram/BackgroundId.h"
 #include "td/telegram/ChannelId.h"
 #include "td/telegram/ChatId.h"
+#include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/FullMessageId.h"
@@ -143,8 +144,19 @@ class FileReferenceManager : public Actor {
 
   std::unordered_map<NodeId, Node, FileIdHash> nodes_;
 
+  static constexpr size_t MAX_MESSAGES_PER_REPAIR_QUERY = 100;
+
+  // promises waiting for a repair of the file source; the source is repaired only once for all of them
+  std::unordered_map<FileSourceId, vector<Promise<Unit>>, FileSourceIdHash> file_source_repair_promises_;
+
+  // message file sources, which will be repaired together by the next repair_message_file_sources
+  vector<FileSourceId> pending_message_file_source_ids_;
+
   void run_node(NodeId node);
   void send_query(Destination dest, FileSourceId file_source_id);
+  void repair_file_source(FileSourceId file_source_id, Promise<Unit> promise);
+  void repair_message_file_sources();
+  void on_file_source_repaired(FileSourceId file_source_id, Result<Unit> result);
   Destination on_query_result(Destination dest, FileSourceId file_source_id, Status status, int32 sub = 0);
 
   template <class T>
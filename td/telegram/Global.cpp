@@ -85,11 +85,12 @@ struct ServerTimeDiff {
   }
 };
 
-Status Global::init(const TdParameters &parameters, ActorId<Td> td, unique_ptr<TdDb> td_db_ptr) {
+Status Global::init(const TdParameters &parameters, ActorId<Td> td, unique_ptr<TdDb> td_db_ptr,
+                    int32 worker_scheduler_id) {
   parameters_ = parameters;
 
-  gc_scheduler_id_ = min(Scheduler::instance()->sched_id() + 2, Scheduler::instance()->sched_count() - 1);
-  slow_net_scheduler_id_ = min(Scheduler::instance()->sched_id() + 3, Scheduler::instance()->sched_count() - 1);
+  gc_scheduler_id_ = min(worker_scheduler_id + 1, Scheduler::instance()->sched_count() - 1);
+  slow_net_scheduler_id_ = min(worker_scheduler_id + 2, Scheduler::instance()->sched_count() - 1);
 
   td_ = td;
   td_db_ = std::move(td_db_ptr);
@@ -36,6 +36,7 @@ class ConfigManager;
 class ConfigShared;
 class ConnectionCreator;
 class ContactsManager;
+class CryptoWorker;
 class FileManager;
 class FileReferenceManager;
 class LanguagePackManager;
@@ -81,7 +82,8 @@ class Global : public ActorContext {
   void close_all(Promise<> on_finished);
   void close_and_destroy_all(Promise<> on_finished);
 
-  Status init(const TdParameters &parameters, ActorId<Td> td, unique_ptr<TdDb> td_db_ptr) TD_WARN_UNUSED_RESULT;
+  Status init(const TdParameters &parameters, ActorId<Td> td, unique_ptr<TdDb> td_db_ptr,
+              int32 worker_scheduler_id) TD_WARN_UNUSED_RESULT;
 
   Slice get_dir() const {
     return parameters_.database_directory;
@@ -201,6 +203,13 @@ class Global : public ActorContext {
     contacts_manager_ = contacts_manager;
   }
 
+  ActorId<CryptoWorker> crypto_worker() const {
+    return crypto_worker_;
+  }
+  void set_crypto_worker(ActorId<CryptoWorker> crypto_worker) {
+    crypto_worker_ = crypto_worker;
+  }
+
   ActorId<FileManager> file_manager() const {
     return file_manager_;
   }
@@ -383,6 +392,7 @@ class Global : public ActorContext {
   ActorId<CallManager> call_manager_;
   ActorId<ConfigManager> config_manager_;
   ActorId<ContactsManager> contacts_manager_;
+  ActorId<CryptoWorker> crypto_worker_;
   ActorId<FileManager> file_manager_;
   ActorId<FileReferenceManager> file_reference_manager_;
   ActorId<LanguagePackManager> language_pack_manager_;
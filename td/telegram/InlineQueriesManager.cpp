@@ -15,6 +15,7 @@
 #include "td/telegram/AnimationsManager.h"
 #include "td/telegram/AudiosManager.h"
 #include "td/telegram/AuthManager.h"
+#include "td/telegram/ConfigShared.h"
 #include "td/telegram/Contact.h"
 #include "td/telegram/ContactsManager.h"
 #include "td/telegram/Document.h"
@@ -161,23 +162,53 @@ class SetInlineBotResultsQuery : public Td::ResultHandler {
 };
 
 InlineQueriesManager::InlineQueriesManager(Td *td, ActorShared<> parent) : td_(td), parent_(std::move(parent)) {
-  drop_inline_query_result_timeout_.set_callback(on_drop_inline_query_result_timeout_callback);
-  drop_inline_query_result_timeout_.set_callback_data(static_cast<void *>(this));
 }
 
 void InlineQueriesManager::tear_down() {
   parent_.reset();
 }
 
-void InlineQueriesManager::on_drop_inline_query_result_timeout_callback(void *inline_queries_manager_ptr,
-                                                                        int64 query_hash) {
-  auto inline_queries_manager = static_cast<InlineQueriesManager *>(inline_queries_manager_ptr);
-  auto it = inline_queries_manager->inline_query_results_.find(query_hash);
-  CHECK(it != inline_queries_manager->inline_query_results_.end());
-  CHECK(it->second.results != nullptr);
-  CHECK(it->second.pending_request_count >= 0);
-  if (it->second.pending_request_count == 0) {
-    inline_queries_manager->inline_query_results_.erase(it);
+size_t InlineQueriesManager::get_inline_query_results_size(const td_api::inlineQueryResults &results) {
+  return sizeof(results) + results.next_offset_.size() + results.switch_pm_text_.size() +
+         results.switch_pm_parameter_.size() + results.results_.size() * INLINE_QUERY_RESULT_SIZE_ESTIMATE;
+}
+
+void InlineQueriesManager::add_unused_inline_query_result(uint64 query_hash) {
+  auto it = inline_query_results_.find(query_hash);
+  CHECK(it != inline_query_results_.end());
+  auto &result = it->second;
+  CHECK(result.pending_request_count == 0);
+  CHECK(result.last_access_id == 0);
+  result.last_access_id = ++last_inline_query_result_access_id_;
+  unused_inline_query_results_.emplace(result.last_access_id, query_hash);
+  unused_inline_query_results_size_ += result.size;
+
+  drop_unused_inline_query_results();
+}
+
+void InlineQueriesManager::remove_unused_inline_query_result(uint64 query_hash) {
+  auto it = inline_query_results_.find(query_hash);
+  CHECK(it != inline_query_results_.end());
+  auto &result = it->second;
+  if (result.last_access_id == 0) {
+    return;
+  }
+  auto is_deleted = unused_inline_query_results_.erase(result.last_access_id) > 0;
+  CHECK(is_deleted);
+  CHECK(unused_inline_query_results_size_ >= result.size);
+  unused_inline_query_results_size_ -= result.size;
+  result.last_access_id = 0;
+}
+
+void InlineQueriesManager::drop_unused_inline_query_results() {
+  auto max_size = G()->shared_config().get_option_integer("inline_query_results_cache_size_max",
+                                                          DEFAULT_INLINE_QUERY_RESULTS_CACHE_SIZE_MAX);
+  while (static_cast<int64>(unused_inline_query_results_size_) > max_size) {
+    CHECK(!unused_inline_query_results_.empty());
+    auto query_hash = unused_inline_query_results_.begin()->second;
+    LOG(INFO) << "Drop cache for least recently used inline query " << query_hash;
+    remove_unused_inline_query_result(query_hash);
+    inline_query_results_.erase(query_hash);
   }
 }
 
@@ -775,6 +806,7 @@ uint64 InlineQueriesManager::send_inline_query(UserId bot_user_id, DialogId dial
 
   auto it = inline_query_results_.find(query_hash);
   if (it != inline_query_results_.end()) {
+    remove_unused_inline_query_result(query_hash);
     it->second.pending_request_count++;
     if (Time::now() < it->second.cache_expire_time) {
       promise.set_value(Unit());
@@ -1086,13 +1118,14 @@ tl_object_ptr<td_api::inlineQueryResults> InlineQueriesManager::decrease_pending
     auto left_time = it->second.cache_expire_time - Time::now();
     if (left_time < 0) {
       LOG(INFO) << "Drop cache for inline query " << query_hash;
-      drop_inline_query_result_timeout_.cancel_timeout(static_cast<int64>(query_hash));
       auto result = std::move(it->second.results);
       inline_query_results_.erase(it);
       return result;
-    } else {
-      drop_inline_query_result_timeout_.set_timeout_at(static_cast<int64>(query_hash), it->second.cache_expire_time);
     }
+
+    auto result = copy(it->second.results);
+    add_unused_inline_query_result(query_hash);  // can drop the result
+    return result;
   }
   return copy(it->second.results);
 }
@@ -1589,6 +1622,7 @@ void InlineQueriesManager::on_get_inline_query_results(UserId bot_user_id, uint6
   it->second.results = make_tl_object<td_api::inlineQueryResults>(
       results->query_id_, results->next_offset_, std::move(output_results), switch_pm_text, switch_pm_parameter);
   it->second.cache_expire_time = Time::now() + results->cache_time_;
+  it->second.size = get_inline_query_results_size(*it->second.results);
 }
 
 vector<UserId> InlineQueriesManager::get_recent_inline_bots(Promise<Unit> &&promise) {
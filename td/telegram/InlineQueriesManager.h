@@ -12,7 +12,6 @@
 #include "td/actor/actor.h"
 #include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
-#include "td/actor/Timeout.h"
 
 #include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileId.h"
@@ -26,6 +25,7 @@
 #include "td/utils/common.h"
 #include "td/utils/Status.h"
 
+#include <map>
 #include <unordered_map>
 #include <utility>
 
@@ -105,7 +105,13 @@ class InlineQueriesManager : public Actor {
 
   tl_object_ptr<td_api::inlineQueryResults> decrease_pending_request_count(uint64 query_hash);
 
-  static void on_drop_inline_query_result_timeout_callback(void *inline_queries_manager_ptr, int64 query_hash);
+  static size_t get_inline_query_results_size(const td_api::inlineQueryResults &results);
+
+  void add_unused_inline_query_result(uint64 query_hash);
+
+  void remove_unused_inline_query_result(uint64 query_hash);
+
+  void drop_unused_inline_query_results();
 
   void loop() override;
 
@@ -134,11 +140,20 @@ class InlineQueriesManager : public Actor {
     tl_object_ptr<td_api::inlineQueryResults> results;
     double cache_expire_time;
     int32 pending_request_count;
+    size_t size = 0;            // estimated memory size of results
+    uint64 last_access_id = 0;  // non-zero only for unused results
   };
 
-  MultiTimeout drop_inline_query_result_timeout_{"DropInlineQueryResultTimeout"};
+  static constexpr size_t INLINE_QUERY_RESULT_SIZE_ESTIMATE = 1024;
+  static constexpr int64 DEFAULT_INLINE_QUERY_RESULTS_CACHE_SIZE_MAX = 10 << 20;
+
   std::unordered_map<uint64, InlineQueryResult> inline_query_results_;  // query_hash -> result
 
+  // unused results, which aren't awaited by requests, are dropped in LRU order when their total size is too big
+  std::map<uint64, uint64> unused_inline_query_results_;  // last_access_id -> query_hash
+  size_t unused_inline_query_results_size_ = 0;
+  uint64 last_inline_query_result_access_id_ = 0;
+
   std::unordered_map<int64, std::unordered_map<string, InlineMessageContent>>
       inline_message_contents_;  // query_id -> [result_id -> inline_message_content]
 
@@ -26,9 +26,11 @@
 #include "td/utils/misc.h"
 #include "td/utils/Status.h"
 
+#include <algorithm>
 #include <atomic>
 #include <limits>
 #include <map>
+#include <memory>
 #include <unordered_set>
 #include <utility>
 
@@ -43,8 +45,39 @@ struct LanguagePackManager::PluralizedString {
   string other_value_;
 };
 
+// immutable full language pack, which is shared between all databases having the same version of the language
+struct LanguagePackManager::LanguageStrings {
+  struct Entry {
+    Slice key_;
+    Slice values_[6];  // only the first value is used for ordinary strings
+    bool is_pluralized_ = false;
+
+    td_api::object_ptr<td_api::LanguagePackStringValue> get_value_object() const {
+      if (!is_pluralized_) {
+        return td_api::make_object<td_api::languagePackStringValueOrdinary>(values_[0].str());
+      }
+      return td_api::make_object<td_api::languagePackStringValuePluralized>(
+          values_[0].str(), values_[1].str(), values_[2].str(), values_[3].str(), values_[4].str(), values_[5].str());
+    }
+  };
+
+  string data_;
+  vector<Entry> entries_;  // sorted by key_
+
+  const Entry *find(Slice key) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), key,
+                               [](const Entry &entry, Slice key) { return entry.key_ < key; });
+    if (it == entries_.end() || it->key_ != key) {
+      return nullptr;
+    }
+    return &*it;
+  }
+};
+
 struct LanguagePackManager::Language {
   std::mutex mutex_;
+  string language_pack_;
+  string language_code_;
   std::atomic<int32> version_{-1};
   std::atomic<int32> key_count_{0};
   std::string base_language_code_;
@@ -55,7 +88,8 @@ struct LanguagePackManager::Language {
   std::unordered_map<string, string> ordinary_strings_;
   std::unordered_map<string, PluralizedString> pluralized_strings_;
   std::unordered_set<string> deleted_strings_;
-  SqliteKeyValue kv_;  // usages should be guarded by database_->mutex_
+  std::shared_ptr<const LanguageStrings> shared_strings_;  // if non-empty, replaces ordinary and pluralized strings
+  SqliteKeyValue kv_;                                       // usages should be guarded by database_->mutex_
 };
 
 struct LanguagePackManager::LanguageInfo {
@@ -120,6 +154,48 @@ bool LanguagePackManager::is_custom_language_code(Slice language_code) {
   return !language_code.empty() && language_code[0] == 'X';
 }
 
+void LanguagePackManager::get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) {
+  int64 string_count = 0;
+  int64 string_size = 0;
+  std::unordered_set<const LanguageStrings *> shared_strings;
+  std::lock_guard<std::mutex> database_lock(language_database_mutex_);
+  for (auto &database_it : language_databases_) {
+    auto database = database_it.second.get();
+    std::lock_guard<std::mutex> packs_lock(database->mutex_);
+    for (auto &pack_it : database->language_packs_) {
+      auto pack = pack_it.second.get();
+      std::lock_guard<std::mutex> languages_lock(pack->mutex_);
+      for (auto &language_it : pack->languages_) {
+        auto language = language_it.second.get();
+        std::lock_guard<std::mutex> language_lock(language->mutex_);
+        string_size += static_cast<int64>(sizeof(Language));
+        if (language->shared_strings_ != nullptr && shared_strings.insert(language->shared_strings_.get()).second) {
+          // shared strings are counted only once
+          string_size += static_cast<int64>(sizeof(LanguageStrings) + language->shared_strings_->data_.size() +
+                                            language->shared_strings_->entries_.size() * sizeof(LanguageStrings::Entry));
+          string_count += static_cast<int64>(language->shared_strings_->entries_.size());
+        }
+        for (auto &str : language->ordinary_strings_) {
+          string_size += static_cast<int64>(sizeof(str) + str.first.size() + str.second.size());
+        }
+        for (auto &str : language->pluralized_strings_) {
+          auto &value = str.second;
+          string_size += static_cast<int64>(sizeof(str) + str.first.size() + value.zero_value_.size() +
+                                            value.one_value_.size() + value.two_value_.size() +
+                                            value.few_value_.size() + value.many_value_.size() +
+                                            value.other_value_.size());
+        }
+        for (auto &str : language->deleted_strings_) {
+          string_size += static_cast<int64>(sizeof(str) + str.size());
+        }
+        string_count += static_cast<int64>(language->ordinary_strings_.size() + language->pluralized_strings_.size() +
+                                           language->deleted_strings_.size());
+      }
+    }
+  }
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>("language pack strings", string_count, string_size));
+}
+
 static Result<SqliteDb> open_database(const string &path) {
   TRY_RESULT(database, SqliteDb::open_with_key(path, DbKey::empty()));
   TRY_STATUS(database.exec("PRAGMA synchronous=NORMAL"));
@@ -628,6 +704,8 @@ LanguagePackManager::Language *LanguagePackManager::add_language(LanguageDatabas
   auto code_it = pack->languages_.find(language_code);
   if (code_it == pack->languages_.end()) {
     auto language = make_unique<Language>();
+    language->language_pack_ = language_pack;
+    language->language_code_ = language_code;
     if (!database->database_.empty()) {
       language->kv_
           .init_with_connection(database->database_.clone(), get_database_table_name(language_pack, language_code))
@@ -645,6 +723,9 @@ LanguagePackManager::Language *LanguagePackManager::add_language(LanguageDatabas
 }
 
 bool LanguagePackManager::language_has_string_unsafe(const Language *language, const string &key) {
+  if (language->shared_strings_ != nullptr) {
+    return true;  // the language is full
+  }
   return language->ordinary_strings_.count(key) != 0 || language->pluralized_strings_.count(key) != 0 ||
          language->deleted_strings_.count(key) != 0;
 }
@@ -669,6 +750,102 @@ bool LanguagePackManager::language_has_strings(Language *language, const vector<
   return true;
 }
 
+void LanguagePackManager::share_language_strings_unsafe(Language *language) {
+  CHECK(language->is_full_);
+  if (language->shared_strings_ != nullptr || is_custom_language_code(language->language_code_) ||
+      language->version_ < 0) {
+    // custom languages are changed locally, so they can differ between databases even with the same version
+    return;
+  }
+
+  auto key = PSTRING() << language->language_pack_ << '\x00' << language->language_code_ << '\x00'
+                       << language->version_.load();
+  size_t string_count = language->ordinary_strings_.size() + language->pluralized_strings_.size();
+
+  std::lock_guard<std::mutex> lock(shared_language_strings_mutex_);
+  auto &weak_strings = shared_language_strings_[key];
+  auto strings = weak_strings.lock();
+  if (strings == nullptr || strings->entries_.size() != string_count) {
+    auto new_strings = std::make_shared<LanguageStrings>();
+    size_t data_size = 0;
+    for (auto &str : language->ordinary_strings_) {
+      data_size += str.first.size() + str.second.size();
+    }
+    for (auto &str : language->pluralized_strings_) {
+      auto &value = str.second;
+      data_size += str.first.size() + value.zero_value_.size() + value.one_value_.size() + value.two_value_.size() +
+                   value.few_value_.size() + value.many_value_.size() + value.other_value_.size();
+    }
+
+    // all strings are stored in one buffer, which must not be reallocated after slices to it are created
+    auto &data = new_strings->data_;
+    data.reserve(data_size);
+    auto append = [&data](const string &str) {
+      auto begin = data.size();
+      data += str;
+      return Slice(data.data() + begin, str.size());
+    };
+    new_strings->entries_.reserve(string_count);
+    for (auto &str : language->ordinary_strings_) {
+      LanguageStrings::Entry entry;
+      entry.key_ = append(str.first);
+      entry.values_[0] = append(str.second);
+      new_strings->entries_.push_back(entry);
+    }
+    for (auto &str : language->pluralized_strings_) {
+      auto &value = str.second;
+      LanguageStrings::Entry entry;
+      entry.key_ = append(str.first);
+      entry.values_[0] = append(value.zero_value_);
+      entry.values_[1] = append(value.one_value_);
+      entry.values_[2] = append(value.two_value_);
+      entry.values_[3] = append(value.few_value_);
+      entry.values_[4] = append(value.many_value_);
+      entry.values_[5] = append(value.other_value_);
+      entry.is_pluralized_ = true;
+      new_strings->entries_.push_back(entry);
+    }
+    CHECK(data.size() == data_size);
+    std::sort(new_strings->entries_.begin(), new_strings->entries_.end(),
+              [](const LanguageStrings::Entry &lhs, const LanguageStrings::Entry &rhs) { return lhs.key_ < rhs.key_; });
+
+    strings = std::move(new_strings);
+    weak_strings = strings;
+
+    for (auto it = shared_language_strings_.begin(); it != shared_language_strings_.end();) {
+      if (it->second.expired()) {
+        it = shared_language_strings_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    LOG(INFO) << "Share " << string_count << " strings of language " << language->language_code_ << " of version "
+              << language->version_.load();
+  }
+
+  language->shared_strings_ = std::move(strings);
+  std::unordered_map<string, string>().swap(language->ordinary_strings_);
+  std::unordered_map<string, PluralizedString>().swap(language->pluralized_strings_);
+}
+
+void LanguagePackManager::unshare_language_strings_unsafe(Language *language) {
+  if (language->shared_strings_ == nullptr) {
+    return;
+  }
+
+  auto strings = std::move(language->shared_strings_);
+  language->shared_strings_ = nullptr;
+  for (auto &entry : strings->entries_) {
+    if (entry.is_pluralized_) {
+      language->pluralized_strings_.emplace(
+          entry.key_.str(), PluralizedString{entry.values_[0].str(), entry.values_[1].str(), entry.values_[2].str(),
+                                             entry.values_[3].str(), entry.values_[4].str(), entry.values_[5].str()});
+    } else {
+      language->ordinary_strings_.emplace(entry.key_.str(), entry.values_[0].str());
+    }
+  }
+}
+
 void LanguagePackManager::load_language_string_unsafe(Language *language, const string &key, const string &value) {
   CHECK(is_valid_key(key));
   if (value[0] == '1') {
@@ -733,6 +910,7 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
 
     language->is_full_ = true;
     language->deleted_strings_.clear();
+    share_language_strings_unsafe(language);
     return true;
   }
 
@@ -788,6 +966,13 @@ td_api::object_ptr<td_api::languagePackString> LanguagePackManager::get_language
 td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_language_pack_string_value_object(
     const Language *language, const string &key) {
   CHECK(language != nullptr);
+  if (language->shared_strings_ != nullptr) {
+    auto entry = language->shared_strings_->find(key);
+    if (entry != nullptr) {
+      return entry->get_value_object();
+    }
+    return get_language_pack_string_value_object();
+  }
   auto ordinary_it = language->ordinary_strings_.find(key);
   if (ordinary_it != language->ordinary_strings_.end()) {
     return get_language_pack_string_value_object(ordinary_it->second);
@@ -809,9 +994,18 @@ td_api::object_ptr<td_api::languagePackStrings> LanguagePackManager::get_languag
     Language *language, const vector<string> &keys) {
   CHECK(language != nullptr);
 
-  std::lock_guard<std::mutex> lock(language->mutex_);
+  std::unique_lock<std::mutex> lock(language->mutex_);
   vector<td_api::object_ptr<td_api::languagePackString>> strings;
-  if (keys.empty()) {
+  if (keys.empty() && language->shared_strings_ != nullptr) {
+    // shared strings are immutable, so they can be accessed without the lock
+    auto shared_strings = language->shared_strings_;
+    lock.unlock();
+
+    strings.reserve(shared_strings->entries_.size());
+    for (auto &entry : shared_strings->entries_) {
+      strings.push_back(td_api::make_object<td_api::languagePackString>(entry.key_.str(), entry.get_value_object()));
+    }
+  } else if (keys.empty()) {
     for (auto &str : language->ordinary_strings_) {
       strings.push_back(get_language_pack_string_object(str));
     }
@@ -1355,6 +1549,7 @@ void LanguagePackManager::on_get_language_pack_strings(
     std::lock_guard<std::mutex> lock(language->mutex_);
     int32 key_count_delta = 0;
     if (language->version_ < version || !keys.empty()) {
+      unshare_language_strings_unsafe(language);
       vector<td_api::object_ptr<td_api::languagePackString>> strings;
       if (language->version_ < version) {
         LOG(INFO) << "Set language pack " << language_code << " version to " << version;
@@ -1452,6 +1647,9 @@ void LanguagePackManager::on_get_language_pack_strings(
         language->deleted_strings_.clear();
       }
       new_is_full = language->is_full_;
+      if (new_is_full) {
+        share_language_strings_unsafe(language);
+      }
     }
   }
   if (is_custom_language_code(language_code) && new_database_version == -1) {
@@ -1846,6 +2044,7 @@ Status LanguagePackManager::do_delete_language(string language_code) {
   language->version_ = -1;
   language->key_count_ = load_database_language_key_count(&language->kv_);
   language->is_full_ = false;
+  language->shared_strings_ = nullptr;
   language->ordinary_strings_.clear();
   language->pluralized_strings_.clear();
   language->deleted_strings_.clear();
@@ -1877,5 +2076,8 @@ void LanguagePackManager::hangup() {
 int32 LanguagePackManager::manager_count_ = 0;
 std::mutex LanguagePackManager::language_database_mutex_;
 std::unordered_map<string, unique_ptr<LanguagePackManager::LanguageDatabase>> LanguagePackManager::language_databases_;
+std::mutex LanguagePackManager::shared_language_strings_mutex_;
+std::unordered_map<string, std::weak_ptr<const LanguagePackManager::LanguageStrings>>
+    LanguagePackManager::shared_language_strings_;
 
 }  // namespace td
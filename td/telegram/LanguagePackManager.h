@@ -19,6 +19,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
@@ -43,6 +44,9 @@ class LanguagePackManager : public NetQueryCallback {
 
   static bool is_custom_language_code(Slice language_code);
 
+  // language packs are shared between all TDLib instances
+  static void get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries);
+
   string get_main_language_code();
 
   vector<string> get_used_language_codes();
@@ -85,6 +89,7 @@ class LanguagePackManager : public NetQueryCallback {
 
  private:
   struct PluralizedString;
+  struct LanguageStrings;
   struct Language;
   struct LanguageInfo;
   struct LanguagePack;
@@ -108,6 +113,9 @@ class LanguagePackManager : public NetQueryCallback {
   static std::mutex language_database_mutex_;
   static std::unordered_map<string, unique_ptr<LanguageDatabase>> language_databases_;
 
+  static std::mutex shared_language_strings_mutex_;
+  static std::unordered_map<string, std::weak_ptr<const LanguageStrings>> shared_language_strings_;
+
   static LanguageDatabase *add_language_database(const string &path);
 
   static Language *get_language(LanguageDatabase *database, const string &language_pack, const string &language_code);
@@ -118,6 +126,9 @@ class LanguagePackManager : public NetQueryCallback {
   static bool language_has_string_unsafe(const Language *language, const string &key);
   static bool language_has_strings(Language *language, const vector<string> &keys);
 
+  static void share_language_strings_unsafe(Language *language);
+  static void unshare_language_strings_unsafe(Language *language);
+
   static void load_language_string_unsafe(Language *language, const string &key, const string &value);
   static bool load_language_strings(LanguageDatabase *database, Language *language, const vector<string> &keys);
 
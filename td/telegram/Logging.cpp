@@ -29,6 +29,7 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/AsyncFileLog.h"
 #include "td/utils/ExitGuard.h"
 #include "td/utils/FileLog.h"
 #include "td/utils/logging.h"
@@ -43,6 +44,7 @@ namespace td {
 
 static std::mutex logging_mutex;
 static FileLog file_log;
+static AsyncFileLog async_file_log;
 static TsLog ts_log(&file_log);
 static NullLog null_log;
 static ExitGuard exit_guard;
@@ -80,6 +82,20 @@ Status Logging::set_current_stream(td_api::object_ptr<td_api::LogStream> stream)
       log_interface = &ts_log;
       return Status::OK();
     }
+    case td_api::logStreamAsyncFile::ID: {
+      auto file_stream = td_api::move_object_as<td_api::logStreamAsyncFile>(stream);
+      auto max_log_file_size = file_stream->max_file_size_;
+      if (max_log_file_size <= 0) {
+        return Status::Error("Max log file size must be positive");
+      }
+      auto overflow_policy =
+          file_stream->drop_on_overflow_ ? AsyncFileLog::OverflowPolicy::Drop : AsyncFileLog::OverflowPolicy::Block;
+
+      TRY_STATUS(async_file_log.init(file_stream->path_, max_log_file_size, file_stream->redirect_stderr_,
+                                     overflow_policy));
+      log_interface = &async_file_log;
+      return Status::OK();
+    }
     case td_api::logStreamEmpty::ID:
       log_interface = &null_log;
       return Status::OK();
@@ -101,6 +117,11 @@ Result<td_api::object_ptr<td_api::LogStream>> Logging::get_current_stream() {
     return td_api::make_object<td_api::logStreamFile>(file_log.get_path().str(), file_log.get_rotate_threshold(),
                                                       file_log.get_redirect_stderr());
   }
+  if (log_interface == &async_file_log) {
+    return td_api::make_object<td_api::logStreamAsyncFile>(
+        async_file_log.get_path(), async_file_log.get_rotate_threshold(), async_file_log.get_redirect_stderr(),
+        async_file_log.get_overflow_policy() == AsyncFileLog::OverflowPolicy::Drop);
+  }
   return Status::Error("Log stream is unrecognized");
 }
 
@@ -1369,6 +1369,10 @@ void store_message_content(const MessageContent *content, LogEventStorerUnsafe &
   store(content, storer);
 }
 
+void store_message_content(const MessageContent *content, LogEventStorerGrowable &storer) {
+  store(content, storer);
+}
+
 void parse_message_content(unique_ptr<MessageContent> &content, LogEventParser &parser) {
   parse(content, parser);
 }
@@ -4044,12 +4048,17 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
     thumbnail_file_id = get_message_content_thumbnail_file_id(content, td);
   }
   auto replace_caption = type == MessageContentDupType::Copy && copy_options.replace_caption;
+  // the old caption isn't copied if it is replaced anyway
+  auto dup_caption = [&copy_options, replace_caption](const FormattedText &caption) -> FormattedText {
+    if (replace_caption) {
+      return std::move(copy_options.new_caption);
+    }
+    return caption;
+  };
   switch (content->get_type()) {
     case MessageContentType::Animation: {
-      auto result = make_unique<MessageAnimation>(*static_cast<const MessageAnimation *>(content));
-      if (replace_caption) {
-        result->caption = std::move(copy_options.new_caption);
-      }
+      auto old_content = static_cast<const MessageAnimation *>(content);
+      auto result = make_unique<MessageAnimation>(old_content->file_id, dup_caption(old_content->caption));
       if (td->documents_manager_->has_input_media(result->file_id, thumbnail_file_id, to_secret)) {
         return std::move(result);
       }
@@ -4058,10 +4067,8 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
       return std::move(result);
     }
     case MessageContentType::Audio: {
-      auto result = make_unique<MessageAudio>(*static_cast<const MessageAudio *>(content));
-      if (replace_caption) {
-        result->caption = std::move(copy_options.new_caption);
-      }
+      auto old_content = static_cast<const MessageAudio *>(content);
+      auto result = make_unique<MessageAudio>(old_content->file_id, dup_caption(old_content->caption));
       if (td->documents_manager_->has_input_media(result->file_id, thumbnail_file_id, to_secret)) {
         return std::move(result);
       }
@@ -4079,10 +4086,8 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
       return std::move(result);
     }
     case MessageContentType::Document: {
-      auto result = make_unique<MessageDocument>(*static_cast<const MessageDocument *>(content));
-      if (replace_caption) {
-        result->caption = std::move(copy_options.new_caption);
-      }
+      auto old_content = static_cast<const MessageDocument *>(content);
+      auto result = make_unique<MessageDocument>(old_content->file_id, dup_caption(old_content->caption));
       if (td->documents_manager_->has_input_media(result->file_id, thumbnail_file_id, to_secret)) {
         return std::move(result);
       }
@@ -4103,10 +4108,8 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
     case MessageContentType::Location:
       return make_unique<MessageLocation>(*static_cast<const MessageLocation *>(content));
     case MessageContentType::Photo: {
-      auto result = make_unique<MessagePhoto>(*static_cast<const MessagePhoto *>(content));
-      if (replace_caption) {
-        result->caption = std::move(copy_options.new_caption);
-      }
+      auto old_content = static_cast<const MessagePhoto *>(content);
+      auto result = make_unique<MessagePhoto>(Photo(old_content->photo), dup_caption(old_content->caption));
 
       CHECK(!result->photo.photos.empty());
       if ((result->photo.photos.size() > 2 || result->photo.photos.back().type != 'i') && !to_secret) {
@@ -4184,10 +4187,8 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
     case MessageContentType::Venue:
       return make_unique<MessageVenue>(*static_cast<const MessageVenue *>(content));
     case MessageContentType::Video: {
-      auto result = make_unique<MessageVideo>(*static_cast<const MessageVideo *>(content));
-      if (replace_caption) {
-        result->caption = std::move(copy_options.new_caption);
-      }
+      auto old_content = static_cast<const MessageVideo *>(content);
+      auto result = make_unique<MessageVideo>(old_content->file_id, dup_caption(old_content->caption));
       if (td->documents_manager_->has_input_media(result->file_id, thumbnail_file_id, to_secret)) {
         return std::move(result);
       }
@@ -4206,11 +4207,8 @@ unique_ptr<MessageContent> dup_message_content(Td *td, DialogId dialog_id, const
       return std::move(result);
     }
     case MessageContentType::VoiceNote: {
-      auto result = make_unique<MessageVoiceNote>(*static_cast<const MessageVoiceNote *>(content));
-      if (replace_caption) {
-        result->caption = std::move(copy_options.new_caption);
-      }
-      result->is_listened = false;
+      auto old_content = static_cast<const MessageVoiceNote *>(content);
+      auto result = make_unique<MessageVoiceNote>(old_content->file_id, dup_caption(old_content->caption), false);
       if (td->documents_manager_->has_input_media(result->file_id, thumbnail_file_id, to_secret)) {
         return std::move(result);
       }
@@ -82,6 +82,8 @@ void store_message_content(const MessageContent *content, LogEventStorerCalcLeng
 
 void store_message_content(const MessageContent *content, LogEventStorerUnsafe &storer);
 
+void store_message_content(const MessageContent *content, LogEventStorerGrowable &storer);
+
 void parse_message_content(unique_ptr<MessageContent> &content, LogEventParser &parser);
 
 InlineMessageContent create_inline_message_content(Td *td, FileId file_id,
@@ -777,6 +777,10 @@ bool is_email_address(Slice str) {
   Slice userdata;
   Slice domain;
   std::tie(userdata, domain) = split(str, '@');
+  if (domain.empty()) {
+    // fast path for URLs
+    return false;
+  }
   vector<Slice> userdata_parts;
   size_t prev = 0;
   for (size_t i = 0; i < userdata.size(); i++) {
@@ -1416,38 +1420,18 @@ vector<MessageEntity> find_entities(Slice text, bool skip_bot_commands, bool onl
 
   remove_intersecting_entities(entities);
 
-  // fix offsets to UTF-16 offsets
-  const unsigned char *begin = text.ubegin();
-  const unsigned char *ptr = begin;
-  const unsigned char *end = text.uend();
-
+  // fix offsets to UTF-16 offsets; the entities are non-intersecting, so each part of the text is visited once
+  size_t pos = 0;
   int32 utf16_pos = 0;
   for (auto &entity : entities) {
-    int cnt = 2;
-    auto entity_begin = entity.offset;
-    auto entity_end = entity.offset + entity.length;
-
-    int32 pos = static_cast<int32>(ptr - begin);
-    if (entity_begin == pos) {
-      cnt--;
-      entity.offset = utf16_pos;
-    }
-
-    while (ptr != end && cnt > 0) {
-      unsigned char c = ptr[0];
-      utf16_pos += 1 + (c >= 0xf0);
-      ptr = next_utf8_unsafe(ptr, nullptr, "find_entities");
-
-      pos = static_cast<int32>(ptr - begin);
-      if (entity_begin == pos) {
-        cnt--;
-        entity.offset = utf16_pos;
-      } else if (entity_end == pos) {
-        cnt--;
-        entity.length = utf16_pos - entity.offset;
-      }
-    }
-    CHECK(cnt == 0);
+    auto entity_begin = static_cast<size_t>(entity.offset);
+    auto entity_end = entity_begin + static_cast<size_t>(entity.length);
+    CHECK(pos <= entity_begin && entity_end <= text.size());
+    utf16_pos += text_length(Slice(text.begin() + pos, text.begin() + entity_begin));
+    entity.offset = utf16_pos;
+    entity.length = text_length(Slice(text.begin() + entity_begin, text.begin() + entity_end));
+    utf16_pos += entity.length;
+    pos = entity_end;
   }
 
   return entities;
@@ -1705,6 +1689,22 @@ Result<vector<MessageEntity>> parse_markdown(string &text) {
   return entities;
 }
 
+static bool has_markdown_v2_special_characters(Slice text) {
+  static const auto is_special_character = [] {
+    std::array<bool, 256> result{};
+    for (auto c : Slice("\\_*[]()~`>#+-=|{}.!")) {
+      result[static_cast<unsigned char>(c)] = true;
+    }
+    return result;
+  }();
+  for (auto c : text) {
+    if (is_special_character[static_cast<unsigned char>(c)]) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static Result<vector<MessageEntity>> do_parse_markdown_v2(CSlice text, string &result) {
   vector<MessageEntity> entities;
   int32 utf16_offset = 0;
@@ -1916,9 +1916,15 @@ static Result<vector<MessageEntity>> do_parse_markdown_v2(CSlice text, string &r
 }
 
 Result<vector<MessageEntity>> parse_markdown_v2(string &text) {
+  if (!has_markdown_v2_special_characters(text)) {
+    // fast path: text without any markup is returned as is
+    return vector<MessageEntity>();
+  }
+
   string result;
+  result.reserve(text.size());  // the parsed text is never longer than the source
   TRY_RESULT(entities, do_parse_markdown_v2(text, result));
-  text = result;
+  text = std::move(result);
   return entities;
 }
 
@@ -2878,14 +2884,20 @@ static Result<vector<MessageEntity>> do_parse_html(CSlice text, string &result)
 }
 
 Result<vector<MessageEntity>> parse_html(string &text) {
+  if (text.find_first_of("<&") == string::npos) {
+    // fast path: text without tags and character references is returned as is
+    return vector<MessageEntity>();
+  }
+
   string result;
+  result.reserve(text.size());  // the parsed text is never longer than the source
   TRY_RESULT(entities, do_parse_html(text, result));
   if (!check_utf8(result)) {
     return Status::Error(400,
                          "Text contains invalid Unicode characters after decoding HTML entities, check for unmatched "
                          "surrogate code units");
   }
-  text = result;
+  text = std::move(result);
   return entities;
 }
 
@@ -15,6 +15,7 @@
 #include "td/db/SqliteStatement.h"
 
 #include "td/actor/actor.h"
+#include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
 #include "td/actor/SchedulerLocalStorage.h"
 
@@ -31,15 +32,38 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <iterator>
 #include <limits>
 #include <tuple>
+#include <unordered_map>
 
 namespace td {
 
 static constexpr int32 MESSAGES_DB_INDEX_COUNT = 30;
 static constexpr int32 MESSAGES_DB_INDEX_COUNT_OLD = 9;
 
+static std::tuple<MessageId, int32> get_message_info(Slice message) {
+  LogEventParser message_date_parser(message);
+  int32 flags;
+  td::parse(flags, message_date_parser);
+  int32 flags2 = 0;
+  if ((flags & (1 << 29)) != 0) {
+    td::parse(flags2, message_date_parser);
+  }
+  bool has_sender = (flags >> 10) & 1;
+  MessageId message_id;
+  td::parse(message_id, message_date_parser);
+  UserId sender_user_id;
+  if (has_sender) {
+    td::parse(sender_user_id, message_date_parser);
+  }
+  int32 date;
+  td::parse(date, message_date_parser);
+  LOG(INFO) << "Loaded " << message_id << " sent at " << date << " by " << sender_user_id;
+  return std::make_tuple(message_id, date);
+}
+
 // NB: must happen inside a transaction
 Status init_messages_db(SqliteDb &db, int32 version) {
   LOG(INFO) << "Init message database " << tag("version", version);
@@ -53,6 +77,61 @@ Status init_messages_db(SqliteDb &db, int32 version) {
     version = 0;
   }
 
+  // message_media_index contains a row for each message and each media type of the message. It is much smaller
+  // than the messages table and is clustered by media type, so shared media pagination and counting is cheap
+  auto add_media_index_table = [&db] {
+    TRY_STATUS(
+        db.exec("CREATE TABLE IF NOT EXISTS message_media_index (dialog_id INT8, index_type INT4, message_id INT8, "
+                "date INT4, PRIMARY KEY (dialog_id, index_type, message_id)) WITHOUT ROWID"));
+
+    string index_types;
+    for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
+      if (i != 0) {
+        index_types += ", ";
+      }
+      index_types += to_string(i);
+    }
+    TRY_STATUS(db.exec(PSLICE() << "CREATE TRIGGER IF NOT EXISTS trigger_media_index_delete AFTER DELETE ON messages "
+                                   "WHEN OLD.index_mask IS NOT NULL BEGIN DELETE FROM message_media_index WHERE "
+                                   "dialog_id = OLD.dialog_id AND index_type IN ("
+                                << index_types << ") AND message_id = OLD.message_id; END"));
+    return Status::OK();
+  };
+  auto fill_media_index_table = [&db] {
+    TRY_RESULT(get_stmt,
+               db.get_statement("SELECT dialog_id, message_id, index_mask, data FROM messages WHERE index_mask IS NOT "
+                                "NULL AND index_mask != 0"));
+    TRY_RESULT(add_stmt, db.get_statement("INSERT OR REPLACE INTO message_media_index VALUES(?1, ?2, ?3, ?4)"));
+    int32 message_count = 0;
+    TRY_STATUS(get_stmt.step());
+    while (get_stmt.has_row()) {
+      auto dialog_id = get_stmt.view_int64(0);
+      auto message_id = get_stmt.view_int64(1);
+      auto index_mask = get_stmt.view_int32(2);
+      auto date = std::get<1>(get_message_info(get_stmt.view_blob(3)));
+      for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
+        if ((index_mask & (1 << i)) != 0) {
+          add_stmt.bind_int64(1, dialog_id).ensure();
+          add_stmt.bind_int32(2, i).ensure();
+          add_stmt.bind_int64(3, message_id).ensure();
+          add_stmt.bind_int32(4, date).ensure();
+          TRY_STATUS(add_stmt.step());
+          add_stmt.reset();
+        }
+      }
+      message_count++;
+      TRY_STATUS(get_stmt.step());
+    }
+    LOG(INFO) << "Add " << message_count << " messages to message_media_index";
+    return Status::OK();
+  };
+  auto drop_media_indices = [&db] {
+    for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
+      TRY_STATUS(db.exec(PSLICE() << "DROP INDEX IF EXISTS message_index_" << i));
+    }
+    return Status::OK();
+  };
+
   auto add_media_indices = [&db](int begin, int end) {
     for (int i = begin; i < end; i++) {
       TRY_STATUS(db.exec(PSLICE() << "CREATE INDEX IF NOT EXISTS message_index_" << i
@@ -62,20 +141,21 @@ Status init_messages_db(SqliteDb &db, int32 version) {
     return Status::OK();
   };
 
-  auto add_fts = [&db] {
-    TRY_STATUS(
-        db.exec("CREATE INDEX IF NOT EXISTS message_by_search_id ON messages "
-                "(search_id) WHERE search_id IS NOT NULL"));
+  // new messages are added to messages_fts_queue and are indexed later in batches by index_messages_fts
+  auto add_fts_queue = [&db] {
+    TRY_STATUS(db.exec("CREATE TABLE IF NOT EXISTS messages_fts_queue (search_id INT8 PRIMARY KEY)"));
 
-    TRY_STATUS(
-        db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(text, content='messages', "
-                "content_rowid='search_id', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")"));
+    TRY_STATUS(db.exec("DROP TRIGGER IF EXISTS trigger_fts_delete"));
+    TRY_STATUS(db.exec("DROP TRIGGER IF EXISTS trigger_fts_insert"));
+    // a message, which isn't indexed yet, must not be deleted from messages_fts
     TRY_STATUS(db.exec(
         "CREATE TRIGGER IF NOT EXISTS trigger_fts_delete BEFORE DELETE ON messages WHEN OLD.search_id IS NOT NULL"
-        " BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) VALUES(\'delete\', OLD.search_id, OLD.text); END"));
+        " BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) SELECT \'delete\', OLD.search_id, OLD.text WHERE "
+        "NOT EXISTS (SELECT 1 FROM messages_fts_queue WHERE search_id = OLD.search_id); "
+        "DELETE FROM messages_fts_queue WHERE search_id = OLD.search_id; END"));
     TRY_STATUS(db.exec(
         "CREATE TRIGGER IF NOT EXISTS trigger_fts_insert AFTER INSERT ON messages WHEN NEW.search_id IS NOT NULL"
-        " BEGIN INSERT INTO messages_fts(rowid, text) VALUES(NEW.search_id, NEW.text); END"));
+        " BEGIN INSERT INTO messages_fts_queue VALUES(NEW.search_id); END"));
     //TRY_STATUS(db.exec(
     //"CREATE TRIGGER IF NOT EXISTS trigger_fts_update AFTER UPDATE ON messages WHEN NEW.search_id IS NOT NULL OR "
     //"OLD.search_id IS NOT NULL"
@@ -86,6 +166,17 @@ Status init_messages_db(SqliteDb &db, int32 version) {
 
     return Status::OK();
   };
+  auto add_fts = [&db, &add_fts_queue] {
+    TRY_STATUS(
+        db.exec("CREATE INDEX IF NOT EXISTS message_by_search_id ON messages "
+                "(search_id) WHERE search_id IS NOT NULL"));
+
+    TRY_STATUS(
+        db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(text, content='messages', "
+                "content_rowid='search_id', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")"));
+
+    return add_fts_queue();
+  };
   auto add_call_index = [&db] {
     for (int i = static_cast<int>(MessageSearchFilter::Call) - 1; i < static_cast<int>(MessageSearchFilter::MissedCall);
          i++) {
@@ -129,7 +220,7 @@ Status init_messages_db(SqliteDb &db, int32 version) {
         db.exec("CREATE INDEX IF NOT EXISTS message_by_ttl ON messages "
                 "(ttl_expires_at) WHERE ttl_expires_at IS NOT NULL"));
 
-    TRY_STATUS(add_media_indices(0, MESSAGES_DB_INDEX_COUNT));
+    TRY_STATUS(add_media_index_table());
 
     TRY_STATUS(add_fts());
 
@@ -166,6 +257,14 @@ Status init_messages_db(SqliteDb &db, int32 version) {
   if (version < static_cast<int32>(DbVersion::AddMessageThreadSupport)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN top_thread_message_id INT8"));
   }
+  if (version < static_cast<int32>(DbVersion::AddMessagesFtsQueue)) {
+    TRY_STATUS(add_fts_queue());
+  }
+  if (version < static_cast<int32>(DbVersion::AddMessageMediaIndexTable)) {
+    TRY_STATUS(add_media_index_table());
+    TRY_STATUS(fill_media_index_table());
+    TRY_STATUS(drop_media_indices());
+  }
   return Status::OK();
 }
 
@@ -173,6 +272,8 @@ Status init_messages_db(SqliteDb &db, int32 version) {
 Status drop_messages_db(SqliteDb &db, int32 version) {
   LOG(WARNING) << "Drop message database " << tag("version", version)
                << tag("current_db_version", current_db_version());
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS messages_fts_queue"));
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS message_media_index"));
   return db.exec("DROP TABLE IF EXISTS messages");
 }
 
@@ -186,6 +287,8 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     TRY_RESULT_ASSIGN(
         add_message_stmt_,
         db_.get_statement("INSERT OR REPLACE INTO messages VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12)"));
+    TRY_RESULT_ASSIGN(update_message_data_stmt_,
+                      db_.get_statement("UPDATE messages SET data = ?3 WHERE dialog_id = ?1 AND message_id = ?2"));
     TRY_RESULT_ASSIGN(delete_message_stmt_,
                       db_.get_statement("DELETE FROM messages WHERE dialog_id = ?1 AND message_id = ?2"));
     TRY_RESULT_ASSIGN(delete_all_dialog_messages_stmt_,
@@ -224,21 +327,46 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
         db_.get_statement(
             "SELECT dialog_id, data, search_id FROM messages WHERE search_id IN (SELECT rowid FROM messages_fts WHERE "
             "messages_fts MATCH ?1 AND rowid < ?2 ORDER BY rowid DESC LIMIT ?3) ORDER BY search_id DESC"));
+    TRY_RESULT_ASSIGN(get_fts_queue_batch_stmt_,
+                      db_.get_statement("SELECT MAX(search_id), COUNT(*) FROM (SELECT search_id FROM "
+                                        "messages_fts_queue ORDER BY search_id LIMIT ?1) AS T"));
+    TRY_RESULT_ASSIGN(index_messages_fts_stmt_,
+                      db_.get_statement("INSERT INTO messages_fts(rowid, text) SELECT search_id, text FROM messages "
+                                        "WHERE search_id IN (SELECT search_id FROM messages_fts_queue WHERE "
+                                        "search_id <= ?1)"));
+    TRY_RESULT_ASSIGN(delete_fts_queue_batch_stmt_,
+                      db_.get_statement("DELETE FROM messages_fts_queue WHERE search_id <= ?1"));
 
     for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
-      TRY_RESULT_ASSIGN(get_messages_from_index_stmts_[i].desc_stmt_,
-                        db_.get_statement(PSLICE() << "SELECT data, message_id FROM messages WHERE dialog_id = ?1 "
-                                                      "AND message_id < ?2 AND (index_mask & "
-                                                   << (1 << i) << ") != 0 ORDER BY message_id DESC LIMIT ?3"));
+      // CROSS JOIN forces SQLite to scan message_media_index first
+      TRY_RESULT_ASSIGN(
+          get_messages_from_index_stmts_[i].desc_stmt_,
+          db_.get_statement(PSLICE() << "SELECT data, messages.message_id FROM message_media_index CROSS JOIN messages "
+                                        "ON messages.dialog_id = message_media_index.dialog_id AND messages.message_id "
+                                        "= message_media_index.message_id WHERE message_media_index.dialog_id = ?1 AND "
+                                        "index_type = "
+                                     << i
+                                     << " AND message_media_index.message_id < ?2 ORDER BY "
+                                        "message_media_index.message_id DESC LIMIT ?3"));
 
-      TRY_RESULT_ASSIGN(get_messages_from_index_stmts_[i].asc_stmt_,
-                        db_.get_statement(PSLICE() << "SELECT data, message_id FROM messages WHERE dialog_id = ?1 "
-                                                      "AND message_id > ?2 AND (index_mask & "
-                                                   << (1 << i) << ") != 0 ORDER BY message_id ASC LIMIT ?3"));
+      TRY_RESULT_ASSIGN(
+          get_messages_from_index_stmts_[i].asc_stmt_,
+          db_.get_statement(PSLICE() << "SELECT data, messages.message_id FROM message_media_index CROSS JOIN messages "
+                                        "ON messages.dialog_id = message_media_index.dialog_id AND messages.message_id "
+                                        "= message_media_index.message_id WHERE message_media_index.dialog_id = ?1 AND "
+                                        "index_type = "
+                                     << i
+                                     << " AND message_media_index.message_id > ?2 ORDER BY "
+                                        "message_media_index.message_id ASC LIMIT ?3"));
 
       // LOG(ERROR) << get_messages_from_index_stmts_[i].desc_stmt_.explain().ok();
       // LOG(ERROR) << get_messages_from_index_stmts_[i].asc_stmt_.explain().ok();
     }
+    TRY_RESULT_ASSIGN(add_media_index_stmt_,
+                      db_.get_statement("INSERT OR REPLACE INTO message_media_index VALUES(?1, ?2, ?3, ?4)"));
+    TRY_RESULT_ASSIGN(get_message_count_stmt_,
+                      db_.get_statement("SELECT COUNT(*) FROM message_media_index WHERE dialog_id = ?1 AND "
+                                        "index_type = ?2"));
 
     for (int i = static_cast<int>(MessageSearchFilter::Call) - 1, pos = 0;
          i < static_cast<int>(MessageSearchFilter::MissedCall); i++, pos++) {
@@ -354,6 +482,23 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
 
     add_message_stmt_.step().ensure();
 
+    if (index_mask != 0) {
+      SCOPE_EXIT {
+        add_media_index_stmt_.reset();
+      };
+      auto date = std::get<1>(get_message_info(data.as_slice()));
+      for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
+        if ((index_mask & (1 << i)) != 0) {
+          add_media_index_stmt_.bind_int64(1, dialog_id.get()).ensure();
+          add_media_index_stmt_.bind_int32(2, i).ensure();
+          add_media_index_stmt_.bind_int64(3, message_id.get()).ensure();
+          add_media_index_stmt_.bind_int32(4, date).ensure();
+          add_media_index_stmt_.step().ensure();
+          add_media_index_stmt_.reset();
+        }
+      }
+    }
+
     return Status::OK();
   }
 
@@ -382,6 +527,23 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     return Status::OK();
   }
 
+  Status update_message_data(FullMessageId full_message_id, BufferSlice data) override {
+    LOG(INFO) << "Update data of " << full_message_id << " in database";
+    auto dialog_id = full_message_id.get_dialog_id();
+    auto message_id = full_message_id.get_message_id();
+    CHECK(dialog_id.is_valid());
+    CHECK(message_id.is_valid());
+    SCOPE_EXIT {
+      update_message_data_stmt_.reset();
+    };
+    // unlike INSERT OR REPLACE, UPDATE doesn't fire delete triggers and doesn't touch indexes of other columns
+    update_message_data_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    update_message_data_stmt_.bind_int64(2, message_id.get()).ensure();
+    update_message_data_stmt_.bind_blob(3, data.as_slice()).ensure();
+    update_message_data_stmt_.step().ensure();
+    return Status::OK();
+  }
+
   Status delete_message(FullMessageId full_message_id) override {
     LOG(INFO) << "Delete " << full_message_id << " from database";
     auto dialog_id = full_message_id.get_dialog_id();
@@ -456,7 +618,7 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     }
     stmt.step().ensure();
     if (!stmt.has_row()) {
-      return Status::Error("Not found");
+      return STATIC_ERROR(0, "Not found");
     }
     return BufferSlice(stmt.view_blob(0));
   }
@@ -472,7 +634,7 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     get_message_by_unique_message_id_stmt_.bind_int32(1, unique_message_id.get()).ensure();
     get_message_by_unique_message_id_stmt_.step().ensure();
     if (!get_message_by_unique_message_id_stmt_.has_row()) {
-      return Status::Error("Not found");
+      return STATIC_ERROR(0, "Not found");
     }
     DialogId dialog_id(get_message_by_unique_message_id_stmt_.view_int64(0));
     return std::make_pair(dialog_id, BufferSlice(get_message_by_unique_message_id_stmt_.view_blob(1)));
@@ -486,7 +648,7 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     get_message_by_random_id_stmt_.bind_int64(2, random_id).ensure();
     get_message_by_random_id_stmt_.step().ensure();
     if (!get_message_by_random_id_stmt_.has_row()) {
-      return Status::Error("Not found");
+      return STATIC_ERROR(0, "Not found");
     }
     return BufferSlice(get_message_by_random_id_stmt_.view_blob(0));
   }
@@ -551,7 +713,7 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
       }
     }
 
-    return Status::Error("Not found");
+    return STATIC_ERROR(0, "Not found");
   }
 
   Result<std::pair<std::vector<std::pair<DialogId, BufferSlice>>, int32>> get_expiring_messages(int32 expires_from,
@@ -725,23 +887,66 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     return std::move(result);
   }
 
+  Result<int32> index_messages_fts(int32 limit) override {
+    int64 max_search_id;
+    int32 count;
+    {
+      SCOPE_EXIT {
+        get_fts_queue_batch_stmt_.reset();
+      };
+      get_fts_queue_batch_stmt_.bind_int32(1, limit).ensure();
+      TRY_STATUS(get_fts_queue_batch_stmt_.step());
+      CHECK(get_fts_queue_batch_stmt_.has_row());
+      count = get_fts_queue_batch_stmt_.view_int32(1);
+      if (count == 0) {
+        return 0;
+      }
+      max_search_id = get_fts_queue_batch_stmt_.view_int64(0);
+    }
+    LOG(INFO) << "Add " << count << " messages to the full-text search index";
+
+    SCOPE_EXIT {
+      index_messages_fts_stmt_.reset();
+      delete_fts_queue_batch_stmt_.reset();
+    };
+    index_messages_fts_stmt_.bind_int64(1, max_search_id).ensure();
+    TRY_STATUS(index_messages_fts_stmt_.step());
+    delete_fts_queue_batch_stmt_.bind_int64(1, max_search_id).ensure();
+    TRY_STATUS(delete_fts_queue_batch_stmt_.step());
+    return count;
+  }
+
   Result<std::vector<BufferSlice>> get_messages_from_index(DialogId dialog_id, MessageId from_message_id,
                                                            int32 index_mask, int32 offset, int32 limit) {
+    TRY_RESULT(index_i, get_index_type(index_mask));
+
+    auto &stmt = get_messages_from_index_stmts_[index_i];
+    return get_messages_impl(stmt, dialog_id, from_message_id, offset, limit);
+  }
+
+  static Result<int32> get_index_type(int32 index_mask) {
     CHECK(index_mask != 0);
     LOG_CHECK(index_mask < (1 << MESSAGES_DB_INDEX_COUNT)) << tag("index_mask", index_mask);
-    int index_i = -1;
-    for (int i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
+    for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
       if (index_mask == (1 << i)) {
-        index_i = i;
-        break;
+        return i;
       }
     }
-    if (index_i == -1) {
-      return Status::Error("Union is not supported");
-    }
+    return Status::Error("Union is not supported");
+  }
 
-    auto &stmt = get_messages_from_index_stmts_[index_i];
-    return get_messages_impl(stmt, dialog_id, from_message_id, offset, limit);
+  Result<int32> get_dialog_message_count(DialogId dialog_id, int32 index_mask) override {
+    CHECK(dialog_id.is_valid());
+    TRY_RESULT(index_i, get_index_type(index_mask));
+
+    SCOPE_EXIT {
+      get_message_count_stmt_.reset();
+    };
+    get_message_count_stmt_.bind_int64(1, dialog_id.get()).ensure();
+    get_message_count_stmt_.bind_int32(2, index_i).ensure();
+    TRY_STATUS(get_message_count_stmt_.step());
+    CHECK(get_message_count_stmt_.has_row());
+    return get_message_count_stmt_.view_int32(0);
   }
 
   Result<MessagesDbCallsResult> get_calls(MessagesDbCallsQuery query) override {
@@ -796,6 +1001,7 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
   SqliteDb db_;
 
   SqliteStatement add_message_stmt_;
+  SqliteStatement update_message_data_stmt_;
 
   SqliteStatement delete_message_stmt_;
   SqliteStatement delete_all_dialog_messages_stmt_;
@@ -816,9 +1022,14 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
   SqliteStatement get_messages_from_notification_id_stmt_;
 
   std::array<GetMessagesStmt, MESSAGES_DB_INDEX_COUNT> get_messages_from_index_stmts_;
+  SqliteStatement add_media_index_stmt_;
+  SqliteStatement get_message_count_stmt_;
   std::array<SqliteStatement, 2> get_calls_stmts_;
 
   SqliteStatement get_messages_fts_stmt_;
+  SqliteStatement get_fts_queue_batch_stmt_;
+  SqliteStatement index_messages_fts_stmt_;
+  SqliteStatement delete_fts_queue_batch_stmt_;
 
   SqliteStatement add_scheduled_message_stmt_;
   SqliteStatement get_scheduled_message_stmt_;
@@ -900,27 +1111,6 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
     }
     return std::move(result);
   }
-
-  static std::tuple<MessageId, int32> get_message_info(const BufferSlice &message) {
-    LogEventParser message_date_parser(message.as_slice());
-    int32 flags;
-    td::parse(flags, message_date_parser);
-    int32 flags2 = 0;
-    if ((flags & (1 << 29)) != 0) {
-      td::parse(flags2, message_date_parser);
-    }
-    bool has_sender = (flags >> 10) & 1;
-    MessageId message_id;
-    td::parse(message_id, message_date_parser);
-    UserId sender_user_id;
-    if (has_sender) {
-      td::parse(sender_user_id, message_date_parser);
-    }
-    int32 date;
-    td::parse(date, message_date_parser);
-    LOG(INFO) << "Loaded " << message_id << " sent at " << date << " by " << sender_user_id;
-    return std::make_tuple(message_id, date);
-  }
 };
 
 std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
@@ -944,8 +1134,10 @@ std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
 
 class MessagesDbAsync : public MessagesDbAsyncInterface {
  public:
-  MessagesDbAsync(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id) {
-    impl_ = create_actor_on_scheduler<Impl>("MessagesDbActor", scheduler_id, std::move(sync_db));
+  MessagesDbAsync(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id,
+                  vector<int32> read_scheduler_ids) {
+    impl_ = create_actor_on_scheduler<Impl>("MessagesDbActor", scheduler_id, std::move(sync_db),
+                                            std::move(read_scheduler_ids));
   }
 
   void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, UserId sender_user_id,
@@ -959,6 +1151,9 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
   void add_scheduled_message(FullMessageId full_message_id, BufferSlice data, Promise<> promise) override {
     send_closure_later(impl_, &Impl::add_scheduled_message, full_message_id, std::move(data), std::move(promise));
   }
+  void update_message_data(FullMessageId full_message_id, BufferSlice data, Promise<> promise) override {
+    send_closure_later(impl_, &Impl::update_message_data, full_message_id, std::move(data), std::move(promise));
+  }
 
   void delete_message(FullMessageId full_message_id, Promise<> promise) override {
     send_closure_later(impl_, &Impl::delete_message, full_message_id, std::move(promise));
@@ -997,6 +1192,9 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     send_closure_later(impl_, &Impl::get_messages_from_notification_id, dialog_id, from_notification_id, limit,
                        std::move(promise));
   }
+  void get_dialog_message_count(DialogId dialog_id, int32 index_mask, Promise<int32> promise) override {
+    send_closure_later(impl_, &Impl::get_dialog_message_count, dialog_id, index_mask, std::move(promise));
+  }
   void get_calls(MessagesDbCallsQuery query, Promise<MessagesDbCallsResult> promise) override {
     send_closure_later(impl_, &Impl::get_calls, std::move(query), std::move(promise));
   }
@@ -1018,14 +1216,46 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
   }
 
  private:
+  // executes read queries, which don't need to wait for pending writes
+  class Reader : public Actor {
+   public:
+    Reader(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe, std::shared_ptr<std::atomic<int32>> query_count)
+        : sync_db_safe_(std::move(sync_db_safe)), query_count_(std::move(query_count)) {
+    }
+
+    template <class T, class F>
+    void run_query(Promise<T> promise, F &&f) {
+      promise.set_result(f(sync_db_));
+      query_count_->fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void close(Promise<> promise) {
+      sync_db_safe_.reset();
+      sync_db_ = nullptr;
+      promise.set_value(Unit());
+      stop();
+    }
+
+   private:
+    std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe_;
+    MessagesDbSyncInterface *sync_db_ = nullptr;
+    std::shared_ptr<std::atomic<int32>> query_count_;
+
+    void start_up() override {
+      sync_db_ = &sync_db_safe_->get();
+    }
+  };
+
   class Impl : public Actor {
    public:
-    explicit Impl(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe) : sync_db_safe_(std::move(sync_db_safe)) {
+    Impl(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe, vector<int32> read_scheduler_ids)
+        : sync_db_safe_(std::move(sync_db_safe)), read_scheduler_ids_(std::move(read_scheduler_ids)) {
     }
     void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, UserId sender_user_id,
                      int64 random_id, int32 ttl_expires_at, int32 index_mask, int64 search_id, string text,
                      NotificationId notification_id, MessageId top_thread_message_id, BufferSlice data,
                      Promise<> promise) {
+      drop_message_data_update(full_message_id);
       add_write_query([this, full_message_id, unique_message_id, sender_user_id, random_id, ttl_expires_at, index_mask,
                        search_id, text = std::move(text), notification_id, top_thread_message_id,
                        data = std::move(data), promise = std::move(promise)](Unit) mutable {
@@ -1034,6 +1264,9 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
                                               ttl_expires_at, index_mask, search_id, std::move(text), notification_id,
                                               top_thread_message_id, std::move(data)));
       });
+      if (search_id != 0) {
+        add_fts_message();
+      }
     }
     void add_scheduled_message(FullMessageId full_message_id, BufferSlice data, Promise<> promise) {
       add_write_query([this, full_message_id, promise = std::move(promise), data = std::move(data)](Unit) mutable {
@@ -1041,7 +1274,23 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
       });
     }
 
+    void update_message_data(FullMessageId full_message_id, BufferSlice data, Promise<> promise) {
+      auto &update = pending_message_data_updates_[full_message_id];
+      if (update.promise) {
+        pending_write_results_.emplace_back(std::move(update.promise), Status::OK());
+      }
+      update.data = std::move(data);
+      update.promise = std::move(promise);
+      if (message_data_updates_flush_at_ == 0) {
+        message_data_updates_flush_at_ = Time::now_cached() + MAX_PENDING_MESSAGE_DATA_UPDATE_DELAY;
+        if (pending_writes_.empty()) {
+          set_pending_timeout();
+        }
+      }
+    }
+
     void delete_message(FullMessageId full_message_id, Promise<> promise) {
+      drop_message_data_update(full_message_id);
       add_write_query([this, full_message_id, promise = std::move(promise)](Unit) mutable {
         on_write_result(std::move(promise), sync_db_->delete_message(full_message_id));
       });
@@ -1081,7 +1330,9 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
 
     void get_messages(MessagesDbMessagesQuery query, Promise<std::vector<BufferSlice>> promise) {
       add_read_query();
-      promise.set_result(sync_db_->get_messages(std::move(query)));
+      run_read_query(std::move(promise), [query = std::move(query)](MessagesDbSyncInterface *sync_db) mutable {
+        return sync_db->get_messages(std::move(query));
+      });
     }
     void get_scheduled_messages(DialogId dialog_id, int32 limit, Promise<std::vector<BufferSlice>> promise) {
       add_read_query();
@@ -1092,25 +1343,45 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
       add_read_query();
       promise.set_result(sync_db_->get_messages_from_notification_id(dialog_id, from_notification_id, limit));
     }
+    void get_dialog_message_count(DialogId dialog_id, int32 index_mask, Promise<int32> promise) {
+      add_read_query();
+      promise.set_result(sync_db_->get_dialog_message_count(dialog_id, index_mask));
+    }
     void get_calls(MessagesDbCallsQuery query, Promise<MessagesDbCallsResult> promise) {
       add_read_query();
-      promise.set_result(sync_db_->get_calls(std::move(query)));
+      run_read_query(std::move(promise), [query = std::move(query)](MessagesDbSyncInterface *sync_db) mutable {
+        return sync_db->get_calls(std::move(query));
+      });
     }
     void get_messages_fts(MessagesDbFtsQuery query, Promise<MessagesDbFtsResult> promise) {
       add_read_query();
-      promise.set_result(sync_db_->get_messages_fts(std::move(query)));
+      index_messages_fts();
+      run_read_query(std::move(promise), [query = std::move(query)](MessagesDbSyncInterface *sync_db) mutable {
+        return sync_db->get_messages_fts(std::move(query));
+      });
     }
     void get_expiring_messages(int32 expires_from, int32 expires_till, int32 limit,
                                Promise<std::pair<std::vector<std::pair<DialogId, BufferSlice>>, int32>> promise) {
       add_read_query();
-      promise.set_result(sync_db_->get_expiring_messages(expires_from, expires_till, limit));
+      run_read_query(std::move(promise), [expires_from, expires_till, limit](MessagesDbSyncInterface *sync_db) {
+        return sync_db->get_expiring_messages(expires_from, expires_till, limit);
+      });
     }
 
     void close(Promise<> promise) {
       do_flush();
       sync_db_safe_.reset();
       sync_db_ = nullptr;
-      promise.set_value(Unit());
+
+      MultiPromiseActorSafe mpas{"MessagesDbCloseMultiPromiseActor"};
+      mpas.add_promise(std::move(promise));
+      auto lock = mpas.get_promise();
+      for (auto &reader : readers_) {
+        send_closure(reader.actor, &Reader::close, mpas.get_promise());
+        reader.actor.release();
+      }
+      readers_.clear();
+      lock.set_value(Unit());
       stop();
     }
 
@@ -1123,19 +1394,49 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe_;
     MessagesDbSyncInterface *sync_db_ = nullptr;
 
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
+    struct ReaderInfo {
+      ActorOwn<Reader> actor;
+      std::shared_ptr<std::atomic<int32>> query_count;
+    };
+    vector<int32> read_scheduler_ids_;
+    vector<ReaderInfo> readers_;
+
+    // all pending writes must be already flushed, so the query will see them
+    template <class T, class F>
+    void run_read_query(Promise<T> promise, F &&f) {
+      if (readers_.empty()) {
+        return promise.set_result(f(sync_db_));
+      }
+
+      // choose the reader with the least number of unfinished queries
+      auto *best_reader = &readers_[0];
+      for (auto &reader : readers_) {
+        if (reader.query_count->load(std::memory_order_relaxed) <
+            best_reader->query_count->load(std::memory_order_relaxed)) {
+          best_reader = &reader;
+        }
+      }
+      best_reader->query_count->fetch_add(1, std::memory_order_relaxed);
+      send_closure(best_reader->actor, &Reader::run_query<T, std::decay_t<F>>, std::move(promise),
+                   std::forward<F>(f));
+    }
+
+    // under a high write rate the transactions grow up to MAX_PENDING_QUERIES_COUNT queries
+    static constexpr size_t MIN_PENDING_QUERIES_COUNT{50};
+    static constexpr size_t MAX_PENDING_QUERIES_COUNT{1000};
     static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
 
     //NB: order is important, destructor of pending_writes_ will change pending_write_results_
     std::vector<std::pair<Promise<>, Status>> pending_write_results_;
     std::vector<Promise<>> pending_writes_;
+    size_t max_pending_queries_count_ = MIN_PENDING_QUERIES_COUNT;
     double wakeup_at_ = 0;
     template <class F>
     void add_write_query(F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f), PromiseCreator::Ignore()));
-      if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
-        do_flush();
-        wakeup_at_ = 0;
+      if (pending_writes_.size() > max_pending_queries_count_) {
+        max_pending_queries_count_ = min(max_pending_queries_count_ * 2, MAX_PENDING_QUERIES_COUNT);
+        do_flush(false);
       } else if (wakeup_at_ == 0) {
         wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
       }
@@ -1146,36 +1447,146 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     void add_read_query() {
       do_flush();
     }
-    void do_flush() {
-      if (pending_writes_.empty()) {
+    void do_flush(bool force_message_data_updates = true) {
+      bool need_update_message_data =
+          !pending_message_data_updates_.empty() &&
+          (force_message_data_updates || message_data_updates_flush_at_ <= Time::now_cached());
+      if (pending_writes_.empty() && !need_update_message_data) {
         return;
       }
       sync_db_->begin_transaction().ensure();
       for (auto &query : pending_writes_) {
         query.set_value(Unit());
       }
+      if (need_update_message_data) {
+        for (auto &it : pending_message_data_updates_) {
+          on_write_result(std::move(it.second.promise),
+                          sync_db_->update_message_data(it.first, std::move(it.second.data)));
+        }
+        pending_message_data_updates_.clear();
+        message_data_updates_flush_at_ = 0;
+      }
       sync_db_->commit_transaction().ensure();
       pending_writes_.clear();
       for (auto &p : pending_write_results_) {
         p.first.set_result(std::move(p.second));
       }
       pending_write_results_.clear();
+      wakeup_at_ = 0;
       cancel_timeout();
+
+      if (pending_fts_message_count_ >= MAX_PENDING_FTS_MESSAGE_COUNT) {
+        index_messages_fts();
+      }
+      set_pending_timeout();
     }
+
+    // frequently changed message data, like view counters, is written at most once per delay
+    static constexpr double MAX_PENDING_MESSAGE_DATA_UPDATE_DELAY{1.0};
+
+    struct MessageDataUpdate {
+      BufferSlice data;
+      Promise<> promise;
+    };
+    std::unordered_map<FullMessageId, MessageDataUpdate, FullMessageIdHash> pending_message_data_updates_;
+    double message_data_updates_flush_at_ = 0;
+
+    // the update must not overwrite newer data of the message or resurrect the message after deletion
+    void drop_message_data_update(FullMessageId full_message_id) {
+      auto it = pending_message_data_updates_.find(full_message_id);
+      if (it == pending_message_data_updates_.end()) {
+        return;
+      }
+      pending_write_results_.emplace_back(std::move(it->second.promise), Status::OK());
+      pending_message_data_updates_.erase(it);
+      if (pending_message_data_updates_.empty()) {
+        message_data_updates_flush_at_ = 0;
+      }
+    }
+
+    void set_pending_timeout() {
+      auto timeout_at = fts_index_at_;
+      if (message_data_updates_flush_at_ != 0 && (timeout_at == 0 || message_data_updates_flush_at_ < timeout_at)) {
+        timeout_at = message_data_updates_flush_at_;
+      }
+      if (timeout_at != 0) {
+        set_timeout_at(timeout_at);
+      }
+    }
+
+    // messages are added to the full-text search index in big batches, which is much faster than one by one
+    static constexpr int32 MAX_PENDING_FTS_MESSAGE_COUNT{5000};
+    static constexpr double MAX_PENDING_FTS_MESSAGE_DELAY{1.0};
+
+    int32 pending_fts_message_count_ = 0;
+    double fts_index_at_ = 0;
+    void add_fts_message() {
+      pending_fts_message_count_++;
+      if (fts_index_at_ == 0) {
+        fts_index_at_ = Time::now_cached() + MAX_PENDING_FTS_MESSAGE_DELAY;
+      }
+    }
+    // all pending writes must be already flushed
+    void index_messages_fts() {
+      if (fts_index_at_ == 0) {
+        return;
+      }
+      while (true) {
+        sync_db_->begin_transaction().ensure();
+        auto r_count = sync_db_->index_messages_fts(MAX_PENDING_FTS_MESSAGE_COUNT);
+        sync_db_->commit_transaction().ensure();
+        if (r_count.is_error()) {
+          LOG(ERROR) << "Failed to update the full-text search index: " << r_count.error();
+          break;
+        }
+        if (r_count.ok() < MAX_PENDING_FTS_MESSAGE_COUNT) {
+          break;
+        }
+      }
+      pending_fts_message_count_ = 0;
+      fts_index_at_ = 0;
+    }
+
     void timeout_expired() override {
-      do_flush();
+      if (!pending_writes_.empty() && max_pending_queries_count_ > MIN_PENDING_QUERIES_COUNT) {
+        // the writes were flushed by the timeout, so the transactions can be smaller
+        max_pending_queries_count_ = max(max_pending_queries_count_ / 2, MIN_PENDING_QUERIES_COUNT);
+      }
+      do_flush(false);
+      if (fts_index_at_ != 0 && fts_index_at_ <= Time::now()) {
+        index_messages_fts();
+      }
+      set_pending_timeout();
     }
 
     void start_up() override {
       sync_db_ = &sync_db_safe_->get();
+      for (auto read_scheduler_id : read_scheduler_ids_) {
+        ReaderInfo reader;
+        reader.query_count = std::make_shared<std::atomic<int32>>(0);
+        reader.actor =
+            create_actor_on_scheduler<Reader>("MessagesDbReader", read_scheduler_id, sync_db_safe_, reader.query_count);
+        readers_.push_back(std::move(reader));
+      }
+
+      // index messages, which were left in the queue before restart
+      fts_index_at_ = Time::now() + MAX_PENDING_FTS_MESSAGE_DELAY;
+      set_timeout_at(fts_index_at_);
+      allow_stealing();
+    }
+
+    void on_finish_migrate() override {
+      // database connections are scheduler-local
+      sync_db_ = &sync_db_safe_->get();
     }
   };
   ActorOwn<Impl> impl_;
 };
 
 std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db,
-                                                                   int32 scheduler_id) {
-  return std::make_shared<MessagesDbAsync>(std::move(sync_db), scheduler_id);
+                                                                   int32 scheduler_id,
+                                                                   vector<int32> read_scheduler_ids) {
+  return std::make_shared<MessagesDbAsync>(std::move(sync_db), scheduler_id, std::move(read_scheduler_ids));
 }
 
 }  // namespace td
@@ -72,6 +72,9 @@ class MessagesDbSyncInterface {
                              NotificationId notification_id, MessageId top_thread_message_id, BufferSlice data) = 0;
   virtual Status add_scheduled_message(FullMessageId full_message_id, BufferSlice data) = 0;
 
+  // replaces only data of an already added message; everything else including indexes must be unchanged
+  virtual Status update_message_data(FullMessageId full_message_id, BufferSlice data) = 0;
+
   virtual Status delete_message(FullMessageId full_message_id) = 0;
   virtual Status delete_all_dialog_messages(DialogId dialog_id, MessageId from_message_id) = 0;
   virtual Status delete_dialog_messages_from_user(DialogId dialog_id, UserId sender_user_id) = 0;
@@ -91,9 +94,13 @@ class MessagesDbSyncInterface {
 
   virtual Result<std::pair<std::vector<std::pair<DialogId, BufferSlice>>, int32>> get_expiring_messages(
       int32 expires_from, int32 expires_till, int32 limit) = 0;
+  virtual Result<int32> get_dialog_message_count(DialogId dialog_id, int32 index_mask) = 0;
   virtual Result<MessagesDbCallsResult> get_calls(MessagesDbCallsQuery query) = 0;
   virtual Result<MessagesDbFtsResult> get_messages_fts(MessagesDbFtsQuery query) = 0;
 
+  // adds to the full-text search index up to limit of the oldest not indexed messages; returns number of the messages
+  virtual Result<int32> index_messages_fts(int32 limit) = 0;
+
   virtual Status begin_transaction() = 0;
   virtual Status commit_transaction() = 0;
 };
@@ -121,6 +128,9 @@ class MessagesDbAsyncInterface {
                            Promise<> promise) = 0;
   virtual void add_scheduled_message(FullMessageId full_message_id, BufferSlice data, Promise<> promise) = 0;
 
+  // updates of the same message are coalesced; the update is dropped if the message is added or deleted before flush
+  virtual void update_message_data(FullMessageId full_message_id, BufferSlice data, Promise<> promise) = 0;
+
   virtual void delete_message(FullMessageId full_message_id, Promise<> promise) = 0;
   virtual void delete_all_dialog_messages(DialogId dialog_id, MessageId from_message_id, Promise<> promise) = 0;
   virtual void delete_dialog_messages_from_user(DialogId dialog_id, UserId sender_user_id, Promise<> promise) = 0;
@@ -137,6 +147,7 @@ class MessagesDbAsyncInterface {
   virtual void get_messages_from_notification_id(DialogId dialog_id, NotificationId from_notification_id, int32 limit,
                                                  Promise<vector<BufferSlice>> promise) = 0;
 
+  virtual void get_dialog_message_count(DialogId dialog_id, int32 index_mask, Promise<int32> promise) = 0;
   virtual void get_calls(MessagesDbCallsQuery, Promise<MessagesDbCallsResult> promise) = 0;
   virtual void get_messages_fts(MessagesDbFtsQuery query, Promise<MessagesDbFtsResult> promise) = 0;
 
@@ -154,7 +165,9 @@ Status drop_messages_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
     std::shared_ptr<SqliteConnectionSafe> sqlite_connection);
 
+// long read queries are executed on read_scheduler_ids, each of which uses its own database connection
 std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db,
-                                                                   int32 scheduler_id);
+                                                                   int32 scheduler_id,
+                                                                   vector<int32> read_scheduler_ids = {});
 
 }  // namespace td
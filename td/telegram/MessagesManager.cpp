@@ -56,6 +56,7 @@
 
 #include "td/db/binlog/BinlogEvent.h"
 #include "td/db/binlog/BinlogHelper.h"
+#include "td/db/binlog/BinlogInterface.h"
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueAsync.h"
 
@@ -2543,7 +2544,7 @@ class SendMessageActor : public NetActorOnce {
         flags, false /*ignored*/, false /*ignored*/, false /*ignored*/, false /*ignored*/, std::move(input_peer),
         reply_to_message_id.get_server_message_id().get(), text, random_id, std::move(reply_markup),
         std::move(entities), schedule_date));
-    if (G()->shared_config().get_option_boolean("use_quick_ack")) {
+    if (G()->shared_config().get_option_boolean(ConfigShared::OptionId::UseQuickAck)) {
       query->quick_ack_promise_ = PromiseCreator::lambda(
           [random_id](Unit) {
             send_closure(G()->messages_manager(), &MessagesManager::on_send_message_get_quick_ack, random_id);
@@ -2612,7 +2613,7 @@ class StartBotQuery : public Td::ResultHandler {
 
     auto query = G()->net_query_creator().create(
         telegram_api::messages_startBot(std::move(bot_input_user), std::move(input_peer), random_id, parameter));
-    if (G()->shared_config().get_option_boolean("use_quick_ack")) {
+    if (G()->shared_config().get_option_boolean(ConfigShared::OptionId::UseQuickAck)) {
       query->quick_ack_promise_ = PromiseCreator::lambda(
           [random_id](Unit) {
             send_closure(G()->messages_manager(), &MessagesManager::on_send_message_get_quick_ack, random_id);
@@ -2836,7 +2837,7 @@ class SendMediaActor : public NetActorOnce {
         flags, false /*ignored*/, false /*ignored*/, false /*ignored*/, std::move(input_peer),
         reply_to_message_id.get_server_message_id().get(), std::move(input_media), text, random_id,
         std::move(reply_markup), std::move(entities), schedule_date));
-    if (G()->shared_config().get_option_boolean("use_quick_ack") && was_uploaded_) {
+    if (G()->shared_config().get_option_boolean(ConfigShared::OptionId::UseQuickAck) && was_uploaded_) {
       query->quick_ack_promise_ = PromiseCreator::lambda(
           [random_id](Unit) {
             send_closure(G()->messages_manager(), &MessagesManager::on_send_message_get_quick_ack, random_id);
@@ -3387,7 +3388,7 @@ class ForwardMessagesActor : public NetActorOnce {
         flags, false /*ignored*/, false /*ignored*/, false /*ignored*/, std::move(from_input_peer),
         MessagesManager::get_server_message_ids(message_ids), std::move(random_ids), std::move(to_input_peer),
         schedule_date));
-    if (G()->shared_config().get_option_boolean("use_quick_ack")) {
+    if (G()->shared_config().get_option_boolean(ConfigShared::OptionId::UseQuickAck)) {
       query->quick_ack_promise_ = PromiseCreator::lambda(
           [random_ids = random_ids_](Unit) {
             for (auto random_id : random_ids) {
@@ -4382,6 +4383,9 @@ class GetChannelDifferenceQuery : public Td::ResultHandler {
   }
 
   void on_error(uint64 id, Status status) override {
+    if (status.code() == 429) {
+      td->messages_manager_->on_get_channel_difference_flood_wait();
+    }
     if (!td->messages_manager_->on_get_dialog_error(dialog_id_, status, "GetChannelDifferenceQuery")) {
       LOG(ERROR) << "Receive updates.getChannelDifference error for " << dialog_id_ << " with pts " << pts_
                  << " and limit " << limit_ << ": " << status;
@@ -4530,15 +4534,28 @@ class MessagesManager::UploadDialogPhotoCallback : public FileManager::UploadCal
   }
 };
 
+const MessagesManager::Message::Extra &MessagesManager::Message::get_extra() const {
+  static const Extra empty_extra;
+  return extra == nullptr ? empty_extra : *extra;
+}
+
+MessagesManager::Message::Extra &MessagesManager::Message::get_mutable_extra() {
+  if (extra == nullptr) {
+    extra = make_unique<Extra>();
+  }
+  return *extra;
+}
+
 template <class StorerT>
 void MessagesManager::Message::store(StorerT &storer) const {
+  const Extra &message_extra = get_extra();
   using td::store;
   bool has_sender = sender_user_id.is_valid();
   bool has_edit_date = edit_date > 0;
   bool has_random_id = random_id != 0;
   bool is_forwarded = forward_info != nullptr;
   bool is_reply = reply_to_message_id.is_valid();
-  bool is_reply_to_random_id = reply_to_random_id != 0;
+  bool is_reply_to_random_id = message_extra.reply_to_random_id != 0;
   bool is_via_bot = via_bot_user_id.is_valid();
   bool has_view_count = view_count > 0;
   bool has_reply_markup = reply_markup != nullptr;
@@ -4552,18 +4569,19 @@ void MessagesManager::Message::store(StorerT &storer) const {
   bool has_flags2 = true;
   bool has_notification_id = notification_id.is_valid();
   bool has_forward_sender_name = is_forwarded && !forward_info->sender_name.empty();
-  bool has_send_error_code = send_error_code != 0;
-  bool has_real_forward_from = real_forward_from_dialog_id.is_valid() && real_forward_from_message_id.is_valid();
-  bool has_legacy_layer = legacy_layer != 0;
-  bool has_restriction_reasons = !restriction_reasons.empty();
+  bool has_send_error_code = message_extra.send_error_code != 0;
+  bool has_real_forward_from =
+      message_extra.real_forward_from_dialog_id.is_valid() && message_extra.real_forward_from_message_id.is_valid();
+  bool has_legacy_layer = message_extra.legacy_layer != 0;
+  bool has_restriction_reasons = !message_extra.restriction_reasons.empty();
   bool has_forward_psa_type = is_forwarded && !forward_info->psa_type.empty();
   bool has_forward_count = forward_count > 0;
   bool has_reply_info = !reply_info.is_empty();
   bool has_sender_dialog_id = sender_dialog_id.is_valid();
   bool has_reply_in_dialog_id = is_reply && reply_in_dialog_id.is_valid();
   bool has_top_thread_message_id = top_thread_message_id.is_valid();
-  bool has_thread_draft_message = thread_draft_message != nullptr;
-  bool has_local_thread_message_ids = !local_thread_message_ids.empty();
+  bool has_thread_draft_message = message_extra.thread_draft_message != nullptr;
+  bool has_local_thread_message_ids = !message_extra.local_thread_message_ids.empty();
   bool has_linked_top_thread_message_id = linked_top_thread_message_id.is_valid();
   BEGIN_STORE_FLAGS();
   STORE_FLAG(is_channel_post);
@@ -4659,14 +4677,14 @@ void MessagesManager::Message::store(StorerT &storer) const {
     }
   }
   if (has_real_forward_from) {
-    store(real_forward_from_dialog_id, storer);
-    store(real_forward_from_message_id, storer);
+    store(message_extra.real_forward_from_dialog_id, storer);
+    store(message_extra.real_forward_from_message_id, storer);
   }
   if (is_reply) {
     store(reply_to_message_id, storer);
   }
   if (is_reply_to_random_id) {
-    store(reply_to_random_id, storer);
+    store(message_extra.reply_to_random_id, storer);
   }
   if (is_via_bot) {
     store(via_bot_user_id, storer);
@@ -4685,10 +4703,10 @@ void MessagesManager::Message::store(StorerT &storer) const {
     store_time(ttl_expires_at, storer);
   }
   if (has_send_error_code) {
-    store(send_error_code, storer);
-    store(send_error_message, storer);
-    if (send_error_code == 429) {
-      store_time(try_resend_at, storer);
+    store(message_extra.send_error_code, storer);
+    store(message_extra.send_error_message, storer);
+    if (message_extra.send_error_code == 429) {
+      store_time(message_extra.try_resend_at, storer);
     }
   }
   if (has_author_signature) {
@@ -4701,10 +4719,10 @@ void MessagesManager::Message::store(StorerT &storer) const {
     store(notification_id, storer);
   }
   if (has_legacy_layer) {
-    store(legacy_layer, storer);
+    store(message_extra.legacy_layer, storer);
   }
   if (has_restriction_reasons) {
-    store(restriction_reasons, storer);
+    store(message_extra.restriction_reasons, storer);
   }
   if (has_sender_dialog_id) {
     store(sender_dialog_id, storer);
@@ -4716,10 +4734,10 @@ void MessagesManager::Message::store(StorerT &storer) const {
     store(top_thread_message_id, storer);
   }
   if (has_thread_draft_message) {
-    store(thread_draft_message, storer);
+    store(message_extra.thread_draft_message, storer);
   }
   if (has_local_thread_message_ids) {
-    store(local_thread_message_ids, storer);
+    store(message_extra.local_thread_message_ids, storer);
   }
   if (has_linked_top_thread_message_id) {
     store(linked_top_thread_message_id, storer);
@@ -4826,7 +4844,6 @@ void MessagesManager::Message::parse(ParserT &parser) {
   }
 
   parse(message_id, parser);
-  random_y = get_random_y(message_id);
   if (has_sender) {
     parse(sender_user_id, parser);
   }
@@ -4865,14 +4882,15 @@ void MessagesManager::Message::parse(ParserT &parser) {
     }
   }
   if (has_real_forward_from) {
-    parse(real_forward_from_dialog_id, parser);
-    parse(real_forward_from_message_id, parser);
+    auto &message_extra = get_mutable_extra();
+    parse(message_extra.real_forward_from_dialog_id, parser);
+    parse(message_extra.real_forward_from_message_id, parser);
   }
   if (is_reply) {
     parse(reply_to_message_id, parser);
   }
   if (is_reply_to_random_id) {
-    parse(reply_to_random_id, parser);
+    parse(get_mutable_extra().reply_to_random_id, parser);
   }
   if (is_via_bot) {
     parse(via_bot_user_id, parser);
@@ -4891,10 +4909,11 @@ void MessagesManager::Message::parse(ParserT &parser) {
     parse_time(ttl_expires_at, parser);
   }
   if (has_send_error_code) {
-    parse(send_error_code, parser);
-    parse(send_error_message, parser);
-    if (send_error_code == 429) {
-      parse_time(try_resend_at, parser);
+    auto &message_extra = get_mutable_extra();
+    parse(message_extra.send_error_code, parser);
+    parse(message_extra.send_error_message, parser);
+    if (message_extra.send_error_code == 429) {
+      parse_time(message_extra.try_resend_at, parser);
     }
   }
   if (has_author_signature) {
@@ -4907,10 +4926,10 @@ void MessagesManager::Message::parse(ParserT &parser) {
     parse(notification_id, parser);
   }
   if (has_legacy_layer) {
-    parse(legacy_layer, parser);
+    parse(get_mutable_extra().legacy_layer, parser);
   }
   if (has_restriction_reasons) {
-    parse(restriction_reasons, parser);
+    parse(get_mutable_extra().restriction_reasons, parser);
   }
   if (has_sender_dialog_id) {
     parse(sender_dialog_id, parser);
@@ -4922,10 +4941,10 @@ void MessagesManager::Message::parse(ParserT &parser) {
     parse(top_thread_message_id, parser);
   }
   if (has_thread_draft_message) {
-    parse(thread_draft_message, parser);
+    parse(get_mutable_extra().thread_draft_message, parser);
   }
   if (has_local_thread_message_ids) {
-    parse(local_thread_message_ids, parser);
+    parse(get_mutable_extra().local_thread_message_ids, parser);
   }
   if (has_linked_top_thread_message_id) {
     parse(linked_top_thread_message_id, parser);
@@ -5260,7 +5279,10 @@ void MessagesManager::Dialog::parse(ParserT &parser) {
   parse(last_clear_history_date, parser);
   parse(order, parser);
   if (has_last_database_message) {
-    parse(messages, parser);
+    unique_ptr<Message> last_database_message;
+    parse(last_database_message, parser);
+    auto message_id = last_database_message->message_id;
+    messages.insert(message_id, std::move(last_database_message));
   }
   if (has_first_database_message_id) {
     parse(first_database_message_id, parser);
@@ -5631,15 +5653,7 @@ td_api::object_ptr<td_api::MessageSender> MessagesManager::get_message_sender_ob
 
 BufferSlice MessagesManager::get_dialog_database_value(const Dialog *d) {
   // can't use log_event_store, because it tries to parse stored Dialog
-  LogEventStorerCalcLength storer_calc_length;
-  store(*d, storer_calc_length);
-
-  BufferSlice value_buffer{storer_calc_length.get_length()};
-  auto value = value_buffer.as_slice();
-
-  LogEventStorerUnsafe storer_unsafe(value.ubegin());
-  store(*d, storer_unsafe);
-  return value_buffer;
+  return log_event::store_to_buffer_slice(*d);
 }
 
 void MessagesManager::save_dialog_to_database(DialogId dialog_id) {
@@ -6214,7 +6228,7 @@ void MessagesManager::add_pending_update(tl_object_ptr<telegram_api::Update> &&u
     LOG(INFO) << "Save pending update got while running getDifference from " << source;
     CHECK(update->get_id() == dummyUpdate::ID || update->get_id() == updateSentMessage::ID);
     if (pts_count > 0) {
-      postponed_pts_updates_.emplace(new_pts, PendingPtsUpdate(std::move(update), new_pts, pts_count));
+      add_pending_pts_update(postponed_pts_updates_, PendingPtsUpdate(std::move(update), new_pts, pts_count));
     }
     return;
   }
@@ -6258,7 +6272,7 @@ void MessagesManager::add_pending_update(tl_object_ptr<telegram_api::Update> &&u
   }
 
   if (pts_count > 0) {
-    pending_updates_.emplace(new_pts, PendingPtsUpdate(std::move(update), new_pts, pts_count));
+    add_pending_pts_update(pending_updates_, PendingPtsUpdate(std::move(update), new_pts, pts_count));
   }
 
   if (old_pts + accumulated_pts_count_ < accumulated_pts_) {
@@ -6633,7 +6647,7 @@ void MessagesManager::update_message_interaction_info(FullMessageId full_message
 
   if (update_message_interaction_info(dialog_id, m, view_count, forward_count, has_reply_info,
                                       std::move(new_reply_info))) {
-    on_message_changed(d, m, true, "update_message_interaction_info");
+    on_message_interaction_info_changed(d, m, "update_message_interaction_info");
   }
 }
 
@@ -7375,14 +7389,27 @@ void MessagesManager::on_message_edited(FullMessageId full_message_id) {
   update_used_hashtags(dialog_id, m);
 }
 
+void MessagesManager::add_pending_pts_update(vector<PendingPtsUpdate> &updates, PendingPtsUpdate &&update) {
+  auto it = updates.end();
+  while (it != updates.begin() && (it - 1)->pts > update.pts) {
+    --it;
+  }
+  updates.insert(it, std::move(update));
+}
+
 void MessagesManager::process_pending_updates() {
-  for (auto &update : pending_updates_) {
-    process_update(std::move(update.second.update));
+  auto updates = std::move(pending_updates_);
+  for (auto &update : updates) {
+    process_update(std::move(update.update));
   }
 
   td_->updates_manager_->set_pts(accumulated_pts_, "process pending updates")
       .set_value(Unit());  // TODO can't set until get messages really stored on persistent storage
   drop_pending_updates();
+
+  // reuse the allocated memory
+  updates.clear();
+  pending_updates_ = std::move(updates);
 }
 
 void MessagesManager::drop_pending_updates() {
@@ -8440,7 +8467,7 @@ void MessagesManager::do_send_media(DialogId dialog_id, Message *m, FileId file_
 
   MessageContent *content = nullptr;
   if (m->message_id.is_any_server()) {
-    content = m->edited_content.get();
+    content = m->get_mutable_extra().edited_content.get();
     if (content == nullptr) {
       LOG(ERROR) << "Message has no edited content";
       return;
@@ -8583,7 +8610,7 @@ void MessagesManager::on_upload_thumbnail(FileId thumbnail_file_id,
   bool is_edit = m->message_id.is_any_server();
 
   if (thumbnail_input_file == nullptr) {
-    delete_message_content_thumbnail(is_edit ? m->edited_content.get() : m->content.get(), td_);
+    delete_message_content_thumbnail(is_edit ? m->get_mutable_extra().edited_content.get() : m->content.get(), td_);
   }
 
   auto dialog_id = full_message_id.get_dialog_id();
@@ -8690,8 +8717,9 @@ void MessagesManager::before_get_difference() {
   // scheduled messages are not returned in getDifference, so we must always reget them after it
   scheduled_messages_sync_generation_++;
 
-  postponed_pts_updates_.insert(std::make_move_iterator(pending_updates_.begin()),
-                                std::make_move_iterator(pending_updates_.end()));
+  for (auto &update : pending_updates_) {
+    add_pending_pts_update(postponed_pts_updates_, std::move(update));
+  }
 
   drop_pending_updates();
 }
@@ -8703,13 +8731,11 @@ void MessagesManager::after_get_difference() {
     LOG(INFO) << "Begin to apply postponed pts updates";
     auto old_pts = td_->updates_manager_->get_pts();
     for (auto &update : postponed_pts_updates_) {
-      auto new_pts = update.second.pts;
+      auto new_pts = update.pts;
       if (new_pts <= old_pts) {
-        skip_old_pending_update(std::move(update.second.update), new_pts, old_pts, update.second.pts_count,
-                                "after get difference");
+        skip_old_pending_update(std::move(update.update), new_pts, old_pts, update.pts_count, "after get difference");
       } else {
-        add_pending_update(std::move(update.second.update), update.second.pts, update.second.pts_count, false,
-                           "after get difference");
+        add_pending_update(std::move(update.update), update.pts, update.pts_count, false, "after get difference");
       }
       CHECK(!td_->updates_manager_->running_get_difference());
     }
@@ -8938,7 +8964,7 @@ void MessagesManager::on_get_history(DialogId dialog_id, MessageId from_message_
         on_dialog_updated(dialog_id, "set have_full_history");
       }
 
-      if (from_the_end && d->have_full_history && d->messages == nullptr && !d->last_database_message_id.is_valid()) {
+      if (from_the_end && d->have_full_history && d->messages.empty() && !d->last_database_message_id.is_valid()) {
         set_dialog_is_empty(d, "on_get_history empty");
       }
     }
@@ -9004,7 +9030,7 @@ void MessagesManager::on_get_history(DialogId dialog_id, MessageId from_message_
     auto last_server_message_id = get_message_id(messages[0], false);
     // delete all server messages with ID > last_server_message_id
     vector<MessageId> message_ids;
-    find_newer_messages(d->messages.get(), last_server_message_id, message_ids);
+    find_newer_messages(d->messages, last_server_message_id, message_ids);
     if (!message_ids.empty()) {
       bool need_update_dialog_pos = false;
       vector<int64> deleted_message_ids;
@@ -9024,7 +9050,7 @@ void MessagesManager::on_get_history(DialogId dialog_id, MessageId from_message_
         send_update_delete_messages(dialog_id, std::move(deleted_message_ids), true, false);
 
         message_ids.clear();
-        find_newer_messages(d->messages.get(), last_server_message_id, message_ids);
+        find_newer_messages(d->messages, last_server_message_id, message_ids);
       }
 
       // connect all messages with ID > last_server_message_id
@@ -9471,7 +9497,7 @@ void MessagesManager::on_get_scheduled_server_messages(DialogId dialog_id, uint3
   }
 
   vector<MessageId> old_message_ids;
-  find_old_messages(d->scheduled_messages.get(),
+  find_old_messages(d->scheduled_messages,
                     MessageId(ScheduledServerMessageId(), std::numeric_limits<int32>::max(), true), old_message_ids);
   std::unordered_map<ScheduledServerMessageId, MessageId, ScheduledServerMessageIdHash> old_server_message_ids;
   for (auto &message_id : old_message_ids) {
@@ -9864,9 +9890,9 @@ bool MessagesManager::can_revoke_message(DialogId dialog_id, const Message *m) c
   auto content_type = m->content->get_type();
   switch (dialog_id.get_type()) {
     case DialogType::User: {
-      bool can_revoke_incoming = G()->shared_config().get_option_boolean("revoke_pm_inbox", true);
+      bool can_revoke_incoming = G()->shared_config().get_option_boolean(ConfigShared::OptionId::RevokePmInbox, true);
       int64 revoke_time_limit =
-          G()->shared_config().get_option_integer("revoke_pm_time_limit", DEFAULT_REVOKE_TIME_LIMIT);
+          G()->shared_config().get_option_integer(ConfigShared::OptionId::RevokePmTimeLimit, DEFAULT_REVOKE_TIME_LIMIT);
 
       if (G()->unix_time_cached() - m->date < 86400 && content_type == MessageContentType::Dice) {
         return false;
@@ -9878,7 +9904,8 @@ bool MessagesManager::can_revoke_message(DialogId dialog_id, const Message *m) c
     case DialogType::Chat: {
       bool is_appointed_administrator =
           td_->contacts_manager_->is_appointed_chat_administrator(dialog_id.get_chat_id());
-      int64 revoke_time_limit = G()->shared_config().get_option_integer("revoke_time_limit", DEFAULT_REVOKE_TIME_LIMIT);
+      int64 revoke_time_limit =
+          G()->shared_config().get_option_integer(ConfigShared::OptionId::RevokeTimeLimit, DEFAULT_REVOKE_TIME_LIMIT);
 
       return ((m->is_outgoing && !is_service_message_content(content_type)) || is_appointed_administrator) &&
              G()->unix_time_cached() - m->date <= revoke_time_limit;
@@ -10169,7 +10196,7 @@ void MessagesManager::delete_dialog_history(DialogId dialog_id, bool remove_from
     // TODO get dialog from the server and delete history from last message identifier
   }
 
-  bool allow_error = d->messages == nullptr;
+  bool allow_error = d->messages.empty();
 
   delete_all_dialog_messages(d, remove_from_dialog_list, true);
 
@@ -10256,66 +10283,41 @@ void MessagesManager::delete_dialog_history_from_server(DialogId dialog_id, Mess
   }
 }
 
-void MessagesManager::find_messages(const Message *m, vector<MessageId> &message_ids,
+void MessagesManager::find_messages(const MessagesMap &messages, vector<MessageId> &message_ids,
                                     const std::function<bool(const Message *)> &condition) {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_messages(m->left.get(), message_ids, condition);
-
-  if (condition(m)) {
-    message_ids.push_back(m->message_id);
+  for (auto it = messages.begin(); it != messages.end(); ++it) {
+    if (condition(it.value().get())) {
+      message_ids.push_back(it.key());
+    }
   }
-
-  find_messages(m->right.get(), message_ids, condition);
 }
 
-void MessagesManager::find_old_messages(const Message *m, MessageId max_message_id, vector<MessageId> &message_ids) {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_old_messages(m->left.get(), max_message_id, message_ids);
-
-  if (m->message_id <= max_message_id) {
-    message_ids.push_back(m->message_id);
-
-    find_old_messages(m->right.get(), max_message_id, message_ids);
+void MessagesManager::find_old_messages(const MessagesMap &messages, MessageId max_message_id,
+                                        vector<MessageId> &message_ids) {
+  for (auto it = messages.begin(); it != messages.end() && it.key() <= max_message_id; ++it) {
+    message_ids.push_back(it.key());
   }
 }
 
-void MessagesManager::find_newer_messages(const Message *m, MessageId min_message_id, vector<MessageId> &message_ids) {
-  if (m == nullptr) {
-    return;
-  }
-
-  if (m->message_id > min_message_id) {
-    find_newer_messages(m->left.get(), min_message_id, message_ids);
-
-    message_ids.push_back(m->message_id);
+void MessagesManager::find_newer_messages(const MessagesMap &messages, MessageId min_message_id,
+                                          vector<MessageId> &message_ids) {
+  for (auto it = messages.upper_bound(min_message_id); it != messages.end(); ++it) {
+    message_ids.push_back(it.key());
   }
-
-  find_newer_messages(m->right.get(), min_message_id, message_ids);
 }
 
-void MessagesManager::find_unloadable_messages(const Dialog *d, int32 unload_before_date, const Message *m,
+void MessagesManager::find_unloadable_messages(const Dialog *d, int32 unload_before_date,
                                                vector<MessageId> &message_ids, int32 &left_to_unload) const {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_unloadable_messages(d, unload_before_date, m->left.get(), message_ids, left_to_unload);
-
-  if (can_unload_message(d, m)) {
-    if (m->last_access_date <= unload_before_date) {
-      message_ids.push_back(m->message_id);
-    } else {
-      left_to_unload++;
+  for (auto it = d->messages.begin(); it != d->messages.end(); ++it) {
+    const Message *m = it.value().get();
+    if (can_unload_message(d, m)) {
+      if (m->last_access_date <= unload_before_date) {
+        message_ids.push_back(m->message_id);
+      } else {
+        left_to_unload++;
+      }
     }
   }
-
-  find_unloadable_messages(d, unload_before_date, m->right.get(), message_ids, left_to_unload);
 }
 
 void MessagesManager::delete_dialog_messages_from_user(DialogId dialog_id, UserId user_id, Promise<Unit> &&promise) {
@@ -10373,7 +10375,7 @@ void MessagesManager::delete_dialog_messages_from_user(DialogId dialog_id, UserI
   }
 
   vector<MessageId> message_ids;
-  find_messages(d->messages.get(), message_ids, [user_id](const Message *m) { return m->sender_user_id == user_id; });
+  find_messages(d->messages, message_ids, [user_id](const Message *m) { return m->sender_user_id == user_id; });
 
   vector<int64> deleted_message_ids;
   bool need_update_dialog_pos = false;
@@ -10439,7 +10441,8 @@ int32 MessagesManager::get_unload_dialog_delay() const {
 
   CHECK(is_message_unload_enabled());
   auto default_unload_delay = td_->auth_manager_->is_bot() ? DIALOG_UNLOAD_BOT_DELAY : DIALOG_UNLOAD_DELAY;
-  return narrow_cast<int32>(G()->shared_config().get_option_integer("message_unload_delay", default_unload_delay));
+  return narrow_cast<int32>(
+      G()->shared_config().get_option_integer(ConfigShared::OptionId::MessageUnloadDelay, default_unload_delay));
 }
 
 void MessagesManager::unload_dialog(DialogId dialog_id) {
@@ -10456,8 +10459,8 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
 
   vector<MessageId> to_unload_message_ids;
   int32 left_to_unload = 0;
-  find_unloadable_messages(d, G()->unix_time_cached() - get_unload_dialog_delay() + 2, d->messages.get(),
-                           to_unload_message_ids, left_to_unload);
+  find_unloadable_messages(d, G()->unix_time_cached() - get_unload_dialog_delay() + 2, to_unload_message_ids,
+                           left_to_unload);
 
   vector<int64> unloaded_message_ids;
   for (auto message_id : to_unload_message_ids) {
@@ -10481,6 +10484,156 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
   }
 }
 
+int32 MessagesManager::get_message_memory_size(const Message *m) {
+  // serialized size of the content is a good estimate of memory used by its strings, entities and media
+  LogEventStorerCalcLength storer;
+  store_message_content(m->content.get(), storer);
+  size_t extra_size = m->extra == nullptr ? 0 : sizeof(Message::Extra);
+  return narrow_cast<int32>(sizeof(Message) + extra_size + storer.get_length());
+}
+
+void MessagesManager::on_message_loaded_to_memory(Message *m) {
+  m->memory_size = get_message_memory_size(m);
+  loaded_message_count_++;
+  loaded_message_memory_size_ += m->memory_size;
+  try_schedule_unload_messages_by_memory_limit();
+}
+
+void MessagesManager::on_message_unloaded_from_memory(const Message *m) {
+  loaded_message_count_--;
+  loaded_message_memory_size_ -= m->memory_size;
+  CHECK(loaded_message_count_ >= 0);
+}
+
+void MessagesManager::on_update_message_memory_limit() {
+  message_memory_limit_ = max(G()->shared_config().get_option_integer("message_memory_limit"), static_cast<int64>(0));
+  last_unload_by_memory_limit_size_ = 0;
+  try_schedule_unload_messages_by_memory_limit();
+}
+
+void MessagesManager::try_schedule_unload_messages_by_memory_limit() {
+  if (message_memory_limit_ <= 0 || is_unload_by_memory_limit_scheduled_) {
+    return;
+  }
+  // if the previous unload wasn't able to free enough memory, wait until the size noticeably grows
+  auto max_size = max(message_memory_limit_, last_unload_by_memory_limit_size_ + message_memory_limit_ / 10);
+  if (loaded_message_memory_size_ <= max_size || !is_message_unload_enabled()) {
+    return;
+  }
+
+  // messages can't be unloaded immediately, because the caller can still use them
+  is_unload_by_memory_limit_scheduled_ = true;
+  send_closure_later(actor_id(this), &MessagesManager::unload_messages_by_memory_limit);
+}
+
+void MessagesManager::unload_messages_by_memory_limit() {
+  is_unload_by_memory_limit_scheduled_ = false;
+  if (G()->close_flag() || message_memory_limit_ <= 0 || loaded_message_memory_size_ <= message_memory_limit_) {
+    return;
+  }
+
+  struct UnloadCandidate {
+    int32 last_access_date;
+    FullMessageId full_message_id;
+  };
+  vector<UnloadCandidate> candidates;
+  for (auto &it : dialogs_) {
+    const Dialog *d = it.second.get();
+    for (auto message_it = d->messages.begin(); message_it != d->messages.end(); ++message_it) {
+      const Message *m = message_it.value().get();
+      if (can_unload_message(d, m)) {
+        candidates.push_back(UnloadCandidate{m->last_access_date, FullMessageId{d->dialog_id, m->message_id}});
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](const UnloadCandidate &lhs, const UnloadCandidate &rhs) {
+    if (lhs.last_access_date != rhs.last_access_date) {
+      return lhs.last_access_date < rhs.last_access_date;
+    }
+    return lhs.full_message_id.get_message_id() < rhs.full_message_id.get_message_id();
+  });
+
+  // free some additional memory to not scan all messages after every new message
+  auto target_size = message_memory_limit_ - message_memory_limit_ / 10;
+  std::unordered_map<DialogId, vector<int64>, DialogIdHash> unloaded_message_ids;
+  for (auto &candidate : candidates) {
+    if (loaded_message_memory_size_ <= target_size) {
+      break;
+    }
+    auto dialog_id = candidate.full_message_id.get_dialog_id();
+    auto message_id = candidate.full_message_id.get_message_id();
+    unload_message(get_dialog(dialog_id), message_id);
+    unloaded_message_ids[dialog_id].push_back(message_id.get());
+    unloaded_by_memory_limit_message_count_++;
+  }
+  last_unload_by_memory_limit_size_ = loaded_message_memory_size_;
+  LOG(INFO) << "Unloaded messages from " << unloaded_message_ids.size() << " chats to fit in memory limit of "
+            << message_memory_limit_ << " bytes; now " << loaded_message_count_ << " messages of size "
+            << loaded_message_memory_size_ << " are loaded";
+
+  for (auto &it : unloaded_message_ids) {
+    if (!G()->parameters().use_message_db) {
+      get_dialog(it.first)->have_full_history = false;
+    }
+
+    send_closure_later(
+        G()->td(), &Td::send_update,
+        make_tl_object<td_api::updateDeleteMessages>(it.first.get(), std::move(it.second), false, true));
+  }
+}
+
+void MessagesManager::get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries,
+                                            bool full) const {
+  entries.push_back(
+      td_api::make_object<td_api::memoryStatisticsEntry>("messages", loaded_message_count_, loaded_message_memory_size_));
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "chats", static_cast<int64>(dialogs_.size()), static_cast<int64>(dialogs_.size() * sizeof(Dialog))));
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "chat search index", static_cast<int64>(dialogs_hints_.size()),
+      static_cast<int64>(dialogs_hints_.get_memory_size())));
+
+  int64 message_search_index_size = 0;
+  int64 message_search_index_count = 0;
+  for (auto &it : message_search_indexes_) {
+    message_search_index_count += static_cast<int64>(it.second->hints.size());
+    message_search_index_size += static_cast<int64>(it.second->hints.get_memory_size());
+  }
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "message search index", message_search_index_count, message_search_index_size));
+
+  if (!full) {
+    return;
+  }
+
+  vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> dialog_entries;
+  for (auto &it : dialogs_) {
+    const Dialog *d = it.second.get();
+    int64 message_count = 0;
+    int64 message_size = 0;
+    for (auto messages : {&d->messages, &d->scheduled_messages}) {
+      for (auto message_it = messages->begin(); message_it != messages->end(); ++message_it) {
+        const Message *m = message_it.value().get();
+        message_count++;
+        message_size += m->memory_size != 0 ? m->memory_size : get_message_memory_size(m);
+      }
+    }
+    if (message_count != 0) {
+      dialog_entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+          PSTRING() << "messages in chat " << d->dialog_id.get(), message_count, message_size));
+    }
+  }
+  std::sort(dialog_entries.begin(), dialog_entries.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs->size_ > rhs->size_; });
+  append(entries, std::move(dialog_entries));
+}
+
+td_api::object_ptr<td_api::memoryStatistics> MessagesManager::get_memory_statistics_object(
+    vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &&entries) const {
+  return td_api::make_object<td_api::memoryStatistics>(loaded_message_count_, loaded_message_memory_size_,
+                                                       message_memory_limit_, unloaded_by_memory_limit_message_count_,
+                                                       std::move(entries));
+}
+
 void MessagesManager::delete_all_dialog_messages(Dialog *d, bool remove_from_dialog_list, bool is_permanently_deleted) {
   CHECK(d != nullptr);
   LOG(INFO) << "Delete all messages in " << d->dialog_id
@@ -10607,7 +10760,7 @@ void MessagesManager::read_all_dialog_mentions(DialogId dialog_id, Promise<Unit>
   }
 
   vector<MessageId> message_ids;
-  find_messages(d->messages.get(), message_ids, [](const Message *m) { return m->contains_unread_mention; });
+  find_messages(d->messages, message_ids, [](const Message *m) { return m->contains_unread_mention; });
 
   LOG(INFO) << "Found " << message_ids.size() << " messages with unread mentions in memory";
   bool is_update_sent = false;
@@ -11354,7 +11507,7 @@ void MessagesManager::set_dialog_max_unavailable_message_id(DialogId dialog_id,
     d->max_unavailable_message_id = max_unavailable_message_id;
 
     vector<MessageId> message_ids;
-    find_old_messages(d->messages.get(), max_unavailable_message_id, message_ids);
+    find_old_messages(d->messages, max_unavailable_message_id, message_ids);
 
     vector<int64> deleted_message_ids;
     bool need_update_dialog_pos = false;
@@ -11736,6 +11889,8 @@ void MessagesManager::init() {
 
   always_wait_for_mailbox();
 
+  message_memory_limit_ = max(G()->shared_config().get_option_integer("message_memory_limit"), static_cast<int64>(0));
+
   start_time_ = Time::now();
 
   bool is_authorized = td_->auth_manager_->is_authorized();
@@ -12025,13 +12180,11 @@ void MessagesManager::init() {
       bool have_next;
     };
     vector<MessageBasicInfo> messages_info;
-    std::function<void(Message *m)> get_messages_info = [&](Message *m) {
-      if (m == nullptr) {
-        return;
+    auto get_messages_info = [&](const MessagesMap &messages) {
+      for (auto it = messages.begin(); it != messages.end(); ++it) {
+        const Message *m = it.value().get();
+        messages_info.push_back(MessageBasicInfo{m->message_id, m->have_previous, m->have_next});
       }
-      get_messages_info(m->left.get());
-      messages_info.push_back(MessageBasicInfo{m->message_id, m->have_previous, m->have_next});
-      get_messages_info(m->right.get());
     };
 
     char buf[1280];
@@ -12117,7 +12270,7 @@ void MessagesManager::init() {
       }
 
       messages_info.clear();
-      get_messages_info(d->messages.get());
+      get_messages_info(d->messages);
 
       for (size_t i = 0; i + 1 < messages_info.size(); i++) {
         if (messages_info[i].have_next != messages_info[i + 1].have_previous) {
@@ -12137,7 +12290,7 @@ void MessagesManager::init() {
     }
 
     messages_info.clear();
-    get_messages_info(d->messages.get());
+    get_messages_info(d->messages);
     for (auto &info : messages_info) {
       bool need_update_dialog_pos = false;
       auto m = delete_message(d, info.message_id, true, &need_update_dialog_pos, "Unknown source");
@@ -12913,7 +13066,9 @@ std::pair<DialogId, unique_ptr<MessagesManager::Message>> MessagesManager::creat
   message->reply_in_dialog_id = reply_in_dialog_id;
   message->top_thread_message_id = top_thread_message_id;
   message->via_bot_user_id = via_bot_user_id;
-  message->restriction_reasons = std::move(message_info.restriction_reasons);
+  if (!message_info.restriction_reasons.empty()) {
+    message->get_mutable_extra().restriction_reasons = std::move(message_info.restriction_reasons);
+  }
   message->author_signature = std::move(message_info.author_signature);
   message->is_outgoing = is_outgoing;
   message->is_channel_post = is_channel_post;
@@ -12932,7 +13087,9 @@ std::pair<DialogId, unique_ptr<MessagesManager::Message>> MessagesManager::creat
   message->view_count = view_count;
   message->forward_count = forward_count;
   message->reply_info = std::move(reply_info);
-  message->legacy_layer = (is_legacy ? MTPROTO_LAYER : 0);
+  if (is_legacy) {
+    message->get_mutable_extra().legacy_layer = MTPROTO_LAYER;
+  }
   message->content = std::move(message_info.content);
   message->reply_markup = get_reply_markup(std::move(message_info.reply_markup), td_->auth_manager_->is_bot(), false,
                                            message->contains_mention || dialog_type == DialogType::User);
@@ -13106,7 +13263,7 @@ FullMessageId MessagesManager::on_get_message(MessageInfo &&message_info, bool f
   Dialog *d = get_dialog(dialog_id);
   if (m == nullptr) {
     if (need_update_dialog_pos && d != nullptr) {
-      send_update_chat_last_message(d, "on_get_message");
+      send_update_chat_last_message_batched(d, "on_get_message");
     }
 
     return FullMessageId();
@@ -13136,7 +13293,7 @@ FullMessageId MessagesManager::on_get_message(MessageInfo &&message_info, bool f
   if (dialog_id.get_type() == DialogType::Channel && !have_input_peer(dialog_id, AccessRights::Read)) {
     auto p = delete_message(d, message_id, false, &need_update_dialog_pos, "get a message in inaccessible chat");
     CHECK(p.get() == m);
-    // CHECK(d->messages == nullptr);
+    // CHECK(d->messages.empty());
     send_update_delete_messages(dialog_id, {p->message_id.get()}, false, false);
     // don't need to update dialog pos
     return FullMessageId();
@@ -13144,14 +13301,19 @@ FullMessageId MessagesManager::on_get_message(MessageInfo &&message_info, bool f
 
   send_update_chat_has_scheduled_messages(d, false);
 
-  if (need_update_dialog_pos) {
-    send_update_chat_last_message(d, "on_get_message");
+  // set dialog reply markup only after updateNewMessage and updateChatLastMessage are sent
+  bool need_set_dialog_reply_markup = need_update && m->reply_markup != nullptr && !m->message_id.is_scheduled() &&
+                                      m->reply_markup->type != ReplyMarkup::Type::InlineKeyboard &&
+                                      m->reply_markup->is_personal && !td_->auth_manager_->is_bot();
+  if (need_set_dialog_reply_markup) {
+    if (need_update_dialog_pos || batched_last_message_dialog_ids_.erase(dialog_id) != 0) {
+      send_update_chat_last_message(d, "on_get_message");
+    }
+  } else if (need_update_dialog_pos) {
+    send_update_chat_last_message_batched(d, "on_get_message");
   }
 
-  // set dialog reply markup only after updateNewMessage and updateChatLastMessage are sent
-  if (need_update && m->reply_markup != nullptr && !m->message_id.is_scheduled() &&
-      m->reply_markup->type != ReplyMarkup::Type::InlineKeyboard && m->reply_markup->is_personal &&
-      !td_->auth_manager_->is_bot()) {
+  if (need_set_dialog_reply_markup) {
     set_dialog_reply_markup(d, message_id);
   }
 
@@ -13221,7 +13383,7 @@ void MessagesManager::remove_dialog_newer_messages(Dialog *d, MessageId from_mes
   invalidate_message_indexes(d);
 
   vector<MessageId> to_delete_message_ids;
-  find_newer_messages(d->messages.get(), from_message_id, to_delete_message_ids);
+  find_newer_messages(d->messages, from_message_id, to_delete_message_ids);
   td::remove_if(to_delete_message_ids, [](MessageId message_id) { return message_id.is_yet_unsent(); });
   if (!to_delete_message_ids.empty()) {
     LOG(INFO) << "Delete " << format::as_array(to_delete_message_ids) << " newer than " << from_message_id << " in "
@@ -13535,7 +13697,7 @@ void MessagesManager::remove_dialog_mention_notifications(Dialog *d) {
 
   vector<MessageId> message_ids;
   std::unordered_set<NotificationId, NotificationIdHash> removed_notification_ids_set;
-  find_messages(d->messages.get(), message_ids, [](const Message *m) { return m->contains_unread_mention; });
+  find_messages(d->messages, message_ids, [](const Message *m) { return m->contains_unread_mention; });
   VLOG(notifications) << "Found unread mentions in " << message_ids;
   for (auto &message_id : message_ids) {
     auto m = get_message(d, message_id);
@@ -13635,6 +13797,7 @@ void MessagesManager::on_update_sent_text_message(int64 random_id,
                                "on_update_sent_text_message");
     m->content = std::move(new_content);
     m->is_content_secret = is_secret_message_content(m->ttl, MessageContentType::Text);
+    update_message_search_index(dialog_id, m);
   }
   if (need_update) {
     send_update_message_content(dialog_id, m->message_id, m->content.get(), m->date, m->is_content_secret,
@@ -14141,7 +14304,7 @@ bool MessagesManager::can_unload_message(const Dialog *d, const Message *m) cons
   FullMessageId full_message_id{d->dialog_id, m->message_id};
   return !d->is_opened && m->message_id != d->last_message_id && m->message_id != d->last_database_message_id &&
          !m->message_id.is_yet_unsent() && active_live_location_full_message_ids_.count(full_message_id) == 0 &&
-         replied_by_yet_unsent_messages_.count(full_message_id) == 0 && m->edited_content == nullptr &&
+         replied_by_yet_unsent_messages_.count(full_message_id) == 0 && m->get_extra().edited_content == nullptr &&
          d->suffix_load_queries_.empty() && m->message_id != d->reply_markup_message_id &&
          m->message_id != d->last_pinned_message_id && m->message_id != d->last_edited_message_id;
 }
@@ -14363,8 +14526,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
   }
 
   FullMessageId full_message_id(d->dialog_id, message_id);
-  unique_ptr<Message> *v = treap_find_message(&d->messages, message_id);
-  if (*v == nullptr) {
+  unique_ptr<Message> *v = d->messages.get(message_id);
+  if (v == nullptr) {
     LOG(INFO) << message_id << " is not found in " << d->dialog_id << " to be deleted from " << source;
     if (only_from_memory) {
       return nullptr;
@@ -14401,8 +14564,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
       */
       return nullptr;
     }
-    v = treap_find_message(&d->messages, message_id);
-    CHECK(*v != nullptr);
+    v = d->messages.get(message_id);
+    CHECK(v != nullptr);
   }
 
   const Message *m = v->get();
@@ -14525,7 +14688,7 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
       dump_debug_message_op(d);
     }
   }
-  if ((*v)->have_next && (only_from_memory || !(*v)->have_previous)) {
+  if (m->have_next && (only_from_memory || !m->have_previous)) {
     MessagesIterator it(d, message_id);
     CHECK(*it == m);
     ++it;
@@ -14538,7 +14701,9 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
     }
   }
 
-  auto result = treap_delete_message(v);
+  auto result = d->messages.erase(message_id);
+  on_message_unloaded_from_memory(result.get());
+  delete_message_from_search_index(d->dialog_id, result.get());
 
   d->being_deleted_message_id = MessageId();
 
@@ -14635,8 +14800,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_scheduled_messag
   CHECK(d != nullptr);
   CHECK(message_id.is_valid_scheduled());
 
-  unique_ptr<Message> *v = treap_find_message(&d->scheduled_messages, message_id);
-  if (*v == nullptr) {
+  unique_ptr<Message> *v = d->scheduled_messages.get(message_id);
+  if (v == nullptr) {
     LOG(INFO) << message_id << " is not found in " << d->dialog_id << " to be deleted from " << source;
     auto message = get_message_force(d, message_id, "do_delete_scheduled_message");
     if (message == nullptr) {
@@ -14647,8 +14812,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_scheduled_messag
     }
 
     message_id = message->message_id;
-    v = treap_find_message(&d->scheduled_messages, message_id);
-    CHECK(*v != nullptr);
+    v = d->scheduled_messages.get(message_id);
+    CHECK(v != nullptr);
   }
 
   const Message *m = v->get();
@@ -14660,7 +14825,7 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_scheduled_messag
 
   remove_message_file_sources(d->dialog_id, m);
 
-  auto result = treap_delete_message(v);
+  auto result = d->scheduled_messages.erase(message_id);
 
   if (message_id.is_scheduled_server()) {
     size_t erased_count = d->scheduled_message_date.erase(message_id.get_scheduled_server_message_id());
@@ -14674,31 +14839,31 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_scheduled_messag
   return result;
 }
 
-void MessagesManager::do_delete_all_dialog_messages(Dialog *d, unique_ptr<Message> &message,
-                                                    bool is_permanently_deleted, vector<int64> &deleted_message_ids) {
-  if (message == nullptr) {
-    return;
-  }
-  const Message *m = message.get();
-  MessageId message_id = m->message_id;
+void MessagesManager::do_delete_all_dialog_messages(Dialog *d, MessagesMap &messages, bool is_permanently_deleted,
+                                                    vector<int64> &deleted_message_ids) {
+  // delete messages from the newest, so removal from the map never moves other messages
+  while (!messages.empty()) {
+    auto it = --messages.end();
+    Message *m = it.value().get();
+    MessageId message_id = m->message_id;
 
-  if (is_debug_message_op_enabled()) {
-    d->debug_message_op.emplace_back(Dialog::MessageOp::Delete, m->message_id, m->content->get_type(), false,
-                                     m->have_previous, m->have_next, "delete all messages");
-  }
-
-  LOG(INFO) << "Delete " << message_id;
-  deleted_message_ids.push_back(message_id.get());
+    if (is_debug_message_op_enabled()) {
+      d->debug_message_op.emplace_back(Dialog::MessageOp::Delete, m->message_id, m->content->get_type(), false,
+                                       m->have_previous, m->have_next, "delete all messages");
+    }
 
-  do_delete_all_dialog_messages(d, message->right, is_permanently_deleted, deleted_message_ids);
-  do_delete_all_dialog_messages(d, message->left, is_permanently_deleted, deleted_message_ids);
+    LOG(INFO) << "Delete " << message_id;
+    deleted_message_ids.push_back(message_id.get());
 
-  delete_active_live_location(d->dialog_id, m);
-  remove_message_file_sources(d->dialog_id, m);
+    delete_active_live_location(d->dialog_id, m);
+    remove_message_file_sources(d->dialog_id, m);
 
-  on_message_deleted(d, message.get(), is_permanently_deleted, "do_delete_all_dialog_messages");
+    on_message_deleted(d, m, is_permanently_deleted, "do_delete_all_dialog_messages");
+    on_message_unloaded_from_memory(m);
+    delete_message_from_search_index(d->dialog_id, m);
 
-  message = nullptr;
+    messages.erase(message_id);
+  }
 }
 
 bool MessagesManager::have_dialog(DialogId dialog_id) const {
@@ -15024,7 +15189,7 @@ std::pair<int32, vector<DialogId>> MessagesManager::get_dialogs(DialogListId dia
   update_list_last_pinned_dialog_date(list);
 
   vector<const DialogFolder *> folders;
-  vector<std::set<DialogDate>::const_iterator> folder_iterators;
+  vector<SortedChunkSet<DialogDate>::ConstIterator> folder_iterators;
   for (auto folder_id : get_dialog_list_folder_ids(list)) {
     folders.push_back(get_dialog_folder(folder_id));
     folder_iterators.push_back(folders.back()->ordered_dialogs_.upper_bound(offset));
@@ -15058,6 +15223,9 @@ std::pair<int32, vector<DialogId>> MessagesManager::get_dialogs(DialogListId dia
     if (limit > 0 && list.list_last_dialog_date_ != MAX_DIALOG_DATE) {
       load_dialog_list(list, limit, Promise<Unit>());
     }
+    if (dialog_list_id == DialogListId(FolderId::main())) {
+      schedule_dialog_history_prefetch();
+    }
 
     promise.set_value(Unit());
     return {get_dialog_total_count(list), std::move(result)};
@@ -15194,9 +15362,11 @@ void MessagesManager::on_get_dialogs_from_database(FolderId folder_id, int32 lim
   }
   folder.load_dialog_list_limit_max_ = 0;
 
+  CHECK(dialogs.dialog_ids.size() == dialogs.dialogs.size());
   size_t dialogs_skipped = 0;
-  for (auto &dialog : dialogs.dialogs) {
-    Dialog *d = on_load_dialog_from_database(DialogId(), std::move(dialog));
+  for (size_t i = 0; i < dialogs.dialogs.size(); i++) {
+    // the dialog isn't parsed at all if it is already loaded
+    Dialog *d = on_load_dialog_from_database(dialogs.dialog_ids[i], std::move(dialogs.dialogs[i]));
     if (d == nullptr) {
       dialogs_skipped++;
       continue;
@@ -15209,6 +15379,7 @@ void MessagesManager::on_get_dialogs_from_database(FolderId folder_id, int32 lim
     }
 
     LOG(INFO) << "Loaded from database " << d->dialog_id << " with order " << d->order;
+    folder.loaded_database_dialog_count_++;
   }
 
   DialogDate max_dialog_date(dialogs.next_order, dialogs.next_dialog_id);
@@ -15264,6 +15435,14 @@ void MessagesManager::preload_folder_dialog_list(FolderId folder_id) {
   }
 
   if (folder.last_loaded_database_dialog_date_ < folder.last_database_server_dialog_date_) {
+    auto preload_limit = G()->shared_config().get_option_integer("chat_list_preload_limit");
+    if (preload_limit > 0 && folder.loaded_database_dialog_count_ >= preload_limit) {
+      // the rest of the chats will be loaded from the database on demand, by loadChats or when they are needed
+      LOG(INFO) << "Stop chat list preload in " << folder_id << " after " << folder.loaded_database_dialog_count_
+                << " chats";
+      return;
+    }
+
     // if there are some dialogs in database, preload some of them
     load_folder_dialog_list(folder_id, 20, true, Auto());
   } else if (folder.folder_last_dialog_date_ != MAX_DIALOG_DATE) {
@@ -15280,6 +15459,100 @@ void MessagesManager::preload_folder_dialog_list(FolderId folder_id) {
   }
 }
 
+void MessagesManager::schedule_dialog_history_prefetch() {
+  if (need_dialog_history_prefetch_ || G()->shared_config().get_option_integer("chat_history_prefetch_count") <= 0) {
+    return;
+  }
+
+  need_dialog_history_prefetch_ = true;
+  if (!is_dialog_history_prefetch_active_) {
+    dialog_history_prefetch_timeout_.set_callback(
+        std::move(MessagesManager::on_dialog_history_prefetch_timeout_callback));
+    dialog_history_prefetch_timeout_.set_callback_data(static_cast<void *>(this));
+    dialog_history_prefetch_timeout_.set_timeout_in(DIALOG_HISTORY_PREFETCH_IDLE_DELAY);
+  }
+}
+
+void MessagesManager::postpone_dialog_history_prefetch() {
+  // prefetch is done only while there are no user requests
+  last_dialog_history_request_time_ = Time::now();
+  if (dialog_history_prefetch_timeout_.has_timeout()) {
+    dialog_history_prefetch_timeout_.set_timeout_in(DIALOG_HISTORY_PREFETCH_IDLE_DELAY);
+  }
+}
+
+void MessagesManager::on_dialog_history_prefetch_timeout_callback(void *messages_manager_ptr) {
+  if (G()->close_flag()) {
+    return;
+  }
+  auto messages_manager = static_cast<MessagesManager *>(messages_manager_ptr);
+  send_closure_later(messages_manager->actor_id(messages_manager), &MessagesManager::prefetch_dialog_history);
+}
+
+void MessagesManager::prefetch_dialog_history() {
+  if (G()->close_flag() || !need_dialog_history_prefetch_ || is_dialog_history_prefetch_active_) {
+    return;
+  }
+  CHECK(!td_->auth_manager_->is_bot());
+
+  auto prefetch_count = G()->shared_config().get_option_integer("chat_history_prefetch_count");
+  const auto *list = get_dialog_list(DialogListId(FolderId::main()));
+  CHECK(list != nullptr);
+  vector<DialogId> dialog_ids;
+  for (auto &pinned_dialog : list->pinned_dialogs_) {
+    if (static_cast<int64>(dialog_ids.size()) >= prefetch_count) {
+      break;
+    }
+    dialog_ids.push_back(pinned_dialog.get_dialog_id());
+  }
+  const auto &folder = *get_dialog_folder(FolderId::main());
+  for (auto it = folder.ordered_dialogs_.begin();
+       it != folder.ordered_dialogs_.end() && static_cast<int64>(dialog_ids.size()) < prefetch_count; ++it) {
+    if (it->get_order() == DEFAULT_ORDER) {
+      break;
+    }
+    if (!td::contains(dialog_ids, it->get_dialog_id())) {
+      dialog_ids.push_back(it->get_dialog_id());
+    }
+  }
+
+  for (auto dialog_id : dialog_ids) {
+    if (!prefetched_history_dialog_ids_.insert(dialog_id).second) {
+      continue;
+    }
+    const Dialog *d = get_dialog(dialog_id);
+    if (d == nullptr || !d->last_message_id.is_valid() || d->is_opened ||
+        !have_input_peer(dialog_id, AccessRights::Read)) {
+      // nothing to prefetch or the history is already loaded by the application
+      continue;
+    }
+
+    // messages loaded here are unloaded as usual if the chat isn't opened
+    LOG(INFO) << "Prefetch history of " << dialog_id;
+    is_dialog_history_prefetch_active_ = true;
+    get_history_from_the_end(dialog_id, true, G()->parameters().use_message_db,
+                             PromiseCreator::lambda([actor_id = actor_id(this)](Result<Unit> result) {
+                               send_closure(actor_id, &MessagesManager::on_prefetch_dialog_history);
+                             }));
+    return;
+  }
+
+  LOG(INFO) << "Finished chat history prefetch";
+  need_dialog_history_prefetch_ = false;
+}
+
+void MessagesManager::on_prefetch_dialog_history() {
+  CHECK(is_dialog_history_prefetch_active_);
+  is_dialog_history_prefetch_active_ = false;
+  if (G()->close_flag() || !need_dialog_history_prefetch_) {
+    return;
+  }
+
+  // load chats one by one with a small delay, to not compete with user requests
+  dialog_history_prefetch_timeout_.set_timeout_at(
+      max(Time::now() + 0.1, last_dialog_history_request_time_ + DIALOG_HISTORY_PREFETCH_IDLE_DELAY));
+}
+
 vector<DialogId> MessagesManager::get_pinned_dialog_ids(DialogListId dialog_list_id) const {
   CHECK(!td_->auth_manager_->is_bot());
   auto *list = get_dialog_list(dialog_list_id);
@@ -15925,7 +16198,7 @@ void MessagesManager::block_message_sender_from_replies(MessageId message_id, bo
   }
   if (delete_all_messages && sender_user_id.is_valid()) {
     vector<MessageId> message_ids;
-    find_messages(d->messages.get(), message_ids, [sender_user_id](const Message *m) {
+    find_messages(d->messages, message_ids, [sender_user_id](const Message *m) {
       return !m->is_outgoing && m->forward_info != nullptr && m->forward_info->sender_user_id == sender_user_id;
     });
 
@@ -16433,7 +16706,7 @@ td_api::object_ptr<td_api::messageThreadInfo> MessagesManager::get_message_threa
     if (can_send_message(d->dialog_id).is_ok()) {
       const Message *m = get_message_force(d, top_thread_message_id, "get_message_thread_info_object 2");
       if (m != nullptr && !m->reply_info.is_comment && is_active_message_reply_info(d->dialog_id, m->reply_info)) {
-        draft_message = get_draft_message_object(m->thread_draft_message);
+        draft_message = get_draft_message_object(m->get_extra().thread_draft_message);
       }
     }
   }
@@ -17896,7 +18169,7 @@ Status MessagesManager::set_dialog_draft_message(DialogId dialog_id, MessageId t
       return Status::OK();
     }
 
-    auto &old_draft_message = m->thread_draft_message;
+    auto &old_draft_message = m->get_mutable_extra().thread_draft_message;
     if (((new_draft_message == nullptr) != (old_draft_message == nullptr)) ||
         (new_draft_message != nullptr &&
          (old_draft_message->reply_to_message_id != new_draft_message->reply_to_message_id ||
@@ -18828,7 +19101,8 @@ Status MessagesManager::view_messages(DialogId dialog_id, MessageId top_thread_m
     }
   }
   if (!d->pending_viewed_message_ids.empty()) {
-    pending_message_views_timeout_.add_timeout_in(dialog_id.get(), MAX_MESSAGE_VIEW_DELAY);
+    pending_message_views_timeout_.add_timeout_at(
+        dialog_id.get(), get_batch_flush_time(message_views_batch_flush_time_, MAX_MESSAGE_VIEW_DELAY));
     d->increment_view_counter |= d->is_opened;
   }
   if (!read_content_message_ids.empty()) {
@@ -19015,14 +19289,10 @@ void MessagesManager::open_dialog(Dialog *d) {
   d->is_opened = true;
 
   auto min_message_id = MessageId(ServerMessageId(1));
-  if (d->last_message_id == MessageId() && d->last_read_outbox_message_id < min_message_id && d->messages != nullptr &&
-      d->messages->message_id < min_message_id) {
-    Message *m = d->messages.get();
-    while (m->right != nullptr) {
-      m = m->right.get();
-    }
-    if (m->message_id < min_message_id) {
-      read_history_inbox(dialog_id, m->message_id, -1, "open_dialog");
+  if (d->last_message_id == MessageId() && d->last_read_outbox_message_id < min_message_id && !d->messages.empty()) {
+    auto last_message_id = (--d->messages.end()).key();
+    if (last_message_id < min_message_id) {
+      read_history_inbox(dialog_id, last_message_id, -1, "open_dialog");
     }
   }
 
@@ -19267,7 +19537,7 @@ td_api::object_ptr<td_api::chat> MessagesManager::get_chat_object(const Dialog *
     switch (d->dialog_id.get_type()) {
       case DialogType::User:
         can_delete_for_self = true;
-        can_delete_for_all_users = G()->shared_config().get_option_boolean("revoke_pm_inbox", true);
+        can_delete_for_all_users = G()->shared_config().get_option_boolean(ConfigShared::OptionId::RevokePmInbox, true);
         if (d->dialog_id == get_my_dialog_id() || td_->contacts_manager_->is_user_deleted(d->dialog_id.get_user_id()) ||
             td_->contacts_manager_->is_user_bot(d->dialog_id.get_user_id())) {
           can_delete_for_all_users = false;
@@ -19700,6 +19970,8 @@ tl_object_ptr<td_api::messages> MessagesManager::get_dialog_history(DialogId dia
     return nullptr;
   }
 
+  postpone_dialog_history_prefetch();
+
   LOG(INFO) << "Get " << (only_local ? "local " : "") << "history in " << dialog_id << " from " << from_message_id
             << " with offset " << offset << " and limit " << limit << ", " << left_tries
             << " tries left. Last read inbox message is " << d->last_read_inbox_message_id
@@ -19721,13 +19993,10 @@ tl_object_ptr<td_api::messages> MessagesManager::get_dialog_history(DialogId dia
     bool have_a_gap = false;
     if (*p == nullptr) {
       // there is no gap if from_message_id is less than first message in the dialog
-      if (left_tries == 0 && d->messages != nullptr && offset < 0) {
-        const Message *cur = d->messages.get();
-        while (cur->left != nullptr) {
-          cur = cur->left.get();
-        }
-        CHECK(cur->message_id > from_message_id);
-        from_message_id = cur->message_id;
+      if (left_tries == 0 && !d->messages.empty() && offset < 0) {
+        auto first_message_id = d->messages.begin().key();
+        CHECK(first_message_id > from_message_id);
+        from_message_id = first_message_id;
         p = MessagesConstIterator(d, from_message_id);
       } else {
         have_a_gap = true;
@@ -19904,7 +20173,12 @@ void MessagesManager::read_history_on_server(Dialog *d, MessageId max_message_id
   d->updated_read_history_message_ids.insert(MessageId());
 
   bool need_delay = d->is_opened && !is_secret && d->server_unread_count > 0;
-  pending_read_history_timeout_.set_timeout_in(dialog_id.get(), need_delay ? MIN_READ_HISTORY_DELAY : 0);
+  if (need_delay) {
+    pending_read_history_timeout_.set_timeout_in(dialog_id.get(), MIN_READ_HISTORY_DELAY);
+  } else {
+    pending_read_history_timeout_.set_timeout_at(
+        dialog_id.get(), get_batch_flush_time(read_history_batch_flush_time_, READ_HISTORY_BATCH_DELAY));
+  }
 }
 
 void MessagesManager::read_message_thread_history_on_server(Dialog *d, MessageId top_thread_message_id,
@@ -19934,7 +20208,21 @@ void MessagesManager::read_message_thread_history_on_server(Dialog *d, MessageId
   d->updated_read_history_message_ids.insert(top_thread_message_id);
 
   bool need_delay = d->is_opened && last_message_id.is_valid() && max_message_id != last_message_id;
-  pending_read_history_timeout_.set_timeout_in(dialog_id.get(), need_delay ? MIN_READ_HISTORY_DELAY : 0);
+  if (need_delay) {
+    pending_read_history_timeout_.set_timeout_in(dialog_id.get(), MIN_READ_HISTORY_DELAY);
+  } else {
+    pending_read_history_timeout_.set_timeout_at(
+        dialog_id.get(), get_batch_flush_time(read_history_batch_flush_time_, READ_HISTORY_BATCH_DELAY));
+  }
+}
+
+double MessagesManager::get_batch_flush_time(double &flush_time, double delay) {
+  // all requests scheduled before the returned time are sent together and can be packed by the session
+  auto now = Time::now();
+  if (flush_time <= now) {
+    flush_time = now + delay;
+  }
+  return flush_time;
 }
 
 void MessagesManager::do_read_history_on_server(DialogId dialog_id) {
@@ -20202,8 +20490,8 @@ std::pair<DialogId, vector<MessageId>> MessagesManager::get_message_thread_histo
     }
 
     Message *top_m = get_message_force(d, top_thread_full_message_id.get_message_id(), "get_message_thread_history 2");
-    if (top_m != nullptr && !top_m->local_thread_message_ids.empty()) {
-      vector<MessageId> &message_ids = top_m->local_thread_message_ids;
+    if (top_m != nullptr && !top_m->get_extra().local_thread_message_ids.empty()) {
+      vector<MessageId> &message_ids = top_m->get_mutable_extra().local_thread_message_ids;
       vector<MessageId> merge_message_ids;
       while (true) {
         merge_message_ids = get_message_history_slice(
@@ -20384,6 +20672,18 @@ std::pair<int32, vector<MessageId>> MessagesManager::search_dialog_messages(
     }
   }
 
+  if (!query.empty() && top_thread_message_id == MessageId() && can_search_dialog_messages_in_memory(dialog_id)) {
+    auto index = get_message_search_index(d);
+    if (index != nullptr) {
+      LOG(INFO) << "Search messages in memory in " << dialog_id << " from " << from_message_id << " and with limit "
+                << limit;
+      found_dialog_messages_[random_id] = search_dialog_messages_in_memory(d, *index, query, sender_dialog_id,
+                                                                           from_message_id, offset, limit, filter);
+      promise.set_value(Unit());
+      return result;
+    }
+  }
+
   // Trying to use database
   if (use_db && query.empty() && G()->parameters().use_message_db && filter != MessageSearchFilter::Empty &&
       !sender_dialog_id.is_valid() && top_thread_message_id == MessageId()) {
@@ -20978,6 +21278,110 @@ void MessagesManager::on_search_dialog_messages_db_result(int64 random_id, Dialo
   promise.set_value(Unit());
 }
 
+bool MessagesManager::can_search_dialog_messages_in_memory(DialogId dialog_id) const {
+  // bots can't search messages on the server and all messages of secret chats are in memory without message database
+  return td_->auth_manager_->is_bot() ||
+         (dialog_id.get_type() == DialogType::SecretChat && !G()->parameters().use_message_db);
+}
+
+const MessagesManager::MessageSearchIndex *MessagesManager::get_message_search_index(const Dialog *d) {
+  CHECK(d != nullptr);
+  auto it = message_search_indexes_.find(d->dialog_id);
+  if (it != message_search_indexes_.end()) {
+    return it->second.get();
+  }
+
+  auto index = make_unique<MessageSearchIndex>();
+  for (auto message_it = d->messages.begin(); message_it != d->messages.end(); ++message_it) {
+    if (!add_message_to_search_index(index.get(), message_it.value().get())) {
+      LOG(INFO) << "Messages in " << d->dialog_id << " are too big to be indexed";
+      index = nullptr;
+      break;
+    }
+  }
+  auto result = index.get();
+  message_search_indexes_.emplace(d->dialog_id, std::move(index));
+  return result;
+}
+
+bool MessagesManager::add_message_to_search_index(MessageSearchIndex *index, const Message *m) const {
+  CHECK(index != nullptr);
+  CHECK(m != nullptr);
+  if (m->message_id.is_yet_unsent()) {
+    return true;
+  }
+
+  auto key = m->message_id.get();
+  auto text = get_message_search_text(m);
+  index->text_size -= index->hints.key_to_string(key).size();
+  index->text_size += text.size();
+  index->hints.add(key, text);
+  if (!text.empty()) {
+    // newer messages must be found first
+    index->hints.set_rating(key, -key);
+  }
+  return index->text_size <= MAX_MESSAGE_SEARCH_INDEX_TEXT_SIZE;
+}
+
+void MessagesManager::update_message_search_index(DialogId dialog_id, const Message *m) {
+  auto it = message_search_indexes_.find(dialog_id);
+  if (it == message_search_indexes_.end() || it->second == nullptr) {
+    return;
+  }
+  if (!add_message_to_search_index(it->second.get(), m)) {
+    LOG(INFO) << "Messages in " << dialog_id << " became too big to be indexed";
+    it->second = nullptr;
+  }
+}
+
+void MessagesManager::delete_message_from_search_index(DialogId dialog_id, const Message *m) {
+  CHECK(m != nullptr);
+  auto it = message_search_indexes_.find(dialog_id);
+  if (it == message_search_indexes_.end() || it->second == nullptr) {
+    return;
+  }
+  auto &index = *it->second;
+  auto key = m->message_id.get();
+  index.text_size -= index.hints.key_to_string(key).size();
+  index.hints.remove(key);
+}
+
+std::pair<int32, vector<MessageId>> MessagesManager::search_dialog_messages_in_memory(
+    const Dialog *d, const MessageSearchIndex &index, Slice query, DialogId sender_dialog_id,
+    MessageId from_message_id, int32 offset, int32 limit, MessageSearchFilter filter) const {
+  auto index_mask = message_search_filter_index_mask(filter);
+  vector<MessageId> message_ids;
+  for (auto key : index.hints.search(query, narrow_cast<int32>(index.hints.size())).second) {
+    const Message *m = get_message(d, MessageId(key));
+    CHECK(m != nullptr);
+    if (index_mask != 0 && (get_message_index_mask(d->dialog_id, m) & index_mask) == 0) {
+      continue;
+    }
+    if (sender_dialog_id.is_valid() &&
+        (m->sender_dialog_id.is_valid() ? m->sender_dialog_id : DialogId(m->sender_user_id)) != sender_dialog_id) {
+      continue;
+    }
+    message_ids.push_back(m->message_id);
+  }
+
+  // found messages are sorted from the newest to the oldest; return them like the server does
+  size_t from_pos = 0;
+  if (from_message_id != MessageId()) {
+    while (from_pos < message_ids.size() && message_ids[from_pos] >= from_message_id) {
+      from_pos++;
+    }
+  }
+  auto begin_pos = static_cast<size_t>(max(static_cast<int64>(from_pos) + offset, static_cast<int64>(0)));
+  auto end_pos = min(begin_pos + static_cast<size_t>(limit), message_ids.size());
+
+  std::pair<int32, vector<MessageId>> result;
+  result.first = narrow_cast<int32>(message_ids.size());
+  if (begin_pos < end_pos) {
+    result.second.assign(message_ids.begin() + begin_pos, message_ids.begin() + end_pos);
+  }
+  return result;
+}
+
 td_api::object_ptr<td_api::foundMessages> MessagesManager::get_found_messages_object(
     const FoundMessages &found_messages) {
   vector<tl_object_ptr<td_api::message>> result;
@@ -21213,7 +21617,7 @@ int64 MessagesManager::get_dialog_message_by_date(DialogId dialog_id, int32 date
            get_dialog_message_by_date_results_.find(random_id) != get_dialog_message_by_date_results_.end());
   get_dialog_message_by_date_results_[random_id];  // reserve place for result
 
-  auto message_id = find_message_by_date(d->messages.get(), date);
+  auto message_id = find_message_by_date(d->messages, date);
   if (message_id.is_valid() && (message_id == d->last_message_id || get_message(d, message_id)->have_next)) {
     get_dialog_message_by_date_results_[random_id] = {dialog_id, message_id};
     promise.set_value(Unit());
@@ -21235,21 +21639,12 @@ int64 MessagesManager::get_dialog_message_by_date(DialogId dialog_id, int32 date
   return random_id;
 }
 
-MessageId MessagesManager::find_message_by_date(const Message *m, int32 date) {
-  if (m == nullptr) {
+MessageId MessagesManager::find_message_by_date(const MessagesMap &messages, int32 date) {
+  auto it = messages.partition_point([date](const unique_ptr<Message> &m) { return m->date <= date; });
+  if (it == messages.begin()) {
     return MessageId();
   }
-
-  if (m->date > date) {
-    return find_message_by_date(m->left.get(), date);
-  }
-
-  auto message_id = find_message_by_date(m->right.get(), date);
-  if (message_id.is_valid()) {
-    return message_id;
-  }
-
-  return m->message_id;
+  return (--it).key();
 }
 
 void MessagesManager::on_get_dialog_message_by_date_from_database(DialogId dialog_id, int32 date, int64 random_id,
@@ -21263,7 +21658,7 @@ void MessagesManager::on_get_dialog_message_by_date_from_database(DialogId dialo
     Message *m =
         on_get_message_from_database(dialog_id, d, result.ok(), false, "on_get_dialog_message_by_date_from_database");
     if (m != nullptr) {
-      auto message_id = find_message_by_date(d->messages.get(), date);
+      auto message_id = find_message_by_date(d->messages, date);
       if (!message_id.is_valid()) {
         LOG(ERROR) << "Failed to find " << m->message_id << " in " << dialog_id << " by date " << date;
         message_id = m->message_id;
@@ -21287,7 +21682,7 @@ void MessagesManager::get_dialog_message_by_date_from_server(const Dialog *d, in
       return promise.set_value(Unit());
     }
 
-    auto message_id = find_message_by_date(d->messages.get(), date);
+    auto message_id = find_message_by_date(d->messages, date);
     if (message_id.is_valid()) {
       get_dialog_message_by_date_results_[random_id] = {d->dialog_id, message_id};
     }
@@ -21322,7 +21717,7 @@ void MessagesManager::on_get_dialog_message_by_date_success(DialogId dialog_id,
       if (result != FullMessageId()) {
         const Dialog *d = get_dialog(dialog_id);
         CHECK(d != nullptr);
-        auto message_id = find_message_by_date(d->messages.get(), date);
+        auto message_id = find_message_by_date(d->messages, date);
         if (!message_id.is_valid()) {
           LOG(ERROR) << "Failed to find " << result.get_message_id() << " in " << dialog_id << " by date " << date;
           message_id = result.get_message_id();
@@ -21382,6 +21777,25 @@ int32 MessagesManager::get_dialog_message_count(DialogId dialog_id, MessageSearc
       message_count = d->unread_mention_count;
     }
   }
+  if (message_count == -1 && !return_local && dialog_type == DialogType::SecretChat &&
+      filter != MessageSearchFilter::FailedToSend && G()->parameters().use_message_db) {
+    // all messages in secret chats are stored locally, so they can be counted in the database
+    LOG(INFO) << "Get number of messages in " << dialog_id << " filtered by " << filter << " from the database";
+
+    do {
+      random_id = Random::secure_int64();
+    } while (random_id == 0 || found_dialog_messages_.find(random_id) != found_dialog_messages_.end());
+    found_dialog_messages_[random_id];  // reserve place for result
+
+    G()->td_db()->get_messages_db_async()->get_dialog_message_count(
+        dialog_id, message_search_filter_index_mask(filter),
+        PromiseCreator::lambda([actor_id = actor_id(this), dialog_id, filter, random_id,
+                                promise = std::move(promise)](Result<int32> r_message_count) mutable {
+          send_closure(actor_id, &MessagesManager::on_get_dialog_message_count_from_database, dialog_id, filter,
+                       random_id, std::move(r_message_count), std::move(promise));
+        }));
+    return -1;
+  }
   if (message_count != -1 || return_local || dialog_type == DialogType::SecretChat ||
       filter == MessageSearchFilter::FailedToSend) {
     promise.set_value(Unit());
@@ -21410,6 +21824,25 @@ int32 MessagesManager::get_dialog_message_count(DialogId dialog_id, MessageSearc
   return -1;
 }
 
+void MessagesManager::on_get_dialog_message_count_from_database(DialogId dialog_id, MessageSearchFilter filter,
+                                                                int64 random_id, Result<int32> r_message_count,
+                                                                Promise<Unit> &&promise) {
+  auto it = found_dialog_messages_.find(random_id);
+  CHECK(it != found_dialog_messages_.end());
+  if (G()->close_flag()) {
+    found_dialog_messages_.erase(it);
+    return promise.set_error(Status::Error(500, "Request aborted"));
+  }
+  if (r_message_count.is_error()) {
+    LOG(ERROR) << "Failed to get number of messages in " << dialog_id << " filtered by " << filter
+               << " from the database: " << r_message_count.error();
+    it->second.first = -1;
+  } else {
+    it->second.first = r_message_count.ok();
+  }
+  promise.set_value(Unit());
+}
+
 void MessagesManager::preload_newer_messages(const Dialog *d, MessageId max_message_id) {
   CHECK(d != nullptr);
   CHECK(max_message_id.is_valid());
@@ -21480,6 +21913,28 @@ unique_ptr<MessagesManager::Message> MessagesManager::parse_message(DialogId dia
   return m;
 }
 
+// returns identifier of a message from the database without parsing of the whole message,
+// or an invalid identifier if it can't be fetched; must be kept in sync with Message::store
+MessageId MessagesManager::get_database_message_id(const BufferSlice &value, bool is_scheduled) {
+  constexpr uint32 HAS_FLAGS2_FLAG = 1u << 29;
+
+  LogEventParser parser(value.as_slice());
+  auto flags = static_cast<uint32>(parser.fetch_int());
+  if ((flags & HAS_FLAGS2_FLAG) != 0) {
+    parser.fetch_int();
+  }
+  MessageId message_id;
+  td::parse(message_id, parser);
+  if (parser.get_error() != nullptr) {
+    return MessageId();
+  }
+  bool is_message_id_valid = is_scheduled ? message_id.is_valid_scheduled() : message_id.is_valid();
+  if (!is_message_id_valid) {
+    return MessageId();
+  }
+  return message_id;
+}
+
 void MessagesManager::on_get_history_from_database(DialogId dialog_id, MessageId from_message_id, int32 offset,
                                                    int32 limit, bool from_the_end, bool only_local,
                                                    vector<BufferSlice> &&messages, Promise<Unit> &&promise) {
@@ -21505,7 +21960,7 @@ void MessagesManager::on_get_history_from_database(DialogId dialog_id, MessageId
             << " with offset " << offset << " and limit " << limit << ". First database message is "
             << d->first_database_message_id << ", have_full_history = " << d->have_full_history;
 
-  if (messages.empty() && from_the_end && d->messages == nullptr) {
+  if (messages.empty() && from_the_end && d->messages.empty()) {
     if (d->have_full_history) {
       set_dialog_is_empty(d, "on_get_history_from_database empty");
     } else if (d->last_database_message_id.is_valid()) {
@@ -21533,45 +21988,54 @@ void MessagesManager::on_get_history_from_database(DialogId dialog_id, MessageId
     if (!d->first_database_message_id.is_valid() && !d->have_full_history) {
       break;
     }
-    auto message = parse_message(dialog_id, std::move(message_slice), false);
-    if (message == nullptr) {
-      if (d->have_full_history) {
-        d->have_full_history = false;
-        on_dialog_updated(dialog_id, "drop have_full_history in on_get_history_from_database");
+    // messages, which are already loaded, are newer than messages in the database and don't need to be parsed
+    auto message_id = get_database_message_id(message_slice, false);
+    auto old_message = get_message(d, message_id);
+    unique_ptr<Message> message;
+    if (old_message == nullptr) {
+      message = parse_message(dialog_id, std::move(message_slice), false);
+      if (message == nullptr) {
+        if (d->have_full_history) {
+          d->have_full_history = false;
+          on_dialog_updated(dialog_id, "drop have_full_history in on_get_history_from_database");
+        }
+        break;
       }
-      break;
+      message_id = message->message_id;
+      old_message = get_message(d, message_id);
     }
-    if (message->message_id >= last_received_message_id) {
+    if (message_id >= last_received_message_id) {
       // TODO move to ERROR
-      LOG(FATAL) << "Receive " << message->message_id << " after " << last_received_message_id
+      LOG(FATAL) << "Receive " << message_id << " after " << last_received_message_id
                  << " from database in the history of " << dialog_id << " from " << from_message_id << " with offset "
                  << offset << ", limit " << limit << ", from_the_end = " << from_the_end;
       break;
     }
-    last_received_message_id = message->message_id;
+    last_received_message_id = message_id;
 
-    if (message->message_id < d->first_database_message_id) {
+    if (message_id < d->first_database_message_id) {
       if (d->have_full_history) {
-        LOG(ERROR) << "Have full history in the " << dialog_id << " and receive " << message->message_id
+        LOG(ERROR) << "Have full history in the " << dialog_id << " and receive " << message_id
                    << " from database, but first database message is " << d->first_database_message_id;
       } else {
         break;
       }
     }
-    if (!have_next && (from_the_end || (is_first && offset < -1 && message->message_id <= from_message_id)) &&
-        message->message_id < d->last_message_id) {
+    if (!have_next && (from_the_end || (is_first && offset < -1 && message_id <= from_message_id)) &&
+        message_id < d->last_message_id) {
       // last message in the dialog must be attached to the next local message
       have_next = true;
     }
 
-    message->have_previous = false;
-    message->have_next = have_next;
-    message->from_database = true;
+    Message *m = old_message;
+    if (m == nullptr) {
+      message->have_previous = false;
+      message->have_next = have_next;
+      message->from_database = true;
 
-    auto old_message = get_message(d, message->message_id);
-    Message *m = old_message ? old_message
-                             : add_message_to_dialog(d, std::move(message), false, &need_update,
-                                                     &need_update_dialog_pos, "on_get_history_from_database");
+      m = add_message_to_dialog(d, std::move(message), false, &need_update, &need_update_dialog_pos,
+                                "on_get_history_from_database");
+    }
     if (m != nullptr) {
       first_added_message_id = m->message_id;
       if (!have_next) {
@@ -21813,7 +22277,7 @@ vector<MessageId> MessagesManager::get_dialog_scheduled_messages(DialogId dialog
   }
 
   vector<MessageId> message_ids;
-  find_old_messages(d->scheduled_messages.get(),
+  find_old_messages(d->scheduled_messages,
                     MessageId(ScheduledServerMessageId(), std::numeric_limits<int32>::max(), true), message_ids);
   std::reverse(message_ids.begin(), message_ids.end());
 
@@ -21903,6 +22367,10 @@ void MessagesManager::on_get_scheduled_messages_from_database(DialogId dialog_id
   Dependencies dependencies;
   vector<MessageId> added_message_ids;
   for (auto &message_slice : messages) {
+    if (get_message(d, get_database_message_id(message_slice, true)) != nullptr) {
+      continue;
+    }
+
     auto message = parse_message(dialog_id, std::move(message_slice), true);
     if (message == nullptr) {
       continue;
@@ -22053,8 +22521,10 @@ tl_object_ptr<td_api::MessageSendingState> MessagesManager::get_message_sending_
     return td_api::make_object<td_api::messageSendingStatePending>();
   }
   if (m->is_failed_to_send) {
+    const auto &extra = m->get_extra();
     return td_api::make_object<td_api::messageSendingStateFailed>(
-        m->send_error_code, m->send_error_message, can_resend_message(m), max(m->try_resend_at - Time::now(), 0.0));
+        extra.send_error_code, extra.send_error_message, can_resend_message(m),
+        max(extra.try_resend_at - Time::now(), 0.0));
   }
   return nullptr;
 }
@@ -22156,7 +22626,7 @@ tl_object_ptr<td_api::message> MessagesManager::get_message_object(DialogId dial
       contains_unread_mention, date, edit_date, get_message_forward_info_object(m->forward_info),
       get_message_interaction_info_object(dialog_id, m), reply_in_dialog_id.get(), reply_to_message_id,
       top_thread_message_id, ttl, ttl_expires_in, via_bot_user_id, m->author_signature, media_album_id,
-      get_restriction_reason_description(m->restriction_reasons),
+      get_restriction_reason_description(m->get_extra().restriction_reasons),
       get_message_content_object(m->content.get(), td_, live_location_date, m->is_content_secret),
       get_reply_markup_object(m->reply_markup));
 }
@@ -22292,7 +22762,7 @@ MessagesManager::Message *MessagesManager::get_message_to_send(
   m->is_copy = is_copy || forward_info != nullptr;
 
   if (td_->auth_manager_->is_bot() || options.disable_notification ||
-      G()->shared_config().get_option_boolean("ignore_default_disable_notification")) {
+      G()->shared_config().get_option_boolean(ConfigShared::OptionId::IgnoreDefaultDisableNotification)) {
     m->disable_notification = options.disable_notification;
   } else {
     auto notification_settings = get_dialog_notification_settings(dialog_id, true);
@@ -22310,7 +22780,7 @@ MessagesManager::Message *MessagesManager::get_message_to_send(
     if (reply_to_message_id.is_valid()) {
       auto *reply_to_message = get_message_force(d, reply_to_message_id, "get_message_to_send");
       if (reply_to_message != nullptr) {
-        m->reply_to_random_id = reply_to_message->random_id;
+        m->get_mutable_extra().reply_to_random_id = reply_to_message->random_id;
       } else {
         m->reply_to_message_id = MessageId();
       }
@@ -22663,7 +23133,7 @@ void MessagesManager::cancel_send_message_query(DialogId dialog_id, Message *m)
 
   cancel_upload_message_content_files(m->content.get());
 
-  CHECK(m->edited_content == nullptr);
+  CHECK(m->get_extra().edited_content == nullptr);
 
   if (!m->send_query_ref.empty()) {
     LOG(INFO) << "Cancel send query for " << m->message_id;
@@ -22753,7 +23223,7 @@ void MessagesManager::add_message_dependencies(Dependencies &dependencies, Dialo
   dependencies.user_ids.insert(m->sender_user_id);
   add_dialog_and_dependencies(dependencies, m->sender_dialog_id);
   add_dialog_and_dependencies(dependencies, m->reply_in_dialog_id);
-  add_dialog_and_dependencies(dependencies, m->real_forward_from_dialog_id);
+  add_dialog_and_dependencies(dependencies, m->get_extra().real_forward_from_dialog_id);
   dependencies.user_ids.insert(m->via_bot_user_id);
   if (m->forward_info != nullptr) {
     dependencies.user_ids.insert(m->forward_info->sender_user_id);
@@ -23076,6 +23546,8 @@ Result<vector<MessageId>> MessagesManager::send_message_group(
 
   // there must be no errors after get_message_to_send calls
 
+  // all messages of the album are saved to the binlog at once
+  BinlogBatch log_event_batch(G()->td_db()->get_binlog());
   vector<MessageId> result;
   bool need_update_dialog_pos = false;
   for (size_t i = 0; i < message_contents.size(); i++) {
@@ -23092,11 +23564,12 @@ Result<vector<MessageId>> MessagesManager::send_message_group(
     }
     m->media_album_id = media_album_id;
 
-    save_send_message_log_event(dialog_id, m);
+    save_send_message_log_event(dialog_id, m, &log_event_batch);
     do_send_message(dialog_id, m);
 
     send_update_new_message(d, m);
   }
+  log_event_batch.commit();
 
   if (need_update_dialog_pos) {
     send_update_chat_last_message(d, "send_message_group");
@@ -23105,7 +23578,7 @@ Result<vector<MessageId>> MessagesManager::send_message_group(
   return result;
 }
 
-void MessagesManager::save_send_message_log_event(DialogId dialog_id, const Message *m) {
+void MessagesManager::save_send_message_log_event(DialogId dialog_id, const Message *m, BinlogBatch *batch) {
   if (!G()->parameters().use_message_db) {
     return;
   }
@@ -23114,8 +23587,12 @@ void MessagesManager::save_send_message_log_event(DialogId dialog_id, const Mess
   LOG(INFO) << "Save " << FullMessageId(dialog_id, m->message_id) << " to binlog";
   auto log_event = SendMessageLogEvent(dialog_id, m);
   CHECK(m->send_message_log_event_id == 0);
-  m->send_message_log_event_id =
-      binlog_add(G()->td_db()->get_binlog(), LogEvent::HandlerType::SendMessage, get_log_event_storer(log_event));
+  if (batch != nullptr) {
+    m->send_message_log_event_id = batch->add(LogEvent::HandlerType::SendMessage, get_log_event_storer(log_event));
+  } else {
+    m->send_message_log_event_id =
+        binlog_add(G()->td_db()->get_binlog(), LogEvent::HandlerType::SendMessage, get_log_event_storer(log_event));
+  }
 }
 
 void MessagesManager::do_send_message(DialogId dialog_id, const Message *m, vector<int> bad_parts) {
@@ -23132,7 +23609,7 @@ void MessagesManager::do_send_message(DialogId dialog_id, const Message *m, vect
     request.results.push_back(Status::OK());
   }
 
-  auto content = is_edit ? m->edited_content.get() : m->content.get();
+  auto content = is_edit ? m->get_extra().edited_content.get() : m->content.get();
   CHECK(content != nullptr);
   auto content_type = content->get_type();
   if (content_type == MessageContentType::Text) {
@@ -23190,8 +23667,8 @@ void MessagesManager::on_message_media_uploaded(DialogId dialog_id, const Messag
 
   auto message_id = m->message_id;
   if (message_id.is_any_server()) {
-    const FormattedText *caption = get_message_content_caption(m->edited_content.get());
-    auto input_reply_markup = get_input_reply_markup(m->edited_reply_markup);
+    const FormattedText *caption = get_message_content_caption(m->get_extra().edited_content.get());
+    auto input_reply_markup = get_input_reply_markup(m->get_extra().edited_reply_markup);
     bool was_uploaded = FileManager::extract_was_uploaded(input_media);
     bool was_thumbnail_uploaded = FileManager::extract_was_thumbnail_uploaded(input_media);
 
@@ -23199,7 +23676,7 @@ void MessagesManager::on_message_media_uploaded(DialogId dialog_id, const Messag
     auto schedule_date = get_message_schedule_date(m);
     auto promise = PromiseCreator::lambda(
         [actor_id = actor_id(this), dialog_id, message_id, file_id, thumbnail_file_id, schedule_date,
-         generation = m->edit_generation, was_uploaded, was_thumbnail_uploaded,
+         generation = m->get_extra().edit_generation, was_uploaded, was_thumbnail_uploaded,
          file_reference = FileManager::extract_file_reference(input_media)](Result<Unit> result) mutable {
           send_closure(actor_id, &MessagesManager::on_message_media_edited, dialog_id, message_id, file_id,
                        thumbnail_file_id, was_uploaded, was_thumbnail_uploaded, std::move(file_reference),
@@ -23309,8 +23786,9 @@ void MessagesManager::on_secret_message_media_uploaded(DialogId dialog_id, const
               entities = get_input_secret_message_entities(caption->entities, layer);
             }
             send_closure(td_->create_net_actor<SendSecretMessageActor>(), &SendSecretMessageActor::send, dialog_id,
-                         m->reply_to_random_id, m->ttl, "", std::move(secret_input_media), std::move(entities),
-                         m->via_bot_user_id, m->media_album_id, m->disable_notification, random_id);
+                         m->get_extra().reply_to_random_id, m->ttl, "", std::move(secret_input_media),
+                         std::move(entities), m->via_bot_user_id, m->media_album_id, m->disable_notification,
+                         random_id);
           }));
 }
 
@@ -23584,7 +24062,7 @@ void MessagesManager::on_text_message_ready_to_send(DialogId dialog_id, MessageI
     CHECK(!message_id.is_scheduled());
     auto layer = td_->contacts_manager_->get_secret_chat_layer(dialog_id.get_secret_chat_id());
     send_closure(td_->create_net_actor<SendSecretMessageActor>(), &SendSecretMessageActor::send, dialog_id,
-                 m->reply_to_random_id, m->ttl, message_text->text,
+                 m->get_extra().reply_to_random_id, m->ttl, message_text->text,
                  get_secret_input_media(content, td_, nullptr, BufferSlice(), layer),
                  get_input_secret_message_entities(message_text->entities, layer), m->via_bot_user_id,
                  m->media_album_id, m->disable_notification, random_id);
@@ -24052,7 +24530,8 @@ bool MessagesManager::can_edit_message(DialogId dialog_id, const Message *m, boo
 
   if (has_edit_time_limit) {
     const int32 DEFAULT_EDIT_TIME_LIMIT = 2 * 86400;
-    int64 edit_time_limit = G()->shared_config().get_option_integer("edit_time_limit", DEFAULT_EDIT_TIME_LIMIT);
+    int64 edit_time_limit =
+        G()->shared_config().get_option_integer(ConfigShared::OptionId::EditTimeLimit, DEFAULT_EDIT_TIME_LIMIT);
     if (G()->unix_time_cached() - m->date - (is_editing ? 300 : 0) >= edit_time_limit) {
       return false;
     }
@@ -24129,14 +24608,15 @@ bool MessagesManager::can_edit_message(DialogId dialog_id, const Message *m, boo
 }
 
 bool MessagesManager::can_resend_message(const Message *m) const {
-  if (m->send_error_code != 429 && m->send_error_message != "Message is too old to be re-sent automatically" &&
-      m->send_error_message != "SCHEDULE_TOO_MUCH") {
+  const auto &extra = m->get_extra();
+  if (extra.send_error_code != 429 && extra.send_error_message != "Message is too old to be re-sent automatically" &&
+      extra.send_error_message != "SCHEDULE_TOO_MUCH") {
     return false;
   }
   if (m->is_bot_start_message) {
     return false;
   }
-  if (m->forward_info != nullptr || m->real_forward_from_dialog_id.is_valid()) {
+  if (m->forward_info != nullptr || m->get_extra().real_forward_from_dialog_id.is_valid()) {
     // TODO implement resending of forwarded messages
     return false;
   }
@@ -24174,7 +24654,7 @@ bool MessagesManager::is_deleted_secret_chat(const Dialog *d) const {
     return false;
   }
 
-  if (d->order != DEFAULT_ORDER || d->messages != nullptr) {
+  if (d->order != DEFAULT_ORDER || !d->messages.empty()) {
     return false;
   }
 
@@ -24190,8 +24670,8 @@ int32 MessagesManager::get_message_schedule_date(const Message *m) {
   if (!m->message_id.is_scheduled()) {
     return 0;
   }
-  if (m->edited_schedule_date != 0) {
-    return m->edited_schedule_date;
+  if (m->get_extra().edited_schedule_date != 0) {
+    return m->get_extra().edited_schedule_date;
   }
   return m->date;
 }
@@ -24338,16 +24818,16 @@ void MessagesManager::edit_message_live_location(FullMessageId full_message_id,
 }
 
 void MessagesManager::cancel_edit_message_media(DialogId dialog_id, Message *m, Slice error_message) {
-  if (m->edited_content == nullptr) {
+  if (m->get_extra().edited_content == nullptr) {
     return;
   }
 
-  cancel_upload_message_content_files(m->edited_content.get());
+  cancel_upload_message_content_files(m->get_extra().edited_content.get());
 
-  m->edited_content = nullptr;
-  m->edited_reply_markup = nullptr;
-  m->edit_generation = 0;
-  m->edit_promise.set_error(Status::Error(400, error_message));
+  m->get_mutable_extra().edited_content = nullptr;
+  m->get_mutable_extra().edited_reply_markup = nullptr;
+  m->get_mutable_extra().edit_generation = 0;
+  m->get_mutable_extra().edit_promise.set_error(Status::Error(400, error_message));
 }
 
 void MessagesManager::on_message_media_edited(DialogId dialog_id, MessageId message_id, FileId file_id,
@@ -24356,22 +24836,23 @@ void MessagesManager::on_message_media_edited(DialogId dialog_id, MessageId mess
                                               Result<Unit> &&result) {
   CHECK(message_id.is_any_server());
   auto m = get_message({dialog_id, message_id});
-  if (m == nullptr || m->edit_generation != generation) {
+  if (m == nullptr || m->get_extra().edit_generation != generation) {
     // message is already deleted or was edited again
     return;
   }
 
-  CHECK(m->edited_content != nullptr);
+  CHECK(m->get_extra().edited_content != nullptr);
   if (result.is_ok()) {
     // message content has already been replaced from updateEdit{Channel,}Message
     // TODO check that it really was replaced
     // need only merge files from edited_content with their uploaded counterparts
     // updateMessageContent was already sent and needs to be sent again,
     // only if 'i' and 't' sizes from edited_content was added to the photo
-    std::swap(m->content, m->edited_content);
-    bool need_send_update_message_content = m->edited_content->get_type() == MessageContentType::Photo &&
+    auto &edited_content = m->get_mutable_extra().edited_content;
+    std::swap(m->content, edited_content);
+    bool need_send_update_message_content = edited_content->get_type() == MessageContentType::Photo &&
                                             m->content->get_type() == MessageContentType::Photo;
-    update_message_content(dialog_id, m, std::move(m->edited_content), need_send_update_message_content, true, true);
+    update_message_content(dialog_id, m, std::move(edited_content), need_send_update_message_content, true, true);
   } else {
     if (was_uploaded) {
       if (was_thumbnail_uploaded) {
@@ -24400,23 +24881,23 @@ void MessagesManager::on_message_media_edited(DialogId dialog_id, MessageId mess
       }
     }
 
-    cancel_upload_message_content_files(m->edited_content.get());
+    cancel_upload_message_content_files(m->get_extra().edited_content.get());
 
     if (dialog_id.get_type() != DialogType::SecretChat) {
       get_message_from_server({dialog_id, m->message_id}, Auto());
     }
   }
 
-  if (m->edited_schedule_date == schedule_date) {
-    m->edited_schedule_date = 0;
+  if (m->get_extra().edited_schedule_date == schedule_date) {
+    m->get_mutable_extra().edited_schedule_date = 0;
   }
-  m->edited_content = nullptr;
-  m->edited_reply_markup = nullptr;
-  m->edit_generation = 0;
+  m->get_mutable_extra().edited_content = nullptr;
+  m->get_mutable_extra().edited_reply_markup = nullptr;
+  m->get_mutable_extra().edit_generation = 0;
   if (result.is_ok()) {
-    m->edit_promise.set_value(Unit());
+    m->get_mutable_extra().edit_promise.set_value(Unit());
   } else {
-    m->edit_promise.set_error(result.move_as_error());
+    m->get_mutable_extra().edit_promise.set_error(result.move_as_error());
   }
 }
 
@@ -24498,12 +24979,12 @@ void MessagesManager::edit_message_media(FullMessageId full_message_id,
 
   cancel_edit_message_media(dialog_id, m, "Cancelled by new editMessageMedia request");
 
-  m->edited_content =
+  m->get_mutable_extra().edited_content =
       dup_message_content(td_, dialog_id, content.content.get(), MessageContentDupType::Send, MessageCopyOptions());
-  CHECK(m->edited_content != nullptr);
-  m->edited_reply_markup = r_new_reply_markup.move_as_ok();
-  m->edit_generation = ++current_message_edit_generation_;
-  m->edit_promise = std::move(promise);
+  CHECK(m->get_extra().edited_content != nullptr);
+  m->get_mutable_extra().edited_reply_markup = r_new_reply_markup.move_as_ok();
+  m->get_mutable_extra().edit_generation = ++current_message_edit_generation_;
+  m->get_mutable_extra().edit_promise = std::move(promise);
 
   do_send_message(dialog_id, m);
 }
@@ -24820,7 +25301,7 @@ void MessagesManager::edit_message_scheduling_state(
   if (get_message_schedule_date(m) == schedule_date) {
     return promise.set_value(Unit());
   }
-  m->edited_schedule_date = schedule_date;
+  m->get_mutable_extra().edited_schedule_date = schedule_date;
 
   if (schedule_date > 0) {
     send_closure(td_->create_net_actor<EditMessageActor>(std::move(promise)), &EditMessageActor::send, 0, dialog_id,
@@ -25590,8 +26071,8 @@ Result<vector<MessageId>> MessagesManager::forward_messages(DialogId to_dialog_i
     Message *m = get_message_to_send(to_dialog, MessageId(), MessageId(), message_send_options, std::move(content),
                                      &need_update_dialog_pos, j + 1 != forwarded_message_contents.size(),
                                      std::move(forward_info));
-    m->real_forward_from_dialog_id = from_dialog_id;
-    m->real_forward_from_message_id = message_id;
+    m->get_mutable_extra().real_forward_from_dialog_id = from_dialog_id;
+    m->get_mutable_extra().real_forward_from_message_id = message_id;
     m->via_bot_user_id = forwarded_message->via_bot_user_id;
     m->in_game_share = in_game_share;
     m->media_album_id = new_media_album_ids[forwarded_message_contents[j].media_album_id].first;
@@ -25716,7 +26197,7 @@ Result<vector<MessageId>> MessagesManager::resend_messages(DialogId dialog_id, v
     if (!can_resend_message(m)) {
       return Status::Error(400, "Message can't be re-sent");
     }
-    if (m->try_resend_at > Time::now()) {
+    if (m->get_extra().try_resend_at > Time::now()) {
       return Status::Error(400, "Message can't be re-sent yet");
     }
     if (last_message_id != MessageId()) {
@@ -26224,7 +26705,7 @@ Result<MessagesManager::MessagePushNotificationInfo> MessagesManager::get_messag
   }
 
   if (is_from_scheduled && dialog_id != get_my_dialog_id() &&
-      G()->shared_config().get_option_boolean("disable_sent_scheduled_message_notifications")) {
+      G()->shared_config().get_option_boolean(ConfigShared::OptionId::DisableSentScheduledMessageNotifications)) {
     return Status::Error("Ignore notification about sent scheduled message");
   }
 
@@ -27052,7 +27533,7 @@ bool MessagesManager::is_message_notification_disabled(const Dialog *d, const Me
     return true;
   }
   if (m->is_from_scheduled && d->dialog_id != get_my_dialog_id() &&
-      G()->shared_config().get_option_boolean("disable_sent_scheduled_message_notifications")) {
+      G()->shared_config().get_option_boolean(ConfigShared::OptionId::DisableSentScheduledMessageNotifications)) {
     return true;
   }
 
@@ -27458,7 +27939,7 @@ void MessagesManager::send_update_delete_messages(DialogId dialog_id, vector<int
 
 void MessagesManager::send_update_new_chat(Dialog *d) {
   CHECK(d != nullptr);
-  CHECK(d->messages == nullptr);
+  CHECK(d->messages.empty());
   auto chat_object = get_chat_object(d);
   bool has_action_bar = chat_object->action_bar_ != nullptr;
   d->last_sent_has_scheduled_messages = chat_object->has_scheduled_messages_;
@@ -27491,6 +27972,34 @@ void MessagesManager::send_update_chat_last_message(Dialog *d, const char *sourc
   send_update_chat_last_message_impl(d, source);
 }
 
+void MessagesManager::send_update_chat_last_message_batched(Dialog *d, const char *source) {
+  if (!is_updates_batch_active_) {
+    return send_update_chat_last_message(d, source);
+  }
+
+  LOG(INFO) << "Postpone updateChatLastMessage in " << d->dialog_id << " from " << source;
+  batched_last_message_dialog_ids_.insert(d->dialog_id);
+}
+
+void MessagesManager::start_updates_batch() {
+  CHECK(!is_updates_batch_active_);
+  is_updates_batch_active_ = true;
+}
+
+void MessagesManager::finish_updates_batch() {
+  CHECK(is_updates_batch_active_);
+  is_updates_batch_active_ = false;
+
+  auto dialog_ids = std::move(batched_last_message_dialog_ids_);
+  batched_last_message_dialog_ids_.clear();
+  LOG(INFO) << "Send postponed updateChatLastMessage in " << dialog_ids.size() << " chats";
+  for (auto dialog_id : dialog_ids) {
+    auto d = get_dialog(dialog_id);
+    CHECK(d != nullptr);
+    send_update_chat_last_message(d, "finish_updates_batch");
+  }
+}
+
 void MessagesManager::send_update_chat_last_message_impl(const Dialog *d, const char *source) const {
   if (td_->auth_manager_->is_bot()) {
     return;
@@ -27749,7 +28258,7 @@ void MessagesManager::send_update_chat_has_scheduled_messages(Dialog *d, bool fr
     return;
   }
 
-  if (d->scheduled_messages == nullptr) {
+  if (d->scheduled_messages.empty()) {
     if (d->has_scheduled_database_messages) {
       if (d->has_loaded_scheduled_messages_from_database) {
         set_dialog_has_scheduled_database_messages_impl(d, false);
@@ -27770,7 +28279,7 @@ void MessagesManager::send_update_chat_has_scheduled_messages(Dialog *d, bool fr
 
   LOG(INFO) << "In " << d->dialog_id << " have scheduled messages on server = " << d->has_scheduled_server_messages
             << ", in database = " << d->has_scheduled_database_messages
-            << " and in memory = " << (d->scheduled_messages != nullptr)
+            << " and in memory = " << (!d->scheduled_messages.empty())
             << "; was loaded from database = " << d->has_loaded_scheduled_messages_from_database;
   bool has_scheduled_messages = get_dialog_has_scheduled_messages(d);
   if (has_scheduled_messages == d->last_sent_has_scheduled_messages) {
@@ -28354,14 +28863,14 @@ void MessagesManager::fail_send_message(FullMessageId full_message_id, int error
     message->view_count = 0;
   }
   message->is_failed_to_send = true;
-  message->send_error_code = error_code;
-  message->send_error_message = error_message;
-  message->try_resend_at = 0.0;
+  message->get_mutable_extra().send_error_code = error_code;
+  message->get_mutable_extra().send_error_message = error_message;
+  message->get_mutable_extra().try_resend_at = 0.0;
   Slice retry_after_prefix("Too Many Requests: retry after ");
   if (error_code == 429 && begins_with(error_message, retry_after_prefix)) {
     auto r_retry_after = to_integer_safe<int32>(error_message.substr(retry_after_prefix.size()));
     if (r_retry_after.is_ok() && r_retry_after.ok() > 0) {
-      message->try_resend_at = Time::now() + r_retry_after.ok();
+      message->get_mutable_extra().try_resend_at = Time::now() + r_retry_after.ok();
     }
   }
   update_failed_to_send_message_content(td_, message->content);
@@ -28412,8 +28921,8 @@ void MessagesManager::fail_edit_message_media(FullMessageId full_message_id, Sta
     // message has already been deleted by the user or sent to inaccessible channel
     return;
   }
-  CHECK(m->edited_content != nullptr);
-  m->edit_promise.set_error(std::move(error));
+  CHECK(m->get_extra().edited_content != nullptr);
+  m->get_mutable_extra().edit_promise.set_error(std::move(error));
   cancel_edit_message_media(dialog_id, m, "Failed to edit message. MUST BE IGNORED");
 }
 
@@ -28755,7 +29264,7 @@ void MessagesManager::on_update_dialog_has_scheduled_server_messages(DialogId di
   if (d->has_scheduled_server_messages != has_scheduled_server_messages) {
     set_dialog_has_scheduled_server_messages(d, has_scheduled_server_messages);
   } else if (has_scheduled_server_messages !=
-             (d->has_scheduled_database_messages || d->scheduled_messages != nullptr)) {
+             (d->has_scheduled_database_messages || !d->scheduled_messages.empty())) {
     repair_dialog_scheduled_messages(d);
   }
 }
@@ -28786,8 +29295,8 @@ void MessagesManager::set_dialog_has_scheduled_database_messages_impl(Dialog *d,
     return;
   }
 
-  if (d->has_scheduled_database_messages && d->scheduled_messages != nullptr &&
-      !d->scheduled_messages->message_id.is_yet_unsent()) {
+  if (d->has_scheduled_database_messages && !d->scheduled_messages.empty() &&
+      !d->scheduled_messages.begin().key().is_yet_unsent()) {
     // to prevent race between add_message_to_database and check of has_scheduled_database_messages
     return;
   }
@@ -29063,7 +29572,7 @@ void MessagesManager::on_dialog_linked_channel_updated(DialogId dialog_id, Chann
   auto d = get_dialog(dialog_id);  // no need to create the dialog
   if (d != nullptr && d->is_update_new_chat_sent) {
     vector<MessageId> message_ids;
-    find_messages(d->messages.get(), message_ids, [old_linked_channel_id, new_linked_channel_id](const Message *m) {
+    find_messages(d->messages, message_ids, [old_linked_channel_id, new_linked_channel_id](const Message *m) {
       return !m->reply_info.is_empty() && m->reply_info.channel_id.is_valid() &&
              (m->reply_info.channel_id == old_linked_channel_id || m->reply_info.channel_id == new_linked_channel_id);
     });
@@ -29428,7 +29937,7 @@ bool MessagesManager::get_dialog_has_scheduled_messages(const Dialog *d) const {
   }
   // TODO send updateChatHasScheduledMessage when can_post_messages changes
 
-  return d->has_scheduled_server_messages || d->has_scheduled_database_messages || d->scheduled_messages != nullptr;
+  return d->has_scheduled_server_messages || d->has_scheduled_database_messages || !d->scheduled_messages.empty();
 }
 
 bool MessagesManager::is_dialog_action_unneeded(DialogId dialog_id) const {
@@ -30075,7 +30584,7 @@ void MessagesManager::unpin_all_dialog_messages(DialogId dialog_id, Promise<Unit
   TRY_STATUS_PROMISE(promise, can_pin_messages(dialog_id));
 
   vector<MessageId> message_ids;
-  find_messages(d->messages.get(), message_ids, [](const Message *m) { return m->is_pinned; });
+  find_messages(d->messages, message_ids, [](const Message *m) { return m->is_pinned; });
 
   vector<int64> deleted_message_ids;
   for (auto message_id : message_ids) {
@@ -30793,79 +31302,6 @@ tl_object_ptr<td_api::chatEvents> MessagesManager::get_chat_events_object(int64
   return result;
 }
 
-unique_ptr<MessagesManager::Message> *MessagesManager::treap_find_message(unique_ptr<Message> *v,
-                                                                          MessageId message_id) {
-  return const_cast<unique_ptr<Message> *>(treap_find_message(static_cast<const unique_ptr<Message> *>(v), message_id));
-}
-
-const unique_ptr<MessagesManager::Message> *MessagesManager::treap_find_message(const unique_ptr<Message> *v,
-                                                                                MessageId message_id) {
-  while (*v != nullptr) {
-    if ((*v)->message_id < message_id) {
-      v = &(*v)->right;
-    } else if ((*v)->message_id > message_id) {
-      v = &(*v)->left;
-    } else {
-      break;
-    }
-  }
-  return v;
-}
-
-MessagesManager::Message *MessagesManager::treap_insert_message(unique_ptr<Message> *v, unique_ptr<Message> message) {
-  auto message_id = message->message_id;
-  while (*v != nullptr && (*v)->random_y >= message->random_y) {
-    if ((*v)->message_id < message_id) {
-      v = &(*v)->right;
-    } else if ((*v)->message_id == message_id) {
-      UNREACHABLE();
-    } else {
-      v = &(*v)->left;
-    }
-  }
-
-  unique_ptr<Message> *left = &message->left;
-  unique_ptr<Message> *right = &message->right;
-
-  unique_ptr<Message> cur = std::move(*v);
-  while (cur != nullptr) {
-    if (cur->message_id < message_id) {
-      *left = std::move(cur);
-      left = &((*left)->right);
-      cur = std::move(*left);
-    } else {
-      *right = std::move(cur);
-      right = &((*right)->left);
-      cur = std::move(*right);
-    }
-  }
-  CHECK(*left == nullptr);
-  CHECK(*right == nullptr);
-  *v = std::move(message);
-  return v->get();
-}
-
-unique_ptr<MessagesManager::Message> MessagesManager::treap_delete_message(unique_ptr<Message> *v) {
-  unique_ptr<Message> result = std::move(*v);
-  unique_ptr<Message> left = std::move(result->left);
-  unique_ptr<Message> right = std::move(result->right);
-
-  while (left != nullptr || right != nullptr) {
-    if (left == nullptr || (right != nullptr && right->random_y > left->random_y)) {
-      *v = std::move(right);
-      v = &((*v)->left);
-      right = std::move(*v);
-    } else {
-      *v = std::move(left);
-      v = &((*v)->right);
-      left = std::move(*v);
-    }
-  }
-  CHECK(*v == nullptr);
-
-  return result;
-}
-
 MessagesManager::Message *MessagesManager::get_message(Dialog *d, MessageId message_id) {
   return const_cast<Message *>(get_message(static_cast<const Dialog *>(d), message_id));
 }
@@ -30886,7 +31322,8 @@ const MessagesManager::Message *MessagesManager::get_message(const Dialog *d, Me
       CHECK(message_id.is_scheduled_server());
     }
   }
-  auto result = treap_find_message(is_scheduled ? &d->scheduled_messages : &d->messages, message_id)->get();
+  auto message = (is_scheduled ? d->scheduled_messages : d->messages).get(message_id);
+  auto result = message == nullptr ? nullptr : message->get();
   if (result != nullptr && !is_scheduled) {
     result->last_access_date = G()->unix_time_cached();
   }
@@ -30938,9 +31375,15 @@ MessagesManager::Message *MessagesManager::on_get_message_from_database(DialogId
     return nullptr;
   }
 
-  auto m = parse_message(dialog_id, std::move(value), is_scheduled);
-  if (m == nullptr) {
-    return nullptr;
+  // data in the database is always outdated, so there is no need to parse it if the message is in the memory
+  unique_ptr<Message> m;
+  auto message_id = d == nullptr ? MessageId() : get_database_message_id(value, is_scheduled);
+  if (d == nullptr || get_message(d, message_id) == nullptr) {
+    m = parse_message(dialog_id, std::move(value), is_scheduled);
+    if (m == nullptr) {
+      return nullptr;
+    }
+    message_id = m->message_id;
   }
 
   if (d == nullptr) {
@@ -30964,7 +31407,7 @@ MessagesManager::Message *MessagesManager::on_get_message_from_database(DialogId
     return nullptr;
   }
 
-  auto old_message = get_message(d, m->message_id);
+  auto old_message = get_message(d, message_id);
   if (old_message != nullptr) {
     // data in the database is always outdated, so return a message from the memory
     if (dialog_id.get_type() == DialogType::SecretChat) {
@@ -30980,6 +31423,7 @@ MessagesManager::Message *MessagesManager::on_get_message_from_database(DialogId
 
     return old_message;
   }
+  CHECK(m != nullptr);
 
   Dependencies dependencies;
   add_message_dependencies(dependencies, d->dialog_id, m.get());
@@ -30999,13 +31443,8 @@ MessagesManager::Message *MessagesManager::on_get_message_from_database(DialogId
   return result;
 }
 
-int32 MessagesManager::get_random_y(MessageId message_id) {
-  return static_cast<int32>(static_cast<uint32>(message_id.get() * 2101234567u));
-}
-
 void MessagesManager::set_message_id(unique_ptr<Message> &message, MessageId message_id) {
   message->message_id = message_id;
-  message->random_y = get_random_y(message_id);
 }
 
 MessagesManager::Message *MessagesManager::add_message_to_dialog(DialogId dialog_id, unique_ptr<Message> message,
@@ -31376,7 +31815,7 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     on_dialog_updated(dialog_id, "drop have_full_history");
   }
 
-  if (!d->is_opened && d->messages != nullptr && is_message_unload_enabled()) {
+  if (!d->is_opened && !d->messages.empty() && is_message_unload_enabled()) {
     LOG(INFO) << "Schedule unload of " << dialog_id;
     pending_unload_dialog_timeout_.add_timeout_in(dialog_id.get(), get_unload_dialog_delay());
   }
@@ -31484,16 +31923,8 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     }
     if (!is_attached && !message_id.is_yet_unsent()) {
       // message may be attached to the next message if there is no previous message
-      Message *cur = d->messages.get();
-      Message *next_message = nullptr;
-      while (cur != nullptr) {
-        if (cur->message_id < message_id) {
-          cur = cur->right.get();
-        } else {
-          next_message = cur;
-          cur = cur->left.get();
-        }
-      }
+      auto next_it = d->messages.lower_bound(message_id);
+      Message *next_message = next_it == d->messages.end() ? nullptr : next_it.value().get();
       if (next_message != nullptr) {
         CHECK(!next_message->have_previous);
         LOG(INFO) << "Attach " << message_id << " to the next " << next_message->message_id;
@@ -31667,7 +32098,7 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     cancel_user_dialog_action(dialog_id, m);
     try_hide_distance(dialog_id, m);
 
-    if (!td_->auth_manager_->is_bot() && d->messages == nullptr && !m->is_outgoing && dialog_id != get_my_dialog_id()) {
+    if (!td_->auth_manager_->is_bot() && d->messages.empty() && !m->is_outgoing && dialog_id != get_my_dialog_id()) {
       switch (dialog_id.get_type()) {
         case DialogType::User:
           td_->contacts_manager_->invalidate_user_full(dialog_id.get_user_id());
@@ -31692,10 +32123,12 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     }
   }
 
-  Message *result_message = treap_insert_message(&d->messages, std::move(message));
+  Message *result_message = d->messages.insert(m->message_id, std::move(message)).get();
   CHECK(result_message != nullptr);
   CHECK(result_message == m);
-  CHECK(d->messages != nullptr);
+  CHECK(!d->messages.empty());
+  on_message_loaded_to_memory(result_message);
+  update_message_search_index(dialog_id, result_message);
 
   if (!is_attached) {
     if (m->have_next) {
@@ -31871,9 +32304,9 @@ MessagesManager::Message *MessagesManager::add_scheduled_message_to_dialog(Dialo
     date = m->date;
   }
 
-  Message *result_message = treap_insert_message(&d->scheduled_messages, std::move(message));
+  Message *result_message = d->scheduled_messages.insert(m->message_id, std::move(message)).get();
   CHECK(result_message != nullptr);
-  CHECK(d->scheduled_messages != nullptr);
+  CHECK(!d->scheduled_messages.empty());
   being_readded_message_id_ = FullMessageId();
   return result_message;
 }
@@ -31889,12 +32322,12 @@ void MessagesManager::register_new_local_message_id(Dialog *d, const Message *m)
   if (m->top_thread_message_id.is_valid() && m->top_thread_message_id != m->message_id) {
     Message *top_m = get_message_force(d, m->top_thread_message_id, "register_new_local_message_id");
     if (top_m != nullptr && top_m->top_thread_message_id == top_m->message_id) {
-      auto it = std::lower_bound(top_m->local_thread_message_ids.begin(), top_m->local_thread_message_ids.end(),
-                                 m->message_id);
-      if (it == top_m->local_thread_message_ids.end() || *it != m->message_id) {
-        top_m->local_thread_message_ids.insert(it, m->message_id);
-        if (top_m->local_thread_message_ids.size() >= 1000) {
-          top_m->local_thread_message_ids.erase(top_m->local_thread_message_ids.begin());
+      auto &local_thread_message_ids = top_m->get_mutable_extra().local_thread_message_ids;
+      auto it = std::lower_bound(local_thread_message_ids.begin(), local_thread_message_ids.end(), m->message_id);
+      if (it == local_thread_message_ids.end() || *it != m->message_id) {
+        local_thread_message_ids.insert(it, m->message_id);
+        if (local_thread_message_ids.size() >= 1000) {
+          local_thread_message_ids.erase(local_thread_message_ids.begin());
         }
         on_message_changed(d, top_m, false, "register_new_local_message_id");
       }
@@ -31918,6 +32351,23 @@ void MessagesManager::on_message_changed(const Dialog *d, const Message *m, bool
   }
 }
 
+void MessagesManager::on_message_interaction_info_changed(const Dialog *d, const Message *m, const char *source) {
+  CHECK(d != nullptr);
+  CHECK(m != nullptr);
+  if (m->message_id == d->last_message_id) {
+    send_update_chat_last_message_impl(d, source);
+  }
+
+  if (m->message_id == d->last_database_message_id) {
+    on_dialog_updated(d->dialog_id, source);
+  }
+
+  if (!m->message_id.is_yet_unsent()) {
+    // neither indexed fields nor the search text depend on the interaction info
+    update_message_data_in_database(d, m, source);
+  }
+}
+
 void MessagesManager::add_message_to_database(const Dialog *d, const Message *m, const char *source) {
   if (!G()->parameters().use_message_db) {
     return;
@@ -31978,6 +32428,22 @@ void MessagesManager::add_message_to_database(const Dialog *d, const Message *m,
                                                      Auto());  // TODO Promise
 }
 
+void MessagesManager::update_message_data_in_database(const Dialog *d, const Message *m, const char *source) {
+  if (!G()->parameters().use_message_db) {
+    return;
+  }
+
+  CHECK(d != nullptr);
+  CHECK(m != nullptr);
+  if (m->message_id.is_scheduled()) {
+    return add_message_to_database(d, m, source);
+  }
+
+  LOG(INFO) << "Update " << FullMessageId(d->dialog_id, m->message_id) << " in database from " << source;
+  G()->td_db()->get_messages_db_async()->update_message_data({d->dialog_id, m->message_id}, log_event_store(*m),
+                                                             Auto());
+}
+
 void MessagesManager::delete_all_dialog_messages_from_database(Dialog *d, MessageId max_message_id,
                                                                const char *source) {
   CHECK(d != nullptr);
@@ -32121,10 +32587,10 @@ void MessagesManager::delete_message_from_database(Dialog *d, MessageId message_
     // must not load the message from the database
     Message *top_m = get_message(d, m->top_thread_message_id);
     if (top_m != nullptr && top_m->top_thread_message_id == top_m->message_id) {
-      auto it = std::lower_bound(top_m->local_thread_message_ids.begin(), top_m->local_thread_message_ids.end(),
-                                 m->message_id);
-      if (it != top_m->local_thread_message_ids.end() && *it == m->message_id) {
-        top_m->local_thread_message_ids.erase(it);
+      const auto &local_thread_message_ids = top_m->get_extra().local_thread_message_ids;
+      auto it = std::lower_bound(local_thread_message_ids.begin(), local_thread_message_ids.end(), m->message_id);
+      if (it != local_thread_message_ids.end() && *it == m->message_id) {
+        top_m->get_mutable_extra().local_thread_message_ids.erase(it);
         on_message_changed(d, top_m, false, "delete_message_from_database");
       }
     }
@@ -32263,7 +32729,6 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
   CHECK(old_message != nullptr);
   CHECK(new_message != nullptr);
   CHECK(old_message->message_id == new_message->message_id);
-  CHECK(old_message->random_y == new_message->random_y);
   CHECK(need_update_dialog_pos != nullptr);
 
   DialogId dialog_id = d->dialog_id;
@@ -32271,8 +32736,9 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
   bool is_scheduled = message_id.is_scheduled();
   bool need_send_update = false;
   bool is_new_available = new_message->content->get_type() != MessageContentType::ChatDeleteHistory;
-  bool replace_legacy = (old_message->legacy_layer != 0 &&
-                         (new_message->legacy_layer == 0 || old_message->legacy_layer < new_message->legacy_layer)) ||
+  auto old_legacy_layer = old_message->get_extra().legacy_layer;
+  auto new_legacy_layer = new_message->get_extra().legacy_layer;
+  bool replace_legacy = (old_legacy_layer != 0 && (new_legacy_layer == 0 || old_legacy_layer < new_legacy_layer)) ||
                         old_message->content->get_type() == MessageContentType::Unsupported;
   bool was_visible_message_reply_info = is_visible_message_reply_info(dialog_id, old_message);
   if (old_message->date != new_message->date) {
@@ -32294,8 +32760,8 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
                  << new_message->content->get_type();
     }
   }
-  if (old_message->date == old_message->edited_schedule_date) {
-    old_message->edited_schedule_date = 0;
+  if (old_message->date == old_message->get_extra().edited_schedule_date) {
+    old_message->get_mutable_extra().edited_schedule_date = 0;
   }
   bool is_edited = false;
   int32 old_shown_edit_date = old_message->hide_edit_date ? 0 : old_message->edit_date;
@@ -32353,8 +32819,8 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
     if (new_message->forward_info != nullptr) {
       if (!replace_legacy) {
         LOG(ERROR) << message_id << " in " << dialog_id << " has received forward info " << *new_message->forward_info
-                   << ", really forwarded from " << old_message->real_forward_from_message_id << " in "
-                   << old_message->real_forward_from_dialog_id << ", message content type is "
+                   << ", really forwarded from " << old_message->get_extra().real_forward_from_message_id << " in "
+                   << old_message->get_extra().real_forward_from_dialog_id << ", message content type is "
                    << old_message->content->get_type() << '/' << new_message->content->get_type();
       }
       old_message->forward_info = std::move(new_message->forward_info);
@@ -32371,9 +32837,9 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
         if (!is_forward_info_sender_hidden(new_message->forward_info.get()) && !replace_legacy) {
           LOG(ERROR) << message_id << " in " << dialog_id << " has changed forward info from "
                      << *old_message->forward_info << " to " << *new_message->forward_info << ", really forwarded from "
-                     << old_message->real_forward_from_message_id << " in " << old_message->real_forward_from_dialog_id
-                     << ", message content type is " << old_message->content->get_type() << '/'
-                     << new_message->content->get_type();
+                     << old_message->get_extra().real_forward_from_message_id << " in "
+                     << old_message->get_extra().real_forward_from_dialog_id << ", message content type is "
+                     << old_message->content->get_type() << '/' << new_message->content->get_type();
         }
         old_message->forward_info = std::move(new_message->forward_info);
         need_send_update = true;
@@ -32381,8 +32847,8 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
     } else if (is_new_available) {
       LOG(ERROR) << message_id << " in " << dialog_id << " sent by " << old_message->sender_user_id << "/"
                  << old_message->sender_dialog_id << " has lost forward info " << *old_message->forward_info
-                 << ", really forwarded from " << old_message->real_forward_from_message_id << " in "
-                 << old_message->real_forward_from_dialog_id << ", message content type is "
+                 << ", really forwarded from " << old_message->get_extra().real_forward_from_message_id << " in "
+                 << old_message->get_extra().real_forward_from_dialog_id << ", message content type is "
                  << old_message->content->get_type() << '/' << new_message->content->get_type();
       old_message->forward_info = nullptr;
       need_send_update = true;
@@ -32515,11 +32981,11 @@ bool MessagesManager::update_message(Dialog *d, Message *old_message, unique_ptr
                                       std::move(new_message->reply_info))) {
     need_send_update = true;
   }
-  if (old_message->restriction_reasons != new_message->restriction_reasons) {
-    old_message->restriction_reasons = std::move(new_message->restriction_reasons);
+  if (old_message->get_extra().restriction_reasons != new_message->get_extra().restriction_reasons) {
+    old_message->get_mutable_extra().restriction_reasons = new_message->get_extra().restriction_reasons;
   }
-  if (old_message->legacy_layer != new_message->legacy_layer) {
-    old_message->legacy_layer = new_message->legacy_layer;
+  if (old_message->get_extra().legacy_layer != new_message->get_extra().legacy_layer) {
+    old_message->get_mutable_extra().legacy_layer = new_message->get_extra().legacy_layer;
   }
   if ((old_message->media_album_id == 0 || td_->auth_manager_->is_bot()) && new_message->media_album_id != 0) {
     old_message->media_album_id = new_message->media_album_id;
@@ -32653,7 +33119,7 @@ bool MessagesManager::need_message_changed_warning(const Message *old_message) {
   }
   if (old_message->message_id.is_yet_unsent() &&
       (old_message->forward_info != nullptr || old_message->had_forward_info ||
-       old_message->real_forward_from_dialog_id.is_valid())) {
+       old_message->get_extra().real_forward_from_dialog_id.is_valid())) {
     // original message may be edited
     return false;
   }
@@ -32744,6 +33210,9 @@ bool MessagesManager::update_message_content(DialogId dialog_id, Message *old_me
     }
     old_content = std::move(new_content);
     update_message_content_file_id_remote(old_content.get(), old_file_id);
+    if (is_message_in_dialog) {
+      update_message_search_index(dialog_id, old_message);
+    }
   } else {
     update_message_content_file_id_remote(old_content.get(), get_message_content_any_file_id(new_content.get()));
   }
@@ -32978,7 +33447,12 @@ MessagesManager::Dialog *MessagesManager::add_new_dialog(unique_ptr<Dialog> &&d,
     d->notification_settings.is_synchronized = true;
   }
 
-  unique_ptr<Message> last_database_message = std::move(d->messages);
+  unique_ptr<Message> last_database_message;
+  if (!d->messages.empty()) {
+    CHECK(d->messages.size() == 1);
+    auto message_id = d->messages.begin().key();
+    last_database_message = d->messages.erase(message_id);
+  }
   MessageId last_database_message_id = d->last_database_message_id;
   d->last_database_message_id = MessageId();
   int64 order = d->order;
@@ -33207,7 +33681,7 @@ void MessagesManager::fix_new_dialog(Dialog *d, unique_ptr<Message> &&last_datab
     }
     depend_on_dialog(last_database_message->sender_dialog_id);
     depend_on_dialog(last_database_message->reply_in_dialog_id);
-    depend_on_dialog(last_database_message->real_forward_from_dialog_id);
+    depend_on_dialog(last_database_message->get_extra().real_forward_from_dialog_id);
 
     if (dependent_dialog_count == 0) {
       add_dialog_last_database_message(d, std::move(last_database_message));
@@ -33321,18 +33795,15 @@ void MessagesManager::fix_new_dialog(Dialog *d, unique_ptr<Message> &&last_datab
                       << ", last_new_message_id = " << d->last_new_message_id
                       << ", max_notification_message_id = " << d->max_notification_message_id;
 
-  if (d->messages != nullptr) {
-    CHECK(d->messages->message_id == last_message_id);
-    CHECK(d->messages->left == nullptr);
-    CHECK(d->messages->right == nullptr);
+  if (!d->messages.empty()) {
+    CHECK(d->messages.size() == 1);
+    CHECK(d->messages.begin().key() == last_message_id);
   }
 }
 
 void MessagesManager::add_dialog_last_database_message(Dialog *d, unique_ptr<Message> &&last_database_message) {
   CHECK(d != nullptr);
   CHECK(last_database_message != nullptr);
-  CHECK(last_database_message->left == nullptr);
-  CHECK(last_database_message->right == nullptr);
 
   auto message_id = last_database_message->message_id;
   CHECK(message_id.is_valid());
@@ -33600,7 +34071,7 @@ bool MessagesManager::set_dialog_order(Dialog *d, int64 new_order, bool need_sen
   if (old_date == new_date) {
     if (new_order == DEFAULT_ORDER) {
       // first addition of a new left dialog
-      if (folder.ordered_dialogs_.insert(new_date).second) {
+      if (folder.ordered_dialogs_.insert(new_date)) {
         for (auto &dialog_list : dialog_lists_) {
           if (get_dialog_pinned_order(&dialog_list.second, d->dialog_id) != DEFAULT_ORDER) {
             set_dialog_is_pinned(dialog_list.first, d, false);
@@ -33997,8 +34468,8 @@ unique_ptr<MessagesManager::Dialog> MessagesManager::parse_dialog(DialogId dialo
 
   Dependencies dependencies;
   add_dialog_dependencies(dependencies, dialog_id);
-  if (d->messages != nullptr) {
-    add_message_dependencies(dependencies, dialog_id, d->messages.get());
+  if (!d->messages.empty()) {
+    add_message_dependencies(dependencies, dialog_id, d->messages.begin().value().get());
   }
   if (d->draft_message != nullptr) {
     add_formatted_text_dependencies(dependencies, &d->draft_message->input_message_text.text);
@@ -34127,27 +34598,16 @@ bool MessagesManager::need_dialog_in_filter(const Dialog *d, const DialogFilter
   CHECK(filter != nullptr);
   CHECK(d->order != DEFAULT_ORDER);
 
-  if (InputDialogId::contains(filter->pinned_dialog_ids, d->dialog_id)) {
-    return true;
-  }
-  if (InputDialogId::contains(filter->included_dialog_ids, d->dialog_id)) {
-    return true;
-  }
-  if (InputDialogId::contains(filter->excluded_dialog_ids, d->dialog_id)) {
-    return false;
+  auto inclusion = filter->get_dialog_inclusion(d->dialog_id);
+  if (inclusion != 0) {
+    return inclusion > 0;
   }
   if (d->dialog_id.get_type() == DialogType::SecretChat) {
     auto user_id = td_->contacts_manager_->get_secret_chat_user_id(d->dialog_id.get_secret_chat_id());
     if (user_id.is_valid()) {
-      auto dialog_id = DialogId(user_id);
-      if (InputDialogId::contains(filter->pinned_dialog_ids, dialog_id)) {
-        return true;
-      }
-      if (InputDialogId::contains(filter->included_dialog_ids, dialog_id)) {
-        return true;
-      }
-      if (InputDialogId::contains(filter->excluded_dialog_ids, dialog_id)) {
-        return false;
+      inclusion = filter->get_dialog_inclusion(DialogId(user_id));
+      if (inclusion != 0) {
+        return inclusion > 0;
       }
     }
   }
@@ -34545,9 +35005,58 @@ void MessagesManager::do_get_channel_difference(DialogId dialog_id, int32 pts, b
   LOG(INFO) << "-----BEGIN GET CHANNEL DIFFERENCE----- for " << dialog_id << " with pts " << pts << " and limit "
             << limit << " from " << source;
 
+  if (sent_channel_difference_count_ >= get_channel_difference_concurrency()) {
+    bool is_high_priority = d != nullptr && (d->is_opened || d->unread_mention_count > 0);
+    pending_channel_differences_[is_high_priority ? 0 : 1].push_back(
+        {dialog_id, pts, limit, force, std::move(input_channel)});
+    LOG(INFO) << "Postpone getChannelDifference for " << dialog_id << ", because there are "
+              << sent_channel_difference_count_ << " running and "
+              << pending_channel_differences_[0].size() + pending_channel_differences_[1].size()
+              << " pending requests";
+    return;
+  }
+
+  send_get_channel_difference_query(dialog_id, pts, limit, force, std::move(input_channel));
+}
+
+void MessagesManager::send_get_channel_difference_query(DialogId dialog_id, int32 pts, int32 limit, bool force,
+                                                        tl_object_ptr<telegram_api::InputChannel> &&input_channel) {
+  sent_channel_difference_count_++;
   td_->create_handler<GetChannelDifferenceQuery>()->send(dialog_id, std::move(input_channel), pts, limit, force);
 }
 
+int32 MessagesManager::get_channel_difference_concurrency() {
+  auto max_concurrency = narrow_cast<int32>(G()->shared_config().get_option_integer(
+      "channel_difference_concurrency_max", DEFAULT_CHANNEL_DIFFERENCE_CONCURRENCY));
+  if (channel_difference_concurrency_ <= 0 || channel_difference_concurrency_ > max_concurrency) {
+    channel_difference_concurrency_ = max_concurrency;
+  }
+  return channel_difference_concurrency_;
+}
+
+void MessagesManager::send_pending_channel_differences() {
+  if (G()->close_flag()) {
+    return;
+  }
+
+  for (auto &pending_differences : pending_channel_differences_) {
+    while (!pending_differences.empty() && sent_channel_difference_count_ < get_channel_difference_concurrency()) {
+      auto pending_difference = std::move(pending_differences.front());
+      pending_differences.pop_front();
+      send_get_channel_difference_query(pending_difference.dialog_id, pending_difference.pts, pending_difference.limit,
+                                        pending_difference.force, std::move(pending_difference.input_channel));
+    }
+  }
+  LOG(INFO) << "Have " << sent_channel_difference_count_ << " running and "
+            << pending_channel_differences_[0].size() + pending_channel_differences_[1].size()
+            << " pending getChannelDifference requests with concurrency " << channel_difference_concurrency_;
+}
+
+void MessagesManager::on_get_channel_difference_flood_wait() {
+  channel_difference_concurrency_ = max(get_channel_difference_concurrency() / 2, 1);
+  LOG(INFO) << "Decrease getChannelDifference concurrency to " << channel_difference_concurrency_;
+}
+
 void MessagesManager::process_get_channel_difference_updates(
     DialogId dialog_id, vector<tl_object_ptr<telegram_api::Message>> &&new_messages,
     vector<tl_object_ptr<telegram_api::Update>> &&other_updates) {
@@ -34706,6 +35215,17 @@ void MessagesManager::on_get_channel_difference(
   LOG(INFO) << "----- END  GET CHANNEL DIFFERENCE----- for " << dialog_id;
   CHECK(active_get_channel_differencies_.count(dialog_id) == 1);
   active_get_channel_differencies_.erase(dialog_id);
+
+  CHECK(sent_channel_difference_count_ > 0);
+  sent_channel_difference_count_--;
+  if (difference_ptr != nullptr) {
+    // the concurrency is capped by the maximum value on the next use
+    channel_difference_concurrency_ = get_channel_difference_concurrency() + 1;
+  }
+  if (!pending_channel_differences_[0].empty() || !pending_channel_differences_[1].empty()) {
+    // continuation of this difference is requested synchronously and takes the freed slot first
+    send_closure_later(actor_id(this), &MessagesManager::send_pending_channel_differences);
+  }
   auto d = get_dialog_force(dialog_id);
 
   if (difference_ptr == nullptr) {
@@ -34982,7 +35502,8 @@ void MessagesManager::reget_message_from_server_if_needed(DialogId dialog_id, co
     return;
   }
 
-  if (need_reget_message_content(m->content.get()) || (m->legacy_layer != 0 && m->legacy_layer < MTPROTO_LAYER)) {
+  auto legacy_layer = m->get_extra().legacy_layer;
+  if (need_reget_message_content(m->content.get()) || (legacy_layer != 0 && legacy_layer < MTPROTO_LAYER)) {
     FullMessageId full_message_id{dialog_id, m->message_id};
     LOG(INFO) << "Reget from server " << full_message_id;
     get_message_from_server(full_message_id, Auto());
@@ -60,15 +60,19 @@
 #include "td/utils/buffer.h"
 #include "td/utils/ChangesProcessor.h"
 #include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/Heap.h"
 #include "td/utils/Hints.h"
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SortedChunkMap.h"
+#include "td/utils/SortedChunkSet.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tl_storers.h"
 
 #include <array>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -79,6 +83,8 @@
 
 namespace td {
 
+class BinlogBatch;
+
 struct BinlogEvent;
 
 class DialogFilter;
@@ -276,6 +282,12 @@ class MessagesManager : public Actor {
                                bool is_channel_message, bool is_scheduled, bool have_previous, bool have_next,
                                const char *source);
 
+  // postpones changes of chat positions and sending of updateChatLastMessage for chats with new messages
+  // until finish_updates_batch is called
+  void start_updates_batch();
+
+  void finish_updates_batch();
+
   void open_secret_message(SecretChatId secret_chat_id, int64 random_id, Promise<>);
 
   void on_send_secret_message_success(int64 random_id, MessageId message_id, int32 date,
@@ -334,6 +346,13 @@ class MessagesManager : public Actor {
 
   void on_update_dialog_filters();
 
+  void on_update_message_memory_limit();
+
+  void get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries, bool full) const;
+
+  td_api::object_ptr<td_api::memoryStatistics> get_memory_statistics_object(
+      vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &&entries) const;
+
   void on_update_service_notification(tl_object_ptr<telegram_api::updateServiceNotification> &&update,
                                       bool skip_new_entities, Promise<Unit> &&promise);
 
@@ -878,6 +897,8 @@ class MessagesManager : public Actor {
   void on_get_channel_difference(DialogId dialog_id, int32 request_pts, int32 request_limit,
                                  tl_object_ptr<telegram_api::updates_ChannelDifference> &&difference_ptr);
 
+  void on_get_channel_difference_flood_wait();
+
   void force_create_dialog(DialogId dialog_id, const char *source, bool expect_no_access = false,
                            bool force_update_dialog_pos = false);
 
@@ -1044,7 +1065,30 @@ class MessagesManager : public Actor {
 
   // Do not forget to update MessagesManager::update_message and all make_unique<Message> when this class is changed
   struct Message {
-    int32 random_y;
+    // fields, which are empty for most messages; they are allocated only when needed
+    struct Extra {
+      int64 reply_to_random_id = 0;  // for send_message
+      vector<MessageId> local_thread_message_ids;
+
+      vector<RestrictionReason> restriction_reasons;
+
+      DialogId real_forward_from_dialog_id;    // for resend_message
+      MessageId real_forward_from_message_id;  // for resend_message
+
+      unique_ptr<DraftMessage> thread_draft_message;
+
+      int32 legacy_layer = 0;
+
+      int32 send_error_code = 0;
+      string send_error_message;
+      double try_resend_at = 0;
+
+      int32 edited_schedule_date = 0;
+      unique_ptr<MessageContent> edited_content;
+      unique_ptr<ReplyMarkup> edited_reply_markup;
+      uint64 edit_generation = 0;
+      Promise<Unit> edit_promise;
+    };
 
     MessageId message_id;
     UserId sender_user_id;
@@ -1058,16 +1102,12 @@ class MessagesManager : public Actor {
     unique_ptr<MessageForwardInfo> forward_info;
 
     MessageId reply_to_message_id;
-    int64 reply_to_random_id = 0;  // for send_message
     DialogId reply_in_dialog_id;
     MessageId top_thread_message_id;
     MessageId linked_top_thread_message_id;
-    vector<MessageId> local_thread_message_ids;
 
     UserId via_bot_user_id;
 
-    vector<RestrictionReason> restriction_reasons;
-
     string author_signature;
 
     bool is_channel_post = false;
@@ -1096,22 +1136,12 @@ class MessagesManager : public Actor {
     bool have_next = false;
     bool from_database = false;
 
-    DialogId real_forward_from_dialog_id;    // for resend_message
-    MessageId real_forward_from_message_id;  // for resend_message
-
     NotificationId notification_id;
     NotificationId removed_notification_id;
 
     int32 view_count = 0;
     int32 forward_count = 0;
     MessageReplyInfo reply_info;
-    unique_ptr<DraftMessage> thread_draft_message;
-
-    int32 legacy_layer = 0;
-
-    int32 send_error_code = 0;
-    string send_error_message;
-    double try_resend_at = 0;
 
     int32 ttl = 0;
     double ttl_expires_at = 0;
@@ -1122,21 +1152,21 @@ class MessagesManager : public Actor {
 
     unique_ptr<ReplyMarkup> reply_markup;
 
-    int32 edited_schedule_date = 0;
-    unique_ptr<MessageContent> edited_content;
-    unique_ptr<ReplyMarkup> edited_reply_markup;
-    uint64 edit_generation = 0;
-    Promise<Unit> edit_promise;
-
-    unique_ptr<Message> left;
-    unique_ptr<Message> right;
-
     mutable int32 last_access_date = 0;
+    int32 memory_size = 0;  // approximate size of the message accounted in loaded_message_memory_size_
 
     mutable uint64 send_message_log_event_id = 0;
 
     mutable NetQueryRef send_query_ref;
 
+    unique_ptr<Extra> extra;
+
+    // returns rare fields of the message; they must not be changed
+    const Extra &get_extra() const;
+
+    // returns rare fields of the message, allocating them if needed
+    Extra &get_mutable_extra();
+
     template <class StorerT>
     void store(StorerT &storer) const;
 
@@ -1160,6 +1190,8 @@ class MessagesManager : public Actor {
     void parse(ParserT &parser);
   };
 
+  using MessagesMap = SortedChunkMap<MessageId, unique_ptr<Message>>;
+
   struct Dialog {
     DialogId dialog_id;
     MessageId last_new_message_id;  // identifier of the last known server message received from update, there should be
@@ -1309,8 +1341,8 @@ class MessagesManager : public Actor {
     std::unordered_map<MessageId, int64, MessageIdHash> pending_viewed_live_locations;  // message_id -> task_id
     std::unordered_set<MessageId, MessageIdHash> pending_viewed_message_ids;
 
-    unique_ptr<Message> messages;
-    unique_ptr<Message> scheduled_messages;
+    MessagesMap messages;
+    MessagesMap scheduled_messages;
 
     struct MessageOp {
       enum : int8 { Add, SetPts, Delete, DeleteAll } type;
@@ -1400,7 +1432,7 @@ class MessagesManager : public Actor {
     // date of the last loaded dialog in the folder
     DialogDate folder_last_dialog_date_{MAX_ORDINARY_DIALOG_ORDER, DialogId()};  // in memory
 
-    std::set<DialogDate> ordered_dialogs_;  // all known dialogs, including with default order
+    SortedChunkSet<DialogDate> ordered_dialogs_;  // all known dialogs, including with default order
 
     // date of last known user/group/channel dialog in the right order
     DialogDate last_server_dialog_date_{MAX_ORDINARY_DIALOG_ORDER, DialogId()};
@@ -1410,6 +1442,7 @@ class MessagesManager : public Actor {
     MultiPromiseActor load_folder_dialog_list_multipromise_{
         "LoadDialogListMultiPromiseActor"};  // must be defined before pending_on_get_dialogs_
     int32 load_dialog_list_limit_max_ = 0;
+    int32 loaded_database_dialog_count_ = 0;  // number of dialogs materialized from the database
   };
 
   class DialogListViewIterator {
@@ -1474,31 +1507,19 @@ class MessagesManager : public Actor {
   };
 
   class MessagesIteratorBase {
-    vector<const Message *> stack_;
+    const MessagesMap *messages_ = nullptr;
+    MessagesMap::ConstIterator it_;
 
    protected:
     MessagesIteratorBase() = default;
 
     // points iterator to message with greatest id which is less or equal than message_id
-    MessagesIteratorBase(const Message *root, MessageId message_id) {
-      size_t last_right_pos = 0;
-      while (root != nullptr) {
-        //        LOG(DEBUG) << "Have root->message_id = " << root->message_id;
-        stack_.push_back(root);
-        if (root->message_id <= message_id) {
-          //          LOG(DEBUG) << "Go right";
-          last_right_pos = stack_.size();
-          root = root->right.get();
-        } else {
-          //          LOG(DEBUG) << "Go left";
-          root = root->left.get();
-        }
-      }
-      stack_.resize(last_right_pos);
+    MessagesIteratorBase(const MessagesMap &messages, MessageId message_id)
+        : messages_(&messages), it_(--messages.upper_bound(message_id)) {
     }
 
     const Message *operator*() const {
-      return stack_.empty() ? nullptr : stack_.back();
+      return messages_ == nullptr || it_ == messages_->end() ? nullptr : it_.value().get();
     }
 
     ~MessagesIteratorBase() = default;
@@ -1510,65 +1531,27 @@ class MessagesManager : public Actor {
     MessagesIteratorBase &operator=(MessagesIteratorBase &&other) = default;
 
     void operator++() {
-      if (stack_.empty()) {
+      const Message *cur = MessagesIteratorBase::operator*();
+      if (cur == nullptr) {
         return;
       }
-
-      const Message *cur = stack_.back();
       if (!cur->have_next) {
-        stack_.clear();
+        messages_ = nullptr;
         return;
       }
-      if (cur->right == nullptr) {
-        while (true) {
-          stack_.pop_back();
-          if (stack_.empty()) {
-            return;
-          }
-          const Message *new_cur = stack_.back();
-          if (new_cur->left.get() == cur) {
-            return;
-          }
-          cur = new_cur;
-        }
-      }
-
-      cur = cur->right.get();
-      while (cur != nullptr) {
-        stack_.push_back(cur);
-        cur = cur->left.get();
-      }
+      ++it_;
     }
 
     void operator--() {
-      if (stack_.empty()) {
+      const Message *cur = MessagesIteratorBase::operator*();
+      if (cur == nullptr) {
         return;
       }
-
-      const Message *cur = stack_.back();
       if (!cur->have_previous) {
-        stack_.clear();
+        messages_ = nullptr;
         return;
       }
-      if (cur->left == nullptr) {
-        while (true) {
-          stack_.pop_back();
-          if (stack_.empty()) {
-            return;
-          }
-          const Message *new_cur = stack_.back();
-          if (new_cur->right.get() == cur) {
-            return;
-          }
-          cur = new_cur;
-        }
-      }
-
-      cur = cur->left.get();
-      while (cur != nullptr) {
-        stack_.push_back(cur);
-        cur = cur->right.get();
-      }
+      --it_;
     }
   };
 
@@ -1577,8 +1560,7 @@ class MessagesManager : public Actor {
     MessagesIterator() = default;
 
     MessagesIterator(Dialog *d, MessageId message_id)
-        : MessagesIteratorBase(message_id.is_scheduled() ? d->scheduled_messages.get() : d->messages.get(),
-                               message_id) {
+        : MessagesIteratorBase(message_id.is_scheduled() ? d->scheduled_messages : d->messages, message_id) {
     }
 
     Message *operator*() const {
@@ -1591,8 +1573,7 @@ class MessagesManager : public Actor {
     MessagesConstIterator() = default;
 
     MessagesConstIterator(const Dialog *d, MessageId message_id)
-        : MessagesIteratorBase(message_id.is_scheduled() ? d->scheduled_messages.get() : d->messages.get(),
-                               message_id) {
+        : MessagesIteratorBase(message_id.is_scheduled() ? d->scheduled_messages : d->messages, message_id) {
     }
 
     const Message *operator*() const {
@@ -1667,6 +1648,7 @@ class MessagesManager : public Actor {
   static constexpr int32 MIN_CHANNEL_DIFFERENCE = 10;
   static constexpr int32 MAX_CHANNEL_DIFFERENCE = 100;
   static constexpr int32 MAX_BOT_CHANNEL_DIFFERENCE = 100000;   // server side limit
+  static constexpr int32 DEFAULT_CHANNEL_DIFFERENCE_CONCURRENCY = 20;
   static constexpr int32 MAX_RECENTLY_FOUND_DIALOGS = 30;       // some reasonable value
   static constexpr size_t MAX_TITLE_LENGTH = 128;               // server side limit for chat title
   static constexpr size_t MAX_DESCRIPTION_LENGTH = 255;         // server side limit for chat description
@@ -1675,6 +1657,8 @@ class MessagesManager : public Actor {
   static constexpr int32 MAX_DIALOG_FILTERS = 10;               // server side limit
   static constexpr int32 DIALOG_FILTERS_CACHE_TIME = 86400;
 
+  static constexpr double DIALOG_HISTORY_PREFETCH_IDLE_DELAY = 1.0;  // some reasonable value
+
   static constexpr int64 SPONSORED_DIALOG_ORDER = static_cast<int64>(2147483647) << 32;
   static constexpr int32 MIN_PINNED_DIALOG_DATE = 2147000000;  // some big date
   static constexpr int64 MAX_ORDINARY_DIALOG_ORDER =
@@ -1695,6 +1679,8 @@ class MessagesManager : public Actor {
   static constexpr int32 MIN_READ_HISTORY_DELAY = 3;  // seconds
   static constexpr int32 MAX_SAVE_DIALOG_DELAY = 0;   // seconds
 
+  static constexpr double READ_HISTORY_BATCH_DELAY = 0.1;  // seconds
+
   static constexpr int32 LIVE_LOCATION_VIEW_PERIOD = 60;  // seconds, server-side limit
 
   static constexpr int32 USERNAME_CACHE_EXPIRE_TIME = 3 * 86400;
@@ -1707,6 +1693,8 @@ class MessagesManager : public Actor {
 
   static constexpr int32 SCHEDULE_WHEN_ONLINE_DATE = 2147483646;
 
+  static constexpr size_t MAX_MESSAGE_SEARCH_INDEX_TEXT_SIZE = 1 << 22;  // some reasonable limit per chat
+
   static constexpr double DIALOG_ACTION_TIMEOUT = 5.5;
 
   static constexpr const char *DELETE_MESSAGE_USER_REQUEST_SOURCE = "user request";
@@ -1911,9 +1899,19 @@ class MessagesManager : public Actor {
 
   void unload_dialog(DialogId dialog_id);
 
+  static int32 get_message_memory_size(const Message *m);
+
+  void on_message_loaded_to_memory(Message *m);
+
+  void on_message_unloaded_from_memory(const Message *m);
+
+  void try_schedule_unload_messages_by_memory_limit();
+
+  void unload_messages_by_memory_limit();
+
   void delete_all_dialog_messages(Dialog *d, bool remove_from_dialog_list, bool is_permanently_deleted);
 
-  void do_delete_all_dialog_messages(Dialog *d, unique_ptr<Message> &message, bool is_permanently_deleted,
+  void do_delete_all_dialog_messages(Dialog *d, MessagesMap &messages, bool is_permanently_deleted,
                                      vector<int64> &deleted_message_ids);
 
   void delete_message_from_server(DialogId dialog_id, MessageId message_ids, bool revoke);
@@ -1937,17 +1935,18 @@ class MessagesManager : public Actor {
 
   void unpin_all_dialog_messages_on_server(DialogId dialog_id, uint64 log_event_id, Promise<Unit> &&promise);
 
-  static MessageId find_message_by_date(const Message *m, int32 date);
+  static MessageId find_message_by_date(const MessagesMap &messages, int32 date);
 
-  static void find_messages(const Message *m, vector<MessageId> &message_ids,
+  static void find_messages(const MessagesMap &messages, vector<MessageId> &message_ids,
                             const std::function<bool(const Message *)> &condition);
 
-  static void find_old_messages(const Message *m, MessageId max_message_id, vector<MessageId> &message_ids);
+  static void find_old_messages(const MessagesMap &messages, MessageId max_message_id, vector<MessageId> &message_ids);
 
-  static void find_newer_messages(const Message *m, MessageId min_message_id, vector<MessageId> &message_ids);
+  static void find_newer_messages(const MessagesMap &messages, MessageId min_message_id,
+                                  vector<MessageId> &message_ids);
 
-  void find_unloadable_messages(const Dialog *d, int32 unload_before_date, const Message *m,
-                                vector<MessageId> &message_ids, int32 &left_to_unload) const;
+  void find_unloadable_messages(const Dialog *d, int32 unload_before_date, vector<MessageId> &message_ids,
+                                int32 &left_to_unload) const;
 
   void on_pending_message_views_timeout(DialogId dialog_id);
 
@@ -1996,6 +1995,8 @@ class MessagesManager : public Actor {
 
   void read_history_on_server(Dialog *d, MessageId max_message_id);
 
+  static double get_batch_flush_time(double &flush_time, double delay);
+
   void do_read_history_on_server(DialogId dialog_id);
 
   void read_history_on_server_impl(Dialog *d, MessageId max_message_id);
@@ -2041,7 +2042,8 @@ class MessagesManager : public Actor {
 
   void on_get_scheduled_messages_from_database(DialogId dialog_id, vector<BufferSlice> &&messages);
 
-  static int32 get_random_y(MessageId message_id);
+  void on_get_dialog_message_count_from_database(DialogId dialog_id, MessageSearchFilter filter, int64 random_id,
+                                                 Result<int32> r_message_count, Promise<Unit> &&promise);
 
   static void set_message_id(unique_ptr<Message> &message, MessageId message_id);
 
@@ -2075,6 +2077,14 @@ class MessagesManager : public Actor {
 
   void preload_folder_dialog_list(FolderId folder_id);
 
+  void schedule_dialog_history_prefetch();
+
+  void postpone_dialog_history_prefetch();
+
+  void prefetch_dialog_history();
+
+  void on_prefetch_dialog_history();
+
   static void invalidate_message_indexes(Dialog *d);
 
   void update_message_count_by_index(Dialog *d, int diff, const Message *m);
@@ -2101,12 +2111,16 @@ class MessagesManager : public Actor {
 
   void on_message_changed(const Dialog *d, const Message *m, bool need_send_update, const char *source);
 
+  void on_message_interaction_info_changed(const Dialog *d, const Message *m, const char *source);
+
   bool need_delete_file(FullMessageId full_message_id, FileId file_id) const;
 
   bool need_delete_message_files(DialogId dialog_id, const Message *m) const;
 
   void add_message_to_database(const Dialog *d, const Message *m, const char *source);
 
+  void update_message_data_in_database(const Dialog *d, const Message *m, const char *source);
+
   void delete_all_dialog_messages_from_database(Dialog *d, MessageId max_message_id, const char *source);
 
   void delete_message_from_database(Dialog *d, MessageId message_id, const Message *m, bool is_permanently_deleted);
@@ -2221,6 +2235,8 @@ class MessagesManager : public Actor {
 
   void send_update_chat_last_message_impl(const Dialog *d, const char *source) const;
 
+  void send_update_chat_last_message_batched(Dialog *d, const char *source);
+
   void send_update_chat_filters();
 
   void send_update_unread_message_count(DialogList &list, DialogId dialog_id, bool force, const char *source,
@@ -2545,12 +2561,6 @@ class MessagesManager : public Actor {
                                                                                const string &query, int32 limit,
                                                                                DialogParticipantsFilter filter) const;
 
-  static unique_ptr<Message> *treap_find_message(unique_ptr<Message> *v, MessageId message_id);
-  static const unique_ptr<Message> *treap_find_message(const unique_ptr<Message> *v, MessageId message_id);
-
-  static Message *treap_insert_message(unique_ptr<Message> *v, unique_ptr<Message> message);
-  static unique_ptr<Message> treap_delete_message(unique_ptr<Message> *v);
-
   static Message *get_message(Dialog *d, MessageId message_id);
   static const Message *get_message(const Dialog *d, MessageId message_id);
 
@@ -2661,6 +2671,27 @@ class MessagesManager : public Actor {
   void on_messages_db_fts_result(Result<MessagesDbFtsResult> result, string offset, int32 limit, int64 random_id,
                                  Promise<> &&promise);
 
+  struct MessageSearchIndex {
+    Hints hints;  // message identifiers by message search text
+    size_t text_size = 0;
+  };
+
+  bool can_search_dialog_messages_in_memory(DialogId dialog_id) const;
+
+  const MessageSearchIndex *get_message_search_index(const Dialog *d);
+
+  bool add_message_to_search_index(MessageSearchIndex *index, const Message *m) const;
+
+  void update_message_search_index(DialogId dialog_id, const Message *m);
+
+  void delete_message_from_search_index(DialogId dialog_id, const Message *m);
+
+  std::pair<int32, vector<MessageId>> search_dialog_messages_in_memory(const Dialog *d,
+                                                                       const MessageSearchIndex &index, Slice query,
+                                                                       DialogId sender_dialog_id,
+                                                                       MessageId from_message_id, int32 offset,
+                                                                       int32 limit, MessageSearchFilter filter) const;
+
   void on_messages_db_calls_result(Result<MessagesDbCallsResult> result, int64 random_id, MessageId first_db_message_id,
                                    MessageSearchFilter filter, Promise<Unit> &&promise);
 
@@ -2772,6 +2803,8 @@ class MessagesManager : public Actor {
 
   void process_pending_updates();
 
+  static void add_pending_pts_update(vector<PendingPtsUpdate> &updates, PendingPtsUpdate &&update);
+
   void drop_pending_updates();
 
   static string get_channel_pts_key(DialogId dialog_id);
@@ -2794,6 +2827,13 @@ class MessagesManager : public Actor {
   void do_get_channel_difference(DialogId dialog_id, int32 pts, bool force,
                                  tl_object_ptr<telegram_api::InputChannel> &&input_channel, const char *source);
 
+  void send_get_channel_difference_query(DialogId dialog_id, int32 pts, int32 limit, bool force,
+                                         tl_object_ptr<telegram_api::InputChannel> &&input_channel);
+
+  int32 get_channel_difference_concurrency();
+
+  void send_pending_channel_differences();
+
   void process_get_channel_difference_updates(DialogId dialog_id,
                                               vector<tl_object_ptr<telegram_api::Message>> &&new_messages,
                                               vector<tl_object_ptr<telegram_api::Update>> &&other_updates);
@@ -2829,6 +2869,8 @@ class MessagesManager : public Actor {
 
   static void on_preload_folder_dialog_list_timeout_callback(void *messages_manager_ptr, int64 folder_id_int);
 
+  static void on_dialog_history_prefetch_timeout_callback(void *messages_manager_ptr);
+
   void load_secret_thumbnail(FileId thumbnail_file_id);
 
   static tl_object_ptr<telegram_api::channelAdminLogEventsFilter> get_channel_admin_log_events_filter(
@@ -2899,6 +2941,8 @@ class MessagesManager : public Actor {
 
   unique_ptr<Message> parse_message(DialogId dialog_id, const BufferSlice &value, bool is_scheduled);
 
+  static MessageId get_database_message_id(const BufferSlice &value, bool is_scheduled);
+
   unique_ptr<Dialog> parse_dialog(DialogId dialog_id, const BufferSlice &value);
 
   void load_calls_db_state();
@@ -2912,7 +2956,7 @@ class MessagesManager : public Actor {
 
   static void add_message_dependencies(Dependencies &dependencies, DialogId dialog_id, const Message *m);
 
-  void save_send_message_log_event(DialogId dialog_id, const Message *m);
+  void save_send_message_log_event(DialogId dialog_id, const Message *m, BinlogBatch *batch = nullptr);
 
   uint64 save_change_dialog_report_spam_state_on_server_log_event(DialogId dialog_id, bool is_spam_dialog);
 
@@ -3082,11 +3126,15 @@ class MessagesManager : public Actor {
   std::unordered_map<int64, DialogId> created_dialogs_;                                // random_id -> dialog_id
   std::unordered_map<DialogId, Promise<Unit>, DialogIdHash> pending_created_dialogs_;  // dialog_id -> promise
 
+  bool is_updates_batch_active_ = false;
+  std::unordered_set<DialogId, DialogIdHash> batched_last_message_dialog_ids_;
+
   bool running_get_difference_ = false;  // true after before_get_difference and false after after_get_difference
 
-  std::unordered_map<DialogId, unique_ptr<Dialog>, DialogIdHash> dialogs_;
-  std::multimap<int32, PendingPtsUpdate> pending_updates_;
-  std::multimap<int32, PendingPtsUpdate> postponed_pts_updates_;
+  FlatHashMap<DialogId, unique_ptr<Dialog>, DialogIdHash> dialogs_;
+  // sorted by pts; updates come almost in order, so they are appended to the end and processed without allocations
+  vector<PendingPtsUpdate> pending_updates_;
+  vector<PendingPtsUpdate> postponed_pts_updates_;
 
   std::unordered_set<DialogId, DialogIdHash>
       loaded_dialogs_;  // dialogs loaded from database, but not added to dialogs_
@@ -3124,6 +3172,8 @@ class MessagesManager : public Actor {
   std::unordered_map<int64, std::pair<int32, vector<MessageId>>>
       found_dialog_messages_;                                            // random_id -> [total_count, [message_id]...]
   std::unordered_map<int64, DialogId> found_dialog_messages_dialog_id_;  // random_id -> dialog_id
+  // lazily built indexes of messages in memory; nullptr if the index has become too big
+  std::unordered_map<DialogId, unique_ptr<MessageSearchIndex>, DialogIdHash> message_search_indexes_;
   std::unordered_map<int64, std::pair<int32, vector<FullMessageId>>>
       found_messages_;  // random_id -> [total_count, [full_message_id]...]
   std::unordered_map<int64, std::pair<int32, vector<FullMessageId>>>
@@ -3191,6 +3241,18 @@ class MessagesManager : public Actor {
   vector<Promise<Unit>> dialog_filter_reload_queries_;
 
   std::unordered_map<DialogId, string, DialogIdHash> active_get_channel_differencies_;
+
+  struct PendingChannelDifference {
+    DialogId dialog_id;
+    int32 pts;
+    int32 limit;
+    bool force;
+    tl_object_ptr<telegram_api::InputChannel> input_channel;
+  };
+  // channels.getDifference requests waiting for a free slot; opened chats and chats with unread mentions go first
+  std::deque<PendingChannelDifference> pending_channel_differences_[2];
+  int32 sent_channel_difference_count_ = 0;
+  int32 channel_difference_concurrency_ = 0;  // is halved on FLOOD_WAIT and grows back after successful requests
   std::unordered_map<DialogId, uint64, DialogIdHash> get_channel_difference_to_log_event_id_;
 
   MultiTimeout channel_get_difference_timeout_{"ChannelGetDifferenceTimeout"};
@@ -3199,8 +3261,17 @@ class MessagesManager : public Actor {
   MultiTimeout pending_message_live_location_view_timeout_{"PendingMessageLiveLocationViewTimeout"};
   MultiTimeout pending_draft_message_timeout_{"PendingDraftMessageTimeout"};
   MultiTimeout pending_read_history_timeout_{"PendingReadHistoryTimeout"};
+  double message_views_batch_flush_time_ = 0.0;
+  double read_history_batch_flush_time_ = 0.0;
   MultiTimeout pending_updated_dialog_timeout_{"PendingUpdatedDialogTimeout"};
   MultiTimeout pending_unload_dialog_timeout_{"PendingUnloadDialogTimeout"};
+
+  int64 message_memory_limit_ = 0;
+  int64 loaded_message_count_ = 0;
+  int64 loaded_message_memory_size_ = 0;
+  int64 unloaded_by_memory_limit_message_count_ = 0;
+  int64 last_unload_by_memory_limit_size_ = 0;
+  bool is_unload_by_memory_limit_scheduled_ = false;
   MultiTimeout dialog_unmute_timeout_{"DialogUnmuteTimeout"};
   MultiTimeout pending_send_dialog_action_timeout_{"PendingSendDialogActionTimeout"};
   MultiTimeout active_dialog_action_timeout_{"ActiveDialogActionTimeout"};
@@ -3209,6 +3280,12 @@ class MessagesManager : public Actor {
 
   Timeout reload_dialog_filters_timeout_;
 
+  Timeout dialog_history_prefetch_timeout_;
+  bool need_dialog_history_prefetch_ = false;
+  bool is_dialog_history_prefetch_active_ = false;
+  double last_dialog_history_request_time_ = 0.0;
+  std::unordered_set<DialogId, DialogIdHash> prefetched_history_dialog_ids_;
+
   Hints dialogs_hints_;  // search dialogs by title and username
 
   std::unordered_set<FullMessageId, FullMessageIdHash> active_live_location_full_message_ids_;
@@ -122,6 +122,28 @@ class GetContactSignUpNotificationQuery : public Td::ResultHandler {
   }
 };
 
+class DecryptPushActor : public Actor {
+ public:
+  DecryptPushActor(int64 encryption_key_id, string encryption_key, string push, Promise<string> promise)
+      : encryption_key_id_(encryption_key_id)
+      , encryption_key_(std::move(encryption_key))
+      , push_(std::move(push))
+      , promise_(std::move(promise)) {
+  }
+
+ private:
+  int64 encryption_key_id_;
+  string encryption_key_;
+  string push_;
+  Promise<string> promise_;
+
+  void start_up() override {
+    promise_.set_result(
+        NotificationManager::decrypt_push(encryption_key_id_, std::move(encryption_key_), std::move(push_)));
+    stop();
+  }
+};
+
 NotificationManager::NotificationManager(Td *td, ActorShared<> parent) : td_(td), parent_(std::move(parent)) {
   flush_pending_notifications_timeout_.set_callback(on_flush_pending_notifications_timeout_callback);
   flush_pending_notifications_timeout_.set_callback_data(static_cast<void *>(this));
@@ -159,6 +181,11 @@ void NotificationManager::on_flush_pending_updates_timeout_callback(void *notifi
   }
 
   auto notification_manager = static_cast<NotificationManager *>(notification_manager_ptr);
+  if (group_id_int == 0) {
+    send_closure_later(notification_manager->actor_id(notification_manager),
+                       &NotificationManager::flush_ready_pending_updates);
+    return;
+  }
   send_closure_later(notification_manager->actor_id(notification_manager), &NotificationManager::flush_pending_updates,
                      narrow_cast<int32>(group_id_int), "timeout");
 }
@@ -204,7 +231,7 @@ void NotificationManager::init() {
   }
 
   disable_contact_registered_notifications_ =
-      G()->shared_config().get_option_boolean("disable_contact_registered_notifications");
+      G()->shared_config().get_option_boolean(ConfigShared::OptionId::DisableContactRegisteredNotifications);
   auto sync_state = G()->td_db()->get_binlog_pmc()->get(get_is_contact_registered_notifications_synchronized_key());
   if (sync_state.empty()) {
     sync_state = "00";
@@ -955,12 +982,17 @@ void NotificationManager::add_update(int32 group_id, td_api::object_ptr<td_api::
   }
   VLOG(notifications) << "Add " << as_notification_update(update.get());
   auto &updates = pending_updates_[group_id];
-  if (updates.empty()) {
+  bool is_first_update = updates.empty();
+  if (is_first_update) {
     on_delayed_notification_update_count_changed(1, group_id, "add_update");
   }
   updates.push_back(std::move(update));
   if (!running_get_difference_ && running_get_chat_difference_.count(group_id) == 0) {
-    flush_pending_updates_timeout_.add_timeout_in(group_id, MIN_UPDATE_DELAY_MS * 1e-3);
+    // updates in all groups changed at the same time are flushed together to avoid a wakeup per group
+    if (is_first_update && !flush_pending_updates_timeout_.has_timeout(group_id)) {
+      ready_pending_updates_group_ids_.push_back(group_id);
+      flush_pending_updates_timeout_.add_timeout_in(0, MIN_UPDATE_DELAY_MS * 1e-3);
+    }
   } else {
     flush_pending_updates_timeout_.set_timeout_in(group_id, MAX_UPDATE_DELAY_MS * 1e-3);
   }
@@ -1338,6 +1370,31 @@ void NotificationManager::force_flush_pending_updates(NotificationGroupId group_
   flush_pending_updates(group_id.get(), source);
 }
 
+void NotificationManager::flush_ready_pending_updates() {
+  auto group_ids = std::move(ready_pending_updates_group_ids_);
+  reset_to_empty(ready_pending_updates_group_ids_);
+  std::sort(group_ids.begin(), group_ids.end());
+  group_ids.erase(std::unique(group_ids.begin(), group_ids.end()), group_ids.end());
+
+  vector<NotificationGroupKey> ready_group_keys;
+  for (auto group_id : group_ids) {
+    // skip already flushed groups and groups, which are delayed until the end of getDifference
+    if (pending_updates_.count(group_id) == 0 || flush_pending_updates_timeout_.has_timeout(group_id)) {
+      continue;
+    }
+    auto group_it = get_group(NotificationGroupId(group_id));
+    CHECK(group_it != groups_.end());
+    ready_group_keys.push_back(group_it->first);
+  }
+
+  // flush groups in reverse order to not exceed max_notification_group_count_
+  VLOG(notifications) << "Flush ready pending updates in " << ready_group_keys.size() << " notification groups";
+  std::sort(ready_group_keys.begin(), ready_group_keys.end());
+  for (auto group_key : reversed(ready_group_keys)) {
+    flush_pending_updates(group_key.group_id.get(), "flush_ready_pending_updates");
+  }
+}
+
 void NotificationManager::flush_all_pending_updates(bool include_delayed_chats, const char *source) {
   VLOG(notifications) << "Flush all pending notification updates "
                       << (include_delayed_chats ? "with delayed chats " : "") << "from " << source;
@@ -2538,7 +2595,8 @@ void NotificationManager::on_disable_contact_registered_notifications_changed()
     return;
   }
 
-  auto is_disabled = G()->shared_config().get_option_boolean("disable_contact_registered_notifications");
+  auto is_disabled =
+      G()->shared_config().get_option_boolean(ConfigShared::OptionId::DisableContactRegisteredNotifications);
 
   if (is_disabled == disable_contact_registered_notifications_) {
     return;
@@ -2649,25 +2707,42 @@ void NotificationManager::process_push_notification(string payload, Promise<Unit
   VLOG(notifications) << "Process push notification \"" << format::escaped(payload)
                       << "\" with receiver_id = " << receiver_id << " and " << encryption_keys.size()
                       << " encryption keys";
-  bool was_encrypted = false;
   for (auto &key : encryption_keys) {
     VLOG(notifications) << "Have key " << key.first;
     // VLOG(notifications) << "Have key " << key.first << ": \"" << format::escaped(key.second) << '"';
     if (key.first == receiver_id) {
       if (!key.second.empty()) {
-        auto r_payload = decrypt_push(key.first, key.second.str(), std::move(payload));
-        if (r_payload.is_error()) {
-          LOG(ERROR) << "Failed to decrypt push: " << r_payload.error();
-          return promise.set_error(Status::Error(400, "Failed to decrypt push payload"));
-        }
-        payload = r_payload.move_as_ok();
-        was_encrypted = true;
+        // decryption doesn't depend on the state, so it is done on another thread to not block other requests
+        auto decrypt_promise = PromiseCreator::lambda(
+            [actor_id = actor_id(this), promise = std::move(promise)](Result<string> r_payload) mutable {
+              send_closure(actor_id, &NotificationManager::on_decrypt_push, std::move(r_payload), std::move(promise));
+            });
+        create_actor_on_scheduler<DecryptPushActor>("DecryptPushActor", G()->get_gc_scheduler_id(), key.first,
+                                                    key.second.str(), std::move(payload), std::move(decrypt_promise))
+            .release();
+        return;
       }
       receiver_id = 0;
       break;
     }
   }
 
+  do_process_push_notification(std::move(payload), false, receiver_id, std::move(promise));
+}
+
+void NotificationManager::on_decrypt_push(Result<string> r_payload, Promise<Unit> &&promise) {
+  if (is_disabled()) {
+    return promise.set_error(Status::Error(200, "Immediate success"));
+  }
+  if (r_payload.is_error()) {
+    LOG(ERROR) << "Failed to decrypt push: " << r_payload.error();
+    return promise.set_error(Status::Error(400, "Failed to decrypt push payload"));
+  }
+  do_process_push_notification(r_payload.move_as_ok(), true, 0, std::move(promise));
+}
+
+void NotificationManager::do_process_push_notification(string payload, bool was_encrypted, int64 receiver_id,
+                                                       Promise<Unit> &&promise) {
   if (!td_->is_online()) {
     // reset online flag to false to immediately check all connections aliveness
     send_closure(G()->state_manager(), &StateManager::on_online, false);
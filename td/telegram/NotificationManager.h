@@ -296,6 +296,8 @@ class NotificationManager : public Actor {
 
   void force_flush_pending_updates(NotificationGroupId group_id, const char *source);
 
+  void flush_ready_pending_updates();
+
   void flush_all_pending_updates(bool include_delayed_chats, const char *source);
 
   NotificationGroupId get_call_notification_group_id(DialogId dialog_id);
@@ -304,6 +306,10 @@ class NotificationManager : public Actor {
 
   static string convert_loc_key(const string &loc_key);
 
+  void on_decrypt_push(Result<string> r_payload, Promise<Unit> &&promise);
+
+  void do_process_push_notification(string payload, bool was_encrypted, int64 receiver_id, Promise<Unit> &&promise);
+
   Status process_push_notification_payload(string payload, bool was_encrypted, Promise<Unit> &promise);
 
   void add_message_push_notification(DialogId dialog_id, MessageId message_id, int64 random_id, UserId sender_user_id,
@@ -374,6 +380,7 @@ class NotificationManager : public Actor {
   std::unordered_map<NotificationGroupId, NotificationGroupKey, NotificationGroupIdHash> group_keys_;
 
   std::unordered_map<int32, vector<td_api::object_ptr<td_api::Update>>> pending_updates_;
+  vector<int32> ready_pending_updates_group_ids_;  // groups, which will be flushed together after MIN_UPDATE_DELAY_MS
 
   MultiTimeout flush_pending_notifications_timeout_{"FlushPendingNotificationsTimeout"};
   MultiTimeout flush_pending_updates_timeout_{"FlushPendingUpdatesTimeout"};
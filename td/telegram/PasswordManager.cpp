@@ -6,6 +6,7 @@
 //
 #include "td/telegram/PasswordManager.h"
 
+#include "td/telegram/CryptoWorker.h"
 #include "td/telegram/DhCache.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/logevent/LogEvent.h"
@@ -55,14 +56,14 @@ Result<BufferSlice> PasswordManager::calc_password_srp_hash(Slice password, Slic
   TRY_STATUS(DhHandshake::check_config(g, p, DhCache::instance()));
 
   auto hash = calc_password_hash(password, client_salt, server_salt);
-  auto p_bn = BigNum::from_binary(p);
   BigNum g_bn;
   g_bn.set_value(g);
   auto x_bn = BigNum::from_binary(hash.as_slice());
 
+  auto p_context = DhHandshake::get_montgomery_context(p.str());
   BigNumContext ctx;
   BigNum v_bn;
-  BigNum::mod_exp(v_bn, g_bn, x_bn, p_bn, ctx);
+  BigNum::mod_exp(v_bn, g_bn, x_bn, *p_context, ctx);
 
   BufferSlice result(v_bn.to_binary(256));
   LOG(INFO) << "End password SRP hash calculation";
@@ -100,9 +101,10 @@ tl_object_ptr<telegram_api::InputCheckPasswordSRP> PasswordManager::get_input_ch
   Random::secure_bytes(a.as_slice());
   auto a_bn = BigNum::from_binary(a.as_slice());
 
+  auto p_context = DhHandshake::get_montgomery_context(p.str());
   BigNumContext ctx;
   BigNum A_bn;
-  BigNum::mod_exp(A_bn, g_bn, a_bn, p_bn, ctx);
+  BigNum::mod_exp(A_bn, g_bn, a_bn, *p_context, ctx);
   string A = A_bn.to_binary(256);
 
   string B_pad(256 - B.size(), '\0');
@@ -112,7 +114,7 @@ tl_object_ptr<telegram_api::InputCheckPasswordSRP> PasswordManager::get_input_ch
   auto k_bn = BigNum::from_binary(k);
 
   BigNum v_bn;
-  BigNum::mod_exp(v_bn, g_bn, x_bn, p_bn, ctx);
+  BigNum::mod_exp(v_bn, g_bn, x_bn, *p_context, ctx);
   BigNum kv_bn;
   BigNum::mod_mul(kv_bn, k_bn, v_bn, p_bn, ctx);
   BigNum t_bn;
@@ -125,7 +127,7 @@ tl_object_ptr<telegram_api::InputCheckPasswordSRP> PasswordManager::get_input_ch
   BigNum::add(exp_bn, exp_bn, a_bn);
 
   BigNum S_bn;
-  BigNum::mod_exp(S_bn, t_bn, exp_bn, p_bn, ctx);
+  BigNum::mod_exp(S_bn, t_bn, exp_bn, *p_context, ctx);
   string S = S_bn.to_binary(256);
   auto K = sha256(S);
 
@@ -146,15 +148,24 @@ tl_object_ptr<telegram_api::InputCheckPasswordSRP> PasswordManager::get_input_ch
                                   state.current_srp_p, state.current_srp_B, state.current_srp_id);
 }
 
+void PasswordManager::calc_input_check_password(string password, PasswordState state,
+                                                Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> promise) {
+  run_crypto_job(
+      actor_id(this),
+      [password = std::move(password), state = std::move(state)] { return get_input_check_password(password, state); },
+      std::move(promise));
+}
+
 void PasswordManager::get_input_check_password_srp(
     string password, Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> &&promise) {
-  do_get_state(PromiseCreator::lambda(
-      [promise = std::move(promise), password = std::move(password)](Result<PasswordState> r_state) mutable {
-        if (r_state.is_error()) {
-          return promise.set_error(r_state.move_as_error());
-        }
-        promise.set_value(PasswordManager::get_input_check_password(password, r_state.move_as_ok()));
-      }));
+  do_get_state(PromiseCreator::lambda([actor_id = actor_id(this), promise = std::move(promise),
+                                       password = std::move(password)](Result<PasswordState> r_state) mutable {
+    if (r_state.is_error()) {
+      return promise.set_error(r_state.move_as_error());
+    }
+    send_closure(actor_id, &PasswordManager::calc_input_check_password, std::move(password), r_state.move_as_ok(),
+                 std::move(promise));
+  }));
 }
 
 void PasswordManager::set_password(string current_password, string new_password, string new_hint,
@@ -274,7 +285,20 @@ void PasswordManager::drop_temp_password() {
 
 void PasswordManager::do_create_temp_password(string password, int32 timeout, PasswordState &&password_state,
                                               Promise<TempPasswordState> promise) {
-  auto hash = get_input_check_password(password, password_state);
+  calc_input_check_password(
+      std::move(password), std::move(password_state),
+      PromiseCreator::lambda([actor_id = actor_id(this), timeout, promise = std::move(promise)](
+                                 Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) mutable {
+        if (r_hash.is_error()) {
+          return promise.set_error(r_hash.move_as_error());
+        }
+        send_closure(actor_id, &PasswordManager::send_get_tmp_password_query, r_hash.move_as_ok(), timeout,
+                     std::move(promise));
+      }));
+}
+
+void PasswordManager::send_get_tmp_password_query(tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash,
+                                                  int32 timeout, Promise<TempPasswordState> promise) {
   send_with_promise(G()->net_query_creator().create(telegram_api::account_getTmpPassword(std::move(hash), timeout)),
                     PromiseCreator::lambda([promise = std::move(promise)](Result<NetQueryPtr> r_query) mutable {
                       auto r_result = fetch_result<telegram_api::account_getTmpPassword>(std::move(r_query));
@@ -350,29 +374,54 @@ void PasswordManager::do_get_full_state(string password, PasswordState state, Pr
     return promise.set_value(std::move(result));
   }
 
-  auto hash = get_input_check_password(password, state);
-  send_with_promise(G()->net_query_creator().create(telegram_api::account_getPasswordSettings(std::move(hash))),
-                    PromiseCreator::lambda([promise = std::move(promise), state = std::move(state),
-                                            password](Result<NetQueryPtr> r_query) mutable {
-                      promise.set_result([&]() -> Result<PasswordFullState> {
-                        TRY_RESULT(result, fetch_result<telegram_api::account_getPasswordSettings>(std::move(r_query)));
-                        LOG(INFO) << "Receive password settings: " << to_string(result);
-                        PasswordPrivateState private_state;
-                        private_state.email = std::move(result->email_);
-
-                        if (result->secure_settings_ != nullptr) {
-                          auto r_secret =
-                              decrypt_secure_secret(password, std::move(result->secure_settings_->secure_algo_),
-                                                    result->secure_settings_->secure_secret_.as_slice(),
-                                                    result->secure_settings_->secure_secret_id_);
-                          if (r_secret.is_ok()) {
-                            private_state.secret = r_secret.move_as_ok();
-                          }
-                        }
+  calc_input_check_password(
+      password, state,
+      PromiseCreator::lambda([actor_id = actor_id(this), password, state, promise = std::move(promise)](
+                                 Result<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> r_hash) mutable {
+        if (r_hash.is_error()) {
+          return promise.set_error(r_hash.move_as_error());
+        }
+        send_closure(actor_id, &PasswordManager::send_get_password_settings_query, std::move(password),
+                     std::move(state), r_hash.move_as_ok(), std::move(promise));
+      }));
+}
 
-                        return PasswordFullState{std::move(state), std::move(private_state)};
-                      }());
-                    }));
+void PasswordManager::send_get_password_settings_query(string password, PasswordState state,
+                                                       tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash,
+                                                       Promise<PasswordFullState> promise) {
+  send_with_promise(
+      G()->net_query_creator().create(telegram_api::account_getPasswordSettings(std::move(hash))),
+      PromiseCreator::lambda([actor_id = actor_id(this), promise = std::move(promise), state = std::move(state),
+                              password = std::move(password)](Result<NetQueryPtr> r_query) mutable {
+        auto r_result = fetch_result<telegram_api::account_getPasswordSettings>(std::move(r_query));
+        if (r_result.is_error()) {
+          return promise.set_error(r_result.move_as_error());
+        }
+        auto result = r_result.move_as_ok();
+        LOG(INFO) << "Receive password settings: " << to_string(result);
+        PasswordPrivateState private_state;
+        private_state.email = std::move(result->email_);
+
+        if (result->secure_settings_ == nullptr) {
+          return promise.set_value(PasswordFullState{std::move(state), std::move(private_state)});
+        }
+
+        auto secure_settings = std::move(result->secure_settings_);
+        run_crypto_job(
+            actor_id,
+            [password = std::move(password), secure_settings = std::move(secure_settings)]() mutable {
+              return decrypt_secure_secret(password, std::move(secure_settings->secure_algo_),
+                                           secure_settings->secure_secret_.as_slice(),
+                                           secure_settings->secure_secret_id_);
+            },
+            PromiseCreator::lambda([state = std::move(state), private_state = std::move(private_state),
+                                    promise = std::move(promise)](Result<secure_storage::Secret> r_secret) mutable {
+              if (r_secret.is_ok()) {
+                private_state.secret = r_secret.move_as_ok();
+              }
+              promise.set_value(PasswordFullState{std::move(state), std::move(private_state)});
+            }));
+      }));
 }
 
 void PasswordManager::get_recovery_email_address(string password,
@@ -534,6 +583,26 @@ void PasswordManager::do_update_password_settings(UpdateSettings update_settings
 
 void PasswordManager::do_update_password_settings_impl(UpdateSettings update_settings, PasswordState state,
                                                        PasswordPrivateState private_state, Promise<bool> promise) {
+  run_crypto_job(actor_id(this),
+                 [update_settings = std::move(update_settings), state = std::move(state),
+                  private_state = std::move(private_state)]() mutable {
+                   return get_update_password_settings_query(std::move(update_settings), std::move(state),
+                                                             std::move(private_state));
+                 },
+                 PromiseCreator::lambda(
+                     [actor_id = actor_id(this), promise = std::move(promise)](
+                         Result<tl_object_ptr<telegram_api::account_updatePasswordSettings>> r_query) mutable {
+                       if (r_query.is_error()) {
+                         return promise.set_error(r_query.move_as_error());
+                       }
+                       send_closure(actor_id, &PasswordManager::send_update_password_settings_query,
+                                    r_query.move_as_ok(), std::move(promise));
+                     }));
+}
+
+Result<tl_object_ptr<telegram_api::account_updatePasswordSettings>>
+PasswordManager::get_update_password_settings_query(UpdateSettings update_settings, PasswordState state,
+                                                    PasswordPrivateState private_state) {
   auto new_settings = make_tl_object<telegram_api::account_passwordInputSettings>();
   if (update_settings.update_password) {
     new_settings->flags_ |= telegram_api::account_passwordInputSettings::NEW_PASSWORD_HASH_MASK;
@@ -545,7 +614,7 @@ void PasswordManager::do_update_password_settings_impl(UpdateSettings update_set
       auto new_hash = calc_password_srp_hash(update_settings.new_password, new_client_salt.as_slice(),
                                              state.new_server_salt, state.new_srp_g, state.new_srp_p);
       if (new_hash.is_error()) {
-        return promise.set_error(Status::Error(400, "Unable to change password, because it may be unsafe"));
+        return Status::Error(400, "Unable to change password, because it may be unsafe");
       }
       new_settings->new_password_hash_ = new_hash.move_as_ok();
       new_settings->new_algo_ =
@@ -588,8 +657,13 @@ void PasswordManager::do_update_password_settings_impl(UpdateSettings update_set
     new_settings->email_ = std::move(update_settings.recovery_email_address);
   }
   auto current_hash = get_input_check_password(state.has_password ? update_settings.current_password : Slice(), state);
-  auto query = G()->net_query_creator().create(
-      telegram_api::account_updatePasswordSettings(std::move(current_hash), std::move(new_settings)));
+  return make_tl_object<telegram_api::account_updatePasswordSettings>(std::move(current_hash),
+                                                                      std::move(new_settings));
+}
+
+void PasswordManager::send_update_password_settings_query(
+    tl_object_ptr<telegram_api::account_updatePasswordSettings> update_settings_query, Promise<bool> promise) {
+  auto query = G()->net_query_creator().create(*update_settings_query);
 
   send_with_promise(std::move(query), PromiseCreator::lambda([actor_id = actor_id(this), promise = std::move(promise)](
                                                                  Result<NetQueryPtr> r_query) mutable {
@@ -171,19 +171,31 @@ class PasswordManager : public NetQueryCallback {
   static tl_object_ptr<telegram_api::InputCheckPasswordSRP> get_input_check_password(Slice password,
                                                                                      const PasswordState &state);
 
+  void calc_input_check_password(string password, PasswordState state,
+                                 Promise<tl_object_ptr<telegram_api::InputCheckPasswordSRP>> promise);
+
   void update_password_settings(UpdateSettings update_settings, Promise<State> promise);
   void do_update_password_settings(UpdateSettings update_settings, PasswordFullState full_state, Promise<bool> promise);
   void do_update_password_settings_impl(UpdateSettings update_settings, PasswordState state,
                                         PasswordPrivateState private_state, Promise<bool> promise);
+  static Result<tl_object_ptr<telegram_api::account_updatePasswordSettings>> get_update_password_settings_query(
+      UpdateSettings update_settings, PasswordState state, PasswordPrivateState private_state);
+  void send_update_password_settings_query(
+      tl_object_ptr<telegram_api::account_updatePasswordSettings> update_settings_query, Promise<bool> promise);
   void on_get_code_length(int32 code_length);
   void do_get_state(Promise<PasswordState> promise);
   void get_full_state(string password, Promise<PasswordFullState> promise);
   void do_get_secure_secret(bool allow_recursive, string password, Promise<secure_storage::Secret> promise);
   void do_get_full_state(string password, PasswordState state, Promise<PasswordFullState> promise);
+  void send_get_password_settings_query(string password, PasswordState state,
+                                        tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash,
+                                        Promise<PasswordFullState> promise);
   void cache_secret(secure_storage::Secret secret);
 
   void do_create_temp_password(string password, int32 timeout, PasswordState &&password_state,
                                Promise<TempPasswordState> promise);
+  void send_get_tmp_password_query(tl_object_ptr<telegram_api::InputCheckPasswordSRP> hash, int32 timeout,
+                                   Promise<TempPasswordState> promise);
   void on_finish_create_temp_password(Result<TempPasswordState> result, bool dummy);
 
   void on_result(NetQueryPtr query) override;
@@ -1132,8 +1132,10 @@ void PollManager::stop_local_poll(PollId poll_id) {
   notify_on_poll_update(poll_id);
 }
 
-double PollManager::get_polling_timeout() const {
+double PollManager::get_polling_timeout(const Poll *poll) const {
   double result = td_->is_online() ? 60 : 30 * 60;
+  // results of polls without new votes are reloaded less often
+  result *= 1 << min(poll->unchanged_reload_count, MAX_POLL_RELOAD_SLOWDOWN);
   return result * Random::fast(70, 100) * 0.01;
 }
 
@@ -1154,18 +1156,92 @@ void PollManager::on_update_poll_timeout(PollId poll_id) {
     return;
   }
 
-  auto it = poll_messages_.find(poll_id);
-  if (it == poll_messages_.end()) {
+  if (poll_messages_.count(poll_id) == 0) {
     return;
   }
 
-  auto full_message_id = *it->second.begin();
-  LOG(INFO) << "Fetching results of " << poll_id << " from " << full_message_id;
-  auto query_promise = PromiseCreator::lambda([poll_id, generation = current_generation_, actor_id = actor_id(this)](
-                                                  Result<tl_object_ptr<telegram_api::Updates>> &&result) {
-    send_closure(actor_id, &PollManager::on_get_poll_results, poll_id, generation, std::move(result));
-  });
-  td_->create_handler<GetPollResultsQuery>(std::move(query_promise))->send(poll_id, full_message_id);
+  // results of all polls, which need to be reloaded at about the same time, are reloaded together
+  reloaded_poll_ids_.insert(poll_id);
+  if (!has_timeout()) {
+    set_timeout_in(POLL_RELOAD_DELAY);
+  }
+}
+
+void PollManager::timeout_expired() {
+  reload_poll_results();
+}
+
+void PollManager::reload_poll_results() {
+  if (G()->close_flag()) {
+    return;
+  }
+
+  std::unordered_map<DialogId, vector<std::pair<PollId, FullMessageId>>, DialogIdHash> dialog_polls;
+  for (auto poll_id : reloaded_poll_ids_) {
+    auto it = poll_messages_.find(poll_id);
+    if (it == poll_messages_.end() || pending_answers_.find(poll_id) != pending_answers_.end()) {
+      continue;
+    }
+    auto full_message_id = *it->second.begin();
+    dialog_polls[full_message_id.get_dialog_id()].emplace_back(poll_id, full_message_id);
+  }
+  reset_to_empty(reloaded_poll_ids_);
+
+  for (auto &it : dialog_polls) {
+    auto &polls = it.second;
+    if (polls.size() == 1) {
+      // messages.getPollResults returns full results, including options chosen by the current user
+      auto poll_id = polls[0].first;
+      auto full_message_id = polls[0].second;
+      LOG(INFO) << "Fetching results of " << poll_id << " from " << full_message_id;
+      auto query_promise =
+          PromiseCreator::lambda([poll_id, generation = current_generation_, actor_id = actor_id(this)](
+                                     Result<tl_object_ptr<telegram_api::Updates>> &&result) {
+            send_closure(actor_id, &PollManager::on_get_poll_results, poll_id, generation, std::move(result));
+          });
+      td_->create_handler<GetPollResultsQuery>(std::move(query_promise))->send(poll_id, full_message_id);
+      continue;
+    }
+
+    // results of polls from the same chat are received together with the messages, containing them
+    for (size_t i = 0; i < polls.size(); i += MAX_RELOADED_POLL_MESSAGES) {
+      vector<PollId> poll_ids;
+      vector<FullMessageId> full_message_ids;
+      for (size_t j = i; j < polls.size() && j < i + MAX_RELOADED_POLL_MESSAGES; j++) {
+        poll_ids.push_back(polls[j].first);
+        full_message_ids.push_back(polls[j].second);
+      }
+      LOG(INFO) << "Fetching results of " << poll_ids << " from " << it.first;
+      auto promise = PromiseCreator::lambda(
+          [actor_id = actor_id(this), poll_ids = std::move(poll_ids)](Result<Unit> &&result) mutable {
+            send_closure(actor_id, &PollManager::on_reload_poll_results, std::move(poll_ids), std::move(result));
+          });
+      td_->messages_manager_->get_messages_from_server(std::move(full_message_ids), std::move(promise));
+    }
+  }
+}
+
+void PollManager::on_reload_poll_results(vector<PollId> &&poll_ids, Result<Unit> &&result) {
+  if (G()->close_flag()) {
+    return;
+  }
+  if (result.is_error()) {
+    LOG(INFO) << "Failed to reload " << poll_ids << ": " << result.error();
+  }
+  for (auto poll_id : poll_ids) {
+    auto poll = get_poll(poll_id);
+    CHECK(poll != nullptr);
+    if ((poll->is_closed && poll->is_updated_after_close) || poll_messages_.count(poll_id) == 0) {
+      continue;
+    }
+
+    // the next reload is scheduled when the poll is received, so it needs to be scheduled only if the poll wasn't
+    if (!update_poll_timeout_.has_timeout(poll_id.get())) {
+      auto timeout = get_polling_timeout(poll);
+      LOG(INFO) << "Schedule updating of " << poll_id << " in " << timeout;
+      update_poll_timeout_.add_timeout_in(poll_id.get(), timeout);
+    }
+  }
 }
 
 void PollManager::on_close_poll_timeout(PollId poll_id) {
@@ -1203,7 +1279,7 @@ void PollManager::on_get_poll_results(PollId poll_id, uint64 generation,
   CHECK(poll != nullptr);
   if (result.is_error()) {
     if (!(poll->is_closed && poll->is_updated_after_close) && !G()->close_flag() && !td_->auth_manager_->is_bot()) {
-      auto timeout = get_polling_timeout();
+      auto timeout = get_polling_timeout(poll);
       LOG(INFO) << "Schedule updating of " << poll_id << " in " << timeout;
       update_poll_timeout_.add_timeout_in(poll_id.get(), timeout);
     }
@@ -1594,7 +1670,12 @@ PollId PollManager::on_get_poll(PollId poll_id, tl_object_ptr<telegram_api::poll
   }
 
   if (!is_bot && !poll->is_closed) {
-    auto timeout = get_polling_timeout();
+    if (is_changed) {
+      poll->unchanged_reload_count = 0;
+    } else if (poll->unchanged_reload_count < MAX_POLL_RELOAD_SLOWDOWN) {
+      poll->unchanged_reload_count++;
+    }
+    auto timeout = get_polling_timeout(poll);
     LOG(INFO) << "Schedule updating of " << poll_id << " in " << timeout;
     update_poll_timeout_.set_timeout_in(poll_id.get(), timeout);
   }
@@ -119,6 +119,7 @@ class PollManager : public Actor {
     bool is_closed = false;
     bool is_updated_after_close = false;
     mutable bool was_saved = false;
+    int32 unchanged_reload_count = 0;  // number of consecutive reloads without changes; isn't saved
 
     template <class StorerT>
     void store(StorerT &storer) const;
@@ -135,11 +136,16 @@ class PollManager : public Actor {
 
   static constexpr int32 MAX_GET_POLL_VOTERS = 50;  // server side limit
 
+  static constexpr double POLL_RELOAD_DELAY = 0.2;  // time to collect polls, which are reloaded together
+  static constexpr size_t MAX_RELOADED_POLL_MESSAGES = 100;  // server side limit of messages.getMessages
+  static constexpr int32 MAX_POLL_RELOAD_SLOWDOWN = 2;  // polling period grows up to 4 times for unchanged polls
+
   class SetPollAnswerLogEvent;
   class StopPollLogEvent;
 
   void start_up() override;
   void tear_down() override;
+  void timeout_expired() override;
 
   static void on_update_poll_timeout_callback(void *poll_manager_ptr, int64 poll_id_int);
 
@@ -167,10 +173,14 @@ class PollManager : public Actor {
 
   void on_load_poll_from_database(PollId poll_id, string value);
 
-  double get_polling_timeout() const;
+  double get_polling_timeout(const Poll *poll) const;
 
   void on_update_poll_timeout(PollId poll_id);
 
+  void reload_poll_results();
+
+  void on_reload_poll_results(vector<PollId> &&poll_ids, Result<Unit> &&result);
+
   void on_close_poll_timeout(PollId poll_id);
 
   void on_online();
@@ -207,6 +217,8 @@ class PollManager : public Actor {
 
   std::unordered_map<PollId, std::unordered_set<FullMessageId, FullMessageIdHash>, PollIdHash> poll_messages_;
 
+  std::unordered_set<PollId, PollIdHash> reloaded_poll_ids_;  // polls, which results will be reloaded together
+
   struct PendingPollAnswer {
     vector<string> options_;
     vector<Promise<Unit>> promises_;
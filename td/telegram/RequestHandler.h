@@ -0,0 +1,259 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/telegram/AuthManager.h"
+#include "td/telegram/Td.h"
+
+#include "td/telegram/td_api.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/SmallObjectCache.h"
+#include "td/utils/Status.h"
+
+#include <type_traits>
+
+namespace td {
+
+// Lightweight replacement of RequestActor with the same interface.
+// A request handler isn't an actor: it is stored and run by Td, which also receives results of its promises,
+// so handling of a request, which can be answered immediately, doesn't create any actors.
+class RequestHandlerBase {
+ public:
+  RequestHandlerBase(Td *td, uint64 request_id) : td(td), request_id_(request_id) {
+  }
+  RequestHandlerBase(const RequestHandlerBase &) = delete;
+  RequestHandlerBase &operator=(const RequestHandlerBase &) = delete;
+  RequestHandlerBase(RequestHandlerBase &&) = delete;
+  RequestHandlerBase &operator=(RequestHandlerBase &&) = delete;
+  virtual ~RequestHandlerBase() = default;
+
+  // handlers are created for many requests and are usually destroyed right after the request is answered
+  static void *operator new(size_t size) {
+    return allocate_small_object(size);
+  }
+  static void operator delete(void *ptr, size_t size) {
+    free_small_object(ptr, size);
+  }
+
+  // returns true, if the request has been answered and the handler can be destroyed
+  virtual bool run() = 0;
+
+  virtual void abort() = 0;
+
+ protected:
+  Td *td;
+  uint64 handler_id_ = 0;
+
+  void send_result(tl_object_ptr<td_api::Object> &&result) {
+    td->send_result(request_id_, std::move(result));
+  }
+
+  void send_error(Status &&status) {
+    LOG(INFO) << "Receive error for query: " << status;
+    td->send_error(request_id_, std::move(status));
+  }
+
+ private:
+  friend class Td;
+
+  uint64 request_id_;
+};
+
+template <class T = Unit>
+class RequestHandler : public RequestHandlerBase {
+ public:
+  RequestHandler(Td *td, uint64 request_id) : RequestHandlerBase(td, request_id) {
+  }
+
+  bool run() override {
+    CHECK(!is_running_);
+    is_running_ = true;
+    has_result_ = false;
+    do_run(td->create_request_handler_promise<T>(handler_id_));
+    is_running_ = false;
+
+    if (has_result_) {
+      has_result_ = false;
+      if (result_.is_error()) {
+        on_error(result_.move_as_error());
+      } else {
+        do_set_result(result_.move_as_ok());
+        do_send_result();
+      }
+      return true;
+    }
+
+    if (--tries_left_ == 0) {
+      do_send_error(Status::Error(500, "Requested data is inaccessible"));
+      return true;
+    }
+    return false;
+  }
+
+  void abort() override {
+    do_send_error(Status::Error(500, "Request aborted"));
+  }
+
+  // returns true, if the request has been answered
+  bool on_result(Result<T> &&result) {
+    if (is_running_) {
+      // the promise was set synchronously by do_run
+      result_ = std::move(result);
+      has_result_ = true;
+      return false;
+    }
+
+    if (result.is_error()) {
+      on_error(result.move_as_error());
+      return true;
+    }
+
+    do_set_result(result.move_as_ok());
+    return run();
+  }
+
+  int get_tries() const {
+    return tries_left_;
+  }
+
+  void set_tries(int32 tries) {
+    tries_left_ = tries;
+  }
+
+  static constexpr int HANGUP_ERROR_CODE = 426487;
+
+ private:
+  virtual void do_run(Promise<T> &&promise) = 0;
+
+  virtual void do_send_result() {
+    send_result(make_tl_object<td_api::ok>());
+  }
+
+  virtual void do_send_error(Status &&status) {
+    send_error(std::move(status));
+  }
+
+  virtual void do_set_result(T &&result) {
+    CHECK((std::is_same<T, Unit>::value));  // all other results should be implicitly handled by overriding this method
+  }
+
+  void on_error(Status &&error) {
+    if (error.code() == HANGUP_ERROR_CODE) {
+      // dropping query due to lost authorization or lost promise
+      // td may be already closed, so we should check is auth_manager_ is empty
+      bool is_authorized = td->auth_manager_ && td->auth_manager_->is_authorized();
+      if (is_authorized) {
+        LOG(ERROR) << "Promise was lost";
+        do_send_error(Status::Error(500, "Query can't be answered due to bug in the TDLib"));
+      } else {
+        do_send_error(Status::Error(401, "Unauthorized"));
+      }
+      return;
+    }
+
+    do_send_error(std::move(error));
+  }
+
+  friend class RequestOnceHandler;
+
+  int tries_left_ = 2;
+  bool is_running_ = false;
+  bool has_result_ = false;
+  Result<T> result_;
+};
+
+class RequestOnceHandler : public RequestHandler<> {
+ public:
+  RequestOnceHandler(Td *td, uint64 request_id) : RequestHandler(td, request_id) {
+  }
+
+  bool run() override {
+    if (get_tries() < 2) {
+      do_send_result();
+      return true;
+    }
+
+    return RequestHandler::run();
+  }
+};
+
+// delivers the result to Td; the result is passed directly to the handler if the promise is set from its do_run
+template <class T>
+class RequestHandlerPromise final : public PromiseInterface<T> {
+ public:
+  RequestHandlerPromise(ActorId<Td> td_id, uint64 handler_id)
+      : td_id_(std::move(td_id)), handler_id_(handler_id), scheduler_(Scheduler::instance()) {
+  }
+  RequestHandlerPromise(const RequestHandlerPromise &) = delete;
+  RequestHandlerPromise &operator=(const RequestHandlerPromise &) = delete;
+  RequestHandlerPromise(RequestHandlerPromise &&) = delete;
+  RequestHandlerPromise &operator=(RequestHandlerPromise &&) = delete;
+  ~RequestHandlerPromise() override {
+    if (!is_set_) {
+      do_set_result(Status::Error(RequestHandler<T>::HANGUP_ERROR_CODE, "Lost promise"));
+    }
+  }
+
+  void set_value(T &&value) override {
+    do_set_result(std::move(value));
+  }
+  void set_error(Status &&error) override {
+    do_set_result(std::move(error));
+  }
+  void set_result(Result<T> &&result) override {
+    do_set_result(std::move(result));
+  }
+
+ private:
+  ActorId<Td> td_id_;
+  uint64 handler_id_;
+  Scheduler *scheduler_;
+  bool is_set_ = false;
+
+  void do_set_result(Result<T> &&result) {
+    is_set_ = true;
+    // the handler can be accessed directly only from the thread of Td
+    if (Scheduler::instance() == scheduler_ && td_id_.is_alive()) {
+      auto td = td_id_.get_actor_unsafe();
+      if (td->running_request_handler_id_ == handler_id_) {
+        return td->template on_request_handler_result<T>(handler_id_, std::move(result));
+      }
+    }
+    send_lambda(td_id_, [td_id = td_id_, handler_id = handler_id_, result = std::move(result)]() mutable {
+      td_id.get_actor_unsafe()->template on_request_handler_result<T>(handler_id, std::move(result));
+    });
+  }
+};
+
+template <class T>
+Promise<T> Td::create_request_handler_promise(uint64 handler_id) {
+  return Promise<T>(make_unique<RequestHandlerPromise<T>>(actor_id(this), handler_id));
+}
+
+template <class T>
+void Td::on_request_handler_result(uint64 handler_id, Result<T> &&result) {
+  auto handler = request_handlers_.get(handler_id);
+  if (handler == nullptr) {
+    // the request has already been answered or aborted
+    return;
+  }
+  CHECK(*handler != nullptr);
+  auto old_running_request_handler_id = running_request_handler_id_;
+  running_request_handler_id_ = handler_id;
+  bool is_finished = static_cast<RequestHandler<T> *>(handler->get())->on_result(std::move(result));
+  running_request_handler_id_ = old_running_request_handler_id;
+  if (is_finished) {
+    request_handlers_.erase(handler_id);
+  }
+}
+
+}  // namespace td
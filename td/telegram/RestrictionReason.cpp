@@ -21,10 +21,8 @@ string get_restriction_reason_description(const vector<RestrictionReason> &restr
     return string();
   }
 
-  auto ignored_restriction_reasons =
-      full_split(G()->shared_config().get_option_string("ignored_restriction_reasons"), ',');
   auto platform = [] {
-    if (G()->shared_config().get_option_boolean("ignore_platform_restrictions")) {
+    if (G()->shared_config().get_option_boolean(ConfigShared::OptionId::IgnorePlatformRestrictions)) {
       return Slice();
     }
 
@@ -39,18 +37,35 @@ string get_restriction_reason_description(const vector<RestrictionReason> &restr
 #endif
   }();
 
+  // the option is read and parsed only if there is a restriction reason, which can be applied
+  bool is_ignored_restriction_reasons_loaded = false;
+  string ignored_restriction_reasons;
+  auto is_ignored = [&](const string &reason) {
+    if (!is_ignored_restriction_reasons_loaded) {
+      is_ignored_restriction_reasons_loaded = true;
+      ignored_restriction_reasons = G()->shared_config().get_option_string("ignored_restriction_reasons");
+    }
+    Slice ignored_reasons = ignored_restriction_reasons;
+    while (!ignored_reasons.empty()) {
+      Slice ignored_reason;
+      std::tie(ignored_reason, ignored_reasons) = split(ignored_reasons, ',');
+      if (ignored_reason == reason) {
+        return true;
+      }
+    }
+    return false;
+  };
+
   if (!platform.empty()) {
     for (auto &restriction_reason : restriction_reasons) {
-      if (restriction_reason.platform_ == platform &&
-          !td::contains(ignored_restriction_reasons, restriction_reason.reason_)) {
+      if (restriction_reason.platform_ == platform && !is_ignored(restriction_reason.reason_)) {
         return restriction_reason.description_;
       }
     }
   }
 
   for (auto &restriction_reason : restriction_reasons) {
-    if (restriction_reason.platform_ == "all" &&
-        !td::contains(ignored_restriction_reasons, restriction_reason.reason_)) {
+    if (restriction_reason.platform_ == "all" && !is_ignored(restriction_reason.reason_)) {
       return restriction_reason.description_;
     }
   }
@@ -832,12 +832,14 @@ Result<std::tuple<uint64, BufferSlice, int32>> SecretChatActor::decrypt(BufferSl
     std::swap(versions[0], versions[1]);
   }
 
+  // the message is decrypted in place, so it is copied only if another version can be tried after a failure;
+  // the encrypted message isn't needed after decryption
   BufferSlice encrypted_message_copy;
   int32 mtproto_version = -1;
   Result<mtproto::Transport::ReadResult> r_read_result;
   for (size_t i = 0; i < versions.size(); i++) {
     bool is_last = i + 1 == versions.size();
-    encrypted_message_copy = encrypted_message.copy();
+    encrypted_message_copy = is_last ? std::move(encrypted_message) : encrypted_message.copy();
     data = encrypted_message_copy.as_slice();
     CHECK(is_aligned_pointer<4>(data.data()));
 
@@ -1246,8 +1248,11 @@ Status SecretChatActor::do_inbound_message_decrypted(unique_ptr<log_event::Inbou
     if (message->is_pending) {
       message->is_pending = false;
       auto old_log_event_id = log_event_id;
-      log_event_id = binlog_add(context_->binlog(), LogEvent::HandlerType::SecretChats, create_storer(*message));
-      binlog_erase(context_->binlog(), old_log_event_id);
+      // the old log event must be erased only together with adding of the new one
+      BinlogBatch batch(context_->binlog());
+      log_event_id = batch.add(LogEvent::HandlerType::SecretChats, create_storer(*message));
+      batch.erase(old_log_event_id);
+      batch.commit();
       LOG(INFO) << "Inbound secret message [save_log_event] rewrite (after pending state) "
                 << tag("log_event_id", log_event_id) << tag("old_log_event_id", old_log_event_id);
       need_sync = true;
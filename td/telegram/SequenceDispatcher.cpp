@@ -37,6 +37,9 @@ namespace td {
 //
 // last_sent_i points to the last sent query in current chain.
 //
+// At most max_wait_cnt queries are sent simultaneously. The window grows while queries are delivered in order
+// and shrinks when the chain breaks, because then all queries sent after the failed one must be resent.
+//
 void SequenceDispatcher::send_with_callback(NetQueryPtr query, ActorShared<NetQueryCallback> callback) {
   cancel_timeout();
   query->debug("Waiting at SequenceDispatcher");
@@ -140,11 +143,20 @@ void SequenceDispatcher::on_result(NetQueryPtr query) {
   if (query->is_error() && (query->error().code() == NetQuery::ResendInvokeAfter ||
                             (query->error().code() == 400 && query->error().message() == "MSG_WAIT_FAILED"))) {
     VLOG(net_query) << "Resend " << query;
+    if (data.generation_ == generation_) {
+      max_wait_cnt_ /= 2;
+      if (max_wait_cnt_ < MIN_SIMULTANEOUS_WAIT) {
+        max_wait_cnt_ = MIN_SIMULTANEOUS_WAIT;
+      }
+    }
     query->resend();
     query->debug("Waiting at SequenceDispatcher");
     data.query_ = std::move(query);
     do_resend(data);
   } else {
+    if (max_wait_cnt_ < MAX_SIMULTANEOUS_WAIT) {
+      max_wait_cnt_++;
+    }
     try_resend_query(data, std::move(query));
   }
   loop();
@@ -156,7 +168,7 @@ void SequenceDispatcher::loop() {
   if (next_i_ < finish_i_) {
     next_i_ = finish_i_;
   }
-  for (; next_i_ < data_.size() && data_[next_i_].state_ != State::Wait && wait_cnt_ < MAX_SIMULTANEOUS_WAIT;
+  for (; next_i_ < data_.size() && data_[next_i_].state_ != State::Wait && wait_cnt_ < max_wait_cnt_;
        next_i_++) {
     if (data_[next_i_].state_ == State::Finish) {
       continue;
@@ -53,7 +53,9 @@ class SequenceDispatcher : public NetQueryCallback {
   uint64 generation_ = 1;
   uint32 session_rand_ = Random::secure_int32();
 
-  static constexpr int32 MAX_SIMULTANEOUS_WAIT = 10;
+  static constexpr uint32 MIN_SIMULTANEOUS_WAIT = 10;
+  static constexpr uint32 MAX_SIMULTANEOUS_WAIT = 100;
+  uint32 max_wait_cnt_ = MIN_SIMULTANEOUS_WAIT;
   uint32 wait_cnt_ = 0;
 
   void check_timeout(Data &data);
@@ -52,7 +52,10 @@
 #include "td/utils/utf8.h"
 
 #include <algorithm>
+#include <deque>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <type_traits>
 #include <unordered_set>
 
@@ -651,6 +654,7 @@ class GetStickerSetQuery : public Td::ResultHandler {
   Promise<Unit> promise_;
   StickerSetId sticker_set_id_;
   string sticker_set_name_;
+  bool is_from_shared_cache_ = false;
 
  public:
   explicit GetStickerSetQuery(Promise<Unit> &&promise) : promise_(std::move(promise)) {
@@ -663,16 +667,33 @@ class GetStickerSetQuery : public Td::ResultHandler {
           static_cast<const telegram_api::inputStickerSetShortName *>(input_sticker_set.get())->short_name_;
     }
     LOG(INFO) << "Load " << sticker_set_id << " from server: " << to_string(input_sticker_set);
-    send_query(G()->net_query_creator().create(telegram_api::messages_getStickerSet(std::move(input_sticker_set))));
+    auto query = G()->net_query_creator().create(telegram_api::messages_getStickerSet(std::move(input_sticker_set)));
+    query->cache_ttl_ = 0;
+    send_query(std::move(query));
+  }
+
+  void send_cached(StickerSetId sticker_set_id, BufferSlice packet) {
+    sticker_set_id_ = sticker_set_id;
+    is_from_shared_cache_ = true;
+    LOG(INFO) << "Load " << sticker_set_id << " from shared cache";
+    on_result(0, std::move(packet));
   }
 
   void on_result(uint64 id, BufferSlice packet) override {
+    BufferSlice shared_packet;
+    if (!is_from_shared_cache_ && G()->shared_config().get_option_boolean("use_shared_sticker_set_cache")) {
+      shared_packet = packet.clone();
+    }
+
     auto result_ptr = fetch_result<telegram_api::messages_getStickerSet>(packet);
     if (result_ptr.is_error()) {
       return on_error(id, result_ptr.move_as_error());
     }
 
     auto set = result_ptr.move_as_ok();
+    if (!shared_packet.empty()) {
+      StickersManager::add_shared_sticker_set_packet(set->set_->id_, set->set_->hash_, shared_packet);
+    }
 
     constexpr int64 GREAT_MINDS_COLOR_SET_ID = 151353307481243663;
     if (set->set_->id_ == GREAT_MINDS_COLOR_SET_ID) {
@@ -702,7 +723,9 @@ class ReloadSpecialStickerSetQuery : public Td::ResultHandler {
  public:
   void send(SpecialStickerSetType type) {
     type_ = std::move(type);
-    send_query(G()->net_query_creator().create(telegram_api::messages_getStickerSet(type_.get_input_sticker_set())));
+    auto query = G()->net_query_creator().create(telegram_api::messages_getStickerSet(type_.get_input_sticker_set()));
+    query->cache_ttl_ = 0;
+    send_query(std::move(query));
   }
 
   void on_result(uint64 id, BufferSlice packet) override {
@@ -3239,17 +3262,12 @@ string StickersManager::get_full_sticker_set_database_key(StickerSetId set_id) {
 }
 
 string StickersManager::get_sticker_set_database_value(const StickerSet *s, bool with_stickers) {
-  LogEventStorerCalcLength storer_calc_length;
-  store_sticker_set(s, with_stickers, storer_calc_length);
-
-  BufferSlice value_buffer{storer_calc_length.get_length()};
-  auto value = value_buffer.as_slice();
+  log_event::LogEventStoreBuffer buffer;
+  LogEventStorerGrowable storer(buffer.get());
+  store_sticker_set(s, with_stickers, storer);
 
+  auto value = storer.as_slice();
   LOG(DEBUG) << "Serialized size of " << s->id << " is " << value.size();
-
-  LogEventStorerUnsafe storer_unsafe(value.ubegin());
-  store_sticker_set(s, with_stickers, storer_unsafe);
-
   return value.str();
 }
 
@@ -3423,9 +3441,63 @@ void StickersManager::do_reload_sticker_set(StickerSetId sticker_set_id,
   if (G()->close_flag()) {
     return promise.set_error(Status::Error(500, "Request aborted"));
   }
+  if (sticker_set_id.is_valid() && G()->shared_config().get_option_boolean("use_shared_sticker_set_cache")) {
+    // the hash is known only if the set was received before, for example, as a part of installed sticker sets
+    const StickerSet *sticker_set = get_sticker_set(sticker_set_id);
+    if (sticker_set != nullptr && sticker_set->is_inited && sticker_set->hash != 0) {
+      auto packet = get_shared_sticker_set_packet(sticker_set_id.get(), sticker_set->hash);
+      if (!packet.empty()) {
+        send_closure_later(G()->stickers_manager(), &StickersManager::on_get_sticker_set_from_shared_cache,
+                           sticker_set_id, std::move(packet), std::move(promise));
+        return;
+      }
+    }
+  }
   td_->create_handler<GetStickerSetQuery>(std::move(promise))->send(sticker_set_id, std::move(input_sticker_set));
 }
 
+void StickersManager::on_get_sticker_set_from_shared_cache(StickerSetId sticker_set_id, BufferSlice packet,
+                                                           Promise<Unit> &&promise) {
+  if (G()->close_flag()) {
+    return promise.set_error(Status::Error(500, "Request aborted"));
+  }
+  td_->create_handler<GetStickerSetQuery>(std::move(promise))->send_cached(sticker_set_id, std::move(packet));
+}
+
+BufferSlice StickersManager::get_shared_sticker_set_packet(int64 sticker_set_id, int32 hash) {
+  std::lock_guard<std::mutex> lock(shared_sticker_set_packets_mutex_);
+  auto it = shared_sticker_set_packets_.find(SharedStickerSetPacketKey(G()->is_test_dc(), sticker_set_id, hash));
+  if (it == shared_sticker_set_packets_.end()) {
+    return BufferSlice();
+  }
+  return it->second.clone();
+}
+
+void StickersManager::add_shared_sticker_set_packet(int64 sticker_set_id, int32 hash, const BufferSlice &packet) {
+  if (hash == 0 || packet.size() > MAX_SHARED_STICKER_SET_PACKETS_SIZE / 8) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(shared_sticker_set_packets_mutex_);
+  SharedStickerSetPacketKey key(G()->is_test_dc(), sticker_set_id, hash);
+  auto &shared_packet = shared_sticker_set_packets_[key];
+  if (!shared_packet.empty()) {
+    return;
+  }
+  shared_packet = packet.clone();
+  shared_sticker_set_packet_keys_.push_back(key);
+  shared_sticker_set_packets_size_ += packet.size();
+
+  while (shared_sticker_set_packets_size_ > MAX_SHARED_STICKER_SET_PACKETS_SIZE) {
+    CHECK(!shared_sticker_set_packet_keys_.empty());
+    auto it = shared_sticker_set_packets_.find(shared_sticker_set_packet_keys_.front());
+    CHECK(it != shared_sticker_set_packets_.end());
+    shared_sticker_set_packets_size_ -= it->second.size();
+    shared_sticker_set_packets_.erase(it);
+    shared_sticker_set_packet_keys_.pop_front();
+  }
+}
+
 void StickersManager::on_install_sticker_set(StickerSetId set_id, bool is_archived,
                                              tl_object_ptr<telegram_api::messages_StickerSetInstallResult> &&result) {
   StickerSet *sticker_set = get_sticker_set(set_id);
@@ -3529,6 +3601,28 @@ void StickersManager::on_update_dice_success_values() {
   });
 }
 
+void StickersManager::get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) const {
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "stickers", static_cast<int64>(stickers_.size()), static_cast<int64>(stickers_.size() * sizeof(Sticker))));
+
+  int64 sticker_set_size = 0;
+  for (auto &it : sticker_sets_) {
+    auto sticker_set = it.second.get();
+    sticker_set_size += static_cast<int64>(sizeof(StickerSet) + sticker_set->sticker_ids.capacity() * sizeof(FileId));
+  }
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "sticker sets", static_cast<int64>(sticker_sets_.size()), sticker_set_size));
+
+  int64 hints_count = 0;
+  int64 hints_size = 0;
+  for (auto &hints : installed_sticker_sets_hints_) {
+    hints_count += static_cast<int64>(hints.size());
+    hints_size += static_cast<int64>(hints.get_memory_size());
+  }
+  entries.push_back(
+      td_api::make_object<td_api::memoryStatisticsEntry>("sticker set search index", hints_count, hints_size));
+}
+
 void StickersManager::on_update_sticker_sets() {
   // TODO better support
   archived_sticker_set_ids_[0].clear();
@@ -5822,21 +5916,41 @@ string StickersManager::get_language_emojis_database_key(const string &language_
   return PSTRING() << "emoji$" << language_code << '$' << text;
 }
 
+std::map<string, vector<string>> &StickersManager::get_emoji_language_keywords(const string &language_code) {
+  auto it = emoji_language_keywords_.find(language_code);
+  if (it != emoji_language_keywords_.end()) {
+    return it->second;
+  }
+
+  auto &result = emoji_language_keywords_[language_code];
+  auto prefix = get_language_emojis_database_key(language_code, string());
+  G()->td_db()->get_sqlite_sync_pmc()->get_by_prefix(prefix, [&result, &prefix](Slice key, Slice value) {
+    if (!value.empty()) {
+      result.emplace(key.substr(prefix.size()).str(),
+                     transform(full_split(value, '$'), [](Slice emoji) { return emoji.str(); }));
+    }
+    return true;
+  });
+  LOG(INFO) << "Loaded " << result.size() << " emoji keywords for language " << language_code;
+  return result;
+}
+
 vector<string> StickersManager::search_language_emojis(const string &language_code, const string &text,
-                                                       bool exact_match) const {
+                                                       bool exact_match) {
   LOG(INFO) << "Search for \"" << text << "\" in language " << language_code;
-  auto key = get_language_emojis_database_key(language_code, text);
+  // keywords are kept in memory to not search for them in the database after each typed letter
+  const auto &keywords = get_emoji_language_keywords(language_code);
   if (exact_match) {
-    string emojis = G()->td_db()->get_sqlite_sync_pmc()->get(key);
-    return full_split(emojis, '$');
+    auto it = keywords.find(text);
+    if (it == keywords.end()) {
+      return {};
+    }
+    return it->second;
   } else {
     vector<string> result;
-    G()->td_db()->get_sqlite_sync_pmc()->get_by_prefix(key, [&result](Slice key, Slice value) {
-      for (auto &emoji : full_split(value, '$')) {
-        result.push_back(emoji.str());
-      }
-      return true;
-    });
+    for (auto it = keywords.lower_bound(text); it != keywords.end() && begins_with(it->first, text); ++it) {
+      append(result, it->second);
+    }
     return result;
   }
 }
@@ -6025,6 +6139,7 @@ void StickersManager::on_get_emoji_keywords(
     LOG(ERROR) << "Receive keywords of version " << version;
     version = 1;
   }
+  std::map<string, vector<string>> language_keywords;
   for (auto &keyword_ptr : keywords->keywords_) {
     switch (keyword_ptr->get_id()) {
       case telegram_api::emojiKeyword::ID: {
@@ -6042,6 +6157,9 @@ void StickersManager::on_get_emoji_keywords(
           G()->td_db()->get_sqlite_pmc()->set(get_language_emojis_database_key(language_code, text),
                                               implode(keyword->emoticons_, '$'), mpas.get_promise());
         }
+        if (is_good && !keyword->emoticons_.empty()) {
+          language_keywords[text] = std::move(keyword->emoticons_);
+        }
         break;
       }
       case telegram_api::emojiKeywordDeleted::ID:
@@ -6060,6 +6178,7 @@ void StickersManager::on_get_emoji_keywords(
   }
   emoji_language_code_versions_[language_code] = version;
   emoji_language_code_last_difference_times_[language_code] = static_cast<int32>(Time::now_cached());
+  emoji_language_keywords_[language_code] = std::move(language_keywords);
 
   lock.set_value(Unit());
 }
@@ -6103,6 +6222,7 @@ void StickersManager::on_get_emoji_keywords_difference(
     keywords->version_ = version;
   }
   version = keywords->version_;
+  auto &language_keywords = get_emoji_language_keywords(language_code);
   auto *pmc = G()->td_db()->get_sqlite_sync_pmc();
   pmc->begin_transaction().ensure();
   for (auto &keyword_ptr : keywords->keywords_) {
@@ -6118,7 +6238,7 @@ void StickersManager::on_get_emoji_keywords_difference(
           }
         }
         if (is_good) {
-          vector<string> emojis = search_language_emojis(language_code, text, true);
+          vector<string> &emojis = language_keywords[text];
           bool is_changed = false;
           for (auto &emoji : keyword->emoticons_) {
             if (!td::contains(emojis, emoji)) {
@@ -6138,15 +6258,21 @@ void StickersManager::on_get_emoji_keywords_difference(
       case telegram_api::emojiKeywordDeleted::ID: {
         auto keyword = telegram_api::move_object_as<telegram_api::emojiKeywordDeleted>(keyword_ptr);
         auto text = utf8_to_lower(keyword->keyword_);
-        vector<string> emojis = search_language_emojis(language_code, text, true);
+        auto it = language_keywords.find(text);
         bool is_changed = false;
-        for (auto &emoji : keyword->emoticons_) {
-          if (td::remove(emojis, emoji)) {
-            is_changed = true;
+        if (it != language_keywords.end()) {
+          auto &emojis = it->second;
+          for (auto &emoji : keyword->emoticons_) {
+            if (td::remove(emojis, emoji)) {
+              is_changed = true;
+            }
           }
         }
         if (is_changed) {
-          pmc->set(get_language_emojis_database_key(language_code, text), implode(emojis, '$'));
+          pmc->set(get_language_emojis_database_key(language_code, text), implode(it->second, '$'));
+          if (it->second.empty()) {
+            language_keywords.erase(it);
+          }
         } else {
           LOG(ERROR) << "Emoji keywords not changed for \"" << text << "\" from version " << from_version
                      << " to version " << version;
@@ -6301,4 +6427,9 @@ void StickersManager::get_current_state(vector<td_api::object_ptr<td_api::Update
   }
 }
 
+std::mutex StickersManager::shared_sticker_set_packets_mutex_;
+std::map<StickersManager::SharedStickerSetPacketKey, BufferSlice> StickersManager::shared_sticker_set_packets_;
+std::deque<StickersManager::SharedStickerSetPacketKey> StickersManager::shared_sticker_set_packet_keys_;
+size_t StickersManager::shared_sticker_set_packets_size_ = 0;
+
 }  // namespace td
@@ -28,7 +28,10 @@
 #include "td/telegram/td_api.h"
 #include "td/telegram/telegram_api.h"
 
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
@@ -45,6 +48,8 @@ class StickersManager : public Actor {
   static vector<StickerSetId> convert_sticker_set_ids(const vector<int64> &sticker_set_ids);
   static vector<int64> convert_sticker_set_ids(const vector<StickerSetId> &sticker_set_ids);
 
+  static void add_shared_sticker_set_packet(int64 sticker_set_id, int32 hash, const BufferSlice &packet);
+
   StickersManager(Td *td, ActorShared<> parent);
 
   void init();
@@ -140,6 +145,8 @@ class StickersManager : public Actor {
 
   void on_update_sticker_sets_order(bool is_masks, const vector<StickerSetId> &sticker_set_ids);
 
+  void get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) const;
+
   std::pair<int32, vector<StickerSetId>> get_archived_sticker_sets(bool is_masks, StickerSetId offset_sticker_set_id,
                                                                    int32 limit, bool force, Promise<Unit> &&promise);
 
@@ -442,6 +449,10 @@ class StickersManager : public Actor {
                              tl_object_ptr<telegram_api::InputStickerSet> &&input_sticker_set,
                              Promise<Unit> &&promise) const;
 
+  void on_get_sticker_set_from_shared_cache(StickerSetId sticker_set_id, BufferSlice packet, Promise<Unit> &&promise);
+
+  static BufferSlice get_shared_sticker_set_packet(int64 sticker_set_id, int32 hash);
+
   static void read_featured_sticker_sets(void *td_void);
 
   int32 get_sticker_sets_hash(const vector<StickerSetId> &sticker_set_ids) const;
@@ -599,7 +610,9 @@ class StickersManager : public Actor {
 
   void on_get_language_codes(const string &key, Result<vector<string>> &&result);
 
-  vector<string> search_language_emojis(const string &language_code, const string &text, bool exact_match) const;
+  std::map<string, vector<string>> &get_emoji_language_keywords(const string &language_code);
+
+  vector<string> search_language_emojis(const string &language_code, const string &text, bool exact_match);
 
   void load_emoji_keywords(const string &language_code, Promise<Unit> &&promise);
 
@@ -709,6 +722,8 @@ class StickersManager : public Actor {
   std::unordered_map<string, vector<string>> emoji_language_codes_;
   std::unordered_map<string, int32> emoji_language_code_versions_;
   std::unordered_map<string, double> emoji_language_code_last_difference_times_;
+  std::unordered_map<string, std::map<string, vector<string>>>
+      emoji_language_keywords_;  // language_code -> keyword -> emojis; a copy of keywords from the database
   std::unordered_set<string> reloaded_emoji_keywords_;
   std::unordered_map<string, vector<Promise<Unit>>> load_emoji_keywords_queries_;
   std::unordered_map<string, vector<Promise<Unit>>> load_language_codes_queries_;
@@ -721,6 +736,15 @@ class StickersManager : public Actor {
 
   string dice_success_values_str_;
   vector<std::pair<int32, int32>> dice_success_values_;
+
+  // raw messages.getStickerSet responses shared between all instances, because parsed sticker sets contain
+  // instance-specific file identifiers; key is (is_test_dc, sticker_set_id, hash)
+  using SharedStickerSetPacketKey = std::tuple<bool, int64, int32>;
+  static constexpr size_t MAX_SHARED_STICKER_SET_PACKETS_SIZE = 32 << 20;
+  static std::mutex shared_sticker_set_packets_mutex_;
+  static std::map<SharedStickerSetPacketKey, BufferSlice> shared_sticker_set_packets_;
+  static std::deque<SharedStickerSetPacketKey> shared_sticker_set_packet_keys_;  // in order of addition
+  static size_t shared_sticker_set_packets_size_;
 };
 
 }  // namespace td
@@ -23,6 +23,7 @@
 #include "td/telegram/ConfigShared.h"
 #include "td/telegram/ContactsManager.h"
 #include "td/telegram/CountryInfoManager.h"
+#include "td/telegram/CryptoWorker.h"
 #include "td/telegram/DeviceTokenManager.h"
 #include "td/telegram/DialogAction.h"
 #include "td/telegram/DialogAdministrator.h"
@@ -59,8 +60,10 @@
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/MtprotoHeader.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCreator.h"
 #include "td/telegram/net/NetQueryDelayer.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
+#include "td/telegram/net/NetQueryStats.h"
 #include "td/telegram/net/NetStatsManager.h"
 #include "td/telegram/net/NetType.h"
 #include "td/telegram/net/Proxy.h"
@@ -79,6 +82,7 @@
 #include "td/telegram/PrivacyManager.h"
 #include "td/telegram/PublicDialogType.h"
 #include "td/telegram/RequestActor.h"
+#include "td/telegram/RequestHandler.h"
 #include "td/telegram/SecretChatId.h"
 #include "td/telegram/SecretChatsManager.h"
 #include "td/telegram/SecureManager.h"
@@ -103,15 +107,22 @@
 #include "td/telegram/telegram_api.hpp"
 
 #include "td/actor/actor.h"
+#include "td/actor/ActorStats.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/db/binlog/Binlog.h"
 #include "td/db/binlog/BinlogEvent.h"
+#include "td/db/SqliteDb.h"
+#include "td/db/SqliteStatement.h"
+
+#include "memprof/memprof.h"
 
 #include "td/mtproto/DhHandshake.h"
 #include "td/mtproto/Handshake.h"
 #include "td/mtproto/HandshakeActor.h"
 #include "td/mtproto/RawConnection.h"
 #include "td/mtproto/RSA.h"
+#include "td/mtproto/SessionConnection.h"
 #include "td/mtproto/TransportType.h"
 
 #include "td/utils/buffer.h"
@@ -122,6 +133,7 @@
 #include "td/utils/PathView.h"
 #include "td/utils/port/IPAddress.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/PerfCounters.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/port/uname.h"
 #include "td/utils/Random.h"
@@ -656,7 +668,7 @@ class TestProxyRequest : public RequestOnceActor {
   }
 };
 
-class GetMeRequest : public RequestActor<> {
+class GetMeRequest : public RequestHandler<> {
   UserId user_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -668,11 +680,11 @@ class GetMeRequest : public RequestActor<> {
   }
 
  public:
-  GetMeRequest(ActorShared<Td> td, uint64 request_id) : RequestActor(std::move(td), request_id) {
+  GetMeRequest(Td *td, uint64 request_id) : RequestHandler(td, request_id) {
   }
 };
 
-class GetUserRequest : public RequestActor<> {
+class GetUserRequest : public RequestHandler<> {
   UserId user_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -684,13 +696,12 @@ class GetUserRequest : public RequestActor<> {
   }
 
  public:
-  GetUserRequest(ActorShared<Td> td, uint64 request_id, int32 user_id)
-      : RequestActor(std::move(td), request_id), user_id_(user_id) {
+  GetUserRequest(Td *td, uint64 request_id, int32 user_id) : RequestHandler(td, request_id), user_id_(user_id) {
     set_tries(3);
   }
 };
 
-class GetUserFullInfoRequest : public RequestActor<> {
+class GetUserFullInfoRequest : public RequestHandler<> {
   UserId user_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -702,12 +713,11 @@ class GetUserFullInfoRequest : public RequestActor<> {
   }
 
  public:
-  GetUserFullInfoRequest(ActorShared<Td> td, uint64 request_id, int32 user_id)
-      : RequestActor(std::move(td), request_id), user_id_(user_id) {
+  GetUserFullInfoRequest(Td *td, uint64 request_id, int32 user_id) : RequestHandler(td, request_id), user_id_(user_id) {
   }
 };
 
-class GetGroupRequest : public RequestActor<> {
+class GetGroupRequest : public RequestHandler<> {
   ChatId chat_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -719,13 +729,12 @@ class GetGroupRequest : public RequestActor<> {
   }
 
  public:
-  GetGroupRequest(ActorShared<Td> td, uint64 request_id, int32 chat_id)
-      : RequestActor(std::move(td), request_id), chat_id_(chat_id) {
+  GetGroupRequest(Td *td, uint64 request_id, int32 chat_id) : RequestHandler(td, request_id), chat_id_(chat_id) {
     set_tries(3);
   }
 };
 
-class GetGroupFullInfoRequest : public RequestActor<> {
+class GetGroupFullInfoRequest : public RequestHandler<> {
   ChatId chat_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -737,12 +746,12 @@ class GetGroupFullInfoRequest : public RequestActor<> {
   }
 
  public:
-  GetGroupFullInfoRequest(ActorShared<Td> td, uint64 request_id, int32 chat_id)
-      : RequestActor(std::move(td), request_id), chat_id_(chat_id) {
+  GetGroupFullInfoRequest(Td *td, uint64 request_id, int32 chat_id)
+      : RequestHandler(td, request_id), chat_id_(chat_id) {
   }
 };
 
-class GetSupergroupRequest : public RequestActor<> {
+class GetSupergroupRequest : public RequestHandler<> {
   ChannelId channel_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -754,13 +763,13 @@ class GetSupergroupRequest : public RequestActor<> {
   }
 
  public:
-  GetSupergroupRequest(ActorShared<Td> td, uint64 request_id, int32 channel_id)
-      : RequestActor(std::move(td), request_id), channel_id_(channel_id) {
+  GetSupergroupRequest(Td *td, uint64 request_id, int32 channel_id)
+      : RequestHandler(td, request_id), channel_id_(channel_id) {
     set_tries(3);
   }
 };
 
-class GetSupergroupFullInfoRequest : public RequestActor<> {
+class GetSupergroupFullInfoRequest : public RequestHandler<> {
   ChannelId channel_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -772,12 +781,12 @@ class GetSupergroupFullInfoRequest : public RequestActor<> {
   }
 
  public:
-  GetSupergroupFullInfoRequest(ActorShared<Td> td, uint64 request_id, int32 channel_id)
-      : RequestActor(std::move(td), request_id), channel_id_(channel_id) {
+  GetSupergroupFullInfoRequest(Td *td, uint64 request_id, int32 channel_id)
+      : RequestHandler(td, request_id), channel_id_(channel_id) {
   }
 };
 
-class GetSecretChatRequest : public RequestActor<> {
+class GetSecretChatRequest : public RequestHandler<> {
   SecretChatId secret_chat_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -789,12 +798,12 @@ class GetSecretChatRequest : public RequestActor<> {
   }
 
  public:
-  GetSecretChatRequest(ActorShared<Td> td, uint64 request_id, int32 secret_chat_id)
-      : RequestActor(std::move(td), request_id), secret_chat_id_(secret_chat_id) {
+  GetSecretChatRequest(Td *td, uint64 request_id, int32 secret_chat_id)
+      : RequestHandler(td, request_id), secret_chat_id_(secret_chat_id) {
   }
 };
 
-class GetChatRequest : public RequestActor<> {
+class GetChatRequest : public RequestHandler<> {
   DialogId dialog_id_;
 
   bool dialog_found_ = false;
@@ -812,8 +821,7 @@ class GetChatRequest : public RequestActor<> {
   }
 
  public:
-  GetChatRequest(ActorShared<Td> td, uint64 request_id, int64 dialog_id)
-      : RequestActor(std::move(td), request_id), dialog_id_(dialog_id) {
+  GetChatRequest(Td *td, uint64 request_id, int64 dialog_id) : RequestHandler(td, request_id), dialog_id_(dialog_id) {
     set_tries(3);
   }
 };
@@ -836,7 +844,7 @@ class GetChatFilterRequest : public RequestActor<> {
   }
 };
 
-class GetChatsRequest : public RequestActor<> {
+class GetChatsRequest : public RequestHandler<> {
   DialogListId dialog_list_id_;
   DialogDate offset_;
   int32 limit_;
@@ -853,9 +861,9 @@ class GetChatsRequest : public RequestActor<> {
   }
 
  public:
-  GetChatsRequest(ActorShared<Td> td, uint64 request_id, DialogListId dialog_list_id, int64 offset_order,
-                  int64 offset_dialog_id, int32 limit)
-      : RequestActor(std::move(td), request_id)
+  GetChatsRequest(Td *td, uint64 request_id, DialogListId dialog_list_id, int64 offset_order, int64 offset_dialog_id,
+                  int32 limit)
+      : RequestHandler(td, request_id)
       , dialog_list_id_(dialog_list_id)
       , offset_(offset_order, DialogId(offset_dialog_id))
       , limit_(limit) {
@@ -1015,7 +1023,7 @@ class GetInactiveSupergroupChatsRequest : public RequestActor<> {
   }
 };
 
-class GetMessageRequest : public RequestOnceActor {
+class GetMessageRequest : public RequestOnceHandler {
   FullMessageId full_message_id_;
 
   void do_run(Promise<Unit> &&promise) override {
@@ -1027,8 +1035,8 @@ class GetMessageRequest : public RequestOnceActor {
   }
 
  public:
-  GetMessageRequest(ActorShared<Td> td, uint64 request_id, int64 dialog_id, int64 message_id)
-      : RequestOnceActor(std::move(td), request_id), full_message_id_(DialogId(dialog_id), MessageId(message_id)) {
+  GetMessageRequest(Td *td, uint64 request_id, int64 dialog_id, int64 message_id)
+      : RequestOnceHandler(td, request_id), full_message_id_(DialogId(dialog_id), MessageId(message_id)) {
   }
 };
 
@@ -1125,7 +1133,7 @@ class GetCallbackQueryMessageRequest : public RequestOnceActor {
   }
 };
 
-class GetMessagesRequest : public RequestOnceActor {
+class GetMessagesRequest : public RequestOnceHandler {
   DialogId dialog_id_;
   vector<MessageId> message_ids_;
 
@@ -1138,8 +1146,8 @@ class GetMessagesRequest : public RequestOnceActor {
   }
 
  public:
-  GetMessagesRequest(ActorShared<Td> td, uint64 request_id, int64 dialog_id, const vector<int64> &message_ids)
-      : RequestOnceActor(std::move(td), request_id)
+  GetMessagesRequest(Td *td, uint64 request_id, int64 dialog_id, const vector<int64> &message_ids)
+      : RequestOnceHandler(td, request_id)
       , dialog_id_(dialog_id)
       , message_ids_(MessagesManager::get_message_ids(message_ids)) {
   }
@@ -1396,7 +1404,7 @@ class GetInlineGameHighScoresRequest : public RequestOnceActor {
   }
 };
 
-class GetChatHistoryRequest : public RequestActor<> {
+class GetChatHistoryRequest : public RequestHandler<> {
   DialogId dialog_id_;
   MessageId from_message_id_;
   int32 offset_;
@@ -1415,9 +1423,9 @@ class GetChatHistoryRequest : public RequestActor<> {
   }
 
  public:
-  GetChatHistoryRequest(ActorShared<Td> td, uint64 request_id, int64 dialog_id, int64 from_message_id, int32 offset,
-                        int32 limit, bool only_local)
-      : RequestActor(std::move(td), request_id)
+  GetChatHistoryRequest(Td *td, uint64 request_id, int64 dialog_id, int64 from_message_id, int32 offset, int32 limit,
+                        bool only_local)
+      : RequestHandler(td, request_id)
       , dialog_id_(dialog_id)
       , from_message_id_(from_message_id)
       , offset_(offset)
@@ -3129,6 +3137,10 @@ void Td::on_alarm_timeout(int64 alarm_id) {
     }
     return;
   }
+  if (alarm_id == FLUSH_UPDATES_ALARM_ID) {
+    flush_pending_updates();
+    return;
+  }
   if (alarm_id == PROMO_DATA_ALARM_ID) {
     if (!close_flag_ && !auth_manager_->is_bot()) {
       auto promise = PromiseCreator::lambda(
@@ -3334,6 +3346,11 @@ bool Td::is_synchronous_request(int32 id) {
     case td_api::setLogTagVerbosityLevel::ID:
     case td_api::getLogTagVerbosityLevel::ID:
     case td_api::addLogMessage::ID:
+    case td_api::toggleActorStatistics::ID:
+    case td_api::getActorStatistics::ID:
+    case td_api::toggleDatabaseQueryStatistics::ID:
+    case td_api::getDatabaseQueryStatistics::ID:
+    case td_api::getQueryPackingStatistics::ID:
     case td_api::testReturnError::ID:
       return true;
     default:
@@ -3378,10 +3395,12 @@ bool Td::is_preauthentication_request(int32 id) {
     case td_api::getStorageStatistics::ID:
     case td_api::getStorageStatisticsFast::ID:
     case td_api::getDatabaseStatistics::ID:
+    case td_api::compactDatabase::ID:
     case td_api::setNetworkType::ID:
     case td_api::getNetworkStatistics::ID:
     case td_api::addNetworkStatistics::ID:
     case td_api::resetNetworkStatistics::ID:
+    case td_api::getNetworkQueryStatistics::ID:
     case td_api::getCountries::ID:
     case td_api::getCountryCode::ID:
     case td_api::getPhoneNumberInfo::ID:
@@ -3703,12 +3722,19 @@ void Td::on_config_option_updated(const string &name) {
   } else if (name == "favorite_stickers_limit") {
     stickers_manager_->on_update_favorite_stickers_limit(
         narrow_cast<int32>(G()->shared_config().get_option_integer(name)));
+  } else if (name == "binlog_event_compression_min_size") {
+    Binlog::set_min_compressed_event_size(
+        static_cast<size_t>(max(G()->shared_config().get_option_integer(name), static_cast<int64>(0))));
   } else if (name == "my_id") {
     G()->set_my_id(static_cast<int32>(G()->shared_config().get_option_integer(name)));
-  } else if (name == "session_count") {
+  } else if (name == "session_count" || name == "session_count_max") {
     G()->net_query_dispatcher().update_session_count();
   } else if (name == "use_pfs") {
     G()->net_query_dispatcher().update_use_pfs();
+  } else if (name == "proxy_auto_failover") {
+    send_closure(G()->connection_creator(), &ConnectionCreator::update_proxy_auto_failover);
+  } else if (name == "use_dc_authorization_warmup") {
+    send_closure(G()->connection_creator(), &ConnectionCreator::update_dc_authorization_warmup);
   } else if (name == "use_storage_optimizer") {
     send_closure(storage_manager_, &StorageManager::update_use_storage_optimizer);
   } else if (name == "rating_e_decay") {
@@ -3753,6 +3779,13 @@ void Td::on_config_option_updated(const string &name) {
     return send_closure(notification_manager_actor_, &NotificationManager::on_notification_default_delay_changed);
   } else if (name == "ignored_restriction_reasons") {
     return send_closure(contacts_manager_actor_, &ContactsManager::on_ignored_restriction_reasons_changed);
+  } else if (name == "message_memory_limit") {
+    send_closure(messages_manager_actor_, &MessagesManager::on_update_message_memory_limit);
+  } else if (name == "update_coalescing_delay_ms") {
+    update_coalescing_delay_ms_ = narrow_cast<int32>(G()->shared_config().get_option_integer(name));
+    if (update_coalescing_delay_ms_ <= 0) {
+      flush_pending_updates();
+    }
   } else if (name == "dice_emojis") {
     return send_closure(stickers_manager_actor_, &StickersManager::on_update_dice_emojis);
   } else if (name == "dice_success_values") {
@@ -4034,6 +4067,8 @@ void Td::clear() {
   LOG(DEBUG) << "ConfigManager was cleared" << timer;
   confirm_phone_number_manager_.reset();
   LOG(DEBUG) << "ConfirmPhoneNumberManager was cleared" << timer;
+  crypto_worker_.reset();
+  LOG(DEBUG) << "CryptoWorker was cleared" << timer;
   device_token_manager_.reset();
   LOG(DEBUG) << "DeviceTokenManager was cleared" << timer;
   hashtag_hints_.reset();
@@ -4118,6 +4153,7 @@ void Td::close_impl(bool destroy_flag) {
     G()->set_close_flag();
 
     request_actors_.clear();
+    abort_request_handlers();
     return send_closure_later(actor_id(this), &Td::dec_request_actor_refcnt);  // remove guard
   }
 
@@ -4126,8 +4162,15 @@ void Td::close_impl(bool destroy_flag) {
   G()->set_close_flag();
   send_closure(auth_manager_actor_, &AuthManager::on_closing, destroy_flag);
 
+  if (auth_manager_->is_authorized()) {
+    contacts_manager_->save_startup_snapshot();
+  }
+
   // wait till all request_actors will stop.
+  send_closure(net_stats_manager_, &NetStatsManager::save_pending_stats);
+
   request_actors_.clear();
+  abort_request_handlers();
   G()->td_db()->flush_all();
   send_closure_later(actor_id(this), &Td::dec_request_actor_refcnt);  // remove guard
 }
@@ -4181,21 +4224,37 @@ void Td::complete_pending_preauthentication_requests(const T &func) {
 }
 
 Status Td::init(DbKey key) {
-  auto current_scheduler_id = Scheduler::instance()->sched_id();
+  Timer timer;
+  auto worker_scheduler_id = td_options_.worker_scheduler_id;
+  if (worker_scheduler_id <= 0) {
+    worker_scheduler_id = Scheduler::instance()->sched_id() + 1;
+  }
   auto scheduler_count = Scheduler::instance()->sched_count();
 
+  auto db_scheduler_id = min(worker_scheduler_id, scheduler_count - 1);
+  // GC and slow network schedulers are mostly idle, so they can be used for long database queries
+  vector<int32> db_read_scheduler_ids;
+  for (auto read_scheduler_id : {worker_scheduler_id + 1, worker_scheduler_id + 2}) {
+    if (read_scheduler_id < scheduler_count && read_scheduler_id != db_scheduler_id) {
+      db_read_scheduler_ids.push_back(read_scheduler_id);
+    }
+  }
+
   VLOG(td_init) << "Begin to init database";
   TdDb::Events events;
-  auto r_td_db = TdDb::open(min(current_scheduler_id + 1, scheduler_count - 1), parameters_, std::move(key), events);
+  auto r_td_db = TdDb::open(db_scheduler_id, std::move(db_read_scheduler_ids), parameters_, std::move(key), events);
   if (r_td_db.is_error()) {
     return Status::Error(400, r_td_db.error().message());
   }
   LOG(INFO) << "Successfully inited database in " << tag("database_directory", parameters_.database_directory)
             << " and " << tag("files_directory", parameters_.files_directory);
-  VLOG(td_init) << "Successfully inited database";
+  VLOG(td_init) << "Successfully inited database" << timer;
 
-  G()->init(parameters_, actor_id(this), r_td_db.move_as_ok()).ensure();
+  G()->init(parameters_, actor_id(this), r_td_db.move_as_ok(), worker_scheduler_id).ensure();
   last_sent_server_time_difference_ = G()->get_server_time_difference();
+  crypto_worker_ = create_actor_on_scheduler<CryptoWorker>("CryptoWorker", G()->get_gc_scheduler_id(),
+                                                           create_reference());
+  G()->set_crypto_worker(crypto_worker_.get());
   send_update(td_api::make_object<td_api::updateOption>(
       "unix_time", td_api::make_object<td_api::optionValueInteger>(G()->unix_time())));
 
@@ -4240,10 +4299,10 @@ Status Td::init(DbKey key) {
   G()->set_my_id(static_cast<int32>(G()->shared_config().get_option_integer("my_id")));
 
   storage_manager_ = create_actor<StorageManager>("StorageManager", create_reference(),
-                                                  min(current_scheduler_id + 2, scheduler_count - 1));
+                                                  min(worker_scheduler_id + 1, scheduler_count - 1));
   G()->set_storage_manager(storage_manager_.get());
 
-  VLOG(td_init) << "Send binlog events";
+  VLOG(td_init) << "Send binlog events" << timer;
   for (auto &event : events.user_events) {
     contacts_manager_->on_binlog_user_event(std::move(event));
   }
@@ -4314,7 +4373,7 @@ Status Td::init(DbKey key) {
 
   complete_pending_preauthentication_requests([](int32 id) { return true; });
 
-  VLOG(td_init) << "Finish initialization";
+  VLOG(td_init) << "Finish initialization" << timer;
 
   state_ = State::Run;
   return Status::OK();
@@ -4341,6 +4400,8 @@ void Td::init_options_and_network() {
 
   VLOG(td_init) << "Create ConfigShared";
   G()->set_shared_config(td::make_unique<ConfigShared>(G()->td_db()->get_config_pmc_shared()));
+  update_coalescing_delay_ms_ =
+      narrow_cast<int32>(G()->shared_config().get_option_integer("update_coalescing_delay_ms"));
 
   if (G()->shared_config().have_option("language_database_path")) {
     G()->shared_config().set_option_string("language_pack_database_path",
@@ -4447,6 +4508,13 @@ void Td::init_file_manager() {
                    make_tl_object<td_api::updateFile>(td_->file_manager_->get_file_object(file_id)));
     }
 
+    void on_file_progress_updated(FileId file_id) final {
+      if (!G()->shared_config().get_option_boolean(ConfigShared::OptionId::UseCompactFileProgressUpdates)) {
+        return on_file_updated(file_id);
+      }
+      send_closure(G()->td(), &Td::send_update, td_->file_manager_->get_update_file_progress_object(file_id));
+    }
+
     bool add_file_source(FileId file_id, FileSourceId file_source_id) final {
       return td_->file_reference_manager_->add_file_source(file_id, file_source_id);
     }
@@ -4492,64 +4560,94 @@ void Td::init_file_manager() {
 
 void Td::init_managers() {
   VLOG(td_init) << "Create Managers";
+  Timer timer;
   audios_manager_ = make_unique<AudiosManager>(this);
+  VLOG(td_init) << "AudiosManager was created" << timer;
   callback_queries_manager_ = make_unique<CallbackQueriesManager>(this);
+  VLOG(td_init) << "CallbackQueriesManager was created" << timer;
   documents_manager_ = make_unique<DocumentsManager>(this);
+  VLOG(td_init) << "DocumentsManager was created" << timer;
   video_notes_manager_ = make_unique<VideoNotesManager>(this);
+  VLOG(td_init) << "VideoNotesManager was created" << timer;
   videos_manager_ = make_unique<VideosManager>(this);
+  VLOG(td_init) << "VideosManager was created" << timer;
   voice_notes_manager_ = make_unique<VoiceNotesManager>(this);
+  VLOG(td_init) << "VoiceNotesManager was created" << timer;
 
   animations_manager_ = make_unique<AnimationsManager>(this, create_reference());
   animations_manager_actor_ = register_actor("AnimationsManager", animations_manager_.get());
   G()->set_animations_manager(animations_manager_actor_.get());
+  VLOG(td_init) << "AnimationsManager was created" << timer;
   background_manager_ = make_unique<BackgroundManager>(this, create_reference());
   background_manager_actor_ = register_actor("BackgroundManager", background_manager_.get());
   G()->set_background_manager(background_manager_actor_.get());
+  VLOG(td_init) << "BackgroundManager was created" << timer;
   contacts_manager_ = make_unique<ContactsManager>(this, create_reference());
   contacts_manager_actor_ = register_actor("ContactsManager", contacts_manager_.get());
   G()->set_contacts_manager(contacts_manager_actor_.get());
+  VLOG(td_init) << "ContactsManager was created" << timer;
   country_info_manager_ = make_unique<CountryInfoManager>(this, create_reference());
   country_info_manager_actor_ = register_actor("CountryInfoManager", country_info_manager_.get());
+  VLOG(td_init) << "CountryInfoManager was created" << timer;
   inline_queries_manager_ = make_unique<InlineQueriesManager>(this, create_reference());
   inline_queries_manager_actor_ = register_actor("InlineQueriesManager", inline_queries_manager_.get());
+  VLOG(td_init) << "InlineQueriesManager was created" << timer;
   messages_manager_ = make_unique<MessagesManager>(this, create_reference());
   messages_manager_actor_ = register_actor("MessagesManager", messages_manager_.get());
   G()->set_messages_manager(messages_manager_actor_.get());
+  VLOG(td_init) << "MessagesManager was created" << timer;
   notification_manager_ = make_unique<NotificationManager>(this, create_reference());
   notification_manager_actor_ = register_actor("NotificationManager", notification_manager_.get());
+  VLOG(td_init) << "NotificationManager was created" << timer;
   poll_manager_ = make_unique<PollManager>(this, create_reference());
   poll_manager_actor_ = register_actor("PollManager", poll_manager_.get());
   G()->set_notification_manager(notification_manager_actor_.get());
+  VLOG(td_init) << "PollManager was created" << timer;
   stickers_manager_ = make_unique<StickersManager>(this, create_reference());
   stickers_manager_actor_ = register_actor("StickersManager", stickers_manager_.get());
   G()->set_stickers_manager(stickers_manager_actor_.get());
+  VLOG(td_init) << "StickersManager was created" << timer;
   updates_manager_ = make_unique<UpdatesManager>(this, create_reference());
   updates_manager_actor_ = register_actor("UpdatesManager", updates_manager_.get());
   G()->set_updates_manager(updates_manager_actor_.get());
+  VLOG(td_init) << "UpdatesManager was created" << timer;
   web_pages_manager_ = make_unique<WebPagesManager>(this, create_reference());
   web_pages_manager_actor_ = register_actor("WebPagesManager", web_pages_manager_.get());
   G()->set_web_pages_manager(web_pages_manager_actor_.get());
+  VLOG(td_init) << "WebPagesManager was created" << timer;
 
   call_manager_ = create_actor<CallManager>("CallManager", create_reference());
   G()->set_call_manager(call_manager_.get());
+  VLOG(td_init) << "CallManager was created" << timer;
   change_phone_number_manager_ = create_actor<PhoneNumberManager>(
       "ChangePhoneNumberManager", PhoneNumberManager::Type::ChangePhone, create_reference());
+  VLOG(td_init) << "ChangePhoneNumberManager was created" << timer;
   confirm_phone_number_manager_ = create_actor<PhoneNumberManager>(
       "ConfirmPhoneNumberManager", PhoneNumberManager::Type::ConfirmPhone, create_reference());
+  VLOG(td_init) << "ConfirmPhoneNumberManager was created" << timer;
   device_token_manager_ = create_actor<DeviceTokenManager>("DeviceTokenManager", create_reference());
+  VLOG(td_init) << "DeviceTokenManager was created" << timer;
   hashtag_hints_ = create_actor<HashtagHints>("HashtagHints", "text", create_reference());
+  VLOG(td_init) << "HashtagHints was created" << timer;
   language_pack_manager_ = create_actor<LanguagePackManager>("LanguagePackManager", create_reference());
   G()->set_language_pack_manager(language_pack_manager_.get());
+  VLOG(td_init) << "LanguagePackManager was created" << timer;
   password_manager_ = create_actor<PasswordManager>("PasswordManager", create_reference());
   G()->set_password_manager(password_manager_.get());
+  VLOG(td_init) << "PasswordManager was created" << timer;
   privacy_manager_ = create_actor<PrivacyManager>("PrivacyManager", create_reference());
+  VLOG(td_init) << "PrivacyManager was created" << timer;
   secret_chats_manager_ = create_actor<SecretChatsManager>("SecretChatsManager", create_reference());
   G()->set_secret_chats_manager(secret_chats_manager_.get());
+  VLOG(td_init) << "SecretChatsManager was created" << timer;
   secure_manager_ = create_actor<SecureManager>("SecureManager", create_reference());
+  VLOG(td_init) << "SecureManager was created" << timer;
   top_dialog_manager_ = create_actor<TopDialogManager>("TopDialogManager", create_reference());
   G()->set_top_dialog_manager(top_dialog_manager_.get());
+  VLOG(td_init) << "TopDialogManager was created" << timer;
   verify_phone_number_manager_ = create_actor<PhoneNumberManager>(
       "VerifyPhoneNumberManager", PhoneNumberManager::Type::VerifyPhone, create_reference());
+  VLOG(td_init) << "VerifyPhoneNumberManager was created" << timer;
 }
 
 void Td::send_update(tl_object_ptr<td_api::Update> &&object) {
@@ -4588,9 +4686,101 @@ void Td::send_update(tl_object_ptr<td_api::Update> &&object) {
       VLOG(td_requests) << "Sending update: " << to_string(object);
   }
 
+  if (update_coalescing_delay_ms_ > 0 && object_id != td_api::updateAuthorizationState::ID) {
+    return add_pending_update(std::move(object));
+  }
+
+  flush_pending_updates();
   callback_->on_result(0, std::move(object));
 }
 
+// returns key of the object, which state is fully described by the update, or {0, 0} if the update can't be coalesced
+static std::pair<int32, int64> get_update_coalescing_key(const td_api::Update *update) {
+  auto update_id = update->get_id();
+  switch (update_id) {
+    case td_api::updateUser::ID:
+      return {update_id, static_cast<const td_api::updateUser *>(update)->user_->id_};
+    case td_api::updateSupergroup::ID:
+      return {update_id, static_cast<const td_api::updateSupergroup *>(update)->supergroup_->id_};
+    case td_api::updateUserStatus::ID:
+      return {update_id, static_cast<const td_api::updateUserStatus *>(update)->user_id_};
+    case td_api::updateUserFullInfo::ID:
+      return {update_id, static_cast<const td_api::updateUserFullInfo *>(update)->user_id_};
+    case td_api::updateBasicGroupFullInfo::ID:
+      return {update_id, static_cast<const td_api::updateBasicGroupFullInfo *>(update)->basic_group_id_};
+    case td_api::updateSupergroupFullInfo::ID:
+      return {update_id, static_cast<const td_api::updateSupergroupFullInfo *>(update)->supergroup_id_};
+    case td_api::updateChatLastMessage::ID:
+      return {update_id, static_cast<const td_api::updateChatLastMessage *>(update)->chat_id_};
+    case td_api::updateChatReadInbox::ID:
+      return {update_id, static_cast<const td_api::updateChatReadInbox *>(update)->chat_id_};
+    case td_api::updateChatReadOutbox::ID:
+      return {update_id, static_cast<const td_api::updateChatReadOutbox *>(update)->chat_id_};
+    case td_api::updateChatUnreadMentionCount::ID:
+      return {update_id, static_cast<const td_api::updateChatUnreadMentionCount *>(update)->chat_id_};
+    case td_api::updateChatOnlineMemberCount::ID:
+      return {update_id, static_cast<const td_api::updateChatOnlineMemberCount *>(update)->chat_id_};
+    case td_api::updateFile::ID:
+      return {update_id, static_cast<const td_api::updateFile *>(update)->file_->id_};
+    case td_api::updateFileProgress::ID:
+      return {update_id, static_cast<const td_api::updateFileProgress *>(update)->file_id_};
+    default:
+      return {0, 0};
+  }
+}
+
+void Td::add_pending_update(td_api::object_ptr<td_api::Update> &&object) {
+  auto key = get_update_coalescing_key(object.get());
+  if (key.first != 0) {
+    auto it = pending_update_positions_.find(key);
+    if (it != pending_update_positions_.end()) {
+      auto &old_object = pending_updates_[it->second];
+      CHECK(old_object != nullptr);
+      if (key.first == td_api::updateUser::ID || key.first == td_api::updateSupergroup::ID) {
+        // other updates can reference the object, so the new state must be sent no later than the old one;
+        // the new user already contains the newest user status
+        if (key.first == td_api::updateUser::ID) {
+          auto status_it = pending_update_positions_.find({td_api::updateUserStatus::ID, key.second});
+          if (status_it != pending_update_positions_.end()) {
+            pending_updates_[status_it->second] = nullptr;
+            pending_update_positions_.erase(status_it);
+          }
+        }
+        old_object = std::move(object);
+        return;
+      }
+
+      // the update isn't referenced by other updates, but can reference other objects,
+      // so the old update is dropped and the new one is sent after all previously received updates
+      old_object = nullptr;
+      it->second = pending_updates_.size();
+    } else {
+      pending_update_positions_.emplace(key, pending_updates_.size());
+    }
+  }
+
+  if (pending_updates_.empty()) {
+    alarm_timeout_.set_timeout_in(FLUSH_UPDATES_ALARM_ID, update_coalescing_delay_ms_ * 1e-3);
+  }
+  pending_updates_.push_back(std::move(object));
+}
+
+void Td::flush_pending_updates() {
+  if (pending_updates_.empty()) {
+    return;
+  }
+
+  alarm_timeout_.cancel_timeout(FLUSH_UPDATES_ALARM_ID);
+  auto updates = std::move(pending_updates_);
+  pending_updates_.clear();
+  pending_update_positions_.clear();
+  for (auto &update : updates) {
+    if (update != nullptr) {
+      callback_->on_result(0, std::move(update));
+    }
+  }
+}
+
 void Td::send_result(uint64 id, tl_object_ptr<td_api::Object> object) {
   if (id == 0) {
     LOG(ERROR) << "Sending " << to_string(object) << " through send_result";
@@ -4604,6 +4794,8 @@ void Td::send_result(uint64 id, tl_object_ptr<td_api::Object> object) {
     if (object == nullptr) {
       object = make_tl_object<td_api::error>(404, "Not Found");
     }
+    // the result can reference objects from pending updates
+    flush_pending_updates();
     callback_->on_result(id, std::move(object));
   }
 }
@@ -4615,6 +4807,7 @@ void Td::send_error_impl(uint64 id, tl_object_ptr<td_api::error> error) {
   if (it != request_set_.end()) {
     request_set_.erase(it);
     VLOG(td_requests) << "Sending error for request " << id << ": " << oneline(to_string(error));
+    flush_pending_updates();
     callback_->on_error(id, std::move(error));
   }
 }
@@ -4646,6 +4839,27 @@ Promise<Unit> Td::create_ok_request_promise(uint64 id) {
   });
 }
 
+void Td::run_request_handler(unique_ptr<RequestHandlerBase> handler) {
+  auto handler_ptr = handler.get();
+  auto handler_id = request_handlers_.create(std::move(handler));
+  handler_ptr->handler_id_ = handler_id;
+
+  auto old_running_request_handler_id = running_request_handler_id_;
+  running_request_handler_id_ = handler_id;
+  bool is_finished = handler_ptr->run();
+  running_request_handler_id_ = old_running_request_handler_id;
+  if (is_finished) {
+    request_handlers_.erase(handler_id);
+  }
+}
+
+void Td::abort_request_handlers() {
+  for (auto handler_id : request_handlers_.ids()) {
+    auto handler = request_handlers_.extract(handler_id);
+    handler->abort();
+  }
+}
+
 #define CLEAN_INPUT_STRING(field_name)                                  \
   if (!clean_input_string(field_name)) {                                \
     return send_error_raw(id, 400, "Strings must be encoded in UTF-8"); \
@@ -4667,6 +4881,8 @@ Promise<Unit> Td::create_ok_request_promise(uint64 id) {
   auto slot_id = request_actors_.create(ActorOwn<>(), RequestActorIdType); \
   inc_request_actor_refcnt();                                              \
   *request_actors_.get(slot_id) = create_actor<name>(#name, actor_shared(this, slot_id), id, __VA_ARGS__);
+#define CREATE_NO_ARGS_REQUEST_HANDLER(name) run_request_handler(td::make_unique<name>(this, id))
+#define CREATE_REQUEST_HANDLER(name, ...) run_request_handler(td::make_unique<name>(this, id, __VA_ARGS__))
 #define CREATE_REQUEST_PROMISE() auto promise = create_request_promise<std::decay_t<decltype(request)>::ReturnType>(id)
 #define CREATE_OK_REQUEST_PROMISE()                                                                                    \
   static_assert(std::is_same<std::decay_t<decltype(request)>::ReturnType, td_api::object_ptr<td_api::ok>>::value, ""); \
@@ -5127,43 +5343,43 @@ void Td::on_request(uint64 id, const td_api::disconnectAllWebsites &request) {
 }
 
 void Td::on_request(uint64 id, const td_api::getMe &request) {
-  CREATE_NO_ARGS_REQUEST(GetMeRequest);
+  CREATE_NO_ARGS_REQUEST_HANDLER(GetMeRequest);
 }
 
 void Td::on_request(uint64 id, const td_api::getUser &request) {
-  CREATE_REQUEST(GetUserRequest, request.user_id_);
+  CREATE_REQUEST_HANDLER(GetUserRequest, request.user_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getUserFullInfo &request) {
-  CREATE_REQUEST(GetUserFullInfoRequest, request.user_id_);
+  CREATE_REQUEST_HANDLER(GetUserFullInfoRequest, request.user_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getBasicGroup &request) {
-  CREATE_REQUEST(GetGroupRequest, request.basic_group_id_);
+  CREATE_REQUEST_HANDLER(GetGroupRequest, request.basic_group_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getBasicGroupFullInfo &request) {
-  CREATE_REQUEST(GetGroupFullInfoRequest, request.basic_group_id_);
+  CREATE_REQUEST_HANDLER(GetGroupFullInfoRequest, request.basic_group_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getSupergroup &request) {
-  CREATE_REQUEST(GetSupergroupRequest, request.supergroup_id_);
+  CREATE_REQUEST_HANDLER(GetSupergroupRequest, request.supergroup_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getSupergroupFullInfo &request) {
-  CREATE_REQUEST(GetSupergroupFullInfoRequest, request.supergroup_id_);
+  CREATE_REQUEST_HANDLER(GetSupergroupFullInfoRequest, request.supergroup_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getSecretChat &request) {
-  CREATE_REQUEST(GetSecretChatRequest, request.secret_chat_id_);
+  CREATE_REQUEST_HANDLER(GetSecretChatRequest, request.secret_chat_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getChat &request) {
-  CREATE_REQUEST(GetChatRequest, request.chat_id_);
+  CREATE_REQUEST_HANDLER(GetChatRequest, request.chat_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getMessage &request) {
-  CREATE_REQUEST(GetMessageRequest, request.chat_id_, request.message_id_);
+  CREATE_REQUEST_HANDLER(GetMessageRequest, request.chat_id_, request.message_id_);
 }
 
 void Td::on_request(uint64 id, const td_api::getMessageLocally &request) {
@@ -5185,7 +5401,7 @@ void Td::on_request(uint64 id, const td_api::getCallbackQueryMessage &request) {
 }
 
 void Td::on_request(uint64 id, const td_api::getMessages &request) {
-  CREATE_REQUEST(GetMessagesRequest, request.chat_id_, request.message_ids_);
+  CREATE_REQUEST_HANDLER(GetMessagesRequest, request.chat_id_, request.message_ids_);
 }
 
 void Td::on_request(uint64 id, const td_api::getMessageThread &request) {
@@ -5265,6 +5481,31 @@ void Td::on_request(uint64 id, td_api::getDatabaseStatistics &request) {
   send_closure(storage_manager_, &StorageManager::get_database_stats, std::move(query_promise));
 }
 
+void Td::on_request(uint64 id, const td_api::compactDatabase &request) {
+  CREATE_OK_REQUEST_PROMISE();
+  G()->td_db()->compact_database(
+      [actor_id = actor_id(this)](int64 reclaimed_size, int64 total_size) {
+        send_closure(actor_id, &Td::send_update,
+                     td_api::make_object<td_api::updateDatabaseCompactionProgress>(reclaimed_size, total_size));
+      },
+      std::move(promise));
+}
+
+void Td::on_request(uint64 id, const td_api::getMemoryStatistics &request) {
+  vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> entries;
+  contacts_manager_->get_memory_statistics(entries);
+  file_manager_->get_memory_statistics(entries);
+  stickers_manager_->get_memory_statistics(entries);
+  LanguagePackManager::get_memory_statistics(entries);
+  // buffers and SQLite page caches are shared between all TDLib instances
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "buffers", 0, static_cast<int64>(BufferAllocator::get_buffer_mem() + BufferAllocator::get_cached_buffer_mem())));
+  entries.push_back(
+      td_api::make_object<td_api::memoryStatisticsEntry>("database page cache", 0, SqliteDb::get_total_cache_size()));
+  messages_manager_->get_memory_statistics(entries, request.full_);
+  send_result(id, messages_manager_->get_memory_statistics_object(std::move(entries)));
+}
+
 void Td::on_request(uint64 id, td_api::optimizeStorage &request) {
   std::vector<FileType> file_types;
   for (auto &file_type : request.file_types_) {
@@ -5438,8 +5679,8 @@ void Td::on_request(uint64 id, const td_api::removeTopChat &request) {
 
 void Td::on_request(uint64 id, const td_api::getChats &request) {
   CHECK_IS_USER();
-  CREATE_REQUEST(GetChatsRequest, DialogListId(request.chat_list_), request.offset_order_, request.offset_chat_id_,
-                 request.limit_);
+  CREATE_REQUEST_HANDLER(GetChatsRequest, DialogListId(request.chat_list_), request.offset_order_,
+                         request.offset_chat_id_, request.limit_);
 }
 
 void Td::on_request(uint64 id, td_api::searchPublicChat &request) {
@@ -5553,8 +5794,8 @@ void Td::on_request(uint64 id, const td_api::openMessageContent &request) {
 
 void Td::on_request(uint64 id, const td_api::getChatHistory &request) {
   CHECK_IS_USER();
-  CREATE_REQUEST(GetChatHistoryRequest, request.chat_id_, request.from_message_id_, request.offset_, request.limit_,
-                 request.only_local_);
+  CREATE_REQUEST_HANDLER(GetChatHistoryRequest, request.chat_id_, request.from_message_id_, request.offset_,
+                         request.limit_, request.only_local_);
 }
 
 void Td::on_request(uint64 id, const td_api::deleteChatHistory &request) {
@@ -6386,6 +6627,25 @@ void Td::on_request(uint64 id, const td_api::getFileDownloadedPrefixSize &reques
                td_api::make_object<td_api::count>(narrow_cast<int32>(file_view.downloaded_prefix(request.offset_))));
 }
 
+void Td::on_request(uint64 id, const td_api::setFileStreamingPosition &request) {
+  if (request.offset_ < 0) {
+    return send_error_raw(id, 5, "Streaming position must be non-negative");
+  }
+  if (request.bitrate_ < 0) {
+    return send_error_raw(id, 5, "Bitrate must be non-negative");
+  }
+
+  FileId file_id(request.file_id_, 0);
+  auto file_view = file_manager_->get_file_view(file_id);
+  if (file_view.empty()) {
+    return send_error_raw(id, 400, "Invalid file identifier");
+  }
+
+  file_manager_->update_streaming_position(file_id, download_file_callback_, request.offset_, request.bitrate_);
+
+  send_closure(actor_id(this), &Td::send_result, id, make_tl_object<td_api::ok>());
+}
+
 void Td::on_request(uint64 id, const td_api::cancelDownloadFile &request) {
   file_manager_->download(FileId(request.file_id_, 0), nullptr, request.only_if_pending_ ? -1 : 0, -1, -1);
 
@@ -7161,7 +7421,21 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
         return;
       }
       break;
+    case 'b':
+      if (set_integer_option("binlog_event_compression_min_size", 0, BinlogEvent::MAX_SIZE)) {
+        return;
+      }
+      break;
     case 'c':
+      if (set_integer_option("channel_difference_concurrency_max", 1, 1000)) {
+        return;
+      }
+      if (!is_bot && set_integer_option("chat_history_prefetch_count", 0, 100)) {
+        return;
+      }
+      if (!is_bot && set_integer_option("chat_list_preload_limit")) {
+        return;
+      }
       if (!is_bot && set_string_option("connection_parameters", [](Slice value) {
             string value_copy = value.str();
             auto r_json_value = get_json_value(value_copy);
@@ -7189,6 +7463,9 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       if (set_boolean_option("disable_time_adjustment_protection")) {
         return;
       }
+      if (set_boolean_option("deduplicate_downloaded_files")) {
+        return;
+      }
       if (request.name_ == "drop_notification_ids") {
         G()->td_db()->get_binlog_pmc()->erase("notification_id_current");
         G()->td_db()->get_binlog_pmc()->erase("notification_group_id_current");
@@ -7209,6 +7486,9 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       if (set_boolean_option("ignore_platform_restrictions")) {
         return;
       }
+      if (!is_bot && set_integer_option("inline_query_results_cache_size_max")) {
+        return;
+      }
       if (set_boolean_option("is_emulator")) {
         return;
       }
@@ -7247,9 +7527,28 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       }
       break;
     case 'm':
+      if (set_integer_option("message_memory_limit", 0, std::numeric_limits<int64>::max())) {
+        return;
+      }
       if (set_integer_option("message_unload_delay", 60, 86400)) {
         return;
       }
+      if (request.name_ == "memory_profiler_sampling_rate") {
+        // the option isn't persistent and is applied only to the memory profiler of the current process
+        if (value_constructor_id != td_api::optionValueInteger::ID &&
+            value_constructor_id != td_api::optionValueEmpty::ID) {
+          return send_error_raw(id, 3, "Option \"memory_profiler_sampling_rate\" must have integer value");
+        }
+        int64 sampling_rate = 0;
+        if (value_constructor_id == td_api::optionValueInteger::ID) {
+          sampling_rate = static_cast<td_api::optionValueInteger *>(request.value_.get())->value_;
+          if (sampling_rate < 0) {
+            return send_error_raw(id, 3, "Option \"memory_profiler_sampling_rate\" must be non-negative");
+          }
+        }
+        set_memprof_sampling_rate(static_cast<size_t>(sampling_rate));
+        return send_closure(actor_id(this), &Td::send_result, id, make_tl_object<td_api::ok>());
+      }
       break;
     case 'n':
       if (!is_bot &&
@@ -7288,17 +7587,46 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
         send_closure(state_manager_, &StateManager::on_network_updated);
         return;
       }
+      if (set_boolean_option("proxy_auto_failover")) {
+        return;
+      }
+      break;
+    case 'q':
+      if (set_integer_option("query_packing_delay", 0, 1000)) {
+        return;
+      }
+      if (set_integer_option("query_packing_size_max", 1, mtproto::SessionConnection::MAX_CONTAINER_SIZE)) {
+        return;
+      }
+      if (set_integer_option("query_packing_count_max", 1, mtproto::SessionConnection::MAX_CONTAINER_QUERY_COUNT)) {
+        return;
+      }
+      if (set_integer_option("query_rate_limit_per_dc", 0, 1000000)) {
+        return;
+      }
+      if (set_integer_option("query_rate_limit_per_function", 0, 1000000)) {
+        return;
+      }
       break;
     case 'r':
       // temporary option
+      if (set_boolean_option("reuse_uploaded_files_by_hash")) {
+        return;
+      }
       if (set_boolean_option("reuse_uploaded_photos_by_hash")) {
         return;
       }
       break;
     case 's':
+      if (set_string_option("shared_files_cache_directory", [](Slice value) { return true; })) {
+        return;
+      }
       if (set_integer_option("session_count", 0, 50)) {
         return;
       }
+      if (set_integer_option("session_count_max", 0, 50)) {
+        return;
+      }
       if (set_integer_option("storage_max_files_size")) {
         return;
       }
@@ -7311,6 +7639,11 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       if (set_integer_option("storage_immunity_delay")) {
         return;
       }
+      if (set_string_option("storage_profile", [](Slice value) {
+            return value == "default" || value == "mobile_low_memory" || value == "server_throughput";
+          })) {
+        return;
+      }
       if (set_boolean_option("store_all_files_in_files_directory")) {
         return;
       }
@@ -7347,15 +7680,44 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       return send_closure(actor_id(this), &Td::send_result, id, make_tl_object<td_api::ok>());
     }
     case 'u':
+      if (set_integer_option("update_coalescing_delay_ms", 0, 1000)) {
+        return;
+      }
+      if (set_integer_option("update_file_progress_delay_ms", 0, 10000)) {
+        return;
+      }
+      if (set_integer_option("update_file_progress_min_size")) {
+        return;
+      }
+      if (set_boolean_option("use_compact_file_progress_updates")) {
+        return;
+      }
+      if (!is_bot && set_boolean_option("use_dc_authorization_warmup")) {
+        return;
+      }
       if (set_boolean_option("use_pfs")) {
         return;
       }
       if (set_boolean_option("use_quick_ack")) {
         return;
       }
+      if (set_boolean_option("use_shared_sticker_set_cache")) {
+        return;
+      }
+      if (!is_bot && set_boolean_option("use_startup_snapshot")) {
+        return;
+      }
       if (set_boolean_option("use_storage_optimizer")) {
         return;
       }
+      if (set_boolean_option("use_tcp_fast_open")) {
+        return;
+      }
+      break;
+    case 'w':
+      if (set_integer_option("web_page_instant_view_cache_size_max")) {
+        return;
+      }
       break;
   }
 
@@ -7993,6 +8355,65 @@ void Td::on_request(uint64 id, const td_api::addLogMessage &request) {
   UNREACHABLE();
 }
 
+void Td::on_request(uint64 id, const td_api::toggleActorStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getActorStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::toggleDatabaseQueryStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getDatabaseQueryStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getQueryPackingStatistics &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getNetworkQueryStatistics &request) {
+  auto net_query_stats = G()->net_query_creator().get_net_query_stats();
+  if (net_query_stats == nullptr) {
+    return send_error_raw(id, 400, "Network query statistics are unavailable");
+  }
+
+  auto get_stage_statistics_object = [](Slice stage, const NetQueryStats::Histogram &histogram) {
+    return td_api::make_object<td_api::networkQueryStageStatistics>(
+        stage.str(), static_cast<int64>(histogram.get_count()), histogram.get_total(), histogram.get_percentile(50),
+        histogram.get_percentile(90), histogram.get_percentile(99), histogram.get_max());
+  };
+  auto result = td_api::make_object<td_api::networkQueryStatistics>();
+  for (auto &function_stats : net_query_stats->get_function_stats(request.reset_)) {
+    auto by_function = td_api::make_object<td_api::networkQueryStatisticsByFunction>();
+    by_function->dc_id_ = function_stats.dc_id;
+    by_function->function_id_ = function_stats.tl_constructor;
+    for (size_t i = 0; i < NetQueryStats::STAGE_COUNT; i++) {
+      auto &histogram = function_stats.stages[i];
+      if (histogram.get_count() != 0) {
+        by_function->stages_.push_back(get_stage_statistics_object(
+            NetQueryStats::get_stage_name(static_cast<NetQueryStats::Stage>(i)), histogram));
+      }
+    }
+    by_function->stages_.push_back(get_stage_statistics_object("total", function_stats.total));
+    result->by_function_.push_back(std::move(by_function));
+  }
+  result->interactive_queue_size_ =
+      static_cast<int64>(net_query_stats->get_queued_query_count(NetQueryStats::QueryClass::Interactive));
+  result->default_queue_size_ =
+      static_cast<int64>(net_query_stats->get_queued_query_count(NetQueryStats::QueryClass::Default));
+  result->background_queue_size_ =
+      static_cast<int64>(net_query_stats->get_queued_query_count(NetQueryStats::QueryClass::Background));
+  auto cache_statistics = G()->net_query_dispatcher().get_query_cache_statistics(request.reset_);
+  result->cache_hit_count_ = static_cast<int64>(cache_statistics.hit_count);
+  result->coalesced_query_count_ = static_cast<int64>(cache_statistics.coalesced_count);
+  result->cache_miss_count_ = static_cast<int64>(cache_statistics.miss_count);
+  send_result(id, std::move(result));
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getTextEntities &request) {
   if (!check_utf8(request.text_)) {
     return make_error(400, "Text must be encoded in UTF-8");
@@ -8191,6 +8612,57 @@ td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::addLogMes
   return td_api::make_object<td_api::ok>();
 }
 
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::toggleActorStatistics &request) {
+  ActorStats::set_enabled(request.is_enabled_, request.log_period_);
+  PerfCounters::set_enabled(request.is_enabled_ && request.need_hardware_counters_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getActorStatistics &request) {
+  auto stats = ActorStats::get_all(request.reset_);
+  auto result = td_api::make_object<td_api::actorStatistics>();
+  for (auto &stat : stats) {
+    result->by_name_.push_back(td_api::make_object<td_api::actorStatisticsByName>(
+        stat.name, static_cast<int64>(stat.event_count), stat.total_time, stat.max_event_time,
+        narrow_cast<int32>(td::min(stat.max_mailbox_size, static_cast<size_t>(std::numeric_limits<int32>::max()))),
+        static_cast<int64>(stat.counters.cycles), static_cast<int64>(stat.counters.instructions),
+        static_cast<int64>(stat.counters.cache_misses), static_cast<int64>(stat.counters.context_switches)));
+  }
+  return std::move(result);
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::toggleDatabaseQueryStatistics &request) {
+  SqliteStatement::set_profiling_enabled(request.is_enabled_, request.slow_query_threshold_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getDatabaseQueryStatistics &request) {
+  auto stats = SqliteStatement::get_profiling_stats(request.reset_);
+  auto result = td_api::make_object<td_api::databaseQueryStatistics>();
+  for (auto &stat : stats) {
+    result->by_statement_.push_back(td_api::make_object<td_api::databaseQueryStatisticsByStatement>(
+        stat.sql, stat.execution_count, stat.row_count, stat.total_time, stat.max_time, stat.cache_miss_count,
+        stat.full_scan_step_count, stat.sort_count, stat.auto_index_count));
+  }
+  return std::move(result);
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getQueryPackingStatistics &request) {
+  auto stats = mtproto::SessionConnection::get_packing_stats(request.reset_);
+  double average_fill_ratio = 0.0;
+  double average_send_delay = 0.0;
+  if (stats.packet_count != 0) {
+    average_fill_ratio = static_cast<double>(stats.query_size) /
+                         (static_cast<double>(stats.packet_count) * mtproto::SessionConnection::MAX_CONTAINER_SIZE);
+  }
+  if (stats.query_count != 0) {
+    average_send_delay = stats.total_send_delay / static_cast<double>(stats.query_count);
+  }
+  return td_api::make_object<td_api::queryPackingStatistics>(
+      static_cast<int64>(stats.packet_count), static_cast<int64>(stats.query_count),
+      static_cast<int64>(stats.query_size), average_fill_ratio, average_send_delay, stats.max_send_delay);
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(td_api::testReturnError &request) {
   if (request.error_ == nullptr) {
     return td_api::make_object<td_api::error>(404, "Not Found");
@@ -31,6 +31,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -47,6 +48,7 @@ class CallbackQueriesManager;
 class ConfigManager;
 class ContactsManager;
 class CountryInfoManager;
+class CryptoWorker;
 class DeviceTokenManager;
 class DocumentsManager;
 class FileManager;
@@ -61,6 +63,7 @@ class PasswordManager;
 class PhoneNumberManager;
 class PollManager;
 class PrivacyManager;
+class RequestHandlerBase;
 class SecureManager;
 class SecretChatsManager;
 class StickersManager;
@@ -98,6 +101,9 @@ class Td final : public NetQueryCallback {
 
   struct Options {
     std::shared_ptr<NetQueryStats> net_query_stats;
+    // the first scheduler used for database access, network and other auxiliary work;
+    // if 0, the scheduler following the scheduler of Td is used
+    int32 worker_scheduler_id = 0;
   };
 
   Td(unique_ptr<TdCallback> callback, Options options);
@@ -176,6 +182,7 @@ class Td final : public NetQueryCallback {
   ActorOwn<PhoneNumberManager> change_phone_number_manager_;
   ActorOwn<ConfigManager> config_manager_;
   ActorOwn<PhoneNumberManager> confirm_phone_number_manager_;
+  ActorOwn<CryptoWorker> crypto_worker_;
   ActorOwn<DeviceTokenManager> device_token_manager_;
   ActorOwn<HashtagHints> hashtag_hints_;
   ActorOwn<LanguagePackManager> language_pack_manager_;
@@ -238,6 +245,7 @@ class Td final : public NetQueryCallback {
   static constexpr int32 PING_SERVER_TIMEOUT = 300;
   static constexpr int64 TERMS_OF_SERVICE_ALARM_ID = -2;
   static constexpr int64 PROMO_DATA_ALARM_ID = -3;
+  static constexpr int64 FLUSH_UPDATES_ALARM_ID = -4;
 
   void on_connection_state_changed(StateManager::State new_state);
 
@@ -282,6 +290,8 @@ class Td final : public NetQueryCallback {
   vector<std::pair<uint64, std::shared_ptr<ResultHandler>>> result_handlers_;
   enum : int8 { RequestActorIdType = 1, ActorIdType = 2 };
   Container<ActorOwn<Actor>> request_actors_;
+  Container<unique_ptr<RequestHandlerBase>> request_handlers_;
+  uint64 running_request_handler_id_ = 0;
 
   bool is_online_ = false;
   NetQueryRef update_status_query_;
@@ -290,6 +300,11 @@ class Td final : public NetQueryCallback {
   std::unordered_map<int64, uint64> pending_alarms_;
   MultiTimeout alarm_timeout_{"AlarmTimeout"};
 
+  // updates, which wait for coalescing; superseded updates are replaced with nullptr
+  int32 update_coalescing_delay_ms_ = 0;
+  vector<td_api::object_ptr<td_api::Update>> pending_updates_;
+  std::map<std::pair<int32, int64>, size_t> pending_update_positions_;  // update key -> position in pending_updates_
+
   TermsOfService pending_terms_of_service_;
 
   double last_sent_server_time_difference_ = 1e100;
@@ -311,6 +326,10 @@ class Td final : public NetQueryCallback {
   static void on_alarm_timeout_callback(void *td_ptr, int64 alarm_id);
   void on_alarm_timeout(int64 alarm_id);
 
+  void add_pending_update(td_api::object_ptr<td_api::Update> &&object);
+
+  void flush_pending_updates();
+
   td_api::object_ptr<td_api::updateTermsOfService> get_update_terms_of_service_object() const;
 
   void on_get_terms_of_service(Result<std::pair<int32, TermsOfService>> result, bool dummy);
@@ -323,6 +342,12 @@ class Td final : public NetQueryCallback {
   friend class AuthManager;         // uses send_result/send_error, TODO pass Promise<>
   friend class PhoneNumberManager;  // uses send_result/send_error, TODO pass Promise<>
 
+  friend class RequestHandlerBase;  // uses send_result/send_error
+  template <class T>
+  friend class RequestHandler;  // uses create_request_handler_promise
+  template <class T>
+  friend class RequestHandlerPromise;  // uses running_request_handler_id_ and on_request_handler_result
+
   void add_handler(uint64 id, std::shared_ptr<ResultHandler> handler);
   std::shared_ptr<ResultHandler> extract_handler(uint64 id);
   void invalidate_handler(ResultHandler *handler);
@@ -368,6 +393,16 @@ class Td final : public NetQueryCallback {
 
   Promise<Unit> create_ok_request_promise(uint64 id);
 
+  void run_request_handler(unique_ptr<RequestHandlerBase> handler);
+
+  void abort_request_handlers();
+
+  template <class T>
+  Promise<T> create_request_handler_promise(uint64 handler_id);
+
+  template <class T>
+  void on_request_handler_result(uint64 handler_id, Result<T> &&result);
+
   static bool is_authentication_request(int32 id);
 
   static bool is_synchronous_request(int32 id);
@@ -515,6 +550,10 @@ class Td final : public NetQueryCallback {
 
   void on_request(uint64 id, td_api::getDatabaseStatistics &request);
 
+  void on_request(uint64 id, const td_api::compactDatabase &request);
+
+  void on_request(uint64 id, const td_api::getMemoryStatistics &request);
+
   void on_request(uint64 id, td_api::optimizeStorage &request);
 
   void on_request(uint64 id, td_api::getNetworkStatistics &request);
@@ -775,6 +814,8 @@ class Td final : public NetQueryCallback {
 
   void on_request(uint64 id, const td_api::getFileDownloadedPrefixSize &request);
 
+  void on_request(uint64 id, const td_api::setFileStreamingPosition &request);
+
   void on_request(uint64 id, const td_api::cancelDownloadFile &request);
 
   void on_request(uint64 id, td_api::uploadFile &request);
@@ -1133,6 +1174,18 @@ class Td final : public NetQueryCallback {
 
   void on_request(uint64 id, const td_api::addLogMessage &request);
 
+  void on_request(uint64 id, const td_api::toggleActorStatistics &request);
+
+  void on_request(uint64 id, const td_api::getActorStatistics &request);
+
+  void on_request(uint64 id, const td_api::toggleDatabaseQueryStatistics &request);
+
+  void on_request(uint64 id, const td_api::getDatabaseQueryStatistics &request);
+
+  void on_request(uint64 id, const td_api::getQueryPackingStatistics &request);
+
+  void on_request(uint64 id, const td_api::getNetworkQueryStatistics &request);
+
   // test
   void on_request(uint64 id, const td_api::testNetwork &request);
   void on_request(uint64 id, td_api::testProxy &request);
@@ -1172,6 +1225,11 @@ class Td final : public NetQueryCallback {
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::addLogMessage &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::toggleActorStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getActorStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::toggleDatabaseQueryStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getDatabaseQueryStatistics &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getQueryPackingStatistics &request);
   static td_api::object_ptr<td_api::Object> do_static_request(td_api::testReturnError &request);
 
   static DbKey as_db_key(string key);
@@ -25,6 +25,7 @@
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueAsync.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteWalCheckpointer.h"
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
@@ -32,7 +33,9 @@
 #include "td/utils/misc.h"
 #include "td/utils/port/path.h"
 #include "td/utils/Random.h"
+#include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Timer.h"
 
 #include <algorithm>
 
@@ -140,17 +143,55 @@ Status init_binlog(Binlog &binlog, string path, BinlogKeyValue<Binlog> &binlog_p
   return Status::OK();
 }
 
-Status init_db(SqliteDb &db) {
+Status init_db(SqliteDb &db, const SqliteDb::PerformanceSettings &performance_settings) {
   TRY_STATUS(db.exec("PRAGMA encoding=\"UTF-8\""));
+  // applied only to new databases; existing databases are switched by the next full VACUUM
+  TRY_STATUS(db.exec("PRAGMA auto_vacuum=INCREMENTAL"));
   TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
 
   TRY_STATUS(db.exec("PRAGMA synchronous=NORMAL"));
   TRY_STATUS(db.exec("PRAGMA temp_store=MEMORY"));
-  TRY_STATUS(db.exec("PRAGMA secure_delete=1"));
+  // delete triggers must be fired also for rows replaced by INSERT OR REPLACE, as on all other connections
+  TRY_STATUS(db.exec("PRAGMA recursive_triggers=1"));
+  TRY_STATUS(db.apply_performance_settings(performance_settings));
 
   return Status::OK();
 }
 
+struct StorageProfile {
+  SqliteDb::PerformanceSettings performance_settings;
+  double wal_checkpoint_period = 1.0;
+};
+
+// WAL is checkpointed by SqliteWalCheckpointer; automatic checkpoints are left only as a safety net
+// in case the checkpointer can't keep up with writers
+StorageProfile get_storage_profile(Slice name) {
+  StorageProfile profile;
+  auto &settings = profile.performance_settings;
+  if (name == "mobile_low_memory") {
+    settings.cache_size_kb = 512;
+    settings.mmap_size = 0;
+    settings.secure_delete = true;
+    settings.wal_autocheckpoint = 2000;
+    profile.wal_checkpoint_period = 0.5;
+  } else if (name == "server_throughput") {
+    settings.cache_size_kb = 64 << 10;
+    settings.mmap_size = static_cast<int64>(256) << 20;
+    settings.secure_delete = false;
+    settings.wal_autocheckpoint = 50000;
+    profile.wal_checkpoint_period = 2.0;
+  } else {
+    if (!name.empty() && name != "default") {
+      LOG(ERROR) << "Unsupported storage profile \"" << name << '"';
+    }
+    settings.cache_size_kb = 2000;
+    settings.mmap_size = 0;
+    settings.secure_delete = true;
+    settings.wal_autocheckpoint = 10000;
+  }
+  return profile;
+}
+
 }  // namespace
 
 std::shared_ptr<FileDbInterface> TdDb::get_file_db_shared() {
@@ -251,6 +292,10 @@ void TdDb::do_close(Promise<> on_finished, bool destroy_flag) {
       }));
   auto lock = mpas.get_promise();
 
+  if (!wal_checkpointer_.empty()) {
+    send_closure(wal_checkpointer_.release(), &SqliteWalCheckpointer::close, mpas.get_promise());
+  }
+
   if (file_db_) {
     file_db_->close(mpas.get_promise());
     file_db_.reset();
@@ -288,7 +333,7 @@ void TdDb::do_close(Promise<> on_finished, bool destroy_flag) {
 }
 
 Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, DbKey key, DbKey old_key,
-                         BinlogKeyValue<Binlog> &binlog_pmc) {
+                         Slice storage_profile_name, BinlogKeyValue<Binlog> &binlog_pmc) {
   CHECK(!parameters.use_message_db || parameters.use_chat_info_db);
   CHECK(!parameters.use_chat_info_db || parameters.use_file_db);
 
@@ -303,13 +348,26 @@ Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, DbK
     return Status::OK();
   }
 
+  auto storage_profile = get_storage_profile(storage_profile_name);
+
   sqlite_path_ = sql_database_path;
   TRY_RESULT(db_instance, SqliteDb::change_key(sqlite_path_, key, old_key));
-  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version());
+  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version(),
+                                                           storage_profile.performance_settings);
   sql_connection_->set(std::move(db_instance));
   auto &db = sql_connection_->get();
 
-  TRY_STATUS(init_db(db));
+  TRY_STATUS(init_db(db, storage_profile.performance_settings));
+
+  if (binlog_pmc.get("sqlite_need_vacuum") == "1") {
+    // full VACUUM blocks all other connections, so it is done only here before they are created
+    PerfWarningTimer timer("Vacuum SQLite database", 0.1);
+    auto status = db.exec("VACUUM");
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to vacuum database: " << status;
+    }
+    binlog_pmc.erase("sqlite_need_vacuum");
+  }
 
   // Init databases
   // Do initialization once and before everything else to avoid "database is locked" error.
@@ -378,9 +436,14 @@ Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, DbK
 
   if (use_message_db) {
     messages_db_sync_safe_ = create_messages_db_sync(sql_connection_);
-    messages_db_async_ = create_messages_db_async(messages_db_sync_safe_, scheduler_id);
+    messages_db_async_ = create_messages_db_async(messages_db_sync_safe_, scheduler_id, read_scheduler_ids_);
   }
 
+  // the checkpointer must use a connection different from the connection of the writer
+  auto checkpointer_scheduler_id = read_scheduler_ids_.empty() ? -1 : read_scheduler_ids_.back();
+  wal_checkpointer_ = create_actor_on_scheduler<SqliteWalCheckpointer>(
+      "SqliteWalCheckpointer", checkpointer_scheduler_id, sql_connection_, storage_profile.wal_checkpoint_period);
+
   return Status::OK();
 }
 
@@ -423,8 +486,17 @@ Status TdDb::init(int32 scheduler_id, const TdParameters &parameters, DbKey key,
       drop_sqlite_key = true;
     }
   }
+  // storage profile is applied only when the database is opened
+  string storage_profile_name = config_pmc->get("storage_profile");
+  if (!storage_profile_name.empty() && storage_profile_name[0] == 'S') {
+    storage_profile_name = storage_profile_name.substr(1);
+  } else {
+    storage_profile_name.clear();
+  }
+
   VLOG(td_init) << "Start to init database";
-  auto init_sqlite_status = init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc);
+  auto init_sqlite_status =
+      init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, storage_profile_name, *binlog_pmc);
   VLOG(td_init) << "Finish to init database";
   if (init_sqlite_status.is_error()) {
     LOG(ERROR) << "Destroy bad SQLite database because of " << init_sqlite_status;
@@ -432,7 +504,8 @@ Status TdDb::init(int32 scheduler_id, const TdParameters &parameters, DbKey key,
       sql_connection_->get().close();
     }
     SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
-    TRY_STATUS(init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc));
+    TRY_STATUS(
+        init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, storage_profile_name, *binlog_pmc));
   }
   if (drop_sqlite_key) {
     binlog_pmc->erase("sqlite_key");
@@ -472,8 +545,10 @@ Status TdDb::init(int32 scheduler_id, const TdParameters &parameters, DbKey key,
 TdDb::TdDb() = default;
 TdDb::~TdDb() = default;
 
-Result<unique_ptr<TdDb>> TdDb::open(int32 scheduler_id, const TdParameters &parameters, DbKey key, Events &events) {
+Result<unique_ptr<TdDb>> TdDb::open(int32 scheduler_id, vector<int32> read_scheduler_ids,
+                                     const TdParameters &parameters, DbKey key, Events &events) {
   auto db = make_unique<TdDb>();
+  db->read_scheduler_ids_ = std::move(read_scheduler_ids);
   TRY_STATUS(db->init(scheduler_id, parameters, std::move(key), events));
   return std::move(db);
 }
@@ -497,6 +572,20 @@ void TdDb::with_db_path(std::function<void(CSlice)> callback) {
   callback(binlog_path());
 }
 
+void TdDb::compact_database(std::function<void(int64, int64)> on_progress, Promise<> promise) {
+  if (wal_checkpointer_.empty()) {
+    return promise.set_error(Status::Error(400, "Database is not used"));
+  }
+
+  TRY_RESULT_PROMISE(promise, auto_vacuum, sql_connection_->get().get_pragma_int64("auto_vacuum"));
+  if (auto_vacuum != 2) {
+    // the database was created without incremental auto_vacuum, so it must be fully rebuilt on the next start
+    binlog_pmc_->set("sqlite_need_vacuum", "1");
+    return promise.set_value(Unit());
+  }
+  send_closure(wal_checkpointer_, &SqliteWalCheckpointer::compact, std::move(on_progress), std::move(promise));
+}
+
 Result<string> TdDb::get_stats() {
   auto sb = StringBuilder({}, true);
   auto &sql = sql_connection_->get();
@@ -533,6 +622,13 @@ Result<string> TdDb::get_stats() {
   TRY_STATUS(run_kv_query("ss%"));
   TRY_STATUS(run_kv_query("gr%"));
 
+  if (common_kv_async_ != nullptr) {
+    auto kv_stats = common_kv_async_->get_stats();
+    sb << "common async writes:\n";
+    sb << kv_stats.write_count << " requests\t" << kv_stats.coalesced_write_count << " coalesced\t"
+       << kv_stats.flush_count << " flushes\t" << kv_stats.flushed_key_count << " keys\n";
+  }
+
   vector<int32> prev(1);
   size_t count = 0;
   int32 max_bad_to = 0;
@@ -13,6 +13,7 @@
 #include "td/db/DbKey.h"
 #include "td/db/KeyValueSyncInterface.h"
 
+#include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
 #include "td/utils/Slice.h"
@@ -38,6 +39,7 @@ class SqliteConnectionSafe;
 class SqliteKeyValueSafe;
 class SqliteKeyValueAsyncInterface;
 class SqliteKeyValue;
+class SqliteWalCheckpointer;
 
 class TdDb {
  public:
@@ -59,7 +61,9 @@ class TdDb {
     vector<BinlogEvent> to_messages_manager;
     vector<BinlogEvent> to_notification_manager;
   };
-  static Result<unique_ptr<TdDb>> open(int32 scheduler_id, const TdParameters &parameters, DbKey key, Events &events);
+  // read_scheduler_ids are used for long read-only database queries
+  static Result<unique_ptr<TdDb>> open(int32 scheduler_id, vector<int32> read_scheduler_ids,
+                                       const TdParameters &parameters, DbKey key, Events &events);
 
   struct EncryptionInfo {
     bool is_encrypted{false};
@@ -99,6 +103,9 @@ class TdDb {
 
   void with_db_path(std::function<void(CSlice)> callback);
 
+  // returns free pages of the database to the file system, reporting reclaimed and total size in bytes
+  void compact_database(std::function<void(int64, int64)> on_progress, Promise<> promise);
+
   Result<string> get_stats();
 
  private:
@@ -116,13 +123,17 @@ class TdDb {
   std::shared_ptr<DialogDbSyncSafeInterface> dialog_db_sync_safe_;
   std::shared_ptr<DialogDbAsyncInterface> dialog_db_async_;
 
+  ActorOwn<SqliteWalCheckpointer> wal_checkpointer_;
+
   std::shared_ptr<BinlogKeyValue<ConcurrentBinlog>> binlog_pmc_;
   std::shared_ptr<BinlogKeyValue<ConcurrentBinlog>> config_pmc_;
   std::shared_ptr<ConcurrentBinlog> binlog_;
 
+  vector<int32> read_scheduler_ids_;
+
   Status init(int32 scheduler_id, const TdParameters &parameters, DbKey key, Events &events);
   Status init_sqlite(int32 scheduler_id, const TdParameters &parameters, DbKey key, DbKey old_key,
-                     BinlogKeyValue<Binlog> &binlog_pmc);
+                     Slice storage_profile_name, BinlogKeyValue<Binlog> &binlog_pmc);
 
   void do_close(Promise<> on_finished, bool destroy_flag);
 };
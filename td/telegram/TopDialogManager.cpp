@@ -32,7 +32,6 @@
 
 #include <algorithm>
 #include <cmath>
-#include <iterator>
 
 namespace td {
 
@@ -153,24 +152,31 @@ void TopDialogManager::on_dialog_used(TopDialogCategory category, DialogId dialo
   auto &top_dialogs = by_category_[pos];
 
   top_dialogs.is_dirty = true;
-  auto it = std::find_if(top_dialogs.dialogs.begin(), top_dialogs.dialogs.end(),
-                         [&](auto &top_dialog) { return top_dialog.dialog_id == dialog_id; });
-  if (it == top_dialogs.dialogs.end()) {
+  auto position_it = top_dialogs.dialog_positions.find(dialog_id);
+  size_t dialog_pos;
+  if (position_it == top_dialogs.dialog_positions.end()) {
     TopDialog top_dialog;
     top_dialog.dialog_id = dialog_id;
+    dialog_pos = top_dialogs.dialogs.size();
     top_dialogs.dialogs.push_back(top_dialog);
-    it = top_dialogs.dialogs.end() - 1;
+  } else {
+    dialog_pos = position_it->second;
+    CHECK(dialog_pos < top_dialogs.dialogs.size());
   }
 
+  // the rating only increases, so the dialog can only move to the beginning of the sorted list
   auto delta = rating_add(date, top_dialogs.rating_timestamp);
-  it->rating += delta;
-  while (it != top_dialogs.dialogs.begin()) {
-    auto next = std::prev(it);
-    if (*next < *it) {
-      break;
-    }
-    std::swap(*next, *it);
-    it = next;
+  auto &dialogs = top_dialogs.dialogs;
+  dialogs[dialog_pos].rating += delta;
+  auto new_pos = dialog_pos;
+  while (new_pos > 0 && !(dialogs[new_pos - 1] < dialogs[dialog_pos])) {
+    new_pos--;
+  }
+  if (new_pos != dialog_pos) {
+    std::rotate(dialogs.begin() + new_pos, dialogs.begin() + dialog_pos, dialogs.begin() + dialog_pos + 1);
+  }
+  for (auto i = new_pos; i <= dialog_pos; i++) {
+    top_dialogs.dialog_positions[dialogs[i].dialog_id] = i;
   }
 
   LOG(INFO) << "Update " << top_dialog_category_name(category) << " rating of " << dialog_id << " by " << delta;
@@ -204,14 +210,17 @@ void TopDialogManager::remove_dialog(TopDialogCategory category, DialogId dialog
     G()->net_query_dispatcher().dispatch_with_callback(std::move(net_query), actor_shared(this, 1));
   }
 
-  auto it = std::find_if(top_dialogs.dialogs.begin(), top_dialogs.dialogs.end(),
-                         [&](auto &top_dialog) { return top_dialog.dialog_id == dialog_id; });
-  if (it == top_dialogs.dialogs.end()) {
+  auto position_it = top_dialogs.dialog_positions.find(dialog_id);
+  if (position_it == top_dialogs.dialog_positions.end()) {
     return;
   }
+  auto dialog_pos = position_it->second;
+  CHECK(dialog_pos < top_dialogs.dialogs.size());
+  top_dialogs.dialog_positions.erase(position_it);
 
   top_dialogs.is_dirty = true;
-  top_dialogs.dialogs.erase(it);
+  top_dialogs.dialogs.erase(top_dialogs.dialogs.begin() + dialog_pos);
+  top_dialogs.update_dialog_positions(dialog_pos);
   if (!first_unsync_change_) {
     first_unsync_change_ = Timestamp::now_cached();
   }
@@ -269,6 +278,14 @@ void parse(TopDialogManager::TopDialogs &top_dialogs, ParserT &parser) {
   using ::td::parse;
   parse(top_dialogs.rating_timestamp, parser);
   parse(top_dialogs.dialogs, parser);
+  top_dialogs.dialog_positions.clear();
+  top_dialogs.update_dialog_positions(0);
+}
+
+void TopDialogManager::TopDialogs::update_dialog_positions(size_t from_pos) {
+  for (size_t i = from_pos; i < dialogs.size(); i++) {
+    dialog_positions[dialogs[i].dialog_id] = i;
+  }
 }
 
 double TopDialogManager::rating_add(double now, double rating_timestamp) const {
@@ -476,10 +493,17 @@ void TopDialogManager::on_result(NetQueryPtr net_query) {
 
         top_dialogs.is_dirty = true;
         top_dialogs.dialogs.clear();
+        top_dialogs.dialog_positions.clear();
         for (auto &top_peer : category->peers_) {
           TopDialog top_dialog;
           top_dialog.dialog_id = DialogId(top_peer->peer_);
           top_dialog.rating = top_peer->rating_;
+          if (top_dialogs.dialog_positions.count(top_dialog.dialog_id) != 0) {
+            LOG(ERROR) << "Receive duplicate " << top_dialog.dialog_id << " in "
+                       << top_dialog_category_name(dialog_category);
+            continue;
+          }
+          top_dialogs.dialog_positions[top_dialog.dialog_id] = top_dialogs.dialogs.size();
           top_dialogs.dialogs.push_back(std::move(top_dialog));
         }
       }
@@ -573,6 +597,7 @@ void TopDialogManager::init() {
       top_dialogs.is_dirty = false;
       top_dialogs.rating_timestamp = 0;
       top_dialogs.dialogs.clear();
+      top_dialogs.dialog_positions.clear();
     }
   }
   db_sync_state_ = SyncState::Ok;
@@ -18,6 +18,7 @@
 #include "td/utils/Time.h"
 
 #include <array>
+#include <unordered_map>
 #include <utility>
 
 namespace td {
@@ -80,6 +81,9 @@ class TopDialogManager : public NetQueryCallback {
     bool is_dirty = false;
     double rating_timestamp = 0;
     std::vector<TopDialog> dialogs;
+    std::unordered_map<DialogId, size_t, DialogIdHash> dialog_positions;  // positions in dialogs; aren't saved
+
+    void update_dialog_positions(size_t from_pos);
   };
   template <class StorerT>
   friend void store(const TopDialog &top_dialog, StorerT &storer);
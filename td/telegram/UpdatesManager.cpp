@@ -1041,11 +1041,14 @@ void UpdatesManager::process_get_difference_updates(
     */
   }
 
+  // chat positions and last messages are updated once for all new messages from the difference
+  td_->messages_manager_->start_updates_batch();
   for (auto &message : new_messages) {
     // channel messages must not be received in this vector
     td_->messages_manager_->on_get_message(std::move(message), true, false, false, true, true, "get difference");
     CHECK(!running_get_difference_);
   }
+  td_->messages_manager_->finish_updates_batch();
 
   for (auto &encrypted_message : new_encrypted_messages) {
     send_closure(td_->secret_chats_manager_, &SecretChatsManager::on_new_message, std::move(encrypted_message),
@@ -57,6 +57,8 @@ enum class DbVersion : int32 {
   AddScheduledMessages,
   StorePinnedDialogsInBinlog,
   AddMessageThreadSupport,
+  AddMessagesFtsQueue,
+  AddMessageMediaIndexTable,
   Next
 };
 
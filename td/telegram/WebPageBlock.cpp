@@ -2353,6 +2353,10 @@ void store(const unique_ptr<WebPageBlock> &block, LogEventStorerUnsafe &storer)
   store_web_page_block(block, storer);
 }
 
+void store(const unique_ptr<WebPageBlock> &block, LogEventStorerGrowable &storer) {
+  store_web_page_block(block, storer);
+}
+
 void parse(unique_ptr<WebPageBlock> &block, LogEventParser &parser) {
   parse_web_page_block(block, parser);
 }
@@ -95,6 +95,8 @@ void store(const unique_ptr<WebPageBlock> &block, LogEventStorerCalcLength &stor
 
 void store(const unique_ptr<WebPageBlock> &block, LogEventStorerUnsafe &storer);
 
+void store(const unique_ptr<WebPageBlock> &block, LogEventStorerGrowable &storer);
+
 void parse(unique_ptr<WebPageBlock> &block, LogEventParser &parser);
 
 vector<unique_ptr<WebPageBlock>> get_web_page_blocks(
@@ -11,6 +11,7 @@
 #include "td/telegram/AnimationsManager.h"
 #include "td/telegram/AudiosManager.h"
 #include "td/telegram/AuthManager.h"
+#include "td/telegram/ConfigShared.h"
 #include "td/telegram/Document.h"
 #include "td/telegram/Document.hpp"
 #include "td/telegram/DocumentsManager.h"
@@ -46,6 +47,7 @@
 #include "td/utils/misc.h"
 #include "td/utils/Slice.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 #include "td/utils/utf8.h"
 
@@ -70,8 +72,10 @@ class GetWebPagePreviewQuery : public Td::ResultHandler {
       flags |= telegram_api::messages_getWebPagePreview::ENTITIES_MASK;
     }
 
-    send_query(
-        G()->net_query_creator().create(telegram_api::messages_getWebPagePreview(flags, text, std::move(entities))));
+    auto query =
+        G()->net_query_creator().create(telegram_api::messages_getWebPagePreview(flags, text, std::move(entities)));
+    query->cache_ttl_ = 10;  // the same preview is often requested repeatedly while a message is being composed
+    send_query(std::move(query));
   }
 
   void on_result(uint64 id, BufferSlice packet) override {
@@ -148,6 +152,8 @@ class WebPagesManager::WebPageInstantView {
   bool is_full = false;
   bool is_loaded = false;
   bool was_loaded_from_database = false;
+  size_t size = 0;            // size of the instant view in the database if known
+  uint64 last_access_id = 0;  // non-zero only if the instant view can be unloaded
 
   template <class StorerT>
   void store(StorerT &storer) const {
@@ -434,6 +440,7 @@ WebPageId WebPagesManager::on_get_web_page(tl_object_ptr<telegram_api::WebPage>
           td_->file_manager_->change_files_source(web_page_to_delete->file_source_id,
                                                   get_web_page_file_ids(web_page_to_delete), vector<FileId>());
         }
+        remove_unloadable_web_page_instant_view(web_pages_[web_page_id]->instant_view);
         web_pages_.erase(web_page_id);
       }
 
@@ -582,6 +589,9 @@ void WebPagesManager::update_web_page_instant_view(WebPageId web_page_id, WebPag
                                                    WebPageInstantView &&old_instant_view) {
   LOG(INFO) << "Merge new " << new_instant_view << " and old " << old_instant_view;
 
+  remove_unloadable_web_page_instant_view(new_instant_view);
+  remove_unloadable_web_page_instant_view(old_instant_view);
+
   bool new_from_database = new_instant_view.was_loaded_from_database;
   bool old_from_database = old_instant_view.was_loaded_from_database;
 
@@ -629,8 +639,83 @@ void WebPagesManager::update_web_page_instant_view(WebPageId web_page_id, WebPag
       }
       */
       new_instant_view.was_loaded_from_database = true;
-      G()->td_db()->get_sqlite_pmc()->set(get_web_page_instant_view_database_key(web_page_id),
-                                          log_event_store(new_instant_view).as_slice().str(), Auto());
+      auto value = log_event_store(new_instant_view).as_slice().str();
+      new_instant_view.size = value.size();
+      G()->td_db()->get_sqlite_pmc()->set(get_web_page_instant_view_database_key(web_page_id), std::move(value),
+                                          Auto());
+    }
+
+    add_unloadable_web_page_instant_view(web_page_id, new_instant_view);
+  }
+}
+
+void WebPagesManager::add_unloadable_web_page_instant_view(WebPageId web_page_id, WebPageInstantView &instant_view) {
+  CHECK(instant_view.last_access_id == 0);
+  if (!instant_view.was_loaded_from_database || instant_view.size == 0) {
+    // the instant view isn't in the database or its size is unknown
+    return;
+  }
+
+  instant_view.last_access_id = ++last_instant_view_access_id_;
+  unloadable_instant_views_.emplace(instant_view.last_access_id, web_page_id);
+  unloadable_instant_views_size_ += instant_view.size;
+
+  unload_web_page_instant_views();
+}
+
+void WebPagesManager::remove_unloadable_web_page_instant_view(WebPageInstantView &instant_view) {
+  if (instant_view.last_access_id == 0) {
+    return;
+  }
+
+  auto is_deleted = unloadable_instant_views_.erase(instant_view.last_access_id) > 0;
+  CHECK(is_deleted);
+  CHECK(unloadable_instant_views_size_ >= instant_view.size);
+  unloadable_instant_views_size_ -= instant_view.size;
+  instant_view.last_access_id = 0;
+}
+
+void WebPagesManager::touch_web_page_instant_view(WebPageId web_page_id) {
+  auto it = web_pages_.find(web_page_id);
+  CHECK(it != web_pages_.end());
+  auto &instant_view = it->second->instant_view;
+  if (instant_view.last_access_id == 0 || instant_view.last_access_id == last_instant_view_access_id_) {
+    return;
+  }
+
+  remove_unloadable_web_page_instant_view(instant_view);
+  add_unloadable_web_page_instant_view(web_page_id, instant_view);
+}
+
+void WebPagesManager::unload_web_page_instant_views() {
+  auto max_size = G()->shared_config().get_option_integer("web_page_instant_view_cache_size_max",
+                                                         DEFAULT_WEB_PAGE_INSTANT_VIEW_CACHE_SIZE_MAX);
+  // the most recently used instant view is never unloaded
+  while (static_cast<int64>(unloadable_instant_views_size_) > max_size && unloadable_instant_views_.size() > 1) {
+    auto web_page_id = unloadable_instant_views_.begin()->second;
+    auto it = web_pages_.find(web_page_id);
+    CHECK(it != web_pages_.end());
+    WebPage *web_page = it->second.get();
+    auto &instant_view = web_page->instant_view;
+    remove_unloadable_web_page_instant_view(instant_view);
+    if (load_web_page_instant_view_queries_.count(web_page_id) != 0) {
+      // the instant view is being reloaded and will be added again
+      continue;
+    }
+
+    LOG(INFO) << "Unload instant view of " << web_page_id;
+    auto old_file_ids = get_web_page_file_ids(web_page);
+
+    // the instant view becomes the same as received without the page and can be loaded from the database again
+    reset_to_empty(instant_view.page_blocks);
+    instant_view.is_full = false;
+    instant_view.is_loaded = false;
+    instant_view.was_loaded_from_database = false;
+    instant_view.size = 0;
+
+    auto new_file_ids = get_web_page_file_ids(web_page);
+    if (old_file_ids != new_file_ids) {
+      td_->file_manager_->change_files_source(get_web_page_file_source_id(web_page), old_file_ids, new_file_ids);
     }
   }
 }
@@ -691,6 +776,44 @@ void WebPagesManager::on_get_web_page_by_url(const string &url, WebPageId web_pa
   }
 
   cached_web_page_id = web_page_id;
+
+  if (!from_database && (!web_page_id.is_valid() || have_web_page(web_page_id))) {
+    share_web_page_url(url, web_page_id);
+  }
+}
+
+void WebPagesManager::share_web_page_url(const string &url, WebPageId web_page_id) {
+  auto now = Time::now();
+  std::lock_guard<std::mutex> lock(shared_web_page_urls_mutex_);
+  if (shared_web_page_urls_.size() >= MAX_SHARED_WEB_PAGE_URL_COUNT) {
+    for (auto it = shared_web_page_urls_.begin(); it != shared_web_page_urls_.end();) {
+      if (it->second.expire_time < now) {
+        it = shared_web_page_urls_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (shared_web_page_urls_.size() >= MAX_SHARED_WEB_PAGE_URL_COUNT) {
+      shared_web_page_urls_.clear();
+    }
+  }
+  auto &shared_url = shared_web_page_urls_[url];
+  shared_url.web_page_id = web_page_id;
+  shared_url.expire_time = now + SHARED_WEB_PAGE_URL_EXPIRE_TIME;
+}
+
+bool WebPagesManager::get_shared_web_page_url(const string &url, WebPageId &web_page_id) {
+  std::lock_guard<std::mutex> lock(shared_web_page_urls_mutex_);
+  auto it = shared_web_page_urls_.find(url);
+  if (it == shared_web_page_urls_.end()) {
+    return false;
+  }
+  if (it->second.expire_time < Time::now()) {
+    shared_web_page_urls_.erase(it);
+    return false;
+  }
+  web_page_id = it->second.web_page_id;
+  return true;
 }
 
 void WebPagesManager::register_web_page(WebPageId web_page_id, FullMessageId full_message_id, const char *source) {
@@ -864,6 +987,7 @@ WebPageId WebPagesManager::get_web_page_instant_view(WebPageId web_page_id, bool
     reload_web_page_instant_view(web_page_id);
   }
 
+  touch_web_page_instant_view(web_page_id);
   promise.set_value(Unit());
   return web_page_id;
 }
@@ -945,7 +1069,9 @@ void WebPagesManager::on_load_web_page_instant_view_from_database(WebPageId web_
   WebPageInstantView result;
   if (!value.empty()) {
     auto status = log_event_parse(result, value);
-    if (status.is_error()) {
+    if (status.is_ok()) {
+      result.size = value.size();
+    } else {
       result = WebPageInstantView();
 
       LOG(ERROR) << "Erase instant view in " << web_page_id << " from database because of " << status.message();
@@ -1058,6 +1184,17 @@ WebPageId WebPagesManager::get_web_page_by_url(const string &url, Promise<Unit>
 }
 
 void WebPagesManager::load_web_page_by_url(const string &url, Promise<Unit> &&promise) {
+  // the URL may have been already resolved by another client; its web page must be known to use the result
+  WebPageId shared_web_page_id;
+  if (get_shared_web_page_url(url, shared_web_page_id) &&
+      (!shared_web_page_id.is_valid() || have_web_page(shared_web_page_id))) {
+    LOG(INFO) << "Use shared " << shared_web_page_id << " for the url \"" << url << '"';
+    // the result isn't saved to the database and isn't shared again to not prolong its lifetime
+    on_get_web_page_by_url(url, shared_web_page_id, true);
+    promise.set_value(Unit());
+    return;
+  }
+
   if (!G()->parameters().use_message_db) {
     reload_web_page_by_url(url, std::move(promise));
     return;
@@ -1702,4 +1839,7 @@ vector<FileId> WebPagesManager::get_web_page_file_ids(const WebPage *web_page) c
   return result;
 }
 
+std::mutex WebPagesManager::shared_web_page_urls_mutex_;
+std::unordered_map<string, WebPagesManager::SharedWebPageUrl> WebPagesManager::shared_web_page_urls_;
+
 }  // namespace td
@@ -23,6 +23,8 @@
 #include "td/utils/common.h"
 #include "td/utils/Status.h"
 
+#include <map>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -115,6 +117,14 @@ class WebPagesManager : public Actor {
   static bool need_use_old_instant_view(const WebPageInstantView &new_instant_view,
                                         const WebPageInstantView &old_instant_view);
 
+  void add_unloadable_web_page_instant_view(WebPageId web_page_id, WebPageInstantView &instant_view);
+
+  void remove_unloadable_web_page_instant_view(WebPageInstantView &instant_view);
+
+  void touch_web_page_instant_view(WebPageId web_page_id);
+
+  void unload_web_page_instant_views();
+
   void on_web_page_changed(WebPageId web_page_id, bool have_web_page);
 
   const WebPage *get_web_page(WebPageId web_page_id) const;
@@ -198,6 +208,29 @@ class WebPagesManager : public Actor {
   std::unordered_map<string, FileSourceId> url_to_file_source_id_;
 
   MultiTimeout pending_web_pages_timeout_{"PendingWebPagesTimeout"};
+
+  static constexpr int64 DEFAULT_WEB_PAGE_INSTANT_VIEW_CACHE_SIZE_MAX = 20 << 20;
+
+  // instant views, which are saved in the database, are unloaded in LRU order when their total size is too big
+  std::map<uint64, WebPageId> unloadable_instant_views_;  // last_access_id -> web_page_id
+  size_t unloadable_instant_views_size_ = 0;
+  uint64 last_instant_view_access_id_ = 0;
+
+  struct SharedWebPageUrl {
+    WebPageId web_page_id;  // WebPageId() if the URL has no web page
+    double expire_time = 0.0;
+  };
+
+  static constexpr double SHARED_WEB_PAGE_URL_EXPIRE_TIME = 3600.0;
+  static constexpr size_t MAX_SHARED_WEB_PAGE_URL_COUNT = 100000;
+
+  // web page identifiers are the same for all users, so results of URL resolution are shared between all clients
+  static std::mutex shared_web_page_urls_mutex_;
+  static std::unordered_map<string, SharedWebPageUrl> shared_web_page_urls_;
+
+  static void share_web_page_url(const string &url, WebPageId web_page_id);
+
+  static bool get_shared_web_page_url(const string &url, WebPageId &web_page_id);
 };
 
 }  // namespace td
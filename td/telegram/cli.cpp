@@ -22,6 +22,7 @@
 #include "td/utils/crypto.h"
 #include "td/utils/ExitGuard.h"
 #include "td/utils/FileLog.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
@@ -220,16 +221,38 @@ StringBuilder &operator<<(StringBuilder &sb, const SendMessageInfo &info) {
   return sb;
 }
 
+// requests, which are related to authorization or closing of the client, aren't recorded to traces and aren't replayed
+static bool is_trace_ignored_request(int32 function_id) {
+  switch (function_id) {
+    case td_api::setTdlibParameters::ID:
+    case td_api::checkDatabaseEncryptionKey::ID:
+    case td_api::setDatabaseEncryptionKey::ID:
+    case td_api::setAuthenticationPhoneNumber::ID:
+    case td_api::resendAuthenticationCode::ID:
+    case td_api::checkAuthenticationCode::ID:
+    case td_api::checkAuthenticationPassword::ID:
+    case td_api::checkAuthenticationBotToken::ID:
+    case td_api::registerUser::ID:
+    case td_api::logOut::ID:
+    case td_api::close::ID:
+    case td_api::destroy::ID:
+      return true;
+    default:
+      return false;
+  }
+}
+
 class CliClient final : public Actor {
  public:
   CliClient(ConcurrentScheduler *scheduler, bool use_test_dc, bool get_chat_list, bool disable_network, int32 api_id,
-            string api_hash)
+            string api_hash, string trace_path)
       : scheduler_(scheduler)
       , use_test_dc_(use_test_dc)
       , get_chat_list_(get_chat_list)
       , disable_network_(disable_network)
       , api_id_(api_id)
-      , api_hash_(api_hash) {
+      , api_hash_(api_hash)
+      , trace_path_(std::move(trace_path)) {
   }
 
   static void quit_instance() {
@@ -672,6 +695,9 @@ class CliClient final : public Actor {
     }
 
     auto as_json_str = json_encode<std::string>(ToJson(result));
+    if (id == 0) {
+      write_trace("update", as_json_str);
+    }
     // LOG(INFO) << "Receive result [" << generation << "][id=" << id << "] " << as_json_str;
     //auto copy_as_json_str = as_json_str;
     //auto as_json_value = json_decode(copy_as_json_str).move_as_ok();
@@ -928,9 +954,49 @@ class CliClient final : public Actor {
     }
   }
 
+  // each line of a trace contains time in seconds since the start of recording, "request" or "update" and
+  // the object in JSON format, separated by tabs
+  void init_trace() {
+    if (trace_path_.empty()) {
+      return;
+    }
+    auto r_fd = FileFd::open(trace_path_, FileFd::Write | FileFd::Create | FileFd::Truncate);
+    if (r_fd.is_error()) {
+      LOG(ERROR) << "Failed to open trace file: " << r_fd.error();
+      return;
+    }
+    trace_fd_ = r_fd.move_as_ok();
+    trace_start_time_ = Time::now();
+    LOG(WARNING) << "Record trace to " << trace_path_;
+  }
+
+  void write_trace(Slice type, Slice object) {
+    if (trace_fd_.empty()) {
+      return;
+    }
+    // objects can be big, so they must not be formatted using a Logger
+    string line = PSTRING() << (Time::now() - trace_start_time_) << '\t' << type << '\t';
+    line.append(object.begin(), object.end());
+    line += '\n';
+    auto status = write_to_trace(line);
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to write trace: " << status;
+      trace_fd_.close();
+    }
+  }
+
+  Status write_to_trace(Slice data) {
+    while (!data.empty()) {
+      TRY_RESULT(written_size, trace_fd_.write(data));
+      data.remove_prefix(written_size);
+    }
+    return Status::OK();
+  }
+
   void init() {
     instance_ = this;
 
+    init_trace();
     init_td();
 
 #ifdef USE_READLINE
@@ -1396,6 +1462,9 @@ class CliClient final : public Actor {
   uint64 send_request(td_api::object_ptr<td_api::Function> f) {
     static uint64 query_num = 1;
     if (!td_client_.empty()) {
+      if (f != nullptr && !is_trace_ignored_request(f->get_id())) {
+        write_trace("request", json_encode<std::string>(ToJson(*f)));
+      }
       auto id = query_num++;
       send_closure_later(td_client_, &ClientActor::request, id, std::move(f));
       return id;
@@ -2378,6 +2447,10 @@ class CliClient final : public Actor {
       send_request(td_api::make_object<td_api::getStorageStatisticsFast>());
     } else if (op == "database") {
       send_request(td_api::make_object<td_api::getDatabaseStatistics>());
+    } else if (op == "compact_database") {
+      send_request(td_api::make_object<td_api::compactDatabase>());
+    } else if (op == "memory") {
+      send_request(td_api::make_object<td_api::getMemoryStatistics>(as_bool(args)));
     } else if (op == "optimize_storage" || op == "optimize_storage_all") {
       string chat_ids;
       string exclude_chat_ids;
@@ -2726,6 +2799,15 @@ class CliClient final : public Actor {
         send_request(td_api::make_object<td_api::downloadFile>(
             i, to_integer<int32>(priority), to_integer<int32>(offset), to_integer<int32>(limit), op == "dfs"));
       }
+    } else if (op == "sfsp") {
+      string file_id;
+      string offset;
+      string bitrate;
+      std::tie(file_id, args) = split(args);
+      std::tie(offset, bitrate) = split(args);
+
+      send_request(td_api::make_object<td_api::setFileStreamingPosition>(
+          as_file_id(file_id), to_integer<int32>(offset), to_integer<int32>(bitrate)));
     } else if (op == "cdf") {
       send_request(td_api::make_object<td_api::cancelDownloadFile>(as_file_id(args), false));
     } else if (op == "uf" || op == "ufs" || op == "ufse") {
@@ -4289,6 +4371,11 @@ class CliClient final : public Actor {
         LOG(ERROR) << "RSS = " << stats.resident_size_ << ", peak RSS = " << stats.resident_size_peak_ << ", VSZ "
                    << stats.virtual_size_ << ", peak VSZ = " << stats.virtual_size_peak_;
       }
+    } else if (op == "memprof") {
+      auto status = write_file(args.empty() ? string("memprof.heap") : args, get_memprof_heap_profile());
+      if (status.is_error()) {
+        LOG(ERROR) << status;
+      }
     } else if (op == "cpu") {
       uint32 inc_count = to_integer<uint32>(args);
       while (inc_count-- > 0) {
@@ -4339,6 +4426,28 @@ class CliClient final : public Actor {
       } else {
         execute(std::move(request));
       }
+    } else if (op == "tas") {
+      string is_enabled;
+      string log_period;
+      string need_hardware_counters;
+      std::tie(is_enabled, args) = split(args);
+      std::tie(log_period, need_hardware_counters) = split(args);
+      execute(td_api::make_object<td_api::toggleActorStatistics>(as_bool(is_enabled), to_double(log_period),
+                                                                 as_bool(need_hardware_counters)));
+    } else if (op == "gas" || op == "gasr") {
+      execute(td_api::make_object<td_api::getActorStatistics>(op == "gasr"));
+    } else if (op == "tdqs") {
+      string is_enabled;
+      string slow_query_threshold;
+      std::tie(is_enabled, slow_query_threshold) = split(args);
+      execute(td_api::make_object<td_api::toggleDatabaseQueryStatistics>(as_bool(is_enabled),
+                                                                         to_double(slow_query_threshold)));
+    } else if (op == "gdqs" || op == "gdqsr") {
+      execute(td_api::make_object<td_api::getDatabaseQueryStatistics>(op == "gdqsr"));
+    } else if (op == "gqps" || op == "gqpsr") {
+      execute(td_api::make_object<td_api::getQueryPackingStatistics>(op == "gqpsr"));
+    } else if (op == "gnqs" || op == "gnqsr") {
+      send_request(td_api::make_object<td_api::getNetworkQueryStatistics>(op == "gnqsr"));
     } else if (op == "alog" || op == "aloge") {
       string level;
       string text;
@@ -4491,11 +4600,329 @@ class CliClient final : public Actor {
   int api_id_ = 0;
   std::string api_hash_;
 
+  string trace_path_;
+  FileFd trace_fd_;
+  double trace_start_time_ = 0;
+
   static std::atomic<uint64> cpu_counter_;
 };
 CliClient *CliClient::instance_ = nullptr;
 std::atomic<uint64> CliClient::cpu_counter_;
 
+// replays requests from a trace, recorded with --record, simultaneously in several clients and reports performance;
+// each client must already be logged in, because authorization requests aren't replayed
+class TraceReplayer final : public Actor {
+ public:
+  TraceReplayer(string trace_path, int32 client_count, double speed, string database_directory_prefix,
+                bool use_test_dc, int32 api_id, string api_hash)
+      : trace_path_(std::move(trace_path))
+      , client_count_(client_count)
+      , speed_(speed)
+      , database_directory_prefix_(std::move(database_directory_prefix))
+      , use_test_dc_(use_test_dc)
+      , api_id_(api_id)
+      , api_hash_(std::move(api_hash)) {
+  }
+
+  void on_result(size_t client_pos, uint64 id, td_api::object_ptr<td_api::Object> result) {
+    if (id != 0) {
+      return on_request_finished(id, result != nullptr && result->get_id() == td_api::error::ID);
+    }
+
+    update_count_++;
+    if (result != nullptr && result->get_id() == td_api::updateAuthorizationState::ID) {
+      auto update = static_cast<const td_api::updateAuthorizationState *>(result.get());
+      on_authorization_state(client_pos, *update->authorization_state_);
+    }
+  }
+
+  void on_error(size_t client_pos, uint64 id, td_api::object_ptr<td_api::error> error) {
+    if (id != 0) {
+      on_request_finished(id, true);
+    }
+  }
+
+  void on_closed(size_t client_pos) {
+    closed_client_count_++;
+    if (closed_client_count_ == clients_.size()) {
+      Scheduler::instance()->finish();
+      stop();
+    }
+  }
+
+ private:
+  struct TraceRequest {
+    double time = 0;
+    string json;
+  };
+
+  struct ReplayClient {
+    ActorOwn<ClientActor> client;
+    bool is_ready = false;
+    bool is_failed = false;
+  };
+
+  string trace_path_;
+  int32 client_count_ = 1;
+  double speed_ = 1.0;
+  string database_directory_prefix_;
+  bool use_test_dc_ = false;
+  int32 api_id_ = 0;
+  string api_hash_;
+
+  vector<TraceRequest> requests_;
+  vector<ReplayClient> clients_;
+  size_t ready_client_count_ = 0;
+  size_t failed_client_count_ = 0;
+  size_t closed_client_count_ = 0;
+
+  bool is_started_ = false;
+  bool is_finished_ = false;
+  double start_time_ = 0;
+  CpuStat start_cpu_stat_;
+  size_t next_request_pos_ = 0;
+  uint64 next_request_id_ = 1;
+  std::unordered_map<uint64, double> pending_requests_;  // request identifier -> time when it was sent
+  vector<double> latencies_;
+  size_t error_count_ = 0;
+  size_t update_count_ = 0;
+
+  void start_up() override {
+    auto status = load_trace();
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to load trace from " << trace_path_ << ": " << status;
+      Scheduler::instance()->finish();
+      return stop();
+    }
+    LOG(WARNING) << "Replay " << requests_.size() << " requests from " << trace_path_ << " in " << client_count_
+                 << " clients with speed " << speed_;
+
+    for (int32 i = 0; i < client_count_; i++) {
+      class TdCallbackImpl : public TdCallback {
+       public:
+        TdCallbackImpl(TraceReplayer *replayer, size_t client_pos) : replayer_(replayer), client_pos_(client_pos) {
+        }
+        void on_result(uint64 id, td_api::object_ptr<td_api::Object> result) override {
+          replayer_->on_result(client_pos_, id, std::move(result));
+        }
+        void on_error(uint64 id, td_api::object_ptr<td_api::error> error) override {
+          replayer_->on_error(client_pos_, id, std::move(error));
+        }
+        TdCallbackImpl(const TdCallbackImpl &) = delete;
+        TdCallbackImpl &operator=(const TdCallbackImpl &) = delete;
+        TdCallbackImpl(TdCallbackImpl &&) = delete;
+        TdCallbackImpl &operator=(TdCallbackImpl &&) = delete;
+        ~TdCallbackImpl() override {
+          replayer_->on_closed(client_pos_);
+        }
+
+       private:
+        TraceReplayer *replayer_;
+        size_t client_pos_;
+      };
+
+      ClientActor::Options options;
+      options.net_query_stats = net_query_stats_;
+      ReplayClient client;
+      client.client = create_actor<ClientActor>(PSLICE() << "ReplayClient" << i,
+                                                make_unique<TdCallbackImpl>(this, clients_.size()), std::move(options));
+      clients_.push_back(std::move(client));
+    }
+  }
+
+  Status load_trace() {
+    TRY_RESULT(trace, read_file_str(trace_path_));
+    for (auto line : full_split(Slice(trace), '\n')) {
+      auto parts = full_split(line, '\t', 3);
+      if (parts.size() != 3 || parts[1] != "request") {
+        continue;
+      }
+
+      // check that the request can be parsed
+      auto json = parts[2].str();
+      TRY_RESULT(value, json_decode(json));
+      td_api::object_ptr<td_api::Function> function;
+      TRY_STATUS(from_json(function, std::move(value)));
+      if (function == nullptr || is_trace_ignored_request(function->get_id())) {
+        continue;
+      }
+
+      TraceRequest request;
+      request.time = to_double(parts[0]);
+      request.json = parts[2].str();
+      requests_.push_back(std::move(request));
+    }
+    if (requests_.empty()) {
+      return Status::Error("Trace has no requests to replay");
+    }
+
+    // the replay starts from the first request
+    auto first_request_time = requests_[0].time;
+    for (auto &request : requests_) {
+      request.time = max(request.time - first_request_time, 0.0) / speed_;
+    }
+    return Status::OK();
+  }
+
+  void on_authorization_state(size_t client_pos, const td_api::AuthorizationState &state) {
+    CHECK(client_pos < clients_.size());
+    auto &client = clients_[client_pos];
+    switch (state.get_id()) {
+      case td_api::authorizationStateWaitTdlibParameters::ID: {
+        auto parameters = td_api::make_object<td_api::tdlibParameters>();
+        parameters->database_directory_ = PSTRING() << database_directory_prefix_ << client_pos;
+        parameters->use_test_dc_ = use_test_dc_;
+        parameters->use_message_database_ = true;
+        parameters->use_chat_info_database_ = true;
+        parameters->use_secret_chats_ = true;
+        parameters->api_id_ = api_id_;
+        parameters->api_hash_ = api_hash_;
+        parameters->system_language_code_ = "en";
+        parameters->device_model_ = "Desktop";
+        parameters->application_version_ = "1.0";
+        return send_request(client_pos, td_api::make_object<td_api::setTdlibParameters>(std::move(parameters)));
+      }
+      case td_api::authorizationStateWaitEncryptionKey::ID:
+        return send_request(client_pos, td_api::make_object<td_api::checkDatabaseEncryptionKey>());
+      case td_api::authorizationStateReady::ID:
+        if (!client.is_ready && !client.is_failed) {
+          client.is_ready = true;
+          ready_client_count_++;
+          try_start();
+        }
+        return;
+      case td_api::authorizationStateLoggingOut::ID:
+      case td_api::authorizationStateClosing::ID:
+      case td_api::authorizationStateClosed::ID:
+        return;
+      default:
+        if (!client.is_ready && !client.is_failed) {
+          LOG(ERROR) << "Client " << client_pos << " isn't logged in; it will not be used";
+          client.is_failed = true;
+          failed_client_count_++;
+          try_start();
+        }
+        return;
+    }
+  }
+
+  void try_start() {
+    if (is_started_ || ready_client_count_ + failed_client_count_ != clients_.size()) {
+      return;
+    }
+    is_started_ = true;
+    if (ready_client_count_ == 0) {
+      LOG(ERROR) << "There are no logged in clients";
+      return finish();
+    }
+
+    LOG(WARNING) << "Start replay in " << ready_client_count_ << " clients";
+    start_time_ = Time::now();
+    auto r_cpu_stat = cpu_stat();
+    if (r_cpu_stat.is_ok()) {
+      start_cpu_stat_ = r_cpu_stat.move_as_ok();
+    }
+    timeout_expired();
+  }
+
+  void timeout_expired() override {
+    if (!is_started_ || is_finished_) {
+      return;
+    }
+
+    auto elapsed_time = Time::now() - start_time_;
+    while (next_request_pos_ < requests_.size() && requests_[next_request_pos_].time <= elapsed_time) {
+      auto &request = requests_[next_request_pos_++];
+      for (size_t i = 0; i < clients_.size(); i++) {
+        if (!clients_[i].is_ready) {
+          continue;
+        }
+        auto json = request.json;
+        auto value = json_decode(json).move_as_ok();
+        td_api::object_ptr<td_api::Function> function;
+        from_json(function, std::move(value)).ensure();
+        send_request(i, std::move(function));
+      }
+    }
+
+    if (next_request_pos_ < requests_.size()) {
+      set_timeout_in(requests_[next_request_pos_].time - elapsed_time);
+    } else {
+      try_finish();
+    }
+  }
+
+  void send_request(size_t client_pos, td_api::object_ptr<td_api::Function> function) {
+    auto id = next_request_id_++;
+    pending_requests_[id] = Time::now();
+    send_closure_later(clients_[client_pos].client, &ClientActor::request, id, std::move(function));
+  }
+
+  void on_request_finished(uint64 id, bool is_error) {
+    auto it = pending_requests_.find(id);
+    if (it == pending_requests_.end()) {
+      return;
+    }
+    if (is_started_) {
+      latencies_.push_back(Time::now() - it->second);
+      if (is_error) {
+        error_count_++;
+      }
+    }
+    pending_requests_.erase(it);
+    try_finish();
+  }
+
+  void try_finish() {
+    if (is_started_ && next_request_pos_ == requests_.size() && pending_requests_.empty()) {
+      finish();
+    }
+  }
+
+  double get_latency_percentile(double percentile) const {
+    CHECK(!latencies_.empty());
+    auto pos = static_cast<size_t>(percentile * 0.01 * static_cast<double>(latencies_.size()));
+    return latencies_[min(pos, latencies_.size() - 1)];
+  }
+
+  void finish() {
+    if (is_finished_) {
+      return;
+    }
+    is_finished_ = true;
+
+    if (!latencies_.empty()) {
+      auto duration = Time::now() - start_time_;
+      std::sort(latencies_.begin(), latencies_.end());
+      LOG(PLAIN) << "Replayed " << latencies_.size() << " requests in " << ready_client_count_ << " clients in "
+                 << duration << " seconds, " << static_cast<double>(latencies_.size()) / max(duration, 1e-9)
+                 << " requests per second, " << error_count_ << " errors, " << update_count_ << " updates\n";
+      LOG(PLAIN) << "Latency: 50% = " << get_latency_percentile(50) << ", 90% = " << get_latency_percentile(90)
+                 << ", 99% = " << get_latency_percentile(99) << ", max = " << latencies_.back() << "\n";
+      auto r_cpu_stat = cpu_stat();
+      if (r_cpu_stat.is_ok()) {
+        auto cpu_stat = r_cpu_stat.move_as_ok();
+        LOG(PLAIN) << "CPU: total ticks = " << cpu_stat.total_ticks_ - start_cpu_stat_.total_ticks_
+                   << ", user ticks = " << cpu_stat.process_user_ticks_ - start_cpu_stat_.process_user_ticks_
+                   << ", system ticks = " << cpu_stat.process_system_ticks_ - start_cpu_stat_.process_system_ticks_
+                   << "\n";
+      }
+      auto r_mem_stat = mem_stat();
+      if (r_mem_stat.is_ok()) {
+        auto mem_stat = r_mem_stat.move_as_ok();
+        LOG(PLAIN) << "Memory: RSS = " << mem_stat.resident_size_ << ", peak RSS = " << mem_stat.resident_size_peak_
+                   << "\n";
+      }
+    }
+
+    for (auto &client : clients_) {
+      client.client.reset();
+    }
+  }
+
+  std::shared_ptr<NetQueryStats> net_query_stats_ = create_net_query_stats();
+};
+
 void quit() {
   CliClient::quit_instance();
 }
@@ -4539,6 +4966,11 @@ void main(int argc, char **argv) {
   bool use_test_dc = false;
   bool get_chat_list = false;
   bool disable_network = false;
+  string record_trace_path;
+  string replay_trace_path;
+  int32 replay_client_count = 1;
+  double replay_speed = 1.0;
+  string replay_database_directory_prefix = "tdlib";
   auto api_id = [](auto x) -> int32 {
     if (x) {
       return to_integer<int32>(Slice(x));
@@ -4580,6 +5012,23 @@ void main(int argc, char **argv) {
                      [&](Slice parameter) { api_id = to_integer<int32>(parameter); });
   options.add_option('\0', "api-hash", "Set Telegram API hash", OptionParser::parse_string(api_hash));
   options.add_option('\0', "api_hash", "Set Telegram API hash", OptionParser::parse_string(api_hash));
+  options.add_option('\0', "record", "Record requests and updates to a trace file",
+                     OptionParser::parse_string(record_trace_path));
+  options.add_option('\0', "replay", "Replay requests from a trace file and report performance",
+                     OptionParser::parse_string(replay_trace_path));
+  options.add_checked_option('\0', "replay-clients", "Set number of simultaneously replaying clients",
+                             OptionParser::parse_integer(replay_client_count));
+  options.add_option('\0', "replay-speed", "Set replay speed multiplier",
+                     [&](Slice parameter) { replay_speed = to_double(parameter); });
+  options.add_option('\0', "replay-database-prefix",
+                     "Set database directory prefix of replaying clients; client index is appended to it",
+                     OptionParser::parse_string(replay_database_directory_prefix));
+  options.add_check([&] {
+    if (replay_client_count <= 0 || replay_speed <= 0) {
+      return Status::Error("Number of replaying clients and replay speed must be positive");
+    }
+    return Status::OK();
+  });
   options.add_check([&] {
     if (api_id == 0 || api_hash.empty()) {
       return Status::Error("You must provide valid api-id and api-hash obtained at https://my.telegram.org");
@@ -4602,19 +5051,20 @@ void main(int argc, char **argv) {
     class CreateClient : public Actor {
      public:
       CreateClient(ConcurrentScheduler *scheduler, bool use_test_dc, bool get_chat_list, bool disable_network,
-                   int32 api_id, std::string api_hash)
+                   int32 api_id, std::string api_hash, string trace_path)
           : scheduler_(scheduler)
           , use_test_dc_(use_test_dc)
           , get_chat_list_(get_chat_list)
           , disable_network_(disable_network)
           , api_id_(api_id)
-          , api_hash_(std::move(api_hash)) {
+          , api_hash_(std::move(api_hash))
+          , trace_path_(std::move(trace_path)) {
       }
 
      private:
       void start_up() override {
         create_actor<CliClient>("CliClient", scheduler_, use_test_dc_, get_chat_list_, disable_network_, api_id_,
-                                api_hash_)
+                                api_hash_, trace_path_)
             .release();
       }
 
@@ -4624,11 +5074,19 @@ void main(int argc, char **argv) {
       bool disable_network_;
       int32 api_id_;
       std::string api_hash_;
+      string trace_path_;
     };
-    scheduler
-        .create_actor_unsafe<CreateClient>(0, "CreateClient", &scheduler, use_test_dc, get_chat_list, disable_network,
-                                           api_id, api_hash)
-        .release();
+    if (replay_trace_path.empty()) {
+      scheduler
+          .create_actor_unsafe<CreateClient>(0, "CreateClient", &scheduler, use_test_dc, get_chat_list,
+                                             disable_network, api_id, api_hash, record_trace_path)
+          .release();
+    } else {
+      scheduler
+          .create_actor_unsafe<TraceReplayer>(0, "TraceReplayer", replay_trace_path, replay_client_count, replay_speed,
+                                              replay_database_directory_prefix, use_test_dc, api_id, api_hash)
+          .release();
+    }
 
     scheduler.start();
     while (scheduler.run_main(Timestamp::in(100))) {
@@ -0,0 +1,62 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/misc.h"
+#include "td/utils/StringBuilder.h"
+
+namespace td {
+
+// estimates bandwidth-delay product of a file transfer by its finished parts
+class BandwidthEstimator {
+ public:
+  void on_part_finished(int64 size, double start_time, double now) {
+    auto latency = now - start_time;
+    if (min_latency_ <= 0 || latency < min_latency_ || min_latency_at_ + MIN_LATENCY_TTL < now) {
+      min_latency_ = latency;
+      min_latency_at_ = now;
+    }
+
+    if (sample_start_time_ == 0) {
+      sample_start_time_ = start_time;
+    }
+    sample_size_ += size;
+    auto duration = now - sample_start_time_;
+    if (duration >= SAMPLE_DURATION) {
+      auto bandwidth = static_cast<double>(sample_size_) / duration;
+      max_bandwidth_ = max(bandwidth, max_bandwidth_ * BANDWIDTH_DECAY);
+      sample_start_time_ = now;
+      sample_size_ = 0;
+    }
+  }
+
+  // returns number of bytes, which must be in flight to fully use the available bandwidth
+  int64 get_window(int64 min_window, int64 max_window) const {
+    auto window = static_cast<int64>(2 * max_bandwidth_ * min_latency_);
+    return clamp(window, min_window, max_window);
+  }
+
+  friend StringBuilder &operator<<(StringBuilder &sb, const BandwidthEstimator &estimator) {
+    return sb << tag("bandwidth", static_cast<int64>(estimator.max_bandwidth_))
+              << tag("latency", estimator.min_latency_);
+  }
+
+ private:
+  static constexpr double SAMPLE_DURATION = 0.5;
+  static constexpr double BANDWIDTH_DECAY = 0.9;
+  static constexpr double MIN_LATENCY_TTL = 10.0;
+
+  double max_bandwidth_ = 0;  // bytes per second
+  double min_latency_ = 0;
+  double min_latency_at_ = 0;
+  double sample_start_time_ = 0;
+  int64 sample_size_ = 0;
+};
+
+}  // namespace td
@@ -23,6 +23,7 @@
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/optional.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Slice.h"
 #include "td/utils/StackAllocator.h"
@@ -31,6 +32,10 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
 namespace td {
 
 Status drop_file_db(SqliteDb &db, int32 version) {
@@ -63,112 +68,115 @@ Status init_file_db(SqliteDb &db, int32 version) {
 
 class FileDb : public FileDbInterface {
  public:
-  class FileDbActor : public Actor {
+  // file database changes are coalesced by key and are applied in a single transaction,
+  // so frequent updates of the same files don't turn into separate database writes
+  class WriteBuffer {
    public:
-    FileDbActor(FileDbId current_pmc_id, std::shared_ptr<SqliteKeyValueSafe> file_kv_safe)
-        : current_pmc_id_(current_pmc_id), file_kv_safe_(std::move(file_kv_safe)) {
+    // an empty value means that the key must be erased
+    size_t add(string key, optional<string> value) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_[std::move(key)] = std::move(value);
+      return pending_.size();
     }
 
-    void close(Promise<> promise) {
-      file_kv_safe_.reset();
-      LOG(INFO) << "FileDb is closed";
-      promise.set_value(Unit());
-      stop();
+    // returns false if there are no unsaved changes for the key
+    bool get(const string &key, string &value) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto *changes : {&pending_, &flushing_}) {
+        auto it = changes->find(key);
+        if (it != changes->end()) {
+          value = it->second ? it->second.value() : string();
+          return true;
+        }
+      }
+      return false;
     }
 
-    void load_file_data(const string &key, Promise<FileData> promise) {
-      promise.set_result(load_file_data_impl(actor_id(this), file_pmc(), key, current_pmc_id_));
-    }
+    void flush(SqliteKeyValue &pmc) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty()) {
+          return;
+        }
+        CHECK(flushing_.empty());
+        std::swap(pending_, flushing_);
+      }
 
-    void clear_file_data(FileDbId id, const string &remote_key, const string &local_key, const string &generate_key) {
-      auto &pmc = file_pmc();
+      // flushing_ is changed only by the flushing thread, so it can be read without the lock
+      LOG(DEBUG) << "Save " << flushing_.size() << " changes to file database";
       pmc.begin_transaction().ensure();
-      SCOPE_EXIT {
-        pmc.commit_transaction().ensure();
-      };
-
-      if (id > current_pmc_id_) {
-        pmc.set("file_id", to_string(id.get()));
-        current_pmc_id_ = id;
+      for (auto &it : flushing_) {
+        if (it.second) {
+          pmc.set(it.first, it.second.value());
+        } else {
+          pmc.erase(it.first);
+        }
       }
+      pmc.commit_transaction().ensure();
 
-      pmc.erase(PSTRING() << "file" << id.get());
-      LOG(DEBUG) << "ERASE " << format::as_hex_dump<4>(Slice(PSLICE() << "file" << id.get()));
-
-      if (!remote_key.empty()) {
-        pmc.erase(remote_key);
-        LOG(DEBUG) << "ERASE remote " << format::as_hex_dump<4>(Slice(remote_key));
-      }
-      if (!local_key.empty()) {
-        pmc.erase(local_key);
-        LOG(DEBUG) << "ERASE local " << format::as_hex_dump<4>(Slice(local_key));
-      }
-      if (!generate_key.empty()) {
-        pmc.erase(generate_key);
-      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      flushing_.clear();
     }
-    void store_file_data(FileDbId id, const string &file_data, const string &remote_key, const string &local_key,
-                         const string &generate_key) {
-      auto &pmc = file_pmc();
-      pmc.begin_transaction().ensure();
-      SCOPE_EXIT {
-        pmc.commit_transaction().ensure();
-      };
 
-      if (id > current_pmc_id_) {
-        pmc.set("file_id", to_string(id.get()));
-        current_pmc_id_ = id;
-      }
+   private:
+    mutable std::mutex mutex_;
+    std::unordered_map<string, optional<string>> pending_;
+    std::unordered_map<string, optional<string>> flushing_;
+  };
 
-      pmc.set(PSTRING() << "file" << id.get(), file_data);
+  class FileDbActor : public Actor {
+   public:
+    FileDbActor(std::shared_ptr<SqliteKeyValueSafe> file_kv_safe, std::shared_ptr<WriteBuffer> write_buffer)
+        : file_kv_safe_(std::move(file_kv_safe)), write_buffer_(std::move(write_buffer)) {
+    }
 
-      if (!remote_key.empty()) {
-        pmc.set(remote_key, to_string(id.get()));
-      }
-      if (!local_key.empty()) {
-        pmc.set(local_key, to_string(id.get()));
-      }
-      if (!generate_key.empty()) {
-        pmc.set(generate_key, to_string(id.get()));
-      }
+    void close(Promise<> promise) {
+      flush();
+      file_kv_safe_.reset();
+      LOG(INFO) << "FileDb is closed";
+      promise.set_value(Unit());
+      stop();
+    }
+
+    void load_file_data(const string &key, Promise<FileData> promise) {
+      flush();
+      promise.set_result(load_file_data_impl(actor_id(this), file_pmc(), *write_buffer_, key));
     }
-    void store_file_data_ref(FileDbId id, FileDbId new_id) {
-      auto &pmc = file_pmc();
-      pmc.begin_transaction().ensure();
-      SCOPE_EXIT {
-        pmc.commit_transaction().ensure();
-      };
 
-      if (id > current_pmc_id_) {
-        pmc.set("file_id", to_string(id.get()));
-        current_pmc_id_ = id;
+    void flush_later() {
+      if (!has_timeout()) {
+        set_timeout_in(MAX_FLUSH_DELAY);
       }
+    }
 
-      do_store_file_data_ref(id, new_id);
+    void flush() {
+      cancel_timeout();
+      write_buffer_->flush(file_pmc());
     }
 
     void optimize_refs(const std::vector<FileDbId> ids, FileDbId main_id) {
       LOG(INFO) << "Optimize " << ids.size() << " ids in file database to " << main_id.get();
+      flush();
       auto &pmc = file_pmc();
       pmc.begin_transaction().ensure();
       SCOPE_EXIT {
         pmc.commit_transaction().ensure();
       };
       for (size_t i = 0; i + 1 < ids.size(); i++) {
-        do_store_file_data_ref(ids[i], main_id);
+        pmc.set(get_file_data_key(ids[i]), get_file_data_ref(main_id));
       }
     }
 
    private:
-    FileDbId current_pmc_id_;
     std::shared_ptr<SqliteKeyValueSafe> file_kv_safe_;
+    std::shared_ptr<WriteBuffer> write_buffer_;
 
     SqliteKeyValue &file_pmc() {
       return file_kv_safe_->get();
     }
 
-    void do_store_file_data_ref(FileDbId id, FileDbId new_id) {
-      file_pmc().set(PSTRING() << "file" << id.get(), PSTRING() << "@@" << new_id.get());
+    void timeout_expired() override {
+      flush();
     }
   };
 
@@ -176,8 +184,9 @@ class FileDb : public FileDbInterface {
     file_kv_safe_ = std::move(kv_safe);
     CHECK(file_kv_safe_);
     current_pmc_id_ = FileDbId(to_integer<uint64>(file_kv_safe_->get().get("file_id")));
-    file_db_actor_ =
-        create_actor_on_scheduler<FileDbActor>("FileDbActor", scheduler_id, current_pmc_id_, file_kv_safe_);
+    max_saved_pmc_id_ = current_pmc_id_;
+    write_buffer_ = std::make_shared<WriteBuffer>();
+    file_db_actor_ = create_actor_on_scheduler<FileDbActor>("FileDbActor", scheduler_id, file_kv_safe_, write_buffer_);
   }
 
   FileDbId create_pmc_id() override {
@@ -194,7 +203,7 @@ class FileDb : public FileDbInterface {
   }
 
   Result<FileData> get_file_data_sync_impl(string key) override {
-    return load_file_data_impl(file_db_actor_.get(), file_kv_safe_->get(), key, current_pmc_id_);
+    return load_file_data_impl(file_db_actor_.get(), file_kv_safe_->get(), *write_buffer_, key);
   }
 
   void clear_file_data(FileDbId id, const FileData &file_data) override {
@@ -210,7 +219,21 @@ class FileDb : public FileDbInterface {
     if (file_data.generate_ != nullptr) {
       generate_key = as_key(*file_data.generate_);
     }
-    send_closure(file_db_actor_, &FileDbActor::clear_file_data, id, remote_key, local_key, generate_key);
+    LOG(DEBUG) << "ERASE " << id.get() << " " << tag("remote_key", format::as_hex_dump<4>(Slice(remote_key)))
+               << tag("local_key", format::as_hex_dump<4>(Slice(local_key)))
+               << tag("generate_key", format::as_hex_dump<4>(Slice(generate_key)));
+
+    update_max_saved_pmc_id(id);
+    write(get_file_data_key(id), optional<string>());
+    if (!remote_key.empty()) {
+      write(std::move(remote_key), optional<string>());
+    }
+    if (!local_key.empty()) {
+      write(std::move(local_key), optional<string>());
+    }
+    if (!generate_key.empty()) {
+      write(std::move(generate_key), optional<string>());
+    }
   }
   void set_file_data(FileDbId id, const FileData &file_data, bool new_remote, bool new_local,
                      bool new_generate) override {
@@ -230,38 +253,85 @@ class FileDb : public FileDbInterface {
                << tag("remote_key", format::as_hex_dump<4>(Slice(remote_key)))
                << tag("local_key", format::as_hex_dump<4>(Slice(local_key)))
                << tag("generate_key", format::as_hex_dump<4>(Slice(generate_key)));
-    send_closure(file_db_actor_, &FileDbActor::store_file_data, id, serialize(file_data), remote_key, local_key,
-                 generate_key);
+
+    update_max_saved_pmc_id(id);
+    write(get_file_data_key(id), serialize(file_data));
+    if (!remote_key.empty()) {
+      write(std::move(remote_key), to_string(id.get()));
+    }
+    if (!local_key.empty()) {
+      write(std::move(local_key), to_string(id.get()));
+    }
+    if (!generate_key.empty()) {
+      write(std::move(generate_key), to_string(id.get()));
+    }
   }
 
   void set_file_data_ref(FileDbId id, FileDbId new_id) override {
-    send_closure(file_db_actor_, &FileDbActor::store_file_data_ref, id, new_id);
+    update_max_saved_pmc_id(id);
+    write(get_file_data_key(id), get_file_data_ref(new_id));
   }
   SqliteKeyValue &pmc() override {
     return file_kv_safe_->get();
   }
 
  private:
+  static constexpr size_t MAX_PENDING_WRITES = 1000;
+  static constexpr double MAX_FLUSH_DELAY = 0.1;
+
   ActorOwn<FileDbActor> file_db_actor_;
   FileDbId current_pmc_id_;
+  FileDbId max_saved_pmc_id_;
   std::shared_ptr<SqliteKeyValueSafe> file_kv_safe_;
+  std::shared_ptr<WriteBuffer> write_buffer_;
+
+  static string get_file_data_key(FileDbId id) {
+    return PSTRING() << "file" << id.get();
+  }
+
+  static string get_file_data_ref(FileDbId id) {
+    return PSTRING() << "@@" << id.get();
+  }
+
+  void update_max_saved_pmc_id(FileDbId id) {
+    if (id > max_saved_pmc_id_) {
+      write("file_id", to_string(id.get()));
+      max_saved_pmc_id_ = id;
+    }
+  }
+
+  void write(string key, optional<string> value) {
+    auto pending_count = write_buffer_->add(std::move(key), std::move(value));
+    if (pending_count >= MAX_PENDING_WRITES) {
+      send_closure(file_db_actor_, &FileDbActor::flush);
+    } else if (pending_count == 1) {
+      send_closure(file_db_actor_, &FileDbActor::flush_later);
+    }
+  }
+
+  static string get_value(SqliteKeyValue &pmc, const WriteBuffer &write_buffer, const string &key) {
+    string value;
+    if (!write_buffer.get(key, value)) {
+      value = pmc.get(key);
+    }
+    return value;
+  }
 
   static Result<FileData> load_file_data_impl(ActorId<FileDbActor> file_db_actor_id, SqliteKeyValue &pmc,
-                                              const string &key, FileDbId current_pmc_id) {
+                                              const WriteBuffer &write_buffer, const string &key) {
     //LOG(DEBUG) << "Load by key " << format::as_hex_dump<4>(Slice(key));
-    TRY_RESULT(id, get_id(pmc, key));
+    TRY_RESULT(id, get_id(pmc, write_buffer, key));
 
     vector<FileDbId> ids;
     string data_str;
     int attempt_count = 0;
     while (true) {
       if (attempt_count > 100) {
-        LOG(FATAL) << "Cycle in file database? current_pmc_id=" << current_pmc_id << " key=" << key
-                   << " links=" << format::as_array(ids);
+        LOG(FATAL) << "Cycle in file database? key=" << key << " links=" << format::as_array(ids);
       }
       attempt_count++;
 
-      data_str = pmc.get(PSTRING() << "file" << id.get());
+      data_str = get_value(pmc, write_buffer, get_file_data_key(id));
       auto data_slice = Slice(data_str);
 
       if (data_slice.substr(0, 2) == "@@") {
@@ -290,8 +360,9 @@ class FileDb : public FileDbInterface {
     return std::move(data);
   }
 
-  static Result<FileDbId> get_id(SqliteKeyValue &pmc, const string &key) TD_WARN_UNUSED_RESULT {
-    auto id_str = pmc.get(key);
+  static Result<FileDbId> get_id(SqliteKeyValue &pmc, const WriteBuffer &write_buffer,
+                                 const string &key) TD_WARN_UNUSED_RESULT {
+    auto id_str = get_value(pmc, write_buffer, key);
     //LOG(DEBUG) << "Found id " << id_str << " by key " << format::as_hex_dump<4>(Slice(key));
     if (id_str.empty()) {
       return Status::Error("There is no such a key in database");
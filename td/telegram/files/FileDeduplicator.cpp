@@ -0,0 +1,87 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileDeduplicator.h"
+
+#include "td/telegram/files/FileDb.h"
+#include "td/telegram/files/FileLoaderUtils.h"
+#include "td/telegram/Global.h"
+#include "td/telegram/logevent/LogEvent.h"
+#include "td/telegram/TdDb.h"
+
+#include "td/db/SqliteKeyValue.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/tl_helpers.h"
+
+namespace td {
+
+namespace {
+
+struct FileContentInfo {
+  string path;
+  uint64 mtime_nsec = 0;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(path, storer);
+    td::store(mtime_nsec, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    td::parse(path, parser);
+    td::parse(mtime_nsec, parser);
+  }
+};
+
+}  // namespace
+
+void FileDeduplicator::deduplicate(string path, int64 size, Promise<Unit> promise) {
+  auto status = do_deduplicate(path, size);
+  LOG_IF(INFO, status.is_error()) << "Failed to deduplicate file \"" << path << "\": " << status;
+  promise.set_value(Unit());
+}
+
+Status FileDeduplicator::do_deduplicate(CSlice path, int64 size) {
+  TRY_RESULT(hash, get_file_sha256(path, size));
+  auto key = PSTRING() << "fcontent" << size << '#' << hex_encode(hash);
+
+  auto &pmc = G()->td_db()->get_file_db_shared()->pmc();
+  auto value = pmc.get(key);
+  if (!value.empty()) {
+    FileContentInfo info;
+    if (log_event_parse(info, value).is_ok() && info.path != path) {
+      // the file must not be changed since it was added to the index
+      auto r_stat = stat(info.path);
+      if (r_stat.is_ok() && r_stat.ok().size_ == size && r_stat.ok().mtime_nsec_ == info.mtime_nsec) {
+        string tmp_path = PSTRING() << path << ".dedup";
+        unlink(tmp_path).ignore();
+        TRY_STATUS(hard_link(info.path, tmp_path));
+        auto status = rename(tmp_path, path);
+        if (status.is_error()) {
+          unlink(tmp_path).ignore();
+          return status;
+        }
+        LOG(INFO) << "Replace file \"" << path << "\" with a hard link to \"" << info.path << '"';
+        return Status::OK();
+      }
+    }
+  }
+
+  TRY_RESULT(path_stat, stat(path));
+  FileContentInfo info;
+  info.path = path.str();
+  info.mtime_nsec = path_stat.mtime_nsec_;
+  pmc.set(key, log_event_store(info).as_slice());
+  return Status::OK();
+}
+
+}  // namespace td
@@ -0,0 +1,27 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// replaces downloaded files with hard links to previously downloaded files with the same size and SHA-256 hash
+class FileDeduplicator : public Actor {
+ public:
+  void deduplicate(string path, int64 size, Promise<Unit> promise);
+
+ private:
+  static Status do_deduplicate(CSlice path, int64 size);
+};
+
+}  // namespace td
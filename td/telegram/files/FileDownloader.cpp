@@ -8,8 +8,10 @@
 
 #include "td/telegram/telegram_api.h"
 
+#include "td/telegram/ConfigShared.h"
 #include "td/telegram/FileReferenceManager.h"
 #include "td/telegram/files/FileLoaderUtils.h"
+#include "td/telegram/files/FileLocation.hpp"
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
@@ -27,6 +29,7 @@
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/tl_helpers.h"
 #include "td/utils/UInt.h"
 
 #include <tuple>
@@ -85,6 +88,9 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
       part_size = partial.part_size_;
     }
   }
+  if (encryption_key_.is_secret()) {
+    secret_part_ivs_[next_part_] = encryption_key_.mutable_iv();
+  }
   if (search_file_ && fd_.empty() && size_ > 0 && size_ < 1000 * (1 << 20) && encryption_key_.empty() &&
       !remote_.is_web()) {
     [&] {
@@ -100,6 +106,33 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
       return Status::OK();
     }();
   }
+  if (search_file_ && fd_.empty() && size_ > 0) {
+    auto shared_path = get_shared_cache_path();
+    if (!shared_path.empty()) {
+      auto status = [&] {
+        TRY_RESULT(shared_stat, stat(shared_path));
+        if (shared_stat.size_ != size_) {
+          return Status::Error("Size mismatch");
+        }
+        string path;
+        TRY_RESULT_ASSIGN(std::tie(std::ignore, path), open_temp_file(remote_.file_type_));
+        unlink(path).ignore();
+        TRY_STATUS(hard_link(shared_path, path));
+        TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+        // the file hashes are received from the server, so the file reference must be valid to use the file
+        LOG(INFO) << "Check hash of file " << shared_path << " from the shared cache";
+        path_ = std::move(path);
+        fd_ = std::move(fd);
+        need_check_ = true;
+        only_check_ = true;
+        is_from_shared_cache_ = true;
+        part_size = 32 * (1 << 10);
+        bitmask = Bitmask{Bitmask::Ones{}, (size_ + part_size - 1) / part_size};
+        return Status::OK();
+      }();
+      LOG_IF(DEBUG, status.is_error()) << "Can't use the shared cache file " << shared_path << ": " << status;
+    }
+  }
 
   FileInfo res;
   res.size = size_;
@@ -124,6 +157,7 @@ Status FileDownloader::on_ok(int64 size) {
 
   std::string path;
   fd_.close();
+  part_writer_.reset();
   if (encryption_key_.is_secure()) {
     TRY_RESULT(file_path, open_temp_file(remote_.file_type_));
     string tmp_path;
@@ -134,17 +168,68 @@ Status FileDownloader::on_ok(int64 size) {
     TRY_RESULT(path_stat, stat(path_));
     size = path_stat.size_;
   }
-  if (only_check_) {
+  if (only_check_ && !is_from_shared_cache_) {
     path = path_;
   } else {
     TRY_RESULT_ASSIGN(path, create_from_temp(path_, dir, name_));
   }
-  callback_->on_ok(FullLocalFileLocation(remote_.file_type_, std::move(path), 0), size, !only_check_);
+  if (!only_check_ && size > 0 && G()->parameters().use_file_db &&
+      get_file_dir_type(remote_.file_type_) == FileDirType::Common &&
+      G()->shared_config().get_option_boolean("deduplicate_downloaded_files")) {
+    // the file must be deduplicated before its location and modification time are registered
+    deduplicator_ = create_actor_on_scheduler<FileDeduplicator>("FileDeduplicator", G()->get_gc_scheduler_id());
+    send_closure(deduplicator_, &FileDeduplicator::deduplicate, path, size,
+                 PromiseCreator::lambda([actor_id = actor_id(this), path, size](Result<Unit> result) {
+                   send_closure(actor_id, &FileDownloader::on_file_deduplicated, std::move(path), size);
+                 }));
+    return Status::OK();
+  }
+  if (!only_check_) {
+    add_to_shared_cache(path);
+  }
+  callback_->on_ok(FullLocalFileLocation(remote_.file_type_, std::move(path), 0), size,
+                   !only_check_ || is_from_shared_cache_);
   return Status::OK();
 }
 
+void FileDownloader::on_file_deduplicated(string path, int64 size) {
+  deduplicator_.reset();
+  add_to_shared_cache(path);
+  callback_->on_ok(FullLocalFileLocation(remote_.file_type_, std::move(path), 0), size, true);
+}
+
+string FileDownloader::get_shared_cache_path() const {
+  if (remote_.is_web() || !encryption_key_.empty() || get_file_dir_type(remote_.file_type_) != FileDirType::Common) {
+    return string();
+  }
+  auto dir = G()->shared_config().get_option_string("shared_files_cache_directory");
+  if (dir.empty()) {
+    return string();
+  }
+  if (dir.back() != TD_DIR_SLASH) {
+    dir += TD_DIR_SLASH;
+  }
+
+  // the access hash is a part of the key, so only clients, which have received the file, can find it
+  auto key = serialize(remote_.as_key());
+  key += PSTRING() << '#' << remote_.get_access_hash();
+  string hash(32, '\0');
+  sha256(key, hash);
+  return dir + hex_encode(hash);
+}
+
+void FileDownloader::add_to_shared_cache(CSlice path) {
+  auto shared_path = get_shared_cache_path();
+  if (shared_path.empty()) {
+    return;
+  }
+  // fails if the file is already in the cache
+  hard_link(path, shared_path).ignore();
+}
+
 void FileDownloader::on_error(Status status) {
   fd_.close();
+  part_writer_.reset();
   callback_->on_error(std::move(status));
 }
 
@@ -299,7 +384,46 @@ Status FileDownloader::check_net_query(NetQueryPtr &net_query) {
   return Status::OK();
 }
 
-Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
+void FileDownloader::process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) {
+  TRY_RESULT_PROMISE(promise, data, get_part_data(part, std::move(net_query)));
+  if (data.empty()) {
+    return promise.set_value(0);
+  }
+
+  TRY_STATUS_PROMISE(promise, acquire_fd());
+  LOG(INFO) << "Got " << data.size() << " bytes at offset " << part.offset << " for \"" << path_ << '"';
+  if (part_writer_.empty()) {
+    if (encryption_key_.is_secret()) {
+      part_writer_ = create_actor_on_scheduler<FilePartWriter>("FilePartWriter", G()->get_gc_scheduler_id(), path_,
+                                                               encryption_key_.key(), encryption_key_.mutable_iv());
+    } else {
+      part_writer_ = create_actor_on_scheduler<FilePartWriter>("FilePartWriter", G()->get_gc_scheduler_id(), path_);
+    }
+  }
+  // the part is considered to be ready only after it is written to the file
+  if (encryption_key_.is_secret()) {
+    // may be less than the padded size, when size of downloadable file is unknown
+    auto size = min(data.size(), part.size);
+    send_closure(part_writer_, &FilePartWriter::decrypt_and_write, std::move(data), part.offset, size,
+                 PromiseCreator::lambda([actor_id = actor_id(this), part_id = part.id, size,
+                                         promise = std::move(promise)](Result<UInt256> r_iv) mutable {
+                   if (r_iv.is_error()) {
+                     return promise.set_error(r_iv.move_as_error());
+                   }
+                   send_closure(actor_id, &FileDownloader::on_secret_part_written, part_id, r_iv.move_as_ok(), size,
+                                std::move(promise));
+                 }));
+  } else {
+    send_closure(part_writer_, &FilePartWriter::write, std::move(data), part.offset, std::move(promise));
+  }
+}
+
+void FileDownloader::on_secret_part_written(int32 part_id, UInt256 iv, size_t size, Promise<size_t> promise) {
+  secret_part_ivs_[part_id + 1] = iv;
+  promise.set_value(std::move(size));
+}
+
+Result<BufferSlice> FileDownloader::get_part_data(Part part, NetQueryPtr net_query) {
   TRY_STATUS(check_net_query(net_query));
 
   BufferSlice bytes;
@@ -340,7 +464,7 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
     return Status::Error("Part size is more than requested");
   }
   if (bytes.empty()) {
-    return 0;
+    return BufferSlice();
   }
 
   // Encryption
@@ -363,20 +487,12 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
     if (part.size % 16 != 0) {
       next_part_stop_ = true;
     }
-    aes_ige_decrypt(as_slice(encryption_key_.key()), as_slice(encryption_key_.mutable_iv()), bytes.as_slice(),
-                    bytes.as_slice());
+    // the part is decrypted by FilePartWriter and is truncated to part.size after the decryption
+    return std::move(bytes);
   }
 
-  auto slice = bytes.as_slice().truncate(part.size);
-  TRY_STATUS(acquire_fd());
-  LOG(INFO) << "Got " << slice.size() << " bytes at offset " << part.offset << " for \"" << path_ << '"';
-  TRY_RESULT(written, fd_.pwrite(slice, part.offset));
-  LOG(INFO) << "Written " << written << " bytes";
-  // may write less than part.size, when size of downloadable file is unknown
-  if (written != slice.size()) {
-    return Status::Error("Failed to save file part to the file");
-  }
-  return written;
+  // may be less than part.size, when size of downloadable file is unknown
+  return bytes.from_slice(bytes.as_slice().truncate(part.size));
 }
 
 void FileDownloader::on_progress(Progress progress) {
@@ -392,12 +508,14 @@ void FileDownloader::on_progress(Progress progress) {
         PartialLocalFileLocation{remote_.file_type_, progress.part_size, path_, "", std::move(progress.ready_bitmask)},
         progress.ready_size, progress.size);
   } else if (encryption_key_.is_secret()) {
-    UInt256 iv;
-    if (progress.ready_part_count == next_part_) {
-      iv = encryption_key_.mutable_iv();
-    } else {
-      LOG(FATAL) << tag("ready_part_count", progress.ready_part_count) << tag("next_part", next_part_);
-    }
+    // parts can be already sent to FilePartWriter, so the IV must correspond to the ready parts;
+    // empty parts don't change the IV
+    auto it = secret_part_ivs_.upper_bound(progress.ready_part_count);
+    LOG_CHECK(it != secret_part_ivs_.begin()) << tag("ready_part_count", progress.ready_part_count)
+                                              << tag("next_part", next_part_);
+    --it;
+    UInt256 iv = it->second;
+    secret_part_ivs_.erase(secret_part_ivs_.begin(), it);
     callback_->on_partial_download(PartialLocalFileLocation{remote_.file_type_, progress.part_size, path_,
                                                             as_slice(iv).str(), std::move(progress.ready_bitmask)},
                                    progress.ready_size, progress.size);
@@ -412,7 +530,17 @@ FileLoader::Callback *FileDownloader::get_callback() {
 
 Status FileDownloader::process_check_query(NetQueryPtr net_query) {
   has_hash_query_ = false;
-  TRY_STATUS(check_net_query(net_query));
+  bool is_prefetch = is_hash_query_prefetch_;
+  is_hash_query_prefetch_ = false;
+  auto status = check_net_query(net_query);
+  if (status.is_error()) {
+    if (is_prefetch) {
+      // hashes will be requested again when they are needed
+      LOG(INFO) << "Failed to prefetch file hashes: " << status;
+      return Status::OK();
+    }
+    return status;
+  }
   TRY_RESULT(file_hashes, fetch_result<telegram_api::upload_getCdnFileHashes>(std::move(net_query)));
   add_hash_info(file_hashes);
   return Status::OK();
@@ -468,21 +596,42 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
     }
     if (!has_hash_query_) {
       has_hash_query_ = true;
-      auto query =
-          telegram_api::upload_getFileHashes(remote_.as_input_file_location(), narrow_cast<int32>(checked_prefix_size));
-      auto net_query_type = is_small_ ? NetQuery::Type::DownloadSmall : NetQuery::Type::Download;
-      auto net_query = G()->net_query_creator().create(query, remote_.get_dc_id(), net_query_type);
-      info.queries.push_back(std::move(net_query));
+      info.queries.push_back(create_hash_query(checked_prefix_size));
       break;
     }
     // Should fail?
     break;
   }
+  if (!has_hash_query_ && !is_ready && !hash_info_.empty()) {
+    // request hashes of the next parts before they are downloaded, so they can be checked without waiting
+    auto &last_hash_info = *hash_info_.rbegin();
+    auto hashed_size = last_hash_info.offset + narrow_cast<int64>(last_hash_info.size);
+    bool is_last_hash = last_hash_info.size < hash_info_.begin()->size;
+    if (!is_last_hash && hashed_size < ready_prefix_size + HASH_PREFETCH_SIZE &&
+        hashed_size != last_prefetched_hash_offset_) {
+      last_prefetched_hash_offset_ = hashed_size;
+      has_hash_query_ = true;
+      is_hash_query_prefetch_ = true;
+      info.queries.push_back(create_hash_query(hashed_size));
+    }
+  }
   info.need_check = need_check_;
   info.checked_prefix_size = checked_prefix_size;
   return std::move(info);
 }
 
+NetQueryPtr FileDownloader::create_hash_query(int64 offset) {
+  auto net_query_type = is_small_ ? NetQuery::Type::DownloadSmall : NetQuery::Type::Download;
+  if (use_cdn_) {
+    return G()->net_query_creator().create(
+        telegram_api::upload_getCdnFileHashes(BufferSlice(cdn_file_token_), narrow_cast<int32>(offset)),
+        remote_.get_dc_id(), net_query_type);
+  }
+  return G()->net_query_creator().create(
+      telegram_api::upload_getFileHashes(remote_.as_input_file_location(), narrow_cast<int32>(offset)),
+      remote_.get_dc_id(), net_query_type);
+}
+
 void FileDownloader::add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::fileHash>> &hashes) {
   for (auto &hash : hashes) {
     //LOG(ERROR) << "ADD HASH " << hash->offset_ << "->" << hash->limit_;
@@ -496,6 +645,13 @@ void FileDownloader::add_hash_info(const std::vector<telegram_api::object_ptr<te
 
 void FileDownloader::keep_fd_flag(bool keep_fd) {
   keep_fd_ = keep_fd;
+  if (!keep_fd_) {
+    // the file will be closed after all already sent parts are written;
+    // the writer itself is kept, because it can keep decryption state of the file
+    if (!part_writer_.empty()) {
+      send_closure(part_writer_, &FilePartWriter::close_fd);
+    }
+  }
   try_release_fd();
 }
 
@@ -9,7 +9,9 @@
 #include "td/telegram/telegram_api.h"
 
 #include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileDeduplicator.h"
 #include "td/telegram/files/FileLoader.h"
+#include "td/telegram/files/FilePartWriter.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/NetQuery.h"
@@ -17,6 +19,7 @@
 #include "td/utils/common.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/Status.h"
+#include "td/utils/UInt.h"
 
 #include <map>
 #include <set>
@@ -49,12 +52,16 @@ class FileDownloader : public FileLoader {
   FileEncryptionKey encryption_key_;
   unique_ptr<Callback> callback_;
   bool only_check_{false};
+  bool is_from_shared_cache_{false};
 
   string path_;
   FileFd fd_;
+  ActorOwn<FilePartWriter> part_writer_;
+  ActorOwn<FileDeduplicator> deduplicator_;
 
   int32 next_part_ = 0;
   bool next_part_stop_ = false;
+  std::map<int32, UInt256> secret_part_ivs_;  // part count -> IV for decryption of the next part
   bool is_small_;
   bool search_file_{false};
   int64 offset_;
@@ -80,14 +87,27 @@ class FileDownloader : public FileLoader {
   };
   std::set<HashInfo> hash_info_;
   bool has_hash_query_ = false;
+  bool is_hash_query_prefetch_ = false;
+  int64 last_prefetched_hash_offset_ = -1;
+
+  // hashes are requested in advance for the next HASH_PREFETCH_SIZE bytes after the downloaded prefix
+  static constexpr int64 HASH_PREFETCH_SIZE = 4 << 20;
+
+  NetQueryPtr create_hash_query(int64 offset);
 
   Result<FileInfo> init() override TD_WARN_UNUSED_RESULT;
   Status on_ok(int64 size) override TD_WARN_UNUSED_RESULT;
+  void on_file_deduplicated(string path, int64 size);
+
+  string get_shared_cache_path() const;
+  void add_to_shared_cache(CSlice path);
   void on_error(Status status) override;
   Result<bool> should_restart_part(Part part, NetQueryPtr &net_query) override TD_WARN_UNUSED_RESULT;
   Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int32 part_count,
                                                   int64 streaming_offset) override TD_WARN_UNUSED_RESULT;
-  Result<size_t> process_part(Part part, NetQueryPtr net_query) override TD_WARN_UNUSED_RESULT;
+  void process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) override;
+  void on_secret_part_written(int32 part_id, UInt256 iv, size_t size, Promise<size_t> promise);
+  Result<BufferSlice> get_part_data(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT;
   void on_progress(Progress progress) override;
   FileLoader::Callback *get_callback() override;
   Status process_check_query(NetQueryPtr net_query) override;
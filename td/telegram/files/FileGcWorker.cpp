@@ -21,18 +21,26 @@
 
 #include <algorithm>
 #include <array>
+#include <queue>
+#include <utility>
 
 namespace td {
 
 int VERBOSITY_NAME(file_gc) = VERBOSITY_NAME(INFO);
 
+namespace {
+// maximum time spent on file removal before yielding to other actors
+constexpr double MAX_GC_BATCH_TIME = 0.05;
+}  // namespace
+
 void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFileInfo> files,
                           Promise<FileGcResult> promise) {
-  auto begin_time = Time::now();
+  if (promise_) {
+    return promise.set_error(Status::Error(500, "Files gc is already running"));
+  }
+
+  begin_time_ = Time::now();
   VLOG(file_gc) << "Start files gc with " << parameters;
-  // quite stupid implementations
-  // needs a lot of memory
-  // may write something more clever, but i will need at least 2 passes over the files
   // TODO update atime for all files in android (?)
 
   std::array<bool, MAX_FILE_TYPE> immune_types{{false}};
@@ -63,130 +71,207 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
     immune_types[narrow_cast<size_t>(FileType::EncryptedThumbnail)] = true;
   }
 
-  auto file_cnt = files.size();
-  int32 type_immunity_ignored_cnt = 0;
-  int32 time_immunity_ignored_cnt = 0;
-  int32 exclude_owner_dialog_id_ignored_cnt = 0;
-  int32 owner_dialog_id_ignored_cnt = 0;
-  int32 remove_by_atime_cnt = 0;
-  int32 remove_by_count_cnt = 0;
-  int32 remove_by_size_cnt = 0;
-  int64 total_removed_size = 0;
-  int64 total_size = 0;
-  for (auto &info : files) {
-    if (info.atime_nsec < info.mtime_nsec) {
-      info.atime_nsec = info.mtime_nsec;
-    }
-    total_size += info.size;
-  }
-
-  FileStats new_stats;
-  FileStats removed_stats;
-  removed_stats.split_by_owner_dialog_id = new_stats.split_by_owner_dialog_id = parameters.dialog_limit != 0;
+  file_cnt_ = files.size();
+  type_immunity_ignored_cnt_ = 0;
+  time_immunity_ignored_cnt_ = 0;
+  exclude_owner_dialog_id_ignored_cnt_ = 0;
+  owner_dialog_id_ignored_cnt_ = 0;
+  remove_by_atime_cnt_ = 0;
+  remove_by_count_cnt_ = 0;
+  remove_by_size_cnt_ = 0;
+  total_removed_size_ = 0;
+  total_size_ = 0;
 
-  auto do_remove_file = [&removed_stats](const FullFileInfo &info) {
-    removed_stats.add_copy(info);
-    auto status = unlink(info.path);
-    LOG_IF(WARNING, status.is_error()) << "Failed to unlink file \"" << info.path << "\" during files gc: " << status;
-    send_closure(G()->file_manager(), &FileManager::on_file_unlink,
-                 FullLocalFileLocation(info.file_type, info.path, info.mtime_nsec));
-  };
+  new_stats_ = FileStats();
+  removed_stats_ = FileStats();
+  removed_stats_.split_by_owner_dialog_id = new_stats_.split_by_owner_dialog_id = parameters.dialog_limit != 0;
 
   double now = Clocks::system();
 
-  // Keep all immune files
-  // Remove all files with (atime > now - max_time_from_last_access)
-  td::remove_if(files, [&](const FullFileInfo &info) {
-    if (token_) {
-      return false;
-    }
+  enum class FileState : int32 {
+    TypeImmune,
+    ExcludedOwnerImmune,
+    OwnerImmune,
+    TimeImmune,
+    RemovedByAtime,
+    GcCandidate
+  };
+  auto get_file_state = [&](const FullFileInfo &info) {
     if (immune_types[narrow_cast<size_t>(info.file_type)]) {
-      type_immunity_ignored_cnt++;
-      new_stats.add_copy(info);
-      return true;
+      return FileState::TypeImmune;
     }
     if (td::contains(parameters.exclude_owner_dialog_ids, info.owner_dialog_id)) {
-      exclude_owner_dialog_id_ignored_cnt++;
-      new_stats.add_copy(info);
-      return true;
+      return FileState::ExcludedOwnerImmune;
     }
     if (!parameters.owner_dialog_ids.empty() && !td::contains(parameters.owner_dialog_ids, info.owner_dialog_id)) {
-      owner_dialog_id_ignored_cnt++;
-      new_stats.add_copy(info);
-      return true;
+      return FileState::OwnerImmune;
     }
     if (static_cast<double>(info.mtime_nsec) * 1e-9 > now - parameters.immunity_delay) {
       // new files are immune to gc
-      time_immunity_ignored_cnt++;
-      new_stats.add_copy(info);
-      return true;
+      return FileState::TimeImmune;
     }
-
     if (static_cast<double>(info.atime_nsec) * 1e-9 < now - parameters.max_time_from_last_access) {
-      do_remove_file(info);
-      total_removed_size += info.size;
-      remove_by_atime_cnt++;
-      return true;
+      return FileState::RemovedByAtime;
     }
-    return false;
-  });
-  if (token_) {
-    return promise.set_error(Status::Error(500, "Request aborted"));
-  }
+    return FileState::GcCandidate;
+  };
 
-  // sort by max(atime, mtime)
-  std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) { return a.atime_nsec < b.atime_nsec; });
+  // the first pass finds out, how many files and bytes must be removed to satisfy the limits
+  size_t candidate_count = 0;
+  int64 candidate_size = 0;
+  for (auto &info : files) {
+    if (token_) {
+      return promise.set_error(Status::Error(500, "Request aborted"));
+    }
+    if (info.atime_nsec < info.mtime_nsec) {
+      info.atime_nsec = info.mtime_nsec;
+    }
+    total_size_ += info.size;
+    if (get_file_state(info) == FileState::GcCandidate) {
+      candidate_count++;
+      candidate_size += info.size;
+    }
+  }
 
   // 1. Total size must be less than parameters.max_files_size
   // 2. Total file count must be less than parameters.max_file_count
   size_t remove_count = 0;
-  if (files.size() > parameters.max_file_count) {
-    remove_count = files.size() - parameters.max_file_count;
-  }
-  int64 remove_size = -parameters.max_files_size;
-  for (auto &file : files) {
-    remove_size += file.size;
+  if (candidate_count > parameters.max_file_count) {
+    remove_count = candidate_count - parameters.max_file_count;
   }
+  int64 remove_size = candidate_size - parameters.max_files_size;
 
-  size_t pos = 0;
-  while (pos < files.size() && (remove_count > 0 || remove_size > 0)) {
+  // the second pass keeps in a heap only the oldest files by max(atime, mtime), which are needed to satisfy the limits,
+  // so there is no need to sort all the files
+  std::priority_queue<std::pair<uint64, size_t>> oldest_files;
+  int64 oldest_files_size = 0;
+  vector<size_t> removed_by_atime;
+  for (size_t i = 0; i < files.size(); i++) {
     if (token_) {
       return promise.set_error(Status::Error(500, "Request aborted"));
     }
-    if (remove_count > 0) {
-      remove_by_count_cnt++;
-    } else {
-      remove_by_size_cnt++;
+    const auto &info = files[i];
+    switch (get_file_state(info)) {
+      case FileState::TypeImmune:
+        type_immunity_ignored_cnt_++;
+        new_stats_.add_copy(info);
+        break;
+      case FileState::ExcludedOwnerImmune:
+        exclude_owner_dialog_id_ignored_cnt_++;
+        new_stats_.add_copy(info);
+        break;
+      case FileState::OwnerImmune:
+        owner_dialog_id_ignored_cnt_++;
+        new_stats_.add_copy(info);
+        break;
+      case FileState::TimeImmune:
+        time_immunity_ignored_cnt_++;
+        new_stats_.add_copy(info);
+        break;
+      case FileState::RemovedByAtime:
+        removed_by_atime.push_back(i);
+        break;
+      case FileState::GcCandidate:
+        oldest_files.emplace(info.atime_nsec, i);
+        oldest_files_size += info.size;
+        while (oldest_files.size() > remove_count) {
+          const auto &newest_info = files[oldest_files.top().second];
+          if (oldest_files_size - newest_info.size < remove_size) {
+            break;
+          }
+          oldest_files_size -= newest_info.size;
+          new_stats_.add_copy(newest_info);
+          oldest_files.pop();
+        }
+        break;
+      default:
+        UNREACHABLE();
     }
+  }
 
-    if (remove_count > 0) {
-      remove_count--;
-    }
-    remove_size -= files[pos].size;
+  files_to_remove_.clear();
+  files_to_remove_.reserve(removed_by_atime.size() + oldest_files.size());
+  for (auto i : removed_by_atime) {
+    files_to_remove_.push_back(std::move(files[i]));
+  }
+  auto old_file_pos = files_to_remove_.size();
+  files_to_remove_.resize(old_file_pos + oldest_files.size());
+  for (auto pos = files_to_remove_.size(); pos > old_file_pos; pos--) {
+    files_to_remove_[pos - 1] = std::move(files[oldest_files.top().second]);
+    oldest_files.pop();
+  }
+  remove_by_atime_cnt_ = narrow_cast<int32>(removed_by_atime.size());
+  remove_by_count_left_ = remove_count;
+  remove_pos_ = 0;
+  reset_to_empty(files);
+
+  promise_ = std::move(promise);
+  loop();
+}
+
+void FileGcWorker::remove_file(const FullFileInfo &info) {
+  removed_stats_.add_copy(info);
+  total_removed_size_ += info.size;
+  auto status = unlink(info.path);
+  LOG_IF(WARNING, status.is_error()) << "Failed to unlink file \"" << info.path << "\" during files gc: " << status;
+  send_closure(G()->file_manager(), &FileManager::on_file_unlink,
+               FullLocalFileLocation(info.file_type, info.path, info.mtime_nsec));
+}
 
-    total_removed_size += files[pos].size;
-    do_remove_file(files[pos]);
-    pos++;
+void FileGcWorker::loop() {
+  if (!promise_) {
+    return;
   }
 
-  while (pos < files.size()) {
-    new_stats.add_copy(files[pos]);
-    pos++;
+  // remove files in batches to not block other actors on the scheduler for a long time
+  auto batch_end_time = Time::now() + MAX_GC_BATCH_TIME;
+  auto by_atime_count = static_cast<size_t>(remove_by_atime_cnt_);
+  while (remove_pos_ < files_to_remove_.size()) {
+    if (token_) {
+      return finish_gc(Status::Error(500, "Request aborted"));
+    }
+    if (remove_pos_ >= by_atime_count) {
+      if (remove_by_count_left_ > 0) {
+        remove_by_count_left_--;
+        remove_by_count_cnt_++;
+      } else {
+        remove_by_size_cnt_++;
+      }
+    }
+
+    remove_file(files_to_remove_[remove_pos_]);
+    reset_to_empty(files_to_remove_[remove_pos_].path);
+    remove_pos_++;
+
+    if (remove_pos_ < files_to_remove_.size() && Time::now() >= batch_end_time) {
+      return yield();
+    }
   }
 
   auto end_time = Time::now();
 
-  VLOG(file_gc) << "Finish files gc: " << tag("time", end_time - begin_time) << tag("total", file_cnt)
-                << tag("removed", remove_by_atime_cnt + remove_by_count_cnt + remove_by_size_cnt)
-                << tag("total_size", format::as_size(total_size))
-                << tag("total_removed_size", format::as_size(total_removed_size))
-                << tag("by_atime", remove_by_atime_cnt) << tag("by_count", remove_by_count_cnt)
-                << tag("by_size", remove_by_size_cnt) << tag("type_immunity", type_immunity_ignored_cnt)
-                << tag("time_immunity", time_immunity_ignored_cnt)
-                << tag("owner_dialog_id_immunity", owner_dialog_id_ignored_cnt)
-                << tag("exclude_owner_dialog_id_immunity", exclude_owner_dialog_id_ignored_cnt);
-
-  promise.set_value({std::move(new_stats), std::move(removed_stats)});
+  VLOG(file_gc) << "Finish files gc: " << tag("time", end_time - begin_time_) << tag("total", file_cnt_)
+                << tag("removed", remove_by_atime_cnt_ + remove_by_count_cnt_ + remove_by_size_cnt_)
+                << tag("total_size", format::as_size(total_size_))
+                << tag("total_removed_size", format::as_size(total_removed_size_))
+                << tag("by_atime", remove_by_atime_cnt_) << tag("by_count", remove_by_count_cnt_)
+                << tag("by_size", remove_by_size_cnt_) << tag("type_immunity", type_immunity_ignored_cnt_)
+                << tag("time_immunity", time_immunity_ignored_cnt_)
+                << tag("owner_dialog_id_immunity", owner_dialog_id_ignored_cnt_)
+                << tag("exclude_owner_dialog_id_immunity", exclude_owner_dialog_id_ignored_cnt_);
+
+  finish_gc(FileGcResult{std::move(new_stats_), std::move(removed_stats_)});
+}
+
+void FileGcWorker::finish_gc(Result<FileGcResult> result) {
+  reset_to_empty(files_to_remove_);
+  remove_pos_ = 0;
+  remove_by_count_left_ = 0;
+  new_stats_ = FileStats();
+  removed_stats_ = FileStats();
+
+  auto promise = std::move(promise_);
+  promise.set_result(std::move(result));
 }
 
 }  // namespace td
@@ -13,6 +13,7 @@
 #include "td/telegram/files/FileStats.h"
 
 #include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
 
 namespace td {
@@ -33,6 +34,32 @@ class FileGcWorker : public Actor {
  private:
   ActorShared<> parent_;
   CancellationToken token_;
+
+  // state of the currently running files gc
+  Promise<FileGcResult> promise_;
+  FileStats new_stats_;
+  FileStats removed_stats_;
+  vector<FullFileInfo> files_to_remove_;  // files removed by atime followed by the oldest files in order of atime
+  size_t remove_pos_ = 0;
+  size_t remove_by_count_left_ = 0;
+
+  double begin_time_ = 0;
+  size_t file_cnt_ = 0;
+  int32 type_immunity_ignored_cnt_ = 0;
+  int32 time_immunity_ignored_cnt_ = 0;
+  int32 exclude_owner_dialog_id_ignored_cnt_ = 0;
+  int32 owner_dialog_id_ignored_cnt_ = 0;
+  int32 remove_by_atime_cnt_ = 0;
+  int32 remove_by_count_cnt_ = 0;
+  int32 remove_by_size_cnt_ = 0;
+  int64 total_removed_size_ = 0;
+  int64 total_size_ = 0;
+
+  void loop() override;
+
+  void remove_file(const FullFileInfo &info);
+
+  void finish_gc(Result<FileGcResult> result);
 };
 
 }  // namespace td
@@ -29,6 +29,7 @@
 #include "td/utils/Slice.h"
 
 #include <cmath>
+#include <limits>
 #include <memory>
 #include <utility>
 
@@ -241,6 +242,124 @@ class MapDownloadGenerateActor : public FileGenerateActor {
   }
 };
 
+class FileCopyGenerateActor : public FileGenerateActor {
+ public:
+  FileCopyGenerateActor(const FullGenerateFileLocation &generate_location, const LocalFileLocation &local_location,
+                        string name, unique_ptr<FileGenerateCallback> callback, ActorShared<> parent)
+      : generate_location_(generate_location)
+      , local_(local_location)
+      , name_(std::move(name))
+      , callback_(std::move(callback))
+      , parent_(std::move(parent)) {
+  }
+  void file_generate_progress(int32 expected_size, int32 local_prefix_size, Promise<> promise) override {
+    UNREACHABLE();
+  }
+  void file_generate_finish(Status status, Promise<> promise) override {
+    UNREACHABLE();
+  }
+
+ private:
+  // progress is reported once per copied chunk
+  static constexpr int64 CHUNK_SIZE = 8 << 20;
+
+  FullGenerateFileLocation generate_location_;
+  LocalFileLocation local_;
+  string name_;
+  unique_ptr<FileGenerateCallback> callback_;
+  ActorShared<> parent_;
+
+  FileFd from_fd_;
+  FileFd to_fd_;
+  string path_;
+  int64 size_ = 0;
+  int64 offset_ = 0;
+
+  void start_up() override {
+    if (local_.type() == LocalFileLocation::Type::Full) {
+      callback_->on_ok(local_.full());
+      callback_.reset();
+      return stop();
+    }
+    if (local_.type() == LocalFileLocation::Type::Partial) {
+      LOG(INFO) << "Unlink partially generated file at " << local_.partial().path_;
+      unlink(local_.partial().path_).ignore();
+    }
+
+    LOG(INFO) << "Generate by copying \"" << generate_location_.original_path_ << '"';
+    auto status = do_start_up();
+    if (status.is_error()) {
+      return on_error(std::move(status));
+    }
+    loop();
+  }
+
+  Status do_start_up() {
+    TRY_RESULT_ASSIGN(from_fd_, FileFd::open(generate_location_.original_path_, FileFd::Read));
+    TRY_RESULT_ASSIGN(size_, from_fd_.get_size());
+    if (size_ > std::numeric_limits<int32>::max()) {
+      return Status::Error("File is too big");
+    }
+    TRY_RESULT(file_path, open_temp_file(generate_location_.file_type_));
+    to_fd_ = std::move(file_path.first);
+    path_ = std::move(file_path.second);
+    return Status::OK();
+  }
+
+  void loop() override {
+    auto status = copy_chunk();
+    if (status.is_error()) {
+      return on_error(std::move(status));
+    }
+    if (offset_ < size_) {
+      callback_->on_partial_generate(
+          PartialLocalFileLocation{generate_location_.file_type_, narrow_cast<int32>(offset_), path_, "",
+                                   Bitmask(Bitmask::Ones{}, 1).encode()},
+          narrow_cast<int32>(size_));
+      // let other actors run between the chunks
+      return yield();
+    }
+
+    from_fd_.close();
+    to_fd_.close();
+    auto r_perm_path = create_from_temp(path_, get_files_dir(generate_location_.file_type_), name_);
+    if (r_perm_path.is_error()) {
+      return on_error(r_perm_path.move_as_error());
+    }
+    callback_->on_ok(FullLocalFileLocation(generate_location_.file_type_, r_perm_path.move_as_ok(), 0));
+    callback_.reset();
+    stop();
+  }
+
+  Status copy_chunk() {
+    auto end_offset = min(offset_ + CHUNK_SIZE, size_);
+    while (offset_ < end_offset) {
+      TRY_RESULT(copied_size,
+                 from_fd_.copy_to(to_fd_, offset_, offset_, narrow_cast<size_t>(end_offset - offset_)));
+      if (copied_size == 0) {
+        return Status::Error("File was truncated during copying");
+      }
+      offset_ += static_cast<int64>(copied_size);
+    }
+    return Status::OK();
+  }
+
+  void hangup() override {
+    on_error(Status::Error(1, "Cancelled"));
+  }
+
+  void on_error(Status status) {
+    if (!path_.empty()) {
+      LOG(INFO) << "Unlink partially generated file at " << path_ << " because of " << status;
+      to_fd_.close();
+      unlink(path_).ignore();
+    }
+    callback_->on_error(std::move(status));
+    callback_.reset();
+    stop();
+  }
+};
+
 class FileExternalGenerateActor : public FileGenerateActor {
  public:
   FileExternalGenerateActor(uint64 query_id, const FullGenerateFileLocation &generate_location,
@@ -414,12 +533,19 @@ void FileGenerateManager::generate_file(uint64 query_id, FullGenerateFileLocatio
   CHECK(query_id != 0);
   auto it_flag = query_id_to_query_.emplace(query_id, Query{});
   LOG_CHECK(it_flag.second) << "Query id must be unique";
-  auto parent = actor_shared(this, query_id);
 
   Slice file_id_query = "#file_id#";
   Slice conversion = generate_location.conversion_;
 
   auto &query = it_flag.first->second;
+  if (conversion == "#file_copy#" && !generate_location.original_path_.empty()) {
+    query.is_file_copy_ = true;
+    pending_file_copies_.push_back(PendingFileCopy{query_id, std::move(generate_location), local_location,
+                                                   std::move(name), std::move(callback)});
+    return try_start_file_copies();
+  }
+
+  auto parent = actor_shared(this, query_id);
   if (begins_with(conversion, file_id_query)) {
     auto file_id = FileId(to_integer<int32>(conversion.substr(file_id_query.size())), 0);
     query.worker_ = create_actor<FileDownloadGenerateActor>("FileDownloadGenerateActor", generate_location.file_type_,
@@ -434,11 +560,38 @@ void FileGenerateManager::generate_file(uint64 query_id, FullGenerateFileLocatio
   }
 }
 
+void FileGenerateManager::try_start_file_copies() {
+  while (active_file_copy_count_ < MAX_ACTIVE_FILE_COPY_COUNT && !pending_file_copies_.empty()) {
+    auto file_copy = std::move(pending_file_copies_.front());
+    pending_file_copies_.pop_front();
+
+    auto it = query_id_to_query_.find(file_copy.query_id);
+    CHECK(it != query_id_to_query_.end());
+    active_file_copy_count_++;
+    it->second.worker_ = create_actor_on_scheduler<FileCopyGenerateActor>(
+        "FileCopyGenerateActor", G()->get_gc_scheduler_id(), file_copy.generate_location, file_copy.local_location,
+        std::move(file_copy.name), std::move(file_copy.callback), actor_shared(this, file_copy.query_id));
+  }
+}
+
 void FileGenerateManager::cancel(uint64 query_id) {
   auto it = query_id_to_query_.find(query_id);
   if (it == query_id_to_query_.end()) {
     return;
   }
+  if (it->second.is_file_copy_ && it->second.worker_.empty()) {
+    for (auto file_copy_it = pending_file_copies_.begin(); file_copy_it != pending_file_copies_.end();
+         ++file_copy_it) {
+      if (file_copy_it->query_id == query_id) {
+        auto callback = std::move(file_copy_it->callback);
+        pending_file_copies_.erase(file_copy_it);
+        query_id_to_query_.erase(it);
+        callback->on_error(Status::Error(1, "Cancelled"));
+        return loop();
+      }
+    }
+    UNREACHABLE();
+  }
   it->second.worker_.reset();
 }
 
@@ -471,7 +624,19 @@ void FileGenerateManager::external_file_generate_finish(uint64 query_id, Status
 }
 
 void FileGenerateManager::do_cancel(uint64 query_id) {
-  query_id_to_query_.erase(query_id);
+  auto it = query_id_to_query_.find(query_id);
+  if (it == query_id_to_query_.end()) {
+    return;
+  }
+  bool is_file_copy = it->second.is_file_copy_;
+  query_id_to_query_.erase(it);
+  if (is_file_copy) {
+    CHECK(active_file_copy_count_ > 0);
+    active_file_copy_count_--;
+    if (!close_flag_) {
+      try_start_file_copies();
+    }
+  }
 }
 
 void FileGenerateManager::hangup_shared() {
@@ -481,6 +646,9 @@ void FileGenerateManager::hangup_shared() {
 
 void FileGenerateManager::hangup() {
   close_flag_ = true;
+  while (!pending_file_copies_.empty()) {
+    cancel(pending_file_copies_.front().query_id);
+  }
   for (auto &it : query_id_to_query_) {
     it.second.worker_.reset();
   }
@@ -11,8 +11,10 @@
 
 #include "td/telegram/files/FileLocation.h"
 
+#include "td/utils/common.h"
 #include "td/utils/Status.h"
 
+#include <deque>
 #include <map>
 
 namespace td {
@@ -56,16 +58,32 @@ class FileGenerateManager : public Actor {
     ~Query();
 
     ActorOwn<FileGenerateActor> worker_;
+    bool is_file_copy_ = false;
   };
 
+  struct PendingFileCopy {
+    uint64 query_id;
+    FullGenerateFileLocation generate_location;
+    LocalFileLocation local_location;
+    string name;
+    unique_ptr<FileGenerateCallback> callback;
+  };
+
+  // files are copied on the GC scheduler, so there is no reason to copy many of them simultaneously
+  static constexpr size_t MAX_ACTIVE_FILE_COPY_COUNT = 2;
+
   ActorShared<> parent_;
   std::map<uint64, Query> query_id_to_query_;
+  std::deque<PendingFileCopy> pending_file_copies_;
+  size_t active_file_copy_count_ = 0;
   bool close_flag_ = false;
 
   void hangup() override;
   void hangup_shared() override;
   void loop() override;
   void do_cancel(uint64 query_id);
+
+  void try_start_file_copies();
 };
 
 }  // namespace td
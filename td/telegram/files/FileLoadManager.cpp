@@ -25,14 +25,19 @@ void FileLoadManager::start_up() {
       create_actor<ResourceManager>("UploadResourceManager", !G()->parameters().use_file_db /*tdlib_engine*/
                                                                  ? ResourceManager::Mode::Greedy
                                                                  : ResourceManager::Mode::Baseline);
+  // the manager doesn't depend on its scheduler, so it can be moved to an idle one, while loaders stay in place
+  allow_stealing();
 }
 
 ActorOwn<ResourceManager> &FileLoadManager::get_download_resource_manager(bool is_small, DcId dc_id) {
   auto &actor = is_small ? download_small_resource_manager_map_[dc_id] : download_resource_manager_map_[dc_id];
   if (actor.empty()) {
+    // big files can use more resources, because the number of parts in flight is limited by their bandwidth
+    int64 max_resource_limit =
+        is_small ? ResourceManager::MAX_RESOURCE_LIMIT : ResourceManager::MAX_DOWNLOAD_RESOURCE_LIMIT;
     actor = create_actor<ResourceManager>(
         PSLICE() << "DownloadResourceManager " << tag("is_small", is_small) << tag("dc_id", dc_id),
-        ResourceManager::Mode::Baseline);
+        ResourceManager::Mode::Baseline, max_resource_limit);
   }
   return actor;
 }
@@ -17,6 +17,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <tuple>
 
@@ -81,9 +82,10 @@ void FileLoader::update_downloaded_part(int64 offset, int64 limit) {
     auto end_part_id = begin_part_id + td::min(max_parts, new_end_part_id - begin_part_id);
     VLOG(file_loader) << "Protect parts " << begin_part_id << " ... " << end_part_id - 1;
     for (auto &it : part_map_) {
-      if (!it.second.second.empty() && !(begin_part_id <= it.second.first.id && it.second.first.id < end_part_id)) {
-        VLOG(file_loader) << "Cancel part " << it.second.first.id;
-        it.second.second.reset();  // cancel_query(it.second.second);
+      if (!it.second.cancel_slot.empty() &&
+          !(begin_part_id <= it.second.part.id && it.second.part.id < end_part_id)) {
+        VLOG(file_loader) << "Cancel part " << it.second.part.id;
+        it.second.cancel_slot.reset();  // cancel_query(it.second.cancel_slot);
       }
     }
   } else {
@@ -213,8 +215,7 @@ Status FileLoader::do_loop() {
       CHECK(blocking_id_ == 0);
       blocking_id_ = id;
     }
-    part_map_[id] = std::make_pair(part, query->cancel_slot_.get_signal_new());
-    // part_map_[id] = std::make_pair(part, query.get_weak());
+    part_map_[id] = PartQuery{part, query->cancel_slot_.get_signal_new(), Time::now()};
 
     auto callback = actor_shared(this, id);
     if (delay_dispatcher_.empty()) {
@@ -231,7 +232,7 @@ Status FileLoader::do_loop() {
 
 void FileLoader::tear_down() {
   for (auto &it : part_map_) {
-    it.second.second.reset();  // cancel_query(it.second.second);
+    it.second.cancel_slot.reset();  // cancel_query(it.second.cancel_slot);
   }
   ordered_parts_.clear([](auto &&part) { part.second->clear(); });
   if (!delay_dispatcher_.empty()) {
@@ -243,9 +244,12 @@ void FileLoader::update_estimated_limit() {
   if (stop_flag_) {
     return;
   }
-  auto estimated_extra = parts_manager_.get_estimated_extra();
+  // there is no need to have more parts in flight than the bandwidth-delay product of the connection
+  auto window = bandwidth_estimator_.get_window(ResourceManager::MAX_RESOURCE_LIMIT,
+                                                ResourceManager::MAX_DOWNLOAD_RESOURCE_LIMIT);
+  auto estimated_extra = td::min(parts_manager_.get_estimated_extra(), window);
   resource_state_.update_estimated_limit(estimated_extra);
-  VLOG(file_loader) << "Update estimated limit " << estimated_extra;
+  VLOG(file_loader) << "Update estimated limit " << estimated_extra << " with " << bandwidth_estimator_;
   if (!resource_manager_.empty()) {
     keep_fd_flag(narrow_cast<uint64>(resource_state_.active_limit()) >= parts_manager_.get_part_size());
     send_closure(resource_manager_, &ResourceManager::update_resources, resource_state_);
@@ -270,8 +274,9 @@ void FileLoader::on_result(NetQueryPtr query) {
     return;
   }
 
-  Part part = it->second.first;
-  it->second.second.release();
+  Part part = it->second.part;
+  auto start_time = it->second.start_time;
+  it->second.cancel_slot.release();
   CHECK(query->is_ready());
   part_map_.erase(it);
 
@@ -287,6 +292,7 @@ void FileLoader::on_result(NetQueryPtr query) {
       parts_manager_.on_part_failed(part.id);
     } else {
       next = true;
+      bandwidth_estimator_.on_part_finished(static_cast<int64>(part.size), start_time, Time::now());
     }
     return Status::OK();
   }();
@@ -314,11 +320,24 @@ void FileLoader::on_part_query(Part part, NetQueryPtr query) {
     // important for secret files
     return;
   }
-  auto status = try_on_part_query(part, std::move(query));
+  process_part(part, std::move(query),
+               PromiseCreator::lambda([actor_id = actor_id(this), part](Result<size_t> r_size) {
+                 send_closure(actor_id, &FileLoader::on_part_processed, part, std::move(r_size));
+               }));
+}
+
+void FileLoader::on_part_processed(Part part, Result<size_t> r_size) {
+  if (stop_flag_) {
+    return;
+  }
+  auto status = r_size.is_error() ? r_size.move_as_error() : try_on_part_processed(part, r_size.ok());
   if (status.is_error()) {
     on_error(std::move(status));
     stop_flag_ = true;
+    return;
   }
+  update_estimated_limit();
+  loop();
 }
 
 void FileLoader::on_common_query(NetQueryPtr query) {
@@ -329,8 +348,7 @@ void FileLoader::on_common_query(NetQueryPtr query) {
   }
 }
 
-Status FileLoader::try_on_part_query(Part part, NetQueryPtr query) {
-  TRY_RESULT(size, process_part(part, std::move(query)));
+Status FileLoader::try_on_part_processed(Part part, size_t size) {
   VLOG(file_loader) << "Ok part " << tag("id", part.id) << tag("size", part.size);
   resource_state_.stop_use(static_cast<int64>(part.size));
   auto old_ready_prefix_count = parts_manager_.get_unchecked_ready_prefix_count();
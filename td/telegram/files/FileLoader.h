@@ -7,8 +7,10 @@
 #pragma once
 
 #include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
 
 #include "td/telegram/DelayDispatcher.h"
+#include "td/telegram/files/BandwidthEstimator.h"
 #include "td/telegram/files/FileLoaderActor.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/PartsManager.h"
@@ -71,7 +73,8 @@ class FileLoader : public FileLoaderActor {
                                                           int64 streaming_offset) TD_WARN_UNUSED_RESULT = 0;
   virtual void after_start_parts() {
   }
-  virtual Result<size_t> process_part(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT = 0;
+  // the promise must be set to the size of the processed part; it can be done asynchronously
+  virtual void process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) = 0;
   struct Progress {
     int32 part_count{0};
     int32 part_size{0};
@@ -114,7 +117,13 @@ class FileLoader : public FileLoaderActor {
   ResourceState resource_state_;
   PartsManager parts_manager_;
   uint64 blocking_id_{0};
-  std::map<uint64, std::pair<Part, ActorShared<>>> part_map_;
+  struct PartQuery {
+    Part part;
+    ActorShared<> cancel_slot;
+    double start_time;
+  };
+  std::map<uint64, PartQuery> part_map_;
+  BandwidthEstimator bandwidth_estimator_;
   bool ordered_flag_ = false;
   OrderedEventsProcessor<std::pair<Part, NetQueryPtr>> ordered_parts_;
   ActorOwn<DelayDispatcher> delay_dispatcher_;
@@ -136,8 +145,9 @@ class FileLoader : public FileLoaderActor {
 
   void on_result(NetQueryPtr query) override;
   void on_part_query(Part part, NetQueryPtr query);
+  void on_part_processed(Part part, Result<size_t> r_size);
   void on_common_query(NetQueryPtr query);
-  Status try_on_part_query(Part part, NetQueryPtr query);
+  Status try_on_part_processed(Part part, size_t size);
 };
 
 }  // namespace td
@@ -11,6 +11,7 @@
 #include "td/telegram/TdDb.h"
 
 #include "td/utils/common.h"
+#include "td/utils/crypto.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -170,6 +171,29 @@ Result<FullLocalFileLocation> save_file_bytes(FileType type, BufferSlice bytes,
   return FullLocalFileLocation(type, std::move(perm_path), 0);
 }
 
+Result<string> get_file_sha256(CSlice path, int64 size) {
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  Sha256State state;
+  state.init();
+  BufferSlice buffer(1 << 17);
+  int64 offset = 0;
+  while (offset < size) {
+    auto slice = buffer.as_slice();
+    if (size - offset < static_cast<int64>(slice.size())) {
+      slice.truncate(static_cast<size_t>(size - offset));
+    }
+    TRY_RESULT(read_size, fd.pread(slice, offset));
+    if (read_size == 0) {
+      return Status::Error("Unexpected end of file");
+    }
+    state.feed(slice.truncate(read_size));
+    offset += static_cast<int64>(read_size);
+  }
+  string hash(32, '\0');
+  state.extract(hash, true);
+  return std::move(hash);
+}
+
 static Slice get_file_base_dir(const FileDirType &file_dir_type) {
   switch (file_dir_type) {
     case FileDirType::Secure:
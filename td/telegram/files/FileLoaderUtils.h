@@ -30,6 +30,8 @@ Result<string> search_file(CSlice dir, CSlice name, int64 expected_size) TD_WARN
 
 Result<FullLocalFileLocation> save_file_bytes(FileType type, BufferSlice bytes, CSlice file_name);
 
+Result<string> get_file_sha256(CSlice path, int64 size) TD_WARN_UNUSED_RESULT;
+
 Slice get_files_base_dir(FileType file_type);
 
 string get_files_temp_dir(FileType file_type);
@@ -22,6 +22,7 @@
 #include "td/utils/StringBuilder.h"
 #include "td/utils/Variant.h"
 
+#include <functional>
 #include <tuple>
 #include <utility>
 
@@ -724,6 +725,14 @@ inline StringBuilder &operator<<(StringBuilder &sb, const FullLocalFileLocation
   return sb << "[full local location of " << location.file_type_ << "] at \"" << location.path_ << '"';
 }
 
+struct FullLocalFileLocationHash {
+  std::size_t operator()(const FullLocalFileLocation &location) const {
+    return (std::hash<string>()(location.path_) * 2023654985u + std::hash<uint64>()(location.mtime_nsec_)) *
+               2023654985u +
+           static_cast<std::size_t>(location.file_type_);
+  }
+};
+
 struct PartialLocalFileLocationPtr {
   unique_ptr<PartialLocalFileLocation> location_;  // must never be equal to nullptr
 
@@ -875,6 +884,14 @@ inline StringBuilder &operator<<(StringBuilder &string_builder,
                         << tag("conversion", full_generated_file_location.conversion_) << ']';
 }
 
+struct FullGenerateFileLocationHash {
+  std::size_t operator()(const FullGenerateFileLocation &location) const {
+    return (std::hash<string>()(location.original_path_) * 2023654985u + std::hash<string>()(location.conversion_)) *
+               2023654985u +
+           static_cast<std::size_t>(location.file_type_);
+  }
+};
+
 class GenerateFileLocation {
  public:
   enum class Type : int32 { Empty, Full };
@@ -24,8 +24,9 @@
 
 #include "td/actor/SleepActor.h"
 
+#include "td/db/SqliteKeyValue.h"
+
 #include "td/utils/base64.h"
-#include "td/utils/crypto.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/HttpUrl.h"
@@ -459,6 +460,12 @@ void FileNode::on_pmc_flushed() {
 }
 void FileNode::on_info_flushed() {
   info_changed_flag_ = false;
+  last_info_flush_time_ = Time::now();
+  last_info_flush_progress_size_ = get_progress_size();
+}
+
+int64 FileNode::get_progress_size() const {
+  return local_ready_size_ + remote_.ready_size;
 }
 
 string FileNode::suggested_name() const {
@@ -792,6 +799,9 @@ void prepare_path_for_pmc(FileType file_type, string &path) {
 }  // namespace
 
 FileManager::FileManager(unique_ptr<Context> context) : context_(std::move(context)) {
+  file_progress_timeout_.set_callback(on_file_progress_timeout_callback);
+  file_progress_timeout_.set_callback_data(static_cast<void *>(this));
+
   if (G()->parameters().use_file_db) {
     file_db_ = G()->td_db()->get_file_db_shared();
   }
@@ -1071,6 +1081,21 @@ FileId FileManager::register_empty(FileType type) {
   return register_local(FullLocalFileLocation(type, "", 0), DialogId(), 0, false, true).ok();
 }
 
+void FileManager::get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) const {
+  size_t file_node_count = 0;
+  for (auto &file_node : file_nodes_) {
+    if (file_node != nullptr) {
+      file_node_count++;
+    }
+  }
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "file nodes", static_cast<int64>(file_node_count),
+      static_cast<int64>(file_node_count * sizeof(FileNode) + file_nodes_.capacity() * sizeof(unique_ptr<FileNode>))));
+  entries.push_back(td_api::make_object<td_api::memoryStatisticsEntry>(
+      "file identifiers", static_cast<int64>(file_id_info_.size()),
+      static_cast<int64>(file_id_info_.capacity() * sizeof(FileIdInfo))));
+}
+
 void FileManager::on_file_unlink(const FullLocalFileLocation &location) {
   // TODO: remove file from the database too
   auto it = local_location_to_file_id_.find(location);
@@ -1778,19 +1803,68 @@ void FileManager::try_flush_node_pmc(FileNodePtr node, const char *source) {
   }
 }
 
-void FileManager::try_flush_node_info(FileNodePtr node, const char *source) {
+void FileManager::try_flush_node_info(FileNodePtr node, const char *source, bool is_progress) {
   if (node->need_info_flush()) {
     for (auto file_id : vector<FileId>(node->file_ids_)) {
       auto *info = get_file_id_info(file_id);
       if (info->send_updates_flag_) {
         VLOG(update_file) << "Send UpdateFile about file " << file_id << " from " << source;
-        context_->on_file_updated(file_id);
+        if (is_progress) {
+          context_->on_file_progress_updated(file_id);
+        } else {
+          context_->on_file_updated(file_id);
+        }
       }
     }
     node->on_info_flushed();
   }
 }
 
+// Progress-only changes are postponed until "update_file_progress_min_size" more bytes are transferred and
+// "update_file_progress_delay_ms" passes since the previous update about the file. Any other change flushes
+// the postponed progress together with itself.
+void FileManager::try_flush_node_progress(FileNodePtr node, const char *source) {
+  if (!node->need_info_flush()) {
+    return;
+  }
+
+  auto min_size = G()->shared_config().get_option_integer(ConfigShared::OptionId::UpdateFileProgressMinSize);
+  if (std::abs(node->get_progress_size() - node->last_info_flush_progress_size_) < min_size) {
+    return;
+  }
+
+  auto delay = G()->shared_config().get_option_integer(ConfigShared::OptionId::UpdateFileProgressDelayMs) * 1e-3;
+  auto flush_time = node->last_info_flush_time_ + delay;
+  if (flush_time > Time::now()) {
+    file_progress_timeout_.add_timeout_at(node->main_file_id_.get(), flush_time);
+    return;
+  }
+
+  try_flush_node_info(node, source, true);
+}
+
+void FileManager::on_file_progress_timeout_callback(void *file_manager_ptr, int64 file_id_int) {
+  if (G()->close_flag()) {
+    return;
+  }
+
+  auto file_manager = static_cast<FileManager *>(file_manager_ptr);
+  send_closure_later(file_manager->actor_id(file_manager), &FileManager::on_file_progress_timeout,
+                     FileId(narrow_cast<int32>(file_id_int), 0));
+}
+
+void FileManager::on_file_progress_timeout(FileId file_id) {
+  if (is_closed_) {
+    return;
+  }
+
+  auto node = get_file_node(file_id);
+  if (!node) {
+    return;
+  }
+  try_flush_node_info(node, "on_file_progress_timeout", true);
+}
+
 void FileManager::clear_from_pmc(FileNodePtr node) {
   if (!file_db_) {
     return;
@@ -1955,7 +2029,7 @@ bool FileManager::set_encryption_key(FileId file_id, FileEncryptionKey key) {
 }
 
 bool FileManager::set_content(FileId file_id, BufferSlice bytes) {
-  if (G()->shared_config().get_option_boolean("ignore_inline_thumbnails")) {
+  if (G()->shared_config().get_option_boolean(ConfigShared::OptionId::IgnoreInlineThumbnails)) {
     return false;
   }
 
@@ -2187,6 +2261,39 @@ void FileManager::download(FileId file_id, std::shared_ptr<DownloadCallback> cal
   try_flush_node(node, "download");
 }
 
+void FileManager::update_streaming_position(FileId file_id, std::shared_ptr<DownloadCallback> callback, int64 offset,
+                                            int64 bitrate) {
+  auto prefetch_size = MIN_STREAMING_PREFETCH_SIZE;
+  if (bitrate > 0) {
+    prefetch_size = clamp(static_cast<int64>(static_cast<double>(bitrate) * STREAMING_PREFETCH_TIME),
+                          MIN_STREAMING_PREFETCH_SIZE, MAX_STREAMING_PREFETCH_SIZE);
+  }
+
+  auto node = get_sync_file_node(file_id);
+  if (node) {
+    FileView file_view(node);
+    auto size = file_view.size();
+    if (size > 0) {
+      if (offset >= size) {
+        LOG(INFO) << "Nothing to prefetch after offset " << offset << " of file " << file_id;
+        return;
+      }
+      prefetch_size = td::min(prefetch_size, size - offset);
+    }
+    auto prefetched_size = file_view.downloaded_prefix(offset);
+    if (!file_view.is_downloading() && prefetched_size * 2 >= prefetch_size) {
+      // the download will be restarted after the playback reaches the second half of the prefetched part,
+      // so that the download isn't restarted for every small position change
+      LOG(INFO) << "Have " << prefetched_size << " bytes already downloaded after offset " << offset << " of file "
+                << file_id;
+      return;
+    }
+  }
+
+  LOG(INFO) << "Prefetch " << prefetch_size << " bytes after offset " << offset << " of file " << file_id;
+  download(file_id, std::move(callback), STREAMING_PRIORITY, offset, prefetch_size);
+}
+
 void FileManager::run_download(FileNodePtr node, bool force_update_priority) {
   int8 priority = 0;
   for (auto id : node->file_ids_) {
@@ -2969,6 +3076,18 @@ td_api::object_ptr<td_api::file> FileManager::get_file_object(FileId file_id, bo
                                               file_view.is_uploading(), is_uploading_completed, remote_size));
 }
 
+td_api::object_ptr<td_api::updateFileProgress> FileManager::get_update_file_progress_object(FileId file_id) {
+  auto file_view = get_sync_file_view(file_id);
+  if (file_view.empty()) {
+    return td_api::make_object<td_api::updateFileProgress>(file_id.get(), 0, 0, 0);
+  }
+
+  return td_api::make_object<td_api::updateFileProgress>(file_id.get(),
+                                                         narrow_cast<int32>(file_view.local_prefix_size()),
+                                                         narrow_cast<int32>(file_view.local_total_size()),
+                                                         narrow_cast<int32>(file_view.remote_size()));
+}
+
 vector<int32> FileManager::get_file_ids_object(const vector<FileId> &file_ids, bool with_main_file_id) {
   return transform(file_ids, [this, with_main_file_id](FileId file_id) {
     auto file_view = get_sync_file_view(file_id);
@@ -3055,6 +3174,63 @@ Result<FileId> FileManager::get_input_thumbnail_file_id(const tl_object_ptr<td_a
   }
 }
 
+string FileManager::get_upload_hash_key(FileType file_type, CSlice path) {
+  int64 max_size = 0;
+  if (G()->shared_config().get_option_boolean("reuse_uploaded_files_by_hash")) {
+    max_size = MAX_HASHED_UPLOAD_FILE_SIZE;
+  } else if (G()->shared_config().get_option_boolean("reuse_uploaded_photos_by_hash") &&
+             file_type == FileType::Photo) {
+    max_size = 5000000;
+  }
+
+  auto r_stat = stat(path);
+  if (r_stat.is_error() || r_stat.ok().size_ <= 0 || r_stat.ok().size_ >= max_size) {
+    return string();
+  }
+  auto size = r_stat.ok().size_;
+  auto r_hash = get_file_sha256(path, size);
+  if (r_hash.is_error()) {
+    return string();
+  }
+  return PSTRING() << "fupload" << static_cast<int32>(file_type) << '#' << size << '#' << hex_encode(r_hash.ok());
+}
+
+Result<FileId> FileManager::get_uploaded_file_id_by_hash(const string &hash_key, CSlice path,
+                                                         DialogId owner_dialog_id) {
+  auto is_uploaded = [&](FileId file_id) {
+    auto file_view = get_sync_file_view(file_id);
+    return file_view.has_remote_location() && !file_view.remote_location().is_web();
+  };
+
+  auto it = file_hash_to_file_id_.find(hash_key);
+  if (it != file_hash_to_file_id_.end() && is_uploaded(it->second)) {
+    return it->second;
+  }
+
+  if (!file_db_) {
+    return Status::Error("Not found");
+  }
+  auto value = file_db_->pmc().get(hash_key);
+  if (value.empty()) {
+    return Status::Error("Not found");
+  }
+  FullLocalFileLocation location;
+  TRY_STATUS(log_event_parse(location, value));
+  if (location.path_ == path) {
+    // the file itself will be found by its local location
+    return Status::Error("Same file");
+  }
+
+  // the file with the same content is still unchanged and was already uploaded
+  TRY_RESULT(file_id, register_local(std::move(location), owner_dialog_id, 0));
+  if (!is_uploaded(file_id)) {
+    return Status::Error("Not uploaded");
+  }
+  LOG(INFO) << "Reuse uploaded file " << file_id << " instead of \"" << path << '"';
+  file_hash_to_file_id_[hash_key] = file_id;
+  return file_id;
+}
+
 Result<FileId> FileManager::get_input_file_id(FileType type, const tl_object_ptr<td_api::InputFile> &file,
                                               DialogId owner_dialog_id, bool allow_zero, bool is_encrypted,
                                               bool get_by_hash, bool is_secure) {
@@ -3078,26 +3254,25 @@ Result<FileId> FileManager::get_input_file_id(FileType type, const tl_object_ptr
         if (allow_zero && path.empty()) {
           return FileId();
         }
-        string hash;
-        if (G()->shared_config().get_option_boolean("reuse_uploaded_photos_by_hash") && new_type == FileType::Photo) {
-          auto r_stat = stat(path);
-          if (r_stat.is_ok() && r_stat.ok().size_ > 0 && r_stat.ok().size_ < 5000000) {
-            auto r_file_content = read_file_str(path, r_stat.ok().size_);
-            if (r_file_content.is_ok()) {
-              hash = sha256(r_file_content.ok());
-              auto it = file_hash_to_file_id_.find(hash);
-              if (it != file_hash_to_file_id_.end()) {
-                auto file_view = get_file_view(it->second);
-                if (file_view.has_remote_location() && !file_view.remote_location().is_web()) {
-                  return it->second;
-                }
-              }
-            }
+        string hash_key;
+        if (!is_encrypted && !is_secure) {
+          hash_key = get_upload_hash_key(new_type, path);
+        }
+        if (!hash_key.empty()) {
+          auto r_file_id = get_uploaded_file_id_by_hash(hash_key, path, owner_dialog_id);
+          if (r_file_id.is_ok()) {
+            return r_file_id.move_as_ok();
           }
         }
         TRY_RESULT(file_id, register_local(FullLocalFileLocation(new_type, path, 0), owner_dialog_id, 0, get_by_hash));
-        if (!hash.empty()) {
-          file_hash_to_file_id_[hash] = file_id;
+        if (!hash_key.empty()) {
+          file_hash_to_file_id_[hash_key] = file_id;
+          if (file_db_) {
+            auto file_view = get_file_view(file_id);
+            if (file_view.has_local_location()) {
+              file_db_->pmc().set(hash_key, log_event_store(file_view.local_location()).as_slice());
+            }
+          }
         }
         return file_id;
       }
@@ -3296,14 +3471,23 @@ void FileManager::on_partial_download(QueryId query_id, const PartialLocalFileLo
     return;
   }
 
+  // only the downloaded size changes, if the partial file was already known
+  bool is_progress = file_node->local_.type() == LocalFileLocation::Type::Partial &&
+                     file_node->local_.partial().path_ == partial_local.path_;
   if (size != 0) {
     FileView file_view(file_node);
-    if (!file_view.is_encrypted_secure()) {
+    if (!file_view.is_encrypted_secure() && size != file_node->size_) {
       file_node->set_size(size);
+      is_progress = false;
     }
   }
   file_node->set_local_location(LocalFileLocation(partial_local), ready_size, -1, -1 /* TODO */);
-  try_flush_node(file_node, "on_partial_download");
+  if (is_progress) {
+    try_flush_node_pmc(file_node, "on_partial_download");
+    try_flush_node_progress(file_node, "on_partial_download");
+  } else {
+    try_flush_node(file_node, "on_partial_download");
+  }
 }
 
 void FileManager::on_hash(QueryId query_id, string hash) {
@@ -3348,7 +3532,8 @@ void FileManager::on_partial_upload(QueryId query_id, const PartialRemoteFileLoc
   }
 
   file_node->set_partial_remote_location(partial_remote, ready_size);
-  try_flush_node(file_node, "on_partial_upload");
+  try_flush_node_pmc(file_node, "on_partial_upload");
+  try_flush_node_progress(file_node, "on_partial_upload");
 }
 
 void FileManager::on_download_ok(QueryId query_id, const FullLocalFileLocation &local, int64 size, bool is_new) {
@@ -24,6 +24,7 @@
 
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
+#include "td/actor/Timeout.h"
 
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
@@ -118,6 +119,8 @@ class FileNode {
   void on_pmc_flushed();
   void on_info_flushed();
 
+  int64 get_progress_size() const;
+
   string suggested_name() const;
 
  private:
@@ -180,6 +183,9 @@ class FileNode {
   bool pmc_changed_flag_{false};
   bool info_changed_flag_{false};
 
+  double last_info_flush_time_ = 0;
+  int64 last_info_flush_progress_size_ = 0;
+
   bool upload_was_update_file_reference_{false};
   bool download_was_update_file_reference_{false};
 
@@ -379,6 +385,8 @@ class FileManager : public FileLoadManager::Callback {
 
     virtual void on_file_updated(FileId size) = 0;
 
+    virtual void on_file_progress_updated(FileId file_id) = 0;
+
     virtual bool add_file_source(FileId file_id, FileSourceId file_source_id) = 0;
 
     virtual bool remove_file_source(FileId file_id, FileSourceId file_source_id) = 0;
@@ -414,6 +422,8 @@ class FileManager : public FileLoadManager::Callback {
 
   void on_file_unlink(const FullLocalFileLocation &location);
 
+  void get_memory_statistics(vector<td_api::object_ptr<td_api::memoryStatisticsEntry>> &entries) const;
+
   FileId register_empty(FileType type);
   Result<FileId> register_local(FullLocalFileLocation location, DialogId owner_dialog_id, int64 size,
                                 bool get_by_hash = false, bool force = false,
@@ -442,6 +452,8 @@ class FileManager : public FileLoadManager::Callback {
 
   void download(FileId file_id, std::shared_ptr<DownloadCallback> callback, int32 new_priority, int64 offset,
                 int64 limit);
+  void update_streaming_position(FileId file_id, std::shared_ptr<DownloadCallback> callback, int64 offset,
+                                 int64 bitrate);
   void upload(FileId file_id, std::shared_ptr<UploadCallback> callback, int32 new_priority, uint64 upload_order);
   void resume_upload(FileId file_id, std::vector<int> bad_parts, std::shared_ptr<UploadCallback> callback,
                      int32 new_priority, uint64 upload_order, bool force = false);
@@ -463,6 +475,7 @@ class FileManager : public FileLoadManager::Callback {
   FileView get_file_view(FileId file_id) const;
   FileView get_sync_file_view(FileId file_id);
   td_api::object_ptr<td_api::file> get_file_object(FileId file_id, bool with_main_file_id = true);
+  td_api::object_ptr<td_api::updateFileProgress> get_update_file_progress_object(FileId file_id);
   vector<int32> get_file_ids_object(const vector<FileId> &file_ids, bool with_main_file_id = true);
 
   Result<FileId> get_input_thumbnail_file_id(const tl_object_ptr<td_api::InputFile> &thumb_input_file,
@@ -504,6 +517,13 @@ class FileManager : public FileLoadManager::Callback {
 
   static constexpr int8 FROM_BYTES_PRIORITY = 10;
 
+  // streamed files are downloaded with the maximum priority STREAMING_PREFETCH_TIME seconds of playback ahead
+  static constexpr int8 STREAMING_PRIORITY = 32;
+  static constexpr double STREAMING_PREFETCH_TIME = 30.0;
+  static constexpr int64 MIN_STREAMING_PREFETCH_SIZE = 1 << 20;
+  static constexpr int64 MAX_STREAMING_PREFETCH_SIZE = 64 << 20;
+  static constexpr int64 MAX_HASHED_UPLOAD_FILE_SIZE = 64 << 20;  // the files are hashed synchronously
+
   using FileNodeId = int32;
 
   using QueryId = FileLoadManager::QueryId;
@@ -563,9 +583,8 @@ class FileManager : public FileLoadManager::Callback {
 
   std::unordered_map<string, FileId> file_hash_to_file_id_;
 
-  std::map<FullLocalFileLocation, FileId> local_location_to_file_id_;
-  std::map<FullGenerateFileLocation, FileId> generate_location_to_file_id_;
-  std::map<FileDbId, int32> pmc_id_to_file_node_id_;
+  std::unordered_map<FullLocalFileLocation, FileId, FullLocalFileLocationHash> local_location_to_file_id_;
+  std::unordered_map<FullGenerateFileLocation, FileId, FullGenerateFileLocationHash> generate_location_to_file_id_;
 
   vector<FileIdInfo> file_id_info_;
   vector<int32> empty_file_ids_;
@@ -575,6 +594,8 @@ class FileManager : public FileLoadManager::Callback {
 
   Container<Query> queries_container_;
 
+  MultiTimeout file_progress_timeout_{"FileProgressTimeout"};
+
   bool is_closed_ = false;
 
   std::set<std::string> bad_paths_;
@@ -598,12 +619,16 @@ class FileManager : public FileLoadManager::Callback {
   Status check_local_location(FullLocalFileLocation &location, int64 &size, bool skip_file_size_checks);
   void try_flush_node_full(FileNodePtr node, bool new_remote, bool new_local, bool new_generate, FileDbId other_pmc_id);
   void try_flush_node(FileNodePtr node, const char *source);
-  void try_flush_node_info(FileNodePtr node, const char *source);
+  void try_flush_node_info(FileNodePtr node, const char *source, bool is_progress = false);
+  void try_flush_node_progress(FileNodePtr node, const char *source);
   void try_flush_node_pmc(FileNodePtr node, const char *source);
   void clear_from_pmc(FileNodePtr node);
   void flush_to_pmc(FileNodePtr node, bool new_remote, bool new_local, bool new_generate, const char *source);
   void load_from_pmc(FileNodePtr node, bool new_remote, bool new_local, bool new_generate);
 
+  string get_upload_hash_key(FileType file_type, CSlice path);
+  Result<FileId> get_uploaded_file_id_by_hash(const string &hash_key, CSlice path, DialogId owner_dialog_id);
+
   Result<FileId> from_persistent_id_map(Slice binary, FileType file_type);
   Result<FileId> from_persistent_id_v2(Slice binary, FileType file_type);
   Result<FileId> from_persistent_id_v3(Slice binary, FileType file_type);
@@ -654,6 +679,9 @@ class FileManager : public FileLoadManager::Callback {
 
   std::unordered_set<FileId, FileIdHash> get_main_file_ids(const vector<FileId> &file_ids);
 
+  static void on_file_progress_timeout_callback(void *file_manager_ptr, int64 file_id_int);
+  void on_file_progress_timeout(FileId file_id);
+
   void hangup() override;
   void tear_down() override;
 
@@ -0,0 +1,51 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FilePartReader.h"
+
+#include "td/utils/crypto.h"
+#include "td/utils/logging.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+void FilePartReader::read(Part part, Promise<PartData> promise) {
+  if (is_secret_ && part.offset != next_offset_) {
+    return promise.set_error(Status::Error("Secret file parts must be read consecutively"));
+  }
+  if (fd_.empty()) {
+    TRY_RESULT_PROMISE_ASSIGN(promise, fd_, FileFd::open(path_, FileFd::Read));
+  }
+
+  auto padded_size = part.size;
+  if (is_secret_) {
+    padded_size = (padded_size + 15) & ~15;
+  }
+  BufferSlice bytes(padded_size);
+  TRY_RESULT_PROMISE(promise, size, fd_.pread(bytes.as_slice().truncate(part.size), part.offset));
+  if (size != part.size) {
+    return promise.set_error(Status::Error("Failed to read file part"));
+  }
+  LOG(DEBUG) << "Read " << size << " bytes at offset " << part.offset << " from \"" << path_ << '"';
+
+  PartData result;
+  if (is_secret_) {
+    Random::secure_bytes(bytes.as_slice().substr(part.size));
+    aes_ige_encrypt(as_slice(key_), as_slice(iv_), bytes.as_slice(), bytes.as_slice());
+    next_offset_ += static_cast<int64>(bytes.size());
+    result.next_iv = iv_;
+  }
+  result.data = std::move(bytes);
+  promise.set_value(std::move(result));
+}
+
+void FilePartReader::tear_down() {
+  fd_.close();
+}
+
+}  // namespace td
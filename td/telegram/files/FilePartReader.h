@@ -0,0 +1,52 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/PartsManager.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/UInt.h"
+
+namespace td {
+
+// reads and encrypts file parts ahead of their upload on a separate scheduler,
+// so reading and encryption of big files doesn't block file loaders and network sessions
+class FilePartReader : public Actor {
+ public:
+  struct PartData {
+    BufferSlice data;
+    UInt256 next_iv;  // AES-IGE state after the part; used only for secret files
+  };
+
+  explicit FilePartReader(string path) : path_(std::move(path)) {
+  }
+
+  // secret file parts are chained, so they must be read consecutively starting from the offset
+  FilePartReader(string path, const UInt256 &key, const UInt256 &iv, int64 offset)
+      : path_(std::move(path)), is_secret_(true), key_(key), iv_(iv), next_offset_(offset) {
+  }
+
+  void read(Part part, Promise<PartData> promise);
+
+ private:
+  string path_;
+  FileFd fd_;
+
+  bool is_secret_ = false;
+  UInt256 key_;
+  UInt256 iv_;
+  int64 next_offset_ = 0;
+
+  void tear_down() override;
+};
+
+}  // namespace td
@@ -0,0 +1,46 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FilePartWriter.h"
+
+#include "td/utils/crypto.h"
+#include "td/utils/logging.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+void FilePartWriter::write(BufferSlice data, int64 offset, Promise<size_t> promise) {
+  TRY_STATUS_PROMISE(promise, do_write(data.as_slice(), offset));
+  promise.set_value(data.size());
+}
+
+void FilePartWriter::decrypt_and_write(BufferSlice data, int64 offset, size_t size, Promise<UInt256> promise) {
+  aes_ige_decrypt(as_slice(aes_key_), as_slice(aes_iv_), data.as_slice(), data.as_slice());
+  TRY_STATUS_PROMISE(promise, do_write(data.as_slice().truncate(size), offset));
+  promise.set_value(UInt256(aes_iv_));
+}
+
+Status FilePartWriter::do_write(Slice data, int64 offset) {
+  if (fd_.empty()) {
+    TRY_RESULT_ASSIGN(fd_, FileFd::open(path_, FileFd::Write));
+  }
+  TRY_RESULT(written, fd_.pwrite(data, offset));
+  LOG(INFO) << "Written " << written << " bytes at offset " << offset << " to \"" << path_ << '"';
+  if (written != data.size()) {
+    return Status::Error("Failed to save file part to the file");
+  }
+  return Status::OK();
+}
+
+void FilePartWriter::close_fd() {
+  fd_.close();
+}
+
+void FilePartWriter::tear_down() {
+  fd_.close();
+}
+
+}  // namespace td
@@ -0,0 +1,52 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/UInt.h"
+
+namespace td {
+
+// writes file parts on a separate scheduler, so a slow disk doesn't block file loaders and network sessions
+class FilePartWriter : public Actor {
+ public:
+  explicit FilePartWriter(string path) : path_(std::move(path)) {
+  }
+
+  // parts of secret files are decrypted by the writer before they are written, so the decryption doesn't block
+  // the file loader; AES-IGE decryption of a part depends on the previous parts, so they must be sent in order
+  FilePartWriter(string path, const UInt256 &aes_key, const UInt256 &aes_iv)
+      : path_(std::move(path)), aes_key_(aes_key), aes_iv_(aes_iv) {
+  }
+
+  void write(BufferSlice data, int64 offset, Promise<size_t> promise);
+
+  // writes first size bytes of the decrypted part and returns the IV to be used for decryption of the next part
+  void decrypt_and_write(BufferSlice data, int64 offset, size_t size, Promise<UInt256> promise);
+
+  // closes the file until the next write
+  void close_fd();
+
+ private:
+  string path_;
+  FileFd fd_;
+  UInt256 aes_key_;
+  UInt256 aes_iv_;
+
+  Status do_write(Slice data, int64 offset) TD_WARN_UNUSED_RESULT;
+
+  void tear_down() override;
+};
+
+}  // namespace td
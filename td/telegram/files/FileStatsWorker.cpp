@@ -22,11 +22,13 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/PathView.h"
+#include "td/utils/port/Clocks.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/Time.h"
+#include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 
 #include <functional>
@@ -99,8 +101,159 @@ struct FsFileInfo {
   uint64 mtime_nsec;
 };
 
+// Persistent per-directory index of file sizes and access times. File creation, renaming and deletion, which are
+// done by FileManager on download, upload and file removal, change directory mtime, so files in directories with
+// unchanged mtime don't need to be stat-ed again. The index is rebuilt from scratch after MAX_AGE seconds.
+struct FsDirIndex {
+  static constexpr int32 MAX_AGE = 86400;
+
+  struct Entry {
+    string name;
+    int64 size = 0;
+    uint64 atime_nsec = 0;
+    uint64 mtime_nsec = 0;
+
+    template <class StorerT>
+    void store(StorerT &storer) const {
+      td::store(name, storer);
+      td::store(size, storer);
+      td::store(atime_nsec, storer);
+      td::store(mtime_nsec, storer);
+    }
+
+    template <class ParserT>
+    void parse(ParserT &parser) {
+      td::parse(name, parser);
+      td::parse(size, parser);
+      td::parse(atime_nsec, parser);
+      td::parse(mtime_nsec, parser);
+    }
+  };
+
+  uint64 dir_mtime_nsec = 0;
+  int32 created_at = 0;
+  vector<Entry> entries;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(dir_mtime_nsec, storer);
+    td::store(created_at, storer);
+    td::store(entries, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    td::parse(dir_mtime_nsec, parser);
+    td::parse(created_at, parser);
+    td::parse(entries, parser);
+  }
+
+  static string get_key(Slice dir) {
+    return PSTRING() << "fstat" << dir;
+  }
+};
+
+class FsIndexScanner {
+ public:
+  explicit FsIndexScanner(bool use_index) : use_index_(use_index) {
+  }
+
+  // returns known information about the file or nullptr if the file needs to be stat-ed
+  const FsDirIndex::Entry *get_entry(CSlice path) {
+    auto &dir = get_dir(PathView(path).parent_dir());
+    if (dir.old_entries.empty()) {
+      dir.is_changed = true;
+      return nullptr;
+    }
+    auto it = dir.old_entries.find(PathView(path).file_name().str());
+    if (it == dir.old_entries.end()) {
+      dir.is_changed = true;
+      return nullptr;
+    }
+    reused_count_++;
+    dir.index.entries.push_back(it->second);
+    return &dir.index.entries.back();
+  }
+
+  void add_entry(CSlice path, const Stat &stat) {
+    PathView path_view(path);
+    auto &dir = get_dir(path_view.parent_dir());
+    FsDirIndex::Entry entry;
+    entry.name = path_view.file_name().str();
+    entry.size = stat.real_size_;
+    entry.atime_nsec = stat.atime_nsec_;
+    entry.mtime_nsec = stat.mtime_nsec_;
+    dir.index.entries.push_back(std::move(entry));
+  }
+
+  void save() {
+    if (!use_index_) {
+      return;
+    }
+    for (auto &it : dirs_) {
+      auto &dir = it.second;
+      if (dir.index.dir_mtime_nsec == 0 ||
+          (!dir.is_changed && dir.index.entries.size() == dir.old_entries.size() && !dir.old_entries.empty())) {
+        continue;
+      }
+      get_pmc().set(FsDirIndex::get_key(it.first), log_event_store(dir.index).as_slice());
+    }
+    LOG(INFO) << "Reused information about " << reused_count_ << " files from the file statistics index";
+  }
+
+ private:
+  struct Dir {
+    FsDirIndex index;
+    std::unordered_map<string, FsDirIndex::Entry> old_entries;
+    bool is_changed = false;
+  };
+
+  bool use_index_;
+  std::unordered_map<string, Dir> dirs_;
+  size_t reused_count_ = 0;
+
+  static SqliteKeyValue &get_pmc() {
+    return G()->td_db()->get_file_db_shared()->pmc();
+  }
+
+  Dir &get_dir(Slice dir_path) {
+    auto key = dir_path.str();
+    auto it = dirs_.find(key);
+    if (it != dirs_.end()) {
+      return it->second;
+    }
+
+    auto &dir = dirs_[key];
+    if (!use_index_) {
+      return dir;
+    }
+    auto now = static_cast<int32>(Clocks::system());
+    auto r_stat = stat(key);
+    if (r_stat.is_error()) {
+      return dir;
+    }
+
+    FsDirIndex old_index;
+    auto value = get_pmc().get(FsDirIndex::get_key(key));
+    if (!value.empty() && log_event_parse(old_index, value).is_ok() &&
+        old_index.dir_mtime_nsec == r_stat.ok().mtime_nsec_ && old_index.created_at <= now &&
+        now - old_index.created_at < FsDirIndex::MAX_AGE) {
+      dir.index.created_at = old_index.created_at;
+      for (auto &entry : old_index.entries) {
+        auto name = entry.name;
+        dir.old_entries.emplace(std::move(name), std::move(entry));
+      }
+    } else {
+      dir.index.created_at = now;
+    }
+    dir.index.dir_mtime_nsec = r_stat.ok().mtime_nsec_;
+    return dir;
+  }
+};
+
 template <class CallbackT>
 void scan_fs(CancellationToken &token, CallbackT &&callback) {
+  FsIndexScanner index_scanner(G()->parameters().use_file_db);
   std::unordered_set<string> scanned_file_dirs;
   for (int32 i = 0; i < MAX_FILE_TYPE; i++) {
     auto file_type = static_cast<FileType>(i);
@@ -109,6 +262,8 @@ void scan_fs(CancellationToken &token, CallbackT &&callback) {
       continue;
     }
     auto main_file_type = get_main_file_type(file_type);
+    // partial files are written in place, so their sizes must always be checked
+    bool can_use_index = main_file_type != FileType::Temp;
     walk_path(file_dir, [&](CSlice path, WalkPath::Type type) {
       if (token) {
         return WalkPath::Action::Abort;
@@ -116,27 +271,41 @@ void scan_fs(CancellationToken &token, CallbackT &&callback) {
       if (type != WalkPath::Type::NotDir) {
         return WalkPath::Action::Continue;
       }
-      auto r_stat = stat(path);
-      if (r_stat.is_error()) {
-        LOG(WARNING) << "Stat in files gc failed: " << r_stat.error();
-        return WalkPath::Action::Continue;
+
+      FsFileInfo info;
+      auto *entry = can_use_index ? index_scanner.get_entry(path) : nullptr;
+      if (entry != nullptr) {
+        info.size = entry->size;
+        info.atime_nsec = entry->atime_nsec;
+        info.mtime_nsec = entry->mtime_nsec;
+      } else {
+        auto r_stat = stat(path);
+        if (r_stat.is_error()) {
+          LOG(WARNING) << "Stat in files gc failed: " << r_stat.error();
+          return WalkPath::Action::Continue;
+        }
+        auto stat = r_stat.move_as_ok();
+        if (can_use_index) {
+          index_scanner.add_entry(path, stat);
+        }
+        info.size = stat.real_size_;
+        info.atime_nsec = stat.atime_nsec_;
+        info.mtime_nsec = stat.mtime_nsec_;
       }
-      auto stat = r_stat.move_as_ok();
-      if (stat.size_ == 0 && ends_with(path, "/.nomedia")) {
+      if (info.size == 0 && ends_with(path, "/.nomedia")) {
         // skip .nomedia file
         return WalkPath::Action::Continue;
       }
 
-      FsFileInfo info;
       info.path = path.str();
-      info.size = stat.real_size_;
       info.file_type = main_file_type;
-      info.atime_nsec = stat.atime_nsec_;
-      info.mtime_nsec = stat.mtime_nsec_;
       callback(info);
       return WalkPath::Action::Continue;
     }).ignore();
   }
+  if (!token) {
+    index_scanner.save();
+  }
 }
 }  // namespace
 
@@ -160,6 +160,9 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
       return res_fd.move_as_error();
     }
 
+    if (path != fd_path_) {
+      reset_prefetch();
+    }
     fd_.close();
     fd_ = res_fd.move_as_ok();
     fd_path_ = path;
@@ -196,6 +199,7 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
 }
 
 Status FileUploader::on_ok(int64 size) {
+  reset_prefetch();
   fd_.close();
   if (is_temp_) {
     LOG(INFO) << "UNLINK " << fd_path_;
@@ -205,6 +209,7 @@ Status FileUploader::on_ok(int64 size) {
 }
 
 void FileUploader::on_error(Status status) {
+  reset_prefetch();
   fd_.close();
   if (is_temp_) {
     LOG(INFO) << "UNLINK " << fd_path_;
@@ -252,26 +257,40 @@ Result<std::pair<NetQueryPtr, bool>> FileUploader::start_part(Part part, int32 p
   if (encryption_key_.is_secret()) {
     padded_size = (padded_size + 15) & ~15;
   }
-  BufferSlice bytes(padded_size);
-  TRY_RESULT(size, fd_.pread(bytes.as_slice().truncate(part.size), part.offset));
-  if (encryption_key_.is_secret()) {
-    Random::secure_bytes(bytes.as_slice().substr(part.size));
-    if (next_offset_ == part.offset) {
-      aes_ige_encrypt(as_slice(encryption_key_.key()), as_slice(iv_), bytes.as_slice(), bytes.as_slice());
+  BufferSlice bytes;
+  auto it = prefetched_parts_.find(part.id);
+  if (it != prefetched_parts_.end() && it->second.data.size() == padded_size) {
+    VLOG(file_loader) << "Use prefetched part " << part.id;
+    bytes = std::move(it->second.data);
+    if (encryption_key_.is_secret() && next_offset_ == part.offset) {
+      iv_ = it->second.next_iv;
       next_offset_ += static_cast<int64>(bytes.size());
-    } else {
-      if (part.id >= static_cast<int32>(iv_map_.size())) {
-        TRY_STATUS(generate_iv_map());
+    }
+  } else {
+    bytes = BufferSlice(padded_size);
+    TRY_RESULT(size, fd_.pread(bytes.as_slice().truncate(part.size), part.offset));
+    if (encryption_key_.is_secret()) {
+      Random::secure_bytes(bytes.as_slice().substr(part.size));
+      if (next_offset_ == part.offset) {
+        aes_ige_encrypt(as_slice(encryption_key_.key()), as_slice(iv_), bytes.as_slice(), bytes.as_slice());
+        next_offset_ += static_cast<int64>(bytes.size());
+      } else {
+        if (part.id >= static_cast<int32>(iv_map_.size())) {
+          TRY_STATUS(generate_iv_map());
+        }
+        CHECK(part.id < static_cast<int32>(iv_map_.size()) && part.id >= 0);
+        auto iv = iv_map_[part.id];
+        aes_ige_encrypt(as_slice(encryption_key_.key()), as_slice(iv), bytes.as_slice(), bytes.as_slice());
       }
-      CHECK(part.id < static_cast<int32>(iv_map_.size()) && part.id >= 0);
-      auto iv = iv_map_[part.id];
-      aes_ige_encrypt(as_slice(encryption_key_.key()), as_slice(iv), bytes.as_slice(), bytes.as_slice());
     }
-  }
 
-  if (size != part.size) {
-    return Status::Error("Failed to read file part");
+    if (size != part.size) {
+      return Status::Error("Failed to read file part");
+    }
   }
+  // parts are started in increasing order, so prefetched data for the previous parts will not be needed
+  prefetched_parts_.erase(prefetched_parts_.begin(), prefetched_parts_.upper_bound(part.id));
+  prefetch_parts(part.id + 1, part_count);
 
   NetQueryPtr net_query;
   if (big_flag_) {
@@ -286,9 +305,65 @@ Result<std::pair<NetQueryPtr, bool>> FileUploader::start_part(Part part, int32 p
   return std::make_pair(std::move(net_query), false);
 }
 
-Result<size_t> FileUploader::process_part(Part part, NetQueryPtr net_query) {
+void FileUploader::prefetch_parts(int32 first_part_id, int32 part_count) {
+  if (!big_flag_ || !local_is_ready_ || fd_path_.empty()) {
+    return;
+  }
+  if (!part_reader_.empty() && next_prefetch_part_ < first_part_id) {
+    // the parts were started before they were prefetched, so the reader is too slow to be useful
+    reset_prefetch();
+  }
+
+  auto part_size = static_cast<int64>(get_part_size());
+  if (part_reader_.empty()) {
+    auto offset = part_size * first_part_id;
+    if (encryption_key_.is_secret()) {
+      if (next_offset_ != offset) {
+        // the reader must continue the current AES-IGE chain
+        return;
+      }
+      part_reader_ = create_actor_on_scheduler<FilePartReader>("FilePartReader", G()->get_gc_scheduler_id(), fd_path_,
+                                                               encryption_key_.key(), iv_, offset);
+    } else {
+      part_reader_ = create_actor_on_scheduler<FilePartReader>("FilePartReader", G()->get_gc_scheduler_id(), fd_path_);
+    }
+    next_prefetch_part_ = first_part_id;
+  }
+
+  auto end_part_id = td::min(first_part_id + PREFETCH_PART_COUNT, part_count);
+  for (; next_prefetch_part_ < end_part_id; next_prefetch_part_++) {
+    auto offset = part_size * next_prefetch_part_;
+    if (offset >= local_size_) {
+      break;
+    }
+    Part part{next_prefetch_part_, offset, narrow_cast<size_t>(td::min(part_size, local_size_ - offset))};
+    send_closure(part_reader_, &FilePartReader::read, part,
+                 PromiseCreator::lambda([actor_id = actor_id(this), part_id = part.id,
+                                         generation = prefetch_generation_](Result<FilePartReader::PartData> result) {
+                   if (result.is_ok()) {
+                     send_closure(actor_id, &FileUploader::on_part_read, part_id, generation, result.move_as_ok());
+                   }
+                 }));
+  }
+}
+
+void FileUploader::on_part_read(int32 part_id, uint32 generation, FilePartReader::PartData part_data) {
+  if (generation != prefetch_generation_) {
+    return;
+  }
+  VLOG(file_loader) << "Prefetched part " << part_id;
+  prefetched_parts_[part_id] = std::move(part_data);
+}
+
+void FileUploader::reset_prefetch() {
+  part_reader_.reset();
+  prefetched_parts_.clear();
+  prefetch_generation_++;
+}
+
+void FileUploader::process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) {
   if (net_query->is_error()) {
-    return std::move(net_query->error());
+    return promise.set_error(std::move(net_query->error()));
   }
   Result<bool> result = [&] {
     if (big_flag_) {
@@ -298,13 +373,13 @@ Result<size_t> FileUploader::process_part(Part part, NetQueryPtr net_query) {
     }
   }();
   if (result.is_error()) {
-    return result.move_as_error();
+    return promise.set_error(result.move_as_error());
   }
   if (!result.ok()) {
     // TODO: it is possible
-    return Status::Error(500, "Internal Server Error");
+    return promise.set_error(Status::Error(500, "Internal Server Error"));
   }
-  return part.size;
+  promise.set_value(std::move(part.size));
 }
 
 void FileUploader::on_progress(Progress progress) {
@@ -324,6 +399,9 @@ FileLoader::Callback *FileUploader::get_callback() {
 
 void FileUploader::keep_fd_flag(bool keep_fd) {
   keep_fd_ = keep_fd;
+  if (!keep_fd_) {
+    reset_prefetch();
+  }
   try_release_fd();
 }
 
@@ -9,12 +9,17 @@
 #include "td/telegram/files/FileEncryptionKey.h"
 #include "td/telegram/files/FileLoader.h"
 #include "td/telegram/files/FileLocation.h"
+#include "td/telegram/files/FilePartReader.h"
 #include "td/telegram/files/FileType.h"
 
+#include "td/actor/actor.h"
+
+#include "td/utils/buffer.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/Status.h"
 #include "td/utils/UInt.h"
 
+#include <map>
 #include <utility>
 
 namespace td {
@@ -58,6 +63,13 @@ class FileUploader : public FileLoader {
   int64 file_id_;
   bool big_flag_;
 
+  // parts of big files are read ahead by part_reader_ while previous parts are being uploaded
+  static constexpr int32 PREFETCH_PART_COUNT = 8;
+  ActorOwn<FilePartReader> part_reader_;
+  std::map<int32, FilePartReader::PartData> prefetched_parts_;
+  int32 next_prefetch_part_ = 0;
+  uint32 prefetch_generation_ = 0;
+
   Result<FileInfo> init() override TD_WARN_UNUSED_RESULT;
   Status on_ok(int64 size) override TD_WARN_UNUSED_RESULT;
   void on_error(Status status) override;
@@ -65,7 +77,7 @@ class FileUploader : public FileLoader {
   void after_start_parts() override;
   Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int32 part_count,
                                                   int64 streaming_offset) override TD_WARN_UNUSED_RESULT;
-  Result<size_t> process_part(Part part, NetQueryPtr net_query) override TD_WARN_UNUSED_RESULT;
+  void process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) override;
   void on_progress(Progress progress) override;
   FileLoader::Callback *get_callback() override;
   Result<PrefixInfo> on_update_local_location(const LocalFileLocation &location,
@@ -73,6 +85,10 @@ class FileUploader : public FileLoader {
 
   Status generate_iv_map();
 
+  void prefetch_parts(int32 first_part_id, int32 part_count);
+  void on_part_read(int32 part_id, uint32 generation, FilePartReader::PartData part_data);
+  void reset_prefetch();
+
   bool keep_fd_ = false;
   void keep_fd_flag(bool keep_fd) override;
   void try_release_fd();
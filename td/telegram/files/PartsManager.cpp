@@ -136,6 +136,13 @@ Status PartsManager::init(int64 size, int64 expected_size, bool is_size_final, s
       part_size_ *= 2;
       CHECK(part_size_ <= MAX_PART_SIZE);
     }
+    if (!is_upload_) {
+      // big files are downloaded faster in bigger parts, because there are less queries per downloaded byte
+      while (part_size_ < MAX_DOWNLOAD_PART_SIZE &&
+             calc_part_count(expected_size_, part_size_) > 2 * MIN_DOWNLOAD_PART_COUNT) {
+        part_size_ *= 2;
+      }
+    }
   }
   LOG_CHECK(1 <= size_) << tag("size_", size_);
   LOG_CHECK(!use_part_count_limit || calc_part_count(expected_size_, part_size_) <= MAX_PART_COUNT)
@@ -56,6 +56,8 @@ class PartsManager {
  private:
   static constexpr int MAX_PART_COUNT = 4000;
   static constexpr size_t MAX_PART_SIZE = 512 * (1 << 10);
+  static constexpr size_t MAX_DOWNLOAD_PART_SIZE = 1 << 20;
+  static constexpr int MIN_DOWNLOAD_PART_COUNT = 64;
   static constexpr int64 MAX_FILE_SIZE = static_cast<int64>(MAX_PART_SIZE) * MAX_PART_COUNT;
 
   enum class PartStatus : int32 { Empty, Pending, Ready };
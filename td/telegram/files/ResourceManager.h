@@ -21,7 +21,8 @@ namespace td {
 class ResourceManager : public Actor {
  public:
   enum class Mode : int32 { Baseline, Greedy };
-  explicit ResourceManager(Mode mode) : mode_(mode) {
+  explicit ResourceManager(Mode mode, int64 max_resource_limit = MAX_RESOURCE_LIMIT)
+      : mode_(mode), max_resource_limit_(max_resource_limit) {
   }
   // use through ActorShared
   void update_priority(int8 priority);
@@ -30,9 +31,11 @@ class ResourceManager : public Actor {
   void register_worker(ActorShared<FileLoaderActor> callback, int8 priority);
 
   static constexpr int64 MAX_RESOURCE_LIMIT = 1 << 21;
+  static constexpr int64 MAX_DOWNLOAD_RESOURCE_LIMIT = 1 << 23;
 
  private:
   Mode mode_;
+  int64 max_resource_limit_;
   using NodeId = uint64;
   struct Node : public HeapNode {
     NodeId node_id;
@@ -0,0 +1,41 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/logevent/LogEvent.h"
+
+#include "td/utils/port/thread_local.h"
+
+namespace td {
+namespace log_event {
+
+static TD_THREAD_LOCAL string *store_buffer;  // static zero-initialized
+static TD_THREAD_LOCAL bool is_store_buffer_used;
+
+LogEventStoreBuffer::LogEventStoreBuffer() {
+  if (is_store_buffer_used) {
+    buffer_ = &temporary_buffer_;
+    return;
+  }
+  init_thread_local<string>(store_buffer);
+  is_store_buffer_used = true;
+  buffer_ = store_buffer;
+}
+
+LogEventStoreBuffer::~LogEventStoreBuffer() {
+  if (buffer_ != store_buffer) {
+    return;
+  }
+  is_store_buffer_used = false;
+
+  // don't keep memory used for occasional huge objects
+  constexpr size_t MAX_KEPT_BUFFER_SIZE = 1 << 20;
+  if (store_buffer->size() > MAX_KEPT_BUFFER_SIZE) {
+    string().swap(*store_buffer);
+  }
+}
+
+}  // namespace log_event
+}  // namespace td
@@ -22,6 +22,7 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <cstring>
 #include <type_traits>
 
 namespace td {
@@ -234,29 +235,74 @@ class LogEventStorerUnsafe : public WithContext<TlStorerUnsafe, Global *> {
   }
 };
 
+class LogEventStorerGrowable : public WithContext<TlStorerGrowable, Global *> {
+ public:
+  explicit LogEventStorerGrowable(string &buf) : WithContext<TlStorerGrowable, Global *>(buf) {
+    store_int(static_cast<int32>(Version::Next) - 1);
+    set_context(G());
+  }
+};
+
+// a per-thread buffer for LogEventStorerGrowable; nested users get a temporary buffer
+class LogEventStoreBuffer {
+ public:
+  LogEventStoreBuffer();
+  LogEventStoreBuffer(const LogEventStoreBuffer &) = delete;
+  LogEventStoreBuffer &operator=(const LogEventStoreBuffer &) = delete;
+  LogEventStoreBuffer(LogEventStoreBuffer &&) = delete;
+  LogEventStoreBuffer &operator=(LogEventStoreBuffer &&) = delete;
+  ~LogEventStoreBuffer();
+
+  string &get() {
+    return *buffer_;
+  }
+
+ private:
+  string *buffer_;
+  string temporary_buffer_;
+};
+
+// serializes data in a single pass instead of calculating its length first
+template <class T>
+BufferSlice store_to_buffer_slice(const T &data) {
+  LogEventStoreBuffer buffer;
+  LogEventStorerGrowable storer(buffer.get());
+  store(data, storer);
+
+  BufferSlice value_buffer(storer.as_slice());
+  LOG_CHECK(is_aligned_pointer<4>(value_buffer.as_slice().ubegin())) << value_buffer.as_slice().ubegin();
+  return value_buffer;
+}
+
 template <class T>
 class LogEventStorerImpl : public Storer {
  public:
   explicit LogEventStorerImpl(const T &event) : event_(event) {
   }
 
+  // the event is serialized once in size() and then copied in store()
   size_t size() const override {
-    LogEventStorerCalcLength storer;
+    LogEventStorerGrowable storer(buffer_);
     td::store(event_, storer);
-    return storer.get_length();
+    length_ = storer.get_length();
+    return length_;
   }
   size_t store(uint8 *ptr) const override {
-    LogEventStorerUnsafe storer(ptr);
-    td::store(event_, storer);
+    if (length_ == 0) {
+      size();
+    }
+    std::memcpy(ptr, buffer_.data(), length_);
 #ifdef TD_DEBUG
     T check_result;
-    log_event_parse(check_result, Slice(ptr, storer.get_buf())).ensure();
+    log_event_parse(check_result, Slice(ptr, length_)).ensure();
 #endif
-    return static_cast<size_t>(storer.get_buf() - ptr);
+    return length_;
   }
 
  private:
   const T &event_;
+  mutable string buffer_;
+  mutable size_t length_ = 0;
 };
 
 }  // namespace log_event
@@ -265,6 +311,7 @@ using LogEvent = log_event::LogEvent;
 using LogEventParser = log_event::LogEventParser;
 using LogEventStorerCalcLength = log_event::LogEventStorerCalcLength;
 using LogEventStorerUnsafe = log_event::LogEventStorerUnsafe;
+using LogEventStorerGrowable = log_event::LogEventStorerGrowable;
 
 template <class T>
 Status log_event_parse(T &data, Slice slice) TD_WARN_UNUSED_RESULT;
@@ -279,15 +326,7 @@ Status log_event_parse(T &data, Slice slice) {
 
 template <class T>
 BufferSlice log_event_store(const T &data) {
-  LogEventStorerCalcLength storer_calc_length;
-  store(data, storer_calc_length);
-
-  BufferSlice value_buffer{storer_calc_length.get_length()};
-  auto ptr = value_buffer.as_slice().ubegin();
-  LOG_CHECK(is_aligned_pointer<4>(ptr)) << ptr;
-
-  LogEventStorerUnsafe storer_unsafe(ptr);
-  store(data, storer_unsafe);
+  auto value_buffer = log_event::store_to_buffer_slice(data);
 
 #ifdef TD_DEBUG
   T check_result;
@@ -38,6 +38,7 @@
 #include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 
+#include <set>
 #include <utility>
 
 namespace td {
@@ -218,6 +219,7 @@ void ConnectionCreator::remove_proxy(int32 proxy_id, Promise<Unit> promise) {
   }
 
   proxies_.erase(proxy_id);
+  proxy_health_.erase(proxy_id);
 
   G()->td_db()->get_binlog_pmc()->erase(get_proxy_database_key(proxy_id));
   G()->td_db()->get_binlog_pmc()->erase(get_proxy_used_database_key(proxy_id));
@@ -363,7 +365,7 @@ void ConnectionCreator::ping_proxy_resolved(int32 proxy_id, IPAddress ip_address
   const Proxy &proxy = it->second;
   auto main_dc_id = G()->net_query_dispatcher().main_dc_id();
   FindConnectionExtra extra;
-  auto r_socket_fd = find_connection(proxy, ip_address, main_dc_id, false, extra);
+  auto r_socket_fd = find_connection(proxy, ip_address, main_dc_id, false, 0, extra);
   if (r_socket_fd.is_error()) {
     return promise.set_error(Status::Error(400, r_socket_fd.error().public_message()));
   }
@@ -607,6 +609,10 @@ void ConnectionCreator::on_mtproto_error(size_t hash) {
   auto &client = clients_[hash];
   client.hash = hash;
   client.mtproto_error_flood_control.add_event(static_cast<int32>(Time::now_cached()));
+
+  if (need_check_proxies()) {
+    proxy_health_[active_proxy_id_].on_failure(0.1);
+  }
 }
 
 void ConnectionCreator::request_raw_connection(DcId dc_id, bool allow_media_only, bool is_media,
@@ -693,15 +699,20 @@ Result<mtproto::TransportType> ConnectionCreator::get_transport_type(const Proxy
 }
 
 Result<SocketFd> ConnectionCreator::find_connection(const Proxy &proxy, const IPAddress &proxy_ip_address, DcId dc_id,
-                                                    bool allow_media_only, FindConnectionExtra &extra) {
+                                                    bool allow_media_only, size_t option_index,
+                                                    FindConnectionExtra &extra) {
   extra.debug_str = PSTRING() << "Failed to find valid IP address for " << dc_id;
   bool prefer_ipv6 =
       G()->shared_config().get_option_boolean("prefer_ipv6") || (proxy.use_proxy() && proxy_ip_address.is_ipv6());
   bool only_http = proxy.use_http_caching_proxy();
-  TRY_RESULT(info, dc_options_set_.find_connection(
-                       dc_id, allow_media_only, proxy.use_proxy() && proxy.use_socks5_proxy(), prefer_ipv6, only_http));
+  TRY_RESULT(info, dc_options_set_.find_connection(dc_id, allow_media_only,
+                                                   proxy.use_proxy() && proxy.use_socks5_proxy(), prefer_ipv6,
+                                                   only_http, option_index));
   extra.stat = info.stat;
   TRY_RESULT_ASSIGN(extra.transport_type, get_transport_type(proxy, info));
+  // the transport or proxy handshake is sent together with the SYN
+  extra.use_fast_open = G()->shared_config().get_option_boolean("use_tcp_fast_open") &&
+                        (info.stat == nullptr || info.stat->can_use_fast_open());
 
   extra.debug_str = PSTRING() << " to " << (info.option->is_media_only() ? "MEDIA " : "") << dc_id
                               << (info.use_http ? " over HTTP" : "");
@@ -710,7 +721,7 @@ Result<SocketFd> ConnectionCreator::find_connection(const Proxy &proxy, const IP
     extra.debug_str = PSTRING() << "MTProto " << proxy_ip_address << extra.debug_str;
 
     VLOG(connections) << "Create: " << extra.debug_str;
-    return SocketFd::open(proxy_ip_address);
+    return SocketFd::open(proxy_ip_address, extra.use_fast_open);
   }
 
   extra.check_mode |= info.should_check;
@@ -720,11 +731,11 @@ Result<SocketFd> ConnectionCreator::find_connection(const Proxy &proxy, const IP
     extra.debug_str = PSTRING() << (proxy.use_socks5_proxy() ? "Socks5" : (only_http ? "HTTP_ONLY" : "HTTP_TCP")) << ' '
                                 << proxy_ip_address << " --> " << extra.mtproto_ip_address << extra.debug_str;
     VLOG(connections) << "Create: " << extra.debug_str;
-    return SocketFd::open(proxy_ip_address);
+    return SocketFd::open(proxy_ip_address, extra.use_fast_open);
   } else {
     extra.debug_str = PSTRING() << info.option->get_ip_address() << extra.debug_str;
     VLOG(connections) << "Create: " << extra.debug_str;
-    return SocketFd::open(info.option->get_ip_address());
+    return SocketFd::open(info.option->get_ip_address(), extra.use_fast_open);
   }
 }
 
@@ -861,7 +872,7 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
       return;
     }
     if (check_mode) {
-      if (client.checking_connections >= 3) {
+      if (client.checking_connections >= ClientInfo::MAX_CHECKING_CONNECTIONS) {
         return;
       }
     } else {
@@ -889,8 +900,12 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
     // Create new RawConnection
     // sync part
+    // checked connections race against each other, so try different addresses of the DC simultaneously
+    // the first connection passing the check is used and the others are kept as ready connections
     FindConnectionExtra extra;
-    auto r_socket_fd = find_connection(proxy, proxy_ip_address_, client.dc_id, client.allow_media_only, extra);
+    auto option_index = check_mode ? client.checking_connections : 0;
+    auto r_socket_fd =
+        find_connection(proxy, proxy_ip_address_, client.dc_id, client.allow_media_only, option_index, extra);
     check_mode |= extra.check_mode;
     if (r_socket_fd.is_error()) {
       LOG(WARNING) << extra.debug_str << ": " << r_socket_fd.error();
@@ -922,10 +937,12 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
     auto promise = PromiseCreator::lambda(
         [actor_id = actor_id(this), check_mode, transport_type = extra.transport_type, hash = client.hash,
-         debug_str = extra.debug_str,
-         network_generation = network_generation_](Result<ConnectionData> r_connection_data) mutable {
+         debug_str = extra.debug_str, network_generation = network_generation_,
+         option_stat = extra.stat,
+         use_fast_open = extra.use_fast_open](Result<ConnectionData> r_connection_data) mutable {
           send_closure(std::move(actor_id), &ConnectionCreator::client_create_raw_connection,
-                       std::move(r_connection_data), check_mode, transport_type, hash, debug_str, network_generation);
+                       std::move(r_connection_data), check_mode, transport_type, hash, debug_str, network_generation,
+                       option_stat, use_fast_open);
         });
 
     auto stats_callback =
@@ -943,7 +960,8 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
 void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
                                                      mtproto::TransportType transport_type, size_t hash,
-                                                     string debug_str, uint32 network_generation) {
+                                                     string debug_str, uint32 network_generation,
+                                                     DcOptionsSet::Stat *option_stat, bool use_fast_open) {
   unique_ptr<mtproto::AuthData> auth_data;
   uint64 auth_data_generation{0};
   int64 session_id{0};
@@ -959,7 +977,8 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
     }
   }
   auto promise = PromiseCreator::lambda([actor_id = actor_id(this), hash, check_mode, auth_data_generation, session_id,
-                                         debug_str](Result<unique_ptr<mtproto::RawConnection>> result) mutable {
+                                         debug_str, option_stat,
+                                         use_fast_open](Result<unique_ptr<mtproto::RawConnection>> result) mutable {
     if (result.is_ok()) {
       VLOG(connections) << "Ready connection (" << (check_mode ? "" : "un") << "checked) " << result.ok().get() << ' '
                         << tag("rtt", format::as_time(result.ok()->rtt_)) << ' ' << debug_str;
@@ -968,7 +987,7 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
                         << debug_str;
     }
     send_closure(std::move(actor_id), &ConnectionCreator::client_add_connection, hash, std::move(result), check_mode,
-                 auth_data_generation, session_id);
+                 auth_data_generation, session_id, option_stat, use_fast_open);
   });
 
   if (r_connection_data.is_error()) {
@@ -1003,7 +1022,8 @@ void ConnectionCreator::client_set_timeout_at(ClientInfo &client, double wakeup_
 }
 
 void ConnectionCreator::client_add_connection(size_t hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection,
-                                              bool check_flag, uint64 auth_data_generation, int64 session_id) {
+                                              bool check_flag, uint64 auth_data_generation, int64 session_id,
+                                              DcOptionsSet::Stat *option_stat, bool use_fast_open) {
   auto &client = clients_[hash];
   client.add_session_id(session_id);
   CHECK(client.pending_connections > 0);
@@ -1016,8 +1036,14 @@ void ConnectionCreator::client_add_connection(size_t hash, Result<unique_ptr<mtp
     VLOG(connections) << "Add ready connection " << r_raw_connection.ok().get() << " for "
                       << tag("client", format::as_hex(hash));
     client.backoff.clear();
+    if (check_flag && option_stat != nullptr) {
+      option_stat->on_rtt(r_raw_connection.ok()->rtt_);
+    }
     client.ready_connections.emplace_back(r_raw_connection.move_as_ok(), Time::now_cached());
   } else {
+    if (use_fast_open && option_stat != nullptr) {
+      option_stat->on_fast_open_error();
+    }
     if (r_raw_connection.error().code() == -404 && client.auth_data &&
         client.auth_data_generation == auth_data_generation) {
       VLOG(connections) << "Drop auth data from " << tag("client", format::as_hex(hash));
@@ -1042,6 +1068,30 @@ void ConnectionCreator::on_dc_options(DcOptions new_dc_options) {
 #if !TD_EMSCRIPTEN  // FIXME
   dc_options_set_.add_dc_options(std::move(new_dc_options));
 #endif
+  warm_up_dc_authorizations();
+}
+
+void ConnectionCreator::update_dc_authorization_warmup() {
+  warm_up_dc_authorizations();
+}
+
+// initializes all known DCs in advance, so DcAuthManager exports authorization to them as soon as the user is logged in
+// and the first request to a non-main DC doesn't need to wait for auth key creation and authorization import
+void ConnectionCreator::warm_up_dc_authorizations() {
+  if (!G()->shared_config().get_option_boolean("use_dc_authorization_warmup") || !G()->have_net_query_dispatcher()) {
+    return;
+  }
+  std::set<int32> dc_ids;
+  for (auto &dc_option : dc_options_set_.get_dc_options().dc_options) {
+    auto dc_id = dc_option.get_dc_id();
+    if (dc_id.is_exact() && dc_id.is_internal()) {
+      dc_ids.insert(dc_id.get_raw_id());
+    }
+  }
+  for (auto dc_id : dc_ids) {
+    VLOG(connections) << "Warm up authorization in DC" << dc_id;
+    G()->net_query_dispatcher().update_valid_dc(DcId::internal(dc_id));
+  }
 }
 
 void ConnectionCreator::on_dc_update(DcId dc_id, string ip_port, Promise<> promise) {
@@ -1276,6 +1326,14 @@ void ConnectionCreator::loop() {
     }
   }
 
+  if (!close_flag_ && need_check_proxies() && pending_proxy_check_count_ == 0) {
+    if (check_proxies_timestamp_.is_in_past()) {
+      check_proxies_timestamp_ = Timestamp::in(PROXY_CHECK_INTERVAL);
+      check_proxies();
+    }
+    timeout.relax(check_proxies_timestamp_);
+  }
+
   if (timeout) {
     set_timeout_at(timeout.at());
   }
@@ -1331,4 +1389,92 @@ void ConnectionCreator::on_ping_main_dc_result(uint64 token, Result<double> resu
   }
 }
 
+void ConnectionCreator::ProxyHealth::on_check_result(Result<double> r_rtt) {
+  is_last_check_failed = r_rtt.is_error();
+  if (r_rtt.is_error()) {
+    return on_failure(0.3);
+  }
+  failure_rate *= 0.7;
+  rtt = is_checked ? 0.7 * rtt + 0.3 * r_rtt.ok() : r_rtt.ok();
+  is_checked = true;
+}
+
+void ConnectionCreator::ProxyHealth::on_failure(double weight) {
+  failure_rate = (1 - weight) * failure_rate + weight;
+}
+
+double ConnectionCreator::ProxyHealth::get_score() const {
+  return rtt + failure_rate * PROXY_FAILURE_PENALTY;
+}
+
+bool ConnectionCreator::need_check_proxies() const {
+  return active_proxy_id_ != 0 && proxies_.size() > 1 &&
+         G()->shared_config().get_option_boolean("proxy_auto_failover");
+}
+
+void ConnectionCreator::update_proxy_auto_failover() {
+  check_proxies_timestamp_ = Timestamp();
+  loop();
+}
+
+void ConnectionCreator::check_proxies() {
+  CHECK(pending_proxy_check_count_ == 0);
+  for (auto &it : proxies_) {
+    auto proxy_id = it.first;
+    pending_proxy_check_count_++;
+    ping_proxy(proxy_id, PromiseCreator::lambda([actor_id = actor_id(this), proxy_id](Result<double> result) {
+                 send_closure(actor_id, &ConnectionCreator::on_proxy_checked, proxy_id, std::move(result));
+               }));
+  }
+}
+
+void ConnectionCreator::on_proxy_checked(int32 proxy_id, Result<double> result) {
+  CHECK(pending_proxy_check_count_ > 0);
+  pending_proxy_check_count_--;
+  if (proxies_.count(proxy_id) != 0) {
+    if (result.is_error()) {
+      VLOG(connections) << "Failed to check proxy " << proxy_id << ": " << result.error();
+    }
+    proxy_health_[proxy_id].on_check_result(std::move(result));
+  }
+
+  if (pending_proxy_check_count_ == 0) {
+    try_switch_to_best_proxy();
+    loop();
+  }
+}
+
+void ConnectionCreator::try_switch_to_best_proxy() {
+  if (close_flag_ || !need_check_proxies()) {
+    return;
+  }
+
+  int32 best_proxy_id = 0;
+  double best_score = 0;
+  for (auto &it : proxy_health_) {
+    if (proxies_.count(it.first) == 0 || !it.second.is_checked || it.second.is_last_check_failed) {
+      continue;
+    }
+    auto score = it.second.get_score();
+    if (best_proxy_id == 0 || score < best_score) {
+      best_proxy_id = it.first;
+      best_score = score;
+    }
+  }
+  if (best_proxy_id == 0 || best_proxy_id == active_proxy_id_) {
+    return;
+  }
+
+  // switch only if the active proxy is much worse to avoid flapping between similar proxies
+  auto &active_health = proxy_health_[active_proxy_id_];
+  auto active_score = active_health.is_checked ? active_health.get_score() : PROXY_FAILURE_PENALTY;
+  if (!active_health.is_last_check_failed && active_score < 2 * best_score + 0.1) {
+    return;
+  }
+
+  LOG(WARNING) << "Switch from proxy " << active_proxy_id_ << " with score " << active_score << " to proxy "
+               << best_proxy_id << " with score " << best_score;
+  enable_proxy_impl(best_proxy_id);
+}
+
 }  // namespace td
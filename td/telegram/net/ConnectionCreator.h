@@ -82,6 +82,8 @@ class ConnectionCreator : public NetQueryCallback {
   void get_proxies(Promise<td_api::object_ptr<td_api::proxies>> promise);
   void get_proxy_link(int32 proxy_id, Promise<string> promise);
   void ping_proxy(int32 proxy_id, Promise<double> promise);
+  void update_proxy_auto_failover();
+  void update_dc_authorization_warmup();
 
   struct ConnectionData {
     SocketFd socket_fd;
@@ -118,6 +120,25 @@ class ConnectionCreator : public NetQueryCallback {
   Timestamp resolve_proxy_timestamp_;
   uint64 resolve_proxy_query_token_{0};
 
+  // health of proxies, which is checked in background if the option "proxy_auto_failover" is enabled
+  struct ProxyHealth {
+    double rtt = 0;
+    double failure_rate = 0;  // exponential moving average of ping failures and MTProto errors
+    bool is_checked = false;
+    bool is_last_check_failed = false;
+
+    void on_check_result(Result<double> r_rtt);
+    void on_failure(double weight);
+
+    // returns an estimate of time needed to send a query through the proxy; lower is better
+    double get_score() const;
+  };
+  static constexpr double PROXY_CHECK_INTERVAL = 60.0;
+  static constexpr double PROXY_FAILURE_PENALTY = 10.0;
+  std::unordered_map<int32, ProxyHealth> proxy_health_;
+  Timestamp check_proxies_timestamp_;
+  size_t pending_proxy_check_count_ = 0;
+
   struct ClientInfo {
     class Backoff {
 #if TD_ANDROID || TD_DARWIN_IOS || TD_DARWIN_WATCH_OS || TD_TIZEN
@@ -158,6 +179,7 @@ class ConnectionCreator : public NetQueryCallback {
     std::vector<Promise<unique_ptr<mtproto::RawConnection>>> queries;
 
     static constexpr double READY_CONNECTIONS_TIMEOUT = 10;
+    static constexpr size_t MAX_CHECKING_CONNECTIONS = 3;
 
     bool inited{false};
     size_t hash{0};
@@ -206,6 +228,7 @@ class ConnectionCreator : public NetQueryCallback {
   void loop() override;
 
   void save_dc_options();
+  void warm_up_dc_authorizations();
   Result<SocketFd> do_request_connection(DcId dc_id, bool allow_media_only);
   Result<std::pair<unique_ptr<mtproto::RawConnection>, bool>> do_request_raw_connection(DcId dc_id,
                                                                                         bool allow_media_only,
@@ -221,9 +244,10 @@ class ConnectionCreator : public NetQueryCallback {
   void client_loop(ClientInfo &client);
   void client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
                                     mtproto::TransportType transport_type, size_t hash, string debug_str,
-                                    uint32 network_generation);
+                                    uint32 network_generation, DcOptionsSet::Stat *option_stat, bool use_fast_open);
   void client_add_connection(size_t hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection, bool check_flag,
-                             uint64 auth_data_generation, int64 session_id);
+                             uint64 auth_data_generation, int64 session_id, DcOptionsSet::Stat *option_stat,
+                             bool use_fast_open);
   void client_set_timeout_at(ClientInfo &client, double wakeup_at);
 
   void on_proxy_resolved(Result<IPAddress> ip_address, bool dummy);
@@ -234,13 +258,14 @@ class ConnectionCreator : public NetQueryCallback {
     string debug_str;
     IPAddress mtproto_ip_address;
     bool check_mode{false};
+    bool use_fast_open{false};
   };
 
   static Result<mtproto::TransportType> get_transport_type(const Proxy &proxy,
                                                            const DcOptionsSet::ConnectionInfo &info);
 
   Result<SocketFd> find_connection(const Proxy &proxy, const IPAddress &proxy_ip_address, DcId dc_id,
-                                   bool allow_media_only, FindConnectionExtra &extra);
+                                   bool allow_media_only, size_t option_index, FindConnectionExtra &extra);
 
   ActorId<GetHostByNameActor> get_dns_resolver();
 
@@ -250,6 +275,11 @@ class ConnectionCreator : public NetQueryCallback {
                             Promise<double> promise);
 
   void on_ping_main_dc_result(uint64 token, Result<double> result);
+
+  bool need_check_proxies() const;
+  void check_proxies();
+  void on_proxy_checked(int32 proxy_id, Result<double> result);
+  void try_switch_to_best_proxy();
 };
 
 }  // namespace td
@@ -131,7 +131,8 @@ vector<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_all_connections(DcId dc_
 }
 
 Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, bool allow_media_only, bool use_static,
-                                                                   bool prefer_ipv6, bool only_http) {
+                                                                   bool prefer_ipv6, bool only_http,
+                                                                   size_t option_index) {
   auto options = find_all_connections(dc_id, allow_media_only, use_static, prefer_ipv6, only_http);
 
   if (options.empty()) {
@@ -145,7 +146,7 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
                          return a_option.stat->error_at > b_option.stat->error_at;
                        })->stat->error_at;
 
-  auto result = *std::min_element(options.begin(), options.end(), [](const auto &a_option, const auto &b_option) {
+  std::sort(options.begin(), options.end(), [](const auto &a_option, const auto &b_option) {
     auto &a = *a_option.stat;
     auto &b = *b_option.stat;
     auto a_state = a.state();
@@ -154,6 +155,13 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
       return a_state < b_state;
     }
     if (a_state == Stat::State::Ok) {
+      // prefer options with the least known RTT
+      if ((a.rtt == 0) != (b.rtt == 0)) {
+        return b.rtt == 0;
+      }
+      if (a.rtt != b.rtt) {
+        return a.rtt < b.rtt;
+      }
       if (a_option.order == b_option.order) {
         return a_option.use_http < b_option.use_http;
       }
@@ -163,6 +171,7 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
     }
     return a_option.order < b_option.order;
   });
+  auto result = options[option_index < options.size() ? option_index : 0];
   result.should_check = !result.stat->is_ok() || result.use_http || last_error_at > Time::now_cached() - 10;
   return result;
 }
@@ -28,6 +28,8 @@ class DcOptionsSet {
     double ok_at{-1000};
     double error_at{-1001};
     double check_at{-1002};
+    double rtt{0};  // smoothed round-trip time of successful connection checks; 0 if unknown
+    double fast_open_error_at{-1e9};
     enum class State : int32 { Ok, Error, Checking };
 
     void on_ok() {
@@ -39,6 +41,19 @@ class DcOptionsSet {
     void on_check() {
       check_at = Time::now_cached();
     }
+    void on_fast_open_error() {
+      fast_open_error_at = Time::now_cached();
+    }
+    // TCP Fast Open isn't used for an hour after a failed connection with it, because some middleboxes drop such SYNs
+    bool can_use_fast_open() const {
+      return fast_open_error_at + 3600 < Time::now_cached();
+    }
+    void on_rtt(double new_rtt) {
+      if (new_rtt <= 0) {
+        return;
+      }
+      rtt = rtt == 0 ? new_rtt : rtt * 0.75 + new_rtt * 0.25;
+    }
     bool is_ok() const {
       return state() == State::Ok;
     }
@@ -64,8 +79,9 @@ class DcOptionsSet {
   vector<ConnectionInfo> find_all_connections(DcId dc_id, bool allow_media_only, bool use_static, bool prefer_ipv6,
                                               bool only_http);
 
+  // returns option_index-th best connection, or the best connection if there are not enough connections
   Result<ConnectionInfo> find_connection(DcId dc_id, bool allow_media_only, bool use_static, bool prefer_ipv6,
-                                         bool only_http);
+                                         bool only_http, size_t option_index = 0);
   void reset();
 
  private:
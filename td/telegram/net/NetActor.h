@@ -40,7 +40,7 @@ class NetActor : public NetQueryCallback {
 
 class NetActorOnce : public NetActor {
   void hangup() override {
-    on_error(0, Status::Error(500, "Request aborted"));
+    on_error(0, STATIC_ERROR(500, "Request aborted"));
     stop();
   }
 
@@ -35,6 +35,17 @@ void NetQuery::on_net_read(size_t size) {
   G()->get_net_stats_file_callbacks().at(file_type_)->on_read(size);
 }
 
+void NetQuery::on_finished() {
+  set_stage(NetQueryStats::Stage::Result);
+  if (stats_ != nullptr) {
+    stats_->on_query_finished(stats_dc_id_, tl_constructor_, stage_times_);
+  }
+
+  // the query can be resent by the callback, so the next attempt is measured separately
+  stage_times_.fill(0.0);
+  stage_ = NetQueryStats::Stage::Creation;
+}
+
 int32 NetQuery::tl_magic(const BufferSlice &buffer_slice) {
   auto slice = buffer_slice.as_slice();
   if (slice.size() < 4) {
@@ -43,6 +54,39 @@ int32 NetQuery::tl_magic(const BufferSlice &buffer_slice) {
   return as<int32>(slice.begin());
 }
 
+NetQueryStats::QueryClass NetQuery::get_default_query_class(int32 tl_constructor) {
+  switch (tl_constructor) {
+    case telegram_api::messages_sendMessage::ID:
+    case telegram_api::messages_sendMedia::ID:
+    case telegram_api::messages_sendMultiMedia::ID:
+    case telegram_api::messages_sendInlineBotResult::ID:
+    case telegram_api::messages_forwardMessages::ID:
+    case telegram_api::messages_editMessage::ID:
+    case telegram_api::messages_setTyping::ID:
+    case telegram_api::messages_readHistory::ID:
+    case telegram_api::channels_readHistory::ID:
+    case telegram_api::messages_getBotCallbackAnswer::ID:
+    case telegram_api::account_updateStatus::ID:
+      return NetQueryStats::QueryClass::Interactive;
+    case telegram_api::messages_getHistory::ID:
+    case telegram_api::messages_search::ID:
+    case telegram_api::messages_searchGlobal::ID:
+    case telegram_api::messages_getDialogs::ID:
+    case telegram_api::messages_getMessages::ID:
+    case telegram_api::channels_getMessages::ID:
+    case telegram_api::updates_getChannelDifference::ID:
+    case telegram_api::messages_getStickerSet::ID:
+    case telegram_api::upload_getFile::ID:
+    case telegram_api::upload_saveFilePart::ID:
+    case telegram_api::upload_saveBigFilePart::ID:
+    case telegram_api::upload_getWebFile::ID:
+    case telegram_api::upload_getCdnFile::ID:
+      return NetQueryStats::QueryClass::Background;
+    default:
+      return NetQueryStats::QueryClass::Default;
+  }
+}
+
 void NetQuery::set_error(Status status, string source) {
   if (status.code() == Error::Resend || status.code() == Error::Cancelled ||
       status.code() == Error::ResendInvokeAfter) {
@@ -14,6 +14,8 @@
 #include "td/actor/PromiseFuture.h"
 #include "td/actor/SignalSlot.h"
 
+#include "td/tl/TlArena.h"
+
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
 #include "td/utils/format.h"
@@ -26,6 +28,7 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/TsList.h"
 
+#include <array>
 #include <atomic>
 #include <utility>
 
@@ -231,6 +234,7 @@ class NetQuery : public TsListNode<NetQueryDebug> {
 
   void stop_track() {
     nq_counter_ = NetQueryCounter();
+    stats_ = nullptr;
     remove();
   }
 
@@ -251,6 +255,17 @@ class NetQuery : public TsListNode<NetQueryDebug> {
     }
   }
 
+  // time spent in the previous stage is accumulated until the query is finished
+  void set_stage(NetQueryStats::Stage stage) {
+    auto now = Time::now();
+    stage_times_[static_cast<size_t>(stage_)] += now - stage_start_time_;
+    stage_ = stage;
+    stage_start_time_ = now;
+  }
+
+  // reports stage times to NetQueryStats before the query is passed to the callback
+  void on_finished();
+
   void set_callback(ActorShared<NetQueryCallback> callback) {
     callback_ = std::move(callback);
   }
@@ -275,6 +290,13 @@ class NetQuery : public TsListNode<NetQueryDebug> {
     priority_ = priority;
   }
 
+  NetQueryStats::QueryClass query_class() const {
+    return query_class_;
+  }
+  void set_query_class(NetQueryStats::QueryClass query_class) {
+    query_class_ = query_class;
+  }
+
  private:
   State state_ = State::Empty;
   Type type_ = Type::Common;
@@ -294,6 +316,12 @@ class NetQuery : public TsListNode<NetQueryDebug> {
 
   bool may_be_lost_ = false;
   int8 priority_{0};
+  NetQueryStats::QueryClass query_class_ = NetQueryStats::QueryClass::Default;
+
+  NetQueryStats *stats_ = nullptr;
+  NetQueryStats::Stage stage_ = NetQueryStats::Stage::Creation;
+  double stage_start_time_ = 0;
+  std::array<double, NetQueryStats::STAGE_COUNT> stage_times_{};
 
   template <class T>
   struct movable_atomic : public std::atomic<T> {
@@ -329,6 +357,8 @@ class NetQuery : public TsListNode<NetQueryDebug> {
 
   static int32 tl_magic(const BufferSlice &buffer_slice);
 
+  static NetQueryStats::QueryClass get_default_query_class(int32 tl_constructor);
+
  public:
   double next_timeout_ = 1;          // for NetQueryDelayer
   double total_timeout_ = 0;         // for NetQueryDelayer/SequenceDispatcher
@@ -340,6 +370,10 @@ class NetQuery : public TsListNode<NetQueryDebug> {
   Slot cancel_slot_;                 // for Session and to be set by caller
   Promise<> quick_ack_promise_;      // for Session and to be set by caller
   int32 file_type_ = -1;             // to be set by caller
+  int32 stats_dc_id_ = 0;            // for NetQueryStats, set by NetQueryDispatcher
+  bool is_rate_limited_ = false;     // for NetQueryDispatcher and NetQueryDelayer
+  double cache_ttl_ = -1;            // for NetQueryCache and to be set by caller for idempotent queries
+  string cache_key_;                 // for NetQueryCache
 
   NetQuery(State state, uint64 id, BufferSlice &&query, BufferSlice &&answer, DcId dc_id, Type type, AuthFlag auth_flag,
            GzipFlag gzip_flag, int32 tl_constructor, double total_timeout_limit, NetQueryStats *stats)
@@ -353,13 +387,16 @@ class NetQuery : public TsListNode<NetQueryDebug> {
       , query_(std::move(query))
       , answer_(std::move(answer))
       , tl_constructor_(tl_constructor)
+      , query_class_(get_default_query_class(tl_constructor))
       , total_timeout_limit_(total_timeout_limit) {
     auto &data = get_data_unsafe();
     data.my_id_ = get_my_id();
     data.start_timestamp_ = data.state_timestamp_ = Time::now();
+    stage_start_time_ = data.start_timestamp_;
     LOG(INFO) << *this;
     if (stats) {
       nq_counter_ = stats->register_query(this);
+      stats_ = stats;
     }
   }
 };
@@ -396,6 +433,7 @@ inline void cancel_query(NetQueryRef &ref) {
 
 template <class T>
 Result<typename T::ReturnType> fetch_result(const BufferSlice &message) {
+  TlArena::Guard arena_guard;
   TlBufferParser parser(&message);
   auto result = T::fetch_result(parser);
   parser.fetch_end();
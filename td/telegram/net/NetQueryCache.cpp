@@ -0,0 +1,120 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/net/NetQueryCache.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Time.h"
+
+namespace td {
+
+NetQueryPtr NetQueryCache::process_query(NetQueryPtr net_query, int32 dc_id) {
+  CHECK(net_query->cache_ttl_ >= 0);
+  CHECK(net_query->cache_key_.empty());
+  if (net_query->auth_flag() != NetQuery::AuthFlag::On || !net_query->invoke_after().empty()) {
+    return net_query;
+  }
+
+  auto query = net_query->query().as_slice();
+  string key = PSTRING() << dc_id << ':' << static_cast<int32>(net_query->type()) << ':';
+  key.append(query.data(), query.size());
+
+  auto now = Time::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &entry = entries_[key];
+  if (!entry.is_sent && !entry.answer.empty()) {
+    if (entry.expires_at > now) {
+      statistics_.hit_count++;
+      VLOG(net_query) << "Answer " << net_query << " from cache";
+      net_query->set_ok(entry.answer.clone());
+      return net_query;
+    }
+    entry.answer = BufferSlice();
+  }
+  if (entry.is_sent) {
+    statistics_.coalesced_count++;
+    VLOG(net_query) << "Wait for result of identical query for " << net_query;
+    net_query->debug("waiting for identical query");
+    entry.waiting_queries.push_back(std::move(net_query));
+    return NetQueryPtr();
+  }
+
+  statistics_.miss_count++;
+  entry.is_sent = true;
+  net_query->cache_key_ = std::move(key);
+  if (entries_.size() > MAX_ENTRY_COUNT) {
+    delete_expired_entries(now);
+  }
+  return net_query;
+}
+
+vector<NetQueryPtr> NetQueryCache::on_query_result(NetQuery &net_query) {
+  CHECK(!net_query.cache_key_.empty());
+  CHECK(net_query.is_ready());
+  auto key = std::move(net_query.cache_key_);
+  net_query.cache_key_.clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  CHECK(it != entries_.end());
+  auto &entry = it->second;
+  CHECK(entry.is_sent);
+  entry.is_sent = false;
+  auto waiting_queries = std::move(entry.waiting_queries);
+  entry.waiting_queries.clear();
+
+  bool is_cancelled = net_query.is_error() && net_query.error().code() == NetQuery::Cancelled;
+  if (!is_cancelled) {
+    // the waiting queries will be sent again if the query was cancelled
+    for (auto &query : waiting_queries) {
+      if (net_query.is_ok()) {
+        query->set_ok(net_query.ok().clone());
+      } else {
+        query->set_error(net_query.error().clone());
+      }
+    }
+  }
+  if (net_query.is_ok() && net_query.cache_ttl_ > 0) {
+    entry.answer = net_query.ok().clone();
+    entry.expires_at = Time::now() + net_query.cache_ttl_;
+  } else {
+    entries_.erase(it);
+  }
+  return waiting_queries;
+}
+
+vector<NetQueryPtr> NetQueryCache::clear() {
+  vector<NetQueryPtr> result;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &it : entries_) {
+    append(result, std::move(it.second.waiting_queries));
+  }
+  entries_.clear();
+  return result;
+}
+
+NetQueryCache::Statistics NetQueryCache::get_statistics(bool reset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto result = statistics_;
+  if (reset) {
+    statistics_ = Statistics();
+  }
+  return result;
+}
+
+void NetQueryCache::delete_expired_entries(double now) {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (!it->second.is_sent && it->second.expires_at <= now) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace td
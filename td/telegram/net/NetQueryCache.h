@@ -0,0 +1,58 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/net/NetQuery.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace td {
+
+// Coalesces identical idempotent queries and caches their results for a short time.
+// Queries opt in by setting non-negative NetQuery::cache_ttl_. Can be used from any thread.
+class NetQueryCache {
+ public:
+  struct Statistics {
+    uint64 hit_count = 0;        // queries answered from the cache
+    uint64 coalesced_count = 0;  // queries attached to an identical query being sent
+    uint64 miss_count = 0;       // queries sent to the server
+  };
+
+  // returns the query if it must be sent or is already answered, or an empty pointer if it waits for another query
+  NetQueryPtr process_query(NetQueryPtr net_query, int32 dc_id);
+
+  // must be called for a sent query with non-empty cache_key_ before it is completed;
+  // returns identical queries, which were waiting for it; they are answered unless the query was cancelled
+  vector<NetQueryPtr> on_query_result(NetQuery &net_query);
+
+  // returns all waiting queries
+  vector<NetQueryPtr> clear();
+
+  Statistics get_statistics(bool reset);
+
+ private:
+  static constexpr size_t MAX_ENTRY_COUNT = 1000;
+
+  struct Entry {
+    vector<NetQueryPtr> waiting_queries;
+    bool is_sent = false;
+    BufferSlice answer;
+    double expires_at = 0;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<string, Entry> entries_;
+  Statistics statistics_;
+
+  void delete_expired_entries(double now);
+};
+
+}  // namespace td
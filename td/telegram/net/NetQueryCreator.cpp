@@ -19,6 +19,26 @@
 
 namespace td {
 
+NetQuery::GzipFlag NetQueryCreator::compress_query(BufferSlice &query) {
+  constexpr size_t MIN_GZIPPED_SIZE = 128;
+  constexpr double MAX_COMPRESSION_RATIO = 0.9;
+  if (query.size() < MIN_GZIPPED_SIZE) {
+    return NetQuery::GzipFlag::Off;
+  }
+
+  // the estimate is cheap and almost never wrong for incompressible data,
+  // so the query is compressed at most once and the compression is stopped as soon as the output buffer is full
+  if (estimate_gzip_compression_ratio(query.as_slice()) >= MAX_COMPRESSION_RATIO) {
+    return NetQuery::GzipFlag::Off;
+  }
+  BufferSlice compressed = gzencode(query.as_slice(), MAX_COMPRESSION_RATIO);
+  if (compressed.empty()) {
+    return NetQuery::GzipFlag::Off;
+  }
+  query = std::move(compressed);
+  return NetQuery::GzipFlag::On;
+}
+
 NetQueryPtr NetQueryCreator::create(const telegram_api::Function &function, DcId dc_id, NetQuery::Type type) {
   return create(UniqueId::next(), function, dc_id, type, NetQuery::AuthFlag::On);
 }
@@ -34,25 +54,7 @@ NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::Function &fun
 
   int32 tl_constructor = function.get_id();
 
-  size_t MIN_GZIPPED_SIZE = 128;
-  auto gzip_flag = slice.size() < MIN_GZIPPED_SIZE ? NetQuery::GzipFlag::Off : NetQuery::GzipFlag::On;
-  if (slice.size() >= 16384) {
-    // test compression ratio for the middle part
-    // if it is less than 0.9, then try to compress the whole request
-    size_t TESTED_SIZE = 1024;
-    BufferSlice compressed_part = gzencode(slice.as_slice().substr((slice.size() - TESTED_SIZE) / 2, TESTED_SIZE), 0.9);
-    if (compressed_part.empty()) {
-      gzip_flag = NetQuery::GzipFlag::Off;
-    }
-  }
-  if (gzip_flag == NetQuery::GzipFlag::On) {
-    BufferSlice compressed = gzencode(slice.as_slice(), 0.9);
-    if (compressed.empty()) {
-      gzip_flag = NetQuery::GzipFlag::Off;
-    } else {
-      slice = std::move(compressed);
-    }
-  }
+  auto gzip_flag = compress_query(slice);
 
   double total_timeout_limit = 60;
   if (!G()->close_flag()) {
@@ -49,6 +49,13 @@ class NetQueryCreator {
   NetQueryPtr create(uint64 id, const telegram_api::Function &function, DcId dc_id, NetQuery::Type type,
                      NetQuery::AuthFlag auth_flag);
 
+  NetQueryStats *get_net_query_stats() const {
+    return net_query_stats_.get();
+  }
+
+  // replaces the serialized query with its compressed version if compression is useful; can be called from any thread
+  static NetQuery::GzipFlag compress_query(BufferSlice &query);
+
  private:
   std::shared_ptr<NetQueryStats> net_query_stats_;
   ObjectPool<NetQuery> object_pool_;
@@ -20,6 +20,7 @@ namespace td {
 
 void NetQueryDelayer::delay(NetQueryPtr query) {
   query->debug("trying to delay");
+  query->set_stage(NetQueryStats::Stage::Delay);
   query->is_ready();
   CHECK(query->is_error());
   auto code = query->error().code();
@@ -81,6 +82,17 @@ void NetQueryDelayer::delay(NetQueryPtr query) {
 
   LOG(WARNING) << "Delay: " << query << " " << tag("timeout", timeout) << tag("total_timeout", query->total_timeout_)
                << " because of " << error << " from " << query->source_;
+  delay_impl(std::move(query), timeout);
+}
+
+void NetQueryDelayer::delay_rate_limited(NetQueryPtr query, double timeout) {
+  CHECK(query->is_rate_limited_);
+  query->set_stage(NetQueryStats::Stage::Delay);
+  VLOG(net_query) << "Delay " << query << " for " << timeout << " because of rate limit";
+  delay_impl(std::move(query), timeout);
+}
+
+void NetQueryDelayer::delay_impl(NetQueryPtr query, double timeout) {
   query->debug(PSTRING() << "delay for " << format::as_time(timeout));
   auto id = container_.create(QuerySlot());
   auto *query_slot = container_.get(id);
@@ -103,7 +115,7 @@ void NetQueryDelayer::on_slot_event(uint64 id) {
     return;
   }
   auto query = std::move(slot->query_);
-  if (!query->invoke_after().empty()) {
+  if (!query->is_rate_limited_ && !query->invoke_after().empty()) {
     // Fail query after timeout expired if it is a part of an invokeAfter chain.
     // It is not necessary but helps to avoid server problems, when previous query was lost.
     query->set_error_resend_invoke_after();
@@ -115,7 +127,7 @@ void NetQueryDelayer::on_slot_event(uint64 id) {
 
 void NetQueryDelayer::tear_down() {
   container_.for_each([](auto id, auto &query_slot) {
-    query_slot.query_->set_error(Status::Error(500, "Request aborted"));
+    query_slot.query_->set_error(STATIC_ERROR(500, "Request aborted"));
     G()->net_query_dispatcher().dispatch(std::move(query_slot.query_));
   });
 }
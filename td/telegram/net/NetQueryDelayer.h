@@ -21,6 +21,8 @@ class NetQueryDelayer : public Actor {
   }
   void delay(NetQueryPtr query);
 
+  void delay_rate_limited(NetQueryPtr query, double timeout);
+
  private:
   struct QuerySlot {
     NetQueryPtr query_;
@@ -28,6 +30,8 @@ class NetQueryDelayer : public Actor {
   };
   Container<QuerySlot> container_;
   ActorShared<> parent_;
+  void delay_impl(NetQueryPtr query, double timeout);
+
   void wakeup() override;
 
   void on_slot_event(uint64 id);
@@ -10,6 +10,7 @@
 #include "td/telegram/net/DcAuthManager.h"
 #include "td/telegram/net/NetQuery.h"
 #include "td/telegram/net/NetQueryDelayer.h"
+#include "td/telegram/net/NetQueryRateLimiter.h"
 #include "td/telegram/net/PublicRsaKeyShared.h"
 #include "td/telegram/net/PublicRsaKeyWatchdog.h"
 #include "td/telegram/net/SessionMultiProxy.h"
@@ -30,13 +31,14 @@
 namespace td {
 
 void NetQueryDispatcher::complete_net_query(NetQueryPtr net_query) {
+  net_query->on_finished();
   auto callback = net_query->move_callback();
   if (callback.empty()) {
     net_query->debug("sent to td (no callback)");
-    send_closure(G()->td(), &NetQueryCallback::on_result, std::move(net_query));
+    send_closure_urgent(G()->td(), &NetQueryCallback::on_result, std::move(net_query));
   } else {
     net_query->debug("sent to callback", true);
-    send_closure(std::move(callback), &NetQueryCallback::on_result, std::move(net_query));
+    send_closure_urgent(std::move(callback), &NetQueryCallback::on_result, std::move(net_query));
   }
 }
 
@@ -44,7 +46,7 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
   // net_query->debug("dispatch");
   if (stop_flag_.load(std::memory_order_relaxed)) {
     if (net_query->id() != 0) {
-      net_query->set_error(Status::Error(500, "Request aborted"));
+      net_query->set_error(STATIC_ERROR(500, "Request aborted"));
     }
     return complete_net_query(std::move(net_query));
   }
@@ -86,12 +88,49 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
   }
 
   if (net_query->is_ready()) {
+    if (!net_query->cache_key_.empty()) {
+      bool is_cancelled = net_query->is_error() && net_query->error().code() == NetQuery::Cancelled;
+      for (auto &query : query_cache_.on_query_result(*net_query)) {
+        if (is_cancelled) {
+          dispatch(std::move(query));
+        } else {
+          complete_net_query(std::move(query));
+        }
+      }
+    }
     return complete_net_query(std::move(net_query));
   }
 
+  if (net_query->cache_ttl_ >= 0 && net_query->cache_key_.empty() && !net_query->is_rate_limited_) {
+    net_query = query_cache_.process_query(std::move(net_query), dest_dc_id.get_raw_id());
+    if (net_query.empty()) {
+      return;
+    }
+    if (net_query->is_ready()) {
+      return complete_net_query(std::move(net_query));
+    }
+  }
+
+  if (net_query->is_rate_limited_) {
+    net_query->is_rate_limited_ = false;
+  } else if (net_query->id() != 0) {
+    auto &config = G()->shared_config();
+    auto delay = NetQueryRateLimiter::reserve(
+        G()->get_my_id(), dest_dc_id.get_raw_id(), net_query->tl_constructor(),
+        narrow_cast<int32>(config.get_option_integer("query_rate_limit_per_dc")),
+        narrow_cast<int32>(config.get_option_integer("query_rate_limit_per_function")));
+    if (delay > 0) {
+      net_query->is_rate_limited_ = true;
+      net_query->debug("sent to NetQueryDelayer because of rate limit");
+      return send_closure(delayer_, &NetQueryDelayer::delay_rate_limited, std::move(net_query), delay);
+    }
+  }
+
   if (net_query->dispatch_ttl_ > 0) {
     net_query->dispatch_ttl_--;
   }
+  net_query->set_stage(NetQueryStats::Stage::Dispatch);
+  net_query->stats_dc_id_ = dest_dc_id.get_raw_id();
 
   size_t dc_pos = static_cast<size_t>(dest_dc_id.get_raw_id() - 1);
   CHECK(dc_pos < dcs_.size());
@@ -155,26 +194,29 @@ Status NetQueryDispatcher::wait_dc_init(DcId dc_id, bool force) {
     }
     auto auth_data = AuthDataShared::create(dc_id, std::move(public_rsa_key), td_guard_);
     int32 session_count = get_session_count();
+    int32 max_session_count = get_max_session_count();
     bool use_pfs = get_use_pfs();
 
     int32 slow_net_scheduler_id = G()->get_slow_net_scheduler_id();
 
     auto raw_dc_id = dc_id.get_raw_id();
     int32 upload_session_count = raw_dc_id != 2 && raw_dc_id != 4 ? 8 : 4;
-    int32 download_session_count = 2;
+    // CDN DCs serve only file parts, so more connections are used to increase download throughput
+    int32 download_session_count = is_cdn ? 4 : 2;
     int32 download_small_session_count = 2;
     dc.main_session_ = create_actor<SessionMultiProxy>(PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":main",
-                                                       session_count, auth_data, raw_dc_id == main_dc_id_, use_pfs,
-                                                       false, false, is_cdn, need_destroy_key);
+                                                       session_count, max_session_count, auth_data,
+                                                       raw_dc_id == main_dc_id_, use_pfs, false, false, is_cdn,
+                                                       need_destroy_key);
     dc.upload_session_ = create_actor_on_scheduler<SessionMultiProxy>(
-        PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":upload", slow_net_scheduler_id, upload_session_count,
+        PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":upload", slow_net_scheduler_id, upload_session_count, 0,
         auth_data, false, use_pfs, false, true, is_cdn, need_destroy_key);
     dc.download_session_ = create_actor_on_scheduler<SessionMultiProxy>(
         PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":download", slow_net_scheduler_id, download_session_count,
-        auth_data, false, use_pfs, true, true, is_cdn, need_destroy_key);
+        0, auth_data, false, use_pfs, true, true, is_cdn, need_destroy_key);
     dc.download_small_session_ = create_actor_on_scheduler<SessionMultiProxy>(
         PSLICE() << "SessionMultiProxy:" << raw_dc_id << ":download_small", slow_net_scheduler_id,
-        download_small_session_count, auth_data, false, use_pfs, true, true, is_cdn, need_destroy_key);
+        download_small_session_count, 0, auth_data, false, use_pfs, true, true, is_cdn, need_destroy_key);
     dc.is_inited_ = true;
     if (dc_id.is_internal()) {
       send_closure_later(dc_auth_manager_, &DcAuthManager::add_dc, std::move(auth_data));
@@ -210,15 +252,21 @@ void NetQueryDispatcher::stop() {
   }
   public_rsa_key_watchdog_.reset();
   dc_auth_manager_.reset();
+  for (auto &query : query_cache_.clear()) {
+    query->set_error(STATIC_ERROR(500, "Request aborted"));
+    complete_net_query(std::move(query));
+  }
 }
 
 void NetQueryDispatcher::update_session_count() {
   std::lock_guard<std::mutex> guard(main_dc_id_mutex_);
   int32 session_count = get_session_count();
+  int32 max_session_count = get_max_session_count();
   bool use_pfs = get_use_pfs();
   for (size_t i = 1; i < MAX_DC_COUNT; i++) {
     if (is_dc_inited(narrow_cast<int32>(i))) {
-      send_closure_later(dcs_[i - 1].main_session_, &SessionMultiProxy::update_options, session_count, use_pfs);
+      send_closure_later(dcs_[i - 1].main_session_, &SessionMultiProxy::update_options, session_count,
+                         max_session_count, use_pfs);
       send_closure_later(dcs_[i - 1].upload_session_, &SessionMultiProxy::update_use_pfs, use_pfs);
       send_closure_later(dcs_[i - 1].download_session_, &SessionMultiProxy::update_use_pfs, use_pfs);
       send_closure_later(dcs_[i - 1].download_small_session_, &SessionMultiProxy::update_use_pfs, use_pfs);
@@ -274,8 +322,13 @@ int32 NetQueryDispatcher::get_session_count() {
   return max(narrow_cast<int32>(G()->shared_config().get_option_integer("session_count")), 1);
 }
 
+int32 NetQueryDispatcher::get_max_session_count() {
+  return narrow_cast<int32>(G()->shared_config().get_option_integer("session_count_max"));
+}
+
 bool NetQueryDispatcher::get_use_pfs() {
-  return G()->shared_config().get_option_boolean("use_pfs") || get_session_count() > 1;
+  return G()->shared_config().get_option_boolean("use_pfs") || get_session_count() > 1 ||
+         get_max_session_count() > 1;
 }
 
 NetQueryDispatcher::NetQueryDispatcher(std::function<ActorShared<>()> create_reference) {
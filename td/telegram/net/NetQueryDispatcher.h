@@ -8,6 +8,7 @@
 
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCache.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
@@ -58,11 +59,16 @@ class NetQueryDispatcher {
 
   void set_main_dc_id(int32 new_main_dc_id);
 
+  NetQueryCache::Statistics get_query_cache_statistics(bool reset) {
+    return query_cache_.get_statistics(reset);
+  }
+
  private:
   std::atomic<bool> stop_flag_{false};
   bool need_destroy_auth_key_{false};
   ActorOwn<NetQueryDelayer> delayer_;
   ActorOwn<DcAuthManager> dc_auth_manager_;
+  NetQueryCache query_cache_;
   struct Dc {
     DcId id_;
     std::atomic<bool> is_valid_{false};
@@ -89,6 +95,7 @@ class NetQueryDispatcher {
   bool is_dc_inited(int32 raw_dc_id);
 
   static int32 get_session_count();
+  static int32 get_max_session_count();
   static bool get_use_pfs();
 
   static void complete_net_query(NetQueryPtr net_query);
@@ -0,0 +1,63 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/net/NetQueryRateLimiter.h"
+
+#include "td/utils/misc.h"
+#include "td/utils/Time.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace td {
+
+namespace {
+struct SharedTokenBuckets {
+  std::mutex mutex;
+  std::map<std::tuple<int32, int32, int32>, NetQueryRateLimiter::TokenBucket> buckets;  // my_id, dc_id, function
+};
+
+NetQueryRateLimiter::TokenBucket &get_token_bucket(int32 my_id, int32 dc_id, int32 tl_constructor) {
+  static SharedTokenBuckets shared_buckets;
+  std::lock_guard<std::mutex> lock(shared_buckets.mutex);
+  // map nodes are never removed, so the reference remains valid after the mutex is released
+  return shared_buckets.buckets[std::make_tuple(my_id, dc_id, tl_constructor)];
+}
+
+int64 reserve_token(int32 my_id, int32 dc_id, int32 tl_constructor, int32 rate_limit, int64 now) {
+  if (rate_limit <= 0) {
+    return 0;
+  }
+  // up to 5 seconds worth of queries can be sent at once
+  auto capacity = td::max(static_cast<int64>(rate_limit / 12), static_cast<int64>(1));
+  auto interval = static_cast<int64>(60000000) / rate_limit;
+  return get_token_bucket(my_id, dc_id, tl_constructor).reserve(now, interval, capacity);
+}
+}  // namespace
+
+int64 NetQueryRateLimiter::TokenBucket::reserve(int64 now, int64 interval, int64 capacity) {
+  auto arrival_time = theoretical_arrival_time_.load(std::memory_order_relaxed);
+  while (true) {
+    auto new_arrival_time = td::max(arrival_time, now) + interval;
+    if (theoretical_arrival_time_.compare_exchange_weak(arrival_time, new_arrival_time, std::memory_order_relaxed)) {
+      return td::max(new_arrival_time - now - capacity * interval, static_cast<int64>(0));
+    }
+  }
+}
+
+double NetQueryRateLimiter::reserve(int32 my_id, int32 dc_id, int32 tl_constructor, int32 dc_rate_limit,
+                                    int32 function_rate_limit) {
+  if (dc_rate_limit <= 0 && function_rate_limit <= 0) {
+    return 0.0;
+  }
+  auto now = static_cast<int64>(Time::now() * 1e6);
+  auto delay = td::max(reserve_token(my_id, dc_id, 0, dc_rate_limit, now),
+                       reserve_token(my_id, dc_id, tl_constructor, function_rate_limit, now));
+  return static_cast<double>(delay) * 1e-6;
+}
+
+}  // namespace td
@@ -0,0 +1,36 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <atomic>
+
+namespace td {
+
+// Spaces out queries to avoid receiving FLOOD_WAIT errors from the server.
+// Limits are enforced per DC and per Telegram API function for each user and are shared between all clients
+// of the process, so clients logged in to the same account don't exceed the limits together.
+class NetQueryRateLimiter {
+ public:
+  // returns time in seconds, for which the query must be delayed; rate limits are specified in queries per minute,
+  // 0 means no limit
+  static double reserve(int32 my_id, int32 dc_id, int32 tl_constructor, int32 dc_rate_limit,
+                        int32 function_rate_limit);
+
+  // lock-free token bucket, implemented as generic cell rate algorithm
+  class TokenBucket {
+   public:
+    // reserves a token and returns delay in microseconds before it can be used
+    int64 reserve(int64 now, int64 interval, int64 capacity);
+
+   private:
+    std::atomic<int64> theoretical_arrival_time_{0};
+  };
+};
+
+}  // namespace td
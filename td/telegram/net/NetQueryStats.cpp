@@ -8,6 +8,7 @@
 
 #include "td/telegram/net/NetQuery.h"
 
+#include "td/utils/bits.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -15,10 +16,99 @@
 
 namespace td {
 
+constexpr size_t NetQueryStats::STAGE_COUNT;
+constexpr int NetQueryStats::Histogram::SUB_BUCKET_BITS;
+constexpr uint64 NetQueryStats::Histogram::LINEAR_LIMIT;
+
+Slice NetQueryStats::get_stage_name(Stage stage) {
+  switch (stage) {
+    case Stage::Creation:
+      return Slice("creation");
+    case Stage::Dispatch:
+      return Slice("dispatch");
+    case Stage::Delay:
+      return Slice("delay");
+    case Stage::SessionQueue:
+      return Slice("session_queue");
+    case Stage::Network:
+      return Slice("network");
+    case Stage::Result:
+      return Slice("result");
+    default:
+      UNREACHABLE();
+      return Slice();
+  }
+}
+
+size_t NetQueryStats::Histogram::get_bucket(uint64 microseconds) {
+  if (microseconds < LINEAR_LIMIT) {
+    return static_cast<size_t>(microseconds);
+  }
+  auto high_bit = 63 - count_leading_zeroes_non_zero64(microseconds);
+  auto sub_bucket = (microseconds >> (high_bit - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+  return static_cast<size_t>(LINEAR_LIMIT + ((high_bit - SUB_BUCKET_BITS - 1) << SUB_BUCKET_BITS) + sub_bucket);
+}
+
+uint64 NetQueryStats::Histogram::get_bucket_upper_bound(size_t bucket) {
+  if (bucket < LINEAR_LIMIT) {
+    return bucket;
+  }
+  auto shift = ((bucket - LINEAR_LIMIT) >> SUB_BUCKET_BITS) + 1;
+  auto sub_bucket = (bucket - LINEAR_LIMIT) & ((1 << SUB_BUCKET_BITS) - 1);
+  return (((1 << SUB_BUCKET_BITS) + sub_bucket + 1) << shift) - 1;
+}
+
+void NetQueryStats::Histogram::add(double duration) {
+  if (duration < 0) {
+    duration = 0;
+  }
+  constexpr uint64 MAX_MICROSECONDS = static_cast<uint64>(1) << 40;
+  auto microseconds = td::min(static_cast<uint64>(duration * 1e6), MAX_MICROSECONDS);
+  auto bucket = get_bucket(microseconds);
+  if (bucket >= buckets_.size()) {
+    buckets_.resize(bucket + 1);
+  }
+  buckets_[bucket]++;
+  count_++;
+  total_ += duration;
+  max_ = td::max(max_, duration);
+}
+
+void NetQueryStats::Histogram::merge(const Histogram &other) {
+  if (other.buckets_.size() > buckets_.size()) {
+    buckets_.resize(other.buckets_.size());
+  }
+  for (size_t i = 0; i < other.buckets_.size(); i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  total_ += other.total_;
+  max_ = td::max(max_, other.max_);
+}
+
+double NetQueryStats::Histogram::get_percentile(int percent) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  auto rank = (count_ * percent + 99) / 100;
+  uint64 passed_count = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    passed_count += buckets_[i];
+    if (passed_count >= rank && passed_count != 0) {
+      return td::min(static_cast<double>(get_bucket_upper_bound(i) + 1) * 1e-6, max_);
+    }
+  }
+  return max_;
+}
+
 uint64 NetQueryStats::get_count() const {
   return count_.load(std::memory_order_relaxed);
 }
 
+uint64 NetQueryStats::get_queued_query_count(QueryClass query_class) const {
+  return queued_query_counts_[static_cast<size_t>(query_class)].load(std::memory_order_relaxed);
+}
+
 void NetQueryStats::dump_pending_network_queries() {
   auto n = get_count();
   LOG(WARNING) << tag("pending net queries", n);
@@ -51,4 +141,35 @@ void NetQueryStats::dump_pending_network_queries() {
     }
   }
 }
+
+void NetQueryStats::on_query_finished(int32 dc_id, int32 tl_constructor,
+                                      const std::array<double, STAGE_COUNT> &stage_times) {
+  std::lock_guard<std::mutex> guard(function_stats_mutex_);
+  auto &stats = function_stats_[std::make_pair(dc_id, tl_constructor)];
+  double total_time = 0;
+  for (size_t i = 0; i < STAGE_COUNT; i++) {
+    if (stage_times[i] > 0) {
+      // skipped stages aren't counted
+      stats.stages[i].add(stage_times[i]);
+      total_time += stage_times[i];
+    }
+  }
+  stats.total.add(total_time);
+}
+
+vector<NetQueryStats::FunctionStats> NetQueryStats::get_function_stats(bool reset) {
+  std::lock_guard<std::mutex> guard(function_stats_mutex_);
+  vector<FunctionStats> result;
+  result.reserve(function_stats_.size());
+  for (auto &it : function_stats_) {
+    result.push_back(it.second);
+    result.back().dc_id = it.first.first;
+    result.back().tl_constructor = it.first.second;
+  }
+  if (reset) {
+    function_stats_.clear();
+  }
+  return result;
+}
+
 }  // namespace td
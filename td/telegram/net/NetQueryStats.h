@@ -9,9 +9,14 @@
 #include "td/telegram/net/NetQueryCounter.h"
 
 #include "td/utils/common.h"
+#include "td/utils/Slice.h"
 #include "td/utils/TsList.h"
 
+#include <array>
 #include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
 
 namespace td {
 
@@ -29,6 +34,64 @@ struct NetQueryDebug {
 
 class NetQueryStats {
  public:
+  // stages of a query lifecycle; time is attributed to the stage, which was left
+  enum class Stage : int32 {
+    Creation,      // from creation to the first dispatch, including waiting in sequence dispatchers
+    Dispatch,      // from NetQueryDispatcher to a Session, including waiting for authorization of the DC
+    Delay,         // in NetQueryDelayer after flood wait or server errors
+    SessionQueue,  // in the Session before it is sent to a connection
+    Network,       // from sending to a connection until the answer is received
+    Result,        // from receiving the answer until it is passed to the callback
+    Size
+  };
+  static constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::Size);
+
+  static Slice get_stage_name(Stage stage);
+
+  // scheduling classes of queries; queries of different classes share a Session in weighted fair order
+  enum class QueryClass : int8 {
+    Interactive,  // latency-critical queries, sent on behalf of the user
+    Default,
+    Background,  // bandwidth-heavy and synchronization queries
+    Size
+  };
+  static constexpr size_t QUERY_CLASS_COUNT = static_cast<size_t>(QueryClass::Size);
+
+  // HDR-style latency histogram: logarithmic buckets split into linear sub-buckets with relative error below 12.5%
+  class Histogram {
+   public:
+    void add(double duration);
+
+    void merge(const Histogram &other);
+
+    uint64 get_count() const {
+      return count_;
+    }
+
+    double get_total() const {
+      return total_;
+    }
+
+    double get_max() const {
+      return max_;
+    }
+
+    // returns an upper bound of the specified percentile in seconds
+    double get_percentile(int percent) const;
+
+   private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr uint64 LINEAR_LIMIT = 2 << SUB_BUCKET_BITS;
+
+    vector<uint32> buckets_;  // by duration in microseconds
+    uint64 count_ = 0;
+    double total_ = 0;
+    double max_ = 0;
+
+    static size_t get_bucket(uint64 microseconds);
+    static uint64 get_bucket_upper_bound(size_t bucket);
+  };
+
   NetQueryCounter register_query(TsListNode<NetQueryDebug> *query) {
     if (use_list_.load(std::memory_order_relaxed)) {
       list_.put(query);
@@ -38,12 +101,35 @@ class NetQueryStats {
 
   uint64 get_count() const;
 
+  NetQueryCounter register_queued_query(QueryClass query_class) {
+    return NetQueryCounter(&queued_query_counts_[static_cast<size_t>(query_class)]);
+  }
+
+  // returns number of queries of the class waiting in Session queues
+  uint64 get_queued_query_count(QueryClass query_class) const;
+
   void dump_pending_network_queries();
 
+  void on_query_finished(int32 dc_id, int32 tl_constructor, const std::array<double, STAGE_COUNT> &stage_times);
+
+  struct FunctionStats {
+    int32 dc_id = 0;
+    int32 tl_constructor = 0;
+    std::array<Histogram, STAGE_COUNT> stages;
+    Histogram total;  // from creation of the query until the answer is passed to the callback
+  };
+
+  // returns statistics of finished queries sorted by DC identifier and TL constructor
+  vector<FunctionStats> get_function_stats(bool reset);
+
  private:
   NetQueryCounter::Counter count_{0};
   std::atomic<bool> use_list_{true};
   TsList<NetQueryDebug> list_;
+  std::array<NetQueryCounter::Counter, QUERY_CLASS_COUNT> queued_query_counts_{};
+
+  std::mutex function_stats_mutex_;
+  std::map<std::pair<int32, int32>, FunctionStats> function_stats_;  // by DC identifier and TL constructor
 };
 
 }  // namespace td
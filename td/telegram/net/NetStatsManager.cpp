@@ -291,18 +291,39 @@ void NetStatsManager::update(NetStatsInfo &info, bool force_save) {
 }
 
 void NetStatsManager::save_stats(NetStatsInfo &info, NetType net_type) {
-  if (G()->shared_config().get_option_boolean("disable_persistent_network_statistics")) {
-    return;
+  // stats are saved in batches to avoid a database write for every update
+  auto net_type_i = static_cast<size_t>(net_type);
+  info.stats_by_type[net_type_i].need_save = true;
+  if (!has_timeout()) {
+    set_timeout_in(SAVE_STATS_DELAY);
   }
+}
 
-  auto net_type_i = static_cast<size_t>(net_type);
-  auto &type_stats = info.stats_by_type[net_type_i];
+void NetStatsManager::save_pending_stats() {
+  cancel_timeout();
+  bool is_disabled = G()->shared_config().get_option_boolean("disable_persistent_network_statistics");
+  for_each_stat([&](NetStatsInfo &info, size_t id, CSlice name, FileType file_type) {
+    for (size_t net_type_i = 0; net_type_i < net_type_size(); net_type_i++) {
+      auto &type_stats = info.stats_by_type[net_type_i];
+      if (!type_stats.need_save) {
+        continue;
+      }
+      type_stats.need_save = false;
+      if (is_disabled) {
+        continue;
+      }
+
+      auto key = PSTRING() << info.key << "#" << net_type_string(NetType(net_type_i));
+      auto stats = type_stats.mem_stats + type_stats.db_stats;
+      // LOG(ERROR) << "SAVE " << key << " " << stats;
 
-  auto key = PSTRING() << info.key << "#" << net_type_string(info.net_type);
-  auto stats = type_stats.mem_stats + type_stats.db_stats;
-  // LOG(ERROR) << "SAVE " << key << " " << stats;
+      G()->td_db()->get_binlog_pmc()->set(key, log_event_store(stats).as_slice().str());
+    }
+  });
+}
 
-  G()->td_db()->get_binlog_pmc()->set(key, log_event_store(stats).as_slice().str());
+void NetStatsManager::timeout_expired() {
+  save_pending_stats();
 }
 
 void NetStatsManager::info_loop(NetStatsInfo &info) {
@@ -77,6 +77,8 @@ class NetStatsManager : public Actor {
 
   void add_network_stats(const NetworkStatsEntry &entry);
 
+  void save_pending_stats();
+
  private:
   ActorShared<> parent_;
 
@@ -107,12 +109,15 @@ class NetStatsManager : public Actor {
 
     struct TypeStats {
       uint64 dirty_size = 0;
+      bool need_save = false;
       NetStatsData mem_stats;
       NetStatsData db_stats;
     };
     std::array<TypeStats, 5 /*NetStatsManager::net_type_size()*/> stats_by_type;
   };
 
+  static constexpr double SAVE_STATS_DELAY = 5.0;
+
   int32 since_total_{0};
   int32 since_current_{0};
   NetStatsInfo common_net_stats_;
@@ -136,6 +141,7 @@ class NetStatsManager : public Actor {
   void add_network_stats_impl(NetStatsInfo &info, const NetworkStatsEntry &entry);
 
   void start_up() override;
+  void timeout_expired() override;
   void update(NetStatsInfo &info, bool force_save);
   void save_stats(NetStatsInfo &info, NetType net_type);
   void info_loop(NetStatsInfo &info);
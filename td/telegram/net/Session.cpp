@@ -8,12 +8,14 @@
 
 #include "td/telegram/telegram_api.h"
 
+#include "td/telegram/ConfigShared.h"
 #include "td/telegram/DhCache.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcAuthManager.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/MtprotoHeader.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCreator.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
 #include "td/telegram/net/NetType.h"
 #include "td/telegram/StateManager.h"
@@ -36,6 +38,7 @@
 #include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/TraceLog.h"
 
 #include <tuple>
 #include <utility>
@@ -116,21 +119,85 @@ class GenAuthKeyActor : public Actor {
   }
 };
 
+class PrecomputeDhActor : public Actor {
+  void start_up() override {
+    DhHandshake::precompute_g_b();
+    stop();
+  }
+};
+
 }  // namespace detail
 
+double Session::PriorityQueue::get_query_class_cost(size_t query_class) {
+  static constexpr double QUERY_CLASS_WEIGHTS[QUERY_CLASS_COUNT] = {8.0, 4.0, 1.0};
+  return 1.0 / QUERY_CLASS_WEIGHTS[query_class];
+}
+
+size_t Session::PriorityQueue::find_next_class(const Level &level, bool can_send_background) {
+  size_t result = QUERY_CLASS_COUNT;
+  for (size_t i = 0; i < QUERY_CLASS_COUNT; i++) {
+    if (level.queues[i].empty() ||
+        (!can_send_background && i == static_cast<size_t>(NetQueryStats::QueryClass::Background))) {
+      continue;
+    }
+    if (result == QUERY_CLASS_COUNT || level.queues[i].front().finish_tag < level.queues[result].front().finish_tag) {
+      result = i;
+    }
+  }
+  return result;
+}
+
 void Session::PriorityQueue::push(NetQueryPtr query) {
-  auto priority = query->priority();
-  queries_[priority].push(std::move(query));
+  auto invoke_after = query->invoke_after();
+  if (!invoke_after.empty()) {
+    // queries in an invokeAfter chain must be sent in order, so they must share a queue
+    query->set_query_class(invoke_after->query_class());
+  }
+
+  auto query_class = static_cast<size_t>(query->query_class());
+  CHECK(query_class < QUERY_CLASS_COUNT);
+  auto &level = queries_[query->priority()];
+
+  // self-clocked fair queueing: a query finishes after all previously queued queries of its class
+  auto &last_finish_tag = level.last_finish_tags[query_class];
+  last_finish_tag = max(virtual_time_, last_finish_tag) + get_query_class_cost(query_class);
+
+  NetQueryCounter queued_counter;
+  auto stats = G()->net_query_creator().get_net_query_stats();
+  if (stats != nullptr) {
+    queued_counter = stats->register_queued_query(query->query_class());
+  }
+  level.queues[query_class].push(Entry{std::move(query), last_finish_tag, std::move(queued_counter)});
+  level.size++;
 }
 
-NetQueryPtr Session::PriorityQueue::pop() {
-  CHECK(!empty());
-  auto it = queries_.begin();
-  auto res = it->second.pop();
-  if (it->second.empty()) {
-    queries_.erase(it);
+NetQueryPtr Session::PriorityQueue::pop(bool can_send_background) {
+  for (auto it = queries_.begin(); it != queries_.end(); ++it) {
+    auto &level = it->second;
+    auto query_class = find_next_class(level, can_send_background);
+    if (query_class == QUERY_CLASS_COUNT) {
+      continue;
+    }
+
+    auto entry = level.queues[query_class].pop();
+    virtual_time_ = max(virtual_time_, entry.finish_tag);
+    level.size--;
+    if (level.size == 0) {
+      queries_.erase(it);
+    }
+    return std::move(entry.query);
+  }
+  UNREACHABLE();
+  return NetQueryPtr();
+}
+
+bool Session::PriorityQueue::has_query(bool can_send_background) const {
+  for (auto &it : queries_) {
+    if (find_next_class(it.second, can_send_background) != QUERY_CLASS_COUNT) {
+      return true;
+    }
   }
-  return res;
+  return false;
 }
 
 bool Session::PriorityQueue::empty() const {
@@ -249,9 +316,10 @@ void Session::connection_online_update(bool force) {
 }
 
 void Session::send(NetQueryPtr &&query) {
-  last_activity_timestamp_ = Time::now();
+  last_activity_timestamp_ = Time::now_coarse();
 
   // query->debug("Session: received from SessionProxy");
+  query->set_stage(NetQueryStats::Stage::SessionQueue);
   query->set_session_id(auth_data_.get_session_id());
   VLOG(net_query) << "Got query " << query;
   if (query->update_is_ready()) {
@@ -355,8 +423,9 @@ void Session::on_result(NetQueryPtr query) {
 }
 
 void Session::return_query(NetQueryPtr &&query) {
-  last_activity_timestamp_ = Time::now();
+  last_activity_timestamp_ = Time::now_coarse();
 
+  query->set_stage(NetQueryStats::Stage::Result);
   query->set_session_id(0);
   callback_->on_result(std::move(query));
 }
@@ -387,7 +456,7 @@ void Session::close() {
   flush_pending_invoke_after_queries();
   CHECK(sent_queries_.empty());
   while (!pending_queries_.empty()) {
-    auto query = pending_queries_.pop();
+    auto query = pending_queries_.pop(true);
     query->set_error_resend();
     return_query(std::move(query));
   }
@@ -735,6 +804,10 @@ Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t origi
   auth_data_.on_api_response();
   Query *query_ptr = &it->second;
   VLOG(net_query) << "Return query result " << query_ptr->query;
+  if (unlikely(TraceLog::is_enabled())) {
+    TraceLog::add_event(TraceLog::EventType::QueryReceived, 0, id,
+                        static_cast<uint32>(query_ptr->query->tl_constructor()));
+  }
 
   if (!parser.get_error()) {
     // Steal authorization information.
@@ -956,11 +1029,16 @@ void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_quer
                                    message_id, invoke_after_id, static_cast<bool>(net_query->quick_ack_promise_));
 
   net_query->on_net_write(net_query->query().size());
+  net_query->set_stage(NetQueryStats::Stage::Network);
 
   if (r_message_id.is_error()) {
     LOG(FATAL) << "Failed to send query: " << r_message_id.error();
   }
   message_id = r_message_id.ok();
+  if (unlikely(TraceLog::is_enabled())) {
+    TraceLog::add_event(TraceLog::EventType::QuerySent, 0, message_id,
+                        static_cast<uint32>(net_query->tl_constructor()));
+  }
   VLOG(net_query) << "Send query to connection " << net_query << " [msg_id:" << format::as_hex(message_id) << "]"
                   << tag("invoke_after", format::as_hex(invoke_after_id));
   net_query->set_message_id(message_id);
@@ -975,12 +1053,16 @@ void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_quer
     LOG(DEBUG) << "Set event for net_query cancellation " << tag("message_id", format::as_hex(message_id));
     net_query->cancel_slot_.set_event(EventCreator::raw(actor_id(), message_id));
   }
+  bool is_background = net_query->query_class() == NetQueryStats::QueryClass::Background;
   auto status = sent_queries_.emplace(
       message_id, Query{message_id, std::move(net_query), main_connection_.connection_id, Time::now_cached()});
   sent_queries_list_.put(status.first->second.get_list_node());
   if (!status.second) {
     LOG(FATAL) << "Duplicate message_id [message_id = " << message_id << "]";
   }
+  if (is_background) {
+    status.first->second.background_counter_ = NetQueryCounter(&sent_background_query_count_);
+  }
 }
 
 void Session::connection_open(ConnectionInfo *info, bool ask_info) {
@@ -1033,6 +1115,24 @@ void Session::connection_check_mode(ConnectionInfo *info) {
   }
 }
 
+mtproto::SessionConnection::PackingPolicy Session::get_packing_policy() {
+  mtproto::SessionConnection::PackingPolicy policy;
+  auto &config = G()->shared_config();
+  auto delay = config.get_option_integer("query_packing_delay", -1);
+  if (delay >= 0) {
+    policy.max_delay = static_cast<double>(delay) * 0.001;
+  }
+  auto size_max = config.get_option_integer("query_packing_size_max");
+  if (size_max > 0) {
+    policy.max_size = static_cast<size_t>(size_max);
+  }
+  auto count_max = config.get_option_integer("query_packing_count_max");
+  if (count_max > 0) {
+    policy.max_query_count = static_cast<size_t>(count_max);
+  }
+  return policy;
+}
+
 void Session::connection_open_finish(ConnectionInfo *info,
                                      Result<unique_ptr<mtproto::RawConnection>> r_raw_connection) {
   if (close_flag_ || info->state != ConnectionInfo::State::Connecting) {
@@ -1091,6 +1191,7 @@ void Session::connection_open_finish(ConnectionInfo *info,
     info->connection->destroy_key();
   }
   info->connection->set_online(connection_online_flag_, is_main_);
+  info->connection->set_packing_policy(get_packing_policy());
   info->connection->set_name(name);
   Scheduler::subscribe(info->connection->get_poll_info().extract_pollable_fd(this));
   info->mode = mode_;
@@ -1231,6 +1332,9 @@ void Session::on_handshake_ready(Result<unique_ptr<mtproto::AuthKeyHandshake>> r
         on_server_time_difference_updated();
       }
       LOG(INFO) << "Got " << (is_main ? "main" : "tmp") << " auth key";
+
+      // prepare values for the next handshake in advance
+      create_actor_on_scheduler<detail::PrecomputeDhActor>("PrecomputeDhActor", G()->get_gc_scheduler_id()).release();
     }
   }
 
@@ -1341,8 +1445,13 @@ void Session::loop() {
     while (main_connection_.state == ConnectionInfo::State::Ready) {
       if (auth_data_.is_ready(Time::now_cached())) {
         if (need_send_query()) {
-          while (!pending_queries_.empty() && sent_queries_.size() < MAX_INFLIGHT_QUERIES) {
-            auto query = pending_queries_.pop();
+          while (sent_queries_.size() < MAX_INFLIGHT_QUERIES) {
+            bool can_send_background =
+                sent_background_query_count_.load(std::memory_order_relaxed) < MAX_INFLIGHT_BACKGROUND_QUERIES;
+            if (!pending_queries_.has_query(can_send_background)) {
+              break;
+            }
+            auto query = pending_queries_.pop(can_send_background);
             connection_send_query(&main_connection_, std::move(query));
             need_flush = true;
           }
@@ -85,6 +85,7 @@ class Session final
 
     int8 connection_id;
     double sent_at_;
+    NetQueryCounter background_counter_;  // for sent background queries
     Query(uint64 message_id, NetQueryPtr &&q, int8 connection_id, double sent_at)
         : container_id(message_id), query(std::move(q)), connection_id(connection_id), sent_at_(sent_at) {
     }
@@ -126,14 +127,35 @@ class Session final
 
   // Do not invalidate iterators of these two containers!
   // TODO: better data structures
+  // Queries with higher priority are always sent first. Queries with the same priority are sent in weighted fair
+  // order of their classes, so a burst of background queries can't delay interactive ones for long.
   struct PriorityQueue {
     void push(NetQueryPtr query);
-    NetQueryPtr pop();
+    NetQueryPtr pop(bool can_send_background);
+    bool has_query(bool can_send_background) const;
     bool empty() const;
 
    private:
-    std::map<int8, VectorQueue<NetQueryPtr>, std::greater<>> queries_;
+    static constexpr size_t QUERY_CLASS_COUNT = NetQueryStats::QUERY_CLASS_COUNT;
+
+    struct Entry {
+      NetQueryPtr query;
+      double finish_tag;
+      NetQueryCounter queued_counter;
+    };
+    struct Level {
+      std::array<VectorQueue<Entry>, QUERY_CLASS_COUNT> queues;
+      std::array<double, QUERY_CLASS_COUNT> last_finish_tags{};
+      size_t size = 0;
+    };
+    std::map<int8, Level, std::greater<>> queries_;
+    double virtual_time_ = 0;
+
+    static double get_query_class_cost(size_t query_class);
+
+    static size_t find_next_class(const Level &level, bool can_send_background);
   };
+  NetQueryCounter::Counter sent_background_query_count_{0};  // must outlive sent_queries_
   PriorityQueue pending_queries_;
   std::map<uint64, Query> sent_queries_;
   std::deque<NetQueryPtr> pending_invoke_after_queries_;
@@ -168,6 +190,7 @@ class Session final
 
   static constexpr double ACTIVITY_TIMEOUT = 60 * 5;
   static constexpr size_t MAX_INFLIGHT_QUERIES = 1024;
+  static constexpr uint64 MAX_INFLIGHT_BACKGROUND_QUERIES = 16;
 
   struct ContainerInfo {
     size_t ref_cnt;
@@ -235,6 +258,7 @@ class Session final
   void connection_add(unique_ptr<mtproto::RawConnection> raw_connection);
   void connection_check_mode(ConnectionInfo *info);
   void connection_open_finish(ConnectionInfo *info, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection);
+  static mtproto::SessionConnection::PackingPolicy get_packing_policy();
 
   void connection_online_update(bool force = false);
   void connection_close(ConnectionInfo *info);
@@ -11,7 +11,9 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 
@@ -20,10 +22,11 @@ namespace td {
 SessionMultiProxy::SessionMultiProxy() = default;
 SessionMultiProxy::~SessionMultiProxy() = default;
 
-SessionMultiProxy::SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDataShared> shared_auth_data,
-                                     bool is_main, bool use_pfs, bool allow_media_only, bool is_media, bool is_cdn,
-                                     bool need_destroy_auth_key)
+SessionMultiProxy::SessionMultiProxy(int32 session_count, int32 max_session_count,
+                                     std::shared_ptr<AuthDataShared> shared_auth_data, bool is_main, bool use_pfs,
+                                     bool allow_media_only, bool is_media, bool is_cdn, bool need_destroy_auth_key)
     : session_count_(session_count)
+    , max_session_count_(max_session_count)
     , auth_data_(std::move(shared_auth_data))
     , is_main_(is_main)
     , use_pfs_(use_pfs)
@@ -46,10 +49,16 @@ void SessionMultiProxy::send(NetQueryPtr query) {
       pos = std::min_element(sessions_.begin(), sessions_.end(),
                              [](const auto &a, const auto &b) { return a.queries_count < b.queries_count; }) -
             sessions_.begin();
+      if (sessions_[pos].queries_count >= SESSION_BUSY_QUERY_COUNT &&
+          static_cast<int32>(sessions_.size()) < get_max_session_count()) {
+        add_session();
+        pos = sessions_.size() - 1;
+      }
     }
   }
   // query->debug(PSTRING() << get_name() << ": send to proxy #" << pos);
   sessions_[pos].queries_count++;
+  sessions_[pos].last_query_at = Time::now_cached();
   send_closure(sessions_[pos].proxy, &SessionProxy::send, std::move(query));
 }
 
@@ -66,13 +75,13 @@ void SessionMultiProxy::update_destroy_auth_key(bool need_destroy_auth_key) {
   send_closure(sessions_[0].proxy, &SessionProxy::update_destroy, need_destroy_auth_key_);
 }
 void SessionMultiProxy::update_session_count(int32 session_count) {
-  update_options(session_count, use_pfs_);
+  update_options(session_count, max_session_count_, use_pfs_);
 }
 void SessionMultiProxy::update_use_pfs(bool use_pfs) {
-  update_options(session_count_, use_pfs);
+  update_options(session_count_, max_session_count_, use_pfs);
 }
 
-void SessionMultiProxy::update_options(int32 session_count, bool use_pfs) {
+void SessionMultiProxy::update_options(int32 session_count, int32 max_session_count, bool use_pfs) {
   bool changed = false;
 
   if (session_count != session_count_) {
@@ -87,6 +96,14 @@ void SessionMultiProxy::update_options(int32 session_count, bool use_pfs) {
     changed = true;
   }
 
+  if (max_session_count != max_session_count_) {
+    max_session_count_ = clamp(max_session_count, 0, 100);
+    LOG(INFO) << "Update " << get_name() << " max_session_count to " << max_session_count_;
+    if (static_cast<int32>(sessions_.size()) > get_max_session_count()) {
+      changed = true;
+    }
+  }
+
   if (use_pfs != use_pfs_) {
     bool old_pfs_flag = get_pfs_flag();
     use_pfs_ = use_pfs;
@@ -114,35 +131,64 @@ bool SessionMultiProxy::get_pfs_flag() const {
   return use_pfs_ && !is_cdn_;
 }
 
+int32 SessionMultiProxy::get_max_session_count() const {
+  return max(session_count_, max_session_count_);
+}
+
 void SessionMultiProxy::init() {
   sessions_generation_++;
   sessions_.clear();
+  cancel_timeout();
   if (is_main_ && session_count_ > 1) {
     LOG(WARNING) << tag("session_count", session_count_);
   }
   for (int32 i = 0; i < session_count_; i++) {
-    string name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
-                            << format::cond(session_count_ > 1, format::concat("#", i));
-
-    SessionInfo info;
-    class Callback : public SessionProxy::Callback {
-     public:
-      Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
-          : parent_(parent), generation_(generation), session_id_(session_id) {
-      }
-      void on_query_finished() override {
-        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
-      }
+    add_session();
+  }
+}
 
-     private:
-      ActorId<SessionMultiProxy> parent_;
-      uint32 generation_;
-      int32 session_id_;
-    };
-    info.proxy = create_actor<SessionProxy>(name, make_unique<Callback>(actor_id(this), sessions_generation_, i),
-                                            auth_data_, is_main_, allow_media_only_, is_media_, get_pfs_flag(), is_cdn_,
-                                            need_destroy_auth_key_ && i == 0);
-    sessions_.push_back(std::move(info));
+void SessionMultiProxy::add_session() {
+  auto session_id = narrow_cast<int32>(sessions_.size());
+  string name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
+                          << format::cond(get_max_session_count() > 1, format::concat("#", session_id));
+  if (session_id >= session_count_) {
+    LOG(INFO) << "Add " << name << ", because all " << session_id << " sessions are busy";
+    if (!has_timeout()) {
+      set_timeout_in(SESSION_IDLE_TIMEOUT);
+    }
+  }
+
+  SessionInfo info;
+  class Callback : public SessionProxy::Callback {
+   public:
+    Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
+        : parent_(parent), generation_(generation), session_id_(session_id) {
+    }
+    void on_query_finished() override {
+      send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
+    }
+
+   private:
+    ActorId<SessionMultiProxy> parent_;
+    uint32 generation_;
+    int32 session_id_;
+  };
+  info.proxy = create_actor<SessionProxy>(name, make_unique<Callback>(actor_id(this), sessions_generation_, session_id),
+                                          auth_data_, is_main_, allow_media_only_, is_media_, get_pfs_flag(), is_cdn_,
+                                          need_destroy_auth_key_ && session_id == 0);
+  info.last_query_at = Time::now_cached();
+  sessions_.push_back(std::move(info));
+}
+
+void SessionMultiProxy::timeout_expired() {
+  auto now = Time::now_cached();
+  while (static_cast<int32>(sessions_.size()) > session_count_ && sessions_.back().queries_count == 0 &&
+         sessions_.back().last_query_at + SESSION_IDLE_TIMEOUT <= now) {
+    LOG(INFO) << "Close idle session #" << sessions_.size() - 1 << " of " << get_name();
+    sessions_.pop_back();
+  }
+  if (static_cast<int32>(sessions_.size()) > session_count_) {
+    set_timeout_at(max(sessions_.back().last_query_at + SESSION_IDLE_TIMEOUT, now + 1.0));
   }
 }
 
@@ -150,8 +196,12 @@ void SessionMultiProxy::on_query_finished(uint32 generation, int session_id) {
   if (generation != sessions_generation_) {
     return;
   }
-  sessions_.at(session_id).queries_count--;
-  CHECK(sessions_.at(session_id).queries_count >= 0);
+  if (static_cast<size_t>(session_id) >= sessions_.size()) {
+    // the session has already been closed
+    return;
+  }
+  sessions_[session_id].queries_count--;
+  CHECK(sessions_[session_id].queries_count >= 0);
 }
 
 }  // namespace td
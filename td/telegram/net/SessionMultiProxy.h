@@ -23,21 +23,27 @@ class SessionMultiProxy : public Actor {
   SessionMultiProxy(const SessionMultiProxy &other) = delete;
   SessionMultiProxy &operator=(const SessionMultiProxy &other) = delete;
   ~SessionMultiProxy() override;
-  SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDataShared> shared_auth_data, bool is_main, bool use_pfs,
-                    bool allow_media_only, bool is_media, bool is_cdn, bool need_destroy_auth_key);
+  SessionMultiProxy(int32 session_count, int32 max_session_count, std::shared_ptr<AuthDataShared> shared_auth_data,
+                    bool is_main, bool use_pfs, bool allow_media_only, bool is_media, bool is_cdn,
+                    bool need_destroy_auth_key);
 
   void send(NetQueryPtr query);
   void update_main_flag(bool is_main);
 
   void update_session_count(int32 session_count);
   void update_use_pfs(bool use_pfs);
-  void update_options(int32 session_count, bool use_pfs);
+  void update_options(int32 session_count, int32 max_session_count, bool use_pfs);
   void update_mtproto_header();
 
   void update_destroy_auth_key(bool need_destroy_auth_key);
 
  private:
+  // sessions are added when all of them are busy, and are closed after being idle for SESSION_IDLE_TIMEOUT
+  static constexpr int32 SESSION_BUSY_QUERY_COUNT = 16;
+  static constexpr double SESSION_IDLE_TIMEOUT = 60.0;
+
   int32 session_count_ = 0;
+  int32 max_session_count_ = 0;
   std::shared_ptr<AuthDataShared> auth_data_;
   bool is_main_ = false;
   bool use_pfs_ = false;
@@ -48,14 +54,19 @@ class SessionMultiProxy : public Actor {
   struct SessionInfo {
     ActorOwn<SessionProxy> proxy;
     int queries_count{0};
+    double last_query_at{0};
   };
   uint32 sessions_generation_{0};
   std::vector<SessionInfo> sessions_;
 
   void start_up() override;
   void init();
+  void add_session();
+
+  void timeout_expired() override;
 
   bool get_pfs_flag() const;
+  int32 get_max_session_count() const;
 
   void on_query_finished(uint32 generation, int session_id);
 };
@@ -26,6 +26,10 @@ const char *td_json_client_receive(void *client, double timeout) {
   return static_cast<td::ClientJson *>(client)->receive(timeout);
 }
 
+int td_json_client_receive_many(void *client, double timeout, const char **responses, int max_count) {
+  return static_cast<td::ClientJson *>(client)->receive_many(timeout, responses, max_count);
+}
+
 const char *td_json_client_execute(void *client, const char *request) {
   return td::ClientJson::execute(td::Slice(request == nullptr ? "" : request));
 }
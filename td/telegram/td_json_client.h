@@ -69,19 +69,33 @@ TDJSON_EXPORT void td_json_client_send(void *client, const char *request);
 /**
  * Receives incoming updates and request responses from the TDLib client. May be called from any thread, but
  * must not be called simultaneously from two different threads.
- * Returned pointer will be deallocated by TDLib during next call to td_json_client_receive or td_json_client_execute
- * in the same thread, so it can't be used after that.
+ * Returned pointer will be deallocated by TDLib during next call to td_json_client_receive,
+ * td_json_client_receive_many or td_json_client_execute in the same thread, so it can't be used after that.
  * \param[in] client The client.
  * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
  * \return JSON-serialized null-terminated incoming update or request response. May be NULL if the timeout expires.
  */
 TDJSON_EXPORT const char *td_json_client_receive(void *client, double timeout);
 
+/**
+ * Receives up to max_count incoming updates and request responses from the TDLib client at once. Waits only for
+ * the first response. May be called from any thread, but must not be called simultaneously from two different threads.
+ * Returned pointers will be deallocated by TDLib during next call to td_json_client_receive,
+ * td_json_client_receive_many or td_json_client_execute in the same thread, so they can't be used after that.
+ * \param[in] client The client.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \param[out] responses Array of at least max_count elements, which receives JSON-serialized null-terminated incoming
+ *                       updates and request responses.
+ * \param[in] max_count The maximum number of responses to receive.
+ * \return The number of received responses. May be 0 if the timeout expires.
+ */
+TDJSON_EXPORT int td_json_client_receive_many(void *client, double timeout, const char **responses, int max_count);
+
 /**
  * Synchronously executes TDLib request. May be called from any thread.
  * Only a few requests can be executed synchronously.
- * Returned pointer will be deallocated by TDLib during next call to td_json_client_receive or td_json_client_execute
- * in the same thread, so it can't be used after that.
+ * Returned pointer will be deallocated by TDLib during next call to td_json_client_receive,
+ * td_json_client_receive_many or td_json_client_execute in the same thread, so it can't be used after that.
  * \param[in] client The client. Currently ignored for all requests, so NULL can be passed.
  * \param[in] request JSON-serialized null-terminated request to TDLib.
  * \return JSON-serialized null-terminated request response.
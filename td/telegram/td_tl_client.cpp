@@ -0,0 +1,36 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/td_tl_client.h"
+
+#include "td/telegram/ClientTl.h"
+
+#include "td/utils/Slice.h"
+
+static const void *to_response(td::Slice response, size_t *response_size) {
+  if (response_size != nullptr) {
+    *response_size = response.size();
+  }
+  return response.empty() ? nullptr : response.data();
+}
+
+int td_tl_create_client_id() {
+  return td::tl_create_client_id();
+}
+
+void td_tl_send(int client_id, const void *request, size_t request_size) {
+  td::tl_send(client_id, td::Slice(static_cast<const char *>(request), request == nullptr ? 0 : request_size));
+}
+
+const void *td_tl_receive(double timeout, size_t *response_size) {
+  return to_response(td::tl_receive(timeout), response_size);
+}
+
+const void *td_tl_execute(const void *request, size_t request_size, size_t *response_size) {
+  return to_response(
+      td::tl_execute(td::Slice(static_cast<const char *>(request), request == nullptr ? 0 : request_size)),
+      response_size);
+}
@@ -0,0 +1,81 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+/**
+ * \file
+ * C interface for interaction with TDLib via TL-serialized objects.
+ * Can be used to integrate TDLib with any programming language which supports calling C functions, without the
+ * overhead of JSON serialization.
+ *
+ * TDLib API objects are serialized in the binary TL format with the TDLib API scheme td_api.tl, which is available
+ * in the directory td/generate/scheme. All constructors are boxed, i.e. prefixed with their 32-bit identifier.
+ * Fields of Bool type are stored as boolTrue or boolFalse constructor identifiers, fields of int32 type are stored
+ * as 4 bytes, fields of int53 and int64 types are stored as 8 bytes, fields of double type are stored as 8 bytes
+ * in IEEE 754 format, fields of string and bytes types and vectors are stored as in the MTProto protocol.
+ * All numbers are stored in little-endian byte order. Absent optional objects are stored as the null constructor
+ * with identifier 0x56730bcc.
+ *
+ * A request consists of an 8-byte non-zero request identifier and the serialized TDLib function.
+ * A response consists of a 4-byte identifier of the TDLib client for which the response is received,
+ * an 8-byte identifier of the request, to which the response corresponds, or 0 for incoming updates, and
+ * the serialized TDLib object.
+ * Request buffers must be aligned to at least 4 bytes. Returned response buffers are aligned to at least 4 bytes.
+ *
+ * The interface is similar to the new TDLib JSON interface, but TDLib instances created through td_tl_create_client_id
+ * can be used only with td_tl_send and td_tl_receive.
+ */
+
+#include "td/telegram/tdjson_export.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Returns an opaque identifier of a new TDLib instance.
+ * The TDLib instance will not send updates until the first request is sent to it.
+ * \return Opaque indentifier of a new TDLib instance.
+ */
+TDJSON_EXPORT int td_tl_create_client_id();
+
+/**
+ * Sends request to the TDLib client. May be called from any thread.
+ * \param[in] client_id The TDLib client identifier.
+ * \param[in] request TL-serialized request to TDLib prefixed with the request identifier.
+ * \param[in] request_size Size of the request in bytes.
+ */
+TDJSON_EXPORT void td_tl_send(int client_id, const void *request, size_t request_size);
+
+/**
+ * Receives incoming updates and request responses. Must not be called simultaneously from two different threads.
+ * Returned pointer will be deallocated by TDLib during next call to td_tl_receive or td_tl_execute
+ * in the same thread, so it can't be used after that.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \param[out] response_size Size of the returned response in bytes.
+ * \return TL-serialized incoming update or request response prefixed with the client and request identifiers.
+ *         May be NULL if the timeout expires.
+ */
+TDJSON_EXPORT const void *td_tl_receive(double timeout, size_t *response_size);
+
+/**
+ * Synchronously executes TDLib request. May be called from any thread.
+ * Only a few requests can be executed synchronously.
+ * Returned pointer will be deallocated by TDLib during next call to td_tl_receive or td_tl_execute
+ * in the same thread, so it can't be used after that.
+ * \param[in] request TL-serialized request to TDLib prefixed with the request identifier.
+ * \param[in] request_size Size of the request in bytes.
+ * \param[out] response_size Size of the returned response in bytes.
+ * \return TL-serialized request response prefixed with zero client identifier and the request identifier.
+ */
+TDJSON_EXPORT const void *td_tl_execute(const void *request, size_t request_size, size_t *response_size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,111 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/tl/TlArena.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread_local.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace td {
+
+namespace {
+
+struct alignas(std::max_align_t) Chunk {
+  std::atomic<size_t> ref_cnt{1};
+};
+
+// every allocation is prefixed with a header, containing its chunk, or nullptr if it was allocated separately
+struct alignas(std::max_align_t) AllocationHeader {
+  Chunk *chunk;
+};
+
+constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+constexpr size_t MIN_CHUNK_SIZE = 1 << 12;
+constexpr size_t MAX_CHUNK_SIZE = 1 << 16;
+
+}  // namespace
+
+static TD_THREAD_LOCAL Chunk *current_chunk;
+static TD_THREAD_LOCAL char *current_chunk_begin;
+static TD_THREAD_LOCAL char *current_chunk_end;
+static TD_THREAD_LOCAL size_t next_chunk_size;
+static TD_THREAD_LOCAL int32 guard_count;
+
+static void *allocate_memory(size_t size) {
+  auto result = std::malloc(size);
+  LOG_IF(FATAL, result == nullptr) << "Failed to allocate " << size << " bytes";
+  return result;
+}
+
+static void release_chunk(Chunk *chunk) {
+  if (chunk->ref_cnt.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    chunk->~Chunk();
+    std::free(chunk);
+  }
+}
+
+TlArena::Guard::Guard() {
+  guard_count++;
+}
+
+TlArena::Guard::~Guard() {
+  CHECK(guard_count > 0);
+  if (--guard_count == 0 && current_chunk != nullptr) {
+    // the chunk will be freed after all objects in it are destroyed
+    release_chunk(current_chunk);
+    current_chunk = nullptr;
+    current_chunk_begin = nullptr;
+    current_chunk_end = nullptr;
+    next_chunk_size = 0;
+  }
+}
+
+void *TlArena::allocate(size_t size) {
+  size_t full_size = sizeof(AllocationHeader) + (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  if (guard_count == 0 || full_size > MAX_CHUNK_SIZE / 8) {
+    auto header = static_cast<AllocationHeader *>(allocate_memory(full_size));
+    header->chunk = nullptr;
+    return header + 1;
+  }
+
+  if (current_chunk == nullptr || static_cast<size_t>(current_chunk_end - current_chunk_begin) < full_size) {
+    if (current_chunk != nullptr) {
+      release_chunk(current_chunk);
+    }
+    // the first chunks are small, because most responses are small
+    auto chunk_size = next_chunk_size == 0 ? MIN_CHUNK_SIZE : next_chunk_size;
+    next_chunk_size = td::min(chunk_size * 2, MAX_CHUNK_SIZE);
+
+    current_chunk = new (allocate_memory(sizeof(Chunk) + chunk_size)) Chunk();
+    current_chunk_begin = reinterpret_cast<char *>(current_chunk + 1);
+    current_chunk_end = current_chunk_begin + chunk_size;
+  }
+
+  current_chunk->ref_cnt.fetch_add(1, std::memory_order_relaxed);
+  auto header = reinterpret_cast<AllocationHeader *>(current_chunk_begin);
+  current_chunk_begin += full_size;
+  header->chunk = current_chunk;
+  return header + 1;
+}
+
+void TlArena::deallocate(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto header = static_cast<AllocationHeader *>(ptr) - 1;
+  if (header->chunk == nullptr) {
+    std::free(header);
+  } else {
+    release_chunk(header->chunk);
+  }
+}
+
+}  // namespace td
@@ -0,0 +1,34 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <cstddef>
+
+namespace td {
+
+// allocator for TL objects, which places all objects created by a thread while a TlArena::Guard is alive
+// sequentially in big chunks of memory instead of allocating each of them separately
+// the objects can be destroyed from any thread and in any order; a chunk is freed after all its objects are destroyed,
+// so an object, which is kept for a long time, keeps alive the whole chunk
+class TlArena {
+ public:
+  class Guard {
+   public:
+    Guard();
+    Guard(const Guard &other) = delete;
+    Guard &operator=(const Guard &other) = delete;
+    Guard(Guard &&other) = delete;
+    Guard &operator=(Guard &&other) = delete;
+    ~Guard();
+  };
+
+  static void *allocate(std::size_t size);
+
+  static void deallocate(void *ptr);
+};
+
+}  // namespace td
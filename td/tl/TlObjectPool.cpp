@@ -0,0 +1,105 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/tl/TlObjectPool.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread_local.h"
+
+#include <cstdlib>
+
+namespace td {
+
+// objects can be destroyed in destructors of other thread local variables after the free lists are destroyed
+static TD_THREAD_LOCAL bool are_free_lists_destroyed;
+
+namespace {
+
+constexpr size_t SIZE_CLASS_STEP = 16;
+constexpr size_t MAX_POOLED_SIZE = 256;
+constexpr size_t SIZE_CLASS_COUNT = MAX_POOLED_SIZE / SIZE_CLASS_STEP;
+constexpr size_t MAX_FREE_OBJECT_COUNT = 256;
+
+struct FreeObject {
+  FreeObject *next;
+};
+
+struct FreeLists {
+  FreeObject *heads[SIZE_CLASS_COUNT] = {};
+  size_t sizes[SIZE_CLASS_COUNT] = {};
+
+  FreeLists() = default;
+  FreeLists(const FreeLists &other) = delete;
+  FreeLists &operator=(const FreeLists &other) = delete;
+  FreeLists(FreeLists &&other) = delete;
+  FreeLists &operator=(FreeLists &&other) = delete;
+  ~FreeLists() {
+    are_free_lists_destroyed = true;
+    for (auto head : heads) {
+      while (head != nullptr) {
+        auto next = head->next;
+        std::free(head);
+        head = next;
+      }
+    }
+  }
+};
+
+}  // namespace
+
+// thread_local is used instead of init_thread_local to free the cached objects also on exit of non-TDLib threads
+static FreeLists *get_free_lists() {
+  if (are_free_lists_destroyed) {
+    return nullptr;
+  }
+  static thread_local FreeLists free_lists;
+  return &free_lists;
+}
+
+static size_t get_size_class(size_t size) {
+  return (size - 1) / SIZE_CLASS_STEP;
+}
+
+void *TlObjectPool::allocate(size_t size) {
+  auto free_lists = size != 0 && size <= MAX_POOLED_SIZE ? get_free_lists() : nullptr;
+  if (free_lists != nullptr) {
+    auto size_class = get_size_class(size);
+    auto &head = free_lists->heads[size_class];
+    if (head != nullptr) {
+      auto result = head;
+      head = result->next;
+      free_lists->sizes[size_class]--;
+      return result;
+    }
+    // allocate the whole size class to be able to reuse the memory for any object of the class
+    size = (size_class + 1) * SIZE_CLASS_STEP;
+  }
+
+  auto result = std::malloc(size);
+  LOG_IF(FATAL, result == nullptr) << "Failed to allocate " << size << " bytes";
+  return result;
+}
+
+void TlObjectPool::deallocate(void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto free_lists = size != 0 && size <= MAX_POOLED_SIZE ? get_free_lists() : nullptr;
+  if (free_lists != nullptr) {
+    auto size_class = get_size_class(size);
+    if (free_lists->sizes[size_class] < MAX_FREE_OBJECT_COUNT) {
+      auto object = static_cast<FreeObject *>(ptr);
+      object->next = free_lists->heads[size_class];
+      free_lists->heads[size_class] = object;
+      free_lists->sizes[size_class]++;
+      return;
+    }
+  }
+  std::free(ptr);
+}
+
+}  // namespace td
@@ -0,0 +1,23 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <cstddef>
+
+namespace td {
+
+// allocator for small TL objects, which keeps a limited number of freed objects of every size in per-thread lists
+// and reuses them for new objects of the same size instead of returning them to the system allocator
+// the objects can be destroyed from any thread; a destroyed object is cached by the thread, which has destroyed it
+class TlObjectPool {
+ public:
+  static void *allocate(std::size_t size);
+
+  static void deallocate(void *ptr, std::size_t size);
+};
+
+}  // namespace td
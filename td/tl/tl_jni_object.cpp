@@ -24,6 +24,8 @@ static jclass LongClass;
 static jclass DoubleClass;
 static jclass StringClass;
 static jclass ObjectClass;
+static jstring EmptyString;
+static jbyteArray EmptyByteArray;
 jclass ArrayKeyboardButtonClass;
 jclass ArrayInlineKeyboardButtonClass;
 jclass ArrayPageBlockTableCellClass;
@@ -70,6 +72,22 @@ jfieldID get_field_id(JNIEnv *env, jclass clazz, const char *name, const char *s
   return res;
 }
 
+template <class T>
+static T get_global_ref(JNIEnv *env, T object, const char *description) {
+  if (!object) {
+    fatal_error(env, PSLICE() << "Can't create " << description);
+  }
+  T object_global = (T)env->NewGlobalRef(object);
+
+  env->DeleteLocalRef(object);
+
+  if (!object_global) {
+    fatal_error(env, PSLICE() << "Can't create global reference to " << description);
+  }
+
+  return object_global;
+}
+
 void register_native_method(JNIEnv *env, jclass clazz, std::string name, std::string signature, void *function_ptr) {
   JNINativeMethod native_method{&name[0], &signature[0], function_ptr};
   if (env->RegisterNatives(clazz, &native_method, 1) != 0) {
@@ -109,6 +127,8 @@ void init_vars(JNIEnv *env, const char *td_api_java_package) {
       get_jclass(env, (PSLICE() << "[L" << td_api_java_package << "/TdApi$InlineKeyboardButton;").c_str());
   ArrayPageBlockTableCellClass =
       get_jclass(env, (PSLICE() << "[L" << td_api_java_package << "/TdApi$PageBlockTableCell;").c_str());
+  EmptyString = get_global_ref(env, env->NewStringUTF(""), "empty string");
+  EmptyByteArray = get_global_ref(env, env->NewByteArray(0), "empty byte array");
   GetConstructorID = get_method_id(env, ObjectClass, "getConstructor", "()I");
   BooleanGetValueMethodID = get_method_id(env, BooleanClass, "booleanValue", "()Z");
   IntegerGetValueMethodID = get_method_id(env, IntegerClass, "intValue", "()I");
@@ -270,6 +290,31 @@ jbyteArray to_bytes(JNIEnv *env, const std::string &b) {
   return arr;
 }
 
+// strings and empty arrays are immutable, so the same empty object can be shared by all fields
+void set_string_field(JNIEnv *env, jobject o, jfieldID id, const std::string &s) {
+  if (s.empty()) {
+    env->SetObjectField(o, id, EmptyString);
+    return;
+  }
+  jstring str = to_jstring(env, s);
+  if (str) {
+    env->SetObjectField(o, id, str);
+    env->DeleteLocalRef(str);
+  }
+}
+
+void set_bytes_field(JNIEnv *env, jobject o, jfieldID id, const std::string &b) {
+  if (b.empty()) {
+    env->SetObjectField(o, id, EmptyByteArray);
+    return;
+  }
+  jbyteArray arr = to_bytes(env, b);
+  if (arr) {
+    env->SetObjectField(o, id, arr);
+    env->DeleteLocalRef(arr);
+  }
+}
+
 jintArray store_vector(JNIEnv *env, const std::vector<std::int32_t> &v) {
   static_assert(sizeof(std::int32_t) == sizeof(jint), "Mismatched jint size");
   jsize length = narrow_cast<jsize>(v.size());
@@ -305,6 +350,10 @@ jobjectArray store_vector(JNIEnv *env, const std::vector<std::string> &v) {
   jobjectArray arr = env->NewObjectArray(length, StringClass, 0);
   if (arr != nullptr) {
     for (jsize i = 0; i < length; i++) {
+      if (v[i].empty()) {
+        env->SetObjectArrayElement(arr, i, EmptyString);
+        continue;
+      }
       jstring str = to_jstring(env, v[i]);
       if (str) {
         env->SetObjectArrayElement(arr, i, str);
@@ -95,6 +95,10 @@ std::string from_bytes(JNIEnv *env, jbyteArray arr);
 
 jbyteArray to_bytes(JNIEnv *env, const std::string &b);
 
+void set_string_field(JNIEnv *env, jobject o, jfieldID id, const std::string &s);
+
+void set_bytes_field(JNIEnv *env, jobject o, jfieldID id, const std::string &b);
+
 void init_vars(JNIEnv *env, const char *td_api_java_package);
 
 jintArray store_vector(JNIEnv *env, const std::vector<std::int32_t> &v);
@@ -179,7 +179,7 @@ std::enable_if_t<!std::is_constructible<T>::value, Status> from_json(tl_object_p
   if (constructor_value.type() == JsonValue::Type::Number) {
     constructor = to_integer<int32>(constructor_value.get_number());
   } else if (constructor_value.type() == JsonValue::Type::String) {
-    TRY_RESULT_ASSIGN(constructor, tl_constructor_from_string(to.get(), constructor_value.get_string().str()));
+    TRY_RESULT_ASSIGN(constructor, tl_constructor_from_string(to.get(), constructor_value.get_string()));
   } else {
     return Status::Error(PSLICE() << "Expected String or Integer, got " << constructor_value.type());
   }
@@ -132,6 +132,49 @@ class TlFetchVector {
   }
 };
 
+// vectors of numbers are fetched with a single bounds check and copied at once
+template <class T>
+class TlFetchPrimitiveVector {
+ public:
+  template <class ParserT>
+  static std::vector<T> parse(ParserT &parser) {
+    const std::uint32_t multiplicity = parser.fetch_int();
+    std::vector<T> v;
+    if (parser.get_left_len() / sizeof(T) < multiplicity) {
+      parser.set_error("Wrong vector length");
+    } else if (multiplicity != 0) {
+      v.resize(multiplicity);
+      parser.fetch_array(&v[0], multiplicity);
+    }
+    return v;
+  }
+};
+
+template <>
+class TlFetchVector<TlFetchInt> : public TlFetchPrimitiveVector<std::int32_t> {};
+
+template <>
+class TlFetchVector<TlFetchLong> : public TlFetchPrimitiveVector<std::int64_t> {};
+
+template <>
+class TlFetchVector<TlFetchDouble> : public TlFetchPrimitiveVector<double> {};
+
+// fetches an optional object, which is stored as null#56730bcc if it is absent
+template <class Func>
+class TlFetchNullable {
+ public:
+  template <class ParserT>
+  static auto parse(ParserT &parser) -> decltype(Func::parse(parser)) {
+    constexpr std::int32_t ID_NULL = 0x56730bcc;
+
+    if (parser.can_prefetch_int() && parser.prefetch_int_unsafe() == ID_NULL) {
+      parser.fetch_int();
+      return decltype(Func::parse(parser))();
+    }
+    return Func::parse(parser);
+  }
+};
+
 template <class T>
 class TlFetchObject {
  public:
@@ -36,6 +36,22 @@ class TlStoreBoxedUnknown {
   }
 };
 
+// stores an optional object as null#56730bcc if it is absent
+template <class Func>
+class TlStoreNullable {
+ public:
+  template <class T, class StorerT>
+  static void store(const T &x, StorerT &storer) {
+    constexpr std::int32_t ID_NULL = 0x56730bcc;
+
+    if (x == nullptr) {
+      storer.store_binary(ID_NULL);
+    } else {
+      Func::store(x, storer);
+    }
+  }
+};
+
 class TlStoreBool {
  public:
   template <class StorerT>
@@ -0,0 +1,130 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/ActorStats.h"
+
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/Time.h"
+
+#include <algorithm>
+
+namespace td {
+
+std::atomic<bool> ActorStats::is_enabled_{false};
+
+namespace {
+struct Registry {
+  std::mutex mutex;
+  vector<std::shared_ptr<ActorStats>> stats;
+  std::unordered_map<string, ActorStats::Stat> retired_stats;
+};
+
+Registry &get_registry() {
+  static Registry registry;
+  return registry;
+}
+
+std::atomic<double> log_period{0.0};
+std::atomic<double> next_log_time{0.0};
+}  // namespace
+
+std::shared_ptr<ActorStats> ActorStats::create() {
+  auto result = std::make_shared<ActorStats>();
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.stats.push_back(result);
+  return result;
+}
+
+void ActorStats::retire(std::shared_ptr<ActorStats> stats) {
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = std::find(registry.stats.begin(), registry.stats.end(), stats);
+  CHECK(it != registry.stats.end());
+  registry.stats.erase(it);
+  stats->merge_to(registry.retired_stats);
+}
+
+void ActorStats::merge_to(std::unordered_map<string, Stat> &merged) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &it : stats_) {
+    auto &stat = merged[it.first];
+    stat.event_count += it.second.event_count;
+    stat.total_time += it.second.total_time;
+    stat.max_event_time = td::max(stat.max_event_time, it.second.max_event_time);
+    stat.max_mailbox_size = td::max(stat.max_mailbox_size, it.second.max_mailbox_size);
+    stat.coalesced_wakeup_count += it.second.coalesced_wakeup_count;
+    stat.counters += it.second.counters;
+  }
+}
+
+void ActorStats::set_enabled(bool is_enabled, double new_log_period) {
+  log_period.store(is_enabled ? td::max(new_log_period, 0.0) : 0.0, std::memory_order_relaxed);
+  next_log_time.store(Time::now() + new_log_period, std::memory_order_relaxed);
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+vector<ActorStats::Stat> ActorStats::get_all(bool reset) {
+  std::unordered_map<string, Stat> merged;
+  {
+    auto &registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    merged = registry.retired_stats;
+    for (auto &stats : registry.stats) {
+      stats->merge_to(merged);
+      if (reset) {
+        std::lock_guard<std::mutex> stats_lock(stats->mutex_);
+        stats->stats_.clear();
+      }
+    }
+    if (reset) {
+      registry.retired_stats.clear();
+    }
+  }
+
+  vector<Stat> result;
+  result.reserve(merged.size());
+  for (auto &it : merged) {
+    it.second.name = it.first;
+    result.push_back(std::move(it.second));
+  }
+  std::sort(result.begin(), result.end(), [](const Stat &lhs, const Stat &rhs) { return lhs.total_time > rhs.total_time; });
+  return result;
+}
+
+void ActorStats::try_log() {
+  auto period = log_period.load(std::memory_order_relaxed);
+  if (period <= 0) {
+    return;
+  }
+  auto now = Time::now();
+  auto log_time = next_log_time.load(std::memory_order_relaxed);
+  if (now < log_time || !next_log_time.compare_exchange_strong(log_time, now + period)) {
+    return;
+  }
+
+  constexpr size_t MAX_LOGGED_ACTORS = 20;
+  auto stats = get_all(false);
+  if (stats.size() > MAX_LOGGED_ACTORS) {
+    stats.resize(MAX_LOGGED_ACTORS);
+  }
+  LOG(WARNING) << "Actor statistics: " << format::as_array(stats);
+}
+
+StringBuilder &operator<<(StringBuilder &sb, const ActorStats::Stat &stat) {
+  sb << '[' << stat.name << ": events " << stat.event_count << ", total " << format::as_time(stat.total_time)
+     << ", max " << format::as_time(stat.max_event_time) << ", max mailbox " << stat.max_mailbox_size;
+  if (stat.coalesced_wakeup_count != 0) {
+    sb << ", coalesced wakeups " << stat.coalesced_wakeup_count;
+  }
+  if (!stat.counters.empty()) {
+    sb << ", counters " << stat.counters;
+  }
+  return sb << ']';
+}
+
+}  // namespace td
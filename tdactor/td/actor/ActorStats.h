@@ -0,0 +1,89 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/PerfCounters.h"
+#include "td/utils/Slice.h"
+#include "td/utils/StringBuilder.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace td {
+
+// Statistics about events processed by actors, aggregated by actor name.
+// Every scheduler has its own ActorStats, which is updated only by the scheduler's thread while statistics
+// collection is enabled, so the mutex is almost never contended.
+class ActorStats {
+ public:
+  struct Stat {
+    string name;
+    uint64 event_count = 0;
+    double total_time = 0;
+    double max_event_time = 0;
+    size_t max_mailbox_size = 0;
+    uint64 coalesced_wakeup_count = 0;  // number of dropped wakeups, which were already pending
+    PerfCounters::Values counters;  // non-zero only while PerfCounters are enabled
+  };
+
+  static std::shared_ptr<ActorStats> create();
+
+  // keeps statistics of a destroyed scheduler
+  static void retire(std::shared_ptr<ActorStats> stats);
+
+  static void set_enabled(bool is_enabled, double log_period = 0.0);
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // returns statistics merged from all schedulers and sorted by total time
+  static vector<Stat> get_all(bool reset);
+
+  void on_event(Slice actor_name, double event_time, const PerfCounters::Values &counters = {}) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto &stat = stats_[actor_name.str()];
+      stat.event_count++;
+      stat.total_time += event_time;
+      stat.counters += counters;
+      if (event_time > stat.max_event_time) {
+        stat.max_event_time = event_time;
+      }
+    }
+    try_log();
+  }
+
+  void on_coalesced_wakeup(Slice actor_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[actor_name.str()].coalesced_wakeup_count++;
+  }
+
+  void on_mailbox_size(Slice actor_name, size_t mailbox_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &stat = stats_[actor_name.str()];
+    if (mailbox_size > stat.max_mailbox_size) {
+      stat.max_mailbox_size = mailbox_size;
+    }
+  }
+
+ private:
+  static std::atomic<bool> is_enabled_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<string, Stat> stats_;
+
+  static void try_log();
+
+  void merge_to(std::unordered_map<string, Stat> &merged) const;
+};
+
+StringBuilder &operator<<(StringBuilder &sb, const ActorStats::Stat &stat);
+
+}  // namespace td
@@ -0,0 +1,265 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+#include "td/utils/config.h"
+#include "td/utils/logging.h"
+#include "td/utils/Status.h"
+
+#if TD_HAVE_COROUTINES
+
+#include <coroutine>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace td {
+
+// Task<T> is a lazily started C++20 coroutine, which runs on behalf of an actor.
+// It can co_await other tasks and results of asynchronous requests; co_await returns Result<T>.
+// Execution is always resumed on the scheduler of the actor, so the coroutine can access the actor's state.
+// If the actor is destroyed before the result is received, the whole coroutine chain is destroyed without resuming.
+//
+// Usage:
+//   Task<int32> MyActor::get_sum() {
+//     auto r_a = co_await ask(other_actor_, &OtherActor::get_value, 1);  // get_value(int32, Promise<int32>)
+//     if (r_a.is_error()) {
+//       co_return r_a.move_as_error();
+//     }
+//     co_return r_a.ok() + 1;
+//   }
+//
+//   get_sum().start(actor_id(this), std::move(promise));
+template <class T = Unit>
+class Task;
+
+namespace detail {
+
+class TaskPromiseBase {
+ public:
+  struct FinalAwaiter {
+    bool await_ready() noexcept {
+      return false;
+    }
+    template <class PromiseT>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> handle) noexcept {
+      return handle.promise().on_finish(handle);
+    }
+    void await_resume() noexcept {
+    }
+  };
+
+  std::suspend_always initial_suspend() noexcept {
+    return {};
+  }
+  FinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+  void unhandled_exception() {
+    LOG(FATAL) << "Unhandled exception in a coroutine";
+  }
+
+  ActorId<> actor_id_;
+  std::coroutine_handle<> root_;          // the outermost coroutine, which owns all the others
+  std::coroutine_handle<> continuation_;  // the awaiting coroutine, if any
+};
+
+template <class T>
+class TaskPromise final : public TaskPromiseBase {
+ public:
+  Task<T> get_return_object() noexcept;
+
+  void return_value(Result<T> &&result) {
+    result_ = std::move(result);
+  }
+
+  template <class PromiseT>
+  std::coroutine_handle<> on_finish(std::coroutine_handle<PromiseT> handle) noexcept {
+    if (continuation_) {
+      return continuation_;
+    }
+
+    // the task was started from an actor and nobody owns it
+    auto promise = std::move(promise_);
+    auto result = std::move(result_);
+    handle.destroy();
+    promise.set_result(std::move(result));
+    return std::noop_coroutine();
+  }
+
+  Result<T> result_;
+  Promise<T> promise_;
+};
+
+// resumes the coroutine on its actor's scheduler or destroys the whole coroutine chain, if the actor is gone
+class CoroutineResumer {
+ public:
+  CoroutineResumer(std::coroutine_handle<> handle, std::coroutine_handle<> root) : handle_(handle), root_(root) {
+  }
+  CoroutineResumer(const CoroutineResumer &) = delete;
+  CoroutineResumer &operator=(const CoroutineResumer &) = delete;
+  CoroutineResumer(CoroutineResumer &&other) noexcept
+      : handle_(std::exchange(other.handle_, {})), root_(std::exchange(other.root_, {})) {
+  }
+  CoroutineResumer &operator=(CoroutineResumer &&) = delete;
+  ~CoroutineResumer() {
+    if (root_) {
+      root_.destroy();
+    }
+  }
+
+  void resume() {
+    root_ = {};
+    std::exchange(handle_, {}).resume();
+  }
+
+ private:
+  std::coroutine_handle<> handle_;
+  std::coroutine_handle<> root_;
+};
+
+template <class T, class StartT>
+class PromiseAwaiter {
+ public:
+  explicit PromiseAwaiter(StartT start) : start_(std::move(start)) {
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  template <class PromiseT>
+  void await_suspend(std::coroutine_handle<PromiseT> handle) {
+    auto &promise = handle.promise();
+    CHECK(!promise.actor_id_.empty());
+    start_(PromiseCreator::lambda([this, actor_id = promise.actor_id_,
+                                   resumer = CoroutineResumer(handle, promise.root_)](Result<T> result) mutable {
+      result_ = std::move(result);
+      send_lambda(actor_id, [resumer = std::move(resumer)]() mutable { resumer.resume(); });
+    }));
+  }
+
+  Result<T> await_resume() {
+    return std::move(result_);
+  }
+
+ private:
+  StartT start_;
+  Result<T> result_;
+};
+
+template <class PromiseT>
+struct PromiseValue;
+
+template <class T>
+struct PromiseValue<Promise<T>> {
+  using type = T;
+};
+
+template <class FunctionT>
+struct AskTraits;
+
+template <class ActorT, class... ArgsT>
+struct AskTraits<void (ActorT::*)(ArgsT...)> {
+  using PromiseT = std::decay_t<std::tuple_element_t<sizeof...(ArgsT) - 1, std::tuple<ArgsT...>>>;
+  using type = typename PromiseValue<PromiseT>::type;
+};
+
+}  // namespace detail
+
+template <class T>
+class Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {
+  }
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  ~Task() {
+    destroy();
+  }
+
+  // starts the task on behalf of the actor; must be called from the actor
+  template <class ActorT>
+  void start(ActorId<ActorT> actor_id, Promise<T> promise = Promise<T>()) && {
+    CHECK(handle_);
+    auto handle = std::exchange(handle_, {});
+    auto &task_promise = handle.promise();
+    task_promise.actor_id_ = static_cast<ActorId<>>(actor_id);
+    task_promise.root_ = handle;
+    task_promise.promise_ = std::move(promise);
+    handle.resume();
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  template <class PromiseT>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> continuation) noexcept {
+    auto &task_promise = handle_.promise();
+    task_promise.actor_id_ = continuation.promise().actor_id_;
+    task_promise.root_ = continuation.promise().root_;
+    task_promise.continuation_ = continuation;
+    return handle_;
+  }
+
+  Result<T> await_resume() {
+    return std::move(handle_.promise().result_);
+  }
+
+ private:
+  friend class detail::TaskPromise<T>;
+
+  std::coroutine_handle<promise_type> handle_;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {
+  }
+
+  void destroy() {
+    if (handle_) {
+      std::exchange(handle_, {}).destroy();
+    }
+  }
+};
+
+template <class T>
+Task<T> detail::TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+// co_await make_awaitable<T>(start) calls start(Promise<T>) and waits for the promise to be set
+template <class T, class StartT>
+auto make_awaitable(StartT &&start) {
+  return detail::PromiseAwaiter<T, std::decay_t<StartT>>(std::forward<StartT>(start));
+}
+
+// co_await ask(actor_id, &ActorT::func, args...) calls func(args..., Promise<T>) and waits for the promise to be set
+template <class ActorIdT, class FunctionT, class... ArgsT>
+auto ask(ActorIdT &&actor_id, FunctionT function, ArgsT &&... args) {
+  using T = typename detail::AskTraits<FunctionT>::type;
+  return make_awaitable<T>([actor_id = std::forward<ActorIdT>(actor_id), function,
+                            ... args = std::forward<ArgsT>(args)](Promise<T> &&promise) mutable {
+    send_closure(std::move(actor_id), function, std::move(args)..., std::move(promise));
+  });
+}
+
+}  // namespace td
+
+#endif
@@ -13,6 +13,7 @@
 #include "td/utils/common.h"
 #include "td/utils/invoke.h"  // for tuple_for_each
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/SmallObjectCache.h"
 #include "td/utils/Status.h"
 
 #include <tuple>
@@ -30,6 +31,15 @@ class PromiseInterface {
   PromiseInterface(PromiseInterface &&) = default;
   PromiseInterface &operator=(PromiseInterface &&) = default;
   virtual ~PromiseInterface() = default;
+
+  // a promise is created for almost every query and destroyed right after the query is answered
+  static void *operator new(size_t size) {
+    return allocate_small_object(size);
+  }
+  static void operator delete(void *ptr, size_t size) {
+    free_small_object(ptr, size);
+  }
+
   virtual void set_value(T &&value) {
     set_result(std::move(value));
   }
@@ -274,7 +284,7 @@ class LambdaPromise : public PromiseInterface<ValueT> {
   LambdaPromise(LambdaPromise &&other) = delete;
   LambdaPromise &operator=(LambdaPromise &&other) = delete;
   ~LambdaPromise() override {
-    do_error(Status::Error("Lost promise"));
+    do_error(STATIC_ERROR(0, "Lost promise"));
   }
 
   template <class FromOkT, class FromFailT>
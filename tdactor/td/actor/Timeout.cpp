@@ -18,35 +18,33 @@ bool MultiTimeout::has_timeout(int64 key) const {
 void MultiTimeout::set_timeout_at(int64 key, double timeout) {
   LOG(DEBUG) << "Set " << get_name() << " for " << key << " in " << timeout - Time::now();
   auto item = items_.emplace(key);
-  auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item.first));
-  if (heap_node->in_heap()) {
+  auto timer_wheel_node = static_cast<TimerWheelNode *>(const_cast<Item *>(&*item.first));
+  if (timer_wheel_node->in_timer_wheel()) {
     CHECK(!item.second);
-    bool need_update_timeout = heap_node->is_top();
-    timeout_queue_.fix(timeout, heap_node);
-    if (need_update_timeout || heap_node->is_top()) {
-      update_timeout();
-    }
+    timeout_queue_.fix(timeout, timer_wheel_node);
   } else {
     CHECK(item.second);
-    timeout_queue_.insert(timeout, heap_node);
-    if (heap_node->is_top()) {
-      update_timeout();
+    if (timeout_queue_.empty()) {
+      timeout_queue_.set_now(Time::now_cached());
     }
+    timeout_queue_.insert(timeout, timer_wheel_node);
   }
+  update_timeout();
 }
 
 void MultiTimeout::add_timeout_at(int64 key, double timeout) {
   LOG(DEBUG) << "Add " << get_name() << " for " << key << " in " << timeout - Time::now();
   auto item = items_.emplace(key);
-  auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item.first));
-  if (heap_node->in_heap()) {
+  auto timer_wheel_node = static_cast<TimerWheelNode *>(const_cast<Item *>(&*item.first));
+  if (timer_wheel_node->in_timer_wheel()) {
     CHECK(!item.second);
   } else {
     CHECK(item.second);
-    timeout_queue_.insert(timeout, heap_node);
-    if (heap_node->is_top()) {
-      update_timeout();
+    if (timeout_queue_.empty()) {
+      timeout_queue_.set_now(Time::now_cached());
     }
+    timeout_queue_.insert(timeout, timer_wheel_node);
+    update_timeout();
   }
 }
 
@@ -54,13 +52,13 @@ void MultiTimeout::cancel_timeout(int64 key) {
   LOG(DEBUG) << "Cancel " << get_name() << " for " << key;
   auto item = items_.find(Item(key));
   if (item != items_.end()) {
-    auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item));
-    CHECK(heap_node->in_heap());
-    bool need_update_timeout = heap_node->is_top();
-    timeout_queue_.erase(heap_node);
+    auto timer_wheel_node = static_cast<TimerWheelNode *>(const_cast<Item *>(&*item));
+    CHECK(timer_wheel_node->in_timer_wheel());
+    timeout_queue_.erase(timer_wheel_node);
     items_.erase(item);
 
-    if (need_update_timeout) {
+    // the timeout of the actor is left as is, because an early wakeup is harmless
+    if (items_.empty()) {
       update_timeout();
     }
   }
@@ -70,18 +68,20 @@ void MultiTimeout::update_timeout() {
   if (items_.empty()) {
     LOG(DEBUG) << "Cancel timeout of " << get_name();
     CHECK(timeout_queue_.empty());
-    CHECK(Actor::has_timeout());
-    Actor::cancel_timeout();
+    if (Actor::has_timeout()) {
+      Actor::cancel_timeout();
+    }
   } else {
-    LOG(DEBUG) << "Set timeout of " << get_name() << " in " << timeout_queue_.top_key() - Time::now_cached();
-    Actor::set_timeout_at(timeout_queue_.top_key());
+    auto wakeup_at = timeout_queue_.get_wakeup_at();
+    LOG(DEBUG) << "Set timeout of " << get_name() << " in " << wakeup_at - Time::now_cached();
+    Actor::set_timeout_at(wakeup_at);
   }
 }
 
 vector<int64> MultiTimeout::get_expired_keys(double now) {
   vector<int64> expired_keys;
-  while (!timeout_queue_.empty() && timeout_queue_.top_key() < now) {
-    int64 key = static_cast<Item *>(timeout_queue_.pop())->key;
+  while (TimerWheelNode *node = timeout_queue_.pop_expired(now)) {
+    int64 key = static_cast<Item *>(node)->key;
     items_.erase(Item(key));
     expired_keys.push_back(key);
   }
@@ -9,9 +9,9 @@
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
-#include "td/utils/Heap.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Time.h"
+#include "td/utils/TimerWheel.h"
 
 #include <set>
 
@@ -67,9 +67,9 @@ class Timeout final : public Actor {
   }
 };
 
-// TODO optimize
+// timeouts are kept in a timer wheel, so they can be set and cancelled in O(1)
 class MultiTimeout final : public Actor {
-  struct Item : public HeapNode {
+  struct Item : public TimerWheelNode {
     int64 key;
 
     explicit Item(int64 key) : key(key) {
@@ -118,7 +118,7 @@ class MultiTimeout final : public Actor {
   Callback callback_;
   Data data_;
 
-  KHeap<double> timeout_queue_;
+  TimerWheel timeout_queue_;
   std::set<Item> items_;
 
   void update_timeout();
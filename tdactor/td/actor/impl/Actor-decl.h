@@ -79,6 +79,10 @@ class Actor : public ObserverBase {
 
   void always_wait_for_mailbox();
 
+  // allows an idle scheduler to migrate the actor to itself, when ConcurrentScheduler work stealing is enabled
+  // the actor must not own file descriptors or rely on timeouts and scheduler-local data
+  void allow_stealing();
+
   // for ActorInfo mostly
   void init(ObjectPool<ActorInfo>::OwnerPtr &&info);
   ActorInfo *get_info();
@@ -10,11 +10,11 @@
 #include "td/actor/impl/Event.h"
 
 #include "td/utils/common.h"
-#include "td/utils/Heap.h"
 #include "td/utils/List.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/Slice.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/TimerWheel.h"
 
 #include <atomic>
 #include <memory>
@@ -49,7 +49,7 @@ class ActorContext {
 
 class ActorInfo
     : private ListNode
-    , HeapNode {
+    , TimerWheelNode {
  public:
   enum class Deleter : uint8 { Destroy, None };
 
@@ -90,9 +90,9 @@ class ActorInfo
   const ActorContext *get_context() const;
   CSlice get_name() const;
 
-  HeapNode *get_heap_node();
-  const HeapNode *get_heap_node() const;
-  static ActorInfo *from_heap_node(HeapNode *node);
+  TimerWheelNode *get_timer_wheel_node();
+  const TimerWheelNode *get_timer_wheel_node() const;
+  static ActorInfo *from_timer_wheel_node(TimerWheelNode *node);
 
   ListNode *get_list_node();
   const ListNode *get_list_node() const;
@@ -104,18 +104,39 @@ class ActorInfo
 
   vector<Event> mailbox_;
 
+  // urgent events are placed before ordinary events, unless the latter were already overtaken too many times
+  // returns false, if the event is a wakeup, which was dropped, because the same wakeup is already pending
+  bool add_to_mailbox(Event &&event);
+  void add_to_mailbox_front(Event &&event);
+  void on_mailbox_events_processed(size_t event_count);
+  void on_yield_processed();
+  void clear_mailbox();
+  bool has_urgent_events() const;
+
   bool is_lite() const;
 
   void set_wait_generation(uint32 wait_generation);
   bool must_wait(uint32 wait_generation) const;
   void always_wait_for_mailbox();
 
+  void allow_stealing();
+  bool is_stealable() const;
+  void set_steal_allowed_at(double steal_allowed_at);
+  double get_steal_allowed_at() const;
+
  private:
   Deleter deleter_ = Deleter::None;
   bool is_lite_ = false;
   bool is_running_ = false;
   bool always_wait_for_mailbox_{false};
+  bool is_stealable_{false};
   uint32 wait_generation_{0};
+  double steal_allowed_at_{0};
+
+  static constexpr uint32 MAX_OVERTAKING_EVENTS = 64;
+  size_t urgent_event_count_{0};      // number of urgent events in the beginning of the mailbox
+  uint32 overtaking_event_count_{0};  // number of urgent events, which overtook ordinary events since one was run
+  bool has_pending_yield_{false};     // the last event in the mailbox is a not yet processed ordinary Yield
 
   std::atomic<int32> sched_id_{0};
   Actor *actor_ = nullptr;
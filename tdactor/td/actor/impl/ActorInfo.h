@@ -12,12 +12,12 @@
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
-#include "td/utils/Heap.h"
 #include "td/utils/List.h"
 #include "td/utils/logging.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/Slice.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/TimerWheel.h"
 
 #include <atomic>
 #include <memory>
@@ -50,7 +50,9 @@ inline void ActorInfo::init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::O
   deleter_ = deleter;
   is_lite_ = is_lite;
   is_running_ = false;
+  is_stealable_ = false;
   wait_generation_ = 0;
+  steal_allowed_at_ = 0;
 }
 inline bool ActorInfo::is_lite() const {
   return is_lite_;
@@ -61,9 +63,81 @@ inline void ActorInfo::set_wait_generation(uint32 wait_generation) {
 inline bool ActorInfo::must_wait(uint32 wait_generation) const {
   return wait_generation_ == wait_generation || (always_wait_for_mailbox_ && !mailbox_.empty());
 }
+inline bool ActorInfo::add_to_mailbox(Event &&event) {
+  if (event.is_urgent) {
+    if (urgent_event_count_ == mailbox_.size()) {
+      urgent_event_count_++;
+      has_pending_yield_ = false;
+      mailbox_.push_back(std::move(event));
+      return true;
+    }
+    // events can't be reordered while the mailbox is flushed
+    if (!is_running_ && overtaking_event_count_ < MAX_OVERTAKING_EVENTS) {
+      overtaking_event_count_++;
+      mailbox_.insert(mailbox_.begin() + urgent_event_count_, std::move(event));
+      urgent_event_count_++;
+      return true;
+    }
+    // the event loses its priority to avoid starvation of ordinary events
+    has_pending_yield_ = false;
+  } else if (event.type == Event::Type::Yield) {
+    // the pending wakeup will be processed after all events, which are already in the mailbox
+    if (has_pending_yield_ && mailbox_.back().link_token == event.link_token) {
+      return false;
+    }
+    has_pending_yield_ = true;
+  } else {
+    has_pending_yield_ = false;
+  }
+  mailbox_.push_back(std::move(event));
+  return true;
+}
+inline void ActorInfo::add_to_mailbox_front(Event &&event) {
+  if (urgent_event_count_ != 0 || event.is_urgent) {
+    urgent_event_count_++;
+  }
+  if (mailbox_.empty()) {
+    has_pending_yield_ = false;
+  }
+  mailbox_.insert(mailbox_.begin(), std::move(event));
+}
+inline void ActorInfo::on_mailbox_events_processed(size_t event_count) {
+  if (event_count < urgent_event_count_) {
+    urgent_event_count_ -= event_count;
+    return;
+  }
+  if (event_count > urgent_event_count_) {
+    overtaking_event_count_ = 0;
+  }
+  urgent_event_count_ = 0;
+}
+inline void ActorInfo::on_yield_processed() {
+  has_pending_yield_ = false;
+}
+inline void ActorInfo::clear_mailbox() {
+  mailbox_.clear();
+  urgent_event_count_ = 0;
+  overtaking_event_count_ = 0;
+  has_pending_yield_ = false;
+}
+inline bool ActorInfo::has_urgent_events() const {
+  return urgent_event_count_ != 0;
+}
 inline void ActorInfo::always_wait_for_mailbox() {
   always_wait_for_mailbox_ = true;
 }
+inline void ActorInfo::allow_stealing() {
+  is_stealable_ = true;
+}
+inline bool ActorInfo::is_stealable() const {
+  return is_stealable_;
+}
+inline void ActorInfo::set_steal_allowed_at(double steal_allowed_at) {
+  steal_allowed_at_ = steal_allowed_at;
+}
+inline double ActorInfo::get_steal_allowed_at() const {
+  return steal_allowed_at_;
+}
 inline void ActorInfo::on_actor_moved(Actor *actor_new_ptr) {
   actor_ = actor_new_ptr;
 }
@@ -94,7 +168,7 @@ inline void ActorInfo::destroy_actor() {
       break;
   }
   actor_ = nullptr;
-  mailbox_.clear();
+  clear_mailbox();
 }
 
 template <class ActorT>
@@ -188,13 +262,13 @@ inline bool ActorInfo::is_running() const {
   return is_running_;
 }
 
-inline HeapNode *ActorInfo::get_heap_node() {
+inline TimerWheelNode *ActorInfo::get_timer_wheel_node() {
   return this;
 }
-inline const HeapNode *ActorInfo::get_heap_node() const {
+inline const TimerWheelNode *ActorInfo::get_timer_wheel_node() const {
   return this;
 }
-inline ActorInfo *ActorInfo::from_heap_node(HeapNode *node) {
+inline ActorInfo *ActorInfo::from_timer_wheel_node(TimerWheelNode *node) {
   return static_cast<ActorInfo *>(node);
 }
 inline ListNode *ActorInfo::get_list_node() {
@@ -11,22 +11,23 @@
 #include "td/actor/impl/ActorInfo.h"
 #include "td/actor/impl/Scheduler.h"
 
-#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/logging.h"
+#include "td/utils/MpscLinkPollableQueue.h"
 #include "td/utils/port/thread_local.h"
 
 #include <memory>
 
 namespace td {
 
-void ConcurrentScheduler::init(int32 threads_n) {
+void ConcurrentScheduler::init(int32 threads_n, bool use_work_stealing) {
 #if TD_THREAD_UNSUPPORTED || TD_EVENTFD_UNSUPPORTED
   threads_n = 0;
 #endif
   threads_n++;
-  std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound(threads_n);
+  std::vector<std::shared_ptr<MpscLinkPollableQueue<EventFull>>> outbound(threads_n);
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
   for (int32 i = 0; i < threads_n; i++) {
-    auto queue = std::make_shared<MpscPollableQueue<EventFull>>();
+    auto queue = std::make_shared<MpscLinkPollableQueue<EventFull>>();
     queue->init();
     outbound[i] = queue;
   }
@@ -47,7 +48,7 @@ void ConcurrentScheduler::init(int32 threads_n) {
 
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
     if (i >= threads_n) {
-      auto queue = std::make_shared<MpscPollableQueue<EventFull>>();
+      auto queue = std::make_shared<MpscLinkPollableQueue<EventFull>>();
       queue->init();
       outbound.push_back(std::move(queue));
     }
@@ -56,6 +57,20 @@ void ConcurrentScheduler::init(int32 threads_n) {
     sched->init(i, outbound, static_cast<Scheduler::Callback *>(this));
   }
 
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  if (use_work_stealing && threads_n > 1) {
+    // the extra scheduler doesn't run actors, so it neither steals nor is stolen from
+    std::vector<StealingQueue<ActorInfo *> *> queues;
+    for (int32 i = 0; i < threads_n; i++) {
+      stealing_queues_.push_back(make_unique<StealingQueue<ActorInfo *>>());
+      queues.push_back(stealing_queues_.back().get());
+    }
+    for (int32 i = 0; i < threads_n; i++) {
+      schedulers_[i]->enable_work_stealing(queues);
+    }
+  }
+#endif
+
 #if TD_PORT_WINDOWS
   iocp_ = make_unique<detail::Iocp>();
   iocp_->init();
@@ -86,6 +101,13 @@ void ConcurrentScheduler::start() {
         sched->run(Timestamp::in(10));
       }
     }));
+    if (first_cpu_id_ >= 0) {
+      auto cpu_id = static_cast<int32>((first_cpu_id_ + i) % thread::hardware_concurrency());
+      auto status = threads_.back().set_cpu_affinity(cpu_id);
+      if (status.is_error()) {
+        LOG(ERROR) << "Failed to pin scheduler " << i << " thread to CPU " << cpu_id << ": " << status;
+      }
+    }
   }
 #if TD_PORT_WINDOWS
   iocp_thread_ = td::thread([this] {
@@ -153,6 +175,7 @@ void ConcurrentScheduler::finish() {
 #endif
 
   schedulers_.clear();
+  stealing_queues_.clear();
   for (auto &f : at_finish_) {
     f();
   }
@@ -11,6 +11,7 @@
 #include "td/utils/common.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StealingQueue.h"
 #include "td/utils/Time.h"
 
 #if TD_PORT_WINDOWS
@@ -26,7 +27,9 @@ namespace td {
 
 class ConcurrentScheduler : private Scheduler::Callback {
  public:
-  void init(int32 threads_n);
+  // if use_work_stealing is true, idle schedulers take over ready actors, which allow stealing,
+  // together with their pending events from busy schedulers
+  void init(int32 threads_n, bool use_work_stealing = false);
 
   void finish_async() {
     schedulers_[0]->finish();
@@ -48,6 +51,14 @@ class ConcurrentScheduler : private Scheduler::Callback {
     return is_finished_.load(std::memory_order_relaxed);
   }
 
+  // threads running the schedulers, except the main one, will be pinned to CPUs first_cpu_id + sched_id
+  // modulo the number of CPUs; must be called before start
+  void pin_threads_to_cpus(int32 first_cpu_id) {
+    CHECK(state_ == State::Start);
+    CHECK(first_cpu_id >= 0);
+    first_cpu_id_ = first_cpu_id;
+  }
+
   void start();
 
   bool run_main(double timeout) {
@@ -85,6 +96,7 @@ class ConcurrentScheduler : private Scheduler::Callback {
   enum class State { Start, Run };
   State state_ = State::Start;
   std::vector<unique_ptr<Scheduler>> schedulers_;
+  std::vector<unique_ptr<StealingQueue<ActorInfo *>>> stealing_queues_;
   std::atomic<bool> is_finished_{false};
   std::mutex at_finish_mutex_;
   std::vector<std::function<void()>> at_finish_;
@@ -96,6 +108,7 @@ class ConcurrentScheduler : private Scheduler::Callback {
   td::thread iocp_thread_;
 #endif
   int32 extra_scheduler_;
+  int32 first_cpu_id_ = -1;
 
   void on_finish() override {
     is_finished_.store(true, std::memory_order_relaxed);
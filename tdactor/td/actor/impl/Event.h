@@ -9,6 +9,7 @@
 #include "td/utils/Closure.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/SmallObjectCache.h"
 #include "td/utils/StringBuilder.h"
 
 #include <type_traits>
@@ -31,6 +32,8 @@ class Actor;
 // Hangup -- hang up called
 // Raw -- just pass 8 bytes (union Raw is used for convenience)
 // Custom -- Send CustomEvent
+//
+// Urgent events are queued in the actor mailbox before ordinary ones.
 
 template <class T>
 std::enable_if_t<!std::is_base_of<Actor, T>::value> start_migrate(T &obj, int32 sched_id) {
@@ -48,6 +51,14 @@ class CustomEvent {
   CustomEvent &operator=(CustomEvent &&) = delete;
   virtual ~CustomEvent() = default;
 
+  // custom events are small and short-lived, so their memory is cached
+  static void *operator new(size_t size) {
+    return allocate_small_object(size);
+  }
+  static void operator delete(void *ptr, size_t size) {
+    free_small_object(ptr, size);
+  }
+
   virtual void run(Actor *actor) = 0;
   virtual CustomEvent *clone() const = 0;
   virtual void start_migrate(int32 sched_id) {
@@ -109,6 +120,7 @@ class Event {
  public:
   enum class Type { NoType, Start, Stop, Yield, Timeout, Hangup, Raw, Custom };
   Type type;
+  bool is_urgent = false;
   uint64 link_token = 0;
   union Raw {
     void *ptr;
@@ -166,12 +178,13 @@ class Event {
   }
   Event(const Event &other) = delete;
   Event &operator=(const Event &) = delete;
-  Event(Event &&other) : type(other.type), link_token(other.link_token), data(other.data) {
+  Event(Event &&other) : type(other.type), is_urgent(other.is_urgent), link_token(other.link_token), data(other.data) {
     other.type = Type::NoType;
   }
   Event &operator=(Event &&other) {
     destroy();
     type = other.type;
+    is_urgent = other.is_urgent;
     link_token = other.link_token;
     data = other.data;
     other.type = Type::NoType;
@@ -184,6 +197,7 @@ class Event {
   Event clone() const {
     Event res;
     res.type = type;
+    res.is_urgent = is_urgent;
     if (type == Type::Custom) {
       res.data.custom_event = data.custom_event->clone();
     } else {
@@ -199,6 +213,7 @@ class Event {
   void clear() {
     destroy();
     type = Type::NoType;
+    is_urgent = false;
   }
 
   Event &set_link_token(uint64 new_link_token) {
@@ -206,6 +221,11 @@ class Event {
     return *this;
   }
 
+  Event &set_urgent() {
+    is_urgent = true;
+    return *this;
+  }
+
   friend void start_migrate(Event &obj, int32 sched_id) {
     if (obj.type == Type::Custom) {
       obj.data.custom_event->start_migrate(sched_id);
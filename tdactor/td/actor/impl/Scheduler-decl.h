@@ -6,23 +6,25 @@
 //
 #pragma once
 
+#include "td/actor/ActorStats.h"
 #include "td/actor/impl/Actor-decl.h"
 #include "td/actor/impl/ActorId-decl.h"
 #include "td/actor/impl/EventFull-decl.h"
 
 #include "td/utils/Closure.h"
-#include "td/utils/Heap.h"
 #include "td/utils/List.h"
 #include "td/utils/logging.h"
 #include "td/utils/MovableValue.h"
-#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/MpscLinkPollableQueue.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/Poll.h"
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StealingQueue.h"
 #include "td/utils/Time.h"
+#include "td/utils/TimerWheel.h"
 #include "td/utils/type_traits.h"
 
 #include <functional>
@@ -37,7 +39,8 @@ extern int VERBOSITY_NAME(actor);
 
 class ActorInfo;
 
-enum class ActorSendType { Immediate, Later, LaterWeak };
+// ImmediateUrgent is the same as Immediate, but if the event can't be run immediately, it is queued as urgent
+enum class ActorSendType { Immediate, ImmediateUrgent, Later, LaterWeak };
 
 class Scheduler;
 class SchedulerGuard {
@@ -77,9 +80,12 @@ class Scheduler {
   ~Scheduler();
 
   void init();
-  void init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound, Callback *callback);
+  void init(int32 id, std::vector<std::shared_ptr<MpscLinkPollableQueue<EventFull>>> outbound, Callback *callback);
   void clear();
 
+  // queues[i] is the queue of stealable actors offered by the scheduler i; null queues are skipped
+  void enable_work_stealing(std::vector<StealingQueue<ActorInfo *> *> queues);
+
   int32 sched_id() const;
   int32 sched_count() const;
 
@@ -146,16 +152,19 @@ class Scheduler {
 
   Timestamp get_timeout();
 
+  // returns number of wakeups, which were dropped, because the same wakeup was already pending
+  uint64 get_coalesced_wakeup_count() const;
+
  private:
   static void set_scheduler(Scheduler *scheduler);
   /*** ServiceActor ***/
   class ServiceActor final : public Actor {
    public:
-    void set_queue(std::shared_ptr<MpscPollableQueue<EventFull>> queues);
+    void set_queue(std::shared_ptr<MpscLinkPollableQueue<EventFull>> queues);
     void start_up() override;
 
    private:
-    std::shared_ptr<MpscPollableQueue<EventFull>> inbound_;
+    std::shared_ptr<MpscLinkPollableQueue<EventFull>> inbound_;
     bool subscribed_{false};
     void loop() override;
     void tear_down() override;
@@ -181,8 +190,26 @@ class Scheduler {
   void cancel_actor_timeout(ActorInfo *actor_info);
 
   void register_migrated_actor(ActorInfo *actor_info);
+
+  static constexpr int MIN_INBOUND_EVENTS_TO_OFFER = 16;
+  static constexpr int MAX_INBOUND_EVENTS_TO_STOP_OFFER = 4;
+  static constexpr size_t MIN_READY_ACTORS_TO_OFFER = 4;
+  static constexpr double MIN_STEAL_INTERVAL = 1.0;
+  bool is_overloaded() const;
+  void update_overload_state(int inbound_event_count);
+  void offer_stealable_actor(ActorInfo *actor_info);
+  void offer_stealable_actors();
+  void steal_actors();
+  void request_stolen_actor(ActorInfo *actor_info);
+  void on_steal_request(ActorInfo *actor_info, int32 thief_sched_id);
+
   void add_to_mailbox(ActorInfo *actor_info, Event &&event);
   void clear_mailbox(ActorInfo *actor_info);
+  void put_to_ready_actors_list(ActorInfo *actor_info);
+
+  // an actor with many pending events yields to other ready actors after running for this time,
+  // so a single busy actor, for example Td of one of many clients, can't delay others for long
+  static constexpr double MAX_ACTOR_RUN_TIME = 0.005;
 
   template <class RunFuncT, class EventFuncT>
   void flush_mailbox(ActorInfo *actor_info, const RunFuncT &run_func, const EventFuncT &event_func);
@@ -194,6 +221,7 @@ class Scheduler {
 
   Timestamp run_timeout();
   void run_mailbox();
+  void run_ready_actors(ListNode &actors_list);
   Timestamp run_events();
   void run_poll(Timestamp timeout);
 
@@ -210,7 +238,8 @@ class Scheduler {
   int32 actor_count_ = 0;
   ListNode pending_actors_list_;
   ListNode ready_actors_list_;
-  KHeap<double> timeout_queue_;
+  ListNode urgent_ready_actors_list_;  // ready actors with urgent events in the mailbox
+  TimerWheel timeout_queue_;
 
   std::map<ActorInfo *, std::vector<Event>> pending_events_;
 
@@ -224,11 +253,19 @@ class Scheduler {
   uint32 wait_generation_ = 1;
   int32 sched_id_ = 0;
   int32 sched_n_ = 0;
-  std::shared_ptr<MpscPollableQueue<EventFull>> inbound_queue_;
-  std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound_queues_;
+  std::shared_ptr<MpscLinkPollableQueue<EventFull>> inbound_queue_;
+  std::vector<std::shared_ptr<MpscLinkPollableQueue<EventFull>>> outbound_queues_;
+
+  StealingQueue<ActorInfo *> *stealing_queue_ = nullptr;
+  bool is_overloaded_ = false;
+  bool has_yielded_actors_ = false;
+  uint64 coalesced_wakeup_count_ = 0;
+  std::vector<StealingQueue<ActorInfo *> *> stealing_queues_;
 
   std::shared_ptr<ActorContext> save_context_;
 
+  std::shared_ptr<ActorStats> actor_stats_;
+
   struct EventContext {
     int32 dest_sched_id{0};
     enum Flags { Stop = 1, Migrate = 2 };
@@ -267,6 +304,18 @@ void send_closure(ActorIdT &&actor_id, FunctionT function, ArgsT &&... args) {
       std::forward<ActorIdT>(actor_id), create_immediate_closure(function, std::forward<ArgsT>(args)...));
 }
 
+// the same as send_closure, but if the closure can't be run immediately, it is queued before ordinary events;
+// should be used only for latency-critical events like network query results and user requests
+template <class ActorIdT, class FunctionT, class... ArgsT>
+void send_closure_urgent(ActorIdT &&actor_id, FunctionT function, ArgsT &&... args) {
+  using ActorT = typename std::decay_t<ActorIdT>::ActorT;
+  using FunctionClassT = member_function_class_t<FunctionT>;
+  static_assert(std::is_base_of<FunctionClassT, ActorT>::value, "unsafe send_closure");
+
+  Scheduler::instance()->send_closure<ActorSendType::ImmediateUrgent>(
+      std::forward<ActorIdT>(actor_id), create_immediate_closure(function, std::forward<ArgsT>(args)...));
+}
+
 template <class ActorIdT, class FunctionT, class... ArgsT>
 void send_closure_later(ActorIdT &&actor_id, FunctionT function, ArgsT &&... args) {
   using ActorT = typename std::decay_t<ActorIdT>::ActorT;
@@ -16,13 +16,15 @@
 #include "td/utils/format.h"
 #include "td/utils/List.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Time.h"
+#include "td/utils/TraceLog.h"
 
 #include <functional>
-#include <iterator>
+#include <tuple>
 #include <utility>
 
 namespace td {
@@ -34,6 +36,9 @@ TD_THREAD_LOCAL ActorContext *Scheduler::context_;  // static zero-initialized
 
 Scheduler::~Scheduler() {
   clear();
+  if (actor_stats_ != nullptr) {
+    ActorStats::retire(std::move(actor_stats_));
+  }
 }
 
 Scheduler *Scheduler::instance() {
@@ -74,16 +79,26 @@ void Scheduler::ServiceActor::loop() {
   if (ready_n == 0) {
     return;
   }
+  auto scheduler = Scheduler::instance();
+  scheduler->update_overload_state(ready_n);
+  bool offer_actors = scheduler->stealing_queue_ != nullptr && scheduler->is_overloaded();
   while (ready_n-- > 0) {
     EventFull event = queue->reader_get_unsafe();
     if (event.actor_id().empty()) {
       if (event.data().empty()) {
         yield_scheduler();
+      } else if (event.data().link_token != 0) {
+        // link_token is the identifier of the idle scheduler plus one
+        scheduler->on_steal_request(static_cast<ActorInfo *>(event.data().data.ptr),
+                                    narrow_cast<int32>(event.data().link_token - 1));
       } else {
-        Scheduler::instance()->register_migrated_actor(static_cast<ActorInfo *>(event.data().data.ptr));
+        scheduler->register_migrated_actor(static_cast<ActorInfo *>(event.data().data.ptr));
       }
     } else {
       VLOG(actor) << "Receive " << event.data();
+      if (offer_actors) {
+        scheduler->offer_stealable_actor(event.actor_id().get_actor_info());
+      }
       finish_migrate(event.data());
       event.try_emit();
     }
@@ -155,11 +170,7 @@ EventGuard::~EventGuard() {
   auto info = event_context_.actor_info;
   auto node = info->get_list_node();
   node->remove();
-  if (info->mailbox_.empty()) {
-    scheduler_->pending_actors_list_.put(node);
-  } else {
-    scheduler_->ready_actors_list_.put(node);
-  }
+  scheduler_->put_to_ready_actors_list(info);
   info->finish_run();
   swap_context(info);
   CHECK(info->is_lite() || save_context_ == info->get_context());
@@ -195,7 +206,7 @@ void EventGuard::swap_context(ActorInfo *info) {
   }
 }
 
-void Scheduler::init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound,
+void Scheduler::init(int32 id, std::vector<std::shared_ptr<MpscLinkPollableQueue<EventFull>>> outbound,
                      Callback *callback) {
   save_context_ = std::make_shared<ActorContext>();
   save_context_->this_ptr_ = save_context_;
@@ -205,6 +216,9 @@ void Scheduler::init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<Eve
 
   callback_ = callback;
   actor_info_pool_ = make_unique<ObjectPool<ActorInfo>>();
+  if (actor_stats_ == nullptr) {
+    actor_stats_ = ActorStats::create();
+  }
 
   yield_flag_ = false;
   actor_count_ = 0;
@@ -237,12 +251,17 @@ void Scheduler::clear() {
     auto actor_info = ActorInfo::from_list_node(pending_actors_list_.get());
     do_stop_actor(actor_info);
   }
+  while (!urgent_ready_actors_list_.empty()) {
+    auto actor_info = ActorInfo::from_list_node(urgent_ready_actors_list_.get());
+    do_stop_actor(actor_info);
+  }
   while (!ready_actors_list_.empty()) {
     auto actor_info = ActorInfo::from_list_node(ready_actors_list_.get());
     do_stop_actor(actor_info);
   }
   LOG_IF(FATAL, !ready_actors_list_.empty()) << ActorInfo::from_list_node(ready_actors_list_.next)->get_name();
   CHECK(ready_actors_list_.empty());
+  CHECK(urgent_ready_actors_list_.empty());
   poll_.clear();
 
   if (callback_) {
@@ -258,6 +277,12 @@ void Scheduler::do_event(ActorInfo *actor_info, Event &&event) {
   event_context_ptr_->link_token = event.link_token;
   auto actor = actor_info->get_actor_unsafe();
   VLOG(actor) << *actor_info << ' ' << event;
+  uint32 trace_name_id = 0;
+  if (unlikely(TraceLog::is_enabled())) {
+    trace_name_id = TraceLog::get_name_id(actor_info->get_name());
+    TraceLog::add_event(TraceLog::EventType::ActorEventBegin, trace_name_id, reinterpret_cast<uint64>(actor_info),
+                        static_cast<uint64>(event.type));
+  }
   switch (event.type) {
     case Event::Type::Start:
       actor->start_up();
@@ -266,6 +291,7 @@ void Scheduler::do_event(ActorInfo *actor_info, Event &&event) {
       actor->tear_down();
       break;
     case Event::Type::Yield:
+      actor_info->on_yield_processed();
       actor->wakeup();
       break;
     case Event::Type::Hangup:
@@ -289,6 +315,10 @@ void Scheduler::do_event(ActorInfo *actor_info, Event &&event) {
       UNREACHABLE();
       break;
   }
+  if (unlikely(trace_name_id != 0)) {
+    // actor_info can be already destroyed
+    TraceLog::add_event(TraceLog::EventType::ActorEventEnd, trace_name_id, reinterpret_cast<uint64>(actor_info));
+  }
   // can't clear event here. It may be already destroyed during destroy_actor
 }
 
@@ -306,18 +336,100 @@ void Scheduler::register_migrated_actor(ActorInfo *actor_info) {
   }
   auto it = pending_events_.find(actor_info);
   if (it != pending_events_.end()) {
-    actor_info->mailbox_.insert(actor_info->mailbox_.end(), std::make_move_iterator(it->second.begin()),
-                                std::make_move_iterator(it->second.end()));
+    for (auto &event : it->second) {
+      if (!actor_info->add_to_mailbox(std::move(event))) {
+        coalesced_wakeup_count_++;
+      }
+    }
     pending_events_.erase(it);
   }
-  if (actor_info->mailbox_.empty()) {
-    pending_actors_list_.put(actor_info->get_list_node());
-  } else {
-    ready_actors_list_.put(actor_info->get_list_node());
-  }
+  put_to_ready_actors_list(actor_info);
   actor_info->get_actor_unsafe()->on_finish_migrate();
 }
 
+void Scheduler::enable_work_stealing(std::vector<StealingQueue<ActorInfo *> *> queues) {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  CHECK(static_cast<size_t>(sched_id_) < queues.size());
+  CHECK(queues.size() <= outbound_queues_.size());
+  stealing_queue_ = queues[sched_id_];
+  stealing_queues_ = std::move(queues);
+#endif
+}
+
+void Scheduler::offer_stealable_actor(ActorInfo *actor_info) {
+  if (actor_info != nullptr && actor_info->is_stealable()) {
+    // if the queue is full, the oldest offers are just forgotten
+    stealing_queue_->local_push(actor_info, [](ActorInfo *) {});
+  }
+}
+
+void Scheduler::offer_stealable_actors() {
+  // the first actors are left to the current scheduler, because it will run them right now anyway
+  size_t ready_count = 0;
+  for (ListNode *end = &ready_actors_list_, *it = ready_actors_list_.next; it != end; it = it->next) {
+    if (++ready_count > MIN_READY_ACTORS_TO_OFFER) {
+      offer_stealable_actor(ActorInfo::from_list_node(it));
+    }
+  }
+}
+
+void Scheduler::steal_actors() {
+  constexpr size_t MAX_STEAL_REQUESTS = 8;
+  auto queue_count = static_cast<int32>(stealing_queues_.size());
+  for (int32 i = 1; i < queue_count; i++) {
+    auto victim = stealing_queues_[(sched_id_ + i) % queue_count];
+    if (victim == nullptr) {
+      continue;
+    }
+    ActorInfo *actor_info = nullptr;
+    if (!stealing_queue_->steal(actor_info, *victim)) {
+      continue;
+    }
+    request_stolen_actor(actor_info);
+    for (size_t j = 1; j < MAX_STEAL_REQUESTS && stealing_queue_->local_pop(actor_info); j++) {
+      request_stolen_actor(actor_info);
+    }
+    return;
+  }
+}
+
+void Scheduler::request_stolen_actor(ActorInfo *actor_info) {
+  // actor_info can be already destroyed or reused, but ActorInfo storage is freed only after all schedulers are
+  // stopped, so its scheduler identifier can be safely read. The owner will recheck everything
+  int32 actor_sched_id;
+  bool is_migrating;
+  std::tie(actor_sched_id, is_migrating) = actor_info->migrate_dest_flag_atomic();
+  if (is_migrating || actor_sched_id == sched_id_ || actor_sched_id < 0 ||
+      static_cast<size_t>(actor_sched_id) >= stealing_queues_.size()) {
+    return;
+  }
+  auto event = Event::raw(static_cast<void *>(actor_info));
+  event.set_link_token(static_cast<uint64>(sched_id_) + 1);
+  send_to_other_scheduler(actor_sched_id, ActorId<>(), std::move(event));
+}
+
+void Scheduler::on_steal_request(ActorInfo *actor_info, int32 thief_sched_id) {
+  int32 actor_sched_id;
+  bool is_migrating;
+  std::tie(actor_sched_id, is_migrating) = actor_info->migrate_dest_flag_atomic();
+  if (is_migrating || actor_sched_id != sched_id_ || thief_sched_id == sched_id_) {
+    // the actor has already left the scheduler
+    return;
+  }
+  // timeouts are lost during migration, so actors waiting for a timeout are never stolen;
+  // there is no reason to migrate an actor without pending events from a scheduler, which isn't overloaded either;
+  // recently migrated actors stay where they are for some time to avoid thrashing
+  if (actor_info->empty() || !actor_info->is_stealable() || actor_info->is_running() ||
+      has_actor_timeout(actor_info) || (actor_info->mailbox_.empty() && !is_overloaded()) ||
+      actor_info->get_steal_allowed_at() > Time::now_cached()) {
+    return;
+  }
+  actor_info->set_steal_allowed_at(Time::now_cached() + MIN_STEAL_INTERVAL);
+  VLOG(actor) << "Give " << *actor_info << " with " << actor_info->mailbox_.size() << " pending events to scheduler "
+              << thief_sched_id;
+  do_migrate_actor(actor_info, thief_sched_id);
+}
+
 void Scheduler::send_to_other_scheduler(int32 sched_id, const ActorId<> &actor_id, Event &&event) {
   if (sched_id < sched_count()) {
     auto actor_info = actor_id.get_actor_info();
@@ -333,13 +445,33 @@ void Scheduler::send_to_other_scheduler(int32 sched_id, const ActorId<> &actor_i
 }
 
 void Scheduler::add_to_mailbox(ActorInfo *actor_info, Event &&event) {
+  VLOG(actor) << "Add to mailbox: " << *actor_info << " " << event;
+  if (!actor_info->add_to_mailbox(std::move(event))) {
+    // the actor will be run anyway, because its mailbox isn't empty
+    coalesced_wakeup_count_++;
+    if (unlikely(ActorStats::is_enabled())) {
+      actor_stats_->on_coalesced_wakeup(actor_info->get_name());
+    }
+    return;
+  }
   if (!actor_info->is_running()) {
-    auto node = actor_info->get_list_node();
-    node->remove();
+    actor_info->get_list_node()->remove();
+    put_to_ready_actors_list(actor_info);
+  }
+  if (unlikely(ActorStats::is_enabled())) {
+    actor_stats_->on_mailbox_size(actor_info->get_name(), actor_info->mailbox_.size());
+  }
+}
+
+void Scheduler::put_to_ready_actors_list(ActorInfo *actor_info) {
+  auto node = actor_info->get_list_node();
+  if (actor_info->mailbox_.empty()) {
+    pending_actors_list_.put(node);
+  } else if (actor_info->has_urgent_events()) {
+    urgent_ready_actors_list_.put(node);
+  } else {
     ready_actors_list_.put(node);
   }
-  VLOG(actor) << "Add to mailbox: " << *actor_info << " " << event;
-  actor_info->mailbox_.push_back(std::move(event));
 }
 
 void Scheduler::do_stop_actor(Actor *actor) {
@@ -418,37 +550,42 @@ void Scheduler::set_actor_timeout_in(ActorInfo *actor_info, double timeout) {
 }
 
 void Scheduler::set_actor_timeout_at(ActorInfo *actor_info, double timeout_at) {
-  HeapNode *heap_node = actor_info->get_heap_node();
+  TimerWheelNode *timer_wheel_node = actor_info->get_timer_wheel_node();
   VLOG(actor) << "Set actor " << *actor_info << " timeout in " << timeout_at - Time::now_cached();
-  if (heap_node->in_heap()) {
-    timeout_queue_.fix(timeout_at, heap_node);
+  if (timer_wheel_node->in_timer_wheel()) {
+    timeout_queue_.fix(timeout_at, timer_wheel_node);
   } else {
-    timeout_queue_.insert(timeout_at, heap_node);
+    if (timeout_queue_.empty()) {
+      timeout_queue_.set_now(Time::now_cached());
+    }
+    timeout_queue_.insert(timeout_at, timer_wheel_node);
   }
 }
 
 void Scheduler::run_poll(Timestamp timeout) {
+#if TD_PORT_WINDOWS
   // we can't wait for less than 1ms
   int timeout_ms = static_cast<int32>(td::max(timeout.in(), 0.0) * 1000 + 1);
-#if TD_PORT_WINDOWS
   CHECK(inbound_queue_);
   inbound_queue_->reader_get_event_fd().wait(timeout_ms);
   service_actor_.notify();
 #elif TD_PORT_POSIX
-  poll_.run(timeout_ms);
+  // the poll doesn't wait for expired timeouts and wakes up as close to the nearest timeout as it can
+  poll_.run_precise(timeout.in());
 #endif
 }
 
 void Scheduler::run_mailbox() {
   VLOG(actor) << "Run mailbox : begin";
-  ListNode actors_list = std::move(ready_actors_list_);
-  while (!actors_list.empty()) {
-    ListNode *node = actors_list.get();
-    CHECK(node);
-    auto actor_info = ActorInfo::from_list_node(node);
-    inc_wait_generation();
-    flush_mailbox(actor_info, static_cast<void (*)(ActorInfo *)>(nullptr), static_cast<Event (*)()>(nullptr));
+  if (stealing_queue_ != nullptr) {
+    offer_stealable_actors();
   }
+  // actors with urgent events are run first, but all actors, which are ready now, are run in the same pass,
+  // so actors with only ordinary events can't starve
+  ListNode urgent_actors_list = std::move(urgent_ready_actors_list_);
+  ListNode actors_list = std::move(ready_actors_list_);
+  run_ready_actors(urgent_actors_list);
+  run_ready_actors(actors_list);
   VLOG(actor) << "Run mailbox : finish " << actor_count_;
 
   //Useful for debug, but O(ActorsCount) check
@@ -469,12 +606,21 @@ void Scheduler::run_mailbox() {
   //LOG_CHECK(cnt == actor_count_) << cnt << " vs " << actor_count_;
 }
 
+void Scheduler::run_ready_actors(ListNode &actors_list) {
+  while (!actors_list.empty()) {
+    ListNode *node = actors_list.get();
+    CHECK(node);
+    auto actor_info = ActorInfo::from_list_node(node);
+    inc_wait_generation();
+    flush_mailbox(actor_info, static_cast<void (*)(ActorInfo *)>(nullptr), static_cast<Event (*)()>(nullptr));
+  }
+}
+
 Timestamp Scheduler::run_timeout() {
   double now = Time::now();
   //TODO: use Timestamp().is_in_past()
-  while (!timeout_queue_.empty() && timeout_queue_.top_key() < now) {
-    HeapNode *node = timeout_queue_.pop();
-    ActorInfo *actor_info = ActorInfo::from_heap_node(node);
+  while (TimerWheelNode *node = timeout_queue_.pop_expired(now)) {
+    ActorInfo *actor_info = ActorInfo::from_timer_wheel_node(node);
     inc_wait_generation();
     send<ActorSendType::Immediate>(actor_info->actor_id(), Event::timeout());
   }
@@ -483,15 +629,26 @@ Timestamp Scheduler::run_timeout() {
 
 void Scheduler::run_no_guard(Timestamp timeout) {
   CHECK(has_guard_);
+  Time::update_coarse();
   SCOPE_EXIT {
     yield_flag_ = false;
+    Time::reset_coarse();
   };
 
   timeout.relax(run_events());
   if (yield_flag_) {
     return;
   }
+  if (has_yielded_actors_) {
+    // there are still ready actors, so only new events must be received without waiting
+    timeout = Timestamp::now();
+  } else if (stealing_queue_ != nullptr) {
+    // the scheduler has nothing to do, so it is time to help others
+    is_overloaded_ = false;
+    steal_actors();
+  }
   run_poll(timeout);
+  Time::update_coarse();
   run_events();
 }
 
@@ -499,7 +656,7 @@ Timestamp Scheduler::get_timeout() {
   if (timeout_queue_.empty()) {
     return Timestamp::in(10000);
   }
-  return Timestamp::at(timeout_queue_.top_key());
+  return Timestamp::at(timeout_queue_.get_wakeup_at());
 }
 
 }  // namespace td
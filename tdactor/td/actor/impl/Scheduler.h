@@ -6,19 +6,21 @@
 //
 #pragma once
 
+#include "td/actor/ActorStats.h"
 #include "td/actor/impl/ActorInfo-decl.h"
 #include "td/actor/impl/Scheduler-decl.h"
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
-#include "td/utils/Heap.h"
 #include "td/utils/logging.h"
-#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/MpscLinkPollableQueue.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/port/detail/PollableFd.h"
+#include "td/utils/port/PerfCounters.h"
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Time.h"
+#include "td/utils/TimerWheel.h"
 
 #include <atomic>
 #include <memory>
@@ -28,7 +30,7 @@
 namespace td {
 
 /*** ServiceActor ***/
-inline void Scheduler::ServiceActor::set_queue(std::shared_ptr<MpscPollableQueue<EventFull>> queues) {
+inline void Scheduler::ServiceActor::set_queue(std::shared_ptr<MpscLinkPollableQueue<EventFull>> queues) {
   inbound_ = std::move(queues);
 }
 
@@ -75,6 +77,9 @@ inline int32 Scheduler::sched_id() const {
 inline int32 Scheduler::sched_count() const {
   return sched_n_;
 }
+inline uint64 Scheduler::get_coalesced_wakeup_count() const {
+  return coalesced_wakeup_count_;
+}
 
 template <class ActorT, class... Args>
 ActorOwn<ActorT> Scheduler::create_actor(Slice name, Args &&... args) {
@@ -117,13 +122,14 @@ ActorOwn<ActorT> Scheduler::register_actor_impl(Slice name, ActorT *actor_ptr, A
                    ActorTraits<ActorT>::is_lite);
 
   ActorId<ActorT> actor_id = weak_info->actor_id(actor_ptr);
+  // the start event is urgent, so it can't be overtaken by other urgent events
   if (sched_id != sched_id_) {
-    send<ActorSendType::LaterWeak>(actor_id, Event::start());
+    send<ActorSendType::LaterWeak>(actor_id, std::move(Event::start().set_urgent()));
     do_migrate_actor(actor_info, sched_id);
   } else {
     pending_actors_list_.put(weak_info->get_list_node());
     if (!ActorTraits<ActorT>::is_lite) {
-      send<ActorSendType::LaterWeak>(actor_id, Event::start());
+      send<ActorSendType::LaterWeak>(actor_id, std::move(Event::start().set_urgent()));
     }
   }
 
@@ -157,18 +163,52 @@ void Scheduler::flush_mailbox(ActorInfo *actor_info, const RunFuncT &run_func, c
   size_t mailbox_size = mailbox.size();
   CHECK(mailbox_size != 0);
   EventGuard guard(this, actor_info);
+  bool need_stats = ActorStats::is_enabled();
+  double run_until = mailbox_size > 1 ? Time::now() + MAX_ACTOR_RUN_TIME : 0.0;
+  bool is_yielded = false;
   size_t i = 0;
   for (; i < mailbox_size && guard.can_run(); i++) {
+    if (i > 0 && run_until != 0.0 && Time::now() > run_until) {
+      // the rest of the events will be processed after other ready actors
+      is_yielded = true;
+      has_yielded_actors_ = true;
+      break;
+    }
+    auto start_time = need_stats ? Time::now() : 0.0;
+    auto start_counters = need_stats ? PerfCounters::get_thread_values() : PerfCounters::Values();
     do_event(actor_info, std::move(mailbox[i]));
+    if (need_stats) {
+      actor_stats_->on_event(actor_info->get_name(), Time::now() - start_time,
+                             PerfCounters::get_thread_values() - start_counters);
+    }
   }
   if (run_func) {
+    if (is_yielded) {
+      // the new event must not overtake the pending events
+      mailbox.erase(mailbox.begin(), mailbox.begin() + i);
+      actor_info->on_mailbox_events_processed(i);
+      if (!actor_info->add_to_mailbox((*event_func)())) {
+        coalesced_wakeup_count_++;
+      }
+      return;
+    }
     if (guard.can_run()) {
+      auto start_time = need_stats ? Time::now() : 0.0;
+      auto start_counters = need_stats ? PerfCounters::get_thread_values() : PerfCounters::Values();
       (*run_func)(actor_info);
+      if (need_stats) {
+        actor_stats_->on_event(actor_info->get_name(), Time::now() - start_time,
+                               PerfCounters::get_thread_values() - start_counters);
+      }
     } else {
-      mailbox.insert(mailbox.begin() + i, (*event_func)());
+      mailbox.erase(mailbox.begin(), mailbox.begin() + i);
+      actor_info->on_mailbox_events_processed(i);
+      actor_info->add_to_mailbox_front((*event_func)());
+      return;
     }
   }
   mailbox.erase(mailbox.begin(), mailbox.begin() + i);
+  actor_info->on_mailbox_events_processed(i);
 }
 
 inline void Scheduler::send_to_scheduler(int32 sched_id, const ActorId<> &actor_id, Event &&event) {
@@ -184,6 +224,19 @@ inline void Scheduler::before_tail_send(const ActorId<> &actor_id) {
   // TODO
 }
 
+inline bool Scheduler::is_overloaded() const {
+  return is_overloaded_;
+}
+
+inline void Scheduler::update_overload_state(int inbound_event_count) {
+  // the state changes only on a significant change of the load to avoid passing actors back and forth
+  if (inbound_event_count >= MIN_INBOUND_EVENTS_TO_OFFER) {
+    is_overloaded_ = true;
+  } else if (inbound_event_count <= MAX_INBOUND_EVENTS_TO_STOP_OFFER) {
+    is_overloaded_ = false;
+  }
+}
+
 inline void Scheduler::inc_wait_generation() {
   wait_generation_ += 2;
 }
@@ -202,22 +255,35 @@ void Scheduler::send_impl(const ActorId<> &actor_id, const RunFuncT &run_func, c
   bool on_current_sched = !is_migrating && sched_id_ == actor_sched_id;
   CHECK(has_guard_ || !on_current_sched);
 
-  if (likely(send_type == ActorSendType::Immediate && on_current_sched && !actor_info->is_running() &&
+  if (likely((send_type == ActorSendType::Immediate || send_type == ActorSendType::ImmediateUrgent) &&
+             on_current_sched && !actor_info->is_running() &&
              !actor_info->must_wait(wait_generation_))) {  // run immediately
     if (likely(actor_info->mailbox_.empty())) {
       EventGuard guard(this, actor_info);
-      run_func(actor_info);
+      if (unlikely(ActorStats::is_enabled())) {
+        auto start_time = Time::now();
+        auto start_counters = PerfCounters::get_thread_values();
+        run_func(actor_info);
+        actor_stats_->on_event(actor_info->get_name(), Time::now() - start_time,
+                               PerfCounters::get_thread_values() - start_counters);
+      } else {
+        run_func(actor_info);
+      }
     } else {
       flush_mailbox(actor_info, &run_func, &event_func);
     }
   } else {
+    auto event = event_func();
+    if (send_type == ActorSendType::ImmediateUrgent) {
+      event.set_urgent();
+    }
     if (on_current_sched) {
-      add_to_mailbox(actor_info, event_func());
+      add_to_mailbox(actor_info, std::move(event));
       if (send_type == ActorSendType::Later) {
         actor_info->set_wait_generation(wait_generation_);
       }
     } else {
-      send_to_scheduler(actor_sched_id, actor_id, event_func());
+      send_to_scheduler(actor_sched_id, actor_id, std::move(event));
     }
   }
 }
@@ -313,14 +379,14 @@ inline void Scheduler::cancel_actor_timeout(Actor *actor) {
 }
 
 inline bool Scheduler::has_actor_timeout(const ActorInfo *actor_info) const {
-  const HeapNode *heap_node = actor_info->get_heap_node();
-  return heap_node->in_heap();
+  const TimerWheelNode *timer_wheel_node = actor_info->get_timer_wheel_node();
+  return timer_wheel_node->in_timer_wheel();
 }
 
 inline void Scheduler::cancel_actor_timeout(ActorInfo *actor_info) {
-  HeapNode *heap_node = actor_info->get_heap_node();
-  if (heap_node->in_heap()) {
-    timeout_queue_.erase(heap_node);
+  TimerWheelNode *timer_wheel_node = actor_info->get_timer_wheel_node();
+  if (timer_wheel_node->in_timer_wheel()) {
+    timeout_queue_.erase(timer_wheel_node);
   }
 }
 
@@ -346,10 +412,12 @@ inline Timestamp Scheduler::run_events() {
   Timestamp res;
   VLOG(actor) << "Run events " << sched_id_ << " " << tag("pending", pending_events_.size())
               << tag("actors", actor_count_);
+  has_yielded_actors_ = false;
   do {
     run_mailbox();
     res = run_timeout();
-  } while (!ready_actors_list_.empty());
+    // if some actor has yielded, then events from other threads must be received before it is run again
+  } while ((!ready_actors_list_.empty() || !urgent_ready_actors_list_.empty()) && !has_yielded_actors_);
   return res;
 }
 
@@ -7,6 +7,8 @@
 #include "td/utils/tests.h"
 
 #include "td/actor/actor.h"
+#include "td/actor/ActorStats.h"
+#include "td/actor/Coroutine.h"
 #include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
 #include "td/actor/SleepActor.h"
@@ -14,7 +16,8 @@
 
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
-#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/misc.h"
+#include "td/utils/MpscLinkPollableQueue.h"
 #include "td/utils/Observer.h"
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/FileFd.h"
@@ -39,7 +42,7 @@ static StringBuilder sb(MutableSlice(buf, BUF_SIZE - 1));
 static StringBuilder sb2(MutableSlice(buf2, BUF_SIZE - 1));
 
 static auto create_queue() {
-  auto res = std::make_shared<MpscPollableQueue<EventFull>>();
+  auto res = std::make_shared<MpscLinkPollableQueue<EventFull>>();
   res->init();
   return res;
 }
@@ -510,6 +513,152 @@ TEST(Actors, later) {
   ASSERT_STREQ(sb.as_cslice().c_str(), "AAABBB");
 }
 
+class UrgentSlave : public Actor {
+ public:
+  void start_up() override {
+    sb << "S";
+  }
+  void on_event(char c) {
+    sb << c;
+  }
+  void finish() {
+    Scheduler::instance()->finish();
+    stop();
+  }
+};
+
+class UrgentMaster : public Actor {
+  void start_up() override {
+    auto slave = create_actor<UrgentSlave>("Slave").release();
+    for (int i = 0; i < 3; i++) {
+      send_closure_later(slave, &UrgentSlave::on_event, 'A');
+    }
+    for (int i = 0; i < 3; i++) {
+      send_closure_urgent(slave, &UrgentSlave::on_event, 'B');
+    }
+    send_closure_later(slave, &UrgentSlave::finish);
+    stop();
+  }
+};
+
+TEST(Actors, urgent_events) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  sb.clear();
+  ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  scheduler.create_actor_unsafe<UrgentMaster>(0, "A").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  ASSERT_STREQ(sb.as_cslice().c_str(), "SBBBAAA");
+}
+
+static int busy_event_count;
+
+class BusySlave : public Actor {
+ public:
+  void on_event() {
+    auto end_time = Time::now() + 0.001;
+    while (Time::now() < end_time) {
+    }
+    busy_event_count++;
+  }
+  void finish() {
+    Scheduler::instance()->finish();
+    stop();
+  }
+};
+
+class QuietSlave : public Actor {
+ public:
+  void on_event() {
+    sb << busy_event_count;
+    stop();
+  }
+};
+
+class BusyMaster : public Actor {
+  void start_up() override {
+    auto busy_slave = create_actor<BusySlave>("BusySlave").release();
+    auto quiet_slave = create_actor<QuietSlave>("QuietSlave").release();
+    for (int i = 0; i < 100; i++) {
+      send_closure_later(busy_slave, &BusySlave::on_event);
+    }
+    send_closure_later(quiet_slave, &QuietSlave::on_event);
+    send_closure_later(busy_slave, &BusySlave::finish);
+    stop();
+  }
+};
+
+TEST(Actors, busy_actor_yields) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  sb.clear();
+  busy_event_count = 0;
+  ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  scheduler.create_actor_unsafe<BusyMaster>(0, "A").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  ASSERT_EQ(100, busy_event_count);
+  // the quiet actor must not wait until all events of the busy actor are processed
+  ASSERT_TRUE(to_integer<int>(sb.as_cslice()) < 50);
+}
+
+static int wakeup_count;
+static int wakeup_count_before_change;
+static uint64 coalesced_wakeup_count;
+
+class WakeupCounter final : public Actor {
+ public:
+  void start_up() override {
+    for (int i = 0; i < 10; i++) {
+      send_closure_later(actor_id(this), &WakeupCounter::on_change);
+    }
+  }
+
+  void on_change() {
+    yield();
+  }
+
+  void on_last_change() {
+    wakeup_count_before_change = wakeup_count;
+  }
+
+  void wakeup() override {
+    wakeup_count++;
+    if (wakeup_count == 1) {
+      // wakeups separated by another event must not be merged
+      yield();
+      send_closure_later(actor_id(this), &WakeupCounter::on_last_change);
+      yield();
+    } else if (wakeup_count == 3) {
+      coalesced_wakeup_count = Scheduler::instance()->get_coalesced_wakeup_count();
+      Scheduler::instance()->finish();
+      stop();
+    }
+  }
+};
+
+TEST(Actors, coalesced_wakeups) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  wakeup_count = 0;
+  wakeup_count_before_change = 0;
+  coalesced_wakeup_count = 0;
+  ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  scheduler.create_actor_unsafe<WakeupCounter>(0, "A").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  ASSERT_EQ(3, wakeup_count);
+  ASSERT_EQ(2, wakeup_count_before_change);
+  ASSERT_EQ(9u, coalesced_wakeup_count);
+}
+
 class MultiPromise2 : public Actor {
  public:
   void start_up() override {
@@ -632,6 +781,44 @@ TEST(Actors, always_wait_for_mailbox) {
   scheduler.finish();
 }
 
+TEST(Actors, actor_stats) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  class Counter : public Actor {
+   public:
+    void inc(int left) {
+      if (left == 0) {
+        Scheduler::instance()->finish();
+        return;
+      }
+      send_closure_later(actor_id(this), &Counter::inc, left - 1);
+    }
+  };
+
+  ActorStats::set_enabled(true);
+  ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  auto counter = scheduler.create_actor_unsafe<Counter>(0, "StatsCounter").release();
+  scheduler.start();
+  {
+    auto guard = scheduler.get_main_guard();
+    send_closure(counter, &Counter::inc, 10);
+  }
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  ActorStats::set_enabled(false);
+
+  bool found = false;
+  for (auto &stat : ActorStats::get_all(true)) {
+    if (stat.name == "StatsCounter") {
+      found = true;
+      ASSERT_TRUE(stat.event_count >= 11);
+      ASSERT_TRUE(stat.total_time >= stat.max_event_time);
+    }
+  }
+  ASSERT_TRUE(found);
+}
+
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
 TEST(Actors, send_from_other_threads) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
@@ -669,3 +856,67 @@ TEST(Actors, send_from_other_threads) {
   scheduler.finish();
 }
 #endif
+
+#if TD_HAVE_COROUTINES
+TEST(Actors, coroutines) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  class Squarer : public Actor {
+   public:
+    void square(int x, Promise<int> promise) {
+      if (x < 0) {
+        return promise.set_error(Status::Error("Negative"));
+      }
+      promise.set_value(x * x);
+    }
+  };
+
+  class Main : public Actor {
+   public:
+    explicit Main(ActorId<Squarer> squarer) : squarer_(squarer) {
+    }
+
+   private:
+    ActorId<Squarer> squarer_;
+    int call_count_ = 0;
+
+    Task<int> get_sum_of_squares(int a, int b) {
+      auto r_a = co_await ask(squarer_, &Squarer::square, a);
+      call_count_++;
+      if (r_a.is_error()) {
+        co_return r_a.move_as_error();
+      }
+      auto r_b = co_await ask(squarer_, &Squarer::square, b);
+      call_count_++;
+      if (r_b.is_error()) {
+        co_return r_b.move_as_error();
+      }
+      co_return r_a.ok() + r_b.ok();
+    }
+
+    Task<Unit> run() {
+      auto r_sum = co_await get_sum_of_squares(3, 4);
+      CHECK(r_sum.ok() == 25);
+      r_sum = co_await get_sum_of_squares(-1, 4);
+      CHECK(r_sum.is_error());
+      CHECK(call_count_ == 3);
+      co_return Unit();
+    }
+
+    void start_up() override {
+      run().start(actor_id(this), PromiseCreator::lambda([](Result<Unit> result) {
+        CHECK(result.is_ok());
+        Scheduler::instance()->finish();
+      }));
+    }
+  };
+
+  ConcurrentScheduler scheduler;
+  scheduler.init(1);
+  auto squarer = scheduler.create_actor_unsafe<Squarer>(1, "Squarer").release();
+  scheduler.create_actor_unsafe<Main>(0, "Main", squarer).release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+}
+#endif
@@ -29,6 +29,13 @@ class PowerWorker final : public Actor {
     virtual void on_ready(int query, int res) = 0;
     virtual void on_closed() = 0;
   };
+  explicit PowerWorker(bool is_stealable = false) : is_stealable_(is_stealable) {
+  }
+  void start_up() override {
+    if (is_stealable_) {
+      allow_stealing();
+    }
+  }
   void set_callback(unique_ptr<Callback> callback) {
     callback_ = std::move(callback);
   }
@@ -46,6 +53,7 @@ class PowerWorker final : public Actor {
 
  private:
   unique_ptr<Callback> callback_;
+  bool is_stealable_;
 };
 
 class Manager final : public Actor {
@@ -110,16 +118,18 @@ class Manager final : public Actor {
   int query_size_;
 };
 
-void test_workers(int threads_n, int workers_n, int queries_n, int query_size) {
+void test_workers(int threads_n, int workers_n, int queries_n, int query_size, bool use_work_stealing = false) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
 
   ConcurrentScheduler sched;
-  sched.init(threads_n);
+  sched.init(threads_n, use_work_stealing);
 
   std::vector<ActorId<PowerWorker>> workers;
   for (int i = 0; i < workers_n; i++) {
-    int thread_id = threads_n ? i % (threads_n - 1) + 2 : 0;
-    workers.push_back(sched.create_actor_unsafe<PowerWorker>(thread_id, PSLICE() << "worker" << i).release());
+    // with work stealing all workers are created on the same scheduler and must be spread by idle schedulers
+    int thread_id = threads_n ? (use_work_stealing ? 2 : i % (threads_n - 1) + 2) : 0;
+    workers.push_back(
+        sched.create_actor_unsafe<PowerWorker>(thread_id, PSLICE() << "worker" << i, use_work_stealing).release());
   }
   sched.create_actor_unsafe<Manager>(threads_n ? 1 : 0, "Manager", queries_n, query_size, std::move(workers)).release();
 
@@ -156,3 +166,11 @@ TEST(Actors, workers_small_query_two_threads) {
 TEST(Actors, workers_small_query_nine_threads) {
   test_workers(9, 10, 1000000, 1);
 }
+
+TEST(Actors, workers_big_query_work_stealing) {
+  test_workers(4, 10, 1000, 300000, true);
+}
+
+TEST(Actors, workers_small_query_work_stealing) {
+  test_workers(4, 100, 1000000, 1, true);
+}
@@ -13,9 +13,11 @@
 
 namespace td {
 
-SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version)
+SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version,
+                                           SqliteDb::PerformanceSettings performance_settings)
     : path_(std::move(path))
-    , lsls_connection_([path = path_, key = std::move(key), cipher_version = std::move(cipher_version)] {
+    , lsls_connection_([path = path_, key = std::move(key), cipher_version = std::move(cipher_version),
+                        performance_settings] {
       auto r_db = SqliteDb::open_with_key(path, key, cipher_version.copy());
       if (r_db.is_error()) {
         auto r_stat = stat(path);
@@ -28,7 +30,7 @@ SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int3
       auto db = r_db.move_as_ok();
       db.exec("PRAGMA synchronous=NORMAL").ensure();
       db.exec("PRAGMA temp_store=MEMORY").ensure();
-      db.exec("PRAGMA secure_delete=1").ensure();
+      db.apply_performance_settings(performance_settings).ensure();
       db.exec("PRAGMA recursive_triggers=1").ensure();
       return db;
     }) {
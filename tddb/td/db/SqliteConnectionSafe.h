@@ -19,7 +19,8 @@ namespace td {
 class SqliteConnectionSafe {
  public:
   SqliteConnectionSafe() = default;
-  explicit SqliteConnectionSafe(string path, DbKey key = DbKey::empty(), optional<int32> cipher_version = {});
+  explicit SqliteConnectionSafe(string path, DbKey key = DbKey::empty(), optional<int32> cipher_version = {},
+                                SqliteDb::PerformanceSettings performance_settings = {});
 
   SqliteDb &get();
   void set(SqliteDb &&db);
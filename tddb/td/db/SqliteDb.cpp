@@ -135,6 +135,43 @@ Result<string> SqliteDb::get_pragma_string(Slice name) {
   return std::move(res);
 }
 
+Result<int64> SqliteDb::get_pragma_int64(Slice name) {
+  TRY_RESULT(stmt, get_statement(PSLICE() << "PRAGMA " << name));
+  TRY_STATUS(stmt.step());
+  CHECK(stmt.has_row());
+  auto res = stmt.view_int64(0);
+  TRY_STATUS(stmt.step());
+  CHECK(!stmt.can_step());
+  return res;
+}
+
+Status SqliteDb::apply_performance_settings(const PerformanceSettings &settings) {
+  // negative cache_size is measured in KiB instead of pages
+  TRY_STATUS(exec(PSLICE() << "PRAGMA cache_size=" << -static_cast<int64>(settings.cache_size_kb)));
+  TRY_STATUS(exec(PSLICE() << "PRAGMA mmap_size=" << settings.mmap_size));
+  TRY_STATUS(exec(PSLICE() << "PRAGMA secure_delete=" << (settings.secure_delete ? 1 : 0)));
+  TRY_STATUS(exec(PSLICE() << "PRAGMA wal_autocheckpoint=" << settings.wal_autocheckpoint));
+  return Status::OK();
+}
+
+Result<SqliteDb::CheckpointResult> SqliteDb::wal_checkpoint(Slice mode) {
+  TRY_RESULT(stmt, get_statement(PSLICE() << "PRAGMA wal_checkpoint(" << mode << ")"));
+  TRY_STATUS(stmt.step());
+  if (!stmt.has_row()) {
+    return Status::Error(PSLICE() << "PRAGMA wal_checkpoint failed for database \"" << raw_->path() << '"');
+  }
+  CheckpointResult result;
+  result.is_busy = stmt.view_int32(0) != 0;
+  result.wal_frame_count = stmt.view_int32(1);
+  result.checkpointed_frame_count = stmt.view_int32(2);
+  return result;
+}
+
+Status SqliteDb::incremental_vacuum(int32 max_page_count) {
+  CHECK(max_page_count > 0);
+  return exec(PSLICE() << "PRAGMA incremental_vacuum(" << max_page_count << ")");
+}
+
 Result<int32> SqliteDb::user_version() {
   TRY_RESULT(get_version_stmt, get_statement("PRAGMA user_version"));
   TRY_STATUS(get_version_stmt.step());
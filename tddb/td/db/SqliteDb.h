@@ -47,20 +47,46 @@ class SqliteDb {
     *this = SqliteDb();
   }
 
+  struct PerformanceSettings {
+    int32 cache_size_kb = 2000;
+    int64 mmap_size = 0;
+    bool secure_delete = true;
+    // 0 disables automatic checkpoints, so the WAL must be checkpointed by someone else
+    int32 wal_autocheckpoint = 1000;
+  };
+
   Status init(CSlice path, bool *was_created = nullptr) TD_WARN_UNUSED_RESULT;
   Status exec(CSlice cmd) TD_WARN_UNUSED_RESULT;
   Result<bool> has_table(Slice table);
   Result<string> get_pragma(Slice name);
   Result<string> get_pragma_string(Slice name);
+  Result<int64> get_pragma_int64(Slice name);
   Status begin_transaction() TD_WARN_UNUSED_RESULT;
   Status commit_transaction() TD_WARN_UNUSED_RESULT;
 
+  Status apply_performance_settings(const PerformanceSettings &settings) TD_WARN_UNUSED_RESULT;
+
+  struct CheckpointResult {
+    bool is_busy = false;
+    int32 wal_frame_count = 0;
+    int32 checkpointed_frame_count = 0;
+  };
+  // mode is one of PASSIVE, FULL, RESTART or TRUNCATE
+  Result<CheckpointResult> wal_checkpoint(Slice mode);
+
+  // returns at most max_page_count free pages to the file system; works only with auto_vacuum=INCREMENTAL
+  Status incremental_vacuum(int32 max_page_count) TD_WARN_UNUSED_RESULT;
+
   Result<int32> user_version();
   Status set_user_version(int32 version) TD_WARN_UNUSED_RESULT;
   void trace(bool flag);
 
   static Status destroy(Slice path) TD_WARN_UNUSED_RESULT;
 
+  static int64 get_total_cache_size() {
+    return detail::RawSqliteDb::get_total_cache_size();
+  }
+
   // Anyway we can't change the key on the fly, so having static functions is more than enough
   static Result<SqliteDb> open_with_key(CSlice path, const DbKey &db_key, optional<int32> cipher_version = {});
   static Result<SqliteDb> change_key(CSlice path, const DbKey &new_db_key, const DbKey &old_db_key);
@@ -47,6 +47,25 @@ Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_na
   TRY_RESULT_ASSIGN(get_by_prefix_rare_stmt_,
                     db_.get_statement(PSLICE() << "SELECT k, v FROM " << table_name_ << " WHERE ?1 <= k"));
 
+  string get_batch_query = PSTRING() << "SELECT k, v FROM " << table_name_ << " WHERE k IN (";
+  string set_batch_query = PSTRING() << "REPLACE INTO " << table_name_ << " (k, v) VALUES ";
+  string erase_batch_query = PSTRING() << "DELETE FROM " << table_name_ << " WHERE k IN (";
+  for (size_t i = 0; i < BATCH_SIZE; i++) {
+    if (i != 0) {
+      get_batch_query += ", ";
+      set_batch_query += ", ";
+      erase_batch_query += ", ";
+    }
+    set_batch_query += PSTRING() << "(?" << 2 * i + 1 << ", ?" << 2 * i + 2 << ')';
+    get_batch_query += PSTRING() << '?' << i + 1;
+    erase_batch_query += PSTRING() << '?' << i + 1;
+  }
+  get_batch_query += ')';
+  erase_batch_query += ')';
+  TRY_RESULT_ASSIGN(get_batch_stmt_, db_.get_statement(get_batch_query));
+  TRY_RESULT_ASSIGN(set_batch_stmt_, db_.get_statement(set_batch_query));
+  TRY_RESULT_ASSIGN(erase_batch_stmt_, db_.get_statement(erase_batch_query));
+
   init_guard.dismiss();
   return Status::OK();
 }
@@ -87,6 +106,34 @@ string SqliteKeyValue::get(Slice key) {
   return data;
 }
 
+vector<string> SqliteKeyValue::get_batch(const vector<Slice> &keys) {
+  vector<string> result(keys.size());
+  size_t pos = 0;
+  for (; pos + BATCH_SIZE <= keys.size(); pos += BATCH_SIZE) {
+    SCOPE_EXIT {
+      get_batch_stmt_.reset();
+    };
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+      get_batch_stmt_.bind_blob(static_cast<int>(i + 1), keys[pos + i]).ensure();
+    }
+    get_batch_stmt_.step().ensure();
+    while (get_batch_stmt_.has_row()) {
+      // rows are returned in an arbitrary order, so the key must be matched with the requested keys
+      auto key = get_batch_stmt_.view_blob(0);
+      for (size_t i = 0; i < BATCH_SIZE; i++) {
+        if (keys[pos + i] == key) {
+          result[pos + i] = get_batch_stmt_.view_blob(1).str();
+        }
+      }
+      get_batch_stmt_.step().ensure();
+    }
+  }
+  for (; pos < keys.size(); pos++) {
+    result[pos] = get(keys[pos]);
+  }
+  return result;
+}
+
 SqliteKeyValue::SeqNo SqliteKeyValue::erase(Slice key) {
   erase_stmt_.bind_blob(1, key).ensure();
   erase_stmt_.step().ensure();
@@ -94,6 +141,38 @@ SqliteKeyValue::SeqNo SqliteKeyValue::erase(Slice key) {
   return 0;
 }
 
+void SqliteKeyValue::set_batch(const vector<std::pair<Slice, Slice>> &key_values) {
+  size_t pos = 0;
+  for (; pos + BATCH_SIZE <= key_values.size(); pos += BATCH_SIZE) {
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+      set_batch_stmt_.bind_blob(static_cast<int>(2 * i + 1), key_values[pos + i].first).ensure();
+      set_batch_stmt_.bind_blob(static_cast<int>(2 * i + 2), key_values[pos + i].second).ensure();
+    }
+    auto status = set_batch_stmt_.step();
+    if (status.is_error()) {
+      LOG(FATAL) << "Failed to set keys: " << status;
+    }
+    set_batch_stmt_.reset();
+  }
+  for (; pos < key_values.size(); pos++) {
+    set(key_values[pos].first, key_values[pos].second);
+  }
+}
+
+void SqliteKeyValue::erase_batch(const vector<Slice> &keys) {
+  size_t pos = 0;
+  for (; pos + BATCH_SIZE <= keys.size(); pos += BATCH_SIZE) {
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+      erase_batch_stmt_.bind_blob(static_cast<int>(i + 1), keys[pos + i]).ensure();
+    }
+    erase_batch_stmt_.step().ensure();
+    erase_batch_stmt_.reset();
+  }
+  for (; pos < keys.size(); pos++) {
+    erase(keys[pos]);
+  }
+}
+
 void SqliteKeyValue::erase_by_prefix(Slice prefix) {
   auto next = next_prefix(prefix);
   if (next.empty()) {
@@ -9,11 +9,13 @@
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteStatement.h"
 
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
 #include <unordered_map>
+#include <utility>
 
 namespace td {
 
@@ -51,8 +53,16 @@ class SqliteKeyValue {
 
   string get(Slice key);
 
+  // returns values in the order of the keys; values of missing keys are empty
+  vector<string> get_batch(const vector<Slice> &keys);
+
   SeqNo erase(Slice key);
 
+  // keys must be unique
+  void set_batch(const vector<std::pair<Slice, Slice>> &key_values);
+
+  void erase_batch(const vector<Slice> &keys);
+
   Status begin_transaction() TD_WARN_UNUSED_RESULT {
     return db_.begin_transaction();
   }
@@ -117,6 +127,12 @@ class SqliteKeyValue {
   SqliteStatement erase_by_prefix_rare_stmt_;
   SqliteStatement get_by_prefix_stmt_;
   SqliteStatement get_by_prefix_rare_stmt_;
+  SqliteStatement get_batch_stmt_;
+  SqliteStatement set_batch_stmt_;
+  SqliteStatement erase_batch_stmt_;
+
+  // number of rows in a single batch statement
+  static constexpr size_t BATCH_SIZE = 32;
 
   string next_prefix(Slice prefix);
 };
@@ -14,14 +14,18 @@
 #include "td/utils/optional.h"
 #include "td/utils/Time.h"
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 
 namespace td {
 
 class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
  public:
-  explicit SqliteKeyValueAsync(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int32 scheduler_id = -1) {
-    impl_ = create_actor_on_scheduler<Impl>("KV", scheduler_id, std::move(kv_safe));
+  explicit SqliteKeyValueAsync(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int32 scheduler_id = -1)
+      : counters_(std::make_shared<Counters>()) {
+    impl_ = create_actor_on_scheduler<Impl>("KV", scheduler_id, std::move(kv_safe), counters_);
   }
   void set(string key, string value, Promise<> promise) override {
     send_closure_later(impl_, &Impl::set, std::move(key), std::move(value), std::move(promise));
@@ -35,40 +39,44 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
   void get(string key, Promise<string> promise) override {
     send_closure_later(impl_, &Impl::get, std::move(key), std::move(promise));
   }
+  void get_batch(vector<string> keys, Promise<vector<string>> promise) override {
+    send_closure_later(impl_, &Impl::get_batch, std::move(keys), std::move(promise));
+  }
   void close(Promise<> promise) override {
     send_closure_later(impl_, &Impl::close, std::move(promise));
   }
+  Stats get_stats() const override {
+    Stats stats;
+    stats.write_count = counters_->write_count.load(std::memory_order_relaxed);
+    stats.coalesced_write_count = counters_->coalesced_write_count.load(std::memory_order_relaxed);
+    stats.flush_count = counters_->flush_count.load(std::memory_order_relaxed);
+    stats.flushed_key_count = counters_->flushed_key_count.load(std::memory_order_relaxed);
+    return stats;
+  }
 
  private:
+  // are changed only by Impl
+  struct Counters {
+    std::atomic<uint64> write_count{0};
+    std::atomic<uint64> coalesced_write_count{0};
+    std::atomic<uint64> flush_count{0};
+    std::atomic<uint64> flushed_key_count{0};
+
+    static void inc(std::atomic<uint64> &counter, uint64 value = 1) {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+  };
+
   class Impl : public Actor {
    public:
-    explicit Impl(std::shared_ptr<SqliteKeyValueSafe> kv_safe) : kv_safe_(std::move(kv_safe)) {
+    Impl(std::shared_ptr<SqliteKeyValueSafe> kv_safe, std::shared_ptr<Counters> counters)
+        : kv_safe_(std::move(kv_safe)), counters_(std::move(counters)) {
     }
     void set(string key, string value, Promise<> promise) {
-      auto it = buffer_.find(key);
-      if (it != buffer_.end()) {
-        it->second = std::move(value);
-      } else {
-        buffer_.emplace(std::move(key), std::move(value));
-      }
-      if (promise) {
-        buffer_promises_.push_back(std::move(promise));
-      }
-      cnt_++;
-      do_flush(false /*force*/);
+      add_value(std::move(key), std::move(value), std::move(promise));
     }
     void erase(string key, Promise<> promise) {
-      auto it = buffer_.find(key);
-      if (it != buffer_.end()) {
-        it->second = optional<string>();
-      } else {
-        buffer_.emplace(std::move(key), optional<string>());
-      }
-      if (promise) {
-        buffer_promises_.push_back(std::move(promise));
-      }
-      cnt_++;
-      do_flush(false /*force*/);
+      add_value(std::move(key), optional<string>(), std::move(promise));
     }
     void erase_by_prefix(string key_prefix, Promise<> promise) {
       do_flush(true /*force*/);
@@ -83,6 +91,27 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
       }
       promise.set_value(kv_->get(key));
     }
+    void get_batch(const vector<string> &keys, Promise<vector<string>> promise) {
+      vector<Slice> database_keys;
+      vector<size_t> database_key_positions;
+      vector<string> result(keys.size());
+      for (size_t i = 0; i < keys.size(); i++) {
+        auto it = buffer_.find(keys[i]);
+        if (it != buffer_.end()) {
+          if (it->second) {
+            result[i] = it->second.value();
+          }
+        } else {
+          database_keys.push_back(keys[i]);
+          database_key_positions.push_back(i);
+        }
+      }
+      auto values = kv_->get_batch(database_keys);
+      for (size_t i = 0; i < values.size(); i++) {
+        result[database_key_positions[i]] = std::move(values[i]);
+      }
+      promise.set_value(std::move(result));
+    }
     void close(Promise<> promise) {
       do_flush(true /*force*/);
       kv_safe_.reset();
@@ -93,15 +122,42 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
 
    private:
     std::shared_ptr<SqliteKeyValueSafe> kv_safe_;
+    std::shared_ptr<Counters> counters_;
     SqliteKeyValue *kv_ = nullptr;
 
     static constexpr double MAX_PENDING_QUERIES_DELAY = 0.01;
     static constexpr size_t MAX_PENDING_QUERIES_COUNT = 100;
+    static constexpr size_t MAX_PENDING_QUERIES_SIZE = 1 << 20;
     std::unordered_map<string, optional<string>> buffer_;
     std::vector<Promise<>> buffer_promises_;
     size_t cnt_ = 0;
+    size_t buffer_size_ = 0;
 
     double wakeup_at_ = 0;
+
+    static size_t get_value_size(const optional<string> &value) {
+      return value ? value.value().size() : 0;
+    }
+
+    void add_value(string key, optional<string> value, Promise<> promise) {
+      Counters::inc(counters_->write_count);
+      auto it = buffer_.find(key);
+      if (it != buffer_.end()) {
+        Counters::inc(counters_->coalesced_write_count);
+        buffer_size_ -= get_value_size(it->second);
+        buffer_size_ += get_value_size(value);
+        it->second = std::move(value);
+      } else {
+        buffer_size_ += key.size() + get_value_size(value);
+        buffer_.emplace(std::move(key), std::move(value));
+      }
+      if (promise) {
+        buffer_promises_.push_back(std::move(promise));
+      }
+      cnt_++;
+      do_flush(false /*force*/);
+    }
+
     void do_flush(bool force) {
       if (buffer_.empty()) {
         return;
@@ -112,7 +168,7 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
         if (wakeup_at_ == 0) {
           wakeup_at_ = now + MAX_PENDING_QUERIES_DELAY;
         }
-        if (now < wakeup_at_ && cnt_ < MAX_PENDING_QUERIES_COUNT) {
+        if (now < wakeup_at_ && cnt_ < MAX_PENDING_QUERIES_COUNT && buffer_size_ < MAX_PENDING_QUERIES_SIZE) {
           set_timeout_at(wakeup_at_);
           return;
         }
@@ -120,16 +176,24 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
 
       wakeup_at_ = 0;
       cnt_ = 0;
+      buffer_size_ = 0;
 
-      kv_->begin_transaction().ensure();
+      vector<std::pair<Slice, Slice>> key_values;
+      vector<Slice> erased_keys;
       for (auto &it : buffer_) {
         if (it.second) {
-          kv_->set(it.first, it.second.value());
+          key_values.emplace_back(it.first, it.second.value());
         } else {
-          kv_->erase(it.first);
+          erased_keys.emplace_back(it.first);
         }
       }
+
+      kv_->begin_transaction().ensure();
+      kv_->set_batch(key_values);
+      kv_->erase_batch(erased_keys);
       kv_->commit_transaction().ensure();
+      Counters::inc(counters_->flush_count);
+      Counters::inc(counters_->flushed_key_count, buffer_.size());
       buffer_.clear();
       for (auto &promise : buffer_promises_) {
         promise.set_value(Unit());
@@ -143,8 +207,15 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
 
     void start_up() override {
       kv_ = &kv_safe_->get();
+      allow_stealing();
+    }
+
+    void on_finish_migrate() override {
+      // database connections are scheduler-local
+      kv_ = &kv_safe_->get();
     }
   };
+  std::shared_ptr<Counters> counters_;
   ActorOwn<Impl> impl_;
 };
 
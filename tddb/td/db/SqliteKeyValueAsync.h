@@ -23,7 +23,18 @@ class SqliteKeyValueAsyncInterface {
   virtual void erase_by_prefix(string key_prefix, Promise<> promise) = 0;
 
   virtual void get(string key, Promise<string> promise) = 0;
+  // returns values in the order of the keys; values of missing keys are empty
+  virtual void get_batch(vector<string> keys, Promise<vector<string>> promise) = 0;
   virtual void close(Promise<> promise) = 0;
+
+  struct Stats {
+    uint64 write_count = 0;            // number of received set and erase requests
+    uint64 coalesced_write_count = 0;  // number of requests, replaced by a later request for the same key
+    uint64 flush_count = 0;            // number of transactions
+    uint64 flushed_key_count = 0;      // number of keys written to the database
+  };
+  // may be called from any thread
+  virtual Stats get_stats() const = 0;
 };
 
 unique_ptr<SqliteKeyValueAsyncInterface> create_sqlite_key_value_async(std::shared_ptr<SqliteKeyValueSafe> kv,
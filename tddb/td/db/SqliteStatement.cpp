@@ -10,14 +10,41 @@
 #include "td/utils/logging.h"
 #include "td/utils/StackAllocator.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
+#include "td/utils/TraceLog.h"
 
 #include "sqlite/sqlite3.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
 namespace td {
 
 int VERBOSITY_NAME(sqlite) = VERBOSITY_NAME(DEBUG) + 10;
 
 namespace {
+std::atomic<bool> is_profiling_enabled{false};
+std::atomic<double> slow_query_threshold{0.0};
+
+struct ProfilingRegistry {
+  std::mutex mutex;
+  std::unordered_map<string, SqliteStatement::ProfilingStat> stats;
+};
+
+ProfilingRegistry &get_profiling_registry() {
+  static ProfilingRegistry registry;
+  return registry;
+}
+
+int64 get_cache_miss_count(sqlite3_stmt *stmt) {
+  int current = 0;
+  int highwater = 0;
+  sqlite3_db_status(sqlite3_db_handle(stmt), SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 0);
+  return current;
+}
+
 int printExplainQueryPlan(StringBuilder &sb, sqlite3_stmt *pStmt) {
   const char *zSql = sqlite3_sql(pStmt);
   if (zSql == nullptr) {
@@ -170,6 +197,9 @@ SqliteStatement::Datatype SqliteStatement::view_datatype(int id) {
 }
 
 void SqliteStatement::reset() {
+  if (execution_.is_active) {
+    finish_execution();
+  }
   sqlite3_reset(stmt_.get());
   state_ = State::Start;
 }
@@ -180,7 +210,29 @@ Status SqliteStatement::step() {
   }
   VLOG(sqlite) << "Start step " << tag("query", sqlite3_sql(stmt_.get())) << tag("statement", stmt_.get())
                << tag("database", db_.get());
+  uint32 trace_name_id = 0;
+  if (unlikely(TraceLog::is_enabled())) {
+    trace_name_id = TraceLog::get_name_id(Slice(sqlite3_sql(stmt_.get())));
+    TraceLog::add_event(TraceLog::EventType::DbOperationBegin, trace_name_id, reinterpret_cast<uint64>(stmt_.get()));
+  }
+  bool need_profiling = is_profiling_enabled.load(std::memory_order_relaxed);
+  double start_time = 0;
+  int64 start_cache_miss_count = 0;
+  if (unlikely(need_profiling)) {
+    start_time = Time::now();
+    start_cache_miss_count = get_cache_miss_count(stmt_.get());
+  }
   auto rc = sqlite3_step(stmt_.get());
+  if (unlikely(trace_name_id != 0)) {
+    TraceLog::add_event(TraceLog::EventType::DbOperationEnd, trace_name_id, reinterpret_cast<uint64>(stmt_.get()));
+  }
+  if (unlikely(need_profiling)) {
+    execution_.is_active = true;
+    if (rc == SQLITE_ROW) {
+      execution_.row_count++;
+    }
+    on_step_finished(Time::now() - start_time, get_cache_miss_count(stmt_.get()) - start_cache_miss_count);
+  }
   VLOG(sqlite) << "Finish step " << tag("query", sqlite3_sql(stmt_.get())) << tag("statement", stmt_.get())
                << tag("database", db_.get());
   if (rc == SQLITE_ROW) {
@@ -189,6 +241,9 @@ Status SqliteStatement::step() {
   }
 
   state_ = State::Finish;
+  if (execution_.is_active) {
+    finish_execution();
+  }
   if (rc == SQLITE_DONE) {
     return Status::OK();
   }
@@ -203,4 +258,69 @@ Status SqliteStatement::last_error() {
   return db_->last_error();
 }
 
+void SqliteStatement::on_step_finished(double step_time, int64 cache_miss_count) {
+  execution_.time += step_time;
+  execution_.cache_miss_count += cache_miss_count;
+
+  auto threshold = slow_query_threshold.load(std::memory_order_relaxed);
+  if (threshold > 0 && execution_.time > threshold && !execution_.is_logged) {
+    // bound parameters must be read before the statement is reset, because they may be destroyed after that
+    execution_.is_logged = true;
+    constexpr size_t MAX_LOGGED_SQL_SIZE = 1 << 12;
+    char *expanded_sql = sqlite3_expanded_sql(stmt_.get());
+    Slice sql = expanded_sql != nullptr ? Slice(expanded_sql) : Slice(sqlite3_sql(stmt_.get()));
+    bool is_truncated = sql.size() > MAX_LOGGED_SQL_SIZE;
+    LOG(WARNING) << "SLOW SQLite query: " << tag("time", format::as_time(execution_.time))
+                 << tag("rows", execution_.row_count) << tag("cache misses", execution_.cache_miss_count) << ' '
+                 << sql.substr(0, MAX_LOGGED_SQL_SIZE) << (is_truncated ? "..." : "");
+    sqlite3_free(expanded_sql);
+  }
+}
+
+void SqliteStatement::finish_execution() {
+  auto *stmt = stmt_.get();
+  auto full_scan_step_count = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+  auto sort_count = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+  auto auto_index_count = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+
+  {
+    auto &registry = get_profiling_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto &stat = registry.stats[sqlite3_sql(stmt)];
+    stat.execution_count++;
+    stat.row_count += execution_.row_count;
+    stat.total_time += execution_.time;
+    stat.max_time = td::max(stat.max_time, execution_.time);
+    stat.cache_miss_count += execution_.cache_miss_count;
+    stat.full_scan_step_count += full_scan_step_count;
+    stat.sort_count += sort_count;
+    stat.auto_index_count += auto_index_count;
+  }
+  execution_ = Execution();
+}
+
+void SqliteStatement::set_profiling_enabled(bool is_enabled, double new_slow_query_threshold) {
+  slow_query_threshold.store(is_enabled ? new_slow_query_threshold : 0.0, std::memory_order_relaxed);
+  is_profiling_enabled.store(is_enabled, std::memory_order_relaxed);
+}
+
+vector<SqliteStatement::ProfilingStat> SqliteStatement::get_profiling_stats(bool reset) {
+  vector<ProfilingStat> result;
+  {
+    auto &registry = get_profiling_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    result.reserve(registry.stats.size());
+    for (auto &it : registry.stats) {
+      result.push_back(it.second);
+      result.back().sql = it.first;
+    }
+    if (reset) {
+      registry.stats.clear();
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const ProfilingStat &lhs, const ProfilingStat &rhs) { return lhs.total_time > rhs.total_time; });
+  return result;
+}
+
 }  // namespace td
@@ -67,6 +67,25 @@ class SqliteStatement {
 
   // TODO get row
 
+  struct ProfilingStat {
+    string sql;
+    int64 execution_count = 0;
+    int64 row_count = 0;
+    double total_time = 0;
+    double max_time = 0;
+    int64 cache_miss_count = 0;
+    int64 full_scan_step_count = 0;
+    int64 sort_count = 0;
+    int64 auto_index_count = 0;
+  };
+
+  // enables collection of statistics of all executed statements, which are merged by their SQL text
+  // if slow_query_threshold is positive, slower executions are logged together with bound parameters
+  static void set_profiling_enabled(bool is_enabled, double slow_query_threshold);
+
+  // returns statistics sorted by total execution time
+  static vector<ProfilingStat> get_profiling_stats(bool reset);
+
  private:
   friend class SqliteDb;
   SqliteStatement(sqlite3_stmt *stmt, std::shared_ptr<detail::RawSqliteDb> db);
@@ -82,7 +101,20 @@ class SqliteStatement {
   std::unique_ptr<sqlite3_stmt, StmtDeleter> stmt_;
   std::shared_ptr<detail::RawSqliteDb> db_;
 
+  // the current execution, which lasts from the first step after reset to the last step or to the next reset
+  struct Execution {
+    bool is_active = false;
+    bool is_logged = false;
+    int64 row_count = 0;
+    double time = 0;
+    int64 cache_miss_count = 0;
+  };
+  Execution execution_;
+
   Status last_error();
+
+  void on_step_finished(double step_time, int64 cache_miss_count);
+  void finish_execution();
 };
 
 }  // namespace td
@@ -0,0 +1,164 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteWalCheckpointer.h"
+
+#include "td/db/SqliteDb.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/Status.h"
+#include "td/utils/Time.h"
+
+namespace td {
+
+void SqliteWalCheckpointer::start_up() {
+  next_truncate_time_ = Time::now() + TRUNCATE_PERIOD;
+  set_timeout_in(checkpoint_period_);
+
+  // auto_vacuum mode of an existing database can be changed only by a full VACUUM, which isn't done online
+  auto r_auto_vacuum = connection_->get().get_pragma_int64("auto_vacuum");
+  if (r_auto_vacuum.is_error()) {
+    LOG(WARNING) << "Failed to get auto_vacuum mode: " << r_auto_vacuum.error();
+  } else {
+    is_incremental_vacuum_enabled_ = r_auto_vacuum.ok() == 2;
+  }
+}
+
+void SqliteWalCheckpointer::timeout_expired() {
+  set_timeout_in(checkpoint_period_);
+  if (connection_ == nullptr) {
+    return;
+  }
+
+  auto &db = connection_->get();
+  // PASSIVE checkpoint never blocks readers and writers; TRUNCATE is used rarely to return WAL file space
+  bool need_truncate = Time::now() >= next_truncate_time_;
+  auto r_result = db.wal_checkpoint(need_truncate ? Slice("TRUNCATE") : Slice("PASSIVE"));
+  if (r_result.is_error()) {
+    LOG(WARNING) << "Failed to checkpoint database: " << r_result.error();
+    return;
+  }
+  auto result = r_result.move_as_ok();
+  if (need_truncate && !result.is_busy) {
+    next_truncate_time_ = Time::now() + TRUNCATE_PERIOD;
+  }
+  LOG(DEBUG) << "Checkpoint " << result.checkpointed_frame_count << " out of " << result.wal_frame_count
+             << " WAL frames" << (result.is_busy ? " with busy database" : "");
+
+  // the database is idle if nothing was written to the WAL since the previous checkpoint
+  bool is_idle = !result.is_busy && result.wal_frame_count == last_wal_frame_count_;
+  last_wal_frame_count_ = result.wal_frame_count;
+  if (is_idle && is_incremental_vacuum_enabled_ && !compact_promise_) {
+    on_idle();
+  }
+}
+
+void SqliteWalCheckpointer::on_idle() {
+  auto &db = connection_->get();
+  auto r_free_page_count = db.get_pragma_int64("freelist_count");
+  if (r_free_page_count.is_error()) {
+    LOG(WARNING) << "Failed to get number of free pages: " << r_free_page_count.error();
+    return;
+  }
+  if (r_free_page_count.ok() < MIN_IDLE_VACUUM_FREE_PAGE_COUNT) {
+    return;
+  }
+
+  auto status = db.incremental_vacuum(IDLE_VACUUM_PAGE_COUNT);
+  if (status.is_error()) {
+    LOG(WARNING) << "Failed to vacuum database: " << status;
+    return;
+  }
+  LOG(DEBUG) << "Reclaim up to " << IDLE_VACUUM_PAGE_COUNT << " out of " << r_free_page_count.ok() << " free pages";
+
+  // the vacuum has written to the WAL itself, which must not be treated as an activity of other connections
+  auto r_result = db.wal_checkpoint("PASSIVE");
+  if (r_result.is_ok()) {
+    last_wal_frame_count_ = r_result.ok().wal_frame_count;
+  }
+}
+
+void SqliteWalCheckpointer::compact(std::function<void(int64, int64)> on_progress, Promise<> promise) {
+  if (connection_ == nullptr) {
+    return promise.set_error(Status::Error(500, "Request aborted"));
+  }
+  if (!is_incremental_vacuum_enabled_) {
+    return promise.set_error(Status::Error(400, "Database doesn't support incremental vacuum"));
+  }
+  if (compact_promise_) {
+    return promise.set_error(Status::Error(400, "Database compaction is already in progress"));
+  }
+
+  auto &db = connection_->get();
+  TRY_RESULT_PROMISE(promise, page_size, db.get_pragma_int64("page_size"));
+  TRY_RESULT_PROMISE(promise, free_page_count, db.get_pragma_int64("freelist_count"));
+  compact_promise_ = std::move(promise);
+  on_compact_progress_ = std::move(on_progress);
+  compact_page_size_ = page_size;
+  compact_total_page_count_ = free_page_count;
+  loop();
+}
+
+void SqliteWalCheckpointer::loop() {
+  if (!compact_promise_) {
+    return;
+  }
+
+  // reclaim pages in slices to let other connections write between them
+  auto &db = connection_->get();
+  auto status = db.incremental_vacuum(COMPACT_VACUUM_PAGE_COUNT);
+  if (status.is_error()) {
+    return on_compact_finished(std::move(status));
+  }
+  auto r_free_page_count = db.get_pragma_int64("freelist_count");
+  if (r_free_page_count.is_error()) {
+    return on_compact_finished(r_free_page_count.move_as_error());
+  }
+  auto free_page_count = r_free_page_count.ok();
+  if (free_page_count > compact_total_page_count_) {
+    // some pages were freed by other connections
+    compact_total_page_count_ = free_page_count;
+  }
+  on_compact_progress_((compact_total_page_count_ - free_page_count) * compact_page_size_,
+                       compact_total_page_count_ * compact_page_size_);
+
+  if (free_page_count == 0) {
+    // also return the space taken by the WAL
+    auto r_result = db.wal_checkpoint("TRUNCATE");
+    if (r_result.is_ok()) {
+      last_wal_frame_count_ = r_result.ok().wal_frame_count;
+    }
+    return on_compact_finished(Status::OK());
+  }
+
+  auto r_result = db.wal_checkpoint("PASSIVE");
+  if (r_result.is_ok()) {
+    last_wal_frame_count_ = r_result.ok().wal_frame_count;
+  }
+  yield();
+}
+
+void SqliteWalCheckpointer::on_compact_finished(Status status) {
+  on_compact_progress_ = nullptr;
+  auto promise = std::move(compact_promise_);
+  if (status.is_error()) {
+    LOG(WARNING) << "Failed to compact database: " << status;
+    promise.set_error(std::move(status));
+  } else {
+    promise.set_value(Unit());
+  }
+}
+
+void SqliteWalCheckpointer::close(Promise<> promise) {
+  if (compact_promise_) {
+    on_compact_finished(Status::Error(500, "Request aborted"));
+  }
+  connection_.reset();
+  promise.set_value(Unit());
+  stop();
+}
+
+}  // namespace td
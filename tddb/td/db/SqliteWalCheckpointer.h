@@ -0,0 +1,62 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/SqliteConnectionSafe.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+
+#include <functional>
+#include <memory>
+
+namespace td {
+
+// Checkpoints WAL of the database through its own connection, so writers don't stall on automatic checkpoints.
+// Also returns free pages of databases with auto_vacuum=INCREMENTAL to the file system in small slices,
+// while there are no writes to the database.
+// Should be created on a scheduler different from the scheduler of writers.
+class SqliteWalCheckpointer : public Actor {
+ public:
+  SqliteWalCheckpointer(std::shared_ptr<SqliteConnectionSafe> connection, double checkpoint_period)
+      : connection_(std::move(connection)), checkpoint_period_(checkpoint_period) {
+  }
+
+  // reclaims all free pages of the database; on_progress is called with reclaimed and total size in bytes
+  void compact(std::function<void(int64, int64)> on_progress, Promise<> promise);
+
+  void close(Promise<> promise);
+
+ private:
+  static constexpr double TRUNCATE_PERIOD = 600.0;
+  static constexpr int64 MIN_IDLE_VACUUM_FREE_PAGE_COUNT = 256;
+  static constexpr int32 IDLE_VACUUM_PAGE_COUNT = 64;
+  static constexpr int32 COMPACT_VACUUM_PAGE_COUNT = 1024;
+
+  std::shared_ptr<SqliteConnectionSafe> connection_;
+  double checkpoint_period_;
+  double next_truncate_time_ = 0;
+  int32 last_wal_frame_count_ = -1;
+  bool is_incremental_vacuum_enabled_ = false;
+
+  Promise<> compact_promise_;
+  std::function<void(int64, int64)> on_compact_progress_;
+  int64 compact_page_size_ = 0;
+  int64 compact_total_page_count_ = 0;
+
+  void start_up() override;
+  void timeout_expired() override;
+  void loop() override;
+
+  void on_idle();
+
+  void on_compact_finished(Status status);
+};
+
+}  // namespace td
@@ -11,13 +11,23 @@
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/binlog/BinlogInterface.h"
 
+#include "td/utils/buffer.h"
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/PathView.h"
+#include "td/utils/port/MemoryMapping.h"
+#include "td/utils/port/path.h"
 #include "td/utils/Random.h"
 #include "td/utils/StorerBase.h"
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <algorithm>
+#include <deque>
+#include <limits>
 #include <set>
 #include <unordered_map>
 
@@ -100,7 +110,7 @@ class TQueueImpl : public TQueue {
       return false;
     }
     auto &q = queues_[queue_id];
-    if (q.events.size() >= MAX_QUEUE_EVENTS || q.total_event_length > MAX_TOTAL_EVENT_LENGTH - raw_event.data.size() ||
+    if (q.event_count >= MAX_QUEUE_EVENTS || q.total_event_length > MAX_TOTAL_EVENT_LENGTH - raw_event.data.size() ||
         raw_event.expires_at <= 0) {
       return false;
     }
@@ -109,15 +119,11 @@ class TQueueImpl : public TQueue {
       return false;
     }
 
-    if (!q.events.empty()) {
-      auto it = q.events.end();
-      --it;
-      if (it->second.data.empty()) {
-        if (callback_ != nullptr && it->second.log_event_id != 0) {
-          callback_->pop(it->second.log_event_id);
-        }
-        q.events.erase(it);
+    if (!q.events.empty() && q.events.back().data.empty()) {
+      if (callback_ != nullptr && q.events.back().log_event_id != 0) {
+        callback_->pop(q.events.back().log_event_id);
       }
+      remove_event(q, q.events.size() - 1);
     }
     if (q.events.empty() && !raw_event.data.empty()) {
       schedule_queue_gc(queue_id, q, raw_event.expires_at);
@@ -128,7 +134,8 @@ class TQueueImpl : public TQueue {
     }
     q.tail_id = event_id.next().move_as_ok();
     q.total_event_length += raw_event.data.size();
-    q.events.emplace(event_id, std::move(raw_event));
+    q.event_count++;
+    q.events.push_back(std::move(raw_event));
     return true;
   }
 
@@ -141,7 +148,7 @@ class TQueueImpl : public TQueue {
     }
 
     auto &q = queues_[queue_id];
-    if (q.events.size() >= MAX_QUEUE_EVENTS) {
+    if (q.event_count >= MAX_QUEUE_EVENTS) {
       return Status::Error("Queue is full");
     }
     if (q.total_event_length > MAX_TOTAL_EVENT_LENGTH - data.size()) {
@@ -164,8 +171,8 @@ class TQueueImpl : public TQueue {
       if (event_id.next().is_ok()) {
         break;
       }
-      for (auto it = q.events.begin(); it != q.events.end();) {
-        pop(q, queue_id, it, {});
+      for (size_t pos = 0; pos < q.events.size();) {
+        pos = pop(q, queue_id, pos, {});
       }
       q.tail_id = EventId();
       CHECK(hint_new_id.next().is_ok());
@@ -204,11 +211,11 @@ class TQueueImpl : public TQueue {
       return;
     }
     auto &q = q_it->second;
-    auto it = q.events.find(event_id);
-    if (it == q.events.end()) {
+    auto pos = get_event_pos(q, event_id);
+    if (pos == q.events.size() || q.events[pos].event_id != event_id || is_forgotten(q.events[pos])) {
       return;
     }
-    pop(q, queue_id, it, q.tail_id);
+    pop(q, queue_id, pos, q.tail_id);
   }
 
   Result<size_t> get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now,
@@ -244,7 +251,7 @@ class TQueueImpl : public TQueue {
       int32 new_gc_at = 0;
 
       if (!q.events.empty()) {
-        auto head_id = q.events.begin()->first;
+        auto head_id = q.events.front().event_id;
         Event event;
         MutableSpan<Event> span{&event, 1};
         size_t size_before = get_size(q);
@@ -281,7 +288,10 @@ class TQueueImpl : public TQueue {
  private:
   struct Queue {
     EventId tail_id;
-    std::map<EventId, RawEvent> events;
+    // events sorted by identifier; events forgotten in the middle of the queue are kept with expires_at == 0
+    // until they reach the head of the queue or the queue is compacted; the first and the last events aren't forgotten
+    std::deque<RawEvent> events;
+    size_t event_count = 0;  // number of not forgotten events
     size_t total_event_length = 0;
     int32 gc_at = 0;
   };
@@ -294,7 +304,7 @@ class TQueueImpl : public TQueue {
     if (q.events.empty()) {
       return q.tail_id;
     }
-    return q.events.begin()->first;
+    return q.events.front().event_id;
   }
 
   static size_t get_size(const Queue &q) {
@@ -302,14 +312,25 @@ class TQueueImpl : public TQueue {
       return 0;
     }
 
-    return q.events.size() - (q.events.rbegin()->second.data.empty() ? 1 : 0);
+    return q.event_count - (q.events.back().data.empty() ? 1 : 0);
+  }
+
+  static bool is_forgotten(const RawEvent &event) {
+    return event.expires_at == 0;
   }
 
-  void pop(Queue &q, QueueId queue_id, std::map<EventId, RawEvent>::iterator &it, EventId tail_id) {
-    auto &event = it->second;
+  // returns position of the first event with identifier not less than event_id
+  static size_t get_event_pos(const Queue &q, EventId event_id) {
+    return std::lower_bound(q.events.begin(), q.events.end(), event_id,
+                            [](const RawEvent &event, EventId event_id) { return event.event_id < event_id; }) -
+           q.events.begin();
+  }
+
+  // returns new position of the event, which followed the popped event
+  size_t pop(Queue &q, QueueId queue_id, size_t pos, EventId tail_id) {
+    auto &event = q.events[pos];
     if (callback_ == nullptr || event.log_event_id == 0) {
-      remove_event(q, it);
-      return;
+      return remove_event(q, pos);
     }
 
     if (event.event_id.next().ok() == tail_id) {
@@ -317,16 +338,44 @@ class TQueueImpl : public TQueue {
         clear_event_data(q, event);
         callback_->push(queue_id, event);
       }
-      ++it;
+      return pos + 1;
     } else {
       callback_->pop(event.log_event_id);
-      remove_event(q, it);
+      return remove_event(q, pos);
     }
   }
 
-  static void remove_event(Queue &q, std::map<EventId, RawEvent>::iterator &it) {
-    q.total_event_length -= it->second.data.size();
-    it = q.events.erase(it);
+  // returns new position of the event, which followed the removed event
+  // references to other events stay valid, unlike after compact_events
+  static size_t remove_event(Queue &q, size_t pos) {
+    auto &event = q.events[pos];
+    CHECK(!is_forgotten(event));
+    q.total_event_length -= event.data.size();
+    q.event_count--;
+    if (pos == 0) {
+      do {
+        q.events.pop_front();
+      } while (!q.events.empty() && is_forgotten(q.events.front()));
+      return 0;
+    }
+    if (pos + 1 == q.events.size()) {
+      do {
+        q.events.pop_back();
+      } while (!q.events.empty() && is_forgotten(q.events.back()));
+      return q.events.size();
+    }
+    event.data = {};
+    event.log_event_id = 0;
+    event.expires_at = 0;
+    return pos + 1;
+  }
+
+  static void compact_events(Queue &q) {
+    if (q.events.size() <= 2 * q.event_count + 16) {
+      return;
+    }
+    q.events.erase(std::remove_if(q.events.begin(), q.events.end(), is_forgotten), q.events.end());
+    CHECK(q.events.size() == q.event_count);
   }
 
   static void clear_event_data(Queue &q, RawEvent &event) {
@@ -336,17 +385,25 @@ class TQueueImpl : public TQueue {
 
   void do_get(QueueId queue_id, Queue &q, EventId from_id, bool forget_previous, int32 unix_time_now,
               MutableSpan<Event> &result_events) {
+    // returned events must not be moved, so forgotten events can be deleted only before they are found
+    compact_events(q);
     if (forget_previous) {
-      for (auto it = q.events.begin(); it != q.events.end() && it->first < from_id;) {
-        pop(q, queue_id, it, q.tail_id);
+      for (size_t pos = 0; pos < q.events.size() && q.events[pos].event_id < from_id;) {
+        if (is_forgotten(q.events[pos])) {
+          pos++;
+        } else {
+          pos = pop(q, queue_id, pos, q.tail_id);
+        }
       }
     }
 
     size_t ready_n = 0;
-    for (auto it = q.events.lower_bound(from_id); it != q.events.end();) {
-      auto &event = it->second;
-      if (event.expires_at < unix_time_now || event.data.empty()) {
-        pop(q, queue_id, it, q.tail_id);
+    for (size_t pos = get_event_pos(q, from_id); pos < q.events.size();) {
+      auto &event = q.events[pos];
+      if (is_forgotten(event)) {
+        pos++;
+      } else if (event.expires_at < unix_time_now || event.data.empty()) {
+        pos = pop(q, queue_id, pos, q.tail_id);
       } else {
         CHECK(!(event.event_id < from_id));
         if (ready_n == result_events.size()) {
@@ -359,7 +416,7 @@ class TQueueImpl : public TQueue {
         to.expires_at = event.expires_at;
         to.extra = event.extra;
         ready_n++;
-        ++it;
+        pos++;
       }
     }
 
@@ -505,4 +562,317 @@ void TQueueMemoryStorage::close(Promise<> promise) {
   promise.set_value({});
 }
 
+// a segment consists of records, each of which is stored as its size, CRC32 of its body and the body itself;
+// the body contains record type, log event identifier and TQueueLogEvent for pushed events
+Status TQueueSegmentedStorage::init(string directory, size_t max_segment_size) {
+  CHECK(max_segment_size > 0);
+  directory_ = std::move(directory);
+  max_segment_size_ = max_segment_size;
+  TRY_STATUS(mkpath(PSLICE() << directory_ << TD_DIR_SLASH));
+
+  TRY_STATUS(WalkPath::run(directory_, [&](CSlice path, WalkPath::Type type) {
+    if (type == WalkPath::Type::EnterDir) {
+      return path == directory_ ? WalkPath::Action::Continue : WalkPath::Action::SkipDir;
+    }
+    if (type == WalkPath::Type::NotDir) {
+      PathView path_view(path);
+      auto file_stem = path_view.file_stem();
+      if (path_view.extension() == "seg" && begins_with(file_stem, "tqueue")) {
+        auto r_segment_id = to_integer_safe<int64>(file_stem.substr(6));
+        if (r_segment_id.is_ok() && r_segment_id.ok() > 0) {
+          segments_[r_segment_id.ok()];
+        }
+      }
+    }
+    return WalkPath::Action::Continue;
+  }));
+  if (!segments_.empty()) {
+    last_segment_id_ = segments_.rbegin()->first;
+  }
+  return Status::OK();
+}
+
+Status TQueueSegmentedStorage::replay(TQueue &q) {
+  CHECK(last_segment_fd_.empty());
+  std::map<uint64, std::pair<QueueId, RawEvent>> events;
+  for (auto &segment : segments_) {
+    TRY_STATUS(replay_segment(segment.first, events));
+  }
+
+  TRY_STATUS(open_new_segment());
+
+  // TQueue deletes the last event of a queue without data when a new event is added, but the storage isn't notified
+  // about that during replay, so such events are popped here
+  std::unordered_map<QueueId, uint64> last_empty_log_event_ids;
+  for (auto &it : events) {
+    auto log_event_id = it.first;
+    auto queue_id = it.second.first;
+    auto &event = it.second.second;
+    auto segment_it = segments_.find(event_segment_ids_[log_event_id]);
+    CHECK(segment_it != segments_.end());
+    auto &segment = segment_it->second;
+    segment.event_count++;
+    segment.max_expires_at =
+        max(segment.max_expires_at, event.data.empty() ? std::numeric_limits<int32>::max() : event.expires_at);
+
+    bool is_empty = event.data.empty();
+    if (!q.do_push(queue_id, std::move(event))) {
+      LOG(WARNING) << "Failed to add event " << log_event_id << " to " << queue_id;
+      pop(log_event_id);
+      continue;
+    }
+    auto &last_empty_log_event_id = last_empty_log_event_ids[queue_id];
+    if (last_empty_log_event_id != 0) {
+      pop(last_empty_log_event_id);
+    }
+    last_empty_log_event_id = is_empty ? log_event_id : 0;
+  }
+
+  delete_old_segments();
+  return Status::OK();
+}
+
+Status TQueueSegmentedStorage::replay_segment(int64 segment_id,
+                                              std::map<uint64, std::pair<QueueId, RawEvent>> &events) {
+  auto path = get_segment_path(segment_id);
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  TRY_RESULT(file_size, fd.get_size());
+  if (file_size == 0) {
+    return Status::OK();
+  }
+
+  // the whole segment is read through a memory mapping if possible; data of events is copied to the queue anyway
+  BufferSlice buffer;
+  Slice data;
+  auto r_mapping = MemoryMapping::create_from_file(fd);
+  if (r_mapping.is_ok()) {
+    data = r_mapping.ok().as_slice();
+  } else {
+    TRY_RESULT_ASSIGN(buffer, read_file(path));
+    data = buffer.as_slice();
+  }
+
+  auto &segment = segments_[segment_id];
+  while (!data.empty()) {
+    if (data.size() < 8) {
+      LOG(WARNING) << "Ignore truncated record at the end of " << path;
+      break;
+    }
+    TlParser header_parser(data.substr(0, 8));
+    auto body_size = static_cast<size_t>(header_parser.fetch_int());
+    auto crc = static_cast<uint32>(header_parser.fetch_int());
+    if (body_size < 12 || body_size % 4 != 0 || body_size > data.size() - 8) {
+      LOG(WARNING) << "Ignore truncated record at the end of " << path;
+      break;
+    }
+    auto body = data.substr(8, body_size);
+    if (crc32(body) != crc) {
+      LOG(ERROR) << "Ignore corrupted record and the rest of " << path;
+      break;
+    }
+    data.remove_prefix(8 + body_size);
+
+    TlParser parser(body);
+    auto type = parser.fetch_int();
+    auto log_event_id = static_cast<uint64>(parser.fetch_long());
+    next_log_event_id_ = max(next_log_event_id_, log_event_id + 1);
+
+    auto it = event_segment_ids_.find(log_event_id);
+    if (it != event_segment_ids_.end()) {
+      if (it->second != segment_id) {
+        segment.previous_segment_ids.insert(it->second);
+      }
+      event_segment_ids_.erase(it);
+      events.erase(log_event_id);
+    }
+    if (type == POP_TYPE) {
+      parser.fetch_end();
+      continue;
+    }
+
+    int32 has_extra = type - EVENT_TYPE;
+    if (has_extra != 0 && has_extra != 1) {
+      LOG(ERROR) << "Ignore record of unknown type " << type << " in " << path;
+      continue;
+    }
+    TQueueLogEvent log_event;
+    log_event.parse(parser, has_extra);
+    parser.fetch_end();
+    auto r_event_id = EventId::from_int32(log_event.event_id);
+    if (parser.get_error() != nullptr || r_event_id.is_error()) {
+      LOG(ERROR) << "Ignore invalid event " << log_event_id << " in " << path;
+      continue;
+    }
+
+    RawEvent raw_event;
+    raw_event.log_event_id = log_event_id;
+    raw_event.event_id = r_event_id.move_as_ok();
+    raw_event.expires_at = log_event.expires_at;
+    raw_event.data = log_event.data.str();
+    raw_event.extra = log_event.extra;
+    events[log_event_id] = std::make_pair(log_event.queue_id, std::move(raw_event));
+    event_segment_ids_[log_event_id] = segment_id;
+  }
+  return Status::OK();
+}
+
+uint64 TQueueSegmentedStorage::push(QueueId queue_id, const RawEvent &event) {
+  TQueueLogEvent log_event;
+  log_event.queue_id = queue_id;
+  log_event.event_id = event.event_id.value();
+  log_event.expires_at = event.expires_at;
+  log_event.data = event.data;
+  log_event.extra = event.extra;
+
+  auto log_event_id = event.log_event_id == 0 ? next_log_event_id_++ : event.log_event_id;
+  append_record(EVENT_TYPE + (log_event.extra != 0), log_event_id, log_event);
+  if (event.log_event_id != 0) {
+    remove_event_from_segment(log_event_id);
+  }
+  add_event_to_segment(log_event_id, event.data.empty(), event.expires_at);
+  return log_event_id;
+}
+
+void TQueueSegmentedStorage::pop(uint64 log_event_id) {
+  auto it = event_segment_ids_.find(log_event_id);
+  if (it == event_segment_ids_.end()) {
+    return;
+  }
+  if (segments_.count(it->second) != 0) {
+    append_record(POP_TYPE, log_event_id, EmptyStorer());
+  }
+  remove_event_from_segment(log_event_id);
+}
+
+void TQueueSegmentedStorage::run_gc(int32 unix_time_now) {
+  gc_time_ = unix_time_now;
+  delete_old_segments();
+}
+
+void TQueueSegmentedStorage::close(Promise<> promise) {
+  if (!last_segment_fd_.empty()) {
+    auto status = last_segment_fd_.sync();
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to sync " << get_segment_path(last_segment_id_) << ": " << status;
+    }
+    last_segment_fd_.close();
+  }
+  segments_.clear();
+  event_segment_ids_.clear();
+  promise.set_value(Unit());
+}
+
+string TQueueSegmentedStorage::get_segment_path(int64 segment_id) const {
+  return PSTRING() << directory_ << TD_DIR_SLASH << "tqueue" << segment_id << ".seg";
+}
+
+Status TQueueSegmentedStorage::open_new_segment() {
+  auto segment_id = last_segment_id_ + 1;
+  TRY_RESULT(fd, FileFd::open(get_segment_path(segment_id), FileFd::Write | FileFd::Create | FileFd::Truncate));
+  if (!last_segment_fd_.empty()) {
+    last_segment_fd_.close();
+  }
+  last_segment_fd_ = std::move(fd);
+  last_segment_id_ = segment_id;
+  last_segment_size_ = 0;
+  segments_[segment_id];
+  return Status::OK();
+}
+
+void TQueueSegmentedStorage::append_record(int32 type, uint64 log_event_id, const Storer &storer) {
+  CHECK(!last_segment_fd_.empty());
+  if (last_segment_size_ >= max_segment_size_) {
+    auto status = open_new_segment();
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to create new segment: " << status;
+    } else {
+      // the previous segment could have been kept only because it was the last one
+      delete_old_segments();
+    }
+  }
+
+  auto body_size = 12 + storer.size();
+  BufferSlice record(8 + body_size);
+  auto body = record.as_slice().substr(8);
+  TlStorerUnsafe body_storer(body.ubegin());
+  body_storer.store_int(type);
+  body_storer.store_long(static_cast<int64>(log_event_id));
+  auto stored_size = storer.store(body_storer.get_buf());
+  CHECK(12 + stored_size == body_size);
+  TlStorerUnsafe header_storer(record.as_slice().ubegin());
+  header_storer.store_int(narrow_cast<int32>(body_size));
+  header_storer.store_int(static_cast<int32>(crc32(body)));
+
+  Slice data = record.as_slice();
+  while (!data.empty()) {
+    auto r_size = last_segment_fd_.write(data);
+    if (r_size.is_error()) {
+      LOG(FATAL) << "Failed to write to " << get_segment_path(last_segment_id_) << ": " << r_size.error();
+    }
+    data.remove_prefix(r_size.ok());
+  }
+  last_segment_size_ += record.size();
+
+  auto it = event_segment_ids_.find(log_event_id);
+  if (it != event_segment_ids_.end() && it->second != last_segment_id_ && segments_.count(it->second) != 0) {
+    segments_[last_segment_id_].previous_segment_ids.insert(it->second);
+  }
+}
+
+void TQueueSegmentedStorage::add_event_to_segment(uint64 log_event_id, bool is_empty, int32 expires_at) {
+  auto &segment = segments_[last_segment_id_];
+  segment.event_count++;
+  // events without data are kept by TQueue as long as there are no newer events in the queue
+  segment.max_expires_at = max(segment.max_expires_at, is_empty ? std::numeric_limits<int32>::max() : expires_at);
+  event_segment_ids_[log_event_id] = last_segment_id_;
+}
+
+void TQueueSegmentedStorage::remove_event_from_segment(uint64 log_event_id) {
+  auto it = event_segment_ids_.find(log_event_id);
+  CHECK(it != event_segment_ids_.end());
+  auto segment_it = segments_.find(it->second);
+  event_segment_ids_.erase(it);
+  if (segment_it == segments_.end()) {
+    // the segment was deleted, because all its events are expired
+    return;
+  }
+  CHECK(segment_it->second.event_count > 0);
+  if (--segment_it->second.event_count == 0) {
+    delete_old_segments();
+  }
+}
+
+bool TQueueSegmentedStorage::can_delete_segment(int64 segment_id, const Segment &segment) const {
+  if (segment_id == last_segment_id_) {
+    return false;
+  }
+  if (segment.event_count != 0 && segment.max_expires_at >= gc_time_) {
+    return false;
+  }
+  // records of the segment hide records in the previous segments, so they must be deleted first
+  for (auto previous_segment_id : segment.previous_segment_ids) {
+    if (segments_.count(previous_segment_id) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TQueueSegmentedStorage::delete_old_segments() {
+  // segments are checked in order, so a segment is deleted after all segments it depends on
+  for (auto it = segments_.begin(); it != segments_.end();) {
+    if (!can_delete_segment(it->first, it->second)) {
+      ++it;
+      continue;
+    }
+    auto path = get_segment_path(it->first);
+    LOG(INFO) << "Delete " << path << " with " << it->second.event_count << " expired events";
+    auto status = unlink(path);
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to delete " << path << ": " << status;
+    }
+    it = segments_.erase(it);
+  }
+}
+
 }  // namespace td
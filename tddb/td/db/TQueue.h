@@ -9,13 +9,17 @@
 #include "td/actor/PromiseFuture.h"
 
 #include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Span.h"
 #include "td/utils/Status.h"
+#include "td/utils/StorerBase.h"
 #include "td/utils/StringBuilder.h"
 
 #include <map>
 #include <memory>
+#include <set>
+#include <unordered_map>
 #include <utility>
 
 namespace td {
@@ -150,4 +154,57 @@ class TQueueMemoryStorage : public TQueue::StorageCallback {
   std::map<uint64, std::pair<QueueId, RawEvent>> events_;
 };
 
+// stores events in append-only segment files in a directory; the last segment is replaced with a new one after its
+// size reaches max_segment_size; old segments are deleted as whole files, when all their events are popped or expired
+class TQueueSegmentedStorage : public TQueue::StorageCallback {
+ public:
+  static constexpr size_t DEFAULT_MAX_SEGMENT_SIZE = 1 << 24;
+
+  Status init(string directory, size_t max_segment_size = DEFAULT_MAX_SEGMENT_SIZE) TD_WARN_UNUSED_RESULT;
+
+  // adds all stored events to the queue; must be called once just after init
+  Status replay(TQueue &q) TD_WARN_UNUSED_RESULT;
+
+  uint64 push(QueueId queue_id, const RawEvent &event) override;
+  void pop(uint64 log_event_id) override;
+
+  // deletes old segments, all events of which are expired
+  void run_gc(int32 unix_time_now);
+
+  virtual void close(Promise<> promise) override;
+
+  size_t get_segment_count() const {
+    return segments_.size();
+  }
+
+ private:
+  struct Segment {
+    size_t event_count = 0;  // number of events, which are stored last time in the segment
+    int32 max_expires_at = 0;
+    std::set<int64> previous_segment_ids;  // segments with events, which were rewritten or popped in the segment
+  };
+
+  static constexpr int32 EVENT_TYPE = 2314;
+  static constexpr int32 POP_TYPE = 2316;
+
+  string directory_;
+  size_t max_segment_size_ = 0;
+  std::map<int64, Segment> segments_;
+  int64 last_segment_id_ = 0;
+  FileFd last_segment_fd_;
+  size_t last_segment_size_ = 0;
+  std::unordered_map<uint64, int64> event_segment_ids_;
+  uint64 next_log_event_id_{1};
+  int32 gc_time_ = 0;
+
+  string get_segment_path(int64 segment_id) const;
+  Status open_new_segment() TD_WARN_UNUSED_RESULT;
+  Status replay_segment(int64 segment_id, std::map<uint64, std::pair<QueueId, RawEvent>> &events) TD_WARN_UNUSED_RESULT;
+  void append_record(int32 type, uint64 log_event_id, const Storer &storer);
+  void add_event_to_segment(uint64 log_event_id, bool is_empty, int32 expires_at);
+  void remove_event_from_segment(uint64 log_event_id);
+  void delete_old_segments();
+  bool can_delete_segment(int64 segment_id, const Segment &segment) const;
+};
+
 }  // namespace td
@@ -0,0 +1,157 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/TQueue.h"
+
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/Span.h"
+#include "td/utils/Status.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace td {
+
+// thread-safe TQueue, which distributes queues between shards with independent locks and storages,
+// so events can be added to queues from different shards in parallel
+class TsTQueue {
+ public:
+  using QueueId = TQueue::QueueId;
+  using EventId = TQueue::EventId;
+
+  struct Event {
+    EventId id;
+    string data;
+    int64 extra{0};
+    int32 expires_at{0};
+  };
+
+  explicit TsTQueue(size_t shard_count) {
+    CHECK(shard_count > 0);
+    shards_.resize(shard_count);
+    for (auto &shard : shards_) {
+      shard = make_unique<Shard>();
+      shard->tqueue = TQueue::create();
+    }
+  }
+
+  size_t get_shard_count() const {
+    return shards_.size();
+  }
+
+  // the mapping must not change between restarts, because every shard has its own storage
+  size_t get_shard_id(QueueId queue_id) const {
+    return static_cast<size_t>((static_cast<uint64>(queue_id) * 0x9E3779B97F4A7C15) >> 32) % shards_.size();
+  }
+
+  // not thread-safe; must be used only to replay storage of the shard and to set its callback before first use
+  TQueue &get_shard_unsafe(size_t shard_id) {
+    CHECK(shard_id < shards_.size());
+    return *shards_[shard_id]->tqueue;
+  }
+
+  Result<EventId> push(QueueId queue_id, string data, int32 expires_at, int64 extra, EventId hint_new_id) {
+    auto &shard = get_shard(queue_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return shard.tqueue->push(queue_id, std::move(data), expires_at, extra, hint_new_id);
+  }
+
+  void forget(QueueId queue_id, EventId event_id) {
+    auto &shard = get_shard(queue_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    shard.tqueue->forget(queue_id, event_id);
+  }
+
+  EventId get_head(QueueId queue_id) {
+    auto &shard = get_shard(queue_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return shard.tqueue->get_head(queue_id);
+  }
+
+  EventId get_tail(QueueId queue_id) {
+    auto &shard = get_shard(queue_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return shard.tqueue->get_tail(queue_id);
+  }
+
+  size_t get_size(QueueId queue_id) {
+    auto &shard = get_shard(queue_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return shard.tqueue->get_size(queue_id);
+  }
+
+  // returns at most limit events; their data is copied, because the queue can be changed by other threads
+  Result<size_t> get(QueueId queue_id, EventId from_id, bool forget_previous, int32 unix_time_now, size_t limit,
+                     vector<Event> &result_events) {
+    vector<TQueue::Event> events(limit);
+    MutableSpan<TQueue::Event> span(events);
+    auto &shard = get_shard(queue_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    TRY_RESULT(size, shard.tqueue->get(queue_id, from_id, forget_previous, unix_time_now, span));
+    result_events.clear();
+    result_events.reserve(span.size());
+    for (auto &event : span) {
+      result_events.push_back(Event{event.id, event.data.str(), event.extra, event.expires_at});
+    }
+    return size;
+  }
+
+  // shards are processed one by one, so pushes to other shards aren't blocked
+  int64 run_gc(int32 unix_time_now) {
+    int64 deleted_events = 0;
+    for (auto &shard : shards_) {
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      deleted_events += shard->tqueue->run_gc(unix_time_now);
+    }
+    return deleted_events;
+  }
+
+  // the promise is set after storages of all shards are closed
+  void close(Promise<> promise) {
+    struct CloseState {
+      std::atomic<size_t> left_count{0};
+      Promise<> promise;
+    };
+    auto state = std::make_shared<CloseState>();
+    state->left_count = shards_.size();
+    state->promise = std::move(promise);
+    for (auto &shard : shards_) {
+      auto on_closed = PromiseCreator::lambda([state](Unit) {
+        if (--state->left_count == 0) {
+          state->promise.set_value(Unit());
+        }
+      });
+      std::lock_guard<std::mutex> guard(shard->mutex);
+      auto callback = shard->tqueue->extract_callback();
+      if (callback == nullptr) {
+        on_closed.set_value(Unit());
+      } else {
+        callback->close(std::move(on_closed));
+      }
+    }
+  }
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    unique_ptr<TQueue> tqueue;
+  };
+
+  vector<unique_ptr<Shard>> shards_;
+
+  Shard &get_shard(QueueId queue_id) {
+    return *shards_[get_shard_id(queue_id)];
+  }
+};
+
+}  // namespace td
@@ -11,19 +11,26 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/format.h"
+#include "td/utils/Gzip.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/Clocks.h"
+#include "td/utils/port/config.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/MemoryMapping.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Status.h"
 #include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
+
+#include <algorithm>
 
 namespace td {
 namespace detail {
@@ -90,6 +97,39 @@ struct AesCtrEncryptionEvent {
   }
 };
 
+// Binlog is compacted incrementally: live events are copied to the new file in chunks,
+// which are interleaved with addition of new events. New events are written to both files.
+// The new file is encrypted with the current database key, so the compaction is also used to change the key
+struct BinlogCompaction {
+  static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+  BufferedFdBase<FileFd> fd;
+  ChainBufferWriter buffer_writer;
+  ChainBufferReader buffer_reader;
+
+  // AesCtrEncryption of the new file; events are encrypted in place, so they must be copied to buffer_writer
+  bool is_encrypted{false};
+  BufferSlice key_salt;
+  UInt256 key;
+  ByteFlowSource byte_flow_source;
+  ByteFlowSink byte_flow_sink;
+  AesCtrByteFlow aes_xcode_byte_flow;
+
+  // the compaction can't be cancelled, because the old file is encrypted with the previous key
+  bool is_key_change{false};
+
+  // live events at the start of the compaction, followed by the events added during the compaction
+  vector<BufferSlice> events;
+  size_t next_event{0};
+
+  int64 fd_size{0};
+  uint64 fd_events{0};
+
+  double start_time{0};
+  int64 start_size{0};
+  uint64 start_events{0};
+};
+
 class BinlogReader {
  public:
   explicit BinlogReader(ChainBufferReader *input) : input_(input) {
@@ -137,7 +177,8 @@ class BinlogReader {
     }
 
     event->debug_info_ = BinlogDebugInfo{__FILE__, __LINE__};
-    TRY_STATUS(event->init(input_->cut_head(size_).move_as_buffer_slice()));
+    // CRC is checked by the caller to allow checking of many events in parallel
+    TRY_STATUS(event->init(input_->cut_head(size_).move_as_buffer_slice(), false));
     offset_ += size_;
     event->offset_ = offset_;
     state_ = State::ReadLength;
@@ -154,6 +195,42 @@ class BinlogReader {
   bool is_encrypted_{false};
 };
 
+// returns index of the first event with wrong CRC or events.size() if there are no such events
+static size_t find_first_corrupted_event(const vector<BinlogEvent> &events, size_t events_size) {
+  auto find_in_range = [&events](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      if (events[i].verify_crc().is_error()) {
+        return i;
+      }
+    }
+    return events.size();
+  };
+
+#if !TD_THREAD_UNSUPPORTED
+  constexpr size_t MIN_PARALLEL_EVENTS_SIZE = 1 << 20;
+  constexpr size_t MAX_THREAD_COUNT = 8;
+  auto thread_count = min(static_cast<size_t>(thread::hardware_concurrency()), MAX_THREAD_COUNT);
+  if (events_size >= MIN_PARALLEL_EVENTS_SIZE && thread_count > 1 && events.size() >= thread_count) {
+    vector<size_t> results(thread_count, events.size());
+    auto check_part = [&](size_t part) {
+      results[part] = find_in_range(events.size() * part / thread_count, events.size() * (part + 1) / thread_count);
+    };
+    vector<thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t part = 1; part < thread_count; part++) {
+      threads.emplace_back(check_part, part);
+    }
+    check_part(0);
+    for (auto &worker : threads) {
+      worker.join();
+    }
+    return *std::min_element(results.begin(), results.end());
+  }
+#endif
+
+  return find_in_range(0, events.size());
+}
+
 static int64 file_size(CSlice path) {
   auto r_stat = stat(path);
   if (r_stat.is_error()) {
@@ -161,8 +238,58 @@ static int64 file_size(CSlice path) {
   }
   return r_stat.ok().size_;
 }
+
+// data of a compressed event is a TL string with gzipped original data
+struct CompressedEventData {
+  Slice data;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    storer.store_string(data);
+  }
+};
+
+// returns an empty event if the event can't be compressed well enough
+static BinlogEvent compress_event(const BinlogEvent &event) {
+#if TD_HAVE_ZLIB
+  auto compressed_data = gzencode(event.data_, 0.9);
+  if (!compressed_data.empty()) {
+    return BinlogEvent(
+        BinlogEvent::create_raw(event.id_, event.type_, event.flags_ | BinlogEvent::Flags::Compressed,
+                                create_default_storer(CompressedEventData{compressed_data.as_slice()})),
+        event.debug_info_);
+  }
+#endif
+  return BinlogEvent();
+}
+
+static Result<BinlogEvent> decompress_event(const BinlogEvent &event) {
+  TlParser parser(event.data_);
+  auto compressed_data = parser.template fetch_string<Slice>();
+  parser.fetch_end();
+  TRY_STATUS(parser.get_status());
+#if TD_HAVE_ZLIB
+  auto data = gzdecode(compressed_data);
+#else
+  BufferSlice data;
+#endif
+  if (data.empty() || data.size() % 4 != 0) {
+    return Status::Error("Failed to decompress event");
+  }
+  BinlogEvent result(BinlogEvent::create_raw(event.id_, event.type_, event.flags_ & ~BinlogEvent::Flags::Compressed,
+                                             create_storer(data.as_slice())),
+                     event.debug_info_);
+  result.offset_ = event.offset_;
+  return std::move(result);
+}
 }  // namespace detail
 
+std::atomic<size_t> Binlog::min_compressed_event_size_{0};
+
+void Binlog::set_min_compressed_event_size(size_t size) {
+  min_compressed_event_size_.store(size, std::memory_order_relaxed);
+}
+
 Binlog::Binlog() = default;
 
 Binlog::~Binlog() {
@@ -225,6 +352,17 @@ void Binlog::add_event(BinlogEvent &&event) {
     LOG(FATAL) << "Trying to add event with bad size " << event.public_to_string();
   }
 
+  auto min_compressed_event_size = min_compressed_event_size_.load(std::memory_order_relaxed);
+  if (min_compressed_event_size != 0 && event.type_ >= 0 && event.data_.size() >= min_compressed_event_size &&
+      (event.flags_ & BinlogEvent::Flags::Compressed) == 0) {
+    auto compressed_event = detail::compress_event(event);
+    if (!compressed_event.empty()) {
+      compressed_events_size_ += event.size_;
+      compressed_events_compressed_size_ += compressed_event.size_;
+      event = std::move(compressed_event);
+    }
+  }
+
   if (!events_buffer_) {
     do_add_event(std::move(event));
   } else {
@@ -232,7 +370,9 @@ void Binlog::add_event(BinlogEvent &&event) {
   }
   lazy_flush();
 
-  if (state_ == State::Run) {
+  if (compaction_ != nullptr) {
+    continue_compaction();
+  } else if (state_ == State::Run) {
     auto fd_size = fd_size_;
     if (events_buffer_) {
       fd_size += events_buffer_->size();
@@ -243,7 +383,7 @@ void Binlog::add_event(BinlogEvent &&event) {
     if (need_reindex(50000, 5) || need_reindex(100000, 4) || need_reindex(300000, 3) || need_reindex(500000, 2)) {
       LOG(INFO) << tag("fd_size", format::as_size(fd_size))
                 << tag("total events size", format::as_size(processor_->total_raw_events_size()));
-      do_reindex();
+      start_compaction(false);
     }
   }
 }
@@ -279,11 +419,22 @@ Status Binlog::close(bool need_sync) {
   if (fd_.empty()) {
     return Status::OK();
   }
+  if (compaction_ != nullptr && compaction_->is_key_change) {
+    while (compaction_ != nullptr) {
+      continue_compaction();
+    }
+  }
+  cancel_compaction();
   if (need_sync) {
     sync();
   } else {
     flush();
   }
+  if (compressed_events_compressed_size_ != 0) {
+    LOG(INFO) << "Compressed events in " << tag("path", path_)
+              << tag("size", format::as_size(compressed_events_size_))
+              << tag("compressed_size", format::as_size(compressed_events_compressed_size_));
+  }
 
   fd_.lock(FileFd::LockFlags::Unlock, path_, 1).ensure();
   fd_.close();
@@ -304,6 +455,18 @@ void Binlog::change_key(DbKey new_db_key) {
   do_reindex();
 }
 
+void Binlog::start_change_key(DbKey new_db_key) {
+  CHECK(state_ == State::Run);
+  cancel_compaction();
+  flush_events_buffer(true);
+  db_key_ = std::move(new_db_key);
+  aes_ctr_key_salt_ = BufferSlice();
+  start_compaction(true);
+  if (compaction_ == nullptr) {
+    do_reindex();
+  }
+}
+
 Status Binlog::close_and_destroy() {
   auto path = path_;
   auto close_status = close(false);
@@ -330,10 +493,16 @@ void Binlog::do_event(BinlogEvent &&event) {
     switch (encryption_type_) {
       case EncryptionType::None: {
         buffer_writer_.append(event.raw_event_.clone());
+        if (compaction_ != nullptr) {
+          compaction_->events.push_back(event.raw_event_.clone());
+        }
         break;
       }
       case EncryptionType::AesCtr: {
         buffer_writer_.append(event.raw_event_.as_slice());
+        if (compaction_ != nullptr) {
+          compaction_->events.push_back(event.raw_event_.clone());
+        }
         break;
       }
     }
@@ -409,12 +578,20 @@ void Binlog::do_event(BinlogEvent &&event) {
 void Binlog::sync() {
   flush();
   if (need_sync_) {
-    auto status = fd_.sync();
+    auto status = fd_.sync_data();
     LOG_IF(FATAL, status.is_error()) << "Failed to sync binlog: " << status;
     need_sync_ = false;
   }
 }
 
+void Binlog::start_sync() {
+  flush();
+  if (need_sync_) {
+    auto status = fd_.start_sync_data();
+    LOG_IF(ERROR, status.is_error()) << "Failed to start binlog sync: " << status;
+  }
+}
+
 void Binlog::flush() {
   if (state_ == State::Load) {
     return;
@@ -503,10 +680,36 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
   fd_.get_poll_info().add_flags(PollFlags::Read());
   info_.wrong_password = false;
+
+  // the file is read through a memory mapping if possible, so events are copied to big buffers without system calls,
+  // encrypted events are decrypted in place in the same buffers
+  constexpr size_t MAPPED_READ_SIZE = 1 << 20;
+  auto r_mapping = MemoryMapping::create_from_file(fd_);
+  if (r_mapping.is_error()) {
+    VLOG(binlog) << "Can't map binlog: " << r_mapping.error();
+  }
+  size_t mapped_read_offset = 0;
+
+  // CRC of ordinary events is checked in batches, service events can change the way the binlog is read,
+  // so they are applied immediately
+  constexpr size_t LOADED_EVENTS_BATCH_SIZE = 1 << 22;
+  vector<BinlogEvent> loaded_events;
+  size_t loaded_events_size = 0;
+  auto add_loaded = [&] {
+    auto status = add_loaded_events(loaded_events, loaded_events_size, debug_callback);
+    loaded_events.clear();
+    loaded_events_size = 0;
+    return status;
+  };
   while (true) {
     BinlogEvent event;
     auto r_need_size = reader.read_next(&event);
     if (r_need_size.is_error()) {
+      auto status = add_loaded();
+      if (status.is_error()) {
+        LOG(ERROR) << status;
+        break;
+      }
       if (r_need_size.error().code() == -2) {
         auto old_size = detail::file_size(path_);
         auto offset = reader.offset();
@@ -525,41 +728,103 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
     auto need_size = r_need_size.move_as_ok();
     // LOG(ERROR) << "Need size = " << need_size;
     if (need_size == 0) {
-      if (debug_callback) {
-        debug_callback(event);
+      if (event.type_ >= 0) {
+        loaded_events_size += event.raw_event_.size();
+        loaded_events.push_back(std::move(event));
+        if (loaded_events_size < LOADED_EVENTS_BATCH_SIZE) {
+          continue;
+        }
+      }
+
+      auto status = add_loaded();
+      if (status.is_error()) {
+        LOG(ERROR) << status;
+        break;
       }
-      do_add_event(std::move(event));
       if (info_.wrong_password) {
         return Status::OK();
       }
+
+      if (!event.empty()) {
+        status = event.verify_crc();
+        if (status.is_error()) {
+          LOG(ERROR) << status;
+          break;
+        }
+        if (debug_callback) {
+          debug_callback(event);
+        }
+        do_add_event(std::move(event));
+        if (info_.wrong_password) {
+          return Status::OK();
+        }
+      }
     } else {
-      TRY_STATUS(fd_.flush_read(max(need_size, static_cast<size_t>(4096))));
+      if (r_mapping.is_ok()) {
+        auto data = r_mapping.ok().as_slice().substr(mapped_read_offset);
+        auto read_size = min(data.size(), max(need_size, MAPPED_READ_SIZE));
+        buffer_writer_.append(data.substr(0, read_size), read_size);
+        mapped_read_offset += read_size;
+      } else {
+        auto r_read_size = fd_.flush_read(max(need_size, static_cast<size_t>(4096)));
+        if (r_read_size.is_error()) {
+          add_loaded().ignore();
+          return r_read_size.move_as_error();
+        }
+      }
       buffer_reader_.sync_with_writer();
       if (byte_flow_flag_) {
         byte_flow_source_.wakeup();
       }
       if (reader.input()->size() < need_size) {
+        auto status = add_loaded();
+        if (status.is_error()) {
+          LOG(ERROR) << status;
+        }
         break;
       }
     }
   }
 
   auto offset = processor_->offset();
+  int64 loaded_compressed_events_size = 0;
+  int64 loaded_compressed_events_compressed_size = 0;
   processor_->for_each([&](BinlogEvent &event) {
     VLOG(binlog) << "Replay binlog event: " << event.public_to_string();
+    if ((event.flags_ & BinlogEvent::Flags::Compressed) != 0) {
+      auto r_event = detail::decompress_event(event);
+      if (r_event.is_error()) {
+        LOG(FATAL) << "Failed to decompress " << event.public_to_string() << ": " << r_event.error();
+      }
+      auto decompressed_event = r_event.move_as_ok();
+      loaded_compressed_events_size += decompressed_event.size_;
+      loaded_compressed_events_compressed_size += event.size_;
+      if (callback) {
+        callback(decompressed_event);
+      }
+      return;
+    }
     if (callback) {
       callback(event);
     }
   });
+  if (loaded_compressed_events_compressed_size != 0) {
+    LOG(INFO) << "Loaded compressed events " << tag("size", format::as_size(loaded_compressed_events_size))
+              << tag("compressed_size", format::as_size(loaded_compressed_events_compressed_size));
+  }
+
+  r_mapping = Status::Error("Binlog is loaded");  // all data was copied, so the mapping isn't needed anymore
 
   TRY_RESULT(fd_size, fd_.get_size());
+  fd_.seek(offset).ensure();
   if (offset != fd_size) {
     LOG(ERROR) << "Truncate " << tag("path", path_) << tag("old_size", fd_size) << tag("new_size", offset);
-    fd_.seek(offset).ensure();
     fd_.truncate_to_current_position(offset).ensure();
     db_key_used_ = false;  // force reindex
   }
   LOG_CHECK(fd_size_ == offset) << fd_size << " " << fd_size_ << " " << offset;
+  // partial events of an unfinished batch were truncated together with the rest of the tail
+  pending_events_.clear();
   binlog_reader_ptr_ = nullptr;
   state_ = State::Run;
 
@@ -575,6 +840,20 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
   return Status::OK();
 }
 
+Status Binlog::add_loaded_events(vector<BinlogEvent> &events, size_t events_size, const Callback &debug_callback) {
+  auto corrupted_event_pos = detail::find_first_corrupted_event(events, events_size);
+  for (size_t i = 0; i < corrupted_event_pos; i++) {
+    if (debug_callback) {
+      debug_callback(events[i]);
+    }
+    do_add_event(std::move(events[i]));
+  }
+  if (corrupted_event_pos != events.size()) {
+    return events[corrupted_event_pos].verify_crc();
+  }
+  return Status::OK();
+}
+
 void Binlog::update_encryption(Slice key, Slice iv) {
   as_slice(aes_ctr_key_).copy_from(key);
   UInt128 aes_ctr_iv;
@@ -582,12 +861,8 @@ void Binlog::update_encryption(Slice key, Slice iv) {
   aes_ctr_state_.init(as_slice(aes_ctr_key_), as_slice(aes_ctr_iv));
 }
 
-void Binlog::reset_encryption() {
-  if (db_key_.is_empty()) {
-    encryption_type_ = EncryptionType::None;
-    return;
-  }
-
+detail::AesCtrEncryptionEvent Binlog::create_encryption_event(BufferSlice &key) const {
+  CHECK(!db_key_.is_empty());
   using EncryptionEvent = detail::AesCtrEncryptionEvent;
   EncryptionEvent event;
 
@@ -600,7 +875,6 @@ void Binlog::reset_encryption() {
   event.iv_ = BufferSlice(EncryptionEvent::iv_size());
   Random::secure_bytes(event.iv_.as_slice());
 
-  BufferSlice key;
   if (aes_ctr_key_salt_.as_slice() == event.key_salt_.as_slice()) {
     key = BufferSlice(as_slice(aes_ctr_key_));
   } else {
@@ -608,13 +882,24 @@ void Binlog::reset_encryption() {
   }
 
   event.key_hash_ = event.generate_hash(key.as_slice());
+  return event;
+}
 
+void Binlog::reset_encryption() {
+  if (db_key_.is_empty()) {
+    encryption_type_ = EncryptionType::None;
+    return;
+  }
+
+  BufferSlice key;
+  auto event = create_encryption_event(key);
   do_event(BinlogEvent(
       BinlogEvent::create_raw(0, BinlogEvent::ServiceTypes::AesCtrEncryption, 0, create_default_storer(event)),
       BinlogDebugInfo{__FILE__, __LINE__}));
 }
 
 void Binlog::do_reindex() {
+  cancel_compaction();
   flush_events_buffer(true);
   // start reindex
   CHECK(state_ == State::Run);
@@ -689,6 +974,145 @@ void Binlog::do_reindex() {
   update_write_encryption();
 }
 
+void Binlog::start_compaction(bool is_key_change) {
+  CHECK(state_ == State::Run);
+  CHECK(compaction_ == nullptr);
+
+  string new_path = path_ + ".new";
+  auto r_opened_file = open_binlog(new_path, FileFd::Flags::Write | FileFd::Flags::Create | FileFd::Truncate);
+  if (r_opened_file.is_error()) {
+    LOG(ERROR) << "Can't open new binlog for compaction: " << r_opened_file.error();
+    return;
+  }
+
+  compaction_ = make_unique<detail::BinlogCompaction>();
+  compaction_->fd = BufferedFdBase<FileFd>(r_opened_file.move_as_ok());
+  compaction_->buffer_reader = compaction_->buffer_writer.extract_reader();
+  compaction_->fd.set_output_reader(&compaction_->buffer_reader);
+  compaction_->is_key_change = is_key_change;
+  compaction_->start_time = Clocks::monotonic();
+  compaction_->start_size = fd_size_;
+  compaction_->start_events = fd_events_;
+
+  if (!db_key_.is_empty()) {
+    // the encryption event itself is written unencrypted
+    BufferSlice key;
+    auto event = create_encryption_event(key);
+    auto raw_event =
+        BinlogEvent::create_raw(0, BinlogEvent::ServiceTypes::AesCtrEncryption, 0, create_default_storer(event));
+    compaction_->fd_size += static_cast<int64>(raw_event.size());
+    compaction_->fd_events++;
+    compaction_->buffer_writer.append(std::move(raw_event));
+    compaction_->buffer_reader.sync_with_writer();
+    compaction_->fd.flush_write().ensure();
+    LOG_IF(FATAL, compaction_->fd.need_flush_write()) << "Failed to flush new binlog";
+
+    UInt128 iv;
+    as_slice(iv).copy_from(event.iv_.as_slice());
+    compaction_->is_encrypted = true;
+    compaction_->key_salt = std::move(event.key_salt_);
+    as_slice(compaction_->key).copy_from(key.as_slice());
+    compaction_->aes_xcode_byte_flow.init(compaction_->key, iv);
+    compaction_->byte_flow_source = ByteFlowSource(&compaction_->buffer_reader);
+    compaction_->byte_flow_source >> compaction_->aes_xcode_byte_flow >> compaction_->byte_flow_sink;
+    compaction_->fd.set_output_reader(compaction_->byte_flow_sink.get_output());
+  }
+
+  processor_->for_each([&](BinlogEvent &event) { compaction_->events.push_back(event.raw_event_.clone()); });
+  VLOG(binlog) << "Start " << (is_key_change ? "key change" : "compaction") << " of " << compaction_->events.size()
+               << " events";
+}
+
+void Binlog::continue_compaction() {
+  CHECK(compaction_ != nullptr);
+  auto &compaction = *compaction_;
+  size_t copied_size = 0;
+  while (copied_size < detail::BinlogCompaction::CHUNK_SIZE && compaction.next_event < compaction.events.size()) {
+    auto event = std::move(compaction.events[compaction.next_event++]);
+    copied_size += event.size();
+    compaction.fd_size += static_cast<int64>(event.size());
+    compaction.fd_events++;
+    if (compaction.is_encrypted) {
+      compaction.buffer_writer.append(event.as_slice());
+    } else {
+      compaction.buffer_writer.append(std::move(event));
+    }
+  }
+  compaction.buffer_reader.sync_with_writer();
+  if (compaction.is_encrypted) {
+    compaction.byte_flow_source.wakeup();
+  }
+  compaction.fd.flush_write().ensure();
+  LOG_IF(FATAL, compaction.fd.need_flush_write()) << "Failed to flush new binlog";
+
+  if (compaction.next_event == compaction.events.size()) {
+    finish_compaction();
+  }
+}
+
+void Binlog::finish_compaction() {
+  CHECK(compaction_ != nullptr);
+  auto compaction = std::move(compaction_);
+  CHECK(compaction->buffer_reader.empty());
+  auto status = compaction->fd.sync_data();
+  LOG_IF(FATAL, status.is_error()) << "Failed to sync new binlog: " << status;
+
+  flush();
+  CHECK(buffer_reader_.empty());
+  string new_path = path_ + ".new";
+  status = unlink(path_);
+  LOG_IF(FATAL, status.is_error()) << "Failed to unlink old binlog: " << status;
+  auto old_fd = std::move(fd_);
+  fd_ = std::move(compaction->fd);
+  old_fd.close();  // now we can close old file and release the system lock
+  status = rename(new_path, path_);
+  FileFd::remove_local_lock(new_path);  // now we can release local lock for temporary file
+  LOG_IF(FATAL, status.is_error()) << "Failed to rename binlog: " << status;
+
+  buffer_writer_ = ChainBufferWriter();
+  buffer_reader_ = buffer_writer_.extract_reader();
+  if (compaction->is_encrypted) {
+    encryption_type_ = EncryptionType::AesCtr;
+    aes_ctr_key_salt_ = std::move(compaction->key_salt);
+    aes_ctr_key_ = compaction->key;
+    aes_ctr_state_ = compaction->aes_xcode_byte_flow.move_aes_ctr_state();
+  } else {
+    encryption_type_ = EncryptionType::None;
+  }
+  update_write_encryption();
+  fd_size_ = compaction->fd_size;
+  fd_events_ = compaction->fd_events;
+  need_sync_ = false;
+  LOG_CHECK(fd_size_ == detail::file_size(path_))
+      << fd_size_ << ' ' << detail::file_size(path_) << ' ' << fd_events_ << ' ' << path_;
+
+  auto finish_time = Clocks::monotonic();
+  double ratio = static_cast<double>(compaction->start_size) / static_cast<double>(fd_size_ + 1);
+  LOG(INFO) << (compaction->is_key_change ? "Change key of binlog " : "Compact binlog ") << tag("name", path_)
+            << tag("time", format::as_time(finish_time - compaction->start_time))
+            << tag("before_size", format::as_size(compaction->start_size))
+            << tag("after_size", format::as_size(fd_size_)) << tag("ratio", ratio)
+            << tag("before_events", compaction->start_events) << tag("after_events", fd_events_);
+}
+
+double Binlog::get_compaction_progress() const {
+  if (compaction_ == nullptr || compaction_->events.empty()) {
+    return 1.0;
+  }
+  return static_cast<double>(compaction_->next_event) / static_cast<double>(compaction_->events.size());
+}
+
+void Binlog::cancel_compaction() {
+  if (compaction_ == nullptr) {
+    return;
+  }
+  string new_path = path_ + ".new";
+  compaction_->fd.close();
+  compaction_ = nullptr;
+  unlink(new_path).ignore();
+  FileFd::remove_local_lock(new_path);
+}
+
 string Binlog::debug_get_binlog_data(int64 begin_offset, int64 end_offset) {
   if (begin_offset > end_offset) {
     return "Begin offset is bigger than end_offset";
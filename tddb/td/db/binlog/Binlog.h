@@ -23,6 +23,7 @@
 #include "td/utils/StorerBase.h"
 #include "td/utils/UInt.h"
 
+#include <atomic>
 #include <functional>
 
 namespace td {
@@ -36,8 +37,10 @@ struct BinlogInfo {
 };
 
 namespace detail {
+struct AesCtrEncryptionEvent;
 class BinlogReader;
 class BinlogEventsProcessor;
+struct BinlogCompaction;
 class BinlogEventsBuffer;
 }  // namespace detail
 
@@ -97,6 +100,8 @@ class Binlog {
 
   void add_event(BinlogEvent &&event);
   void sync();
+  // flushes pending events and starts writing them to the disk; sync must be called to wait for the completion
+  void start_sync();
   void flush();
   void lazy_flush();
   double need_flush_since() const {
@@ -104,6 +109,14 @@ class Binlog {
   }
   void change_key(DbKey new_db_key);
 
+  // starts incremental rewriting of the binlog with the new key; the binlog remains usable during the rewriting,
+  // and the new key is used by the binlog on the disk after the compaction is finished
+  void start_change_key(DbKey new_db_key);
+  // copies the next chunk of events to the new binlog file; new events are added during the compaction too
+  void continue_compaction();
+  // returns the part of events, which were already copied to the new file
+  double get_compaction_progress() const;
+
   Status close(bool need_sync = true) TD_WARN_UNUSED_RESULT;
   void close(Promise<> promise);
   Status close_and_destroy() TD_WARN_UNUSED_RESULT;
@@ -117,6 +130,14 @@ class Binlog {
     return info_;
   }
 
+  bool is_compaction_in_progress() const {
+    return compaction_ != nullptr;
+  }
+
+  // events with data not smaller than the size are stored gzip-compressed, if this saves at least 10% of the space;
+  // 0 disables compression; compressed events are always decompressed before they are passed to the callback
+  static void set_min_compressed_event_size(size_t size);
+
  private:
   BufferedFdBase<FileFd> fd_;
   ChainBufferWriter buffer_writer_;
@@ -145,10 +166,13 @@ class Binlog {
   std::vector<BinlogEvent> pending_events_;
   unique_ptr<detail::BinlogEventsProcessor> processor_;
   unique_ptr<detail::BinlogEventsBuffer> events_buffer_;
+  unique_ptr<detail::BinlogCompaction> compaction_;
   bool in_flush_events_buffer_{false};
   uint64 last_id_{0};
   double need_flush_since_ = 0;
   bool need_sync_{false};
+  int64 compressed_events_size_{0};
+  int64 compressed_events_compressed_size_{0};
   enum class State { Empty, Load, Reindex, Run } state_{State::Empty};
 
   Result<FileFd> open_binlog(const string &path, int32 flags);
@@ -156,14 +180,22 @@ class Binlog {
   void do_add_event(BinlogEvent &&event);
   void do_event(BinlogEvent &&event);
   Status load_binlog(const Callback &callback, const Callback &debug_callback = Callback()) TD_WARN_UNUSED_RESULT;
+  Status add_loaded_events(vector<BinlogEvent> &events, size_t events_size, const Callback &debug_callback) TD_WARN_UNUSED_RESULT;
   void do_reindex();
 
+  void start_compaction(bool is_key_change);
+  void finish_compaction();
+  void cancel_compaction();
+
   void update_encryption(Slice key, Slice iv);
+  detail::AesCtrEncryptionEvent create_encryption_event(BufferSlice &key) const;
   void reset_encryption();
   void update_read_encryption();
   void update_write_encryption();
 
   string debug_get_binlog_data(int64 begin_offset, int64 end_offset);
+
+  static std::atomic<size_t> min_compressed_event_size_;
 };
 
 }  // namespace td
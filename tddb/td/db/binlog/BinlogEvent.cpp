@@ -27,15 +27,24 @@ Status BinlogEvent::init(BufferSlice &&raw_event, bool check_crc) {
   auto slice_data = parser.fetch_string_raw<Slice>(size_ - MIN_SIZE);
   data_ = MutableSlice(const_cast<char *>(slice_data.begin()), slice_data.size());
   crc32_ = static_cast<uint32>(parser.fetch_int());
+  raw_event_ = std::move(raw_event);
   if (check_crc) {
-    CHECK(size_ >= TAIL_SIZE);
-    auto calculated_crc = crc32(raw_event.as_slice().truncate(size_ - TAIL_SIZE));
-    if (calculated_crc != crc32_) {
-      return Status::Error(PSLICE() << "crc mismatch " << tag("actual", format::as_hex(calculated_crc))
-                                    << tag("expected", format::as_hex(crc32_)) << public_to_string());
+    auto status = verify_crc();
+    if (status.is_error()) {
+      raw_event_ = BufferSlice();
+      return status;
     }
   }
-  raw_event_ = std::move(raw_event);
+  return Status::OK();
+}
+
+Status BinlogEvent::verify_crc() const {
+  CHECK(size_ >= TAIL_SIZE);
+  auto calculated_crc = crc32(raw_event_.as_slice().truncate(size_ - TAIL_SIZE));
+  if (calculated_crc != crc32_) {
+    return Status::Error(PSLICE() << "crc mismatch " << tag("actual", format::as_hex(calculated_crc))
+                                  << tag("expected", format::as_hex(crc32_)) << public_to_string());
+  }
   return Status::OK();
 }
 
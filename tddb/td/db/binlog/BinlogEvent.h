@@ -70,7 +70,7 @@ struct BinlogEvent {
   BinlogDebugInfo debug_info_;
 
   enum ServiceTypes { Header = -1, Empty = -2, AesCtrEncryption = -3, NoEncryption = -4 };
-  enum Flags { Rewrite = 1, Partial = 2 };
+  enum Flags { Rewrite = 1, Partial = 2, Compressed = 4 };
 
   void clear() {
     raw_event_ = BufferSlice();
@@ -81,7 +81,7 @@ struct BinlogEvent {
   BinlogEvent clone() const {
     BinlogEvent result;
     result.debug_info_ = BinlogDebugInfo{__FILE__, __LINE__};
-    result.init(raw_event_.clone()).ensure();
+    result.init(raw_event_.clone(), false).ensure();
     return result;
   }
 
@@ -100,6 +100,8 @@ struct BinlogEvent {
 
   Status init(BufferSlice &&raw_event, bool check_crc = true) TD_WARN_UNUSED_RESULT;
 
+  Status verify_crc() const TD_WARN_UNUSED_RESULT;
+
   static BufferSlice create_raw(uint64 id, int32 type, int32 flags, const Storer &storer);
 
   std::string public_to_string() const {
@@ -13,6 +13,8 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/Storer.h"
 #include "td/utils/StorerBase.h"
 
 namespace td {
@@ -77,4 +79,70 @@ class BinlogInterface {
   virtual void add_raw_event_impl(uint64 id, BufferSlice &&raw_event, Promise<> promise, BinlogDebugInfo info) = 0;
 };
 
+// a sequence of binlog changes, which are replayed either all together or not at all
+// the changes are sent to the binlog only on commit, and events added to the binlog after the first change
+// aren't written until then, so the batch must be committed right after it is filled
+class BinlogBatch {
+ public:
+  explicit BinlogBatch(BinlogInterface *binlog) : binlog_(binlog) {
+  }
+  BinlogBatch(const BinlogBatch &) = delete;
+  BinlogBatch &operator=(const BinlogBatch &) = delete;
+  BinlogBatch(BinlogBatch &&) = delete;
+  BinlogBatch &operator=(BinlogBatch &&) = delete;
+  ~BinlogBatch() {
+    LOG_CHECK(events_.empty()) << "Binlog batch wasn't committed";
+  }
+
+  uint64 add(int32 type, const Storer &storer) {
+    auto log_event_id = binlog_->next_id();
+    add_event(log_event_id, log_event_id, type, 0, storer);
+    return log_event_id;
+  }
+
+  void rewrite(uint64 log_event_id, int32 type, const Storer &storer) {
+    add_event(binlog_->next_id(), log_event_id, type, BinlogEvent::Flags::Rewrite, storer);
+  }
+
+  void erase(uint64 log_event_id) {
+    add_event(binlog_->next_id(), log_event_id, BinlogEvent::ServiceTypes::Empty, BinlogEvent::Flags::Rewrite,
+              EmptyStorer());
+  }
+
+  // the promise is set after all changes are synced
+  void commit(Promise<> promise = Promise<>()) {
+    for (size_t i = 0; i < events_.size(); i++) {
+      auto &event = events_[i];
+      bool is_last = i + 1 == events_.size();
+      auto flags = is_last ? event.flags : event.flags | BinlogEvent::Flags::Partial;
+      auto raw_event =
+          BinlogEvent::create_raw(event.log_event_id, event.type, flags, SliceStorer(event.data.as_slice()));
+      binlog_->add_raw_event(event.seq_no, std::move(raw_event), is_last ? std::move(promise) : Promise<>());
+    }
+    if (events_.empty()) {
+      promise.set_value(Unit());
+    }
+    events_.clear();
+  }
+
+ private:
+  struct Event {
+    uint64 seq_no;
+    uint64 log_event_id;
+    int32 type;
+    int32 flags;
+    BufferSlice data;
+  };
+
+  BinlogInterface *binlog_;
+  vector<Event> events_;
+
+  void add_event(uint64 seq_no, uint64 log_event_id, int32 type, int32 flags, const Storer &storer) {
+    BufferSlice data(storer.size());
+    auto real_size = storer.store(data.as_slice().ubegin());
+    CHECK(real_size == data.size());
+    events_.push_back(Event{seq_no, log_event_id, type, flags, std::move(data)});
+  }
+};
+
 }  // namespace td
@@ -8,25 +8,81 @@
 
 #include "td/utils/logging.h"
 #include "td/utils/OrderedEventsProcessor.h"
+#include "td/utils/port/thread_local.h"
 #include "td/utils/Time.h"
 
+#include <algorithm>
 #include <map>
+#include <memory>
 
 namespace td {
+
+std::atomic<double> ConcurrentBinlog::group_commit_window_{0.0};
+
 namespace detail {
+// Binlogs of all BinlogActors running in the same thread, which need to be synced within the group commit window,
+// are synced together. Writing of all binlogs to the disk is started at once and then every binlog is synced,
+// so the disk can process all the writes in a single batch
+class BinlogSyncGroup {
+ public:
+  static std::shared_ptr<BinlogSyncGroup> get() {
+    static TD_THREAD_LOCAL std::shared_ptr<BinlogSyncGroup> *group;
+    init_thread_local<std::shared_ptr<BinlogSyncGroup>>(group, std::make_shared<BinlogSyncGroup>());
+    return *group;
+  }
+
+  // returns time, when the binlogs will be synced
+  double add(BinlogActor *actor, double window) {
+    if (actors_.empty()) {
+      sync_at_ = Time::now_cached() + window;
+    }
+    actors_.push_back(actor);
+    return sync_at_;
+  }
+
+  void remove(BinlogActor *actor) {
+    auto it = std::find(actors_.begin(), actors_.end(), actor);
+    if (it != actors_.end()) {
+      actors_.erase(it);
+    }
+  }
+
+  bool is_ready() const {
+    return !actors_.empty() && Time::now_cached() >= sync_at_ - 1e-9;
+  }
+
+  void sync();
+
+ private:
+  vector<BinlogActor *> actors_;
+  double sync_at_ = 0;
+};
+
 class BinlogActor : public Actor {
  public:
   BinlogActor(unique_ptr<Binlog> binlog, uint64 seq_no) : binlog_(std::move(binlog)), processor_(seq_no) {
   }
+  BinlogActor(const BinlogActor &) = delete;
+  BinlogActor &operator=(const BinlogActor &) = delete;
+  BinlogActor(BinlogActor &&) = delete;
+  BinlogActor &operator=(BinlogActor &&) = delete;
+  ~BinlogActor() override {
+    leave_sync_group();
+  }
+
   void close(Promise<> promise) {
-    binlog_->close().ensure();
+    leave_sync_group();
+    binlog_->close().ensure();  // finishes the key change if any
+    set_change_key_promises();
     LOG(INFO) << "Finished to close binlog";
     stop();
 
     promise.set_value(Unit());  // setting promise can complete closing and destroy the current actor context
   }
   void close_and_destroy(Promise<> promise) {
+    leave_sync_group();
     binlog_->close_and_destroy().ensure();
+    set_change_key_promises();
     LOG(INFO) << "Finished to destroy binlog";
     stop();
 
@@ -64,18 +120,26 @@ class BinlogActor : public Actor {
     flush_flag_ = false;
   }
 
+  // the binlog is rewritten with the new key in chunks, interleaved with other requests to the actor,
+  // so adding events isn't blocked for the whole rewriting
   void change_key(DbKey db_key, Promise<> promise) {
-    binlog_->change_key(std::move(db_key));
-    promise.set_value(Unit());
+    binlog_->start_change_key(std::move(db_key));
+    change_key_promises_.push_back(std::move(promise));
+    loop();
   }
 
  private:
+  friend class BinlogSyncGroup;
+
   unique_ptr<Binlog> binlog_;
 
   OrderedEventsProcessor<Event> processor_;
+  std::shared_ptr<BinlogSyncGroup> sync_group_;
+  double sync_at_ = 0;
 
   std::multimap<uint64, Promise<>> immediate_sync_promises_;
   std::vector<Promise<>> sync_promises_;
+  std::vector<Promise<>> change_key_promises_;
   bool force_sync_flag_ = false;
   bool lazy_sync_flag_ = false;
   bool flush_flag_ = false;
@@ -83,6 +147,33 @@ class BinlogActor : public Actor {
 
   static constexpr double FLUSH_TIMEOUT = 0.001;  // 1ms
 
+  void start_up() override {
+    // the binlog waits for a timeout while it is in a thread-local sync group, so it is never stolen from the group
+    allow_stealing();
+  }
+
+  void loop() override {
+    if (change_key_promises_.empty()) {
+      return;
+    }
+    if (binlog_->is_compaction_in_progress()) {
+      binlog_->continue_compaction();
+    }
+    if (binlog_->is_compaction_in_progress()) {
+      VLOG(binlog) << "Binlog key change progress: " << binlog_->get_compaction_progress();
+      yield();
+      return;
+    }
+    set_change_key_promises();
+  }
+
+  void set_change_key_promises() {
+    for (auto &promise : change_key_promises_) {
+      promise.set_value(Unit());
+    }
+    change_key_promises_.clear();
+  }
+
   void wakeup_after(double after) {
     auto now = Time::now_cached();
     wakeup_at(now + after);
@@ -148,21 +239,65 @@ class BinlogActor : public Actor {
     bool need_flush = flush_flag_;
     flush_flag_ = false;
     wakeup_at_ = 0;
-    if (need_sync) {
-      binlog_->sync();
-      // LOG(ERROR) << "BINLOG SYNC";
-      for (auto &promise : sync_promises_) {
-        promise.set_value(Unit());
+    if (sync_group_ != nullptr) {
+      // the binlog is waiting for the group sync, which will also sync all events added after joining the group
+      if (sync_group_->is_ready()) {
+        sync_group_->sync();
+      } else {
+        wakeup_at(sync_at_);
+        if (need_flush) {
+          try_flush();
+        }
+      }
+    } else if (need_sync) {
+      auto window = ConcurrentBinlog::get_group_commit_window();
+      if (window > 0) {
+        sync_group_ = BinlogSyncGroup::get();
+        sync_at_ = sync_group_->add(this, window);
+        wakeup_at(sync_at_);
+      } else {
+        do_sync();
       }
-      sync_promises_.clear();
     } else if (need_flush) {
       try_flush();
       // LOG(ERROR) << "BINLOG FLUSH";
     }
   }
+
+  void do_sync() {
+    binlog_->sync();
+    // LOG(ERROR) << "BINLOG SYNC";
+    for (auto &promise : sync_promises_) {
+      promise.set_value(Unit());
+    }
+    sync_promises_.clear();
+  }
+
+  void leave_sync_group() {
+    if (sync_group_ != nullptr) {
+      sync_group_->remove(this);
+      sync_group_ = nullptr;
+    }
+  }
 };
+
+void BinlogSyncGroup::sync() {
+  auto actors = std::move(actors_);
+  actors_.clear();
+  for (auto actor : actors) {
+    actor->binlog_->start_sync();
+  }
+  for (auto actor : actors) {
+    actor->sync_group_ = nullptr;
+    actor->do_sync();
+  }
+}
 }  // namespace detail
 
+void ConcurrentBinlog::set_group_commit_window(double window) {
+  group_commit_window_.store(max(window, 0.0), std::memory_order_relaxed);
+}
+
 ConcurrentBinlog::ConcurrentBinlog() = default;
 ConcurrentBinlog::~ConcurrentBinlog() = default;
 ConcurrentBinlog::ConcurrentBinlog(unique_ptr<Binlog> binlog, int scheduler_id) {
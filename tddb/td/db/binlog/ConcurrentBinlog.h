@@ -56,6 +56,14 @@ class ConcurrentBinlog : public BinlogInterface {
     return path_;
   }
 
+  // if positive, syncs of all binlogs with actors on the same thread, requested within the window,
+  // are batched together; promises are still set only after the corresponding binlog is synced
+  static void set_group_commit_window(double window);
+
+  static double get_group_commit_window() {
+    return group_commit_window_.load(std::memory_order_relaxed);
+  }
+
  private:
   void init_impl(unique_ptr<Binlog> binlog, int scheduler_id);
   void close_impl(Promise<> promise) override;
@@ -65,6 +73,8 @@ class ConcurrentBinlog : public BinlogInterface {
   ActorOwn<detail::BinlogActor> binlog_actor_;
   string path_;
   std::atomic<uint64> last_id_{0};
+
+  static std::atomic<double> group_commit_window_;
 };
 
 }  // namespace td
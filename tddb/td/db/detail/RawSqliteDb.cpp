@@ -13,9 +13,44 @@
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
 
+#include <algorithm>
+#include <mutex>
+
 namespace td {
 namespace detail {
 
+namespace {
+struct Registry {
+  std::mutex mutex;
+  vector<sqlite3 *> databases;
+};
+
+Registry &get_registry() {
+  static Registry registry;
+  return registry;
+}
+}  // namespace
+
+RawSqliteDb::RawSqliteDb(sqlite3 *db, std::string path) : db_(db), path_(std::move(path)) {
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.databases.push_back(db_);
+}
+
+int64 RawSqliteDb::get_total_cache_size() {
+  int64 result = 0;
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto db : registry.databases) {
+    int current = 0;
+    int highwater = 0;
+    if (sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_USED, &current, &highwater, 0) == SQLITE_OK) {
+      result += current;
+    }
+  }
+  return result;
+}
+
 Status RawSqliteDb::last_error(sqlite3 *db, CSlice path) {
   return Status::Error(PSLICE() << Slice(sqlite3_errmsg(db)) << " for database \"" << path << '"');
 }
@@ -42,6 +77,13 @@ Status RawSqliteDb::last_error() {
 }
 
 RawSqliteDb::~RawSqliteDb() {
+  {
+    auto &registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = std::find(registry.databases.begin(), registry.databases.end(), db_);
+    CHECK(it != registry.databases.end());
+    registry.databases.erase(it);
+  }
   auto rc = sqlite3_close(db_);
   LOG_IF(FATAL, rc != SQLITE_OK) << last_error(db_, path());
 }
@@ -18,8 +18,7 @@ namespace detail {
 
 class RawSqliteDb {
  public:
-  RawSqliteDb(sqlite3 *db, std::string path) : db_(db), path_(std::move(path)) {
-  }
+  RawSqliteDb(sqlite3 *db, std::string path);
   RawSqliteDb(const RawSqliteDb &) = delete;
   RawSqliteDb(RawSqliteDb &&) = delete;
   RawSqliteDb &operator=(const RawSqliteDb &) = delete;
@@ -45,6 +44,9 @@ class RawSqliteDb {
   Status last_error();
   static Status last_error(sqlite3 *db, CSlice path);
 
+  // returns total size of page caches of all opened databases
+  static int64 get_total_cache_size();
+
   bool on_begin() {
     begin_cnt_++;
     return begin_cnt_ == 1;
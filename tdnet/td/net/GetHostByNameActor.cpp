@@ -22,38 +22,60 @@ namespace detail {
 
 class GoogleDnsResolver : public Actor {
  public:
-  GoogleDnsResolver(std::string host, bool prefer_ipv6, Promise<IPAddress> promise)
-      : host_(std::move(host)), prefer_ipv6_(prefer_ipv6), promise_(std::move(promise)) {
+  GoogleDnsResolver(std::string host, bool prefer_ipv6, ActorId<HttpConnectionPool> connection_pool,
+                    Promise<std::pair<IPAddress, int32>> promise)
+      : host_(std::move(host))
+      , prefer_ipv6_(prefer_ipv6)
+      , connection_pool_(std::move(connection_pool))
+      , promise_(std::move(promise)) {
   }
 
  private:
+  // time to wait for an IPv6 address after an IPv4 address is received, as recommended by RFC 8305
+  static constexpr double RESOLUTION_DELAY = 0.05;
+
   std::string host_;
   bool prefer_ipv6_;
-  Promise<IPAddress> promise_;
-  ActorOwn<Wget> wget_;
+  ActorId<HttpConnectionPool> connection_pool_;
+  Promise<std::pair<IPAddress, int32>> promise_;
+  ActorOwn<Wget> wget_[2];  // A and AAAA queries
+  Result<std::pair<IPAddress, int32>> results_[2];
+  bool is_finished_[2] = {false, false};
   double begin_time_ = 0;
 
   void start_up() override {
     auto r_address = IPAddress::get_ip_address(host_);
     if (r_address.is_ok()) {
-      promise_.set_value(r_address.move_as_ok());
+      promise_.set_value(std::make_pair(r_address.move_as_ok(), 0));
       return stop();
     }
 
+    begin_time_ = Time::now();
+    // if IPv6 is preferred, A and AAAA queries are sent simultaneously, so a missing AAAA record costs nothing
+    send_query(false);
+    if (prefer_ipv6_) {
+      send_query(true);
+    } else {
+      is_finished_[1] = true;
+    }
+  }
+
+  void send_query(bool is_ipv6) {
     const int timeout = 10;
     const int ttl = 3;
-    begin_time_ = Time::now();
-    auto wget_promise = PromiseCreator::lambda([actor_id = actor_id(this)](Result<unique_ptr<HttpQuery>> r_http_query) {
-      send_closure(actor_id, &GoogleDnsResolver::on_result, std::move(r_http_query));
-    });
-    wget_ = create_actor<Wget>(
+    auto wget_promise =
+        PromiseCreator::lambda([actor_id = actor_id(this), is_ipv6](Result<unique_ptr<HttpQuery>> r_http_query) {
+          send_closure(actor_id, &GoogleDnsResolver::on_result, is_ipv6, std::move(r_http_query));
+        });
+    wget_[is_ipv6] = create_actor<Wget>(
         "GoogleDnsResolver", std::move(wget_promise),
-        PSTRING() << "https://dns.google/resolve?name=" << url_encode(host_) << "&type=" << (prefer_ipv6_ ? 28 : 1),
+        PSTRING() << "https://dns.google/resolve?name=" << url_encode(host_) << "&type=" << (is_ipv6 ? 28 : 1),
         std::vector<std::pair<string, string>>({{"Host", "dns.google"}}), timeout, ttl, prefer_ipv6_,
-        SslStream::VerifyPeer::Off);
+        SslStream::VerifyPeer::Off, string(), string(), connection_pool_);
   }
 
-  static Result<IPAddress> get_ip_address(Result<unique_ptr<HttpQuery>> r_http_query) {
+  static Result<std::pair<IPAddress, int32>> get_ip_address(Result<unique_ptr<HttpQuery>> r_http_query,
+                                                            bool is_ipv6) {
     TRY_RESULT(http_query, std::move(r_http_query));
     TRY_RESULT(json_value, json_decode(http_query->content_));
     if (json_value.type() != JsonValue::Type::Object) {
@@ -64,37 +86,63 @@ class GoogleDnsResolver : public Actor {
     if (array.size() == 0) {
       return Status::Error("Failed to parse DNS result: Answer is an empty array");
     }
-    if (array[0].type() != JsonValue::Type::Object) {
-      return Status::Error("Failed to parse DNS result: Answer[0] is not an object");
+    for (auto &answer_value : array) {
+      if (answer_value.type() != JsonValue::Type::Object) {
+        return Status::Error("Failed to parse DNS result: Answer item is not an object");
+      }
+      auto &answer_object = answer_value.get_object();
+      // skip CNAME and other records preceding the address
+      TRY_RESULT(type, get_json_object_int_field(answer_object, "type"));
+      if (type != (is_ipv6 ? 28 : 1)) {
+        continue;
+      }
+      TRY_RESULT(ip_str, get_json_object_string_field(answer_object, "data", false));
+      TRY_RESULT(ttl, get_json_object_int_field(answer_object, "TTL"));
+      IPAddress ip;
+      TRY_STATUS(ip.init_host_port(ip_str, 0));
+      return std::make_pair(std::move(ip), td::max(ttl, 0));
     }
-    auto &answer_0 = array[0].get_object();
-    TRY_RESULT(ip_str, get_json_object_string_field(answer_0, "data", false));
-    IPAddress ip;
-    TRY_STATUS(ip.init_host_port(ip_str, 0));
-    return ip;
+    return Status::Error("Failed to parse DNS result: Answer has no address");
   }
 
-  void on_result(Result<unique_ptr<HttpQuery>> r_http_query) {
+  void on_result(bool is_ipv6, Result<unique_ptr<HttpQuery>> r_http_query) {
     auto end_time = Time::now();
-    auto result = get_ip_address(std::move(r_http_query));
-    VLOG(dns_resolver) << "Init IPv" << (prefer_ipv6_ ? "6" : "4") << " host = " << host_ << " in "
+    auto result = get_ip_address(std::move(r_http_query), is_ipv6);
+    VLOG(dns_resolver) << "Init IPv" << (is_ipv6 ? "6" : "4") << " host = " << host_ << " in "
                        << end_time - begin_time_ << " seconds to "
-                       << (result.is_ok() ? (PSLICE() << result.ok()) : CSlice("[invalid]"));
-    promise_.set_result(std::move(result));
+                       << (result.is_ok() ? (PSLICE() << result.ok().first) : CSlice("[invalid]"));
+    results_[is_ipv6] = std::move(result);
+    is_finished_[is_ipv6] = true;
+
+    if (is_finished_[1] && (results_[1].is_ok() || is_finished_[0])) {
+      return finish(results_[1].is_ok());
+    }
+    if (is_finished_[0] && results_[0].is_ok() && !has_timeout()) {
+      set_timeout_in(RESOLUTION_DELAY);
+    }
+  }
+
+  void timeout_expired() override {
+    CHECK(is_finished_[0]);
+    finish(false);
+  }
+
+  void finish(bool is_ipv6) {
+    promise_.set_result(std::move(results_[is_ipv6]));
     stop();
   }
 };
 
 class NativeDnsResolver : public Actor {
  public:
-  NativeDnsResolver(std::string host, bool prefer_ipv6, Promise<IPAddress> promise)
+  NativeDnsResolver(std::string host, bool prefer_ipv6, Promise<std::pair<IPAddress, int32>> promise)
       : host_(std::move(host)), prefer_ipv6_(prefer_ipv6), promise_(std::move(promise)) {
   }
 
  private:
   std::string host_;
   bool prefer_ipv6_;
-  Promise<IPAddress> promise_;
+  Promise<std::pair<IPAddress, int32>> promise_;
 
   void start_up() override {
     IPAddress ip;
@@ -105,7 +153,8 @@ class NativeDnsResolver : public Actor {
     if (status.is_error()) {
       promise_.set_error(std::move(status));
     } else {
-      promise_.set_value(std::move(ip));
+      // getaddrinfo doesn't return TTL
+      promise_.set_value(std::make_pair(std::move(ip), 0));
     }
     stop();
   }
@@ -119,6 +168,14 @@ GetHostByNameActor::GetHostByNameActor(Options options) : options_(std::move(opt
   CHECK(!options_.resolver_types.empty());
 }
 
+int32 GetHostByNameActor::get_cache_timeout(int32 ttl) const {
+  if (ttl <= 0) {
+    return options_.ok_timeout;
+  }
+  // respect record TTL, but don't requery too often if it is very small
+  return td::max(td::min(ttl, options_.ok_timeout), td::min(Options::MIN_CACHE_TIME, options_.ok_timeout));
+}
+
 void GetHostByNameActor::run(string host, int port, bool prefer_ipv6, Promise<IPAddress> promise) {
   if (host.empty()) {
     return promise.set_error(Status::Error("Host is empty"));
@@ -147,9 +204,10 @@ void GetHostByNameActor::run(string host, int port, bool prefer_ipv6, Promise<IP
 }
 
 void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &query) {
-  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), host, prefer_ipv6](Result<IPAddress> res) mutable {
-    send_closure(actor_id, &GetHostByNameActor::on_query_result, std::move(host), prefer_ipv6, std::move(res));
-  });
+  auto promise = PromiseCreator::lambda(
+      [actor_id = actor_id(this), host, prefer_ipv6](Result<std::pair<IPAddress, int32>> res) mutable {
+        send_closure(actor_id, &GetHostByNameActor::on_query_result, std::move(host), prefer_ipv6, std::move(res));
+      });
 
   CHECK(query.query.empty());
   CHECK(query.pos < options_.resolver_types.size());
@@ -160,8 +218,13 @@ void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &qu
         return ActorOwn<>(create_actor_on_scheduler<detail::NativeDnsResolver>(
             "NativeDnsResolver", options_.scheduler_id, std::move(host), prefer_ipv6, std::move(promise)));
       case ResolverType::Google:
+        if (connection_pool_.empty()) {
+          connection_pool_ =
+              create_actor_on_scheduler<HttpConnectionPool>("DnsConnectionPool", options_.scheduler_id);
+        }
         return ActorOwn<>(create_actor_on_scheduler<detail::GoogleDnsResolver>(
-            "GoogleDnsResolver", options_.scheduler_id, std::move(host), prefer_ipv6, std::move(promise)));
+            "GoogleDnsResolver", options_.scheduler_id, std::move(host), prefer_ipv6, connection_pool_.get(),
+            std::move(promise)));
       default:
         UNREACHABLE();
         return ActorOwn<>();
@@ -169,7 +232,8 @@ void GetHostByNameActor::run_query(std::string host, bool prefer_ipv6, Query &qu
   }();
 }
 
-void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Result<IPAddress> result) {
+void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6,
+                                         Result<std::pair<IPAddress, int32>> result) {
   auto query_it = active_queries_[prefer_ipv6].find(host);
   CHECK(query_it != active_queries_[prefer_ipv6].end());
   auto &query = query_it->second;
@@ -183,13 +247,17 @@ void GetHostByNameActor::on_query_result(std::string host, bool prefer_ipv6, Res
 
   auto end_time = Time::now();
   VLOG(dns_resolver) << "Init host = " << query.real_host << " in total of " << end_time - query.begin_time
-                     << " seconds to " << (result.is_ok() ? (PSLICE() << result.ok()) : CSlice("[invalid]"));
+                     << " seconds to " << (result.is_ok() ? (PSLICE() << result.ok().first) : CSlice("[invalid]"));
 
   auto promises = std::move(query.promises);
   auto value_it = cache_[prefer_ipv6].find(host);
   CHECK(value_it != cache_[prefer_ipv6].end());
-  auto cache_timeout = result.is_ok() ? options_.ok_timeout : options_.error_timeout;
-  value_it->second = Value{std::move(result), end_time + cache_timeout};
+  if (result.is_ok()) {
+    auto cache_timeout = get_cache_timeout(result.ok().second);
+    value_it->second = Value{result.move_as_ok().first, end_time + cache_timeout};
+  } else {
+    value_it->second = Value{result.move_as_error(), end_time + options_.error_timeout};
+  }
   active_queries_[prefer_ipv6].erase(query_it);
 
   for (auto &promise : promises) {
@@ -6,6 +6,8 @@
 //
 #pragma once
 
+#include "td/net/HttpConnectionPool.h"
+
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
@@ -27,10 +29,11 @@ class GetHostByNameActor final : public Actor {
   struct Options {
     static constexpr int32 DEFAULT_CACHE_TIME = 60 * 29;       // 29 minutes
     static constexpr int32 DEFAULT_ERROR_CACHE_TIME = 60 * 5;  // 5 minutes
+    static constexpr int32 MIN_CACHE_TIME = 30;                // minimum cache time for records with small TTL
 
     vector<ResolverType> resolver_types{ResolverType::Native};
     int32 scheduler_id{-1};
-    int32 ok_timeout{DEFAULT_CACHE_TIME};
+    int32 ok_timeout{DEFAULT_CACHE_TIME};  // maximum cache time for successfully resolved hosts
     int32 error_timeout{DEFAULT_ERROR_CACHE_TIME};
   };
 
@@ -39,7 +42,9 @@ class GetHostByNameActor final : public Actor {
   void run(std::string host, int port, bool prefer_ipv6, Promise<IPAddress> promise);
 
  private:
-  void on_query_result(std::string host, bool prefer_ipv6, Result<IPAddress> result);
+  void on_query_result(std::string host, bool prefer_ipv6, Result<std::pair<IPAddress, int32>> result);
+
+  int32 get_cache_timeout(int32 ttl) const;
 
   struct Value {
     Result<IPAddress> ip;
@@ -69,6 +74,9 @@ class GetHostByNameActor final : public Actor {
 
   Options options_;
 
+  // keep-alive connections to DNS-over-HTTPS servers
+  ActorOwn<HttpConnectionPool> connection_pool_;
+
   void run_query(std::string host, bool prefer_ipv6, Query &query);
 };
 
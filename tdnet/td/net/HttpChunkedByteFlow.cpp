@@ -53,7 +53,8 @@ bool HttpChunkedByteFlow::loop() {
       return false;
     }
 
-    output_.append(input_->cut_head(ready));
+    // chunk content is passed by reference to the buffers of the input
+    output_.append_by_reference(input_->cut_head(ready));
     result = true;
     len_ -= ready;
     if (uncommited_size_ >= MIN_UPDATE_SIZE) {
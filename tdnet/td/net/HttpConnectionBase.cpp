@@ -59,6 +59,7 @@ void HttpConnectionBase::tear_down() {
 
 void HttpConnectionBase::write_next_noflush(BufferSlice buffer) {
   CHECK(state_ == State::Write);
+  CHECK(file_.empty());
   write_buffer_.append(std::move(buffer));
 }
 void HttpConnectionBase::write_next(BufferSlice buffer) {
@@ -66,8 +67,26 @@ void HttpConnectionBase::write_next(BufferSlice buffer) {
   loop();
 }
 
+void HttpConnectionBase::write_file(FileFd file, int64 offset, int64 size) {
+  CHECK(state_ == State::Write);
+  CHECK(file_.empty());
+  CHECK(offset >= 0 && size >= 0);
+  if (size == 0) {
+    return;
+  }
+  file_ = std::move(file);
+  file_offset_ = offset;
+  file_left_size_ = size;
+  loop();
+}
+
 void HttpConnectionBase::write_ok() {
   CHECK(state_ == State::Write);
+  if (!file_.empty()) {
+    need_write_ok_ = true;
+    return;
+  }
+  on_write_ok();
   current_query_ = make_unique<HttpQuery>();
   state_ = State::Read;
   live_event();
@@ -81,6 +100,42 @@ void HttpConnectionBase::write_error(Status error) {
   loop();
 }
 
+// the file is sent only after the socket output buffer has been flushed, so at most one part of the file is kept
+// in memory, and the speed of reading from the file is limited by the speed of writing to the socket
+Status HttpConnectionBase::flush_write_file() {
+  while (!file_.empty() && !fd_.need_flush_write()) {
+    auto part_size = td::min(file_left_size_, MAX_FILE_PART_SIZE);
+    size_t written_size = 0;
+    if (ssl_stream_) {
+      // data must be encrypted, so it can't be sent directly from the file
+      BufferSlice part(narrow_cast<size_t>(part_size));
+      TRY_RESULT_ASSIGN(written_size, file_.pread(part.as_slice(), file_offset_));
+      if (written_size == 0) {
+        return Status::Error("Unexpected end of file");
+      }
+      part.truncate(written_size);
+      write_buffer_.append(std::move(part));
+      write_source_.wakeup();
+      TRY_STATUS(fd_.flush_write());
+    } else {
+      if (!can_write_local(fd_)) {
+        break;
+      }
+      TRY_RESULT_ASSIGN(written_size, fd_.write_file(file_, file_offset_, narrow_cast<size_t>(part_size)));
+      if (written_size == 0) {
+        break;
+      }
+    }
+    file_offset_ += static_cast<int64>(written_size);
+    file_left_size_ -= static_cast<int64>(written_size);
+    if (file_left_size_ == 0) {
+      file_.close();
+    }
+    live_event();
+  }
+  return Status::OK();
+}
+
 void HttpConnectionBase::timeout_expired() {
   LOG(INFO) << "Idle timeout expired";
 
@@ -159,6 +214,17 @@ void HttpConnectionBase::loop() {
       return stop();
     }
   }
+  if (!file_.empty()) {
+    auto status = flush_write_file();
+    if (status.is_error()) {
+      LOG(INFO) << "Failed to send file: " << status;
+      on_error(Status::Error(status.public_message()));
+      state_ = State::Close;
+    } else if (file_.empty() && need_write_ok_) {
+      need_write_ok_ = false;
+      return write_ok();
+    }
+  }
 
   Status pending_error;
   if (fd_.get_poll_info().get_flags_local().has_pending_error()) {
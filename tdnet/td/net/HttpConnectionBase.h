@@ -15,6 +15,8 @@
 #include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
 #include "td/utils/ByteFlow.h"
+#include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
 #include "td/utils/port/IPAddress.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Status.h"
@@ -27,6 +29,9 @@ class HttpConnectionBase : public Actor {
  public:
   void write_next_noflush(BufferSlice buffer);
   void write_next(BufferSlice buffer);
+  // sends size bytes of the file starting from the offset after all previously written data;
+  // the file isn't loaded to memory; only write_ok or write_error can be called after it
+  void write_file(FileFd file, int64 offset, int64 size);
   void write_ok();
   void write_error(Status error);
 
@@ -57,9 +62,16 @@ class HttpConnectionBase : public Actor {
   unique_ptr<HttpQuery> current_query_;
   bool close_after_write_ = false;
 
+  static constexpr int64 MAX_FILE_PART_SIZE = 1 << 20;
+  FileFd file_;
+  int64 file_offset_ = 0;
+  int64 file_left_size_ = 0;
+  bool need_write_ok_ = false;  // write_ok was called before the whole file was sent
+
   int32 slow_scheduler_id_{-1};
 
   void live_event();
+  Status flush_write_file() TD_WARN_UNUSED_RESULT;
 
   void start_up() override;
   void tear_down() override;
@@ -71,6 +83,8 @@ class HttpConnectionBase : public Actor {
 
   virtual void on_query(unique_ptr<HttpQuery> query) = 0;
   virtual void on_error(Status error) = 0;
+  virtual void on_write_ok() {
+  }
 };
 
 }  // namespace detail
@@ -0,0 +1,122 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/net/HttpConnectionPool.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/Time.h"
+
+namespace td {
+
+void HttpConnectionPool::get_connection(string key, ActorShared<HttpOutboundConnection::Callback> callback,
+                                        Promise<ActorOwn<HttpOutboundConnection>> promise) {
+  auto it = connections_.find(key);
+  if (it == connections_.end()) {
+    return promise.set_value(ActorOwn<HttpOutboundConnection>());
+  }
+
+  // the most recently used connection is the least likely to be already closed by the server
+  auto connection = std::move(it->second.back());
+  it->second.pop_back();
+  if (it->second.empty()) {
+    connections_.erase(it);
+  }
+  connection_keys_.erase(connection.id);
+
+  LOG(DEBUG) << "Reuse HTTP connection to " << key;
+  send_closure(connection.connection, &HttpOutboundConnection::set_callback, std::move(callback));
+  promise.set_value(std::move(connection.connection));
+}
+
+void HttpConnectionPool::put_connection(string key, ActorOwn<HttpOutboundConnection> connection) {
+  if (connection.empty()) {
+    return;
+  }
+
+  auto id = ++next_connection_id_;
+  send_closure(connection, &HttpOutboundConnection::set_callback, actor_shared(this, id));
+
+  auto &key_connections = connections_[key];
+  if (key_connections.size() >= max_idle_connections_per_key_) {
+    connection_keys_.erase(key_connections[0].id);
+    key_connections.erase(key_connections.begin());
+  }
+  connection_keys_[id] = key;
+  key_connections.push_back(IdleConnection{id, std::move(connection), Time::now()});
+
+  if (!has_timeout()) {
+    set_timeout_in(idle_timeout_);
+  }
+}
+
+void HttpConnectionPool::remove_connection(uint64 id) {
+  auto key_it = connection_keys_.find(id);
+  if (key_it == connection_keys_.end()) {
+    return;
+  }
+
+  auto it = connections_.find(key_it->second);
+  CHECK(it != connections_.end());
+  auto &key_connections = it->second;
+  for (size_t i = 0; i < key_connections.size(); i++) {
+    if (key_connections[i].id == id) {
+      key_connections.erase(key_connections.begin() + i);
+      break;
+    }
+  }
+  if (key_connections.empty()) {
+    connections_.erase(it);
+  }
+  connection_keys_.erase(key_it);
+}
+
+void HttpConnectionPool::handle(unique_ptr<HttpQuery> query) {
+  LOG(INFO) << "Receive unexpected response on an idle HTTP connection";
+  remove_connection(get_link_token());
+}
+
+void HttpConnectionPool::on_connection_error(Status error) {
+  LOG(DEBUG) << "Idle HTTP connection was closed: " << error;
+  remove_connection(get_link_token());
+}
+
+void HttpConnectionPool::hangup_shared() {
+  remove_connection(get_link_token());
+}
+
+void HttpConnectionPool::hangup() {
+  stop();
+}
+
+void HttpConnectionPool::timeout_expired() {
+  auto now = Time::now();
+  double next_timeout_at = 0;
+  for (auto it = connections_.begin(); it != connections_.end();) {
+    auto &key_connections = it->second;
+    size_t expired_count = 0;
+    while (expired_count < key_connections.size() &&
+           key_connections[expired_count].idle_since + idle_timeout_ <= now) {
+      connection_keys_.erase(key_connections[expired_count].id);
+      expired_count++;
+    }
+    key_connections.erase(key_connections.begin(), key_connections.begin() + expired_count);
+    if (key_connections.empty()) {
+      it = connections_.erase(it);
+      continue;
+    }
+
+    auto timeout_at = key_connections[0].idle_since + idle_timeout_;
+    if (next_timeout_at == 0 || timeout_at < next_timeout_at) {
+      next_timeout_at = timeout_at;
+    }
+    ++it;
+  }
+  if (next_timeout_at != 0) {
+    set_timeout_at(next_timeout_at);
+  }
+}
+
+}  // namespace td
@@ -0,0 +1,59 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/net/HttpOutboundConnection.h"
+#include "td/net/HttpQuery.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Status.h"
+
+#include <unordered_map>
+
+namespace td {
+
+// keeps idle keep-alive HTTP connections, so they can be reused by subsequent queries to the same server
+class HttpConnectionPool : public HttpOutboundConnection::Callback {
+ public:
+  explicit HttpConnectionPool(double idle_timeout = 30.0, size_t max_idle_connections_per_key = 4)
+      : idle_timeout_(idle_timeout), max_idle_connections_per_key_(max_idle_connections_per_key) {
+  }
+
+  // returns an idle connection to the server or an empty ActorOwn if there is none;
+  // the returned connection will pass received responses to the callback
+  void get_connection(string key, ActorShared<HttpOutboundConnection::Callback> callback,
+                      Promise<ActorOwn<HttpOutboundConnection>> promise);
+
+  // returns to the pool a connection, which has fully received a response and can be used for the next query
+  void put_connection(string key, ActorOwn<HttpOutboundConnection> connection);
+
+ private:
+  struct IdleConnection {
+    uint64 id = 0;
+    ActorOwn<HttpOutboundConnection> connection;
+    double idle_since = 0;
+  };
+
+  double idle_timeout_;
+  size_t max_idle_connections_per_key_;
+  uint64 next_connection_id_ = 0;
+  std::unordered_map<string, vector<IdleConnection>> connections_;
+  std::unordered_map<uint64, string> connection_keys_;
+
+  void handle(unique_ptr<HttpQuery> query) override;
+  void on_connection_error(Status error) override;
+  void hangup_shared() override;
+  void hangup() override;
+  void timeout_expired() override;
+
+  void remove_connection(uint64 id);
+};
+
+}  // namespace td
@@ -20,7 +20,8 @@ bool HttpContentLengthByteFlow::loop() {
     set_need_size(need_size);
     return false;
   }
-  output_.append(input_->cut_head(ready_size));
+  input_->advance(ready_size);
+  output_.advance_end(ready_size);
   len_ -= ready_size;
   if (len_ == 0) {
     finish(Status::OK());
@@ -10,7 +10,8 @@
 
 namespace td {
 
-class HttpContentLengthByteFlow final : public ByteFlowBase {
+// the content is a prefix of the input, so it is passed to the next flow in place without copying
+class HttpContentLengthByteFlow final : public ByteFlowInplaceBase {
  public:
   HttpContentLengthByteFlow() = default;
   explicit HttpContentLengthByteFlow(size_t len) : len_(len) {
@@ -9,18 +9,22 @@
 #include "td/net/SslStream.h"
 
 #include "td/utils/common.h"
+#include "td/utils/Time.h"
 
 namespace td {
 
 HttpInboundConnection::HttpInboundConnection(SocketFd fd, size_t max_post_size, size_t max_files, int32 idle_timeout,
-                                             ActorShared<Callback> callback, int32 slow_scheduler_id)
+                                             ActorShared<Callback> callback, int32 slow_scheduler_id,
+                                             std::shared_ptr<HttpLatencyStats> latency_stats)
     : HttpConnectionBase(State::Read, std::move(fd), SslStream(), max_post_size, max_files, idle_timeout,
                          slow_scheduler_id)
-    , callback_(std::move(callback)) {
+    , callback_(std::move(callback))
+    , latency_stats_(std::move(latency_stats)) {
 }
 
 void HttpInboundConnection::on_query(unique_ptr<HttpQuery> query) {
   CHECK(!callback_.empty());
+  query_start_time_ = Time::now();
   send_closure(callback_, &Callback::handle, std::move(query), ActorOwn<HttpInboundConnection>(actor_id(this)));
 }
 
@@ -28,4 +32,10 @@ void HttpInboundConnection::on_error(Status error) {
   // nothing to do
 }
 
+void HttpInboundConnection::on_write_ok() {
+  if (latency_stats_ != nullptr) {
+    latency_stats_->on_query_answered(Time::now() - query_start_time_);
+  }
+}
+
 }  // namespace td
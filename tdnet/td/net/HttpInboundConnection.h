@@ -9,11 +9,14 @@
 #include "td/actor/actor.h"
 
 #include "td/net/HttpConnectionBase.h"
+#include "td/net/HttpLatencyStats.h"
 #include "td/net/HttpQuery.h"
 
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Status.h"
 
+#include <memory>
+
 namespace td {
 
 class HttpInboundConnection final : public detail::HttpConnectionBase {
@@ -28,16 +31,20 @@ class HttpInboundConnection final : public detail::HttpConnectionBase {
   // void write_error(Status error);
 
   HttpInboundConnection(SocketFd fd, size_t max_post_size, size_t max_files, int32 idle_timeout,
-                        ActorShared<Callback> callback, int32 slow_scheduler_id = -1);
+                        ActorShared<Callback> callback, int32 slow_scheduler_id = -1,
+                        std::shared_ptr<HttpLatencyStats> latency_stats = nullptr);
 
  private:
   void on_query(unique_ptr<HttpQuery> query) override;
   void on_error(Status error) override;
+  void on_write_ok() override;
   void hangup() override {
     callback_.release();
     stop();
   }
   ActorShared<Callback> callback_;
+  std::shared_ptr<HttpLatencyStats> latency_stats_;
+  double query_start_time_ = 0;
 };
 
 }  // namespace td
@@ -0,0 +1,95 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/SchedulerLocalStorage.h"
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/StringBuilder.h"
+
+#include <array>
+#include <atomic>
+
+namespace td {
+
+struct HttpLatencyHistogram {
+  static constexpr size_t BUCKET_COUNT = 32;
+
+  // counts[0] is the number of queries answered in less than 1 microsecond,
+  // counts[i] is the number of queries answered in [2^(i - 1), 2^i) microseconds; the last bucket is unbounded
+  std::array<uint64, BUCKET_COUNT> counts{};
+
+  static size_t get_bucket(double latency) {
+    auto microseconds = latency <= 0 ? 0 : static_cast<uint64>(latency * 1e6);
+    if (microseconds == 0) {
+      return 0;
+    }
+    return td::min(static_cast<size_t>(64 - count_leading_zeroes64(microseconds)), BUCKET_COUNT - 1);
+  }
+
+  uint64 get_count() const {
+    uint64 result = 0;
+    for (auto count : counts) {
+      result += count;
+    }
+    return result;
+  }
+
+  // returns an upper bound for the latency of the given share of the queries in seconds
+  double get_quantile(double quantile) const {
+    auto total_count = get_count();
+    uint64 count = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      count += counts[i];
+      if (count > 0 && static_cast<double>(count) >= quantile * static_cast<double>(total_count)) {
+        return static_cast<double>(static_cast<uint64>(1) << i) * 1e-6;
+      }
+    }
+    return 0.0;
+  }
+};
+
+inline StringBuilder &operator<<(StringBuilder &sb, const HttpLatencyHistogram &histogram) {
+  return sb << tag("count", histogram.get_count()) << tag("p50", format::as_time(histogram.get_quantile(0.5)))
+            << tag("p90", format::as_time(histogram.get_quantile(0.9)))
+            << tag("p99", format::as_time(histogram.get_quantile(0.99)));
+}
+
+// latencies of HTTP queries answered by inbound connections, collected separately on every scheduler;
+// must be created inside a scheduler, but get_histogram can be called from any thread
+class HttpLatencyStats {
+ public:
+  void on_query_answered(double latency) {
+    local_stats_.get().counts[HttpLatencyHistogram::get_bucket(latency)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  HttpLatencyHistogram get_histogram() const {
+    HttpLatencyHistogram result;
+    local_stats_.for_each([&](const LocalStats &stats) {
+      for (size_t i = 0; i < HttpLatencyHistogram::BUCKET_COUNT; i++) {
+        result.counts[i] += stats.counts[i].load(std::memory_order_relaxed);
+      }
+    });
+    return result;
+  }
+
+ private:
+  struct LocalStats {
+    std::array<std::atomic<uint64>, HttpLatencyHistogram::BUCKET_COUNT> counts;
+
+    LocalStats() {
+      for (auto &count : counts) {
+        count.store(0, std::memory_order_relaxed);
+      }
+    }
+  };
+  SchedulerLocalStorage<LocalStats> local_stats_;
+};
+
+}  // namespace td
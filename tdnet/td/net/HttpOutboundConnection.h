@@ -30,6 +30,12 @@ class HttpOutboundConnection final : public detail::HttpConnectionBase {
                            max_files, idle_timeout, slow_scheduler_id)
       , callback_(std::move(callback)) {
   }
+  // passes subsequent responses to another callback; used to reuse keep-alive connections
+  void set_callback(ActorShared<Callback> callback) {
+    callback_.release();
+    callback_ = std::move(callback);
+  }
+
   // Inherited interface
   // void write_next(BufferSlice buffer);
   // void write_ok();
@@ -47,7 +47,7 @@ Result<size_t> HttpReader::read_next(HttpQuery *query, bool can_be_slow) {
       gzip_flow_.wakeup();
       flow_source_.wakeup();
       if (flow_sink_.is_ready() && flow_sink_.status().is_error()) {
-        if (!temp_file_.empty()) {
+        if (has_open_file()) {
           clean_temporary_file();
         }
         return Status::Error(400, PSLICE() << "Bad Request: " << flow_sink_.status().message());
@@ -171,16 +171,20 @@ Result<size_t> HttpReader::read_next(HttpQuery *query, bool can_be_slow) {
           return Status::Error("SLOW");
         }
         // save content to a file
-        if (temp_file_.empty()) {
-          auto file = open_temp_file("file");
-          if (file.is_error()) {
-            return Status::Error(500, "Internal Server Error: can't create temporary file");
-          }
+        if (!has_open_file()) {
+          TRY_STATUS(open_file("file", "", content_type_));
         }
 
         auto size = content_->size();
         bool restart = false;
         if (size > (1 << 20) || flow_sink_.is_ready()) {
+          auto part_size = get_max_file_part_size(size);
+          if (part_size < size) {
+            if (part_size > 0) {
+              TRY_STATUS(save_file_part(content_->cut_head(part_size).move_as_buffer_slice()));
+            }
+            return need_size;
+          }
           TRY_STATUS(save_file_part(content_->cut_head(size).move_as_buffer_slice()));
           restart = true;
         }
@@ -288,7 +292,7 @@ Result<bool> HttpReader::parse_multipart_form_data(bool can_be_slow) {
           field_content_type_ = "application/octet-stream";
           file_name_.clear();
           has_file_name_ = false;
-          CHECK(temp_file_.empty());
+          CHECK(!has_open_file());
           temp_file_name_.clear();
 
           Parser headers_parser(headers.as_slice());
@@ -372,10 +376,7 @@ Result<bool> HttpReader::parse_multipart_form_data(bool can_be_slow) {
             if (query_->files_.size() == max_files_) {
               return Status::Error(413, "Request Entity Too Large: too much files attached");
             }
-            auto file = open_temp_file(file_name_);
-            if (file.is_error()) {
-              return Status::Error(500, "Internal Server Error: can't create temporary file");
-            }
+            TRY_STATUS(open_file(field_name_, file_name_, field_content_type_));
 
             // don't need to save headers for files
             file_field_name_ = field_name_.str();
@@ -431,7 +432,18 @@ Result<bool> HttpReader::parse_multipart_form_data(bool can_be_slow) {
         if (!can_be_slow) {
           return Status::Error("SLOW");
         }
-        if (find_boundary(content_->clone(), boundary_, form_data_read_length_)) {
+        bool is_boundary_found = find_boundary(content_->clone(), boundary_, form_data_read_length_);
+        auto part_size = get_max_file_part_size(form_data_read_length_);
+        if (part_size < form_data_read_length_) {
+          // the consumer can't accept all the data now
+          if (part_size > 0) {
+            form_data_skipped_length_ += part_size;
+            form_data_read_length_ -= part_size;
+            TRY_STATUS(save_file_part(content_->cut_head(part_size).move_as_buffer_slice()));
+          }
+          return false;
+        }
+        if (is_boundary_found) {
           auto file_part = content_->cut_head(form_data_read_length_).move_as_buffer_slice();
           content_->advance(boundary_.size());
           form_data_skipped_length_ += form_data_read_length_ + boundary_.size();
@@ -520,7 +532,9 @@ void HttpReader::process_header(MutableSlice header_name, MutableSlice header_va
   LOG(DEBUG) << "Process header [" << header_name << "=>" << header_value << "]";
   query_->headers_.emplace_back(header_name, header_value);
   // TODO: check if protocol is HTTP/1.1
-  query_->keep_alive_ = true;
+  if (query_->headers_.size() == 1) {
+    query_->keep_alive_ = true;
+  }
   if (header_name == "content-length") {
     content_length_ = to_integer<size_t>(header_value);
   } else if (header_name == "connection") {
@@ -729,6 +743,28 @@ Status HttpReader::parse_head(MutableSlice head) {
   return parser.status().is_ok() ? Status::OK() : Status::Error(400, "Bad Request");
 }
 
+Status HttpReader::open_file(Slice field_name, CSlice file_name, Slice content_type) {
+  if (file_callback_ == nullptr) {
+    auto status = open_temp_file(file_name);
+    if (status.is_error()) {
+      return Status::Error(500, "Internal Server Error: can't create temporary file");
+    }
+    return Status::OK();
+  }
+
+  TRY_STATUS(file_callback_->on_file_begin(field_name, file_name, content_type));
+  file_size_ = 0;
+  is_file_streamed_ = true;
+  return Status::OK();
+}
+
+size_t HttpReader::get_max_file_part_size(size_t size) {
+  if (!is_file_streamed_) {
+    return size;
+  }
+  return td::min(size, file_callback_->get_max_file_part_size());
+}
+
 Status HttpReader::open_temp_file(CSlice desired_file_name) {
   CHECK(temp_file_.empty());
 
@@ -794,6 +830,19 @@ Status HttpReader::save_file_part(BufferSlice &&file_part) {
         413, PSLICE() << "Request Entity Too Large: file of size " << file_size_ << " is too big to be uploaded");
   }
 
+  if (is_file_streamed_) {
+    if (file_part.empty()) {
+      return Status::OK();
+    }
+    LOG(DEBUG) << "Pass file part of size " << file_part.size() << " to the callback";
+    auto status = file_callback_->on_file_part(std::move(file_part));
+    if (status.is_error()) {
+      clean_temporary_file();
+      return status;
+    }
+    return Status::OK();
+  }
+
   LOG(DEBUG) << "Save file part of size " << file_part.size() << " to file " << temp_file_name_;
   auto result_written = temp_file_.write(file_part.as_slice());
   if (result_written.is_error() || result_written.ok() != file_part.size()) {
@@ -804,12 +853,22 @@ Status HttpReader::save_file_part(BufferSlice &&file_part) {
 }
 
 void HttpReader::clean_temporary_file() {
+  if (is_file_streamed_) {
+    is_file_streamed_ = false;
+    file_callback_->on_file_abort();
+    return;
+  }
   string file_name = temp_file_name_;
   close_temp_file();
   delete_temp_file(file_name);
 }
 
 void HttpReader::close_temp_file() {
+  if (is_file_streamed_) {
+    is_file_streamed_ = false;
+    file_callback_->on_file_end();
+    return;
+  }
   LOG(DEBUG) << "Close temporary file " << temp_file_name_;
   CHECK(!temp_file_.empty());
   temp_file_.close();
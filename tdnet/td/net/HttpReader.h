@@ -25,6 +25,29 @@ namespace td {
 
 class HttpReader {
  public:
+  // receives contents of uploaded files as they arrive instead of temporary files
+  class FileCallback {
+   public:
+    FileCallback() = default;
+    FileCallback(const FileCallback &) = delete;
+    FileCallback &operator=(const FileCallback &) = delete;
+    virtual ~FileCallback() = default;
+
+    virtual Status on_file_begin(Slice field_name, Slice file_name, Slice content_type) TD_WARN_UNUSED_RESULT = 0;
+
+    // returns maximum size of the part, which can be passed to on_file_part now;
+    // if 0 is returned, reading of the file is paused until the next call to read_next
+    virtual size_t get_max_file_part_size() = 0;
+
+    virtual Status on_file_part(BufferSlice &&file_part) TD_WARN_UNUSED_RESULT = 0;
+
+    // the whole file has been received; the file is added to query files with empty temp_file_name
+    virtual void on_file_end() = 0;
+
+    // the query was rejected or the reader was destroyed before the end of the file
+    virtual void on_file_abort() = 0;
+  };
+
   void init(ChainBufferReader *input, size_t max_post_size = std::numeric_limits<size_t>::max(),
             size_t max_files = 100);
   Result<size_t> read_next(HttpQuery *query, bool can_be_slow = true) TD_WARN_UNUSED_RESULT;  // TODO move query to init
@@ -38,10 +61,18 @@ class HttpReader {
     if (!temp_file_.empty()) {
       temp_file_.close();
     }
+    if (is_file_streamed_) {
+      file_callback_->on_file_abort();
+    }
   }
 
   static void delete_temp_file(CSlice file_name);
 
+  // by default files are saved to temporary files; must be called before parsing of a query is started
+  void set_file_callback(unique_ptr<FileCallback> file_callback) {
+    file_callback_ = std::move(file_callback);
+  }
+
  private:
   size_t max_post_size_ = 0;
   size_t max_files_ = 0;
@@ -86,6 +117,8 @@ class HttpReader {
   FileFd temp_file_;
   string temp_file_name_;
   int64 file_size_ = 0;
+  unique_ptr<FileCallback> file_callback_;
+  bool is_file_streamed_ = false;
 
   Result<size_t> split_header() TD_WARN_UNUSED_RESULT;
   void process_header(MutableSlice header_name, MutableSlice header_value);
@@ -95,6 +128,11 @@ class HttpReader {
   Status parse_json_parameters(MutableSlice parameters) TD_WARN_UNUSED_RESULT;
   Status parse_head(MutableSlice head) TD_WARN_UNUSED_RESULT;
 
+  bool has_open_file() const {
+    return !temp_file_.empty() || is_file_streamed_;
+  }
+  Status open_file(Slice field_name, CSlice file_name, Slice content_type) TD_WARN_UNUSED_RESULT;
+  size_t get_max_file_part_size(size_t size);
   Status open_temp_file(CSlice desired_file_name) TD_WARN_UNUSED_RESULT;
   Status try_open_temp_file(Slice directory_name, CSlice desired_file_name) TD_WARN_UNUSED_RESULT;
   Status save_file_part(BufferSlice &&file_part) TD_WARN_UNUSED_RESULT;
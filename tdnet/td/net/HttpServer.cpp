@@ -0,0 +1,91 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/net/HttpServer.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/port/SocketFd.h"
+
+namespace td {
+
+namespace {
+
+class HttpServerWorker final : public TcpListener::Callback {
+ public:
+  HttpServerWorker(int port, std::shared_ptr<HttpServer::Callback> callback, size_t max_post_size, size_t max_files,
+                   int32 idle_timeout, std::shared_ptr<HttpLatencyStats> latency_stats, Slice server_address)
+      : port_(port)
+      , callback_(std::move(callback))
+      , max_post_size_(max_post_size)
+      , max_files_(max_files)
+      , idle_timeout_(idle_timeout)
+      , latency_stats_(std::move(latency_stats))
+      , server_address_(server_address.str()) {
+  }
+
+  void accept(SocketFd fd) override {
+    // the connection stays on the scheduler of the listener, so there is no cross-thread handoff
+    auto handler = callback_->create_query_handler();
+    create_actor<HttpInboundConnection>("HttpInboundConnection", std::move(fd), max_post_size_, max_files_,
+                                        idle_timeout_, std::move(handler), -1, latency_stats_)
+        .release();
+  }
+
+ private:
+  int port_;
+  std::shared_ptr<HttpServer::Callback> callback_;
+  size_t max_post_size_;
+  size_t max_files_;
+  int32 idle_timeout_;
+  std::shared_ptr<HttpLatencyStats> latency_stats_;
+  const string server_address_;
+
+  ActorOwn<TcpListener> listener_;
+
+  void start_up() override {
+    listener_ = create_actor<TcpListener>("TcpListener", port_, actor_shared(this), server_address_);
+  }
+
+  void hangup() override {
+    stop();
+  }
+
+  void hangup_shared() override {
+    LOG(INFO) << "TcpListener on port " << port_ << " was closed";
+    stop();
+  }
+};
+
+}  // namespace
+
+HttpServer::HttpServer(int port, vector<int32> scheduler_ids, std::shared_ptr<Callback> callback, size_t max_post_size,
+                       size_t max_files, int32 idle_timeout, std::shared_ptr<HttpLatencyStats> latency_stats,
+                       Slice server_address)
+    : port_(port)
+    , scheduler_ids_(std::move(scheduler_ids))
+    , callback_(std::move(callback))
+    , max_post_size_(max_post_size)
+    , max_files_(max_files)
+    , idle_timeout_(idle_timeout)
+    , latency_stats_(std::move(latency_stats))
+    , server_address_(server_address.str()) {
+  CHECK(callback_ != nullptr);
+}
+
+void HttpServer::start_up() {
+  for (auto scheduler_id : scheduler_ids_) {
+    auto worker = create_actor_on_scheduler<HttpServerWorker>("HttpServerWorker", scheduler_id, port_, callback_,
+                                                              max_post_size_, max_files_, idle_timeout_,
+                                                              latency_stats_, server_address_);
+    workers_.emplace_back(std::move(worker));
+  }
+}
+
+void HttpServer::hangup() {
+  stop();
+}
+
+}  // namespace td
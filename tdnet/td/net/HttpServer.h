@@ -0,0 +1,58 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+
+#include "td/net/HttpInboundConnection.h"
+#include "td/net/HttpLatencyStats.h"
+#include "td/net/TcpListener.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <memory>
+
+namespace td {
+
+// HTTP server, which listens to the port on every given scheduler
+// listeners of all schedulers share the port using SO_REUSEPORT, so the kernel distributes new connections between
+// them, and every connection with its query handler is served by the scheduler, which has accepted it
+class HttpServer final : public Actor {
+ public:
+  class Callback {
+   public:
+    Callback() = default;
+    Callback(const Callback &) = delete;
+    Callback &operator=(const Callback &) = delete;
+    virtual ~Callback() = default;
+
+    // is called from threads of all schedulers; the handler must be created on the current scheduler
+    virtual ActorOwn<HttpInboundConnection::Callback> create_query_handler() = 0;
+  };
+
+  HttpServer(int port, vector<int32> scheduler_ids, std::shared_ptr<Callback> callback, size_t max_post_size,
+             size_t max_files, int32 idle_timeout, std::shared_ptr<HttpLatencyStats> latency_stats = nullptr,
+             Slice server_address = Slice("0.0.0.0"));
+
+ private:
+  int port_;
+  vector<int32> scheduler_ids_;
+  std::shared_ptr<Callback> callback_;
+  size_t max_post_size_;
+  size_t max_files_;
+  int32 idle_timeout_;
+  std::shared_ptr<HttpLatencyStats> latency_stats_;
+  const string server_address_;
+
+  vector<ActorOwn<TcpListener::Callback>> workers_;
+
+  void start_up() override;
+  void hangup() override;
+};
+
+}  // namespace td
@@ -106,6 +106,7 @@ class NetStats {
     }
 
    private:
+    // the counters are changed only from the owning scheduler, so there is no need in atomic read-modify-write
     struct LocalNetStats {
       double last_update = 0;
       uint64 unsync_size = 0;
@@ -117,20 +118,20 @@ class NetStats {
 
     void on_read(uint64 size) final {
       auto &stats = local_net_stats_.get();
-      stats.read_size.fetch_add(size, std::memory_order_relaxed);
+      stats.read_size.store(stats.read_size.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
 
       on_change(stats, size);
     }
     void on_write(uint64 size) final {
       auto &stats = local_net_stats_.get();
-      stats.write_size.fetch_add(size, std::memory_order_relaxed);
+      stats.write_size.store(stats.write_size.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
 
       on_change(stats, size);
     }
 
     void on_change(LocalNetStats &stats, uint64 size) {
       stats.unsync_size += size;
-      auto now = Time::now();
+      auto now = Time::now_coarse();
       if (stats.unsync_size > 10000 || now - stats.last_update > 300) {
         stats.unsync_size = 0;
         stats.last_update = now;
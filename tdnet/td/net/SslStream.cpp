@@ -22,10 +22,12 @@
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 
+#include <atomic>
 #include <cstring>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #if TD_PORT_WINDOWS
 #include <wincrypt.h>
@@ -142,6 +144,90 @@ int verify_callback(int preverify_ok, X509_STORE_CTX *ctx) {
   return preverify_ok;
 }
 
+std::atomic<uint64> handshake_count{0};
+std::atomic<uint64> offered_session_count{0};
+std::atomic<uint64> resumed_session_count{0};
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+#define TD_SSL_SESSION_CACHE 1
+
+struct SslSessionDeleter {
+  void operator()(SSL_SESSION *session) {
+    SSL_SESSION_free(session);
+  }
+};
+
+using SslSession = std::unique_ptr<SSL_SESSION, SslSessionDeleter>;
+
+// process-wide cache of client sessions, which allows to resume TLS sessions in new connections to the same host
+class SslSessionCache {
+ public:
+  static SslSessionCache &instance() {
+    static SslSessionCache cache;
+    return cache;
+  }
+
+  // returns a new reference to the cached session or nullptr
+  SSL_SESSION *get_session(const string &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(key);
+    if (it == sessions_.end()) {
+      return nullptr;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (SSL_SESSION_is_resumable(it->second.session.get()) == 0) {
+      sessions_.erase(it);
+      return nullptr;
+    }
+#endif
+    it->second.last_used = ++generation_;
+    auto *session = it->second.session.get();
+    SSL_SESSION_up_ref(session);
+    return session;
+  }
+
+  void add_session(const string &key, SslSession session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &entry = sessions_[key];
+    entry.session = std::move(session);
+    entry.last_used = ++generation_;
+    if (sessions_.size() > MAX_SESSION_COUNT) {
+      auto oldest = sessions_.begin();
+      for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+        if (it->second.last_used < oldest->second.last_used) {
+          oldest = it;
+        }
+      }
+      sessions_.erase(oldest);
+    }
+  }
+
+ private:
+  static constexpr size_t MAX_SESSION_COUNT = 256;
+
+  struct Entry {
+    SslSession session;
+    uint64 last_used = 0;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<string, Entry> sessions_;
+  uint64 generation_ = 0;
+};
+
+int new_session_callback(SSL *ssl_handle, SSL_SESSION *session) {
+  auto *key = static_cast<const string *>(SSL_get_app_data(ssl_handle));
+  if (key == nullptr) {
+    return 0;
+  }
+  // the callback takes ownership of the session reference
+  SslSessionCache::instance().add_session(*key, SslSession(session));
+  return 1;
+}
+#else
+#define TD_SSL_SESSION_CACHE 0
+#endif
+
 using SslCtx = std::shared_ptr<SSL_CTX>;
 
 struct SslHandleDeleter {
@@ -185,6 +271,10 @@ Result<SslCtx> do_create_ssl_ctx(CSlice cert_file, SslStream::VerifyPeer verify_
   SSL_CTX_set_min_proto_version(ssl_ctx, TLS1_VERSION);
 #endif
   SSL_CTX_set_mode(ssl_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+#if TD_SSL_SESSION_CACHE
+  SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ssl_ctx, new_session_callback);
+#endif
 
   if (cert_file.empty()) {
 #if TD_PORT_WINDOWS
@@ -341,6 +431,21 @@ class SslStreamImpl {
 #endif
     SSL_set_connect_state(ssl_handle.get());
 
+#if TD_SSL_SESSION_CACHE
+    // sessions must not be shared between connections with different verification settings
+    session_key_ = PSTRING() << host << '#' << cert_file << '#' << (verify_peer == SslStream::VerifyPeer::On) << '#'
+                             << check_ip_address_as_host;
+    SSL_set_app_data(ssl_handle.get(), &session_key_);
+    SslSession session(SslSessionCache::instance().get_session(session_key_));
+    if (session != nullptr) {
+      if (SSL_set_session(ssl_handle.get(), session.get()) == 1) {
+        is_session_offered_ = true;
+      } else {
+        LOG(INFO) << create_openssl_error(-14, "Failed to set cached SSL session");
+      }
+    }
+#endif
+
     ssl_handle_ = std::move(ssl_handle);
 
     return Status::OK();
@@ -361,6 +466,9 @@ class SslStreamImpl {
 
  private:
   SslHandle ssl_handle_;
+  string session_key_;
+  bool is_session_offered_ = false;
+  bool is_handshake_finished_ = false;
 
   friend class SslReadByteFlow;
   friend class SslWriteByteFlow;
@@ -371,6 +479,7 @@ class SslStreamImpl {
     if (size <= 0) {
       return process_ssl_error(size);
     }
+    on_handshake_finished();
     return size;
   }
 
@@ -380,9 +489,26 @@ class SslStreamImpl {
     if (size <= 0) {
       return process_ssl_error(size);
     }
+    on_handshake_finished();
     return size;
   }
 
+  void on_handshake_finished() {
+    if (is_handshake_finished_) {
+      return;
+    }
+    is_handshake_finished_ = true;
+    handshake_count++;
+    if (is_session_offered_) {
+      offered_session_count++;
+      if (SSL_session_reused(ssl_handle_.get())) {
+        resumed_session_count++;
+      } else {
+        LOG(DEBUG) << "Cached SSL session wasn't accepted by the server";
+      }
+    }
+  }
+
   class SslReadByteFlow : public ByteFlowBase {
    public:
     explicit SslReadByteFlow(SslStreamImpl *stream) : stream_(stream) {
@@ -530,6 +656,14 @@ size_t SslStream::flow_write(Slice slice) {
   return impl_->flow_write(slice);
 }
 
+SslStream::SessionCacheStats SslStream::get_session_cache_stats() {
+  SessionCacheStats stats;
+  stats.handshake_count = detail::handshake_count.load(std::memory_order_relaxed);
+  stats.offered_session_count = detail::offered_session_count.load(std::memory_order_relaxed);
+  stats.resumed_session_count = detail::resumed_session_count.load(std::memory_order_relaxed);
+  return stats;
+}
+
 }  // namespace td
 
 #else
@@ -569,6 +703,10 @@ size_t SslStream::flow_write(Slice slice) {
   UNREACHABLE();
 }
 
+SslStream::SessionCacheStats SslStream::get_session_cache_stats() {
+  return SessionCacheStats();
+}
+
 }  // namespace td
 
 #endif
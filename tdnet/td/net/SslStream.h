@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/utils/ByteFlow.h"
+#include "td/utils/common.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
@@ -34,6 +35,13 @@ class SslStream {
   size_t flow_read(MutableSlice slice);
   size_t flow_write(Slice slice);
 
+  struct SessionCacheStats {
+    uint64 handshake_count = 0;
+    uint64 offered_session_count = 0;  // number of handshakes, in which a cached session was offered to the server
+    uint64 resumed_session_count = 0;  // number of handshakes, in which the server has accepted the cached session
+  };
+  static SessionCacheStats get_session_cache_stats();
+
   explicit operator bool() const {
     return static_cast<bool>(impl_);
   }
@@ -24,7 +24,7 @@ namespace td {
 
 Wget::Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::pair<string, string>> headers,
            int32 timeout_in, int32 ttl, bool prefer_ipv6, SslStream::VerifyPeer verify_peer, string content,
-           string content_type)
+           string content_type, ActorId<HttpConnectionPool> connection_pool)
     : promise_(std::move(promise))
     , input_url_(std::move(url))
     , headers_(std::move(headers))
@@ -33,7 +33,8 @@ Wget::Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::
     , prefer_ipv6_(prefer_ipv6)
     , verify_peer_(verify_peer)
     , content_(std::move(content))
-    , content_type_(std::move(content_type)) {
+    , content_type_(std::move(content_type))
+    , connection_pool_(std::move(connection_pool)) {
 }
 
 Status Wget::try_init() {
@@ -69,6 +70,25 @@ Status Wget::try_init() {
     hc.add_header("Accept-Encoding", "gzip, deflate");
   }
   TRY_RESULT(header, hc.finish(content_));
+  request_header_ = header.str();
+
+  connection_key_ = PSTRING() << (url.protocol_ == HttpUrl::Protocol::Http ? "http" : "https") << "://" << url.host_
+                              << ':' << url.port_ << (prefer_ipv6_ ? "/ipv6" : "")
+                              << (verify_peer_ == SslStream::VerifyPeer::On ? "" : "/noverify");
+  if (!connection_pool_.empty() && !skip_connection_pool_) {
+    is_waiting_connection_ = true;
+    auto link_token = ++last_connection_token_;
+    send_closure(connection_pool_, &HttpConnectionPool::get_connection, connection_key_, actor_shared(this, link_token),
+                 PromiseCreator::lambda([actor_id = actor_id(this), link_token](
+                                            Result<ActorOwn<HttpOutboundConnection>> r_connection) {
+                   send_closure(actor_id, &Wget::on_pooled_connection,
+                                r_connection.is_ok() ? r_connection.move_as_ok() : ActorOwn<HttpOutboundConnection>(),
+                                link_token);
+                 }));
+    return Status::OK();
+  }
+  skip_connection_pool_ = false;
+  reused_connection_token_ = 0;
 
   IPAddress addr;
   TRY_STATUS(addr.init_host_port(url.host_, url.port_, prefer_ipv6_));
@@ -85,13 +105,37 @@ Status Wget::try_init() {
                                                        ActorOwn<HttpOutboundConnection::Callback>(actor_id(this)));
   }
 
-  send_closure(connection_, &HttpOutboundConnection::write_next, BufferSlice(header));
+  send_closure(connection_, &HttpOutboundConnection::write_next, BufferSlice(request_header_));
   send_closure(connection_, &HttpOutboundConnection::write_ok);
   return Status::OK();
 }
 
+void Wget::on_pooled_connection(ActorOwn<HttpOutboundConnection> connection, uint64 link_token) {
+  CHECK(is_waiting_connection_);
+  is_waiting_connection_ = false;
+  if (connection.empty()) {
+    skip_connection_pool_ = true;
+    return loop();
+  }
+
+  LOG(DEBUG) << "Reuse connection to " << connection_key_;
+  connection_ = std::move(connection);
+  reused_connection_token_ = link_token;
+  send_closure(connection_, &HttpOutboundConnection::write_next, BufferSlice(request_header_));
+  send_closure(connection_, &HttpOutboundConnection::write_ok);
+}
+
+void Wget::on_reused_connection_failed(Status error) {
+  // the server could have closed the idle connection, so the query is repeated once over a new connection
+  LOG(DEBUG) << "Reused connection to " << connection_key_ << " has failed: " << error;
+  reused_connection_token_ = 0;
+  connection_.reset();
+  skip_connection_pool_ = true;
+  loop();
+}
+
 void Wget::loop() {
-  if (connection_.empty()) {
+  if (connection_.empty() && !is_waiting_connection_) {
     auto status = try_init();
     if (status.is_error()) {
       return on_error(std::move(status));
@@ -104,9 +148,26 @@ void Wget::handle(unique_ptr<HttpQuery> result) {
 }
 
 void Wget::on_connection_error(Status error) {
+  if (reused_connection_token_ != 0 && get_link_token() == reused_connection_token_) {
+    return on_reused_connection_failed(std::move(error));
+  }
   on_error(std::move(error));
 }
 
+void Wget::hangup_shared() {
+  if (reused_connection_token_ != 0 && get_link_token() == reused_connection_token_) {
+    on_reused_connection_failed(Status::Error("Connection closed"));
+  }
+}
+
+void Wget::release_connection(bool keep_alive) {
+  reused_connection_token_ = 0;
+  if (keep_alive && !connection_pool_.empty() && !connection_.empty()) {
+    send_closure(connection_pool_, &HttpConnectionPool::put_connection, connection_key_, std::move(connection_));
+  }
+  connection_.reset();
+}
+
 void Wget::on_ok(unique_ptr<HttpQuery> http_query_ptr) {
   CHECK(promise_);
   CHECK(http_query_ptr);
@@ -117,9 +178,10 @@ void Wget::on_ok(unique_ptr<HttpQuery> http_query_ptr) {
     input_url_ = http_query_ptr->get_header("location").str();
     LOG(DEBUG) << input_url_;
     ttl_--;
-    connection_.reset();
+    release_connection(http_query_ptr->keep_alive_);
     yield();
   } else if (http_query_ptr->code_ >= 200 && http_query_ptr->code_ < 300) {
+    release_connection(http_query_ptr->keep_alive_);
     promise_.set_value(std::move(http_query_ptr));
     stop();
   } else {
@@ -6,6 +6,7 @@
 //
 #pragma once
 
+#include "td/net/HttpConnectionPool.h"
 #include "td/net/HttpOutboundConnection.h"
 #include "td/net/HttpQuery.h"
 #include "td/net/SslStream.h"
@@ -25,13 +26,17 @@ class Wget : public HttpOutboundConnection::Callback {
   explicit Wget(Promise<unique_ptr<HttpQuery>> promise, string url, std::vector<std::pair<string, string>> headers = {},
                 int32 timeout_in = 10, int32 ttl = 3, bool prefer_ipv6 = false,
                 SslStream::VerifyPeer verify_peer = SslStream::VerifyPeer::On, string content = {},
-                string content_type = {});
+                string content_type = {}, ActorId<HttpConnectionPool> connection_pool = {});
 
  private:
   Status try_init();
   void loop() override;
   void handle(unique_ptr<HttpQuery> result) override;
   void on_connection_error(Status error) override;
+  void hangup_shared() override;
+  void on_pooled_connection(ActorOwn<HttpOutboundConnection> connection, uint64 link_token);
+  void on_reused_connection_failed(Status error);
+  void release_connection(bool keep_alive);
   void on_ok(unique_ptr<HttpQuery> http_query_ptr);
   void on_error(Status error);
 
@@ -49,6 +54,14 @@ class Wget : public HttpOutboundConnection::Callback {
   SslStream::VerifyPeer verify_peer_;
   string content_;
   string content_type_;
+
+  ActorId<HttpConnectionPool> connection_pool_;
+  string connection_key_;
+  string request_header_;
+  bool is_waiting_connection_ = false;
+  bool skip_connection_pool_ = false;
+  uint64 reused_connection_token_ = 0;
+  uint64 last_connection_token_ = 0;
 };
 
 }  // namespace td
@@ -0,0 +1,246 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/AsyncFileLog.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Slice.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace td {
+
+static constexpr int32 FLUSH_PERIOD_MS = 10;
+
+// single producer single consumer ring buffer of bytes
+// threads without an identifier share the buffer of the thread 0, so writers are serialized with a spinlock,
+// which is never contended for threads created by td::thread
+struct AsyncFileLog::Buffer {
+  explicit Buffer(size_t size) : data(size) {
+  }
+
+  vector<char> data;
+  std::atomic<uint64> write_pos{0};
+  std::atomic<uint64> read_pos{0};
+  std::atomic<uint64> dropped_count{0};
+  std::atomic_flag lock = ATOMIC_FLAG_INIT;
+
+  size_t get_used_size() const {
+    return static_cast<size_t>(write_pos.load(std::memory_order_relaxed) - read_pos.load(std::memory_order_relaxed));
+  }
+
+  bool try_write(Slice slice) {
+    while (lock.test_and_set(std::memory_order_acquire)) {
+      td::this_thread::yield();
+    }
+    auto pos = write_pos.load(std::memory_order_relaxed);
+    auto used_size = static_cast<size_t>(pos - read_pos.load(std::memory_order_acquire));
+    bool is_written = used_size + slice.size() <= data.size();
+    if (is_written) {
+      auto offset = static_cast<size_t>(pos & (data.size() - 1));
+      auto first_size = td::min(slice.size(), data.size() - offset);
+      std::memcpy(&data[offset], slice.data(), first_size);
+      std::memcpy(&data[0], slice.data() + first_size, slice.size() - first_size);
+      write_pos.store(pos + slice.size(), std::memory_order_release);
+    }
+    lock.clear(std::memory_order_release);
+    return is_written;
+  }
+
+  // must be called only by one thread at a time
+  void read_to(string &to) {
+    auto pos = read_pos.load(std::memory_order_relaxed);
+    auto end_pos = write_pos.load(std::memory_order_acquire);
+    auto size = static_cast<size_t>(end_pos - pos);
+    if (size != 0) {
+      auto offset = static_cast<size_t>(pos & (data.size() - 1));
+      auto first_size = td::min(size, data.size() - offset);
+      to.append(&data[offset], first_size);
+      to.append(&data[0], size - first_size);
+      read_pos.store(end_pos, std::memory_order_release);
+    }
+
+    auto dropped = dropped_count.exchange(0, std::memory_order_relaxed);
+    if (dropped != 0) {
+      to += PSTRING() << "[" << dropped << " log messages were dropped]\n";
+    }
+  }
+};
+
+AsyncFileLog::AsyncFileLog() {
+  for (auto &buffer : buffers_) {
+    buffer.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+AsyncFileLog::~AsyncFileLog() {
+#if !TD_THREAD_UNSUPPORTED
+  if (buffer_size_ != 0) {
+    {
+      std::lock_guard<std::mutex> guard(wakeup_mutex_);
+      is_closing_ = true;
+    }
+    wakeup_condition_.notify_one();
+    writer_thread_.join();
+  }
+#endif
+  for (auto &buffer : buffers_) {
+    delete buffer.load(std::memory_order_relaxed);
+  }
+}
+
+Status AsyncFileLog::init(string path, int64 rotate_threshold, bool redirect_stderr, OverflowPolicy overflow_policy,
+                          size_t buffer_size) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  flush_buffers();
+  TRY_STATUS(file_log_.init(std::move(path), rotate_threshold, redirect_stderr));
+  overflow_policy_.store(overflow_policy, std::memory_order_relaxed);
+
+  if (buffer_size_ == 0) {
+    buffer_size_ = 4096;
+    while (buffer_size_ < buffer_size) {
+      buffer_size_ *= 2;
+    }
+#if !TD_THREAD_UNSUPPORTED
+    writer_thread_ = td::thread([this] { run_writer(); });
+#endif
+  }
+  return Status::OK();
+}
+
+string AsyncFileLog::get_path() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return file_log_.get_path().str();
+}
+
+int64 AsyncFileLog::get_rotate_threshold() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return file_log_.get_rotate_threshold();
+}
+
+bool AsyncFileLog::get_redirect_stderr() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return file_log_.get_redirect_stderr();
+}
+
+AsyncFileLog::OverflowPolicy AsyncFileLog::get_overflow_policy() const {
+  return overflow_policy_.load(std::memory_order_relaxed);
+}
+
+vector<string> AsyncFileLog::get_file_paths() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return file_log_.get_file_paths();
+}
+
+void AsyncFileLog::append(CSlice cslice, int log_level) {
+  auto *buffer = log_level == VERBOSITY_NAME(FATAL) ? nullptr : get_current_buffer();
+  if (buffer == nullptr || cslice.size() > buffer->data.size()) {
+    return append_sync(cslice, log_level);
+  }
+
+  while (!buffer->try_write(cslice)) {
+    if (overflow_policy_.load(std::memory_order_relaxed) == OverflowPolicy::Drop) {
+      buffer->dropped_count.fetch_add(1, std::memory_order_relaxed);
+      return wakeup_writer();
+    }
+    // the buffer is full, so write it without waiting for the writer thread
+    flush();
+  }
+  if (buffer->get_used_size() >= buffer->data.size() / 2) {
+    wakeup_writer();
+  }
+}
+
+void AsyncFileLog::rotate() {
+  file_log_.lazy_rotate();
+  wakeup_writer();
+}
+
+void AsyncFileLog::flush() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  flush_buffers();
+}
+
+AsyncFileLog::Buffer *AsyncFileLog::get_current_buffer() {
+#if TD_THREAD_UNSUPPORTED
+  return nullptr;
+#else
+  auto thread_id = static_cast<size_t>(get_thread_id());
+  if (thread_id >= MAX_THREAD_ID) {
+    return nullptr;
+  }
+  auto *buffer = buffers_[thread_id].load(std::memory_order_acquire);
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (buffer_size_ == 0) {
+      return nullptr;
+    }
+    buffer = buffers_[thread_id].load(std::memory_order_relaxed);
+    if (buffer == nullptr) {
+      buffer = new Buffer(buffer_size_);
+      buffers_[thread_id].store(buffer, std::memory_order_release);
+    }
+  }
+  return buffer;
+#endif
+}
+
+void AsyncFileLog::append_sync(CSlice cslice, int log_level) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // previous messages must be written first
+  flush_buffers();
+  file_log_.append(cslice, log_level);
+}
+
+void AsyncFileLog::wakeup_writer() {
+  if (!need_flush_.exchange(true, std::memory_order_acq_rel)) {
+    wakeup_condition_.notify_one();
+  }
+}
+
+void AsyncFileLog::run_writer() {
+  while (true) {
+    bool is_closing;
+    {
+      std::unique_lock<std::mutex> guard(wakeup_mutex_);
+      wakeup_condition_.wait_for(guard, std::chrono::milliseconds(FLUSH_PERIOD_MS), [&] {
+        return is_closing_ || need_flush_.load(std::memory_order_relaxed);
+      });
+      need_flush_.store(false, std::memory_order_relaxed);
+      is_closing = is_closing_;
+    }
+
+    flush();
+    if (is_closing) {
+      break;
+    }
+  }
+}
+
+void AsyncFileLog::flush_buffers() {
+  for (auto &buffer : buffers_) {
+    auto *ptr = buffer.load(std::memory_order_acquire);
+    if (ptr != nullptr) {
+      ptr->read_to(write_buffer_);
+    }
+  }
+  if (!write_buffer_.empty()) {
+    file_log_.append(write_buffer_, VERBOSITY_NAME(PLAIN));
+    write_buffer_.clear();
+  }
+}
+
+Result<unique_ptr<LogInterface>> AsyncFileLog::create(string path, int64 rotate_threshold, bool redirect_stderr,
+                                                      OverflowPolicy overflow_policy, size_t buffer_size) {
+  auto log = make_unique<AsyncFileLog>();
+  TRY_STATUS(log->init(std::move(path), rotate_threshold, redirect_stderr, overflow_policy, buffer_size));
+  return std::move(log);
+}
+
+}  // namespace td
@@ -0,0 +1,101 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/FileLog.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/config.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace td {
+
+// log, which is written to a file by a separate thread
+// every thread appends log messages to its own ring buffer without locks and system calls; the writer thread
+// periodically writes all buffered messages with one system call and rotates the file, so messages of different threads
+// can be reordered within a batch; fatal errors and messages bigger than the buffer are written synchronously
+// if threads are unsupported, all messages are written synchronously
+class AsyncFileLog final : public LogInterface {
+  static constexpr int64 DEFAULT_ROTATE_THRESHOLD = 10 * (1 << 20);
+  static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 18;
+
+ public:
+  enum class OverflowPolicy : int32 { Block, Drop };
+
+  AsyncFileLog();
+  AsyncFileLog(const AsyncFileLog &) = delete;
+  AsyncFileLog &operator=(const AsyncFileLog &) = delete;
+  AsyncFileLog(AsyncFileLog &&) = delete;
+  AsyncFileLog &operator=(AsyncFileLog &&) = delete;
+  ~AsyncFileLog() override;
+
+  static Result<unique_ptr<LogInterface>> create(string path, int64 rotate_threshold = DEFAULT_ROTATE_THRESHOLD,
+                                                 bool redirect_stderr = true,
+                                                 OverflowPolicy overflow_policy = OverflowPolicy::Block,
+                                                 size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+  // can be called again to change the file or the policy; buffer_size is used only by the first successful call
+  Status init(string path, int64 rotate_threshold = DEFAULT_ROTATE_THRESHOLD, bool redirect_stderr = true,
+              OverflowPolicy overflow_policy = OverflowPolicy::Block, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+  string get_path() const;
+
+  int64 get_rotate_threshold() const;
+
+  bool get_redirect_stderr() const;
+
+  OverflowPolicy get_overflow_policy() const;
+
+  vector<string> get_file_paths() override;
+
+  void append(CSlice cslice, int log_level) override;
+
+  void rotate() override;
+
+  // writes all messages, which were appended before the call
+  void flush();
+
+ private:
+  struct Buffer;
+
+  static constexpr size_t MAX_THREAD_ID = 128;
+
+  FileLog file_log_;
+  string write_buffer_;
+  mutable std::mutex mutex_;  // protects file_log_ and reading from the buffers
+
+  std::array<std::atomic<Buffer *>, MAX_THREAD_ID> buffers_;
+  size_t buffer_size_ = 0;
+  std::atomic<OverflowPolicy> overflow_policy_{OverflowPolicy::Block};
+
+#if !TD_THREAD_UNSUPPORTED
+  td::thread writer_thread_;
+#endif
+  std::mutex wakeup_mutex_;
+  std::condition_variable wakeup_condition_;
+  std::atomic<bool> need_flush_{false};
+  bool is_closing_ = false;
+
+  Buffer *get_current_buffer();
+
+  void append_sync(CSlice cslice, int log_level);
+
+  void wakeup_writer();
+
+  void run_writer();
+
+  void flush_buffers();
+};
+
+}  // namespace td
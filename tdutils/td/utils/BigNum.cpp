@@ -65,6 +65,35 @@ class BigNum::Impl {
 BigNum::BigNum() : impl_(make_unique<Impl>()) {
 }
 
+class BigNumMontgomeryContext::Impl {
+ public:
+  BN_MONT_CTX *mont_context;
+  BigNum modulus;
+
+  explicit Impl(const BigNum &modulus) : mont_context(BN_MONT_CTX_new()), modulus(modulus) {
+    LOG_IF(FATAL, mont_context == nullptr);
+  }
+  Impl(const Impl &other) = delete;
+  Impl &operator=(const Impl &other) = delete;
+  Impl(Impl &&other) = delete;
+  Impl &operator=(Impl &&other) = delete;
+  ~Impl() {
+    BN_MONT_CTX_free(mont_context);
+  }
+};
+
+BigNumMontgomeryContext::BigNumMontgomeryContext(const BigNum &modulus, BigNumContext &context)
+    : impl_(make_unique<Impl>(modulus)) {
+  CHECK(BN_is_odd(modulus.impl_->big_num));
+  int result = BN_MONT_CTX_set(impl_->mont_context, impl_->modulus.impl_->big_num, context.impl_->big_num_context);
+  LOG_IF(FATAL, result != 1);
+}
+
+BigNumMontgomeryContext::BigNumMontgomeryContext(BigNumMontgomeryContext &&other) = default;
+BigNumMontgomeryContext &BigNumMontgomeryContext::operator=(BigNumMontgomeryContext &&other) = default;
+
+BigNumMontgomeryContext::~BigNumMontgomeryContext() = default;
+
 BigNum::BigNum(const BigNum &other) : BigNum() {
   *this = other;
 }
@@ -298,6 +327,14 @@ void BigNum::mod_exp(BigNum &r, const BigNum &a, const BigNum &p, const BigNum &
   LOG_IF(FATAL, result != 1);
 }
 
+void BigNum::mod_exp(BigNum &r, const BigNum &a, const BigNum &p, const BigNumMontgomeryContext &m,
+                     BigNumContext &context) {
+  int result = BN_mod_exp_mont_consttime(r.impl_->big_num, a.impl_->big_num, p.impl_->big_num,
+                                         m.impl_->modulus.impl_->big_num, context.impl_->big_num_context,
+                                         m.impl_->mont_context);
+  LOG_IF(FATAL, result != 1);
+}
+
 void BigNum::gcd(BigNum &r, BigNum &a, BigNum &b, BigNumContext &context) {
   int result = BN_gcd(r.impl_->big_num, a.impl_->big_num, b.impl_->big_num, context.impl_->big_num_context);
   LOG_IF(FATAL, result != 1);
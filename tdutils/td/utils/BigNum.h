@@ -25,6 +25,26 @@ class BigNumContext {
   BigNumContext &operator=(BigNumContext &&other);
   ~BigNumContext();
 
+ private:
+  class Impl;
+  unique_ptr<Impl> impl_;
+
+  friend class BigNum;
+  friend class BigNumMontgomeryContext;
+};
+
+class BigNum;
+
+// precomputed data for Montgomery multiplication modulo an odd number; can be shared between threads
+class BigNumMontgomeryContext {
+ public:
+  BigNumMontgomeryContext(const BigNum &modulus, BigNumContext &context);
+  BigNumMontgomeryContext(const BigNumMontgomeryContext &other) = delete;
+  BigNumMontgomeryContext &operator=(const BigNumMontgomeryContext &other) = delete;
+  BigNumMontgomeryContext(BigNumMontgomeryContext &&other);
+  BigNumMontgomeryContext &operator=(BigNumMontgomeryContext &&other);
+  ~BigNumMontgomeryContext();
+
  private:
   class Impl;
   unique_ptr<Impl> impl_;
@@ -104,6 +124,10 @@ class BigNum {
 
   static void mod_exp(BigNum &r, const BigNum &a, const BigNum &p, const BigNum &m, BigNumContext &context);
 
+  // constant-time in the exponent p; the modulus is taken from the Montgomery context
+  static void mod_exp(BigNum &r, const BigNum &a, const BigNum &p, const BigNumMontgomeryContext &m,
+                      BigNumContext &context);
+
   static void gcd(BigNum &r, BigNum &a, BigNum &b, BigNumContext &context);
 
   static int compare(const BigNum &a, const BigNum &b);
@@ -113,6 +137,8 @@ class BigNum {
   unique_ptr<Impl> impl_;
 
   explicit BigNum(unique_ptr<Impl> &&impl);
+
+  friend class BigNumMontgomeryContext;
 };
 
 StringBuilder &operator<<(StringBuilder &sb, const BigNum &bn);
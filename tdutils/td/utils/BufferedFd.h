@@ -48,9 +48,22 @@ class BufferedFdBase : public FdT {
     write_ = write;
   }
 
+  // sets expected number of bytes to be read before the packet being read is complete; can be an upper bound
+  // the rest of the packet is then read into a single buffer with fewer system calls
+  void set_read_size_hint(size_t read_size_hint) {
+    read_size_hint_ = min(read_size_hint, MAX_READ_SIZE_HINT);
+  }
+
  private:
+  static constexpr size_t MIN_SPARE_READ_BUFFER_SIZE = 1 << 14;
+  static constexpr size_t MAX_SPARE_READ_BUFFER_SIZE = 1 << 20;
+  static constexpr size_t MAX_READ_SIZE_HINT = 1 << 23;
+
   ChainBufferWriter *read_ = nullptr;
   ChainBufferReader *write_ = nullptr;
+  BufferWriter spare_read_buffer_;
+  size_t spare_read_buffer_size_ = MIN_SPARE_READ_BUFFER_SIZE;
+  size_t read_size_hint_ = 0;
 };
 
 template <class FdT>
@@ -92,6 +105,13 @@ class BufferedFd : public BufferedFdBase<FdT> {
 // IMPLEMENTATION
 
 /*** BufferedFd ***/
+template <class FdT>
+constexpr size_t BufferedFdBase<FdT>::MIN_SPARE_READ_BUFFER_SIZE;
+template <class FdT>
+constexpr size_t BufferedFdBase<FdT>::MAX_SPARE_READ_BUFFER_SIZE;
+template <class FdT>
+constexpr size_t BufferedFdBase<FdT>::MAX_READ_SIZE_HINT;
+
 template <class FdT>
 BufferedFdBase<FdT>::BufferedFdBase(FdT &&fd_) : FdT(std::move(fd_)) {
 }
@@ -101,10 +121,41 @@ Result<size_t> BufferedFdBase<FdT>::flush_read(size_t max_read) {
   CHECK(read_);
   size_t result = 0;
   while (::td::can_read_local(*this) && max_read) {
-    MutableSlice slice = read_->prepare_append().truncate(max_read);
-    TRY_RESULT(x, FdT::read(slice));
-    slice.truncate(x);
-    read_->confirm_append(x);
+    // read both into the rest of the current buffer and into a spare buffer, which is added to the chain only if
+    // some data was read into it, so a read of a big chunk of data isn't split into many small reads
+    IoSlice buf[2];
+    size_t buf_size = 0;
+    MutableSlice slice = read_->prepare_append_inplace().truncate(max_read);
+    if (!slice.empty()) {
+      buf[buf_size++] = as_io_slice(slice);
+    }
+    size_t spare_read_size = 0;
+    if (slice.size() < max_read) {
+      // the rest of the expected packet must fit into the spare buffer
+      size_t expected_size = read_size_hint_ > slice.size() ? read_size_hint_ - slice.size() : 0;
+      if (spare_read_buffer_.is_null() || spare_read_buffer_.prepare_append().size() < expected_size) {
+        spare_read_buffer_ = BufferWriter(max(spare_read_buffer_size_, expected_size));
+      }
+      auto spare_slice = spare_read_buffer_.prepare_append().truncate(max_read - slice.size());
+      spare_read_size = spare_slice.size();
+      buf[buf_size++] = as_io_slice(spare_slice);
+    }
+    TRY_RESULT(x, FdT::readv(Span<IoSlice>(buf, buf_size)));
+    auto inplace_size = min(x, slice.size());
+    read_->confirm_append(inplace_size);
+    if (x > inplace_size) {
+      auto spare_size = x - inplace_size;
+      // adapt size of the next spare buffer to the amount of data, which is received at once
+      if (spare_size == spare_read_size) {
+        spare_read_buffer_size_ = min(spare_read_buffer_size_ * 2, MAX_SPARE_READ_BUFFER_SIZE);
+      } else if (spare_size < spare_read_buffer_size_ / 4) {
+        spare_read_buffer_size_ = max(spare_read_buffer_size_ / 2, MIN_SPARE_READ_BUFFER_SIZE);
+      }
+      spare_read_buffer_.confirm_append(spare_size);
+      read_->append_writer(std::move(spare_read_buffer_));
+      spare_read_buffer_ = BufferWriter();
+    }
+    read_size_hint_ = read_size_hint_ > x ? read_size_hint_ - x : 0;
     result += x;
     max_read -= x;
   }
@@ -117,7 +168,7 @@ Result<size_t> BufferedFdBase<FdT>::flush_write() {
   write_->sync_with_writer();
   size_t result = 0;
   while (!write_->empty() && ::td::can_write_local(*this)) {
-    constexpr size_t BUF_SIZE = 20;
+    constexpr size_t BUF_SIZE = MAX_IO_SLICES;
     IoSlice buf[BUF_SIZE];
 
     auto it = write_->clone();
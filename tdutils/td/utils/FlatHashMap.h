@@ -0,0 +1,228 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+
+#include <functional>
+#include <utility>
+
+namespace td {
+
+// hash map with open addressing and linear probing, which stores all elements in a single array
+// it is intended for small keys like identifiers, which have default value only for an invalid key;
+// a key equal to KeyT() can't be stored in the map
+// any insertion or erasure invalidates all iterators, references and pointers to elements
+template <class KeyT, class ValueT, class HashT = std::hash<KeyT>, class EqT = std::equal_to<KeyT>>
+class FlatHashMap {
+ public:
+  struct Node {
+    KeyT first{};
+    ValueT second{};
+
+    bool empty() const {
+      return EqT()(first, KeyT());
+    }
+  };
+
+  template <class NodeT>
+  class IteratorImpl {
+   public:
+    IteratorImpl() = default;
+
+    NodeT &operator*() const {
+      return *node_;
+    }
+    NodeT *operator->() const {
+      return node_;
+    }
+
+    bool operator==(const IteratorImpl &other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const IteratorImpl &other) const {
+      return node_ != other.node_;
+    }
+
+    IteratorImpl &operator++() {
+      do {
+        ++node_;
+      } while (node_ != end_ && node_->empty());
+      return *this;
+    }
+
+   private:
+    friend class FlatHashMap;
+
+    NodeT *node_ = nullptr;
+    NodeT *end_ = nullptr;
+
+    IteratorImpl(NodeT *node, NodeT *end) : node_(node), end_(end) {
+      while (node_ != end_ && node_->empty()) {
+        ++node_;
+      }
+    }
+  };
+
+  using Iterator = IteratorImpl<Node>;
+  using ConstIterator = IteratorImpl<const Node>;
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void clear() {
+    nodes_ = vector<Node>();
+    size_ = 0;
+    bucket_shift_ = 64;
+  }
+
+  Iterator begin() {
+    return Iterator(nodes_.data(), nodes_.data() + nodes_.size());
+  }
+  ConstIterator begin() const {
+    return ConstIterator(nodes_.data(), nodes_.data() + nodes_.size());
+  }
+
+  Iterator end() {
+    return Iterator(nodes_.data() + nodes_.size(), nodes_.data() + nodes_.size());
+  }
+  ConstIterator end() const {
+    return ConstIterator(nodes_.data() + nodes_.size(), nodes_.data() + nodes_.size());
+  }
+
+  Iterator find(const KeyT &key) {
+    auto pos = find_pos(key);
+    return pos == nodes_.size() ? end() : Iterator(&nodes_[pos], nodes_.data() + nodes_.size());
+  }
+  ConstIterator find(const KeyT &key) const {
+    auto pos = find_pos(key);
+    return pos == nodes_.size() ? end() : ConstIterator(&nodes_[pos], nodes_.data() + nodes_.size());
+  }
+
+  size_t count(const KeyT &key) const {
+    return find_pos(key) == nodes_.size() ? 0 : 1;
+  }
+
+  // returns iterator to the element with the key and true, if the element was inserted
+  template <class... ArgsT>
+  std::pair<Iterator, bool> emplace(KeyT key, ArgsT &&... args) {
+    auto pos = find_pos(key);
+    if (pos != nodes_.size()) {
+      return {Iterator(&nodes_[pos], nodes_.data() + nodes_.size()), false};
+    }
+    pos = insert_pos(std::move(key));
+    nodes_[pos].second = ValueT(std::forward<ArgsT>(args)...);
+    return {Iterator(&nodes_[pos], nodes_.data() + nodes_.size()), true};
+  }
+
+  ValueT &operator[](const KeyT &key) {
+    auto pos = find_pos(key);
+    if (pos == nodes_.size()) {
+      pos = insert_pos(key);
+    }
+    return nodes_[pos].second;
+  }
+
+  size_t erase(const KeyT &key) {
+    auto pos = find_pos(key);
+    if (pos == nodes_.size()) {
+      return 0;
+    }
+    erase_pos(pos);
+    return 1;
+  }
+
+ private:
+  static constexpr size_t MIN_BUCKET_COUNT = 8;
+
+  vector<Node> nodes_;
+  size_t size_ = 0;
+  int32 bucket_shift_ = 64;  // 64 - log2(nodes_.size())
+
+  size_t get_bucket(const KeyT &key) const {
+    // multiplicative hashing spreads identifiers with equal low bits over the whole table
+    auto hash = static_cast<uint64>(HashT()(key));
+    return static_cast<size_t>((hash * static_cast<uint64>(0x9E3779B97F4A7C15)) >> bucket_shift_);
+  }
+
+  size_t next_pos(size_t pos) const {
+    return (pos + 1) & (nodes_.size() - 1);
+  }
+
+  // returns nodes_.size() if there is no such key
+  size_t find_pos(const KeyT &key) const {
+    if (nodes_.empty() || EqT()(key, KeyT())) {
+      return nodes_.size();
+    }
+    auto pos = get_bucket(key);
+    while (true) {
+      auto &node = nodes_[pos];
+      if (node.empty()) {
+        return nodes_.size();
+      }
+      if (EqT()(node.first, key)) {
+        return pos;
+      }
+      pos = next_pos(pos);
+    }
+  }
+
+  // the key must not be in the map
+  size_t insert_pos(KeyT key) {
+    CHECK(!EqT()(key, KeyT()));
+    if ((size_ + 1) * 2 > nodes_.size()) {
+      resize(nodes_.empty() ? MIN_BUCKET_COUNT : nodes_.size() * 2);
+    }
+    size_++;
+    auto pos = get_bucket(key);
+    while (!nodes_[pos].empty()) {
+      pos = next_pos(pos);
+    }
+    nodes_[pos].first = std::move(key);
+    return pos;
+  }
+
+  void erase_pos(size_t pos) {
+    size_--;
+    // move back the following elements of the cluster, which can't be found after the removal
+    auto empty_pos = pos;
+    for (auto cur_pos = next_pos(pos); !nodes_[cur_pos].empty(); cur_pos = next_pos(cur_pos)) {
+      auto bucket = get_bucket(nodes_[cur_pos].first);
+      bool is_reachable = empty_pos <= cur_pos ? empty_pos < bucket && bucket <= cur_pos
+                                               : empty_pos < bucket || bucket <= cur_pos;
+      if (!is_reachable) {
+        nodes_[empty_pos] = std::move(nodes_[cur_pos]);
+        empty_pos = cur_pos;
+      }
+    }
+    nodes_[empty_pos] = Node();
+  }
+
+  void resize(size_t new_bucket_count) {
+    auto old_nodes = std::move(nodes_);
+    nodes_ = vector<Node>(new_bucket_count);
+    bucket_shift_ = 64 - count_trailing_zeroes64(static_cast<uint64>(new_bucket_count));
+    for (auto &node : old_nodes) {
+      if (!node.empty()) {
+        auto pos = get_bucket(node.first);
+        while (!nodes_[pos].empty()) {
+          pos = next_pos(pos);
+        }
+        nodes_[pos] = std::move(node);
+      }
+    }
+  }
+};
+
+}  // namespace td
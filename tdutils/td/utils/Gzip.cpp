@@ -11,6 +11,8 @@ char disable_linker_warning_about_empty_file_gzip_cpp TD_UNUSED;
 #if TD_HAVE_ZLIB
 #include "td/utils/logging.h"
 
+#include <array>
+#include <cmath>
 #include <cstring>
 #include <limits>
 #include <utility>
@@ -154,14 +156,52 @@ Gzip::~Gzip() {
   clear();
 }
 
+// returns size of the uncompressed data stored in the gzip trailer or 0 if it is unknown or looks wrong
+static size_t get_gzip_uncompressed_size_hint(Slice s) {
+  if (s.size() < 18 || s.ubegin()[0] != 0x1f || s.ubegin()[1] != 0x8b) {
+    return 0;
+  }
+  auto trailer = s.ubegin() + s.size() - 4;
+  size_t size = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<uint32>(trailer[3]) << 24);
+  // the size is stored modulo 2^32 and deflate can't compress data more than 1032 times
+  if (size < s.size() / 2 || size / 1032 > s.size()) {
+    return 0;
+  }
+  return size;
+}
+
 BufferSlice gzdecode(Slice s) {
   Gzip gzip;
   gzip.init_decode().ensure();
-  ChainBufferWriter message;
   gzip.set_input(s);
   gzip.close_input();
+
+  ChainBufferWriter message;
   double k = 2;
-  gzip.set_output(message.prepare_append(static_cast<size_t>(static_cast<double>(s.size()) * k)));
+  auto size_hint = get_gzip_uncompressed_size_hint(s);
+  if (size_hint != 0) {
+    // decode to a buffer of the final size to avoid reallocations and copying of the result
+    BufferWriter result{size_hint + 1};
+    gzip.set_output(result.prepare_append());
+    auto r_state = gzip.run();
+    if (r_state.is_error()) {
+      return BufferSlice();
+    }
+    result.confirm_append(gzip.flush_output());
+    if (r_state.ok() == Gzip::State::Done) {
+      return result.as_buffer_slice();
+    }
+    if (gzip.need_input()) {
+      return BufferSlice();
+    }
+
+    // the hint was wrong, continue decoding in the usual way
+    LOG(DEBUG) << "Receive wrong gzip size hint " << size_hint;
+    message.append(result.as_buffer_slice());
+    k = 1.5;
+  }
+
+  gzip.set_output(message.prepare_append(static_cast<size_t>(static_cast<double>(gzip.left_input()) * k)));
   while (true) {
     auto r_state = gzip.run();
     if (r_state.is_error()) {
@@ -204,5 +244,38 @@ BufferSlice gzencode(Slice s, double max_compression_ratio) {
   return message.as_buffer_slice();
 }
 
+double estimate_gzip_compression_ratio(Slice s) {
+  if (s.empty()) {
+    return 1.0;
+  }
+
+  constexpr size_t PART_SIZE = 256;
+  constexpr size_t MAX_PART_COUNT = 16;
+  std::array<uint32, 256> counts{};
+  size_t total_count = 0;
+  auto add_part = [&](Slice part) {
+    for (auto c : part) {
+      counts[static_cast<unsigned char>(c)]++;
+    }
+    total_count += part.size();
+  };
+  if (s.size() <= PART_SIZE * MAX_PART_COUNT) {
+    add_part(s);
+  } else {
+    for (size_t i = 0; i < MAX_PART_COUNT; i++) {
+      add_part(s.substr((s.size() - PART_SIZE) * i / (MAX_PART_COUNT - 1), PART_SIZE));
+    }
+  }
+
+  double entropy = 0.0;
+  for (auto count : counts) {
+    if (count != 0) {
+      auto probability = static_cast<double>(count) / static_cast<double>(total_count);
+      entropy -= probability * std::log2(probability);
+    }
+  }
+  return entropy / 8.0;
+}
+
 }  // namespace td
 #endif
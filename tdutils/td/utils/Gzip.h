@@ -101,6 +101,10 @@ BufferSlice gzdecode(Slice s);
 
 BufferSlice gzencode(Slice s, double max_compression_ratio);
 
+// returns a cheap estimate of the compression ratio, based on entropy of bytes in evenly spaced parts of the data
+// the estimate is close for incompressible data and is too big for data with many long repeated substrings
+double estimate_gzip_compression_ratio(Slice s);
+
 }  // namespace td
 
 #endif
@@ -199,17 +199,35 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
     results.resize(new_results_size);
   }
 
+  // look up ratings once instead of twice per comparison
   auto total_size = results.size();
+  vector<std::pair<RatingT, KeyT>> rated_results;
+  rated_results.reserve(total_size);
+  for (auto key : results) {
+    rated_results.emplace_back(get_rating(key), key);
+  }
   if (total_size < static_cast<size_t>(limit)) {
-    std::sort(results.begin(), results.end(), CompareByRating(key_to_rating_));
+    std::sort(rated_results.begin(), rated_results.end());
   } else {
-    std::partial_sort(results.begin(), results.begin() + limit, results.end(), CompareByRating(key_to_rating_));
-    results.resize(limit);
+    std::partial_sort(rated_results.begin(), rated_results.begin() + limit, rated_results.end());
+    rated_results.resize(limit);
   }
 
+  results.resize(rated_results.size());
+  for (size_t i = 0; i < rated_results.size(); i++) {
+    results[i] = rated_results[i].second;
+  }
   return {total_size, std::move(results)};
 }
 
+Hints::RatingT Hints::get_rating(KeyT key) const {
+  auto it = key_to_rating_.find(key);
+  if (it == key_to_rating_.end()) {
+    return RatingT();
+  }
+  return it->second;
+}
+
 bool Hints::has_key(KeyT key) const {
   return key_to_name_.find(key) != key_to_name_.end();
 }
@@ -230,4 +248,25 @@ size_t Hints::size() const {
   return key_to_name_.size();
 }
 
+size_t Hints::get_memory_size() const {
+  // rough estimate of per-node overhead of standard containers
+  constexpr size_t NODE_OVERHEAD = 4 * sizeof(void *);
+  auto get_words_memory_size = [&](const std::map<string, vector<KeyT>> &word_to_keys) {
+    size_t result = 0;
+    for (auto &it : word_to_keys) {
+      result += NODE_OVERHEAD + sizeof(it) + it.first.capacity() + it.second.capacity() * sizeof(KeyT);
+    }
+    return result;
+  };
+
+  size_t result = sizeof(*this);
+  result += get_words_memory_size(word_to_keys_);
+  result += get_words_memory_size(translit_word_to_keys_);
+  for (auto &it : key_to_name_) {
+    result += NODE_OVERHEAD + sizeof(it) + it.second.capacity();
+  }
+  result += key_to_rating_.size() * (NODE_OVERHEAD + sizeof(std::pair<KeyT, RatingT>));
+  return result;
+}
+
 }  // namespace td
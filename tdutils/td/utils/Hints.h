@@ -41,6 +41,9 @@ class Hints {
 
   size_t size() const;
 
+  // returns approximate size of memory used by the index
+  size_t get_memory_size() const;
+
  private:
   std::map<string, vector<KeyT>> word_to_keys_;
   std::map<string, vector<KeyT>> translit_word_to_keys_;
@@ -59,27 +62,7 @@ class Hints {
 
   vector<KeyT> search_word(const string &word) const;
 
-  class CompareByRating {
-    const std::unordered_map<KeyT, RatingT> &key_to_rating_;
-
-    RatingT get_rating(const KeyT &key) const {
-      auto it = key_to_rating_.find(key);
-      if (it == key_to_rating_.end()) {
-        return RatingT();
-      }
-      return it->second;
-    }
-
-   public:
-    explicit CompareByRating(const std::unordered_map<KeyT, RatingT> &key_to_rating) : key_to_rating_(key_to_rating) {
-    }
-
-    bool operator()(const KeyT &lhs, const KeyT &rhs) const {
-      auto lhs_rating = get_rating(lhs);
-      auto rhs_rating = get_rating(rhs);
-      return lhs_rating < rhs_rating || (lhs_rating == rhs_rating && lhs < rhs);
-    }
-  };
+  RatingT get_rating(KeyT key) const;
 };
 
 }  // namespace td
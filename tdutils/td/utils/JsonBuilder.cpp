@@ -13,6 +13,42 @@
 
 namespace td {
 
+// returns true, if a byte of the word may need to be escaped in a JSON string;
+// bytes with the highest bit set don't need to be escaped only in raw strings
+static bool has_json_escaped_byte(uint64 word, bool is_raw) {
+  constexpr uint64 ONES = 0x0101010101010101ULL;
+  constexpr uint64 HIGH_BITS = 0x8080808080808080ULL;
+  auto has_zero_byte = [](uint64 x) {
+    return ((x - ONES) & ~x & HIGH_BITS) != 0;
+  };
+  if (!is_raw && (word & HIGH_BITS) != 0) {
+    return true;
+  }
+  return ((word - ONES * 0x20) & ~word & HIGH_BITS) != 0 || has_zero_byte(word ^ (ONES * '"')) ||
+         has_zero_byte(word ^ (ONES * '\\'));
+}
+
+static bool is_json_escaped_byte(unsigned char c, bool is_raw) {
+  return c < 0x20 || c == '"' || c == '\\' || (!is_raw && c >= 0x80);
+}
+
+// returns length of the longest prefix of the string, which can be copied to a JSON string without changes
+static size_t get_json_unescaped_prefix_length(Slice str, bool is_raw) {
+  size_t pos = 0;
+  while (str.size() - pos >= 8) {
+    uint64 word;
+    std::memcpy(&word, str.data() + pos, sizeof(word));
+    if (has_json_escaped_byte(word, is_raw)) {
+      break;
+    }
+    pos += 8;
+  }
+  while (pos < str.size() && !is_json_escaped_byte(str.ubegin()[pos], is_raw)) {
+    pos++;
+  }
+  return pos;
+}
+
 StringBuilder &operator<<(StringBuilder &sb, const JsonRawString &val) {
   sb << '"';
   SCOPE_EXIT {
@@ -22,6 +58,15 @@ StringBuilder &operator<<(StringBuilder &sb, const JsonRawString &val) {
   auto len = val.value_.size();
 
   for (size_t pos = 0; pos < len; pos++) {
+    auto unescaped_length = get_json_unescaped_prefix_length(Slice(s + pos, len - pos), true);
+    if (unescaped_length != 0) {
+      sb << Slice(s + pos, unescaped_length);
+      pos += unescaped_length;
+      if (pos == len) {
+        break;
+      }
+    }
+
     auto ch = static_cast<unsigned char>(s[pos]);
     switch (ch) {
       case '"':
@@ -66,6 +111,15 @@ StringBuilder &operator<<(StringBuilder &sb, const JsonString &val) {
   auto len = val.str_.size();
 
   for (size_t pos = 0; pos < len; pos++) {
+    auto unescaped_length = get_json_unescaped_prefix_length(Slice(s + pos, len - pos), false);
+    if (unescaped_length != 0) {
+      sb << Slice(s + pos, unescaped_length);
+      pos += unescaped_length;
+      if (pos == len) {
+        break;
+      }
+    }
+
     auto ch = static_cast<unsigned char>(s[pos]);
     switch (ch) {
       case '"':
@@ -0,0 +1,167 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/EventFd.h"
+
+#if !TD_EVENTFD_UNSUPPORTED
+
+#include "td/utils/MpscLinkQueue.h"
+
+#include <utility>
+
+namespace td {
+// interface like in MpscPollableQueue
+// writer_put is lock-free: it is a single CAS and the event fd is released only by the writer,
+// which has found the queue empty, so a burst of writes wakes the reader up only once
+template <class T>
+class MpscLinkPollableQueue {
+ public:
+  using ValueType = T;
+
+  MpscLinkPollableQueue() = default;
+  MpscLinkPollableQueue(const MpscLinkPollableQueue &) = delete;
+  MpscLinkPollableQueue &operator=(const MpscLinkPollableQueue &) = delete;
+  MpscLinkPollableQueue(MpscLinkPollableQueue &&) = delete;
+  MpscLinkPollableQueue &operator=(MpscLinkPollableQueue &&) = delete;
+  ~MpscLinkPollableQueue() {
+    clear_nodes();
+  }
+
+  int reader_wait_nonblock() {
+    if (reader_ready_ != 0) {
+      return narrow_cast<int>(reader_ready_);
+    }
+
+    for (int i = 0; i < 2; i++) {
+      queue_.pop_all(reader_);
+      reader_ready_ = reader_.calc_size();
+      if (reader_ready_ != 0) {
+        return narrow_cast<int>(reader_ready_);
+      }
+      if (i == 1) {
+        // the queue is empty, so the next writer will release the event fd
+        return 0;
+      }
+      event_fd_.acquire();
+    }
+    UNREACHABLE();
+  }
+  ValueType reader_get_unsafe() {
+    CHECK(reader_ready_ != 0);
+    reader_ready_--;
+    unique_ptr<Node> node(static_cast<Node *>(reader_.read()));
+    return std::move(node->value);
+  }
+  void reader_flush() {
+    //nop
+  }
+  void writer_put(ValueType value) {
+    if (queue_.push(new Node(std::move(value)))) {
+      event_fd_.release();
+    }
+  }
+  EventFd &reader_get_event_fd() {
+    return event_fd_;
+  }
+  void writer_flush() {
+    //nop
+  }
+
+  void init() {
+    event_fd_.init();
+  }
+  void destroy() {
+    if (!event_fd_.empty()) {
+      event_fd_.close();
+      clear_nodes();
+    }
+  }
+
+  // Just an example of usage
+  int reader_wait() {
+    int res;
+    while ((res = reader_wait_nonblock()) == 0) {
+      reader_get_event_fd().wait(1000);
+    }
+    return res;
+  }
+
+ private:
+  struct Node : public MpscLinkQueueImpl::Node {
+    explicit Node(ValueType value) : value(std::move(value)) {
+    }
+    ValueType value;
+  };
+
+  MpscLinkQueueImpl queue_;
+  EventFd event_fd_;
+  MpscLinkQueueImpl::Reader reader_;
+  size_t reader_ready_{0};
+
+  void clear_nodes() {
+    queue_.pop_all(reader_);
+    while (auto node = reader_.read()) {
+      delete static_cast<Node *>(node);
+    }
+    reader_ready_ = 0;
+  }
+};
+
+}  // namespace td
+
+#else
+
+namespace td {
+
+// dummy implementation which shouldn't be used
+
+template <class T>
+class MpscLinkPollableQueue {
+ public:
+  using ValueType = T;
+
+  void init() {
+    UNREACHABLE();
+  }
+
+  template <class PutValueType>
+  void writer_put(PutValueType &&value) {
+    UNREACHABLE();
+  }
+
+  void writer_flush() {
+    UNREACHABLE();
+  }
+
+  int reader_wait_nonblock() {
+    UNREACHABLE();
+    return 0;
+  }
+
+  ValueType reader_get_unsafe() {
+    UNREACHABLE();
+    return ValueType();
+  }
+
+  void reader_flush() {
+    UNREACHABLE();
+  }
+
+  MpscLinkPollableQueue() = default;
+  MpscLinkPollableQueue(const MpscLinkPollableQueue &) = delete;
+  MpscLinkPollableQueue &operator=(const MpscLinkPollableQueue &) = delete;
+  MpscLinkPollableQueue(MpscLinkPollableQueue &&) = delete;
+  MpscLinkPollableQueue &operator=(MpscLinkPollableQueue &&) = delete;
+  ~MpscLinkPollableQueue() = default;
+};
+
+}  // namespace td
+
+#endif
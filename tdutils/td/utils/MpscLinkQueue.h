@@ -17,10 +17,13 @@ class MpscLinkQueueImpl {
   class Node;
   class Reader;
 
-  void push(Node *node) {
-    node->next_ = head_.load(std::memory_order_relaxed);
-    while (!head_.compare_exchange_strong(node->next_, node, std::memory_order_release, std::memory_order_relaxed)) {
-    }
+  // returns true, if the queue was empty before the push
+  bool push(Node *node) {
+    auto head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next_ = head;
+    } while (!head_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    return head == nullptr;
   }
 
   void push_unsafe(Node *node) {
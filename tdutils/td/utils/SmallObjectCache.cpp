@@ -0,0 +1,168 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/SmallObjectCache.h"
+
+#include "td/utils/port/thread_local.h"
+#include "td/utils/SpinLock.h"
+
+#include <array>
+#include <new>
+
+namespace td {
+
+namespace {
+struct FreeBlock {
+  FreeBlock *next;
+  FreeBlock *next_batch;  // used only for the first block of a batch in SmallObjectDepot
+};
+
+// batches of free blocks, which are passed from threads freeing more objects than they allocate
+// to threads allocating more objects than they free, so the global allocator isn't used in producer-consumer workloads
+class SmallObjectDepot {
+ public:
+  static constexpr size_t SIZE_CLASS_COUNT = 16;
+  static constexpr size_t MAX_BATCH_COUNT = 64;
+
+  bool push_batch(size_t size_class, FreeBlock *batch) {
+    auto &size_class_batches = batches_[size_class];
+    auto lock = size_class_batches.lock.lock();
+    if (size_class_batches.count == MAX_BATCH_COUNT) {
+      return false;
+    }
+    batch->next_batch = size_class_batches.first_batch;
+    size_class_batches.first_batch = batch;
+    size_class_batches.count++;
+    return true;
+  }
+
+  FreeBlock *pop_batch(size_t size_class) {
+    auto &size_class_batches = batches_[size_class];
+    auto lock = size_class_batches.lock.lock();
+    auto batch = size_class_batches.first_batch;
+    if (batch != nullptr) {
+      size_class_batches.first_batch = batch->next_batch;
+      size_class_batches.count--;
+    }
+    return batch;
+  }
+
+ private:
+  struct SizeClassBatches {
+    SpinLock lock;
+    FreeBlock *first_batch = nullptr;
+    size_t count = 0;
+  };
+  std::array<SizeClassBatches, SIZE_CLASS_COUNT> batches_;
+};
+
+SmallObjectDepot &get_small_object_depot() {
+  // the depot is never destroyed, because threads can exit after static objects are destroyed
+  static SmallObjectDepot *depot = new SmallObjectDepot();
+  return *depot;
+}
+
+class SmallObjectCache {
+ public:
+  static constexpr size_t SIZE_CLASS_STEP = 16;
+  static constexpr size_t SIZE_CLASS_COUNT = SmallObjectDepot::SIZE_CLASS_COUNT;
+  static constexpr size_t BATCH_SIZE = 64;
+  static constexpr size_t MAX_CACHED_BLOCK_COUNT = 1024;
+
+  SmallObjectCache() {
+    free_blocks_.fill(nullptr);
+    free_block_counts_.fill(0);
+  }
+  SmallObjectCache(const SmallObjectCache &) = delete;
+  SmallObjectCache &operator=(const SmallObjectCache &) = delete;
+  SmallObjectCache(SmallObjectCache &&) = delete;
+  SmallObjectCache &operator=(SmallObjectCache &&) = delete;
+  ~SmallObjectCache() {
+    for (size_t size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++) {
+      // the cached blocks are left to other threads as long as the depot has space for them
+      while (free_block_counts_[size_class] >= BATCH_SIZE && push_batch(size_class)) {
+      }
+      auto block = free_blocks_[size_class];
+      while (block != nullptr) {
+        auto next = block->next;
+        ::operator delete(block);
+        block = next;
+      }
+    }
+  }
+
+  static size_t get_size_class(size_t size) {
+    return (size - 1) / SIZE_CLASS_STEP;
+  }
+
+  void *allocate(size_t size_class) {
+    auto block = free_blocks_[size_class];
+    if (block == nullptr) {
+      block = get_small_object_depot().pop_batch(size_class);
+      if (block == nullptr) {
+        return ::operator new((size_class + 1) * SIZE_CLASS_STEP);
+      }
+      free_block_counts_[size_class] = BATCH_SIZE;
+    }
+    free_blocks_[size_class] = block->next;
+    free_block_counts_[size_class]--;
+    return block;
+  }
+
+  void deallocate(void *ptr, size_t size_class) {
+    if (free_block_counts_[size_class] == MAX_CACHED_BLOCK_COUNT && !push_batch(size_class)) {
+      return ::operator delete(ptr);
+    }
+    auto block = static_cast<FreeBlock *>(ptr);
+    block->next = free_blocks_[size_class];
+    free_blocks_[size_class] = block;
+    free_block_counts_[size_class]++;
+  }
+
+ private:
+  std::array<FreeBlock *, SIZE_CLASS_COUNT> free_blocks_;
+  std::array<size_t, SIZE_CLASS_COUNT> free_block_counts_;
+
+  bool push_batch(size_t size_class) {
+    auto batch = free_blocks_[size_class];
+    auto last_block = batch;
+    for (size_t i = 1; i < BATCH_SIZE; i++) {
+      last_block = last_block->next;
+    }
+    auto rest = last_block->next;
+    last_block->next = nullptr;
+    if (!get_small_object_depot().push_batch(size_class, batch)) {
+      last_block->next = rest;
+      return false;
+    }
+    free_blocks_[size_class] = rest;
+    free_block_counts_[size_class] -= BATCH_SIZE;
+    return true;
+  }
+};
+
+TD_THREAD_LOCAL SmallObjectCache *small_object_cache;  // static zero-initialized
+}  // namespace
+
+void *allocate_small_object(size_t size) {
+  auto size_class = SmallObjectCache::get_size_class(size);
+  if (size_class >= SmallObjectCache::SIZE_CLASS_COUNT) {
+    return ::operator new(size);
+  }
+  init_thread_local<SmallObjectCache>(small_object_cache);
+  return small_object_cache->allocate(size_class);
+}
+
+void free_small_object(void *ptr, size_t size) {
+  auto size_class = SmallObjectCache::get_size_class(size);
+  if (size_class >= SmallObjectCache::SIZE_CLASS_COUNT || small_object_cache == nullptr) {
+    // both the cache and the global allocator allocate blocks with ::operator new, so they can be freed directly
+    return ::operator delete(ptr);
+  }
+  small_object_cache->deallocate(ptr, size_class);
+}
+
+}  // namespace td
@@ -0,0 +1,20 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+namespace td {
+
+// memory for small short-lived objects, which is cached per thread in size classes of 16 bytes up to 256 bytes
+// the memory can be freed by any thread, but the size must be the same as was passed to allocate_small_object
+// memory freed by other threads is handed back to allocating threads in batches
+void *allocate_small_object(size_t size);
+
+void free_small_object(void *ptr, size_t size);
+
+}  // namespace td
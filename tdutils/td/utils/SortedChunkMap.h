@@ -0,0 +1,287 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace td {
+
+// ordered map with unique keys, which stores its elements in a sorted list of chunks with contiguous keys and values
+// lookups are done by binary search over the chunks and then inside the chunk, so they touch only a few cache lines
+// in-order iteration is a linear scan over chunk arrays
+// insertion and erasure move at most MAX_CHUNK_SIZE elements inside a chunk
+// any insertion or erasure invalidates all iterators, but not the stored values
+template <class KeyT, class ValueT, size_t MAX_CHUNK_SIZE = 128>
+class SortedChunkMap {
+  static_assert(MAX_CHUNK_SIZE >= 4, "Chunk size is too small");
+
+  struct Chunk {
+    vector<KeyT> keys;
+    vector<ValueT> values;
+  };
+
+ public:
+  template <class MapT, class ValueRefT>
+  class IteratorImpl {
+   public:
+    IteratorImpl() = default;
+
+    const KeyT &key() const {
+      return map_->chunks_[chunk_].keys[pos_];
+    }
+
+    ValueRefT value() const {
+      return map_->chunks_[chunk_].values[pos_];
+    }
+
+    bool operator==(const IteratorImpl &other) const {
+      return chunk_ == other.chunk_ && pos_ == other.pos_;
+    }
+
+    bool operator!=(const IteratorImpl &other) const {
+      return !(*this == other);
+    }
+
+    // end() must not be incremented
+    IteratorImpl &operator++() {
+      if (++pos_ == map_->chunks_[chunk_].keys.size()) {
+        chunk_++;
+        pos_ = 0;
+      }
+      return *this;
+    }
+
+    // decrementing of begin() returns end(), decrementing of end() returns the last element
+    IteratorImpl &operator--() {
+      if (pos_ > 0) {
+        pos_--;
+      } else if (chunk_ == 0) {
+        chunk_ = map_->chunks_.size();
+      } else {
+        chunk_--;
+        pos_ = map_->chunks_[chunk_].keys.size() - 1;
+      }
+      return *this;
+    }
+
+   private:
+    friend class SortedChunkMap;
+
+    MapT *map_ = nullptr;
+    size_t chunk_ = 0;
+    size_t pos_ = 0;
+
+    IteratorImpl(MapT *map, size_t chunk, size_t pos) : map_(map), chunk_(chunk), pos_(pos) {
+    }
+  };
+
+  using Iterator = IteratorImpl<SortedChunkMap, ValueT &>;
+  using ConstIterator = IteratorImpl<const SortedChunkMap, const ValueT &>;
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+  }
+
+  Iterator begin() {
+    return Iterator(this, 0, 0);
+  }
+  ConstIterator begin() const {
+    return ConstIterator(this, 0, 0);
+  }
+
+  Iterator end() {
+    return Iterator(this, chunks_.size(), 0);
+  }
+  ConstIterator end() const {
+    return ConstIterator(this, chunks_.size(), 0);
+  }
+
+  // returns iterator to the first element with key not less than the given key
+  Iterator lower_bound(const KeyT &key) {
+    auto chunk_pos = lower_bound_chunk(key);
+    return Iterator(this, chunk_pos, lower_bound_pos(chunk_pos, key));
+  }
+  ConstIterator lower_bound(const KeyT &key) const {
+    auto chunk_pos = lower_bound_chunk(key);
+    return ConstIterator(this, chunk_pos, lower_bound_pos(chunk_pos, key));
+  }
+
+  // returns iterator to the first element with key greater than the given key
+  Iterator upper_bound(const KeyT &key) {
+    auto chunk_pos = upper_bound_chunk(key);
+    return Iterator(this, chunk_pos, upper_bound_pos(chunk_pos, key));
+  }
+  ConstIterator upper_bound(const KeyT &key) const {
+    auto chunk_pos = upper_bound_chunk(key);
+    return ConstIterator(this, chunk_pos, upper_bound_pos(chunk_pos, key));
+  }
+
+  // returns iterator to the first element, for which is_before(value) is false;
+  // the elements must be partitioned by is_before
+  template <class F>
+  ConstIterator partition_point(const F &is_before) const {
+    auto chunk_it = std::partition_point(chunks_.begin(), chunks_.end(),
+                                         [&is_before](const Chunk &chunk) { return is_before(chunk.values.back()); });
+    if (chunk_it == chunks_.end()) {
+      return end();
+    }
+    auto &values = chunk_it->values;
+    auto pos = std::partition_point(values.begin(), values.end(), is_before) - values.begin();
+    return ConstIterator(this, static_cast<size_t>(chunk_it - chunks_.begin()), static_cast<size_t>(pos));
+  }
+
+  ValueT *get(const KeyT &key) {
+    auto it = lower_bound(key);
+    if (it == end() || key < it.key()) {
+      return nullptr;
+    }
+    return &it.value();
+  }
+  const ValueT *get(const KeyT &key) const {
+    auto it = lower_bound(key);
+    if (it == end() || key < it.key()) {
+      return nullptr;
+    }
+    return &it.value();
+  }
+
+  // the key must not be already in the map
+  ValueT &insert(KeyT key, ValueT value) {
+    size_++;
+    if (chunks_.empty()) {
+      chunks_.emplace_back();
+      chunks_[0].keys.push_back(std::move(key));
+      chunks_[0].values.push_back(std::move(value));
+      return chunks_[0].values[0];
+    }
+
+    auto chunk_pos = lower_bound_chunk(key);
+    if (chunk_pos == chunks_.size()) {
+      chunk_pos--;
+    }
+    auto pos = lower_bound_pos(chunk_pos, key);
+    CHECK(pos == chunks_[chunk_pos].keys.size() || key < chunks_[chunk_pos].keys[pos]);
+    if (chunks_[chunk_pos].keys.size() == MAX_CHUNK_SIZE) {
+      split_chunk(chunk_pos);
+      auto left_size = chunks_[chunk_pos].keys.size();
+      if (pos > left_size) {
+        pos -= left_size;
+        chunk_pos++;
+      }
+    }
+
+    auto &chunk = chunks_[chunk_pos];
+    chunk.keys.insert(chunk.keys.begin() + pos, std::move(key));
+    chunk.values.insert(chunk.values.begin() + pos, std::move(value));
+    return chunk.values[pos];
+  }
+
+  // the key must be in the map; returns the erased value
+  ValueT erase(const KeyT &key) {
+    auto chunk_pos = lower_bound_chunk(key);
+    CHECK(chunk_pos < chunks_.size());
+    auto pos = lower_bound_pos(chunk_pos, key);
+    auto &chunk = chunks_[chunk_pos];
+    CHECK(!(key < chunk.keys[pos]));
+
+    ValueT result = std::move(chunk.values[pos]);
+    chunk.keys.erase(chunk.keys.begin() + pos);
+    chunk.values.erase(chunk.values.begin() + pos);
+    size_--;
+
+    if (chunk.keys.empty()) {
+      chunks_.erase(chunks_.begin() + chunk_pos);
+    } else if (chunk.keys.size() < MAX_CHUNK_SIZE / 4) {
+      try_merge_chunk(chunk_pos);
+    }
+    return result;
+  }
+
+ private:
+  vector<Chunk> chunks_;
+  size_t size_ = 0;
+
+  size_t lower_bound_chunk(const KeyT &key) const {
+    return std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                            [](const Chunk &chunk, const KeyT &key) { return chunk.keys.back() < key; }) -
+           chunks_.begin();
+  }
+
+  size_t upper_bound_chunk(const KeyT &key) const {
+    return std::upper_bound(chunks_.begin(), chunks_.end(), key,
+                            [](const KeyT &key, const Chunk &chunk) { return key < chunk.keys.back(); }) -
+           chunks_.begin();
+  }
+
+  size_t lower_bound_pos(size_t chunk_pos, const KeyT &key) const {
+    if (chunk_pos == chunks_.size()) {
+      return 0;
+    }
+    auto &keys = chunks_[chunk_pos].keys;
+    return std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+  }
+
+  size_t upper_bound_pos(size_t chunk_pos, const KeyT &key) const {
+    if (chunk_pos == chunks_.size()) {
+      return 0;
+    }
+    auto &keys = chunks_[chunk_pos].keys;
+    return std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+  }
+
+  void split_chunk(size_t chunk_pos) {
+    auto &chunk = chunks_[chunk_pos];
+    auto half = chunk.keys.size() / 2;
+
+    Chunk new_chunk;
+    new_chunk.keys.reserve(MAX_CHUNK_SIZE);
+    new_chunk.values.reserve(MAX_CHUNK_SIZE);
+    new_chunk.keys.assign(std::make_move_iterator(chunk.keys.begin() + half), std::make_move_iterator(chunk.keys.end()));
+    new_chunk.values.assign(std::make_move_iterator(chunk.values.begin() + half),
+                            std::make_move_iterator(chunk.values.end()));
+    chunk.keys.erase(chunk.keys.begin() + half, chunk.keys.end());
+    chunk.values.erase(chunk.values.begin() + half, chunk.values.end());
+
+    chunks_.insert(chunks_.begin() + chunk_pos + 1, std::move(new_chunk));
+  }
+
+  void try_merge_chunk(size_t chunk_pos) {
+    auto size = chunks_[chunk_pos].keys.size();
+    if (chunk_pos + 1 < chunks_.size() && size + chunks_[chunk_pos + 1].keys.size() <= MAX_CHUNK_SIZE) {
+      merge_chunks(chunk_pos);
+    } else if (chunk_pos > 0 && size + chunks_[chunk_pos - 1].keys.size() <= MAX_CHUNK_SIZE) {
+      merge_chunks(chunk_pos - 1);
+    }
+  }
+
+  // moves all elements of the chunk chunk_pos + 1 to the end of the chunk chunk_pos
+  void merge_chunks(size_t chunk_pos) {
+    auto &chunk = chunks_[chunk_pos];
+    auto &next_chunk = chunks_[chunk_pos + 1];
+    chunk.keys.insert(chunk.keys.end(), std::make_move_iterator(next_chunk.keys.begin()),
+                      std::make_move_iterator(next_chunk.keys.end()));
+    chunk.values.insert(chunk.values.end(), std::make_move_iterator(next_chunk.values.begin()),
+                        std::make_move_iterator(next_chunk.values.end()));
+    chunks_.erase(chunks_.begin() + chunk_pos + 1);
+  }
+};
+
+}  // namespace td
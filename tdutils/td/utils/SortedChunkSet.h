@@ -0,0 +1,115 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/SortedChunkMap.h"
+
+namespace td {
+
+// ordered set with unique keys, which stores them in a sorted list of chunks; see SortedChunkMap
+// any insertion or erasure invalidates all iterators
+template <class KeyT, size_t MAX_CHUNK_SIZE = 128>
+class SortedChunkSet {
+  struct Empty {};
+  using MapT = SortedChunkMap<KeyT, Empty, MAX_CHUNK_SIZE>;
+
+ public:
+  class ConstIterator {
+   public:
+    ConstIterator() = default;
+
+    const KeyT &operator*() const {
+      return it_.key();
+    }
+
+    const KeyT *operator->() const {
+      return &it_.key();
+    }
+
+    bool operator==(const ConstIterator &other) const {
+      return it_ == other.it_;
+    }
+
+    bool operator!=(const ConstIterator &other) const {
+      return it_ != other.it_;
+    }
+
+    ConstIterator &operator++() {
+      ++it_;
+      return *this;
+    }
+
+    ConstIterator &operator--() {
+      --it_;
+      return *this;
+    }
+
+   private:
+    friend class SortedChunkSet;
+
+    typename MapT::ConstIterator it_;
+
+    explicit ConstIterator(typename MapT::ConstIterator it) : it_(it) {
+    }
+  };
+
+  size_t size() const {
+    return map_.size();
+  }
+
+  bool empty() const {
+    return map_.empty();
+  }
+
+  void clear() {
+    map_.clear();
+  }
+
+  ConstIterator begin() const {
+    return ConstIterator(map_.begin());
+  }
+
+  ConstIterator end() const {
+    return ConstIterator(map_.end());
+  }
+
+  ConstIterator lower_bound(const KeyT &key) const {
+    return ConstIterator(map_.lower_bound(key));
+  }
+
+  ConstIterator upper_bound(const KeyT &key) const {
+    return ConstIterator(map_.upper_bound(key));
+  }
+
+  bool contains(const KeyT &key) const {
+    return map_.get(key) != nullptr;
+  }
+
+  // returns true, if the key was inserted
+  bool insert(KeyT key) {
+    if (contains(key)) {
+      return false;
+    }
+    map_.insert(std::move(key), Empty());
+    return true;
+  }
+
+  // returns number of erased keys
+  size_t erase(const KeyT &key) {
+    if (!contains(key)) {
+      return 0;
+    }
+    map_.erase(key);
+    return 1;
+  }
+
+ private:
+  MapT map_;
+};
+
+}  // namespace td
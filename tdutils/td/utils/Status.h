@@ -114,6 +114,13 @@
     }                                           \
   }
 
+// returns an error with the given constant code and message, which is allocated once per call site
+#define STATIC_ERROR(code, message)                                                     \
+  [] {                                                                                  \
+    static const ::td::Status static_status = ::td::Status::StaticError(code, message); \
+    return static_status.clone();                                                       \
+  }()
+
 #ifndef TD_STATUS_NO_ENSURE
 #define ensure() ensure_impl(__FILE__, __LINE__)
 #define ensure_error() ensure_error_impl(__FILE__, __LINE__)
@@ -198,6 +205,11 @@ class Status {
     return Error<0>();
   }
 
+  // the returned error is never deallocated and clone() of it doesn't allocate memory, so it must be created once
+  static Status StaticError(int err, Slice message) TD_WARN_UNUSED_RESULT {
+    return Status(true, ErrorType::General, err, message);
+  }
+
   template <int Code>
   static Status Error() {
     static Status status(true, ErrorType::General, Code, "");
@@ -27,6 +27,11 @@ class StringBuilder {
     error_flag_ = false;
   }
 
+  // removes the last character; the builder must be non-empty
+  void pop_back() {
+    current_ptr_--;
+  }
+
   MutableCSlice as_cslice() {
     if (current_ptr_ >= end_ptr_ + RESERVED_SIZE) {
       std::abort();  // shouldn't happen
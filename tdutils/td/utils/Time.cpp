@@ -6,6 +6,8 @@
 //
 #include "td/utils/Time.h"
 
+#include "td/utils/port/thread_local.h"
+
 #include <atomic>
 #include <cmath>
 
@@ -25,6 +27,25 @@ double Time::now_unadjusted() {
   return Clocks::monotonic();
 }
 
+static TD_THREAD_LOCAL double coarse_now;  // 0 if the coarse time isn't maintained in the thread
+
+double Time::now_coarse() {
+  auto result = coarse_now;
+  if (result == 0) {
+    return now();
+  }
+  return result;
+}
+
+double Time::update_coarse() {
+  coarse_now = now();
+  return coarse_now;
+}
+
+void Time::reset_coarse() {
+  coarse_now = 0;
+}
+
 void Time::jump_in_future(double at) {
   while (true) {
     auto old_time_diff = time_diff.load();
@@ -30,6 +30,17 @@ class Time {
   }
   static double now_unadjusted();
 
+  // Returns the time saved by the last update_coarse() call in the current thread or now(), if there was none.
+  // The value can lag behind now() for the duration of a scheduler iteration and isn't synchronized between threads,
+  // so it must be used only for statistics and activity tracking, which tolerate such staleness.
+  static double now_coarse();
+
+  // Saves now() as the coarse time of the current thread; is called by Scheduler at the start of every iteration
+  static double update_coarse();
+
+  // Makes now_coarse() return now() in the current thread
+  static void reset_coarse();
+
   // Used for testing. After jump_in_future(at) is called, now() >= at.
   static void jump_in_future(double at);
 };
@@ -47,11 +47,17 @@ StringBuilder &operator<<(StringBuilder &string_builder, const Timer &timer) {
 }
 
 PerfWarningTimer::PerfWarningTimer(string name, double max_duration)
-    : name_(std::move(name)), start_at_(Time::now()), max_duration_(max_duration) {
+    : name_(std::move(name))
+    , start_at_(Time::now())
+    , max_duration_(max_duration)
+    , start_counters_(PerfCounters::get_thread_values()) {
 }
 
 PerfWarningTimer::PerfWarningTimer(PerfWarningTimer &&other)
-    : name_(std::move(other.name_)), start_at_(other.start_at_), max_duration_(other.max_duration_) {
+    : name_(std::move(other.name_))
+    , start_at_(other.start_at_)
+    , max_duration_(other.max_duration_)
+    , start_counters_(other.start_counters_) {
   other.start_at_ = 0;
 }
 
@@ -64,8 +70,14 @@ void PerfWarningTimer::reset() {
     return;
   }
   double duration = Time::now() - start_at_;
-  LOG_IF(WARNING, duration > max_duration_)
-      << "SLOW: " << tag("name", name_) << tag("duration", format::as_time(duration));
+  if (duration > max_duration_) {
+    PerfCounters::Values counters;
+    if (!start_counters_.empty()) {
+      counters = PerfCounters::get_thread_values() - start_counters_;
+    }
+    LOG(WARNING) << "SLOW: " << tag("name", name_) << tag("duration", format::as_time(duration))
+                 << format::cond(!counters.empty(), counters);
+  }
   start_at_ = 0;
 }
 
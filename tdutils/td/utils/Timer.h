@@ -6,6 +6,7 @@
 //
 #pragma once
 
+#include "td/utils/port/PerfCounters.h"
 #include "td/utils/StringBuilder.h"
 
 namespace td {
@@ -30,6 +31,9 @@ class Timer {
   bool is_paused_{true};
 };
 
+// logs a warning if the scope takes more than max_duration
+// the warning includes changes of the thread's PerfCounters, if they are enabled,
+// to distinguish CPU-bound work from waits for I/O or for the scheduler
 class PerfWarningTimer {
  public:
   explicit PerfWarningTimer(string name, double max_duration = 0.1);
@@ -44,6 +48,7 @@ class PerfWarningTimer {
   string name_;
   double start_at_{0};
   double max_duration_{0};
+  PerfCounters::Values start_counters_;
 };
 
 }  // namespace td
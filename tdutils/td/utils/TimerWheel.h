@@ -0,0 +1,291 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace td {
+
+struct TimerWheelNode {
+  bool in_timer_wheel() const {
+    return slot_ != -1;
+  }
+  double get_timeout_at() const {
+    return timeout_at_;
+  }
+
+ private:
+  friend class TimerWheel;
+
+  TimerWheelNode *prev_ = nullptr;
+  TimerWheelNode *next_ = nullptr;
+  double timeout_at_ = 0.0;
+  int32 slot_ = -1;
+};
+
+// hierarchical timing wheel with O(1) insertion and removal of timeouts
+// nodes are distributed between slots of 1 millisecond, 64 milliseconds, ~4 seconds and ~4 minutes length;
+// the slots are moved to the lower levels as the time passes, and exact timeouts are compared only in the nearest slot,
+// so nodes are returned as from a heap: when their timeout is less than the current time, earlier timeouts first
+class TimerWheel {
+ public:
+  TimerWheel() {
+    slots_.fill(nullptr);
+    masks_.fill(0);
+  }
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+  TimerWheel(TimerWheel &&) = delete;
+  TimerWheel &operator=(TimerWheel &&) = delete;
+  ~TimerWheel() = default;
+
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+  // the time of the wheel is advanced by pop_expired; for an empty wheel it can be also set directly,
+  // otherwise nodes inserted long after the last pop_expired are moved between the levels several times
+  void set_now(double now) {
+    CHECK(empty());
+    current_tick_ = get_tick(now);
+  }
+
+  void insert(double timeout_at, TimerWheelNode *node) {
+    CHECK(!node->in_timer_wheel());
+    node->timeout_at_ = timeout_at;
+    link(node, get_slot(get_tick(timeout_at)));
+    size_++;
+    if (is_wakeup_at_known_ && timeout_at < wakeup_at_) {
+      wakeup_at_ = timeout_at;
+    }
+  }
+
+  void fix(double timeout_at, TimerWheelNode *node) {
+    erase(node);
+    insert(timeout_at, node);
+  }
+
+  void erase(TimerWheelNode *node) {
+    CHECK(node->in_timer_wheel());
+    unlink(node);
+    size_--;
+  }
+
+  // returns time, before which there are no expiring nodes; the wheel must be checked for expired nodes at that time
+  // it is the earliest timeout of a node if it is expected soon, and the time of the next move between levels otherwise
+  double get_wakeup_at() {
+    CHECK(!empty());
+    if (!is_wakeup_at_known_) {
+      wakeup_at_ = calc_wakeup_at();
+      is_wakeup_at_known_ = true;
+    }
+    return wakeup_at_;
+  }
+
+  // removes and returns a node with timeout less than now, or returns nullptr if there are no such nodes
+  // the wheel can be changed between calls, for example, by callbacks of the returned nodes
+  TimerWheelNode *pop_expired(double now) {
+    if (slots_[EXPIRED_SLOT] == nullptr) {
+      collect_expired(now);
+      if (slots_[EXPIRED_SLOT] == nullptr) {
+        return nullptr;
+      }
+    }
+    auto node = slots_[EXPIRED_SLOT];
+    erase(node);
+    is_wakeup_at_known_ = false;
+    return node;
+  }
+
+ private:
+  static constexpr int32 TICKS_PER_SECOND = 1000;
+  static constexpr int32 LEVEL_BITS = 6;
+  static constexpr int32 LEVEL_COUNT = 4;
+  static constexpr int32 SLOT_COUNT = 1 << LEVEL_BITS;
+  static constexpr int32 EXPIRED_SLOT = LEVEL_COUNT * SLOT_COUNT;
+
+  // slots of all levels and the list of already expired nodes sorted by timeout
+  std::array<TimerWheelNode *, EXPIRED_SLOT + 1> slots_;
+  std::array<uint64, LEVEL_COUNT> masks_;
+  int64 current_tick_ = 0;
+  size_t size_ = 0;
+  double wakeup_at_ = 0.0;
+  bool is_wakeup_at_known_ = false;
+  vector<TimerWheelNode *> expired_nodes_;
+
+  static int64 get_tick(double time) {
+    return static_cast<int64>(std::floor(time * TICKS_PER_SECOND));
+  }
+
+  static double get_tick_time(int64 tick) {
+    return static_cast<double>(tick) / TICKS_PER_SECOND;
+  }
+
+  // a node is put to the level of the highest differing digit between its tick and the current tick,
+  // and nodes which are already expired are put to the current slot of the level 0
+  int32 get_slot(int64 tick) const {
+    if (tick <= current_tick_) {
+      return static_cast<int32>(current_tick_ & (SLOT_COUNT - 1));
+    }
+    auto diff = static_cast<uint64>(tick ^ current_tick_);
+    auto level = (63 - count_leading_zeroes64(diff)) / LEVEL_BITS;
+    if (level >= LEVEL_COUNT) {
+      // the node is too far in the future and will be moved to the same slot of the highest level again
+      level = LEVEL_COUNT - 1;
+    }
+    return level * SLOT_COUNT + static_cast<int32>((tick >> (level * LEVEL_BITS)) & (SLOT_COUNT - 1));
+  }
+
+  void link(TimerWheelNode *node, int32 slot) {
+    node->slot_ = slot;
+    node->prev_ = nullptr;
+    node->next_ = slots_[slot];
+    if (node->next_ != nullptr) {
+      node->next_->prev_ = node;
+    }
+    slots_[slot] = node;
+    if (slot != EXPIRED_SLOT) {
+      masks_[slot / SLOT_COUNT] |= static_cast<uint64>(1) << (slot % SLOT_COUNT);
+    }
+  }
+
+  void unlink(TimerWheelNode *node) {
+    auto slot = node->slot_;
+    if (node->prev_ == nullptr) {
+      slots_[slot] = node->next_;
+    } else {
+      node->prev_->next_ = node->next_;
+    }
+    if (node->next_ != nullptr) {
+      node->next_->prev_ = node->prev_;
+    }
+    node->prev_ = nullptr;
+    node->next_ = nullptr;
+    node->slot_ = -1;
+    if (slot != EXPIRED_SLOT && slots_[slot] == nullptr) {
+      masks_[slot / SLOT_COUNT] &= ~(static_cast<uint64>(1) << (slot % SLOT_COUNT));
+    }
+  }
+
+  int32 get_current_slot() const {
+    return static_cast<int32>(current_tick_ & (SLOT_COUNT - 1));
+  }
+
+  // returns the nearest tick after the current one, at which a non-empty slot must be processed, and its level,
+  // or -1 as the level, if all the slots except the current slot of the level 0 are empty
+  int64 get_next_tick(int32 &level) const {
+    for (int32 i = 0; i < LEVEL_COUNT; i++) {
+      auto shift = i * LEVEL_BITS;
+      auto index = static_cast<int32>((current_tick_ >> shift) & (SLOT_COUNT - 1));
+      auto base_tick = (current_tick_ >> (shift + LEVEL_BITS)) << (shift + LEVEL_BITS);
+      auto next_mask = masks_[i] & ~((static_cast<uint64>(2) << index) - 1);
+      if (next_mask != 0) {
+        level = i;
+        return base_tick + (static_cast<int64>(count_trailing_zeroes64(next_mask)) << shift);
+      }
+      if (i == LEVEL_COUNT - 1 && masks_[i] != 0) {
+        // the remaining slots of the highest level belong to its next rotation
+        level = i;
+        return base_tick + ((static_cast<int64>(count_trailing_zeroes64(masks_[i])) + SLOT_COUNT) << shift);
+      }
+    }
+    level = -1;
+    return std::numeric_limits<int64>::max();
+  }
+
+  void cascade(int32 level) {
+    auto slot = level * SLOT_COUNT + static_cast<int32>((current_tick_ >> (level * LEVEL_BITS)) & (SLOT_COUNT - 1));
+    auto node = slots_[slot];
+    while (node != nullptr) {
+      auto next_node = node->next_;
+      unlink(node);
+      link(node, get_slot(get_tick(node->timeout_at_)));
+      node = next_node;
+    }
+  }
+
+  static double get_min_timeout_at(const TimerWheelNode *node) {
+    auto result = std::numeric_limits<double>::infinity();
+    for (; node != nullptr; node = node->next_) {
+      result = td::min(result, node->timeout_at_);
+    }
+    return result;
+  }
+
+  double calc_wakeup_at() const {
+    if (slots_[EXPIRED_SLOT] != nullptr) {
+      return slots_[EXPIRED_SLOT]->timeout_at_;
+    }
+    auto result = get_min_timeout_at(slots_[get_current_slot()]);
+    int32 level;
+    auto next_tick = get_next_tick(level);
+    if (level == 0) {
+      result = td::min(result, get_min_timeout_at(slots_[next_tick & (SLOT_COUNT - 1)]));
+    } else if (level > 0) {
+      result = td::min(result, get_tick_time(next_tick));
+    }
+    return result;
+  }
+
+  void move_expired(int32 slot, double now) {
+    auto node = slots_[slot];
+    while (node != nullptr) {
+      auto next_node = node->next_;
+      if (node->timeout_at_ < now) {
+        unlink(node);
+        expired_nodes_.push_back(node);
+      }
+      node = next_node;
+    }
+  }
+
+  void collect_expired(double now) {
+    is_wakeup_at_known_ = false;
+    auto target_tick = get_tick(now);
+    if (empty()) {
+      current_tick_ = td::max(current_tick_, target_tick);
+      return;
+    }
+
+    while (current_tick_ < target_tick) {
+      // all nodes from the current slot are expired, because the whole tick has already passed
+      move_expired(get_current_slot(), std::numeric_limits<double>::infinity());
+
+      int32 level;
+      auto next_tick = get_next_tick(level);
+      if (next_tick > target_tick) {
+        current_tick_ = target_tick;
+        break;
+      }
+      current_tick_ = next_tick;
+      if (level > 0) {
+        cascade(level);
+      }
+    }
+    move_expired(get_current_slot(), now);
+
+    std::stable_sort(expired_nodes_.begin(), expired_nodes_.end(),
+                     [](const TimerWheelNode *lhs, const TimerWheelNode *rhs) {
+                       return lhs->timeout_at_ < rhs->timeout_at_;
+                     });
+    for (auto it = expired_nodes_.rbegin(); it != expired_nodes_.rend(); ++it) {
+      link(*it, EXPIRED_SLOT);
+    }
+    expired_nodes_.clear();
+  }
+};
+
+}  // namespace td
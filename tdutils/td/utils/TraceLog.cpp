@@ -0,0 +1,222 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/TraceLog.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/config.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/MemoryMapping.h"
+#include "td/utils/port/thread_local.h"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#if TD_PORT_POSIX
+#include <unistd.h>
+#endif
+
+namespace td {
+
+static_assert(sizeof(TraceLog::Event) == 32, "");
+static_assert(sizeof(TraceLog::FileHeader) == 64, "");
+
+constexpr uint64 TraceLog::FileHeader::MAGIC;
+constexpr size_t TraceLog::DEFAULT_EVENTS_PER_THREAD;
+
+std::atomic<bool> TraceLog::is_enabled_{false};
+
+namespace {
+
+int get_process_id() {
+#if TD_PORT_POSIX
+  return getpid();
+#elif TD_PORT_WINDOWS
+  return GetCurrentProcessId();
+#endif
+}
+
+class TraceLogImpl {
+ public:
+  Status init(CSlice directory, size_t events_per_thread) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (is_inited_) {
+      return Status::Error("Trace log is already initialized");
+    }
+    directory_ = directory.str();
+    if (!directory_.empty() && directory_.back() != TD_DIR_SLASH) {
+      directory_ += TD_DIR_SLASH;
+    }
+    process_id_ = get_process_id();
+    events_per_thread_ = 1;
+    while (events_per_thread_ < events_per_thread) {
+      events_per_thread_ *= 2;
+    }
+    TRY_RESULT_ASSIGN(names_fd_, FileFd::open(PSLICE() << directory_ << "names." << process_id_ << ".txt",
+                                              FileFd::Create | FileFd::Truncate | FileFd::Write));
+    is_inited_ = true;
+    return Status::OK();
+  }
+
+  bool is_inited() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return is_inited_;
+  }
+
+  uint32 get_name_id(Slice name) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = name_ids_.find(name.str());
+    if (it != name_ids_.end()) {
+      return it->second;
+    }
+    auto name_id = static_cast<uint32>(name_ids_.size() + 1);
+    name_ids_.emplace(name.str(), name_id);
+    if (!names_fd_.empty()) {
+      // the file contains a name per line, so line breaks in names are replaced with spaces
+      auto line = PSTRING() << name_id << ' ' << name;
+      for (auto &c : line) {
+        if (c == '\n' || c == '\r') {
+          c = ' ';
+        }
+      }
+      line += '\n';
+      // write errors aren't fatal, the names are just lost
+      names_fd_.write(line).ignore();
+    }
+    return name_id;
+  }
+
+  Result<MemoryMapping> create_thread_file() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!is_inited_) {
+      return Status::Error("Trace log isn't initialized");
+    }
+    auto thread_index = ++thread_count_;
+    TRY_RESULT(fd, FileFd::open(PSLICE() << directory_ << "trace." << process_id_ << '.' << thread_index << ".bin",
+                                FileFd::Create | FileFd::Truncate | FileFd::Read | FileFd::Write));
+    auto file_size =
+        static_cast<int64>(sizeof(TraceLog::FileHeader) + events_per_thread_ * sizeof(TraceLog::Event));
+    TRY_STATUS(fd.seek(file_size));
+    TRY_STATUS(fd.truncate_to_current_position(file_size));
+    TRY_RESULT(mapping, MemoryMapping::create_from_file(fd, MemoryMapping::Options().with_writable(true)));
+
+    auto *header = reinterpret_cast<TraceLog::FileHeader *>(mapping.as_mutable_slice().begin());
+    header->magic = TraceLog::FileHeader::MAGIC;
+    header->event_size = static_cast<uint32>(sizeof(TraceLog::Event));
+    header->reserved = 0;
+    header->capacity = events_per_thread_;
+    header->thread_index = thread_index;
+    header->event_count.store(0, std::memory_order_relaxed);
+    return std::move(mapping);
+  }
+
+ private:
+  std::mutex mutex_;
+  bool is_inited_ = false;
+  string directory_;
+  int process_id_ = 0;
+  size_t events_per_thread_ = 0;
+  uint64 thread_count_ = 0;
+  FileFd names_fd_;
+  std::unordered_map<string, uint32> name_ids_;
+};
+
+TraceLogImpl &get_trace_log() {
+  // never destroyed, because events can be added during destruction of other static objects
+  static TraceLogImpl *trace_log = new TraceLogImpl();
+  return *trace_log;
+}
+
+class ThreadTraceLog {
+ public:
+  ThreadTraceLog() {
+    auto r_mapping = get_trace_log().create_thread_file();
+    if (r_mapping.is_ok()) {
+      mapping_ = r_mapping.move_as_ok();
+      auto data = mapping_.ok_ref().as_mutable_slice();
+      header_ = reinterpret_cast<TraceLog::FileHeader *>(data.begin());
+      events_ = reinterpret_cast<TraceLog::Event *>(data.begin() + sizeof(TraceLog::FileHeader));
+      mask_ = header_->capacity - 1;
+    }
+  }
+
+  void add_event(const TraceLog::Event &event) {
+    if (header_ == nullptr) {
+      return;
+    }
+    auto event_count = header_->event_count.load(std::memory_order_relaxed);
+    events_[event_count & mask_] = event;
+    header_->event_count.store(event_count + 1, std::memory_order_release);
+  }
+
+  uint32 get_name_id(Slice name) {
+    auto &entry = name_cache_[(reinterpret_cast<std::uintptr_t>(name.data()) >> 3) % NAME_CACHE_SIZE];
+    if (entry.data != name.data() || entry.name != name) {
+      entry.data = name.data();
+      entry.name = name.str();
+      entry.name_id = get_trace_log().get_name_id(name);
+    }
+    return entry.name_id;
+  }
+
+ private:
+  static constexpr size_t NAME_CACHE_SIZE = 256;
+
+  struct NameCacheEntry {
+    const char *data = nullptr;
+    string name;
+    uint32 name_id = 0;
+  };
+
+  Result<MemoryMapping> mapping_ = Status::Error("Trace file wasn't created");
+  TraceLog::FileHeader *header_ = nullptr;
+  TraceLog::Event *events_ = nullptr;
+  uint64 mask_ = 0;
+  std::array<NameCacheEntry, NAME_CACHE_SIZE> name_cache_;
+};
+
+TD_THREAD_LOCAL ThreadTraceLog *thread_trace_log;  // static zero-initialized
+
+ThreadTraceLog *get_thread_trace_log() {
+  init_thread_local<ThreadTraceLog>(thread_trace_log);
+  return thread_trace_log;
+}
+
+}  // namespace
+
+Status TraceLog::init(CSlice directory, size_t events_per_thread) {
+  return get_trace_log().init(directory, events_per_thread);
+}
+
+void TraceLog::set_enabled(bool is_enabled) {
+  if (is_enabled && !get_trace_log().is_inited()) {
+    LOG(ERROR) << "Trace log must be initialized before it is enabled";
+    return;
+  }
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+uint32 TraceLog::get_name_id(Slice name) {
+  return get_thread_trace_log()->get_name_id(name);
+}
+
+void TraceLog::add_event(EventType type, uint32 name_id, uint64 id, uint64 arg) {
+  Event event;
+  event.timestamp = static_cast<uint64>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+  event.type = static_cast<uint32>(type);
+  event.name_id = name_id;
+  event.id = id;
+  event.arg = arg;
+  get_thread_trace_log()->add_event(event);
+}
+
+}  // namespace td
@@ -0,0 +1,73 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <atomic>
+
+namespace td {
+
+// binary log of hot-path events
+// every thread writes fixed-size events to its own memory mapped ring file "trace.<pid>.<index>.bin" in the directory,
+// so the last events are kept even if the process crashes; event names are stored once in "names.<pid>.txt"
+// an event costs a clock read and a 32-byte store, and disabled tracing costs a relaxed atomic load
+// the files can be converted to Chrome trace format with benchmark/trace_to_json
+class TraceLog {
+ public:
+  enum class EventType : uint32 {
+    ActorEventBegin = 1,  // id is the actor, arg is the type of the event
+    ActorEventEnd,
+    QuerySent,  // id is the message identifier, arg is the constructor of the query
+    QueryReceived,
+    DbOperationBegin,  // id is the statement
+    DbOperationEnd
+  };
+
+  struct Event {
+    uint64 timestamp;  // in nanoseconds since an unspecified point of the monotonic clock
+    uint32 type;
+    uint32 name_id;  // 0 if the event has no name
+    uint64 id;
+    uint64 arg;
+  };
+
+  struct FileHeader {
+    static constexpr uint64 MAGIC = 0x3145434152544454;  // "TDTRACE1"
+    uint64 magic;
+    uint32 event_size;
+    uint32 reserved;
+    uint64 capacity;  // in events; a power of two
+    uint64 thread_index;
+    std::atomic<uint64> event_count;  // the event i is stored at position i % capacity
+    uint64 padding[3];
+  };
+
+  static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+  // can be called only once; tracing is disabled after initialization
+  static Status init(CSlice directory, size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD) TD_WARN_UNUSED_RESULT;
+
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // returns identifier of the name; names are expected to be nearly constant, because they are never forgotten
+  static uint32 get_name_id(Slice name);
+
+  // must be called only after initialization; usually, it is called only if tracing is enabled
+  static void add_event(EventType type, uint32 name_id, uint64 id, uint64 arg = 0);
+
+ private:
+  static std::atomic<bool> is_enabled_;
+};
+
+}  // namespace td
@@ -13,6 +13,13 @@
 #include <algorithm>
 #include <iterator>
 
+#if (TD_GCC || TD_CLANG) && defined(__x86_64__)
+#define TD_HAVE_BASE64_AVX2 1
+#include <immintrin.h>
+#else
+#define TD_HAVE_BASE64_AVX2 0
+#endif
+
 namespace td {
 
 template <bool is_url>
@@ -36,33 +43,139 @@ static const unsigned char *get_character_table() {
   return char_to_value;
 }
 
+#if TD_HAVE_BASE64_AVX2
+#define TD_BASE64_AVX2_TARGET __attribute__((target("avx2")))
+
+// AVX2 versions of base64 encoding and decoding of 24-byte blocks, based on the algorithms
+// by Wojciech Mula and Daniel Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions"
+class Base64Avx2 {
+ public:
+  static bool is_supported() {
+    static const bool is_supported = __builtin_cpu_supports("avx2") != 0;
+    return is_supported;
+  }
+
+  // encodes 24-byte blocks while at least 28 bytes of the input are available; returns number of encoded bytes
+  template <bool is_url>
+  TD_BASE64_AVX2_TARGET static size_t encode(const unsigned char *input, size_t size, char *output) {
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4,
+                                             7, 6, 8, 7, 10, 9, 11, 10);
+    const char c62 = is_url ? '-' : '+';
+    const char c63 = is_url ? '_' : '/';
+    const __m256i offsets =
+        _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, static_cast<char>(c62 - 62),
+                         static_cast<char>(c63 - 63), 0, 0, 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,
+                         static_cast<char>(c62 - 62), static_cast<char>(c63 - 63), 0, 0);
+    size_t i = 0;
+    for (; i + 28 <= size; i += 24) {
+      auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+      auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i + 12));
+      auto in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+      // split each 3 bytes to 4 6-bit values
+      in = _mm256_shuffle_epi8(in, shuffle);
+      auto t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+      auto t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+      auto values = _mm256_or_si256(t0, t1);
+
+      // translate values to characters by adding an offset depending on the range of the value
+      auto indices = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+      indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25)));
+      auto result = _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, indices));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i / 3 * 4), result);
+    }
+    return i;
+  }
+
+  // decodes 32-character blocks while they consist of valid characters; returns number of decoded characters
+  template <bool is_url>
+  TD_BASE64_AVX2_TARGET static size_t decode(const unsigned char *input, size_t size, char *output) {
+    const char c62 = is_url ? '-' : '+';
+    const char c63 = is_url ? '_' : '/';
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+      auto in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+
+      // all bytes greater than 127 are negative and don't belong to any range
+      auto is_upper = get_range_mask(in, 'A', 'Z');
+      auto is_lower = get_range_mask(in, 'a', 'z');
+      auto is_digit = get_range_mask(in, '0', '9');
+      auto is_62 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c62));
+      auto is_63 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c63));
+      auto is_valid = _mm256_or_si256(_mm256_or_si256(is_upper, is_lower), _mm256_or_si256(is_digit, is_62));
+      is_valid = _mm256_or_si256(is_valid, is_63);
+      if (_mm256_movemask_epi8(is_valid) != -1) {
+        break;
+      }
+
+      auto shift = _mm256_and_si256(is_upper, _mm256_set1_epi8(-65));
+      shift = _mm256_or_si256(shift, _mm256_and_si256(is_lower, _mm256_set1_epi8(-71)));
+      shift = _mm256_or_si256(shift, _mm256_and_si256(is_digit, _mm256_set1_epi8(4)));
+      shift = _mm256_or_si256(shift, _mm256_and_si256(is_62, _mm256_set1_epi8(static_cast<char>(62 - c62))));
+      shift = _mm256_or_si256(shift, _mm256_and_si256(is_63, _mm256_set1_epi8(static_cast<char>(63 - c63))));
+      auto values = _mm256_add_epi8(in, shift);
+
+      // merge each 4 6-bit values to 3 bytes
+      auto merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+      merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+      merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2,
+                                                            1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+      merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+      char *ptr = output + i / 4 * 3;
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), _mm256_castsi256_si128(merged));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(ptr + 16), _mm256_extracti128_si256(merged, 1));
+    }
+    return i;
+  }
+
+ private:
+  TD_BASE64_AVX2_TARGET static __m256i get_range_mask(__m256i in, char from, char to) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(static_cast<char>(from - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(to + 1)), in));
+  }
+};
+#endif
+
 template <bool is_url>
 string base64_encode_impl(Slice input) {
   auto characters = get_characters<is_url>();
-  string base64;
-  base64.reserve((input.size() + 2) / 3 * 4);
-  for (size_t i = 0; i < input.size();) {
+  size_t result_size = input.size() / 3 * 4;
+  if (input.size() % 3 != 0) {
+    result_size += is_url ? input.size() % 3 + 1 : 4;
+  }
+  string base64(result_size, '\0');
+  char *ptr = &base64[0];
+  size_t i = 0;
+#if TD_HAVE_BASE64_AVX2
+  if (Base64Avx2::is_supported()) {
+    i = Base64Avx2::encode<is_url>(input.ubegin(), input.size(), ptr);
+    ptr += i / 3 * 4;
+  }
+#endif
+  while (i < input.size()) {
     size_t left = min(input.size() - i, static_cast<size_t>(3));
     int c = input.ubegin()[i++] << 16;
-    base64 += characters[c >> 18];
+    *ptr++ = characters[c >> 18];
     if (left != 1) {
       c |= input.ubegin()[i++] << 8;
     }
-    base64 += characters[(c >> 12) & 63];
+    *ptr++ = characters[(c >> 12) & 63];
     if (left == 3) {
       c |= input.ubegin()[i++];
     }
     if (left != 1) {
-      base64 += characters[(c >> 6) & 63];
+      *ptr++ = characters[(c >> 6) & 63];
     } else if (!is_url) {
-      base64 += '=';
+      *ptr++ = '=';
     }
     if (left == 3) {
-      base64 += characters[c & 63];
+      *ptr++ = characters[c & 63];
     } else if (!is_url) {
-      base64 += '=';
+      *ptr++ = '=';
     }
   }
+  CHECK(ptr == base64.data() + base64.size());
   return base64;
 }
 
@@ -93,8 +206,17 @@ Result<Slice> base64_drop_padding(Slice base64) {
   return base64;
 }
 
-static Status do_base64_decode_impl(Slice base64, const unsigned char *table, char *ptr) {
-  for (size_t i = 0; i < base64.size();) {
+template <bool is_url>
+static Status do_base64_decode_impl(Slice base64, char *ptr) {
+  auto table = get_character_table<is_url>();
+  size_t i = 0;
+#if TD_HAVE_BASE64_AVX2
+  if (Base64Avx2::is_supported()) {
+    i = Base64Avx2::decode<is_url>(base64.ubegin(), base64.size(), ptr);
+    ptr += i / 4 * 3;
+  }
+#endif
+  while (i < base64.size()) {
     size_t left = min(base64.size() - i, static_cast<size_t>(4));
     int c = 0;
     for (size_t t = 0; t < left; t++) {
@@ -136,15 +258,31 @@ SecureString create_empty<SecureString>(size_t size) {
   return SecureString{size};
 }
 
+static size_t get_base64_decoded_size(Slice base64) {
+  return base64.size() / 4 * 3 + ((base64.size() & 3) + 1) / 2;
+}
+
 template <bool is_url, class T>
 static Result<T> base64_decode_impl(Slice base64) {
   TRY_RESULT_ASSIGN(base64, base64_drop_padding<is_url>(base64));
 
-  T result = create_empty<T>(base64.size() / 4 * 3 + ((base64.size() & 3) + 1) / 2);
-  TRY_STATUS(do_base64_decode_impl(base64, get_character_table<is_url>(), as_mutable_slice(result).begin()));
+  T result = create_empty<T>(get_base64_decoded_size(base64));
+  TRY_STATUS(do_base64_decode_impl<is_url>(base64, as_mutable_slice(result).begin()));
   return std::move(result);
 }
 
+template <bool is_url>
+static Result<MutableSlice> base64_decode_impl(Slice base64, MutableSlice buffer) {
+  TRY_RESULT_ASSIGN(base64, base64_drop_padding<is_url>(base64));
+
+  auto size = get_base64_decoded_size(base64);
+  if (buffer.size() < size) {
+    return Status::Error("Buffer is too small");
+  }
+  TRY_STATUS(do_base64_decode_impl<is_url>(base64, buffer.begin()));
+  return buffer.substr(0, size);
+}
+
 Result<string> base64_decode(Slice base64) {
   return base64_decode_impl<false, string>(base64);
 }
@@ -157,6 +295,14 @@ Result<string> base64url_decode(Slice base64) {
   return base64_decode_impl<true, string>(base64);
 }
 
+Result<MutableSlice> base64_decode(Slice base64, MutableSlice buffer) {
+  return base64_decode_impl<false>(base64, buffer);
+}
+
+Result<MutableSlice> base64url_decode(Slice base64, MutableSlice buffer) {
+  return base64_decode_impl<true>(base64, buffer);
+}
+
 template <bool is_url>
 static bool is_base64_impl(Slice input) {
   size_t padding_length = 0;
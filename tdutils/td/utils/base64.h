@@ -20,6 +20,10 @@ Result<SecureString> base64_decode_secure(Slice base64);
 string base64url_encode(Slice input);
 Result<string> base64url_decode(Slice base64);
 
+// decode to the beginning of the buffer, which can start at the same address as base64; return the decoded data
+Result<MutableSlice> base64_decode(Slice base64, MutableSlice buffer);
+Result<MutableSlice> base64url_decode(Slice base64, MutableSlice buffer);
+
 bool is_base64(Slice input);
 bool is_base64url(Slice input);
 
@@ -0,0 +1,212 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/benchmark.h"
+
+#include "td/utils/filesystem.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/misc.h"
+#include "td/utils/OptionParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace td {
+
+double BenchmarkResult::get_percentile(int percent) const {
+  if (ns_per_op.empty()) {
+    return 0;
+  }
+  auto pos = (ns_per_op.size() * percent + 99) / 100;
+  return ns_per_op[pos == 0 ? 0 : pos - 1];
+}
+
+bool BenchmarkRunner::is_filtered_out(Slice description) const {
+  for (const auto &filter : substr_filters_) {
+    bool is_match = description.str().find(filter.substr(1)) != string::npos;
+    if (is_match != (filter[0] == '+')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BenchmarkRunner::run(Benchmark &b) {
+  auto description = b.get_description();
+  if (is_filtered_out(description)) {
+    return;
+  }
+  if (need_list_) {
+    LOG(PLAIN) << description;
+    return;
+  }
+
+  int n = 1;
+  double pass_time = 0;
+  double total_pass_time = 0;
+  while (pass_time < max_time_ && total_pass_time < max_time_ * 3 && n < (1 << 30)) {
+    n *= 2;
+    std::tie(pass_time, total_pass_time) = bench_n(b, n);
+  }
+  for (int i = 0; i < warmup_count_; i++) {
+    bench_n(b, n);
+  }
+
+  BenchmarkResult result;
+  result.name = std::move(description);
+  result.n = n;
+  double sum = 0;
+  double square_sum = 0;
+  for (int i = 0; i < repeat_count_; i++) {
+    auto ns_per_op = bench_n(b, n).first * 1e9 / n;
+    result.ns_per_op.push_back(ns_per_op);
+    sum += ns_per_op;
+    square_sum += ns_per_op * ns_per_op;
+  }
+  std::sort(result.ns_per_op.begin(), result.ns_per_op.end());
+  if (repeat_count_ > 0) {
+    result.mean = sum / repeat_count_;
+    result.stddev = std::sqrt(std::max(square_sum / repeat_count_ - result.mean * result.mean, 0.0));
+  }
+
+  std::string pad;
+  if (result.name.size() < 40) {
+    pad = std::string(40 - result.name.size(), ' ');
+  }
+  LOG(ERROR) << "Bench [" << pad << result.name << "]: " << format::as_time(result.mean * 1e-9)
+             << " [p50 = " << format::as_time(result.get_percentile(50) * 1e-9)
+             << ", p90 = " << format::as_time(result.get_percentile(90) * 1e-9)
+             << ", p99 = " << format::as_time(result.get_percentile(99) * 1e-9)
+             << ", d = " << format::as_time(result.stddev * 1e-9) << "], "
+             << StringBuilder::FixedDouble(result.mean == 0 ? 0.0 : 1e9 / result.mean, 3) << " ops/sec";
+  results_.push_back(std::move(result));
+}
+
+string BenchmarkRunner::to_json(const vector<BenchmarkResult> &results) {
+  return json_encode<string>(json_object([&results](auto &o) {
+                               o("benchmarks", json_array(results, [](const BenchmarkResult &result) {
+                                   return json_object([&result](auto &o) {
+                                     o("name", result.name);
+                                     o("n", result.n);
+                                     o("repeat", narrow_cast<int32>(result.ns_per_op.size()));
+                                     o("mean_ns", result.mean);
+                                     o("stddev_ns", result.stddev);
+                                     o("min_ns", result.get_percentile(0));
+                                     o("p50_ns", result.get_percentile(50));
+                                     o("p90_ns", result.get_percentile(90));
+                                     o("p99_ns", result.get_percentile(99));
+                                     o("max_ns", result.get_percentile(100));
+                                   });
+                                 }));
+                             }),
+                             true);
+}
+
+Result<vector<string>> BenchmarkRunner::compare_with_baseline(const vector<BenchmarkResult> &results,
+                                                              Slice baseline_json, double threshold) {
+  auto json_copy = baseline_json.str();
+  TRY_RESULT(value, json_decode(json_copy));
+  if (value.type() != JsonValue::Type::Object) {
+    return Status::Error("Expected an object");
+  }
+  TRY_RESULT(benchmarks, get_json_object_field(value.get_object(), "benchmarks", JsonValue::Type::Array, false));
+
+  std::unordered_map<string, double> baseline_medians;
+  for (auto &benchmark : benchmarks.get_array()) {
+    if (benchmark.type() != JsonValue::Type::Object) {
+      return Status::Error("Expected an object");
+    }
+    auto &object = benchmark.get_object();
+    TRY_RESULT(name, get_json_object_string_field(object, "name", false));
+    TRY_RESULT(median, get_json_object_double_field(object, "p50_ns", false));
+    baseline_medians[name] = median;
+  }
+
+  vector<string> regressions;
+  for (auto &result : results) {
+    auto it = baseline_medians.find(result.name);
+    if (it == baseline_medians.end() || it->second <= 0) {
+      continue;
+    }
+    auto median = result.get_percentile(50);
+    if (median > it->second * (1 + threshold)) {
+      regressions.push_back(PSTRING() << result.name << ": " << format::as_time(median * 1e-9) << " instead of "
+                                      << format::as_time(it->second * 1e-9) << " ("
+                                      << StringBuilder::FixedDouble((median / it->second - 1) * 100, 1) << "% slower)");
+    }
+  }
+  return std::move(regressions);
+}
+
+bool BenchmarkRunner::init(int argc, char *argv[]) {
+  OptionParser options;
+  options.set_description("Benchmark runner");
+  options.add_option('f', "filter", "Run only benchmarks with description containing the string",
+                     [&](Slice filter) {
+                       string str = filter.str();
+                       if (str[0] != '+' && str[0] != '-') {
+                         str = "+" + str;
+                       }
+                       substr_filters_.push_back(std::move(str));
+                     });
+  options.add_checked_option('w', "warmup", "Number of unmeasured passes after calibration, 1 by default",
+                             OptionParser::parse_integer(warmup_count_));
+  options.add_checked_option('r', "repeat", "Number of measured passes, 5 by default",
+                             OptionParser::parse_integer(repeat_count_));
+  options.add_option('t', "time", "Minimum duration of a pass in seconds, 1 by default",
+                     [&](Slice arg) { max_time_ = to_double(arg); });
+  options.add_option('j', "json", "Save results in JSON to the file", [&](Slice path) { json_path_ = path.str(); });
+  options.add_option('b', "baseline", "Compare results with the JSON file saved by a previous run",
+                     [&](Slice path) { baseline_path_ = path.str(); });
+  options.add_option('p', "threshold", "Allowed slowdown of median in percents, 10 by default",
+                     [&](Slice arg) { threshold_ = to_double(arg) / 100; });
+  options.add_option('l', "list", "List benchmarks without running them", [&] { need_list_ = true; });
+  auto r_non_options = options.run(argc, argv, 0);
+  if (r_non_options.is_error()) {
+    LOG(PLAIN) << argv[0] << ": " << r_non_options.error().message();
+    LOG(PLAIN) << options;
+    return false;
+  }
+  return true;
+}
+
+int BenchmarkRunner::finish() {
+  if (need_list_) {
+    return 0;
+  }
+
+  if (!json_path_.empty()) {
+    auto status = write_file(json_path_, to_json(results_));
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to save results to " << json_path_ << ": " << status;
+      return 1;
+    }
+  }
+
+  if (!baseline_path_.empty()) {
+    auto r_baseline = read_file_str(baseline_path_);
+    if (r_baseline.is_error()) {
+      LOG(ERROR) << "Failed to read baseline from " << baseline_path_ << ": " << r_baseline.error();
+      return 1;
+    }
+    auto r_regressions = compare_with_baseline(results_, r_baseline.ok(), threshold_);
+    if (r_regressions.is_error()) {
+      LOG(ERROR) << "Failed to parse baseline from " << baseline_path_ << ": " << r_regressions.error();
+      return 1;
+    }
+    auto regressions = r_regressions.move_as_ok();
+    for (auto &regression : regressions) {
+      LOG(ERROR) << "Regression in " << regression;
+    }
+    if (!regressions.empty()) {
+      return 2;
+    }
+  }
+  return 0;
+}
+
+}  // namespace td
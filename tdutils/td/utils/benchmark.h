@@ -6,9 +6,12 @@
 //
 #pragma once
 
+#include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 
 #include <cmath>
@@ -129,4 +132,55 @@ inline void bench(Benchmark &&b, double max_time = 1.0) {
   bench(b, max_time);
 }
 
+struct BenchmarkResult {
+  string name;
+  int n = 0;                 // number of operations in a pass
+  vector<double> ns_per_op;  // for each measured pass, sorted
+
+  double mean = 0;
+  double stddev = 0;
+  double get_percentile(int percent) const;
+};
+
+// runs benchmarks with the same command line options in every benchmark binary:
+// filtering by description, warmup and measured passes, percentiles over passes,
+// JSON output and comparison with results saved by a previous run
+class BenchmarkRunner {
+ public:
+  // parses command line options; returns false if the process must exit
+  bool init(int argc, char *argv[]);
+
+  void run(Benchmark &b);
+  void run(Benchmark &&b) {
+    run(b);
+  }
+
+  // saves and compares results; returns the exit code of the process,
+  // which is non-zero if a benchmark is slower than its baseline by more than the allowed threshold
+  int finish();
+
+  const vector<BenchmarkResult> &get_results() const {
+    return results_;
+  }
+
+  static string to_json(const vector<BenchmarkResult> &results);
+
+  // returns descriptions of regressions; threshold is a relative slowdown of the median, for example 0.1 for 10%
+  static Result<vector<string>> compare_with_baseline(const vector<BenchmarkResult> &results, Slice baseline_json,
+                                                      double threshold);
+
+ private:
+  vector<string> substr_filters_;
+  int warmup_count_ = 1;
+  int repeat_count_ = 5;
+  double max_time_ = 1.0;
+  string json_path_;
+  string baseline_path_;
+  double threshold_ = 0.1;
+  bool need_list_ = false;
+  vector<BenchmarkResult> results_;
+
+  bool is_filtered_out(Slice description) const;
+};
+
 }  // namespace td
@@ -6,10 +6,13 @@
 //
 #include "td/utils/buffer.h"
 
+#include "td/utils/bits.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/ThreadSafeCounter.h"
 
+#include <array>
 #include <cstddef>
+#include <mutex>
 #include <new>
 
 // fixes https://bugs.llvm.org/show_bug.cgi?id=33723 for clang >= 3.6 + c++11 + libc++
@@ -27,6 +30,204 @@ std::atomic<size_t> BufferAllocator::buffer_mem;
 
 static ThreadSafeCounter buffer_slice_size_;
 
+namespace {
+
+// buffers with data size in (2 KB, 1 MB] are allocated in size classes, four per power of two, and are reused
+// freed buffers are cached by the freeing thread and are passed through a shared cache to the threads, which need them,
+// so buffers allocated by one thread and freed by another are reused too
+constexpr size_t MIN_POOLED_SIZE_LOG = 11;
+constexpr size_t MAX_POOLED_SIZE_LOG = 20;
+constexpr size_t SIZE_CLASS_COUNT = (MAX_POOLED_SIZE_LOG - MIN_POOLED_SIZE_LOG) * 4;
+constexpr size_t LOCAL_CACHE_SIZE = 256 << 10;  // per size class
+constexpr size_t SHARED_CACHE_SIZE = 1 << 20;   // per size class
+
+bool is_pooled_size(size_t size) {
+  return (static_cast<size_t>(1) << MIN_POOLED_SIZE_LOG) < size &&
+         size <= (static_cast<size_t>(1) << MAX_POOLED_SIZE_LOG);
+}
+
+size_t get_size_class(size_t size) {
+  auto size_log = static_cast<size_t>(63 - count_leading_zeroes64(size - 1));
+  auto step = ((size - 1) >> (size_log - 2)) & 3;
+  return (size_log - MIN_POOLED_SIZE_LOG) * 4 + step;
+}
+
+size_t get_size_class_size(size_t size_class) {
+  auto size_log = MIN_POOLED_SIZE_LOG + size_class / 4;
+  return (static_cast<size_t>(1) << size_log) + ((size_class % 4 + 1) << (size_log - 2));
+}
+
+size_t get_max_cached_count(size_t size_class, size_t cache_size) {
+  return td::max(cache_size / get_size_class_size(size_class), static_cast<size_t>(1));
+}
+
+size_t get_buffer_raw_size(size_t size) {
+  return td::max(sizeof(BufferRaw), TD_OFFSETOF(BufferRaw, data_) + size);
+}
+
+// used and cached buffer counts for every size class
+ThreadSafeMultiCounter<SIZE_CLASS_COUNT * 2> buffer_counters;
+
+void on_used_count_changed(size_t size_class, int64 diff) {
+  buffer_counters.add(size_class * 2, diff);
+}
+
+void on_cached_count_changed(size_t size_class, int64 diff) {
+  buffer_counters.add(size_class * 2 + 1, diff);
+}
+
+struct FreeBuffer {
+  FreeBuffer *next;
+};
+
+void free_buffers(size_t size_class, FreeBuffer *head) {
+  while (head != nullptr) {
+    auto next = head->next;
+    ::operator delete(head);
+    on_cached_count_changed(size_class, -1);
+    head = next;
+  }
+}
+
+class SharedBufferCache {
+ public:
+  FreeBuffer *pop(size_t size_class, size_t max_count, size_t &count) {
+    auto &list = lists_[size_class];
+    std::lock_guard<std::mutex> guard(list.mutex);
+    auto head = list.head;
+    FreeBuffer *tail = nullptr;
+    count = 0;
+    while (list.head != nullptr && count < max_count) {
+      tail = list.head;
+      list.head = list.head->next;
+      count++;
+    }
+    if (tail == nullptr) {
+      return nullptr;
+    }
+    tail->next = nullptr;
+    list.count -= count;
+    return head;
+  }
+
+  void push(size_t size_class, FreeBuffer *head) {
+    auto &list = lists_[size_class];
+    {
+      std::lock_guard<std::mutex> guard(list.mutex);
+      auto max_count = get_max_cached_count(size_class, SHARED_CACHE_SIZE);
+      while (head != nullptr && list.count < max_count) {
+        auto next = head->next;
+        head->next = list.head;
+        list.head = head;
+        list.count++;
+        head = next;
+      }
+    }
+    free_buffers(size_class, head);
+  }
+
+ private:
+  struct List {
+    std::mutex mutex;
+    FreeBuffer *head = nullptr;
+    size_t count = 0;
+  };
+  std::array<List, SIZE_CLASS_COUNT> lists_;
+};
+
+SharedBufferCache &get_shared_buffer_cache() {
+  // never destroyed, because buffers can be freed during destruction of other static objects
+  static SharedBufferCache *cache = new SharedBufferCache();
+  return *cache;
+}
+
+class LocalBufferCache {
+ public:
+  LocalBufferCache() {
+    heads_.fill(nullptr);
+    counts_.fill(0);
+  }
+  LocalBufferCache(const LocalBufferCache &) = delete;
+  LocalBufferCache &operator=(const LocalBufferCache &) = delete;
+  LocalBufferCache(LocalBufferCache &&) = delete;
+  LocalBufferCache &operator=(LocalBufferCache &&) = delete;
+  ~LocalBufferCache() {
+    for (size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+      get_shared_buffer_cache().push(i, heads_[i]);
+    }
+  }
+
+  void *allocate(size_t size_class) {
+    if (heads_[size_class] == nullptr) {
+      heads_[size_class] = get_shared_buffer_cache().pop(
+          size_class, (get_max_cached_count(size_class, LOCAL_CACHE_SIZE) + 1) / 2, counts_[size_class]);
+      if (heads_[size_class] == nullptr) {
+        return ::operator new(TD_OFFSETOF(BufferRaw, data_) + get_size_class_size(size_class));
+      }
+    }
+    auto result = heads_[size_class];
+    heads_[size_class] = result->next;
+    counts_[size_class]--;
+    on_cached_count_changed(size_class, -1);
+    return result;
+  }
+
+  void free(void *ptr, size_t size_class) {
+    auto max_count = get_max_cached_count(size_class, LOCAL_CACHE_SIZE);
+    if (counts_[size_class] == max_count) {
+      // pass a half of the cached buffers to other threads
+      auto head = heads_[size_class];
+      auto tail = head;
+      for (size_t i = 1; i < max_count / 2; i++) {
+        tail = tail->next;
+      }
+      heads_[size_class] = tail->next;
+      counts_[size_class] -= max_count / 2;
+      tail->next = nullptr;
+      get_shared_buffer_cache().push(size_class, max_count / 2 == 0 ? nullptr : head);
+    }
+    auto buffer = static_cast<FreeBuffer *>(ptr);
+    buffer->next = heads_[size_class];
+    heads_[size_class] = buffer;
+    counts_[size_class]++;
+    on_cached_count_changed(size_class, 1);
+  }
+
+ private:
+  std::array<FreeBuffer *, SIZE_CLASS_COUNT> heads_;
+  std::array<size_t, SIZE_CLASS_COUNT> counts_;
+};
+
+TD_THREAD_LOCAL LocalBufferCache *local_buffer_cache;  // static zero-initialized
+
+void *allocate_buffer_raw_memory(size_t size) {
+  if (!is_pooled_size(size)) {
+    return ::operator new(get_buffer_raw_size(size));
+  }
+  auto size_class = get_size_class(size);
+  on_used_count_changed(size_class, 1);
+  init_thread_local<LocalBufferCache>(local_buffer_cache);
+  return local_buffer_cache->allocate(size_class);
+}
+
+void free_buffer_raw_memory(void *ptr, size_t size) {
+  if (!is_pooled_size(size)) {
+    return ::operator delete(ptr);
+  }
+  auto size_class = get_size_class(size);
+  on_used_count_changed(size_class, -1);
+  if (local_buffer_cache == nullptr) {
+    // the thread is being destroyed
+    auto buffer = static_cast<FreeBuffer *>(ptr);
+    buffer->next = nullptr;
+    on_cached_count_changed(size_class, 1);
+    return get_shared_buffer_cache().push(size_class, buffer);
+  }
+  local_buffer_cache->free(ptr, size_class);
+}
+
+}  // namespace
+
 int64 BufferAllocator::get_buffer_slice_size() {
   return buffer_slice_size_.sum();
 }
@@ -43,6 +244,26 @@ size_t BufferAllocator::get_buffer_mem() {
   return buffer_mem;
 }
 
+vector<BufferAllocator::SizeClassStats> BufferAllocator::get_size_class_stats() {
+  vector<SizeClassStats> result;
+  for (size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+    SizeClassStats stats;
+    stats.buffer_size = get_size_class_size(i);
+    stats.used_count = buffer_counters.sum(i * 2);
+    stats.cached_count = buffer_counters.sum(i * 2 + 1);
+    result.push_back(stats);
+  }
+  return result;
+}
+
+size_t BufferAllocator::get_cached_buffer_mem() {
+  size_t result = 0;
+  for (auto &stats : get_size_class_stats()) {
+    result += static_cast<size_t>(stats.cached_count) * get_buffer_raw_size(stats.buffer_size);
+  }
+  return result;
+}
+
 BufferAllocator::WriterPtr BufferAllocator::create_writer(size_t size) {
   if (size < 512) {
     size = 512;
@@ -99,23 +320,18 @@ BufferAllocator::ReaderPtr BufferAllocator::create_reader(const ReaderPtr &raw)
 void BufferAllocator::dec_ref_cnt(BufferRaw *ptr) {
   int left = ptr->ref_cnt_.fetch_sub(1, std::memory_order_acq_rel);
   if (left == 1) {
-    auto buf_size = max(sizeof(BufferRaw), TD_OFFSETOF(BufferRaw, data_) + ptr->data_size_);
-    buffer_mem -= buf_size;
+    auto size = ptr->data_size_;
+    buffer_mem -= get_buffer_raw_size(size);
     ptr->~BufferRaw();
-    delete[] ptr;
+    free_buffer_raw_memory(ptr, size);
   }
 }
 
 BufferRaw *BufferAllocator::create_buffer_raw(size_t size) {
   size = (size + 7) & -8;
 
-  auto buf_size = TD_OFFSETOF(BufferRaw, data_) + size;
-  if (buf_size < sizeof(BufferRaw)) {
-    buf_size = sizeof(BufferRaw);
-  }
-  buffer_mem += buf_size;
-  auto *buffer_raw = reinterpret_cast<BufferRaw *>(new char[buf_size]);
-  return new (buffer_raw) BufferRaw(size);
+  buffer_mem += get_buffer_raw_size(size);
+  return new (allocate_buffer_raw_memory(size)) BufferRaw(size);
 }
 
 void BufferBuilder::append(BufferSlice slice) {
@@ -9,6 +9,7 @@
 #include "td/utils/common.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SmallObjectCache.h"
 
 #include <atomic>
 #include <limits>
@@ -69,6 +70,16 @@ class BufferAllocator {
   static size_t get_buffer_mem();
   static int64 get_buffer_slice_size();
 
+  struct SizeClassStats {
+    size_t buffer_size = 0;
+    int64 used_count = 0;
+    int64 cached_count = 0;
+  };
+  // buffers from 2 KB to 1 MB are allocated in size classes and freed buffers are cached for reuse;
+  // get_buffer_mem doesn't include memory of cached buffers
+  static vector<SizeClassStats> get_size_class_stats();
+  static size_t get_cached_buffer_mem();
+
   static void clear_thread_local();
 
  private:
@@ -407,6 +418,13 @@ struct ChainBufferNode {
   ChainBufferNode(BufferSlice slice, bool sync_flag) : slice_(std::move(slice)), sync_flag_(sync_flag) {
   }
 
+  static void *operator new(size_t size) {
+    return allocate_small_object(size);
+  }
+  static void operator delete(void *ptr, size_t size) {
+    free_small_object(ptr, size);
+  }
+
   // reader
   // There are two options
   // 1. Fixed slice of Buffer
@@ -727,6 +745,16 @@ class ChainBufferWriter {
     writer_.confirm_append(size);
   }
 
+  // appends data already written to the writer without copying and continues to append to its free space
+  void append_writer(BufferWriter &&writer) {
+    CHECK(!empty());
+    CHECK(!writer.is_null());
+    auto new_tail = ChainBufferNodeAllocator::create(writer.as_buffer_slice(), true);
+    tail_->next_ = ChainBufferNodeAllocator::clone(new_tail);
+    writer_ = std::move(writer);
+    tail_ = std::move(new_tail);  // release tail_
+  }
+
   void append(Slice slice, size_t hint = 0) {
     while (!slice.empty()) {
       auto ready = prepare_append(td::max(slice.size(), hint));
@@ -745,10 +773,16 @@ class ChainBufferWriter {
       return append(slice.as_slice());
     }
 
-    auto new_tail = ChainBufferNodeAllocator::create(std::move(slice), false);
-    tail_->next_ = ChainBufferNodeAllocator::clone(new_tail);
-    writer_ = BufferWriter();
-    tail_ = std::move(new_tail);  // release tail_
+    append_node(std::move(slice));
+  }
+
+  // appends the slice by reference even if it fits into free space of the current buffer; only tiny slices are copied
+  void append_by_reference(BufferSlice slice) {
+    if (slice.size() < (1 << 8)) {
+      return append(slice.as_slice());
+    }
+
+    append_node(std::move(slice));
   }
 
   void append(ChainBufferReader &&reader) {
@@ -762,6 +796,12 @@ class ChainBufferWriter {
     }
   }
 
+  void append_by_reference(ChainBufferReader &&reader) {
+    while (!reader.empty()) {
+      append_by_reference(reader.read_as_buffer_slice());
+    }
+  }
+
   ChainBufferReader extract_reader() {
     CHECK(head_);
     return ChainBufferReader(std::move(head_));
@@ -772,6 +812,13 @@ class ChainBufferWriter {
     return !tail_;
   }
 
+  void append_node(BufferSlice slice) {
+    auto new_tail = ChainBufferNodeAllocator::create(std::move(slice), false);
+    tail_->next_ = ChainBufferNodeAllocator::clone(new_tail);
+    writer_ = BufferWriter();
+    tail_ = std::move(new_tail);  // release tail_
+  }
+
   ChainBufferNodeReaderPtr head_;
   ChainBufferNodeWriterPtr tail_;
   BufferWriter writer_;
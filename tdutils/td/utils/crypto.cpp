@@ -33,6 +33,13 @@
 #include <openssl/sha.h>
 #endif
 
+#if TD_HAVE_OPENSSL && (TD_GCC || TD_CLANG) && defined(__x86_64__)
+#define TD_HAVE_AES_NI 1
+#include <wmmintrin.h>
+#else
+#define TD_HAVE_AES_NI 0
+#endif
+
 #if TD_HAVE_ZLIB
 #include <zlib.h>
 #endif
@@ -44,6 +51,7 @@
 #include <algorithm>
 #include <cerrno>
 #include <cstring>
+#include <limits>
 #include <mutex>
 #include <utility>
 
@@ -414,15 +422,162 @@ void AesState::decrypt(const uint8 *src, uint8 *dst, int size) {
   impl_->evp.decrypt(src, dst, size);
 }
 
+#if TD_HAVE_AES_NI
+#define TD_AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+// AES-256 implementation using AES-NI instructions, which is used for IGE mode instead of OpenSSL,
+// because there is no way to avoid EVP_DecryptUpdate call per block during IGE decryption
+class AesNi {
+ public:
+  static constexpr size_t MAX_LANE_COUNT = 4;
+
+  static bool is_supported() {
+    static const bool is_supported = __builtin_cpu_supports("aes") != 0;
+    return is_supported;
+  }
+
+  TD_AES_NI_TARGET void init(Slice key, bool encrypt) {
+    CHECK(key.size() == 32);
+    __m128i encryption_keys[ROUND_COUNT + 1];
+    expand_key(key.ubegin(), encryption_keys);
+    if (encrypt) {
+      for (int i = 0; i <= ROUND_COUNT; i++) {
+        round_keys_[i] = encryption_keys[i];
+      }
+    } else {
+      round_keys_[0] = encryption_keys[ROUND_COUNT];
+      for (int i = 1; i < ROUND_COUNT; i++) {
+        round_keys_[i] = _mm_aesimc_si128(encryption_keys[ROUND_COUNT - i]);
+      }
+      round_keys_[ROUND_COUNT] = encryption_keys[0];
+    }
+  }
+
+  struct Lane {
+    const AesNi *aes;
+    AesBlock *encrypted_iv;
+    AesBlock *plaintext_iv;
+    const uint8 *in;
+    uint8 *out;
+  };
+
+  // encrypts or decrypts block_count blocks in each of lane_count independent buffers
+  // IGE mode is sequential by design, so interleaving of several buffers is the only way to hide AES latency
+  // y[i] = E(x[i] ^ y[i - 1]) ^ x[i - 1]
+  // x[i] = D(y[i] ^ x[i - 1]) ^ y[i - 1]
+  template <bool encrypt>
+  TD_AES_NI_TARGET static void ige(const Lane *lanes, size_t lane_count, size_t block_count) {
+    CHECK(lane_count <= MAX_LANE_COUNT);
+    __m128i x[MAX_LANE_COUNT];
+    __m128i y[MAX_LANE_COUNT];
+    __m128i next[MAX_LANE_COUNT];
+    __m128i state[MAX_LANE_COUNT];
+    for (size_t j = 0; j < lane_count; j++) {
+      y[j] = load(lanes[j].encrypted_iv->raw());
+      x[j] = load(lanes[j].plaintext_iv->raw());
+    }
+    for (size_t i = 0; i < block_count; i++) {
+      auto offset = i * AES_BLOCK_SIZE;
+      for (size_t j = 0; j < lane_count; j++) {
+        next[j] = load(lanes[j].in + offset);
+        state[j] = _mm_xor_si128(_mm_xor_si128(next[j], encrypt ? y[j] : x[j]), lanes[j].aes->round_keys_[0]);
+      }
+      for (int r = 1; r < ROUND_COUNT; r++) {
+        for (size_t j = 0; j < lane_count; j++) {
+          auto &round_key = lanes[j].aes->round_keys_[r];
+          state[j] = encrypt ? _mm_aesenc_si128(state[j], round_key) : _mm_aesdec_si128(state[j], round_key);
+        }
+      }
+      for (size_t j = 0; j < lane_count; j++) {
+        auto &round_key = lanes[j].aes->round_keys_[ROUND_COUNT];
+        if (encrypt) {
+          y[j] = _mm_xor_si128(_mm_aesenclast_si128(state[j], round_key), x[j]);
+          x[j] = next[j];
+          store(lanes[j].out + offset, y[j]);
+        } else {
+          x[j] = _mm_xor_si128(_mm_aesdeclast_si128(state[j], round_key), y[j]);
+          y[j] = next[j];
+          store(lanes[j].out + offset, x[j]);
+        }
+      }
+    }
+    for (size_t j = 0; j < lane_count; j++) {
+      store(lanes[j].encrypted_iv->raw(), y[j]);
+      store(lanes[j].plaintext_iv->raw(), x[j]);
+    }
+  }
+
+ private:
+  static constexpr int ROUND_COUNT = 14;
+
+  __m128i round_keys_[ROUND_COUNT + 1];
+
+  TD_AES_NI_TARGET static __m128i load(const uint8 *from) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(from));
+  }
+
+  TD_AES_NI_TARGET static void store(uint8 *to, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to), value);
+  }
+
+  TD_AES_NI_TARGET static __m128i xor_shifted(__m128i key) {
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  }
+
+  template <int rcon>
+  TD_AES_NI_TARGET static void expand_key_step(__m128i &key1, __m128i &key3) {
+    key1 = _mm_xor_si128(xor_shifted(key1), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key3, rcon), 0xff));
+    key3 = _mm_xor_si128(xor_shifted(key3), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key1, 0), 0xaa));
+  }
+
+  TD_AES_NI_TARGET static void expand_key(const uint8 *key, __m128i *keys) {
+    auto key1 = load(key);
+    auto key3 = load(key + AES_BLOCK_SIZE);
+    keys[0] = key1;
+    keys[1] = key3;
+    expand_key_step<0x01>(key1, key3);
+    keys[2] = key1;
+    keys[3] = key3;
+    expand_key_step<0x02>(key1, key3);
+    keys[4] = key1;
+    keys[5] = key3;
+    expand_key_step<0x04>(key1, key3);
+    keys[6] = key1;
+    keys[7] = key3;
+    expand_key_step<0x08>(key1, key3);
+    keys[8] = key1;
+    keys[9] = key3;
+    expand_key_step<0x10>(key1, key3);
+    keys[10] = key1;
+    keys[11] = key3;
+    expand_key_step<0x20>(key1, key3);
+    keys[12] = key1;
+    keys[13] = key3;
+    key1 = _mm_xor_si128(xor_shifted(key1), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key3, 0x40), 0xff));
+    keys[14] = key1;
+  }
+};
+#endif
+
 class AesIgeStateImpl {
  public:
   void init(Slice key, Slice iv, bool encrypt) {
     CHECK(key.size() == 32);
     CHECK(iv.size() == 32);
-    if (encrypt) {
-      evp_.init_encrypt_cbc(key);
-    } else {
-      evp_.init_decrypt_ecb(key);
+#if TD_HAVE_AES_NI
+    use_aes_ni_ = AesNi::is_supported();
+    if (use_aes_ni_) {
+      aes_ni_.init(key, encrypt);
+    }
+#endif
+    if (!use_aes_ni_) {
+      if (encrypt) {
+        evp_.init_encrypt_cbc(key);
+      } else {
+        evp_.init_decrypt_ecb(key);
+      }
     }
 
     encrypted_iv_.load(iv.ubegin());
@@ -438,6 +593,11 @@ class AesIgeStateImpl {
   void encrypt(Slice from, MutableSlice to) {
     CHECK(from.size() % AES_BLOCK_SIZE == 0);
     CHECK(to.size() >= from.size());
+#if TD_HAVE_AES_NI
+    if (use_aes_ni_) {
+      return process_aes_ni<true>(from, to);
+    }
+#endif
     auto len = to.size() / AES_BLOCK_SIZE;
     auto in = from.ubegin();
     auto out = to.ubegin();
@@ -478,6 +638,11 @@ class AesIgeStateImpl {
   void decrypt(Slice from, MutableSlice to) {
     CHECK(from.size() % AES_BLOCK_SIZE == 0);
     CHECK(to.size() >= from.size());
+#if TD_HAVE_AES_NI
+    if (use_aes_ni_) {
+      return process_aes_ni<false>(from, to);
+    }
+#endif
     auto len = to.size() / AES_BLOCK_SIZE;
     auto in = from.ubegin();
     auto out = to.ubegin();
@@ -504,6 +669,17 @@ class AesIgeStateImpl {
   Evp evp_;
   AesBlock encrypted_iv_;
   AesBlock plaintext_iv_;
+  bool use_aes_ni_ = false;
+
+#if TD_HAVE_AES_NI
+  AesNi aes_ni_;
+
+  template <bool encrypt>
+  void process_aes_ni(Slice from, MutableSlice to) {
+    AesNi::Lane lane{&aes_ni_, &encrypted_iv_, &plaintext_iv_, from.ubegin(), to.ubegin()};
+    AesNi::ige<encrypt>(&lane, 1, from.size() / AES_BLOCK_SIZE);
+  }
+#endif
 };
 
 AesIgeState::AesIgeState() = default;
@@ -541,6 +717,64 @@ void aes_ige_decrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlic
   state.get_iv(aes_iv);
 }
 
+template <bool encrypt>
+static void aes_ige_process_multiple(Span<AesIgeBuffer> buffers) {
+#if TD_HAVE_AES_NI
+  if (AesNi::is_supported()) {
+    constexpr size_t MAX_LANE_COUNT = AesNi::MAX_LANE_COUNT;
+    for (size_t pos = 0; pos < buffers.size(); pos += MAX_LANE_COUNT) {
+      auto lane_count = td::min(MAX_LANE_COUNT, buffers.size() - pos);
+      AesNi aes[MAX_LANE_COUNT];
+      AesBlock encrypted_ivs[MAX_LANE_COUNT];
+      AesBlock plaintext_ivs[MAX_LANE_COUNT];
+      AesNi::Lane lanes[MAX_LANE_COUNT];
+      size_t block_counts[MAX_LANE_COUNT];
+      size_t common_block_count = std::numeric_limits<size_t>::max();
+      for (size_t i = 0; i < lane_count; i++) {
+        auto &buffer = buffers[pos + i];
+        CHECK(buffer.aes_iv.size() == 32);
+        CHECK(buffer.from.size() % AES_BLOCK_SIZE == 0);
+        CHECK(buffer.to.size() >= buffer.from.size());
+        aes[i].init(buffer.aes_key, encrypt);
+        encrypted_ivs[i].load(buffer.aes_iv.ubegin());
+        plaintext_ivs[i].load(buffer.aes_iv.ubegin() + AES_BLOCK_SIZE);
+        lanes[i] = AesNi::Lane{&aes[i], &encrypted_ivs[i], &plaintext_ivs[i], buffer.from.ubegin(), buffer.to.ubegin()};
+        block_counts[i] = buffer.from.size() / AES_BLOCK_SIZE;
+        common_block_count = td::min(common_block_count, block_counts[i]);
+      }
+
+      AesNi::ige<encrypt>(lanes, lane_count, common_block_count);
+      for (size_t i = 0; i < lane_count; i++) {
+        lanes[i].in += common_block_count * AES_BLOCK_SIZE;
+        lanes[i].out += common_block_count * AES_BLOCK_SIZE;
+        AesNi::ige<encrypt>(&lanes[i], 1, block_counts[i] - common_block_count);
+
+        auto &buffer = buffers[pos + i];
+        encrypted_ivs[i].store(buffer.aes_iv.ubegin());
+        plaintext_ivs[i].store(buffer.aes_iv.ubegin() + AES_BLOCK_SIZE);
+      }
+    }
+    return;
+  }
+#endif
+
+  for (auto &buffer : buffers) {
+    if (encrypt) {
+      aes_ige_encrypt(buffer.aes_key, buffer.aes_iv, buffer.from, buffer.to);
+    } else {
+      aes_ige_decrypt(buffer.aes_key, buffer.aes_iv, buffer.from, buffer.to);
+    }
+  }
+}
+
+void aes_ige_encrypt_multiple(Span<AesIgeBuffer> buffers) {
+  aes_ige_process_multiple<true>(buffers);
+}
+
+void aes_ige_decrypt_multiple(Span<AesIgeBuffer> buffers) {
+  aes_ige_process_multiple<false>(buffers);
+}
+
 void aes_cbc_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
   CHECK(from.size() <= to.size());
   CHECK(from.size() % 16 == 0);
@@ -1111,8 +1345,34 @@ static const uint64 crc64_table[256] = {
     0xe0ada17364673f59};
 
 static uint64 crc64_partial(Slice data, uint64 crc) {
+  // slicing-by-8: crc64_slice_table[k][b] is CRC of byte b followed by k zero bytes
+  static uint64 crc64_slice_table_raw[8][256];
+  static const auto *crc64_slice_table = [&] {
+    auto *table = crc64_slice_table_raw;
+    for (int b = 0; b < 256; b++) {
+      table[0][b] = crc64_table[b];
+    }
+    for (int k = 1; k < 8; k++) {
+      for (int b = 0; b < 256; b++) {
+        table[k][b] = (table[k - 1][b] >> 8) ^ crc64_table[table[k - 1][b] & 0xff];
+      }
+    }
+    return table;
+  }();
+
   const char *p = data.begin();
-  for (auto len = data.size(); len > 0; len--) {
+  auto len = data.size();
+  while (len >= 8) {
+    // NB: works only for little-endian systems
+    crc ^= as<uint64>(p);
+    crc = crc64_slice_table[7][crc & 0xff] ^ crc64_slice_table[6][(crc >> 8) & 0xff] ^
+          crc64_slice_table[5][(crc >> 16) & 0xff] ^ crc64_slice_table[4][(crc >> 24) & 0xff] ^
+          crc64_slice_table[3][(crc >> 32) & 0xff] ^ crc64_slice_table[2][(crc >> 40) & 0xff] ^
+          crc64_slice_table[1][(crc >> 48) & 0xff] ^ crc64_slice_table[0][crc >> 56];
+    p += 8;
+    len -= 8;
+  }
+  for (; len > 0; len--) {
     crc = crc64_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
   }
   return crc;
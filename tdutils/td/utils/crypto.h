@@ -10,6 +10,7 @@
 #include "td/utils/common.h"
 #include "td/utils/SharedSlice.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Span.h"
 #include "td/utils/Status.h"
 
 namespace td {
@@ -44,6 +45,18 @@ class AesState {
 void aes_ige_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to);
 void aes_ige_decrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to);
 
+// a buffer to be encrypted or decrypted together with other independent buffers
+struct AesIgeBuffer {
+  Slice aes_key;
+  MutableSlice aes_iv;
+  Slice from;
+  MutableSlice to;
+};
+
+// the same as aes_ige_encrypt/aes_ige_decrypt for each of the buffers, but faster if there are several of them
+void aes_ige_encrypt_multiple(Span<AesIgeBuffer> buffers);
+void aes_ige_decrypt_multiple(Span<AesIgeBuffer> buffers);
+
 class AesIgeStateImpl;
 
 class AesIgeState {
@@ -72,10 +72,27 @@ Result<SecureString> read_file_secure(CSlice path, int64 size, int64 offset) {
   return read_file_impl<SecureString>(path, size, offset);
 }
 
-// Very straightforward function. Don't expect much of it.
 Status copy_file(CSlice from, CSlice to, int64 size) {
-  TRY_RESULT(content, read_file(from, size));
-  return write_file(to, content.as_slice());
+  TRY_RESULT(from_file, FileFd::open(from, FileFd::Read));
+  TRY_RESULT(file_size, from_file.get_size());
+  if (size < 0 || size > file_size) {
+    size = file_size;
+  }
+  TRY_RESULT(to_file, FileFd::open(to, FileFd::Truncate | FileFd::Create | FileFd::Write));
+
+  // the file is copied in chunks to not use much memory if the copying can't be done by the kernel
+  constexpr int64 MAX_CHUNK_SIZE = 1 << 26;
+  int64 offset = 0;
+  while (offset < size) {
+    TRY_RESULT(copied_size,
+               from_file.copy_to(to_file, offset, offset, narrow_cast<size_t>(min(size - offset, MAX_CHUNK_SIZE))));
+    if (copied_size == 0) {
+      return Status::Error("Failed to copy file: unexpected end of file");
+    }
+    offset += static_cast<int64>(copied_size);
+  }
+  to_file.close();
+  return Status::OK();
 }
 
 Status write_file(CSlice to, Slice data, WriteFileOptions options) {
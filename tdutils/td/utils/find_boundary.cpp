@@ -17,32 +17,46 @@ bool find_boundary(ChainBufferReader range, Slice boundary, size_t &already_read
   CHECK(boundary.size() <= MAX_BOUNDARY_LENGTH + 4);
   while (!range.empty()) {
     Slice ready = range.prepare_read();
-    if (ready[0] == boundary[0]) {
-      if (range.size() < boundary.size()) {
-        return false;
-      }
-      auto save_range = range.clone();
-      char x[MAX_BOUNDARY_LENGTH + 4];
-      range.advance(boundary.size(), {x, sizeof(x)});
-      if (Slice(x, boundary.size()) == boundary) {
-        return true;
-      }
 
-      // not a boundary, restoring previous state and skip one symbol
-      range = std::move(save_range);
-      range.advance(1);
-      already_read++;
-    } else {
-      const char *ptr = static_cast<const char *>(std::memchr(ready.data(), boundary[0], ready.size()));
-      size_t shift;
+    // look for candidates, which are completely inside the current chunk, without copying the range
+    size_t shift = 0;
+    while (true) {
+      auto ptr = static_cast<const char *>(std::memchr(ready.data() + shift, boundary[0], ready.size() - shift));
       if (ptr == nullptr) {
         shift = ready.size();
-      } else {
-        shift = ptr - ready.data();
+        break;
+      }
+      shift = ptr - ready.data();
+      if (ready.size() - shift < boundary.size()) {
+        break;
+      }
+      if (std::memcmp(ptr, boundary.data(), boundary.size()) == 0) {
+        already_read += shift;
+        return true;
       }
-      already_read += shift;
-      range.advance(shift);
+      shift++;
     }
+    already_read += shift;
+    range.advance(shift);
+    if (shift == ready.size()) {
+      continue;
+    }
+
+    // the candidate continues in the next chunk
+    if (range.size() < boundary.size()) {
+      return false;
+    }
+    auto save_range = range.clone();
+    char x[MAX_BOUNDARY_LENGTH + 4];
+    range.advance(boundary.size(), {x, sizeof(x)});
+    if (Slice(x, boundary.size()) == boundary) {
+      return true;
+    }
+
+    // not a boundary, restoring previous state and skip one symbol
+    range = std::move(save_range);
+    range.advance(1);
+    already_read++;
   }
 
   return false;
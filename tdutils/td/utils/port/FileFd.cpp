@@ -37,6 +37,10 @@
 #include <unistd.h>
 #endif
 
+#if TD_LINUX
+#include <sys/syscall.h>
+#endif
+
 #if TD_PORT_WINDOWS && defined(WIN32_LEAN_AND_MEAN)
 #include <winioctl.h>
 #endif
@@ -308,6 +312,47 @@ Result<size_t> FileFd::read(MutableSlice slice) {
   return OS_ERROR(PSLICE() << "Read from " << get_native_fd() << " has failed");
 }
 
+Result<size_t> FileFd::readv(Span<IoSlice> slices) {
+#if TD_PORT_POSIX
+  auto native_fd = get_native_fd().fd();
+  TRY_RESULT(slices_size, narrow_cast_safe<int>(slices.size()));
+  size_t total_size = 0;
+  for (auto io_slice : slices) {
+    total_size += as_slice(io_slice).size();
+  }
+  auto bytes_read = detail::skip_eintr([&] { return ::readv(native_fd, slices.begin(), slices_size); });
+  bool success = bytes_read >= 0;
+  if (!success) {
+    auto read_errno = errno;
+    if (read_errno == EAGAIN
+#if EAGAIN != EWOULDBLOCK
+        || read_errno == EWOULDBLOCK
+#endif
+    ) {
+      success = true;
+      bytes_read = 0;
+    }
+  }
+  if (success) {
+    if (narrow_cast<size_t>(bytes_read) < total_size) {
+      get_poll_info().clear_flags(PollFlags::Read());
+    }
+    return static_cast<size_t>(bytes_read);
+  }
+  return OS_ERROR(PSLICE() << "Readv from " << get_native_fd() << " has failed");
+#else
+  size_t res = 0;
+  for (Slice slice : slices) {
+    TRY_RESULT(size, read(MutableSlice(const_cast<char *>(slice.data()), slice.size())));
+    res += size;
+    if (size < slice.size()) {
+      break;
+    }
+  }
+  return res;
+#endif
+}
+
 Result<size_t> FileFd::pwrite(Slice slice, int64 offset) {
   if (offset < 0) {
     return Status::Error("Offset must be non-negative");
@@ -355,6 +400,45 @@ Result<size_t> FileFd::pread(MutableSlice slice, int64 offset) const {
   return OS_ERROR(PSLICE() << "Pread from " << get_native_fd() << " at offset " << offset << " has failed");
 }
 
+Result<size_t> FileFd::copy_to(FileFd &to, int64 offset, int64 to_offset, size_t size) const {
+  if (offset < 0 || to_offset < 0) {
+    return Status::Error("Offset must be non-negative");
+  }
+#if TD_LINUX && defined(__NR_copy_file_range)
+  {
+    TRY_RESULT(in_offset, narrow_cast_safe<loff_t>(offset));
+    TRY_RESULT(out_offset, narrow_cast_safe<loff_t>(to_offset));
+    auto bytes_copied = detail::skip_eintr([&] {
+      return syscall(__NR_copy_file_range, get_native_fd().fd(), &in_offset, to.get_native_fd().fd(), &out_offset,
+                     size, 0u);
+    });
+    if (bytes_copied >= 0) {
+      return narrow_cast<size_t>(bytes_copied);
+    }
+    auto copy_errno = errno;
+    if (copy_errno != ENOSYS && copy_errno != EXDEV && copy_errno != EINVAL && copy_errno != EOPNOTSUPP &&
+        copy_errno != EPERM) {
+      return OS_ERROR(PSLICE() << "Copy from " << get_native_fd() << " at offset " << offset << " to "
+                               << to.get_native_fd() << " at offset " << to_offset << " has failed");
+    }
+    // the kernel or the file system doesn't support the copying, fall back to pread and pwrite
+  }
+#endif
+
+  constexpr size_t MAX_BUFFER_SIZE = 1 << 20;
+  string buffer(min(size, MAX_BUFFER_SIZE), '\0');
+  TRY_RESULT(read_size, pread(buffer, offset));
+  if (read_size == 0) {
+    return 0;
+  }
+  TRY_RESULT(written_size, to.pwrite(Slice(buffer).truncate(read_size), to_offset));
+  if (written_size != read_size) {
+    return Status::Error(PSLICE() << "Failed to write file: written " << written_size << " bytes instead of "
+                                  << read_size);
+  }
+  return read_size;
+}
+
 static std::mutex in_process_lock_mutex;
 static std::unordered_set<string> locked_files;
 static ExitGuard exit_guard;
@@ -591,6 +675,28 @@ Status FileFd::sync() {
   return Status::OK();
 }
 
+Status FileFd::sync_data() {
+  CHECK(!empty());
+#if TD_LINUX
+  if (detail::skip_eintr([&] { return fdatasync(get_native_fd().fd()); }) != 0) {
+    return OS_ERROR("Data sync failed");
+  }
+  return Status::OK();
+#else
+  return sync();
+#endif
+}
+
+Status FileFd::start_sync_data() {
+  CHECK(!empty());
+#if TD_LINUX
+  if (detail::skip_eintr([&] { return sync_file_range(get_native_fd().fd(), 0, 0, SYNC_FILE_RANGE_WRITE); }) != 0) {
+    return OS_ERROR("Start of data sync failed");
+  }
+#endif
+  return Status::OK();
+}
+
 Status FileFd::seek(int64 position) {
   CHECK(!empty());
 #if TD_PORT_POSIX
@@ -40,10 +40,15 @@ class FileFd {
   Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT;
   Result<size_t> writev(Span<IoSlice> slices) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
+  Result<size_t> readv(Span<IoSlice> slices) TD_WARN_UNUSED_RESULT;
 
   Result<size_t> pwrite(Slice slice, int64 offset) TD_WARN_UNUSED_RESULT;
   Result<size_t> pread(MutableSlice slice, int64 offset) const TD_WARN_UNUSED_RESULT;
 
+  // copies up to size bytes from the given offset to another file; returns 0 at the end of the file
+  // the data is copied or cloned by the kernel without passing it through user space whenever possible
+  Result<size_t> copy_to(FileFd &to, int64 offset, int64 to_offset, size_t size) const TD_WARN_UNUSED_RESULT;
+
   enum class LockFlags { Write, Read, Unlock };
   Status lock(const LockFlags flags, const string &path, int32 max_tries) TD_WARN_UNUSED_RESULT;
   static void remove_local_lock(const string &path);
@@ -63,6 +68,12 @@ class FileFd {
 
   Status sync() TD_WARN_UNUSED_RESULT;
 
+  // syncs file data and only the metadata needed to read the data back
+  Status sync_data() TD_WARN_UNUSED_RESULT;
+
+  // starts writing of dirty file data to the disk without waiting for completion; does nothing if unsupported
+  Status start_sync_data() TD_WARN_UNUSED_RESULT;
+
   Status seek(int64 position) TD_WARN_UNUSED_RESULT;
 
   Status truncate_to_current_position(int64 current_position) TD_WARN_UNUSED_RESULT;
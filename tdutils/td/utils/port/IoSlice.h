@@ -9,11 +9,19 @@
 #include "td/utils/Slice.h"
 
 #if TD_PORT_POSIX
+#include <climits>
 #include <sys/uio.h>
 #endif
 
 namespace td {
 
+// maximum number of slices passed to a single readv/writev call
+#if defined(IOV_MAX) && IOV_MAX < 128
+constexpr size_t MAX_IO_SLICES = IOV_MAX;
+#else
+constexpr size_t MAX_IO_SLICES = 128;
+#endif
+
 #if TD_PORT_POSIX
 
 using IoSlice = struct iovec;
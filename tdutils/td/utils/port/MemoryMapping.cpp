@@ -24,18 +24,34 @@ namespace td {
 
 class MemoryMapping::Impl {
  public:
-  Impl(MutableSlice data, int64 offset) : data_(data), offset_(offset) {
+  Impl(MutableSlice data, int64 offset, bool is_writable)
+      : data_(data), offset_(offset), is_writable_(is_writable) {
+  }
+  Impl(const Impl &other) = delete;
+  Impl &operator=(const Impl &other) = delete;
+  Impl(Impl &&other) = delete;
+  Impl &operator=(Impl &&other) = delete;
+  ~Impl() {
+#if !TD_WINDOWS
+    if (munmap(data_.data(), data_.size()) != 0) {
+      LOG(ERROR) << OS_ERROR("munmap call failed");
+    }
+#endif
   }
   Slice as_slice() const {
     return data_.substr(narrow_cast<size_t>(offset_));
   }
   MutableSlice as_mutable_slice() const {
-    return {};
+    if (!is_writable_) {
+      return {};
+    }
+    return data_.substr(narrow_cast<size_t>(offset_));
   }
 
  private:
   MutableSlice data_;
   int64 offset_;
+  bool is_writable_;
 };
 
 static Result<int64> get_page_size() {
@@ -75,7 +91,10 @@ Result<MemoryMapping> MemoryMapping::create_from_file(const FileFd &file_fd, con
   if (options.size < 0) {
     end = stat.size_;
   } else {
-    end = begin + stat.size_;
+    end = begin + options.size;
+  }
+  if (end <= begin) {
+    return Status::Error("Can't create memory mapping: nothing to map");
   }
 
   TRY_RESULT(page_size, get_page_size());
@@ -84,12 +103,15 @@ Result<MemoryMapping> MemoryMapping::create_from_file(const FileFd &file_fd, con
   auto data_offset = begin - fixed_begin;
   TRY_RESULT(data_size, narrow_cast_safe<size_t>(end - fixed_begin));
 
-  void *data = mmap(nullptr, data_size, PROT_READ, MAP_PRIVATE, fd, narrow_cast<off_t>(fixed_begin));
+  int prot = options.is_writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  int flags = options.is_writable ? MAP_SHARED : MAP_PRIVATE;
+  void *data = mmap(nullptr, data_size, prot, flags, fd, narrow_cast<off_t>(fixed_begin));
   if (data == MAP_FAILED) {
     return OS_ERROR("mmap call failed");
   }
 
-  return MemoryMapping(make_unique<Impl>(MutableSlice(static_cast<char *>(data), data_size), data_offset));
+  return MemoryMapping(
+      make_unique<Impl>(MutableSlice(static_cast<char *>(data), data_size), data_offset, options.is_writable));
 #endif
 }
 
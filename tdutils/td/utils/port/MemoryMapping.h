@@ -18,6 +18,7 @@ class MemoryMapping {
   struct Options {
     int64 offset{0};
     int64 size{-1};
+    bool is_writable{false};  // changes are written to the file, which must be opened for reading and writing
 
     Options() {
     }
@@ -29,6 +30,10 @@ class MemoryMapping {
       size = new_size;
       return *this;
     }
+    Options &with_writable(bool new_is_writable) {
+      is_writable = new_is_writable;
+      return *this;
+    }
   };
 
   static Result<MemoryMapping> create_anonymous(const Options &options = {});
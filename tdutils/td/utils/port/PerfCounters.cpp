@@ -0,0 +1,149 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/port/PerfCounters.h"
+
+#include "td/utils/port/config.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Status.h"
+
+#if TD_LINUX || TD_ANDROID
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#endif
+
+namespace td {
+
+std::atomic<bool> PerfCounters::is_enabled_{false};
+
+PerfCounters::Values &PerfCounters::Values::operator+=(const Values &other) {
+  cycles += other.cycles;
+  instructions += other.instructions;
+  cache_misses += other.cache_misses;
+  context_switches += other.context_switches;
+  return *this;
+}
+
+PerfCounters::Values &PerfCounters::Values::operator-=(const Values &other) {
+  cycles -= other.cycles;
+  instructions -= other.instructions;
+  cache_misses -= other.cache_misses;
+  context_switches -= other.context_switches;
+  return *this;
+}
+
+StringBuilder &operator<<(StringBuilder &sb, const PerfCounters::Values &values) {
+  sb << "[cycles:" << values.cycles << "][instructions:" << values.instructions;
+  if (values.cycles != 0) {
+    sb << "][IPC:" << StringBuilder::FixedDouble(static_cast<double>(values.instructions) / values.cycles, 2);
+  }
+  return sb << "][cache_misses:" << values.cache_misses << "][context_switches:" << values.context_switches << ']';
+}
+
+#if TD_LINUX || TD_ANDROID
+namespace {
+
+class ThreadPerfCounters {
+ public:
+  ThreadPerfCounters() {
+    // all counters are in one group, so they are read with one system call
+    static const std::pair<uint32, uint64> EVENTS[COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}};
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = EVENTS[i].first;
+      attr.config = EVENTS[i].second;
+      attr.disabled = i == 0 ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      fds_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds_[0], 0));
+      if (fds_[i] < 0) {
+        auto open_errno = errno;
+        close_all();
+        static std::atomic<bool> is_logged{false};
+        if (!is_logged.exchange(true)) {
+          LOG(WARNING) << "Performance counters are unavailable: "
+                       << Status::PosixError(open_errno, "perf_event_open failed");
+        }
+        return;
+      }
+    }
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+  ThreadPerfCounters(const ThreadPerfCounters &) = delete;
+  ThreadPerfCounters &operator=(const ThreadPerfCounters &) = delete;
+  ThreadPerfCounters(ThreadPerfCounters &&) = delete;
+  ThreadPerfCounters &operator=(ThreadPerfCounters &&) = delete;
+  ~ThreadPerfCounters() {
+    close_all();
+  }
+
+  PerfCounters::Values get_values() const {
+    PerfCounters::Values result;
+    if (fds_[0] < 0) {
+      return result;
+    }
+    uint64 data[1 + COUNTER_COUNT];
+    if (read(fds_[0], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[0] != COUNTER_COUNT) {
+      return result;
+    }
+    result.cycles = data[1];
+    result.instructions = data[2];
+    result.cache_misses = data[3];
+    result.context_switches = data[4];
+    return result;
+  }
+
+ private:
+  static constexpr int COUNTER_COUNT = 4;
+  int fds_[COUNTER_COUNT] = {-1, -1, -1, -1};
+
+  void close_all() {
+    for (auto &fd : fds_) {
+      if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+  }
+};
+
+TD_THREAD_LOCAL ThreadPerfCounters *thread_perf_counters;  // static zero-initialized
+
+}  // namespace
+#endif
+
+void PerfCounters::set_enabled(bool is_enabled) {
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+PerfCounters::Values PerfCounters::get_thread_values() {
+  if (!is_enabled()) {
+    return Values();
+  }
+#if TD_LINUX || TD_ANDROID
+  init_thread_local<ThreadPerfCounters>(thread_perf_counters);
+  return thread_perf_counters->get_values();
+#else
+  return Values();
+#endif
+}
+
+}  // namespace td
@@ -0,0 +1,54 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/StringBuilder.h"
+
+#include <atomic>
+
+namespace td {
+
+// hardware and scheduler counters of the current thread
+// supported only on Linux through perf_event_open; elsewhere, or if the kernel forbids it, all values are zero
+// reading the counters is a system call, so they are read only while explicitly enabled
+class PerfCounters {
+ public:
+  struct Values {
+    uint64 cycles = 0;
+    uint64 instructions = 0;
+    uint64 cache_misses = 0;
+    uint64 context_switches = 0;
+
+    bool empty() const {
+      return cycles == 0 && instructions == 0 && cache_misses == 0 && context_switches == 0;
+    }
+
+    Values &operator+=(const Values &other);
+    Values &operator-=(const Values &other);
+  };
+
+  static void set_enabled(bool is_enabled);
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // returns current values of the counters of the thread, or zeros if the counters are disabled
+  static Values get_thread_values();
+
+ private:
+  static std::atomic<bool> is_enabled_;
+};
+
+inline PerfCounters::Values operator-(PerfCounters::Values lhs, const PerfCounters::Values &rhs) {
+  return lhs -= rhs;
+}
+
+StringBuilder &operator<<(StringBuilder &sb, const PerfCounters::Values &values);
+
+}  // namespace td
@@ -9,6 +9,8 @@
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/PollFlags.h"
 
+#include <cmath>
+
 namespace td {
 class PollBase {
  public:
@@ -24,5 +26,13 @@ class PollBase {
   virtual void unsubscribe(PollableFdRef fd) = 0;
   virtual void unsubscribe_before_close(PollableFdRef fd) = 0;
   virtual void run(int timeout_ms) = 0;
+
+  // waits for at most timeout seconds; the default implementation rounds the timeout up to whole milliseconds
+  virtual void run_precise(double timeout) {
+    if (timeout <= 0) {
+      return run(0);
+    }
+    run(timeout >= 1e6 ? 1000000000 : static_cast<int>(std::ceil(timeout * 1000)));
+  }
 };
 }  // namespace td
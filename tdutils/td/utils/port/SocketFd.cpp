@@ -11,6 +11,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/detail/skip_eintr.h"
+#include "td/utils/port/FileFd.h"
 #include "td/utils/port/PollFlags.h"
 
 #if TD_PORT_WINDOWS
@@ -30,6 +31,10 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+
+#if TD_LINUX
+#include <sys/sendfile.h>
+#endif
 #endif
 
 #include <atomic>
@@ -135,6 +140,18 @@ class SocketFdImpl : private Iocp::Callback {
     return res;
   }
 
+  Result<size_t> readv(Span<IoSlice> slices) {
+    size_t total_size = 0;
+    for (auto io_slice : slices) {
+      TRY_RESULT(size, read(MutableSlice(const_cast<char *>(io_slice.data()), io_slice.size())));
+      total_size += size;
+      if (size < io_slice.size()) {
+        break;
+      }
+    }
+    return total_size;
+  }
+
   Status get_pending_error() {
     Status res;
     {
@@ -415,13 +432,31 @@ class SocketFdImpl {
     return write_finish(write_res);
   }
 
+#if TD_LINUX
+  // returns error with code -1 if sendfile can't be used for the file
+  Result<size_t> write_file(const NativeFd &file_fd, int64 offset, size_t size) {
+    CHECK(size > 0);
+    int native_fd = get_native_fd().socket();
+    TRY_RESULT(file_offset, narrow_cast_safe<off_t>(offset));
+    auto write_res = detail::skip_eintr([&] { return ::sendfile(native_fd, file_fd.fd(), &file_offset, size); });
+    if (write_res == 0) {
+      return Status::Error("Unexpected end of file");
+    }
+    if (write_res < 0 && (errno == EINVAL || errno == ENOSYS)) {
+      return Status::Error(-1, "Sendfile is unsupported");
+    }
+    return write_finish(write_res);
+  }
+#endif
+
   Result<size_t> write_finish(ssize_t write_res) {
     auto write_errno = errno;
     if (write_res >= 0) {
       return narrow_cast<size_t>(write_res);
     }
 
-    if (write_errno == EAGAIN
+    // EINPROGRESS is returned by the first write with TCP Fast Open, if the SYN was sent without data
+    if (write_errno == EAGAIN || write_errno == EINPROGRESS
 #if EAGAIN != EWOULDBLOCK
         || write_errno == EWOULDBLOCK
 #endif
@@ -461,6 +496,21 @@ class SocketFdImpl {
     int native_fd = get_native_fd().socket();
     CHECK(slice.size() > 0);
     auto read_res = detail::skip_eintr([&] { return ::read(native_fd, slice.begin(), slice.size()); });
+    return read_finish(read_res);
+  }
+
+  Result<size_t> readv(Span<IoSlice> slices) {
+    if (get_poll_info().get_flags_local().has_pending_error()) {
+      TRY_STATUS(get_pending_error());
+    }
+    int native_fd = get_native_fd().socket();
+    CHECK(!slices.empty());
+    TRY_RESULT(slices_size, narrow_cast_safe<int>(slices.size()));
+    auto read_res = detail::skip_eintr([&] { return ::readv(native_fd, slices.begin(), slices_size); });
+    return read_finish(read_res);
+  }
+
+  Result<size_t> read_finish(ssize_t read_res) {
     auto read_errno = errno;
     if (read_res >= 0) {
       if (read_res == 0) {
@@ -589,7 +639,7 @@ Result<SocketFd> SocketFd::from_native_fd(NativeFd fd) {
   return SocketFd(make_unique<detail::SocketFdImpl>(std::move(fd)));
 }
 
-Result<SocketFd> SocketFd::open(const IPAddress &address) {
+Result<SocketFd> SocketFd::open(const IPAddress &address, bool use_fast_open) {
   NativeFd native_fd{socket(address.get_address_family(), SOCK_STREAM, IPPROTO_TCP)};
   if (!native_fd) {
     return OS_SOCKET_ERROR("Failed to create a socket");
@@ -597,6 +647,15 @@ Result<SocketFd> SocketFd::open(const IPAddress &address) {
   TRY_STATUS(detail::init_socket_options(native_fd));
 
 #if TD_PORT_POSIX
+#ifdef TCP_FASTOPEN_CONNECT
+  if (use_fast_open) {
+    // connect returns immediately and the SYN is sent by the first write; fails on old kernels, which is fine
+    int flags = 1;
+    if (setsockopt(native_fd.socket(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &flags, sizeof(flags)) != 0) {
+      VLOG(fd) << "Failed to enable TCP Fast Open: " << OS_SOCKET_ERROR("setsockopt");
+    }
+  }
+#endif
   int e_connect =
       connect(native_fd.socket(), address.get_sockaddr(), narrow_cast<socklen_t>(address.get_sockaddr_len()));
   if (e_connect == -1) {
@@ -647,8 +706,27 @@ Result<size_t> SocketFd::writev(Span<IoSlice> slices) {
   return impl_->writev(slices);
 }
 
+Result<size_t> SocketFd::write_file(const FileFd &file, int64 offset, size_t size) {
+#if TD_LINUX
+  auto r_size = impl_->write_file(file.get_native_fd(), offset, size);
+  if (r_size.is_ok() || r_size.error().code() != -1) {
+    return r_size;
+  }
+#endif
+  char buffer[1 << 14];
+  TRY_RESULT(read_size, file.pread(MutableSlice(buffer, td::min(size, sizeof(buffer))), offset));
+  if (read_size == 0) {
+    return Status::Error("Unexpected end of file");
+  }
+  return write(Slice(buffer, read_size));
+}
+
 Result<size_t> SocketFd::read(MutableSlice slice) {
   return impl_->read(slice);
 }
 
+Result<size_t> SocketFd::readv(Span<IoSlice> slices) {
+  return impl_->readv(slices);
+}
+
 }  // namespace td
@@ -20,6 +20,8 @@
 
 namespace td {
 
+class FileFd;
+
 namespace detail {
 class SocketFdImpl;
 class SocketFdImplDeleter {
@@ -37,7 +39,8 @@ class SocketFd {
   SocketFd &operator=(SocketFd &&);
   ~SocketFd();
 
-  static Result<SocketFd> open(const IPAddress &address) TD_WARN_UNUSED_RESULT;
+  // if use_fast_open is true and TCP Fast Open is supported, the SYN is sent together with the first written data
+  static Result<SocketFd> open(const IPAddress &address, bool use_fast_open = false) TD_WARN_UNUSED_RESULT;
 
   PollableFdInfo &get_poll_info();
   const PollableFdInfo &get_poll_info() const;
@@ -47,6 +50,11 @@ class SocketFd {
   Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT;
   Result<size_t> writev(Span<IoSlice> slices) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
+  Result<size_t> readv(Span<IoSlice> slices) TD_WARN_UNUSED_RESULT;
+
+  // writes at most size bytes of the file starting from the offset; on Linux data is sent by the kernel directly
+  // from the page cache using sendfile, otherwise it is read to a temporary buffer
+  Result<size_t> write_file(const FileFd &file, int64 offset, size_t size) TD_WARN_UNUSED_RESULT;
 
   const NativeFd &get_native_fd() const;
   static Result<SocketFd> from_native_fd(NativeFd fd);
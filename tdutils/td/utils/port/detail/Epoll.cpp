@@ -15,7 +15,9 @@ char disable_linker_warning_about_empty_file_epoll_cpp TD_UNUSED;
 #include "td/utils/Status.h"
 
 #include <cerrno>
+#include <cmath>
 
+#include <sys/timerfd.h>
 #include <unistd.h>
 
 namespace td {
@@ -26,7 +28,22 @@ void Epoll::init() {
   auto epoll_create_errno = errno;
   LOG_IF(FATAL, !epoll_fd_) << Status::PosixError(epoll_create_errno, "epoll_create failed");
 
-  events_.resize(1000);
+  events_.resize(MIN_EVENT_COUNT);
+
+  // the timer is used to wait for less than a millisecond or for a non-integer number of milliseconds
+  timer_fd_ = NativeFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+  if (!timer_fd_) {
+    auto timerfd_create_errno = errno;
+    LOG(WARNING) << Status::PosixError(timerfd_create_errno, "timerfd_create failed");
+    return;
+  }
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  int err = epoll_ctl(epoll_fd_.fd(), EPOLL_CTL_ADD, timer_fd_.fd(), &event);
+  auto epoll_ctl_errno = errno;
+  LOG_IF(FATAL, err == -1) << Status::PosixError(epoll_ctl_errno, "epoll_ctl ADD failed")
+                           << ", epoll_fd = " << epoll_fd_.fd() << ", timer_fd = " << timer_fd_.fd();
 }
 
 void Epoll::clear() {
@@ -35,6 +52,7 @@ void Epoll::clear() {
   }
   events_.clear();
 
+  timer_fd_.close();
   epoll_fd_.close();
 
   for (auto *list_node = list_root_.next; list_node != &list_root_;) {
@@ -80,6 +98,34 @@ void Epoll::unsubscribe_before_close(PollableFdRef fd) {
   unsubscribe(fd);
 }
 
+void Epoll::run_precise(double timeout) {
+  if (timeout <= 0) {
+    return run(0);
+  }
+  if (timeout >= MAX_PRECISE_TIMEOUT || !timer_fd_) {
+    return PollBase::run_precise(timeout);
+  }
+  auto timeout_ms = std::ceil(timeout * 1000);
+  if (timeout_ms - timeout * 1000 < 1e-3) {
+    // the timeout is a whole number of milliseconds
+    return run(static_cast<int>(timeout_ms));
+  }
+
+  auto timeout_ns = static_cast<int64>(timeout * 1e9);
+  struct itimerspec timer_spec;
+  timer_spec.it_interval.tv_sec = 0;
+  timer_spec.it_interval.tv_nsec = 0;
+  timer_spec.it_value.tv_sec = static_cast<time_t>(timeout_ns / 1000000000);
+  timer_spec.it_value.tv_nsec = static_cast<long>(td::max(timeout_ns % 1000000000, static_cast<int64>(1)));
+  if (timerfd_settime(timer_fd_.fd(), 0, &timer_spec, nullptr) == -1) {
+    auto timerfd_settime_errno = errno;
+    LOG(ERROR) << Status::PosixError(timerfd_settime_errno, "timerfd_settime failed");
+    return PollBase::run_precise(timeout);
+  }
+  // the timer wakes up epoll_wait in time; the timeout is kept as a safety net
+  run(static_cast<int>(timeout_ms));
+}
+
 void Epoll::run(int timeout_ms) {
   int ready_n = epoll_wait(epoll_fd_.fd(), &events_[0], static_cast<int>(events_.size()), timeout_ms);
   auto epoll_wait_errno = errno;
@@ -87,8 +133,15 @@ void Epoll::run(int timeout_ms) {
       << Status::PosixError(epoll_wait_errno, "epoll_wait failed");
 
   for (int i = 0; i < ready_n; i++) {
-    PollFlags flags;
     epoll_event *event = &events_[i];
+    if (event->data.ptr == nullptr) {
+      // the timer has expired; its expiration counter must be read to reset the readiness
+      uint64 expiration_count;
+      while (read(timer_fd_.fd(), &expiration_count, sizeof(expiration_count)) == -1 && errno == EINTR) {
+      }
+      continue;
+    }
+    PollFlags flags;
     if (event->events & EPOLLIN) {
       event->events &= ~EPOLLIN;
       flags = flags | PollFlags::Read();
@@ -119,6 +172,11 @@ void Epoll::run(int timeout_ms) {
     pollable_fd.add_flags(flags);
     pollable_fd.release_as_list_node();
   }
+
+  // a full batch means that there can be more ready events, so the next call should fetch more of them at once
+  if (ready_n == static_cast<int>(events_.size()) && events_.size() < MAX_EVENT_COUNT) {
+    events_.resize(events_.size() * 2);
+  }
 }
 }  // namespace detail
 }  // namespace td
@@ -43,12 +43,21 @@ class Epoll final : public PollBase {
 
   void run(int timeout_ms) override;
 
+  void run_precise(double timeout) override;
+
   static bool is_edge_triggered() {
     return true;
   }
 
  private:
+  static constexpr size_t MIN_EVENT_COUNT = 1000;
+  static constexpr size_t MAX_EVENT_COUNT = 64000;
+
+  // longer timeouts are rounded up to whole milliseconds, because the precision loss is negligible for them
+  static constexpr double MAX_PRECISE_TIMEOUT = 1.0;
+
   NativeFd epoll_fd_;
+  NativeFd timer_fd_;
   vector<struct epoll_event> events_;
   ListNode list_root_;
 };
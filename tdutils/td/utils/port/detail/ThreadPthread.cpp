@@ -10,6 +10,7 @@ char disable_linker_warning_about_empty_file_thread_pthread_cpp TD_UNUSED;
 
 #if TD_THREAD_PTHREAD
 
+#include "td/utils/logging.h"
 #include "td/utils/misc.h"
 
 #include <pthread.h>
@@ -68,6 +69,24 @@ void ThreadPthread::set_name(CSlice name) {
 #endif
 }
 
+Status ThreadPthread::set_cpu_affinity(int32 cpu_id) {
+#if TD_LINUX
+  if (cpu_id < 0 || cpu_id >= CPU_SETSIZE) {
+    return Status::Error(PSLICE() << "Invalid CPU " << cpu_id);
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu_id, &cpu_set);
+  auto err = pthread_setaffinity_np(thread_, sizeof(cpu_set), &cpu_set);
+  if (err != 0) {
+    return Status::PosixError(err, "pthread_setaffinity_np failed");
+  }
+  return Status::OK();
+#else
+  return Status::Error("Thread affinity is unsupported");
+#endif
+}
+
 void ThreadPthread::join() {
   if (is_inited_.get()) {
     is_inited_ = false;
@@ -17,6 +17,7 @@
 #include "td/utils/port/detail/ThreadIdGuard.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Status.h"
 
 #include <tuple>
 #include <type_traits>
@@ -55,6 +56,9 @@ class ThreadPthread {
 
   void set_name(CSlice name);
 
+  // allows the thread to run only on the specified CPU
+  Status set_cpu_affinity(int32 cpu_id);
+
   void join();
 
   void detach();
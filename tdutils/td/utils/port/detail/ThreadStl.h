@@ -15,6 +15,7 @@
 #include "td/utils/port/detail/ThreadIdGuard.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Status.h"
 
 #include <thread>
 #include <tuple>
@@ -55,6 +56,9 @@ class ThreadStl {
   }
   void set_name(CSlice name) {
   }
+  Status set_cpu_affinity(int32 cpu_id) {
+    return Status::Error("Thread affinity is unsupported");
+  }
 
   static unsigned hardware_concurrency() {
     return std::thread::hardware_concurrency();
@@ -46,6 +46,8 @@ void TlParser::set_error(const string &error_message) {
   }
 }
 
+// aligned data, which includes all strings of length at least 254, references the parsed buffer without copying
+// short strings are copied, because they can be parsed as TL later and to not keep alive the whole buffer
 BufferSlice TlBufferParser::as_buffer_slice(Slice slice) {
   if (slice.empty()) {
     return BufferSlice();
@@ -132,6 +132,17 @@ class TlParser {
     return fetch_binary_unsafe<T>();
   }
 
+  template <class T>
+  void fetch_array(T *result, size_t count) {
+    if (unlikely(left_len / sizeof(T) < count)) {
+      set_error("Not enough data to read");
+      return;
+    }
+    left_len -= count * sizeof(T);
+    std::memcpy(result, data, count * sizeof(T));
+    data += count * sizeof(T);
+  }
+
   template <class T>
   T fetch_string() {
     check_len(sizeof(int32));
@@ -201,9 +212,11 @@ class TlBufferParser : public TlParser {
   template <class T>
   T fetch_string() {
     auto result = TlParser::fetch_string<T>();
-    for (auto &c : result) {
-      if (c == '\0') {
-        c = ' ';
+    if (std::memchr(result.data(), '\0', result.size()) != nullptr) {
+      for (auto &c : result) {
+        if (c == '\0') {
+          c = ' ';
+        }
       }
     }
     if (check_utf8(result)) {
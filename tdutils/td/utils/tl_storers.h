@@ -141,6 +141,69 @@ class TlStorerCalcLength {
   }
 };
 
+// stores data in a single pass to a reusable buffer, which grows as needed; previous buffer content is overwritten
+class TlStorerGrowable {
+  string &buf_;
+  size_t length_ = 0;
+
+  unsigned char *reserve(size_t size) {
+    if (buf_.size() - length_ < size) {
+      auto new_size = buf_.size() * 2;
+      if (new_size < length_ + size) {
+        new_size = length_ + size;
+      }
+      buf_.resize(new_size);
+    }
+    return reinterpret_cast<unsigned char *>(&buf_[length_]);
+  }
+
+ public:
+  explicit TlStorerGrowable(string &buf) : buf_(buf) {
+  }
+
+  TlStorerGrowable(const TlStorerGrowable &other) = delete;
+  TlStorerGrowable &operator=(const TlStorerGrowable &other) = delete;
+
+  template <class T>
+  void store_binary(const T &x) {
+    std::memcpy(reserve(sizeof(T)), &x, sizeof(T));
+    length_ += sizeof(T);
+  }
+
+  void store_int(int32 x) {
+    store_binary<int32>(x);
+  }
+
+  void store_long(int64 x) {
+    store_binary<int64>(x);
+  }
+
+  void store_slice(Slice slice) {
+    std::memcpy(reserve(slice.size()), slice.begin(), slice.size());
+    length_ += slice.size();
+  }
+
+  void store_storer(const Storer &storer) {
+    length_ += storer.store(reserve(storer.size()));
+  }
+
+  template <class T>
+  void store_string(const T &str) {
+    auto ptr = reserve(str.size() + 11);  // at most 8 bytes of length and 3 bytes of padding
+    TlStorerUnsafe storer(ptr);
+    storer.store_string(str);
+    length_ += static_cast<size_t>(storer.get_buf() - ptr);
+  }
+
+  size_t get_length() const {
+    return length_;
+  }
+
+  Slice as_slice() const {
+    return Slice(buf_.data(), length_);
+  }
+};
+
 class TlStorerToString {
   std::string result;
   size_t shift = 0;
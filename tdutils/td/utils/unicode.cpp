@@ -9,6 +9,7 @@
 #include "td/utils/logging.h"
 
 #include <algorithm>
+#include <array>
 #include <iterator>
 
 namespace td {
@@ -1160,12 +1161,27 @@ static const int32 without_diacritics_ranges[] = {
     917505,     0,       917506, -917507, 917536, 0,       917632, -917633, 917760, 0,       918000, -918001,
     2147483647, 0};
 
-UnicodeSimpleCategory get_unicode_simple_category(uint32 code) {
+static UnicodeSimpleCategory find_unicode_simple_category(uint32 code) {
   auto it = std::upper_bound(std::begin(unicode_simple_category_ranges), std::end(unicode_simple_category_ranges),
                              (code << 5) + 30);
   return static_cast<UnicodeSimpleCategory>(*(it - 1) & 31);
 }
 
+UnicodeSimpleCategory get_unicode_simple_category(uint32 code) {
+  // ASCII characters are the most frequent ones, so avoid binary search for them
+  static const auto ascii_categories = [] {
+    std::array<UnicodeSimpleCategory, 128> result;
+    for (uint32 i = 0; i < 128; i++) {
+      result[i] = find_unicode_simple_category(i);
+    }
+    return result;
+  }();
+  if (code < 128) {
+    return ascii_categories[code];
+  }
+  return find_unicode_simple_category(code);
+}
+
 /**
  * Search pregenerated ranges of pairs for the replacement of specified character
  */
@@ -6,15 +6,64 @@
 //
 #include "td/utils/utf8.h"
 
+#include "td/utils/bits.h"
 #include "td/utils/logging.h"  // for UNREACHABLE
 #include "td/utils/unicode.h"
 
+#include <cstring>
+
+#if defined(__wasm_simd128__)
+#define TD_HAVE_UTF8_WASM_SIMD 1
+#include <wasm_simd128.h>
+#else
+#define TD_HAVE_UTF8_WASM_SIMD 0
+#endif
+
 namespace td {
 
+// the strings are processed by 8 bytes at a time, which is much faster for ASCII text
+
+static constexpr uint64 HIGH_BITS = 0x8080808080808080ULL;
+
+static uint64 load_word(const void *ptr) {
+  uint64 word;
+  std::memcpy(&word, ptr, sizeof(word));
+  return word;
+}
+
+// returns the highest bit of every byte of the word, which is a UTF-8 continuation code unit
+static uint64 get_continuation_code_unit_mask(uint64 word) {
+  return word & ~(word << 1) & HIGH_BITS;
+}
+
+// returns the highest bit of every byte of the word, which is a first code unit of a 4-byte UTF-8 character
+static uint64 get_four_byte_first_code_unit_mask(uint64 word) {
+  constexpr uint64 LOW_BITS = ~HIGH_BITS;
+  uint64 diff = (word & 0xF8F8F8F8F8F8F8F8ULL) ^ 0xF0F0F0F0F0F0F0F0ULL;
+  return ~(((diff & LOW_BITS) + LOW_BITS) | diff) & HIGH_BITS;
+}
+
+#if TD_HAVE_UTF8_WASM_SIMD
+// checks 32 bytes at a time using WebAssembly SIMD
+static bool is_ascii32(const char *data) {
+  v128_t word = wasm_v128_or(wasm_v128_load(data), wasm_v128_load(data + 16));
+  return ((wasm_i64x2_extract_lane(word, 0) | wasm_i64x2_extract_lane(word, 1)) & HIGH_BITS) == 0;
+}
+#endif
+
 bool check_utf8(CSlice str) {
   const char *data = str.data();
   const char *data_end = data + str.size();
   do {
+#if TD_HAVE_UTF8_WASM_SIMD
+    while (data_end - data >= 32 && is_ascii32(data)) {
+      data += 32;
+    }
+#endif
+    while (data_end - data >= 8 && (load_word(data) & HIGH_BITS) == 0) {
+      data += 8;
+    }
+
     unsigned int a = static_cast<unsigned char>(*data++);
     if ((a & 0x80) == 0) {
       if (data == data_end + 1) {
@@ -61,6 +110,97 @@ bool check_utf8(CSlice str) {
   return false;
 }
 
+size_t utf8_length(Slice str) {
+  auto ptr = str.ubegin();
+  auto end = str.uend();
+  size_t result = str.size();
+  while (end - ptr >= 8) {
+    auto word = load_word(ptr);
+    if ((word & HIGH_BITS) != 0) {
+      result -= count_bits64(get_continuation_code_unit_mask(word));
+    }
+    ptr += 8;
+  }
+  while (ptr != end) {
+    result -= !is_utf8_character_first_code_unit(*ptr++);
+  }
+  return result;
+}
+
+size_t utf8_utf16_length(Slice str) {
+  auto ptr = str.ubegin();
+  auto end = str.uend();
+  size_t result = str.size();
+  while (end - ptr >= 8) {
+    auto word = load_word(ptr);
+    if ((word & HIGH_BITS) != 0) {
+      result -= count_bits64(get_continuation_code_unit_mask(word));
+      result += count_bits64(get_four_byte_first_code_unit_mask(word));
+    }
+    ptr += 8;
+  }
+  for (; ptr != end; ptr++) {
+    auto c = *ptr;
+    result += ((c & 0xf8) == 0xf0) - !is_utf8_character_first_code_unit(c);
+  }
+  return result;
+}
+
+namespace detail {
+
+size_t get_utf8_truncated_size(Slice str, size_t length) {
+  auto begin = str.ubegin();
+  auto ptr = begin;
+  auto end = str.uend();
+  while (end - ptr >= 8) {
+    auto word = load_word(ptr);
+    auto character_count =
+        (word & HIGH_BITS) == 0 ? 8 : static_cast<size_t>(8 - count_bits64(get_continuation_code_unit_mask(word)));
+    if (character_count > length) {
+      break;
+    }
+    length -= character_count;
+    ptr += 8;
+  }
+  for (; ptr != end; ptr++) {
+    if (is_utf8_character_first_code_unit(*ptr)) {
+      if (length == 0) {
+        return static_cast<size_t>(ptr - begin);
+      }
+      length--;
+    }
+  }
+  return str.size();
+}
+
+size_t get_utf8_utf16_truncated_size(Slice str, size_t length) {
+  auto begin = str.ubegin();
+  auto ptr = begin;
+  auto end = str.uend();
+  while (ptr != end) {
+    if (length >= 8 && end - ptr >= 8 && (load_word(ptr) & HIGH_BITS) == 0) {
+      length -= 8;
+      ptr += 8;
+      continue;
+    }
+
+    auto c = *ptr;
+    if (is_utf8_character_first_code_unit(c)) {
+      if (length <= 0) {
+        return static_cast<size_t>(ptr - begin);
+      }
+      length--;
+      if (c >= 0xf0) {  // >= 4 bytes in symbol => surrogate pair
+        length--;
+      }
+    }
+    ptr++;
+  }
+  return str.size();
+}
+
+}  // namespace detail
+
 void append_utf8_character(string &str, uint32 ch) {
   if (ch <= 0x7f) {
     str.push_back(static_cast<char>(ch));
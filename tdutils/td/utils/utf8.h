@@ -20,22 +20,10 @@ inline bool is_utf8_character_first_code_unit(unsigned char c) {
 }
 
 /// returns length of UTF-8 string in characters
-inline size_t utf8_length(Slice str) {
-  size_t result = 0;
-  for (auto c : str) {
-    result += is_utf8_character_first_code_unit(c);
-  }
-  return result;
-}
+size_t utf8_length(Slice str);
 
 /// returns length of UTF-8 string in UTF-16 code units
-inline size_t utf8_utf16_length(Slice str) {
-  size_t result = 0;
-  for (auto c : str) {
-    result += is_utf8_character_first_code_unit(c) + ((c & 0xf8) == 0xf0);
-  }
-  return result;
-}
+size_t utf8_utf16_length(Slice str);
 
 /// appends a Unicode character using UTF-8 encoding
 void append_utf8_character(string &str, uint32 ch);
@@ -51,18 +39,21 @@ inline const unsigned char *prev_utf8_unsafe(const unsigned char *ptr) {
 /// moves pointer one UTF-8 character forward and saves code of the skipped character in *code
 const unsigned char *next_utf8_unsafe(const unsigned char *ptr, uint32 *code, const char *source);
 
+namespace detail {
+// returns size of the prefix of the string with the given length in Unicode characters or str.size()
+size_t get_utf8_truncated_size(Slice str, size_t length);
+
+// returns size of the prefix of the string with the given length in UTF-16 code units or str.size()
+size_t get_utf8_utf16_truncated_size(Slice str, size_t length);
+}  // namespace detail
+
 /// truncates UTF-8 string to the given length in Unicode characters
 template <class T>
 T utf8_truncate(T str, size_t length) {
   if (str.size() > length) {
-    for (size_t i = 0; i < str.size(); i++) {
-      if (is_utf8_character_first_code_unit(static_cast<unsigned char>(str[i]))) {
-        if (length == 0) {
-          return str.substr(0, i);
-        } else {
-          length--;
-        }
-      }
+    auto truncated_size = detail::get_utf8_truncated_size(Slice(str), length);
+    if (truncated_size < str.size()) {
+      return str.substr(0, truncated_size);
     }
   }
   return str;
@@ -71,18 +62,9 @@ T utf8_truncate(T str, size_t length) {
 /// truncates UTF-8 string to the given length given in UTF-16 code units
 template <class T>
 T utf8_utf16_truncate(T str, size_t length) {
-  for (size_t i = 0; i < str.size(); i++) {
-    auto c = static_cast<unsigned char>(str[i]);
-    if (is_utf8_character_first_code_unit(c)) {
-      if (length <= 0) {
-        return str.substr(0, i);
-      } else {
-        length--;
-        if (c >= 0xf0) {  // >= 4 bytes in symbol => surrogate pair
-          length--;
-        }
-      }
-    }
+  auto truncated_size = detail::get_utf8_utf16_truncated_size(Slice(str), length);
+  if (truncated_size < str.size()) {
+    return str.substr(0, truncated_size);
   }
   return str;
 }
@@ -0,0 +1,91 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <unordered_map>
+
+TEST(FlatHashMap, simple) {
+  td::FlatHashMap<td::int32, td::string> map;
+  ASSERT_TRUE(map.empty());
+  ASSERT_TRUE(map.begin() == map.end());
+  ASSERT_TRUE(map.find(1) == map.end());
+  ASSERT_EQ(0u, map.count(1));
+  ASSERT_EQ(0u, map.erase(1));
+
+  map[1] = "a";
+  ASSERT_EQ("a", map[1]);
+  ASSERT_EQ(1u, map.size());
+  auto result = map.emplace(2, "b");
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(2, result.first->first);
+  ASSERT_EQ("b", result.first->second);
+  result = map.emplace(2, "c");
+  ASSERT_TRUE(!result.second);
+  ASSERT_EQ("b", result.first->second);
+  ASSERT_EQ(2u, map.size());
+
+  int sum = 0;
+  for (auto &it : map) {
+    sum += it.first;
+  }
+  ASSERT_EQ(3, sum);
+
+  ASSERT_EQ(1u, map.erase(1));
+  ASSERT_EQ(1u, map.size());
+  ASSERT_TRUE(map.find(1) == map.end());
+  ASSERT_EQ("b", map.find(2)->second);
+  map.clear();
+  ASSERT_TRUE(map.empty());
+  ASSERT_TRUE(map.find(2) == map.end());
+}
+
+TEST(FlatHashMap, random) {
+  td::FlatHashMap<td::int64, td::int32> map;
+  std::unordered_map<td::int64, td::int32> reference;
+  auto check = [&] {
+    ASSERT_EQ(reference.size(), map.size());
+    size_t count = 0;
+    for (auto &it : map) {
+      auto ref_it = reference.find(it.first);
+      ASSERT_TRUE(ref_it != reference.end());
+      ASSERT_EQ(ref_it->second, it.second);
+      count++;
+    }
+    ASSERT_EQ(reference.size(), count);
+  };
+
+  for (int i = 0; i < 200000; i++) {
+    // keys with equal low bits must not degrade the map
+    auto key = static_cast<td::int64>(td::Random::fast(1, 3000)) << (i % 2 == 0 ? 0 : 20);
+    auto it = map.find(key);
+    auto ref_it = reference.find(key);
+    ASSERT_EQ(ref_it == reference.end(), it == map.end());
+    if (ref_it != reference.end()) {
+      ASSERT_EQ(ref_it->second, it->second);
+    }
+
+    switch (td::Random::fast(0, 2)) {
+      case 0:
+        ASSERT_EQ(reference.emplace(key, i).second, map.emplace(key, i).second);
+        break;
+      case 1:
+        ASSERT_EQ(reference.erase(key), map.erase(key));
+        break;
+      case 2:
+        reference[key] = i;
+        map[key] = i;
+        break;
+    }
+    if (i % 10000 == 0) {
+      check();
+    }
+  }
+  check();
+}
@@ -7,6 +7,7 @@
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/MpscLinkPollableQueue.h"
 #include "td/utils/MpscLinkQueue.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/tests.h"
@@ -113,4 +114,47 @@ TEST(MpscLinkQueue, multi_thread) {
     thread.join();
   }
 }
+
+#if !TD_EVENTFD_UNSUPPORTED
+TEST(MpscLinkPollableQueue, multi_thread) {
+  td::MpscLinkPollableQueue<td::unique_ptr<int>> queue;
+  queue.init();
+  int threads_n = 10;
+  int queries_n = 100000;
+  std::vector<int> next_value(threads_n);
+  std::vector<td::thread> threads(threads_n);
+  int thread_i = 0;
+  for (auto &thread : threads) {
+    thread = td::thread([&, id = thread_i] {
+      for (int i = 0; i < queries_n; i++) {
+        queue.writer_put(td::make_unique<int>(i * threads_n + id));
+      }
+    });
+    thread_i++;
+  }
+
+  int active_threads = threads_n;
+  while (active_threads) {
+    int ready_n = queue.reader_wait();
+    while (ready_n-- > 0) {
+      auto x = *queue.reader_get_unsafe();
+      auto thread_id = x % threads_n;
+      x /= threads_n;
+      CHECK(next_value[thread_id] == x);
+      next_value[thread_id]++;
+      if (x + 1 == queries_n) {
+        active_threads--;
+      }
+    }
+    queue.reader_flush();
+  }
+  CHECK(queue.reader_wait_nonblock() == 0);
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  queue.writer_put(td::make_unique<int>(0));
+  queue.destroy();
+}
+#endif  //!TD_EVENTFD_UNSUPPORTED
 #endif  //!TD_THREAD_UNSUPPORTED
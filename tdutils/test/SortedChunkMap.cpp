@@ -0,0 +1,144 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2020
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/misc.h"
+#include "td/utils/Random.h"
+#include "td/utils/SortedChunkMap.h"
+#include "td/utils/SortedChunkSet.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <set>
+
+TEST(SortedChunkMap, simple) {
+  td::SortedChunkMap<int, td::string, 4> map;
+  ASSERT_TRUE(map.empty());
+  ASSERT_TRUE(map.begin() == map.end());
+  ASSERT_TRUE(map.get(1) == nullptr);
+  ASSERT_TRUE(--map.end() == map.end());
+
+  for (int i = 10; i > 0; i--) {
+    map.insert(i * 2, td::to_string(i));
+  }
+  ASSERT_EQ(10u, map.size());
+  ASSERT_EQ("5", *map.get(10));
+  ASSERT_TRUE(map.get(11) == nullptr);
+  ASSERT_EQ(12, map.lower_bound(11).key());
+  ASSERT_EQ(12, map.lower_bound(12).key());
+  ASSERT_EQ(14, map.upper_bound(12).key());
+  ASSERT_TRUE(map.upper_bound(20) == map.end());
+  ASSERT_TRUE(--map.upper_bound(1) == map.end());
+  ASSERT_EQ(20, (--map.end()).key());
+  ASSERT_EQ(8, map.partition_point([](const td::string &value) { return td::to_integer<int>(value) < 4; }).key());
+
+  int expected_key = 2;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    ASSERT_EQ(expected_key, it.key());
+    expected_key += 2;
+  }
+
+  ASSERT_EQ("1", map.erase(2));
+  ASSERT_EQ("10", map.erase(20));
+  ASSERT_EQ(8u, map.size());
+  ASSERT_EQ(4, map.begin().key());
+  map.clear();
+  ASSERT_TRUE(map.empty());
+  ASSERT_TRUE(map.begin() == map.end());
+}
+
+TEST(SortedChunkMap, random) {
+  td::SortedChunkMap<td::int32, td::int32, 8> map;
+  std::map<td::int32, td::int32> reference;
+  auto check = [&] {
+    ASSERT_EQ(reference.size(), map.size());
+    auto it = map.begin();
+    for (auto &key_value : reference) {
+      ASSERT_TRUE(it != map.end());
+      ASSERT_EQ(key_value.first, it.key());
+      ASSERT_EQ(key_value.second, it.value());
+      ++it;
+    }
+    ASSERT_TRUE(it == map.end());
+
+    auto rit = map.end();
+    for (auto ref_it = reference.rbegin(); ref_it != reference.rend(); ++ref_it) {
+      --rit;
+      ASSERT_EQ(ref_it->first, rit.key());
+    }
+    ASSERT_TRUE(--rit == map.end());
+  };
+
+  for (int i = 0; i < 100000; i++) {
+    auto key = td::Random::fast(0, 1000);
+    auto ref_it = reference.find(key);
+    auto value = map.get(key);
+    ASSERT_EQ(ref_it == reference.end(), value == nullptr);
+    if (value != nullptr) {
+      ASSERT_EQ(ref_it->second, *value);
+    }
+
+    auto lower = map.lower_bound(key);
+    auto upper = map.upper_bound(key);
+    auto ref_lower = reference.lower_bound(key);
+    auto ref_upper = reference.upper_bound(key);
+    ASSERT_EQ(ref_lower == reference.end(), lower == map.end());
+    ASSERT_EQ(ref_upper == reference.end(), upper == map.end());
+    if (lower != map.end()) {
+      ASSERT_EQ(ref_lower->first, lower.key());
+    }
+    if (upper != map.end()) {
+      ASSERT_EQ(ref_upper->first, upper.key());
+    }
+
+    if (value == nullptr) {
+      map.insert(key, i);
+      reference[key] = i;
+    } else if (td::Random::fast_bool()) {
+      ASSERT_EQ(ref_it->second, map.erase(key));
+      reference.erase(ref_it);
+    } else {
+      *value = i;
+      ref_it->second = i;
+    }
+
+    if (i % 1000 == 0) {
+      check();
+    }
+  }
+  check();
+}
+
+TEST(SortedChunkSet, random) {
+  td::SortedChunkSet<td::int32, 8> set;
+  std::set<td::int32> reference;
+  for (int i = 0; i < 100000; i++) {
+    auto key = td::Random::fast(0, 1000);
+    if (td::Random::fast_bool()) {
+      ASSERT_EQ(reference.insert(key).second, set.insert(key));
+    } else {
+      ASSERT_EQ(reference.erase(key), set.erase(key));
+    }
+    ASSERT_EQ(reference.size(), set.size());
+
+    auto it = set.upper_bound(key);
+    auto ref_it = reference.upper_bound(key);
+    for (int j = 0; j < 3 && ref_it != reference.end(); j++, ++it, ++ref_it) {
+      ASSERT_TRUE(it != set.end());
+      ASSERT_EQ(*ref_it, *it);
+    }
+    if (ref_it == reference.end()) {
+      ASSERT_TRUE(it == set.end());
+    }
+  }
+
+  auto it = set.begin();
+  for (auto key : reference) {
+    ASSERT_EQ(key, *it);
+    ++it;
+  }
+  ASSERT_TRUE(it == set.end());
+}
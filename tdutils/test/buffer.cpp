@@ -7,8 +7,14 @@
 #include "td/utils/tests.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 
+#include <cstring>
+
 using namespace td;
 
 TEST(Buffer, buffer_builder) {
@@ -56,3 +62,113 @@ TEST(Buffer, buffer_builder) {
     ASSERT_EQ(builder.extract().as_slice(), str);
   }
 }
+
+TEST(Buffer, chain_buffer_append_by_reference) {
+  ChainBufferWriter writer;
+  auto reader = writer.extract_reader();
+  writer.append("a");
+
+  BufferSlice big(string(1000, 'b'));
+  auto big_data = big.as_slice().data();
+  writer.append_by_reference(big.clone());
+  writer.append_by_reference(BufferSlice("c"));
+  reader.sync_with_writer();
+  ASSERT_EQ(1002u, reader.size());
+
+  reader.advance(1);
+  ASSERT_TRUE(reader.prepare_read().data() == big_data);
+  ASSERT_EQ(string(1000, 'b') + "c", reader.move_as_buffer_slice().as_slice().str());
+}
+
+static int64 get_cached_buffer_count(size_t size) {
+  for (auto &stats : BufferAllocator::get_size_class_stats()) {
+    if (stats.buffer_size >= size) {
+      return stats.cached_count;
+    }
+  }
+  UNREACHABLE();
+  return 0;
+}
+
+TEST(Buffer, size_classes) {
+  size_t last_buffer_size = 0;
+  for (auto &stats : BufferAllocator::get_size_class_stats()) {
+    ASSERT_TRUE(stats.buffer_size > last_buffer_size);
+    last_buffer_size = stats.buffer_size;
+  }
+  ASSERT_EQ(static_cast<size_t>(1) << 20, last_buffer_size);
+
+  auto buffer_mem = BufferAllocator::get_buffer_mem();
+  for (size_t size : {2049, 3000, 65536, 100000, 1 << 20}) {
+    BufferSlice slice(size);
+    ASSERT_EQ(size, slice.size());
+    std::memset(slice.as_slice().begin(), 'a', size);
+  }
+  ASSERT_EQ(buffer_mem, BufferAllocator::get_buffer_mem());
+  ASSERT_TRUE(BufferAllocator::get_cached_buffer_mem() > 0);
+
+  // buffers freed by another thread must be reused
+  const size_t SIZE = 200000;
+  vector<BufferSlice> slices;
+  for (int i = 0; i < 4; i++) {
+    slices.emplace_back(SIZE);
+  }
+  auto cached_count = get_cached_buffer_count(SIZE);
+  td::thread([&] { slices.clear(); }).join();
+  ASSERT_EQ(cached_count + 4, get_cached_buffer_count(SIZE));
+  for (int i = 0; i < 4; i++) {
+    slices.emplace_back(SIZE);
+  }
+  ASSERT_EQ(cached_count, get_cached_buffer_count(SIZE));
+}
+
+TEST(Buffer, buffered_fd) {
+  string name = "buffered_fd_test";
+  unlink(name).ignore();
+  string str = rand_string('a', 'z', 1000000);
+  {
+    BufferedFd<FileFd> fd(FileFd::open(name, FileFd::Write | FileFd::Create).move_as_ok());
+    for (auto &part : rand_split(str)) {
+      fd.output_buffer().append(BufferSlice(part));
+    }
+    while (fd.need_flush_write()) {
+      fd.flush_write().ensure();
+    }
+  }
+  {
+    BufferedFd<FileFd> fd(FileFd::open(name, FileFd::Read).move_as_ok());
+    fd.get_poll_info().add_flags(PollFlags::Read());
+    string result;
+    while (can_read_local(fd)) {
+      fd.flush_read(Random::fast(1, 100000)).ensure();
+      auto &input = fd.input_buffer();
+      result += input.cut_head(input.size()).move_as_buffer_slice().as_slice().str();
+    }
+    ASSERT_EQ(str, result);
+  }
+  unlink(name).ignore();
+}
+
+TEST(Buffer, buffered_fd_read_size_hint) {
+  string name = "buffered_fd_read_size_hint_test";
+  unlink(name).ignore();
+  string str = rand_string('a', 'z', 1000000);
+  {
+    auto fd = FileFd::open(name, FileFd::Write | FileFd::Create).move_as_ok();
+    ASSERT_EQ(str.size(), fd.write(str).move_as_ok());
+  }
+  {
+    BufferedFd<FileFd> fd(FileFd::open(name, FileFd::Read).move_as_ok());
+    fd.get_poll_info().add_flags(PollFlags::Read());
+    fd.set_read_size_hint(str.size());
+    ASSERT_EQ(str.size(), fd.flush_read().move_as_ok());
+
+    // the data must be read into at most two buffers
+    auto &input = fd.input_buffer();
+    ASSERT_EQ(str.size(), input.size());
+    auto first_size = input.prepare_read().size();
+    input.advance(first_size);
+    ASSERT_EQ(str.size() - first_size, input.prepare_read().size());
+  }
+  unlink(name).ignore();
+}
@@ -160,6 +160,50 @@ TEST(Crypto, AesIgeState) {
   }
 }
 
+TEST(Crypto, AesIgeMultiple) {
+  for (auto buffer_count : {0, 1, 3, 4, 7}) {
+    td::vector<td::UInt256> keys(buffer_count);
+    td::vector<td::UInt256> initial_ivs(buffer_count);
+    td::vector<td::UInt256> ivs(buffer_count);
+    td::vector<td::UInt256> multiple_ivs(buffer_count);
+    td::vector<td::string> plaintexts(buffer_count);
+    td::vector<td::string> ciphertexts(buffer_count);
+    td::vector<td::string> multiple_ciphertexts(buffer_count);
+    td::vector<td::AesIgeBuffer> buffers(buffer_count);
+    for (int i = 0; i < buffer_count; i++) {
+      td::Random::secure_bytes(keys[i].raw, sizeof(keys[i].raw));
+      td::Random::secure_bytes(initial_ivs[i].raw, sizeof(initial_ivs[i].raw));
+      ivs[i] = initial_ivs[i];
+      multiple_ivs[i] = initial_ivs[i];
+      plaintexts[i] = td::rand_string(std::numeric_limits<char>::min(), std::numeric_limits<char>::max(),
+                                      16 * td::Random::fast(0, 100));
+      ciphertexts[i] = td::string(plaintexts[i].size(), '\0');
+      multiple_ciphertexts[i] = ciphertexts[i];
+      buffers[i] = td::AesIgeBuffer{as_slice(keys[i]), as_slice(multiple_ivs[i]), plaintexts[i],
+                                    td::MutableSlice(multiple_ciphertexts[i])};
+      td::aes_ige_encrypt(as_slice(keys[i]), as_slice(ivs[i]), plaintexts[i], td::MutableSlice(ciphertexts[i]));
+    }
+
+    td::aes_ige_encrypt_multiple(buffers);
+    for (int i = 0; i < buffer_count; i++) {
+      ASSERT_EQ(ciphertexts[i], multiple_ciphertexts[i]);
+      ASSERT_TRUE(ivs[i] == multiple_ivs[i]);
+      ivs[i] = initial_ivs[i];
+      multiple_ivs[i] = initial_ivs[i];
+      buffers[i].from = ciphertexts[i];
+      buffers[i].to = td::MutableSlice(multiple_ciphertexts[i]);
+    }
+
+    td::aes_ige_decrypt_multiple(buffers);
+    for (int i = 0; i < buffer_count; i++) {
+      td::aes_ige_decrypt(as_slice(keys[i]), as_slice(ivs[i]), ciphertexts[i], td::MutableSlice(ciphertexts[i]));
+      ASSERT_EQ(plaintexts[i], ciphertexts[i]);
+      ASSERT_EQ(plaintexts[i], multiple_ciphertexts[i]);
+      ASSERT_TRUE(ivs[i] == multiple_ivs[i]);
+    }
+  }
+}
+
 TEST(Crypto, AesCbcState) {
   td::vector<td::uint32> answers1{0u, 3617355989u, 3449188102u, 186999968u, 4244808847u, 2626031206u};
 
@@ -5,6 +5,8 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/utils/filesystem.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/tests.h"
 
@@ -45,3 +47,26 @@ TEST(Misc, clean_filename) {
   test_clean_filename("....test....asdf", "test.asdf");
   test_clean_filename("കറുപ്പ്.txt", "കറപപ.txt");
 }
+
+TEST(Misc, copy_file) {
+  td::CSlice from = "copy_file_from.txt";
+  td::CSlice to = "copy_file_to.txt";
+  td::string data(3000001, '\0');
+  for (auto &c : data) {
+    c = static_cast<char>(td::Random::fast(0, 255));
+  }
+  write_file(from, data).ensure();
+
+  copy_file(from, to).ensure();
+  ASSERT_TRUE(td::read_file_str(to).move_as_ok() == data);
+
+  copy_file(from, to, 1234567).ensure();
+  ASSERT_TRUE(td::read_file_str(to).move_as_ok() == data.substr(0, 1234567));
+
+  copy_file(from, to, 5000000).ensure();
+  ASSERT_TRUE(td::read_file_str(to).move_as_ok() == data);
+
+  td::unlink(from).ignore();
+  td::unlink(to).ignore();
+  ASSERT_TRUE(copy_file(from, to).is_error());
+}
@@ -30,6 +30,19 @@ TEST(Gzip, gzencode_gzdecode) {
   encode_decode(td::string(1000000, 'a'));
 }
 
+TEST(Gzip, gzdecode_gzip_format) {
+  td::Slice packed(
+      "\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x4b\x4c\x1c\x05\xa3\x60\x14\x0c\x77\x00\x00\x03\xda\x38\x9a\xe8\x03\x00\x00",
+      29);
+  ASSERT_EQ(td::string(1000, 'a'), td::gzdecode(packed));
+
+  auto wrong_size = packed.str();
+  wrong_size[wrong_size.size() - 4] = '\xe7';
+  ASSERT_TRUE(td::gzdecode(wrong_size).empty());
+  wrong_size[wrong_size.size() - 4] = '\xe9';
+  ASSERT_TRUE(td::gzdecode(wrong_size).empty());
+}
+
 static void test_gzencode(td::string s) {
   auto begin_time = td::Time::now();
   auto r = td::gzencode(s, td::max(2, static_cast<int>(100 / s.size())));
@@ -46,6 +59,17 @@ TEST(Gzip, gzencode) {
   }
 }
 
+TEST(Gzip, estimate_gzip_compression_ratio) {
+  ASSERT_EQ(1.0, td::estimate_gzip_compression_ratio(td::string()));
+  ASSERT_EQ(0.0, td::estimate_gzip_compression_ratio(td::string(100000, 'a')));
+  for (size_t len = 1000; len <= 1000000; len *= 10) {
+    ASSERT_TRUE(td::estimate_gzip_compression_ratio(td::rand_string(0, 255, len)) > 0.9);
+    auto ratio = td::estimate_gzip_compression_ratio(td::rand_string('a', 'z', len));
+    ASSERT_TRUE(ratio > 0.5);
+    ASSERT_TRUE(ratio < 0.65);
+  }
+}
+
 TEST(Gzip, flow) {
   auto str = td::rand_string('a', 'z', 1000000);
   auto parts = td::rand_split(str);
@@ -10,6 +10,7 @@
 #include "td/utils/Heap.h"
 #include "td/utils/Random.h"
 #include "td/utils/Span.h"
+#include "td/utils/TimerWheel.h"
 
 #include <cstdio>
 #include <set>
@@ -173,3 +174,56 @@ TEST(Heap, random_events) {
     // heap.check();
   }
 }
+
+TEST(TimerWheel, random_events) {
+  struct Node : public td::TimerWheelNode {
+    double timeout_at = 0.0;
+  };
+  const int N = 1000;
+  td::vector<Node> nodes(N);
+  std::set<std::pair<double, int>> timeouts;
+  td::TimerWheel timer_wheel;
+
+  const double max_delays[] = {0.002, 0.2, 20.0, 2000.0, 100000.0};
+  double now = 12345.678;
+  timer_wheel.set_now(now);
+  for (int i = 0; i < 300000; i++) {
+    if (!timer_wheel.empty()) {
+      ASSERT_TRUE(timer_wheel.get_wakeup_at() <= timeouts.begin()->first);
+    }
+
+    int id = td::Random::fast(0, N - 1);
+    auto &node = nodes[id];
+    int x = td::Random::fast(0, 9);
+    if (x < 4) {
+      auto timeout_at = now + td::Random::fast(0.0, max_delays[td::Random::fast(0, 4)]);
+      if (node.in_timer_wheel()) {
+        timeouts.erase(std::make_pair(node.timeout_at, id));
+        timer_wheel.fix(timeout_at, &node);
+      } else {
+        timer_wheel.insert(timeout_at, &node);
+      }
+      node.timeout_at = timeout_at;
+      timeouts.emplace(timeout_at, id);
+    } else if (x < 6) {
+      if (node.in_timer_wheel()) {
+        timeouts.erase(std::make_pair(node.timeout_at, id));
+        timer_wheel.erase(&node);
+      }
+    } else {
+      now += x < 9 ? td::Random::fast(0.0, 0.01) : max_delays[td::Random::fast(0, 4)] * td::Random::fast(0.0, 0.5);
+      double last_timeout_at = 0.0;
+      while (auto expired_node = timer_wheel.pop_expired(now)) {
+        auto &expired = *static_cast<Node *>(expired_node);
+        ASSERT_TRUE(!timeouts.empty());
+        ASSERT_EQ(timeouts.begin()->first, expired.timeout_at);
+        ASSERT_TRUE(expired.timeout_at < now);
+        ASSERT_TRUE(last_timeout_at <= expired.timeout_at);
+        last_timeout_at = expired.timeout_at;
+        timeouts.erase(std::make_pair(expired.timeout_at, static_cast<int>(&expired - &nodes[0])));
+      }
+      ASSERT_TRUE(timeouts.empty() || timeouts.begin()->first >= now);
+    }
+    ASSERT_EQ(timeouts.size(), timer_wheel.size());
+  }
+}
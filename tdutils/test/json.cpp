@@ -8,6 +8,7 @@
 
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/StringBuilder.h"
 
@@ -92,3 +93,30 @@ TEST(JSON, kphp) {
       "{\"keyboard\":[[\"\\u2022 abcdefg\"],[\"\\u2022 hijklmnop\"],[\"\\u2022 "
       "qrstuvwxyz\"]],\"one_time_keyboard\":true}");
 }
+
+TEST(JSON, string_escaping) {
+  const char *parts[] = {"a",  "Hello world ", "\"", "\\", "\n", "\t", "\x01", "\x1f", "\x7f", "/",
+                         "я", "€",            "😀"};
+  for (int i = 0; i < 10000; i++) {
+    string str;
+    auto part_count = Random::fast(0, 20);
+    for (int j = 0; j < part_count; j++) {
+      str += parts[Random::fast(0, static_cast<int>(sizeof(parts) / sizeof(parts[0])) - 1)];
+    }
+
+    for (auto is_raw : {false, true}) {
+      auto encoded = is_raw ? PSTRING() << JsonRawString(str) : PSTRING() << JsonString(str);
+      for (auto c : encoded) {
+        ASSERT_TRUE(static_cast<unsigned char>(c) >= 0x20);
+        ASSERT_TRUE(is_raw || static_cast<unsigned char>(c) < 0x80);
+      }
+      auto r_value = json_decode(encoded);
+      ASSERT_TRUE(r_value.is_ok());
+      ASSERT_TRUE(r_value.ok().type() == JsonValue::Type::String);
+      ASSERT_EQ(str, r_value.ok().get_string());
+    }
+  }
+  ASSERT_EQ("\"a\\\"b\\\\c\\nd\\u0001e\\u044f\"", PSTRING() << JsonString("a\"b\\c\nd\x01" "eя"));
+  ASSERT_EQ("\"long ASCII string with a \\\"quote\\\"\"",
+            PSTRING() << JsonRawString("long ASCII string with a \"quote\""));
+}
@@ -4,15 +4,20 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/utils/AsyncFileLog.h"
 #include "td/utils/benchmark.h"
 #include "td/utils/FileLog.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/MemoryLog.h"
+#include "td/utils/misc.h"
+#include "td/utils/PathView.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
 #include "td/utils/tests.h"
+#include "td/utils/TraceLog.h"
 #include "td/utils/TsFileLog.h"
 
 #include <functional>
@@ -39,10 +44,11 @@ class LogBenchmark : public td::Benchmark {
     threads_.resize(threads_n_);
   }
   void tear_down() override {
-    for (auto path : log_->get_file_paths()) {
+    auto paths = log_->get_file_paths();
+    log_.reset();  // the log can still write to the files before it is destroyed
+    for (auto path : paths) {
       td::unlink(path).ignore();
     }
-    log_.reset();
   }
   void run(int n) override {
     auto old_log_interface = td::log_interface;
@@ -95,6 +101,16 @@ TEST(Log, Bench) {
 
   bench_log("MemoryLog", [] { return td::make_unique<td::MemoryLog<1 << 20>>(); });
 
+  bench_log("AsyncFileLog", [] {
+    return td::AsyncFileLog::create("tmplog", std::numeric_limits<td::int64>::max(), false).move_as_ok();
+  });
+
+  bench_log("AsyncFileLog drop", [] {
+    return td::AsyncFileLog::create("tmplog", std::numeric_limits<td::int64>::max(), false,
+                                    td::AsyncFileLog::OverflowPolicy::Drop)
+        .move_as_ok();
+  });
+
   bench_log("TsFileLog",
             [] { return td::TsFileLog::create("tmplog", std::numeric_limits<td::int64>::max(), false).move_as_ok(); });
 
@@ -142,4 +158,88 @@ TEST(Log, Bench) {
     return td::make_unique<FileLog>();
   });
 }
+
+TEST(Log, AsyncFileLog) {
+  auto log = td::AsyncFileLog::create("tmplog_async", std::numeric_limits<td::int64>::max(), false,
+                                      td::AsyncFileLog::OverflowPolicy::Block, 4096)
+                 .move_as_ok();
+  td::vector<td::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&log, i] {
+      for (int j = 0; j < 10000; j++) {
+        log->append(PSLICE() << i << ' ' << j << '\n', VERBOSITY_NAME(ERROR));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log->append(td::CSlice(td::string(10000, 'a') + '\n'), VERBOSITY_NAME(ERROR));
+  static_cast<td::AsyncFileLog *>(log.get())->flush();
+
+  auto content = td::read_file_str("tmplog_async").move_as_ok();
+  td::vector<int> next_j(4);
+  size_t line_count = 0;
+  for (auto line : td::full_split(content, '\n')) {
+    if (line.empty()) {
+      continue;
+    }
+    line_count++;
+    if (line[0] == 'a') {
+      ASSERT_EQ(10000u, line.size());
+      continue;
+    }
+    auto numbers = td::split(line);
+    auto i = td::to_integer<int>(numbers.first);
+    ASSERT_EQ(next_j[i], td::to_integer<int>(numbers.second));
+    next_j[i]++;
+  }
+  ASSERT_EQ(40001u, line_count);
+
+  log.reset();
+  td::unlink("tmplog_async").ignore();
+}
+
+TEST(Log, TraceLog) {
+  td::mkdir("tmptrace").ignore();
+  ASSERT_TRUE(td::TraceLog::init("tmptrace", 16).is_ok());
+  ASSERT_TRUE(td::TraceLog::init("tmptrace").is_error());
+  td::TraceLog::set_enabled(true);
+  ASSERT_TRUE(td::TraceLog::is_enabled());
+
+  td::uint32 name_id = 0;
+  td::thread([&name_id] {
+    name_id = td::TraceLog::get_name_id("name");
+    ASSERT_EQ(name_id, td::TraceLog::get_name_id(td::string("name")));
+    for (td::uint64 i = 0; i < 20; i++) {
+      td::TraceLog::add_event(td::TraceLog::EventType::ActorEventBegin, name_id, i, i * 2);
+    }
+  }).join();
+  td::TraceLog::set_enabled(false);
+
+  td::vector<td::string> trace_files;
+  td::walk_path("tmptrace", [&](td::CSlice path, auto type) {
+    if (type == td::WalkPath::Type::NotDir && td::begins_with(td::PathView(path).file_name(), "trace.")) {
+      trace_files.push_back(path.str());
+    }
+  }).ignore();
+  ASSERT_EQ(1u, trace_files.size());
+
+  auto content = td::read_file_str(trace_files[0]).move_as_ok();
+  ASSERT_EQ(sizeof(td::TraceLog::FileHeader) + 16 * sizeof(td::TraceLog::Event), content.size());
+  auto header = reinterpret_cast<const td::TraceLog::FileHeader *>(content.data());
+  ASSERT_EQ(td::TraceLog::FileHeader::MAGIC, header->magic);
+  ASSERT_EQ(16u, header->capacity);
+  ASSERT_EQ(20u, header->event_count.load());
+  auto events = reinterpret_cast<const td::TraceLog::Event *>(content.data() + sizeof(td::TraceLog::FileHeader));
+  for (td::uint64 i = 4; i < 20; i++) {
+    auto &event = events[i % 16];
+    ASSERT_EQ(static_cast<td::uint32>(td::TraceLog::EventType::ActorEventBegin), event.type);
+    ASSERT_EQ(name_id, event.name_id);
+    ASSERT_EQ(i, event.id);
+    ASSERT_EQ(i * 2, event.arg);
+  }
+
+  td::rmrf("tmptrace").ignore();
+}
 #endif
@@ -29,6 +29,7 @@
 #include "td/utils/port/wstring_convert.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SmallObjectCache.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
@@ -38,6 +39,7 @@
 #include "td/utils/unicode.h"
 #include "td/utils/utf8.h"
 
+#include <algorithm>
 #include <atomic>
 #include <clocale>
 #include <limits>
@@ -247,6 +249,16 @@ TEST(Misc, base64) {
       auto decoded_secure = base64_decode_secure(encoded);
       ASSERT_TRUE(decoded_secure.is_ok());
       ASSERT_TRUE(decoded_secure.ok().as_slice() == s);
+
+      string buffer = encoded;
+      auto decoded_in_place = base64_decode(encoded, buffer);
+      ASSERT_TRUE(decoded_in_place.is_ok());
+      ASSERT_TRUE(decoded_in_place.ok() == s);
+
+      if (!encoded.empty()) {
+        encoded[encoded.size() / 2] = '*';
+        ASSERT_TRUE(base64_decode(encoded).is_error());
+      }
     }
   }
 
@@ -619,6 +631,79 @@ TEST(Misc, unicode) {
   test_unicode(remove_diacritics);
 }
 
+static string get_random_utf8_string(int max_length) {
+  string result;
+  auto length = Random::fast(0, max_length);
+  for (int i = 0; i < length; i++) {
+    switch (Random::fast(0, 4)) {
+      case 0:
+      case 1:
+        append_utf8_character(result, Random::fast(0x20, 0x7e));
+        break;
+      case 2:
+        append_utf8_character(result, Random::fast(0x80, 0x7ff));
+        break;
+      case 3:
+        append_utf8_character(result, Random::fast(0xe000, 0xffff));
+        break;
+      case 4:
+        append_utf8_character(result, Random::fast(0x10000, 0x10ffff));
+        break;
+    }
+  }
+  return result;
+}
+
+TEST(Misc, utf8) {
+  for (int i = 0; i < 100000; i++) {
+    auto str = get_random_utf8_string(i % 50);
+    ASSERT_TRUE(check_utf8(str));
+
+    size_t length = 0;
+    size_t utf16_length = 0;
+    for (auto c : str) {
+      auto code_unit = static_cast<unsigned char>(c);
+      length += is_utf8_character_first_code_unit(code_unit);
+      utf16_length += is_utf8_character_first_code_unit(code_unit) + ((code_unit & 0xf8) == 0xf0);
+    }
+    ASSERT_EQ(length, utf8_length(str));
+    ASSERT_EQ(utf16_length, utf8_utf16_length(str));
+
+    auto prefix_length = static_cast<size_t>(Random::fast(0, static_cast<int>(length) + 1));
+    auto prefix = utf8_truncate(Slice(str), prefix_length);
+    ASSERT_EQ(td::min(prefix_length, length), utf8_length(prefix));
+    ASSERT_TRUE(prefix.size() == str.size() || is_utf8_character_first_code_unit(str[prefix.size()]));
+    ASSERT_EQ(prefix, utf8_truncate(str, prefix_length));
+
+    size_t utf16_prefix_size = str.size();
+    size_t left_length = prefix_length;
+    for (size_t j = 0; j < str.size(); j++) {
+      auto code_unit = static_cast<unsigned char>(str[j]);
+      if (is_utf8_character_first_code_unit(code_unit)) {
+        if (left_length == 0) {
+          utf16_prefix_size = j;
+          break;
+        }
+        left_length -= 1 + (code_unit >= 0xf0);
+      }
+    }
+    ASSERT_EQ(utf16_prefix_size, utf8_utf16_truncate(Slice(str), prefix_length).size());
+
+    if (!str.empty()) {
+      auto broken_str = str;
+      auto pos = Random::fast(0, static_cast<int>(str.size()) - 1);
+      if (is_utf8_character_first_code_unit(static_cast<unsigned char>(str[pos]))) {
+        broken_str[pos] = static_cast<char>(0x80);
+      } else {
+        broken_str[pos] = 'a';
+      }
+      ASSERT_TRUE(!check_utf8(broken_str));
+      ASSERT_TRUE(check_utf8(str + "abcdefghijklmnopqrstuvwxyz"));
+      ASSERT_TRUE(!check_utf8(string(i % 20, 'a') + broken_str));
+    }
+  }
+}
+
 TEST(BigNum, from_decimal) {
   ASSERT_TRUE(BigNum::from_decimal("").is_error());
   ASSERT_TRUE(BigNum::from_decimal("a").is_error());
@@ -1205,3 +1290,25 @@ TEST(Misc, uname) {
   ASSERT_EQ(first_version.begin(), second_version.begin());
   ASSERT_TRUE(!first_version.empty());
 }
+
+TEST(Misc, SmallObjectCache) {
+  // objects allocated by one thread and freed by another must be safely reused by both of them
+  for (int round = 0; round < 10; round++) {
+    vector<char *> objects;
+    for (int i = 0; i < 5000; i++) {
+      auto object = static_cast<char *>(allocate_small_object(40));
+      std::fill(object, object + 40, static_cast<char>(i));
+      objects.push_back(object);
+    }
+    td::thread th([&] {
+      free_small_object(allocate_small_object(40), 40);
+      for (size_t i = 0; i < objects.size(); i++) {
+        ASSERT_EQ(static_cast<char>(i), objects[i][39]);
+        free_small_object(objects[i], 40);
+      }
+      objects.clear();
+    });
+    th.join();
+    ASSERT_TRUE(objects.empty());
+  }
+}
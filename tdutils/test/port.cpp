@@ -10,6 +10,7 @@
 #include "td/utils/port/EventFd.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/port/IoSlice.h"
+#include "td/utils/port/MemoryMapping.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/signals.h"
 #include "td/utils/port/sleep.h"
@@ -27,6 +28,7 @@
 #include <mutex>
 
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #endif
 
@@ -93,6 +95,8 @@ TEST(Port, files) {
   ASSERT_TRUE(fd.pread(buf_slice.substr(0, 4), 2).is_error());
   fd.seek(11).ensure();
   ASSERT_EQ(2u, fd.write("?!").move_as_ok());
+  fd.start_sync_data().ensure();
+  fd.sync_data().ensure();
 
   ASSERT_TRUE(td::FileFd::open(main_dir, td::FileFd::Read | td::FileFd::CreateNew).is_error());
   fd = td::FileFd::open(fd_path, td::FileFd::Read | td::FileFd::Create).move_as_ok();
@@ -120,6 +124,59 @@ TEST(Port, SparseFiles) {
   td::unlink(path).ensure();
 }
 
+TEST(Port, HardLink) {
+  td::CSlice path = "hard_link.txt";
+  td::CSlice link_path = "hard_link2.txt";
+  td::unlink(path).ignore();
+  td::unlink(link_path).ignore();
+  auto fd = td::FileFd::open(path, td::FileFd::Write | td::FileFd::CreateNew).move_as_ok();
+  fd.write("Hello world!").ensure();
+  fd.close();
+
+  td::hard_link(path, link_path).ensure();
+  ASSERT_TRUE(td::hard_link(path, link_path).is_error());
+  td::unlink(path).ensure();
+
+  char buf[100];
+  td::MutableSlice buf_slice(buf, sizeof(buf));
+  fd = td::FileFd::open(link_path, td::FileFd::Read).move_as_ok();
+  ASSERT_EQ(12u, fd.read(buf_slice).move_as_ok());
+  ASSERT_STREQ("Hello world!", buf_slice.substr(0, 12));
+  fd.close();
+  td::unlink(link_path).ensure();
+}
+
+#if !TD_WINDOWS
+TEST(Port, MemoryMapping) {
+  td::CSlice path = "mapped.txt";
+  td::unlink(path).ignore();
+  auto fd = td::FileFd::open(path, td::FileFd::Read | td::FileFd::Write | td::FileFd::CreateNew).move_as_ok();
+  ASSERT_TRUE(td::MemoryMapping::create_from_file(fd).is_error());
+
+  td::string data(100000, 'a');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>('a' + i % 26);
+  }
+  ASSERT_EQ(data.size(), fd.write(data).move_as_ok());
+
+  {
+    auto mapping = td::MemoryMapping::create_from_file(fd).move_as_ok();
+    ASSERT_STREQ(data, mapping.as_slice());
+  }
+  for (auto offset : {1, 4096, 5000, 99999}) {
+    auto mapping =
+        td::MemoryMapping::create_from_file(fd, td::MemoryMapping::Options().with_offset(offset)).move_as_ok();
+    ASSERT_STREQ(td::Slice(data).substr(offset), mapping.as_slice());
+
+    mapping = td::MemoryMapping::create_from_file(fd, td::MemoryMapping::Options().with_offset(offset).with_size(1))
+                  .move_as_ok();
+    ASSERT_STREQ(td::Slice(data).substr(offset, 1), mapping.as_slice());
+  }
+  fd.close();
+  td::unlink(path).ensure();
+}
+#endif
+
 TEST(Port, Writev) {
   td::vector<td::IoSlice> vec;
   td::CSlice test_file_path = "test.txt";
@@ -254,4 +311,25 @@ TEST(Port, EventFdAndSignals) {
   }
   flag.clear();
 }
+
+#if TD_LINUX
+TEST(Port, ThreadCpuAffinity) {
+  std::atomic<bool> is_pinned{false};
+  std::atomic<int> cpu_id{-1};
+  td::thread thread{[&] {
+    while (!is_pinned.load()) {
+      td::this_thread::yield();
+    }
+    cpu_id = sched_getcpu();
+  }};
+  thread.set_cpu_affinity(0).ensure();
+  is_pinned = true;
+  thread.join();
+  ASSERT_EQ(0, cpu_id.load());
+
+  td::thread other_thread{[] {
+  }};
+  ASSERT_TRUE(other_thread.set_cpu_affinity(-1).is_error());
+}
+#endif
 #endif
@@ -15,15 +15,18 @@
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteStatement.h"
 #include "td/db/TsSeqKeyValue.h"
 
 #include "td/actor/actor.h"
 
 #include "td/utils/base64.h"
 #include "td/utils/common.h"
+#include "td/utils/config.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
@@ -133,6 +136,232 @@ TEST(DB, binlog_encryption) {
   }
 };
 
+TEST(DB, binlog_compaction) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  constexpr int KEY_COUNT = 100;
+  std::map<uint64, string> expected;
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+    vector<uint64> ids;
+    for (int i = 0; i < KEY_COUNT; i++) {
+      auto data = string(1000, static_cast<char>('a' + i % 26));
+      ids.push_back(binlog.add(1, create_storer(data)));
+      expected[ids.back()] = data;
+    }
+
+    bool was_compaction = false;
+    for (int i = 0; i < 10000 && (!was_compaction || binlog.is_compaction_in_progress()); i++) {
+      auto id = ids[Random::fast(0, KEY_COUNT - 1)];
+      auto data = string(4 * Random::fast(1, 500), static_cast<char>('a' + i % 26));
+      binlog.rewrite(id, 1, create_storer(data));
+      expected[id] = data;
+      if (binlog.is_compaction_in_progress()) {
+        was_compaction = true;
+      }
+    }
+    ASSERT_TRUE(was_compaction);
+    ASSERT_TRUE(!binlog.is_compaction_in_progress());
+
+    for (int i = 0; i < 10; i++) {
+      auto id = ids[i];
+      binlog.erase(id);
+      expected.erase(id);
+    }
+    binlog.close().ensure();
+  }
+
+  std::map<uint64, string> loaded;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { loaded[x.id_] = x.data_.str(); }).ensure();
+  ASSERT_TRUE(loaded == expected);
+  binlog.close_and_destroy().ensure();
+}
+
+#if TD_HAVE_ZLIB
+TEST(DB, binlog_compression) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  constexpr int KEY_COUNT = 100;
+  std::map<uint64, string> expected;
+  int64 compressed_size = 0;
+  Binlog::set_min_compressed_event_size(256);
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+    for (int i = 0; i < KEY_COUNT; i++) {
+      auto data = string(4 * Random::fast(1, 1000), static_cast<char>('a' + i % 26));
+      if (i % 10 == 0) {
+        data = Random::fast_bool() ? string() : string(4, 'a');
+      }
+      auto id = binlog.add(1, create_storer(data));
+      expected[id] = data;
+      if (i % 7 == 0) {
+        auto random_data = string(1000, '\0');
+        Random::secure_bytes(random_data);
+        binlog.rewrite(id, 1, create_storer(random_data));
+        expected[id] = random_data;
+      }
+    }
+    binlog.close().ensure();
+    compressed_size = stat(binlog_name).move_as_ok().size_;
+  }
+  Binlog::set_min_compressed_event_size(0);
+
+  std::map<uint64, string> loaded;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &x) {
+          ASSERT_EQ(0, x.flags_ & BinlogEvent::Flags::Compressed);
+          loaded[x.id_] = x.data_.str();
+        })
+      .ensure();
+  ASSERT_TRUE(loaded == expected);
+
+  int64 data_size = 0;
+  for (auto &it : expected) {
+    data_size += static_cast<int64>(it.second.size());
+  }
+  ASSERT_TRUE(compressed_size < data_size / 4);
+  binlog.close_and_destroy().ensure();
+}
+#endif
+
+TEST(DB, binlog_change_key) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  auto cucumber = DbKey::password("cucumber");
+  auto hello = DbKey::raw_key(std::string(32, 'A'));
+  std::map<uint64, string> expected;
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, cucumber).ensure();
+    vector<uint64> ids;
+    for (int i = 0; i < 1000; i++) {
+      auto data = string(1000, static_cast<char>('a' + i % 26));
+      ids.push_back(binlog.add(1, create_storer(data)));
+      expected[ids.back()] = data;
+    }
+
+    binlog.start_change_key(hello);
+    ASSERT_TRUE(binlog.is_compaction_in_progress());
+    for (int i = 0; binlog.is_compaction_in_progress(); i++) {
+      auto id = ids[Random::fast(0, static_cast<int>(ids.size()) - 1)];
+      auto data = string(4 * Random::fast(1, 500), static_cast<char>('a' + i % 26));
+      binlog.rewrite(id, 1, create_storer(data));
+      expected[id] = data;
+      if (i % 3 == 0) {
+        binlog.continue_compaction();
+      }
+    }
+    ids.push_back(binlog.add(1, create_storer("AAAA")));
+    expected[ids.back()] = "AAAA";
+
+    binlog.start_change_key(DbKey::empty());
+    binlog.start_change_key(cucumber);
+    binlog.close().ensure();  // finishes the key change
+  }
+
+  {
+    Binlog binlog;
+    ASSERT_TRUE(binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, hello).is_error());
+  }
+
+  std::map<uint64, string> loaded;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { loaded[x.id_] = x.data_.str(); }, cucumber).ensure();
+  ASSERT_TRUE(loaded == expected);
+  binlog.close_and_destroy().ensure();
+}
+
+TEST(DB, binlog_corrupted_event) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  constexpr int EVENT_COUNT = 6000;
+  constexpr int CORRUPTED_EVENT = 4500;
+  auto get_data = [](int i) {
+    auto data = PSTRING() << "event" << i << '|';
+    data.resize(1000, 'a');
+    return data;
+  };
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+    for (int i = 0; i < EVENT_COUNT; i++) {
+      binlog.add(1, create_storer(get_data(i)));
+    }
+    binlog.close().ensure();
+  }
+
+  auto content = read_file_str(binlog_name).move_as_ok();
+  auto pos = content.find(PSTRING() << "event" << CORRUPTED_EVENT << '|');
+  ASSERT_TRUE(pos != string::npos);
+  content[pos] = 'E';
+  write_file(binlog_name, content).ensure();
+
+  vector<string> loaded;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { loaded.push_back(x.data_.str()); }).ensure();
+  ASSERT_EQ(static_cast<size_t>(CORRUPTED_EVENT), loaded.size());
+  for (int i = 0; i < CORRUPTED_EVENT; i++) {
+    ASSERT_EQ(get_data(i), loaded[i]);
+  }
+  binlog.close_and_destroy().ensure();
+}
+
+TEST(DB, sqlite_key_value_batch) {
+  string path = "test_sqlite_kv";
+  SqliteDb::destroy(path).ignore();
+  SqliteKeyValue kv;
+  kv.init(path).ensure();
+
+  std::map<string, string> expected;
+  vector<std::pair<Slice, Slice>> key_values;
+  vector<string> keys;
+  for (int i = 0; i < 100; i++) {
+    keys.push_back(PSTRING() << "key" << i);
+  }
+  for (int i = 0; i < 100; i++) {
+    key_values.emplace_back(keys[i], keys[(i + 1) % 100]);
+    expected[keys[i]] = keys[(i + 1) % 100];
+  }
+  kv.begin_transaction().ensure();
+  kv.set_batch(key_values);
+  kv.commit_transaction().ensure();
+
+  vector<Slice> erased_keys;
+  for (int i = 0; i < 100; i += 3) {
+    erased_keys.push_back(keys[i]);
+    expected.erase(keys[i]);
+  }
+  erased_keys.push_back("missing key");
+  kv.erase_batch(erased_keys);
+
+  auto all = kv.get_all();
+  ASSERT_EQ(expected.size(), all.size());
+  for (auto &it : expected) {
+    ASSERT_EQ(it.second, kv.get(it.first));
+  }
+
+  vector<Slice> requested_keys;
+  for (int i = 99; i >= 0; i--) {
+    requested_keys.push_back(keys[i]);
+  }
+  requested_keys.push_back("missing key");
+  auto values = kv.get_batch(requested_keys);
+  ASSERT_EQ(requested_keys.size(), values.size());
+  for (size_t i = 0; i < requested_keys.size(); i++) {
+    auto it = expected.find(requested_keys[i].str());
+    ASSERT_EQ(it == expected.end() ? string() : it->second, values[i]);
+  }
+  kv.close();
+  SqliteDb::destroy(path).ignore();
+}
+
 TEST(DB, sqlite_lfs) {
   string path = "test_sqlite_db";
   SqliteDb::destroy(path).ignore();
@@ -142,6 +371,47 @@ TEST(DB, sqlite_lfs) {
   db.exec("PRAGMA user_version").ensure();
 }
 
+TEST(DB, sqlite_profiling) {
+  string path = "test_sqlite_db";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb db;
+  db.init(path).ensure();
+  db.exec("CREATE TABLE test (id INT PRIMARY KEY, value BLOB)").ensure();
+
+  SqliteStatement::set_profiling_enabled(true, 0.0);
+  SqliteStatement::get_profiling_stats(true);
+  auto insert = db.get_statement("INSERT INTO test VALUES(?1, ?2)").move_as_ok();
+  for (int i = 0; i < 10; i++) {
+    insert.bind_int32(1, i).ensure();
+    insert.bind_blob(2, "value").ensure();
+    insert.step().ensure();
+    insert.reset();
+  }
+  auto select = db.get_statement("SELECT value FROM test WHERE id < ?1").move_as_ok();
+  select.bind_int32(1, 5).ensure();
+  select.step().ensure();
+  while (select.has_row()) {
+    select.step().ensure();
+  }
+  select.reset();
+  SqliteStatement::set_profiling_enabled(false, 0.0);
+
+  auto stats = SqliteStatement::get_profiling_stats(true);
+  ASSERT_EQ(2u, stats.size());
+  for (auto &stat : stats) {
+    if (stat.sql == "INSERT INTO test VALUES(?1, ?2)") {
+      ASSERT_EQ(10, stat.execution_count);
+      ASSERT_EQ(0, stat.row_count);
+    } else {
+      ASSERT_EQ("SELECT value FROM test WHERE id < ?1", stat.sql);
+      ASSERT_EQ(1, stat.execution_count);
+      ASSERT_EQ(5, stat.row_count);
+    }
+    ASSERT_TRUE(stat.total_time >= stat.max_time);
+  }
+  ASSERT_TRUE(SqliteStatement::get_profiling_stats(false).empty());
+}
+
 TEST(DB, sqlite_encryption) {
   string path = "test_sqlite_db";
   SqliteDb::destroy(path).ignore();
@@ -639,3 +909,161 @@ TEST(DB, persistent_key_value) {
     }
   }
 }
+
+TEST(DB, binlog_group_commit) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  constexpr int BINLOG_COUNT = 10;
+  constexpr int EVENT_COUNT = 20;
+  auto get_binlog_name = [](int i) {
+    return PSTRING() << "test_binlog" << i;
+  };
+  for (int i = 0; i < BINLOG_COUNT; i++) {
+    Binlog::destroy(get_binlog_name(i)).ignore();
+  }
+
+  class Main : public Actor {
+   public:
+    explicit Main(std::function<string(int)> get_binlog_name) : get_binlog_name_(std::move(get_binlog_name)) {
+    }
+
+    void start_up() override {
+      for (int i = 0; i < BINLOG_COUNT; i++) {
+        auto binlog = std::make_shared<ConcurrentBinlog>();
+        binlog->init(get_binlog_name_(i), [](const BinlogEvent &event) {}).ensure();
+        for (int j = 0; j < EVENT_COUNT; j++) {
+          binlog->add(1, create_storer(string(4 * (j + 1), static_cast<char>('a' + i))), create_promise());
+        }
+        binlog->force_sync(create_promise());
+        binlogs_.push_back(std::move(binlog));
+      }
+    }
+
+    void on_synced() {
+      if (++synced_count_ == BINLOG_COUNT * (EVENT_COUNT + 1)) {
+        for (auto &binlog : binlogs_) {
+          binlog->close(create_promise());
+        }
+      } else if (synced_count_ == BINLOG_COUNT * (EVENT_COUNT + 2)) {
+        Scheduler::instance()->finish();
+        stop();
+      }
+    }
+
+   private:
+    std::function<string(int)> get_binlog_name_;
+    vector<std::shared_ptr<ConcurrentBinlog>> binlogs_;
+    int synced_count_ = 0;
+
+    Promise<> create_promise() {
+      return PromiseCreator::lambda([actor_id = actor_id(this)](Unit) { send_closure(actor_id, &Main::on_synced); });
+    }
+  };
+
+  ConcurrentBinlog::set_group_commit_window(0.01);
+  ConcurrentScheduler sched;
+  sched.init(1);
+  sched.create_actor_unsafe<Main>(1, "Main", get_binlog_name).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  ConcurrentBinlog::set_group_commit_window(0.0);
+
+  for (int i = 0; i < BINLOG_COUNT; i++) {
+    int event_count = 0;
+    Binlog binlog;
+    binlog.init(get_binlog_name(i), [&](const BinlogEvent &event) { event_count++; }).ensure();
+    ASSERT_EQ(EVENT_COUNT, event_count);
+    binlog.close_and_destroy().ensure();
+  }
+}
+
+TEST(DB, binlog_batch) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  // an unfinished batch at the end of the binlog must be ignored
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &event) {}).ensure();
+    auto id = binlog.add(1, create_storer(Slice("abcd")));
+    auto next_id = binlog.peek_next_id();
+    binlog.close().ensure();
+
+    auto content = read_file_str(binlog_name).move_as_ok();
+    content +=
+        BinlogEvent::create_raw(next_id, 1, BinlogEvent::Flags::Partial, create_storer(Slice("efgh"))).as_slice().str();
+    content += BinlogEvent::create_raw(id, BinlogEvent::ServiceTypes::Empty,
+                                       BinlogEvent::Flags::Rewrite | BinlogEvent::Flags::Partial, EmptyStorer())
+                   .as_slice()
+                   .str();
+    write_file(binlog_name, content).ensure();
+  }
+  {
+    vector<string> loaded;
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [&](const BinlogEvent &event) { loaded.push_back(event.data_.str()); }).ensure();
+    ASSERT_EQ(1u, loaded.size());
+    ASSERT_EQ("abcd", loaded[0]);
+    binlog.add(1, create_storer(Slice("ijkl")));
+    binlog.close().ensure();
+  }
+
+  class Main : public Actor {
+   public:
+    explicit Main(string binlog_name) : binlog_name_(std::move(binlog_name)) {
+    }
+
+    void start_up() override {
+      binlog_ = std::make_shared<ConcurrentBinlog>();
+      binlog_->init(binlog_name_, [&](const BinlogEvent &event) { ids_.push_back(event.id_); }).ensure();
+      CHECK(ids_.size() == 2u);
+
+      BinlogBatch batch(binlog_.get());
+      auto id = batch.add(1, create_storer(Slice("mnop")));
+      batch.rewrite(ids_[0], 1, create_storer(Slice("qrst")));
+      batch.erase(ids_[1]);
+      binlog_->add(1, create_storer(Slice("uvwx")));
+      batch.rewrite(id, 1, create_storer(Slice("yzab")));
+      batch.commit(PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+        send_closure(actor_id, &Main::on_committed);
+      }));
+    }
+
+    void on_committed() {
+      binlog_->close(PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+        send_closure(actor_id, &Main::on_closed);
+      }));
+    }
+
+    void on_closed() {
+      Scheduler::instance()->finish();
+      stop();
+    }
+
+   private:
+    string binlog_name_;
+    std::shared_ptr<ConcurrentBinlog> binlog_;
+    vector<uint64> ids_;
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(1);
+  sched.create_actor_unsafe<Main>(1, "Main", binlog_name.str()).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+
+  vector<string> loaded;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &event) { loaded.push_back(event.data_.str()); }).ensure();
+  ASSERT_EQ(3u, loaded.size());
+  ASSERT_EQ("qrst", loaded[0]);
+  ASSERT_EQ("yzab", loaded[1]);
+  ASSERT_EQ("uvwx", loaded[2]);
+  binlog.close_and_destroy().ensure();
+}
@@ -7,6 +7,7 @@
 #include "data.h"
 
 #include "td/net/HttpChunkedByteFlow.h"
+#include "td/net/HttpContentLengthByteFlow.h"
 #include "td/net/HttpHeaderCreator.h"
 #include "td/net/HttpQuery.h"
 #include "td/net/HttpReader.h"
@@ -18,6 +19,7 @@
 #include "td/utils/ByteFlow.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
+#include "td/utils/find_boundary.h"
 #include "td/utils/format.h"
 #include "td/utils/Gzip.h"
 #include "td/utils/GzipByteFlow.h"
@@ -125,6 +127,35 @@ TEST(Http, stack_overflow) {
   }
 }
 
+TEST(Http, find_boundary) {
+  for (int i = 0; i < 1000; i++) {
+    string boundary = i % 2 == 0 ? string("\r\n\r\n") : "--" + rand_string('a', 'c', Random::fast(1, 5));
+    string str = rand_string('a', 'c', Random::fast(0, 50));
+    for (int j = Random::fast(0, 5); j > 0; j--) {
+      str += boundary.substr(0, Random::fast(1, static_cast<int>(boundary.size())));
+      str += rand_string('a', 'c', Random::fast(0, 10));
+    }
+    str += rand_string('\r', '\r', Random::fast(0, 2));
+    auto expected_pos = str.find(boundary);
+
+    ChainBufferWriter writer;
+    auto reader = writer.extract_reader();
+    size_t already_read = 0;
+    bool is_found = false;
+    for (auto &part : rand_split(str)) {
+      writer.append(part);
+      reader.sync_with_writer();
+      is_found = find_boundary(reader.clone(), boundary, already_read);
+      if (is_found) {
+        ASSERT_EQ(expected_pos, already_read);
+        break;
+      }
+      ASSERT_TRUE(already_read <= reader.size());
+    }
+    ASSERT_EQ(expected_pos != string::npos, is_found);
+  }
+}
+
 TEST(Http, reader) {
 #if TD_ANDROID || TD_TIZEN
   return;
@@ -208,6 +239,103 @@ TEST(Http, reader) {
   ASSERT_EQ(start_size, BufferAllocator::get_buffer_slice_size());
 }
 
+namespace {
+class TestFileCallback final : public HttpReader::FileCallback {
+ public:
+  explicit TestFileCallback(std::vector<string> *files) : files_(files) {
+  }
+
+  Status on_file_begin(Slice field_name, Slice file_name, Slice content_type) final {
+    CHECK(!is_open_);
+    is_open_ = true;
+    return Status::OK();
+  }
+
+  size_t get_max_file_part_size() final {
+    return Random::fast(0, 3) == 0 ? 0 : Random::fast(1, 10000);
+  }
+
+  Status on_file_part(BufferSlice &&file_part) final {
+    CHECK(is_open_);
+    CHECK(!file_part.empty());
+    content_ += file_part.as_slice().str();
+    return Status::OK();
+  }
+
+  void on_file_end() final {
+    CHECK(is_open_);
+    is_open_ = false;
+    files_->push_back(std::move(content_));
+    content_.clear();
+  }
+
+  void on_file_abort() final {
+    UNREACHABLE();
+  }
+
+ private:
+  std::vector<string> *files_;
+  string content_;
+  bool is_open_ = false;
+};
+}  // namespace
+
+static string make_multipart_query(const string &content) {
+  string body = "--XyZ\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\nvalue\r\n--XyZ\r\n"
+                "Content-Disposition: form-data; name=\"f\"; filename=\"test.bin\"\r\n\r\n" +
+                content + "\r\n--XyZ--\r\n";
+  HttpHeaderCreator hc;
+  hc.init_post("/");
+  hc.set_content_type("multipart/form-data; boundary=XyZ");
+  hc.set_content_size(body.size());
+  auto r_header = hc.finish();
+  CHECK(r_header.is_ok());
+  return r_header.ok().str() + body;
+}
+
+TEST(Http, reader_file_callback) {
+  td::ChainBufferWriter input_writer;
+  auto input = input_writer.extract_reader();
+  HttpReader reader;
+  reader.init(&input, 1000, 10);
+  std::vector<string> files;
+  reader.set_file_callback(td::make_unique<TestFileCallback>(&files));
+
+  std::vector<string> contents(100);
+  std::vector<string> queries;
+  for (auto &content : contents) {
+    content =
+        rand_string(std::numeric_limits<char>::min(), std::numeric_limits<char>::max(), Random::fast(1001, 50000));
+    queries.push_back(Random::fast_bool() ? make_multipart_query(content) : rand_http_query(content));
+  }
+
+  HttpQuery q;
+  size_t query_count = 0;
+  auto read_queries = [&] {
+    while (true) {
+      auto r_state = reader.read_next(&q);
+      LOG_IF(ERROR, r_state.is_error()) << r_state.error();
+      ASSERT_TRUE(r_state.is_ok());
+      if (r_state.ok() != 0) {
+        break;
+      }
+      ASSERT_EQ(1u, q.files_.size());
+      ASSERT_TRUE(q.files_[0].temp_file_name.empty());
+      ASSERT_EQ(contents[query_count].size(), static_cast<size_t>(q.files_[0].size));
+      query_count++;
+    }
+  };
+  for (auto &str : rand_split(join(queries))) {
+    input_writer.append(str);
+    input.sync_with_writer();
+    read_queries();
+  }
+  while (query_count < contents.size()) {
+    read_queries();
+  }
+  ASSERT_EQ(contents, files);
+}
+
 TEST(Http, gzip_bomb) {
 #if TD_ANDROID || TD_TIZEN || TD_EMSCRIPTEN  // the test should be disabled on low-memory systems
   return;
@@ -348,6 +476,27 @@ TEST(Http, chunked_flow) {
   ASSERT_EQ(str, res);
 }
 
+TEST(Http, content_length_flow) {
+  auto str = rand_string('a', 'z', 100000);
+  auto parts = rand_split(str + "GET");
+  ChainBufferWriter input_writer;
+  auto input = input_writer.extract_reader();
+  ByteFlowSource source(&input);
+  HttpContentLengthByteFlow content_length_flow(str.size());
+  ByteFlowSink sink;
+  source >> content_length_flow >> sink;
+
+  for (auto &part : parts) {
+    input_writer.append(part);
+    source.wakeup();
+  }
+  ASSERT_TRUE(sink.is_ready());
+  LOG_IF(ERROR, sink.status().is_error()) << sink.status();
+  ASSERT_TRUE(sink.status().is_ok());
+  ASSERT_EQ(str, sink.result()->move_as_buffer_slice().as_slice().str());
+  ASSERT_EQ("GET", input.move_as_buffer_slice().as_slice().str());
+}
+
 TEST(Http, chunked_flow_error) {
   auto str = rand_string('a', 'z', 100000);
   for (int d = 1; d < 100; d += 10) {
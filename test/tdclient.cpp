@@ -1186,3 +1186,31 @@ TEST(PartsManager, hands) {
     pm.init(1, 100000, true, 10, {0, 1, 2}, false, true).ensure_error();
   }
 }
+
+TEST(PartsManager, download_part_size) {
+  {
+    td::PartsManager pm;
+    pm.init(1 << 20, 1 << 20, true, 0, {}, false, false).ensure();
+    ASSERT_EQ(64u << 10, pm.get_part_size());
+  }
+  {
+    td::PartsManager pm;
+    pm.init(20 << 20, 20 << 20, true, 0, {}, false, false).ensure();
+    ASSERT_EQ(256u << 10, pm.get_part_size());
+  }
+  {
+    td::PartsManager pm;
+    pm.init(1000 << 20, 1000 << 20, true, 0, {}, false, false).ensure();
+    ASSERT_EQ(1u << 20, pm.get_part_size());
+  }
+  {
+    td::PartsManager pm;
+    pm.init(1000 << 20, 1000 << 20, true, 0, {}, true, true).ensure();
+    ASSERT_EQ(256u << 10, pm.get_part_size());
+  }
+  {
+    td::PartsManager pm;
+    pm.init(1000 << 20, 1000 << 20, true, 128 << 10, {}, false, false).ensure();
+    ASSERT_EQ(128u << 10, pm.get_part_size());
+  }
+}
@@ -8,11 +8,13 @@
 #include "td/db/binlog/BinlogEvent.h"
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/TQueue.h"
+#include "td/db/TsTQueue.h"
 
 #include "td/utils/buffer.h"
 #include "td/utils/int_types.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Span.h"
@@ -51,6 +53,10 @@ class TestTQueue {
     return td::CSlice("tqueue_binlog");
   }
 
+  static td::CSlice segments_path() {
+    return td::CSlice("tqueue_segments");
+  }
+
   TestTQueue() {
     baseline_ = td::TQueue::create();
 
@@ -66,6 +72,18 @@ class TestTQueue {
     binlog->init(binlog_path().str(), [&](const td::BinlogEvent &event) { UNREACHABLE(); }).ensure();
     tqueue_binlog->set_binlog(std::move(binlog));
     binlog_->set_callback(std::move(tqueue_binlog));
+
+    td::rmrf(segments_path()).ignore();
+    create_segmented();
+  }
+
+  void create_segmented() {
+    segmented_ = td::TQueue::create();
+    auto segmented_storage = td::make_unique<td::TQueueSegmentedStorage>();
+    segmented_storage->init(segments_path().str(), 1 << 12).ensure();
+    segmented_storage->replay(*segmented_).ensure();
+    segmented_storage_ = segmented_storage.get();
+    segmented_->set_callback(std::move(segmented_storage));
   }
 
   void restart(td::Random::Xorshift128plus &rnd, td::int32 now) {
@@ -82,10 +100,19 @@ class TestTQueue {
       memory_->run_gc(now);
     }
 
+    if (rnd.fast(0, 10) == 0) {
+      segmented_->run_gc(now);
+      segmented_storage_->run_gc(now);
+    }
+
     if (rnd.fast(0, 30) != 0) {
       return;
     }
 
+    LOG(INFO) << "Restart segmented storage";
+    segmented_->close(td::Promise<>());
+    create_segmented();
+
     LOG(INFO) << "Restart binlog";
     binlog_ = td::TQueue::create();
     auto tqueue_binlog = td::make_unique<td::TQueueBinlog<td::Binlog>>();
@@ -105,16 +132,32 @@ class TestTQueue {
     auto a_id = baseline_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
     auto b_id = memory_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
     auto c_id = binlog_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
+    auto d_id = segmented_->push(queue_id, data, expires_at, 0, new_id).move_as_ok();
     ASSERT_EQ(a_id, b_id);
     ASSERT_EQ(a_id, c_id);
+    ASSERT_EQ(a_id, d_id);
     return a_id;
   }
 
+  void forget(td::TQueue::QueueId qid, td::Random::Xorshift128plus &rnd) {
+    auto head = baseline_->get_head(qid);
+    auto tail = baseline_->get_tail(qid);
+    if (head == tail) {
+      return;
+    }
+    auto event_id = head.advance(rnd.fast(0, tail.value() - head.value() - 1)).move_as_ok();
+    baseline_->forget(qid, event_id);
+    memory_->forget(qid, event_id);
+    binlog_->forget(qid, event_id);
+    segmented_->forget(qid, event_id);
+  }
+
   void check_head_tail(td::TQueue::QueueId qid) {
     //ASSERT_EQ(baseline_->get_head(qid), memory_->get_head(qid));
     //ASSERT_EQ(baseline_->get_head(qid), binlog_->get_head(qid));
     ASSERT_EQ(baseline_->get_tail(qid), memory_->get_tail(qid));
     ASSERT_EQ(baseline_->get_tail(qid), binlog_->get_tail(qid));
+    ASSERT_EQ(baseline_->get_tail(qid), segmented_->get_tail(qid));
   }
 
   void check_get(td::TQueue::QueueId qid, td::Random::Xorshift128plus &rnd, td::int32 now) {
@@ -124,6 +167,8 @@ class TestTQueue {
     td::MutableSpan<td::TQueue::Event> b_span(b, 10);
     td::TQueue::Event c[10];
     td::MutableSpan<td::TQueue::Event> c_span(c, 10);
+    td::TQueue::Event d[10];
+    td::MutableSpan<td::TQueue::Event> d_span(d, 10);
 
     auto a_from = baseline_->get_head(qid);
     //auto b_from = memory_->get_head(qid);
@@ -138,13 +183,17 @@ class TestTQueue {
     baseline_->get(qid, a_from, true, now, a_span).move_as_ok();
     memory_->get(qid, a_from, true, now, b_span).move_as_ok();
     binlog_->get(qid, a_from, true, now, c_span).move_as_ok();
+    segmented_->get(qid, a_from, true, now, d_span).move_as_ok();
     ASSERT_EQ(a_span.size(), b_span.size());
     ASSERT_EQ(a_span.size(), c_span.size());
+    ASSERT_EQ(a_span.size(), d_span.size());
     for (size_t i = 0; i < a_span.size(); i++) {
       ASSERT_EQ(a_span[i].id, b_span[i].id);
       ASSERT_EQ(a_span[i].id, c_span[i].id);
+      ASSERT_EQ(a_span[i].id, d_span[i].id);
       ASSERT_EQ(a_span[i].data, b_span[i].data);
       ASSERT_EQ(a_span[i].data, c_span[i].data);
+      ASSERT_EQ(a_span[i].data, d_span[i].data);
     }
   }
 
@@ -152,7 +201,9 @@ class TestTQueue {
   td::unique_ptr<td::TQueue> baseline_;
   td::unique_ptr<td::TQueue> memory_;
   td::unique_ptr<td::TQueue> binlog_;
+  td::unique_ptr<td::TQueue> segmented_;
   td::TQueueMemoryStorage *memory_storage_{nullptr};
+  td::TQueueSegmentedStorage *segmented_storage_{nullptr};
 };
 
 TEST(TQueue, random) {
@@ -189,12 +240,97 @@ TEST(TQueue, random) {
   auto get = [&] {
     q.check_get(next_queue_id(), rnd, now);
   };
-  td::RandomSteps steps({{push_event, 100}, {check_head_tail, 10}, {get, 40}, {inc_now, 5}, {restart, 1}});
+  auto forget = [&] {
+    q.forget(next_queue_id(), rnd);
+  };
+  td::RandomSteps steps(
+      {{push_event, 100}, {check_head_tail, 10}, {get, 40}, {forget, 20}, {inc_now, 5}, {restart, 1}});
   for (int i = 0; i < 100000; i++) {
     steps.step(rnd);
   }
 }
 
+TEST(TQueue, segmented_storage) {
+  td::CSlice path("tqueue_segments");
+  td::rmrf(path).ignore();
+  auto tqueue = td::TQueue::create();
+  auto storage = td::make_unique<td::TQueueSegmentedStorage>();
+  storage->init(path.str(), 1 << 10).ensure();
+  storage->replay(*tqueue).ensure();
+  auto storage_ptr = storage.get();
+  tqueue->set_callback(std::move(storage));
+
+  // segments with forgotten events are deleted
+  for (int i = 0; i < 1000; i++) {
+    auto id = tqueue->push(1, td::string(100, 'a'), 100, 0, td::TQueue::EventId()).move_as_ok();
+    tqueue->forget(1, id);
+  }
+  ASSERT_TRUE(storage_ptr->get_segment_count() <= 3);
+
+  // segments with expired events are deleted as a whole
+  for (int i = 0; i < 1000; i++) {
+    tqueue->push(2, td::string(100, 'b'), 100 + i, 0, td::TQueue::EventId()).ensure();
+  }
+  auto segment_count = storage_ptr->get_segment_count();
+  ASSERT_TRUE(segment_count > 100);
+  storage_ptr->run_gc(600);
+  ASSERT_TRUE(storage_ptr->get_segment_count() <= segment_count / 2 + 3);
+  auto tail_id = tqueue->get_tail(1);
+  tqueue->close(td::Promise<>());
+
+  tqueue = td::TQueue::create();
+  storage = td::make_unique<td::TQueueSegmentedStorage>();
+  storage->init(path.str(), 1 << 10).ensure();
+  storage->replay(*tqueue).ensure();
+  tqueue->set_callback(std::move(storage));
+  tqueue->run_gc(600);
+  ASSERT_EQ(0u, tqueue->get_size(1));
+  ASSERT_EQ(500u, tqueue->get_size(2));
+  ASSERT_EQ(tail_id, tqueue->get_tail(1));
+  tqueue->close(td::Promise<>());
+  td::rmrf(path).ignore();
+}
+
+TEST(TQueue, sharded) {
+  td::TsTQueue tqueue(4);
+  ASSERT_EQ(4u, tqueue.get_shard_count());
+
+  constexpr int THREAD_COUNT = 4;
+  constexpr int QUEUE_COUNT = 32;
+  constexpr int EVENT_COUNT = 1000;
+  td::vector<td::thread> threads;
+  for (int i = 0; i < THREAD_COUNT; i++) {
+    threads.emplace_back([&tqueue, i] {
+      for (int j = 0; j < EVENT_COUNT; j++) {
+        for (int queue_id = 1 + i; queue_id <= QUEUE_COUNT; queue_id += THREAD_COUNT) {
+          tqueue.push(queue_id, td::to_string(j), j < EVENT_COUNT / 2 ? 10 : 20, queue_id, {}).ensure();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int queue_id = 1; queue_id <= QUEUE_COUNT; queue_id++) {
+    ASSERT_EQ(static_cast<size_t>(EVENT_COUNT), tqueue.get_size(queue_id));
+    td::vector<td::TsTQueue::Event> events;
+    ASSERT_EQ(static_cast<size_t>(EVENT_COUNT),
+              tqueue.get(queue_id, tqueue.get_head(queue_id), false, 0, 10, events).move_as_ok());
+    ASSERT_EQ(10u, events.size());
+    ASSERT_EQ("0", events[0].data);
+    ASSERT_EQ(queue_id, events[9].extra);
+    ASSERT_EQ(tqueue.get_head(queue_id).advance(9).move_as_ok(), events[9].id);
+  }
+
+  ASSERT_EQ(QUEUE_COUNT * EVENT_COUNT / 2, tqueue.run_gc(11));
+  ASSERT_EQ(static_cast<size_t>(EVENT_COUNT / 2), tqueue.get_size(QUEUE_COUNT));
+
+  bool is_closed = false;
+  tqueue.close(td::PromiseCreator::lambda([&is_closed](td::Unit) { is_closed = true; }));
+  ASSERT_TRUE(is_closed);
+}
+
 TEST(TQueue, memory_leak) {
   return;
   auto tqueue = td::TQueue::create();